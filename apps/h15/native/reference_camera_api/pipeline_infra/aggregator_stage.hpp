@@ -61,19 +61,15 @@ public:
 
     void flatten_hailo_roi(HailoROIPtr roi, HailoROIPtr parent_roi, hailo_object_t filter_type)
     {
-        std::vector<HailoObjectPtr> objects = roi->get_objects();
-        for (uint index = 0; index < objects.size(); index++)
+        std::vector<HailoObjectPtr> objects = roi->extract_objects_if([filter_type](const HailoObjectPtr &obj)
+                                                                      { return obj->get_type() == filter_type; });
+        HailoBBox roi_bbox = roi->get_scaling_bbox();
+        for (const HailoObjectPtr &obj : objects)
         {
-            if (objects[index]->get_type() == filter_type)
-            {
-                HailoROIPtr sub_obj_roi = std::dynamic_pointer_cast<HailoROI>(objects[index]);
-                sub_obj_roi->set_bbox(std::move(create_flattened_bbox(sub_obj_roi->get_bbox(), roi->get_scaling_bbox())));
-                parent_roi->add_object(sub_obj_roi);
-                roi->remove_object(index);
-                objects.erase(objects.begin() + index);
-                index--;
-            }
+            HailoROIPtr sub_obj_roi = std::dynamic_pointer_cast<HailoROI>(obj);
+            sub_obj_roi->set_bbox(std::move(create_flattened_bbox(sub_obj_roi->get_bbox(), roi_bbox)));
         }
+        parent_roi->add_objects(objects);
     }
 
     /**
@@ -86,20 +82,18 @@ public:
      */
     static void remove_exceeded_bboxes(HailoROIPtr hailo_tile_roi, float border_threshold)
     {
-        auto detections = hailo_common::get_hailo_detections(hailo_tile_roi);
         HailoBBox tile_bbox = hailo_tile_roi->get_scaling_bbox();
 
-        for (const HailoDetectionPtr &detection : detections)
-        {
-            HailoBBox bbox = detection->get_bbox();
-            bool exceed_xmin = (tile_bbox.xmin() != 0 && bbox.xmin() < border_threshold);
-            bool exceed_xmax = (tile_bbox.xmax() != 1 && (1 - bbox.xmax()) < border_threshold);
-            bool exceed_ymin = (tile_bbox.ymin() != 0 && bbox.ymin() < border_threshold);
-            bool exceed_ymax = (tile_bbox.ymax() != 1 && (1 - bbox.ymax()) < border_threshold);
-
-            if (exceed_xmin || exceed_xmax || exceed_ymin || exceed_ymax)
-                hailo_tile_roi->remove_object(detection);
-        }
+        hailo_tile_roi->remove_objects_if([&tile_bbox, border_threshold](const HailoObjectPtr &obj)
+                                          {
+                                              if (obj->get_type() != HAILO_DETECTION)
+                                                  return false;
+                                              HailoBBox bbox = std::dynamic_pointer_cast<HailoDetection>(obj)->get_bbox();
+                                              bool exceed_xmin = (tile_bbox.xmin() != 0 && bbox.xmin() < border_threshold);
+                                              bool exceed_xmax = (tile_bbox.xmax() != 1 && (1 - bbox.xmax()) < border_threshold);
+                                              bool exceed_ymin = (tile_bbox.ymin() != 0 && bbox.ymin() < border_threshold);
+                                              bool exceed_ymax = (tile_bbox.ymax() != 1 && (1 - bbox.ymax()) < border_threshold);
+                                              return exceed_xmin || exceed_xmax || exceed_ymin || exceed_ymax; });
     }
 
     float iou_calc(const HailoBBox &box_1, const HailoBBox &box_2)
@@ -137,6 +131,7 @@ public:
                 [](HailoDetectionPtr a, HailoDetectionPtr b)
                 { return a->get_confidence() > b->get_confidence(); });
 
+        std::vector<HailoObjectPtr> suppressed;
         for (uint index = 0; index < objects.size(); index++)
         {
             for (uint jindex = index + 1; jindex < objects.size(); jindex++)
@@ -151,13 +146,15 @@ public:
                     {
                         // The detections are arranged in highest score order,
                         // so we want to erase the latter detection.
-                        hailo_roi->remove_object(objects[jindex]);
+                        suppressed.push_back(objects[jindex]);
                         objects.erase(objects.begin() + jindex);
                         jindex--; // Step back jindex since we just erased the current detection.
                     }
                 }
             }
         }
+        // Removed from the roi in a single pass
+        hailo_common::remove_objects(hailo_roi, suppressed);
     }
 
     void loop() override
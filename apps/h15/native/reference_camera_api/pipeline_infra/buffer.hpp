@@ -135,10 +135,11 @@ private:
     HailoROIPtr m_roi;
     std::vector<MetadataPtr> m_metadata;
     std::vector<TimeStampPtr> m_timestamps;
+    std::chrono::steady_clock::time_point m_pts; // When the frame was captured, the same for every buffer made from it
 
 public:
     Buffer(HailoMediaLibraryBufferPtr buffer)
-        : m_buffer(buffer) 
+        : m_buffer(buffer), m_pts(std::chrono::steady_clock::now())
     {
         m_roi = std::make_shared<HailoROI>(HailoROI(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f)));
         TimeStampPtr time_stamp =  std::make_shared<TimeStamp>("Source");
@@ -147,7 +148,7 @@ public:
 
 
     Buffer(HailoMediaLibraryBufferPtr buffer, HailoROIPtr roi)
-        : m_buffer(buffer) 
+        : m_buffer(buffer), m_pts(std::chrono::steady_clock::now())
     {
         if (roi) {
             m_roi = roi;
@@ -164,6 +165,15 @@ public:
         return m_roi;
     }
 
+    std::chrono::steady_clock::time_point get_pts() const {
+        return m_pts;
+    }
+
+    // Buffers made from another frame, like crops, take its PTS
+    void set_pts(std::chrono::steady_clock::time_point pts) {
+        m_pts = pts;
+    }
+
     void add_time_stamp(const std::string &stage) {
         TimeStampPtr time_stamp =  std::make_shared<TimeStamp>(stage);
         m_timestamps.push_back(time_stamp);
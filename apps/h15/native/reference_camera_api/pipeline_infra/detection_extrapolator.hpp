@@ -0,0 +1,178 @@
+#pragma once
+
+// General includes
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * @brief What the extrapolator keeps of a detection, a plain copy that shares nothing with the frame it came from.
+ *        Coordinates are normalized to the frame.
+ */
+struct ExtrapolatedDetection
+{
+    float xmin, ymin, width, height;
+    int class_id;
+    std::string label;
+    float confidence;
+    int track_id; // -1 when the detection isn't tracked
+};
+
+/**
+ * @brief Keeps a constant velocity state per detection, and predicts where the detections are at a later time.
+ *
+ * Detections are matched to the previous ones by track id when they have one, otherwise by IoU with a
+ * detection of the same class. A detection seen for the first time doesn't move until it is matched.
+ */
+class DetectionExtrapolator
+{
+private:
+    struct DetectionState
+    {
+        ExtrapolatedDetection detection;
+        float x_center, y_center, width, height;
+        float vx = 0.0f, vy = 0.0f, vwidth = 0.0f, vheight = 0.0f; // Per second
+        std::chrono::steady_clock::time_point time;
+    };
+
+    std::vector<DetectionState> m_states;
+    float m_smoothing;
+    float m_match_iou;
+
+    static float iou(const DetectionState &a, const DetectionState &b)
+    {
+        float overlap_width = std::min(a.x_center + a.width / 2, b.x_center + b.width / 2) - std::max(a.x_center - a.width / 2, b.x_center - b.width / 2);
+        float overlap_height = std::min(a.y_center + a.height / 2, b.y_center + b.height / 2) - std::max(a.y_center - a.height / 2, b.y_center - b.height / 2);
+        if (overlap_width <= 0.0f || overlap_height <= 0.0f)
+            return 0.0f;
+        float intersection = overlap_width * overlap_height;
+        return intersection / (a.width * a.height + b.width * b.height - intersection);
+    }
+
+    // A state moved to the given time
+    static DetectionState advance(const DetectionState &state, std::chrono::steady_clock::time_point time)
+    {
+        float elapsed = std::chrono::duration<float>(time - state.time).count();
+        DetectionState advanced = state;
+        advanced.x_center += state.vx * elapsed;
+        advanced.y_center += state.vy * elapsed;
+        advanced.width = std::max(state.width + state.vwidth * elapsed, 0.0f);
+        advanced.height = std::max(state.height + state.vheight * elapsed, 0.0f);
+        advanced.time = time;
+        return advanced;
+    }
+
+    // The previous state of a detection, or nullptr for a new one
+    DetectionState *match(const DetectionState &state, std::vector<bool> &matched)
+    {
+        DetectionState *best = nullptr;
+        float best_iou = m_match_iou;
+        for (size_t i = 0; i < m_states.size(); i++)
+        {
+            DetectionState &previous = m_states[i];
+            if (matched[i])
+                continue;
+            if (state.detection.track_id >= 0 || previous.detection.track_id >= 0)
+            {
+                if (state.detection.track_id != previous.detection.track_id)
+                    continue;
+                matched[i] = true;
+                return &previous;
+            }
+            if (previous.detection.class_id != state.detection.class_id)
+                continue;
+            // Compared where the previous detection is expected by now, so fast objects still overlap
+            float overlap = iou(state, advance(previous, state.time));
+            if (overlap >= best_iou)
+            {
+                best_iou = overlap;
+                best = &previous;
+            }
+        }
+        if (best != nullptr)
+            matched[best - m_states.data()] = true;
+        return best;
+    }
+
+public:
+    /**
+     * @param smoothing Weight of the newest velocity measurement against the previous velocity (1 uses only the newest).
+     * @param match_iou Least IoU for an untracked detection to be considered the same object as a previous one.
+     */
+    DetectionExtrapolator(float smoothing=0.6f, float match_iou=0.3f) : m_smoothing(smoothing), m_match_iou(match_iou) {}
+
+    /**
+     * @brief Replace the state with the detections of a frame, updating the velocity of the ones seen before.
+     *
+     * @param time The presentation time of the frame the detections were made on.
+     */
+    void update(const std::vector<ExtrapolatedDetection> &detections, std::chrono::steady_clock::time_point time)
+    {
+        std::vector<DetectionState> states;
+        std::vector<bool> matched(m_states.size(), false);
+        states.reserve(detections.size());
+        for (const ExtrapolatedDetection &detection : detections)
+        {
+            DetectionState state;
+            state.detection = detection;
+            state.x_center = detection.xmin + detection.width / 2;
+            state.y_center = detection.ymin + detection.height / 2;
+            state.width = detection.width;
+            state.height = detection.height;
+            state.time = time;
+
+            DetectionState *previous = match(state, matched);
+            float elapsed = previous ? std::chrono::duration<float>(time - previous->time).count() : 0.0f;
+            if (elapsed > 0.0f)
+            {
+                float weight = m_smoothing;
+                float keep = 1.0f - m_smoothing;
+                state.vx = weight * (state.x_center - previous->x_center) / elapsed + keep * previous->vx;
+                state.vy = weight * (state.y_center - previous->y_center) / elapsed + keep * previous->vy;
+                state.vwidth = weight * (state.width - previous->width) / elapsed + keep * previous->vwidth;
+                state.vheight = weight * (state.height - previous->height) / elapsed + keep * previous->vheight;
+            }
+            states.push_back(state);
+        }
+        m_states = std::move(states);
+    }
+
+    /**
+     * @brief The detections of the last update, at where they are expected to be at the given time.
+     *        Detections that moved out of the frame are left out.
+     */
+    std::vector<ExtrapolatedDetection> predict(std::chrono::steady_clock::time_point time) const
+    {
+        std::vector<ExtrapolatedDetection> detections;
+        detections.reserve(m_states.size());
+        for (const DetectionState &state : m_states)
+        {
+            DetectionState advanced = advance(state, time);
+            float xmin = std::max(advanced.x_center - advanced.width / 2, 0.0f);
+            float ymin = std::max(advanced.y_center - advanced.height / 2, 0.0f);
+            float xmax = std::min(advanced.x_center + advanced.width / 2, 1.0f);
+            float ymax = std::min(advanced.y_center + advanced.height / 2, 1.0f);
+            if (xmax <= xmin || ymax <= ymin)
+                continue;
+
+            ExtrapolatedDetection detection = state.detection;
+            detection.xmin = xmin;
+            detection.ymin = ymin;
+            detection.width = xmax - xmin;
+            detection.height = ymax - ymin;
+            detections.push_back(detection);
+        }
+        return detections;
+    }
+
+    bool empty() const
+    {
+        return m_states.empty();
+    }
+
+    void clear()
+    {
+        m_states.clear();
+    }
+};
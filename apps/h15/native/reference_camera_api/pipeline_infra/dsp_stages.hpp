@@ -211,6 +211,7 @@ public:
         {
             HailoROIPtr roi = get_crop_roi(i);
             BufferPtr cropped_buffer_ptr = std::make_shared<Buffer>(cropped_buffers[i], roi);
+            cropped_buffer_ptr->set_pts(data->get_pts());
 
             // Set the ROI of the cropped buffer to the scale of the parent ROI
             // Note, this will make overlay incorrect if the bboxes are not flattened
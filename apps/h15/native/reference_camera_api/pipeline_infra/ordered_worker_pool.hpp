@@ -0,0 +1,175 @@
+#pragma once
+
+// General includes
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Runs work on a pool of threads and hands the items on in the order they were submitted.
+ *
+ * Every submitted item gets a sequence number. Items that finish out of order wait in a reorder
+ * buffer until all the items before them were handed on. The out of order window is bounded:
+ * submit() blocks while window items are between submission and output, so a slow item
+ * backpressures the caller instead of growing the reorder buffer.
+ * Output is called from the worker threads, never concurrently and always in sequence order.
+ */
+template <typename Item>
+class OrderedWorkerPool
+{
+public:
+    using WorkFunc = std::function<void(size_t worker_index, Item &item)>;
+    using OutputFunc = std::function<void(Item &item)>;
+
+private:
+    size_t m_window;
+    WorkFunc m_work;
+    OutputFunc m_output;
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;      // Workers wait for submitted items
+    std::condition_variable m_idle_cv;      // submit() and drain() wait for items to be handed on
+    std::deque<std::pair<uint64_t, Item>> m_pending; // Submitted and not picked up by a worker yet
+    std::map<uint64_t, Item> m_done;        // The reorder buffer, processed and waiting for their turn
+    uint64_t m_next_seq = 0;                // Sequence number of the next submitted item
+    uint64_t m_next_output = 0;             // Sequence number of the next item to hand on
+    uint64_t m_finished = 0;                // All items before this sequence number were processed
+    uint64_t m_reordered = 0;               // Items that finished before an item submitted earlier
+    bool m_outputting = false;
+    bool m_stop = false;
+    std::vector<std::thread> m_workers;
+
+    // Called with the lock held, the lock is released while output runs
+    void output_ready(std::unique_lock<std::mutex> &lock)
+    {
+        // A single worker hands items on, the others just leave theirs in the reorder buffer
+        if (m_outputting)
+            return;
+        m_outputting = true;
+        while (!m_stop && !m_done.empty() && m_done.begin()->first == m_next_output)
+        {
+            Item item = std::move(m_done.begin()->second);
+            m_done.erase(m_done.begin());
+            lock.unlock();
+            m_output(item);
+            lock.lock();
+            m_next_output++;
+            m_idle_cv.notify_all();
+        }
+        m_outputting = false;
+    }
+
+    void worker_loop(size_t worker_index)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_work_cv.wait(lock, [this]
+                           { return m_stop || !m_pending.empty(); });
+            if (m_stop)
+                return;
+            uint64_t seq = m_pending.front().first;
+            Item item = std::move(m_pending.front().second);
+            m_pending.pop_front();
+            lock.unlock();
+            m_work(worker_index, item);
+            lock.lock();
+            if (seq == m_finished)
+            {
+                // Items finished ahead of this one are still in the reorder buffer, they can't be handed on before it
+                for (m_finished++; m_done.count(m_finished); m_finished++)
+                    ;
+            }
+            else
+            {
+                m_reordered++;
+            }
+            m_done.emplace(seq, std::move(item));
+            output_ready(lock);
+        }
+    }
+
+public:
+    /**
+     * @param num_workers Number of worker threads, work has to be thread safe if above 1.
+     * @param window Most items between submission and output, 0 picks twice the number of workers.
+     * @param work Processes an item, on a worker thread.
+     * @param output Hands an item on, in submission order.
+     */
+    OrderedWorkerPool(size_t num_workers, size_t window, WorkFunc work, OutputFunc output)
+        : m_work(work), m_output(output)
+    {
+        num_workers = num_workers ? num_workers : 1;
+        // A window smaller than the number of workers would just leave workers idle
+        m_window = (window >= num_workers) ? window : 2 * num_workers;
+        for (size_t i = 0; i < num_workers; i++)
+            m_workers.emplace_back(&OrderedWorkerPool::worker_loop, this, i);
+    }
+
+    // Items that were not handed on yet are dropped
+    ~OrderedWorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            m_work_cv.notify_all();
+            m_idle_cv.notify_all();
+        }
+        for (std::thread &worker : m_workers)
+            worker.join();
+    }
+
+    OrderedWorkerPool(const OrderedWorkerPool &) = delete;
+    OrderedWorkerPool &operator=(const OrderedWorkerPool &) = delete;
+
+    /**
+     * @brief Queue an item for the workers.
+     *        Blocks while the out of order window is full.
+     *
+     * @return The sequence number of the item.
+     */
+    uint64_t submit(Item item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle_cv.wait(lock, [this]
+                       { return m_stop || m_next_seq - m_next_output < m_window; });
+        uint64_t seq = m_next_seq++;
+        if (m_stop)
+            return seq;
+        m_pending.emplace_back(seq, std::move(item));
+        m_work_cv.notify_one();
+        return seq;
+    }
+
+    /**
+     * @brief Wait until all submitted items were handed on.
+     */
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle_cv.wait(lock, [this]
+                       { return m_stop || (m_next_output == m_next_seq && !m_outputting); });
+    }
+
+    size_t get_num_workers() const
+    {
+        return m_workers.size();
+    }
+
+    size_t get_window() const
+    {
+        return m_window;
+    }
+
+    // Number of items that finished ahead of an item submitted before them, and waited in the reorder buffer
+    uint64_t get_reordered_count()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_reordered;
+    }
+};
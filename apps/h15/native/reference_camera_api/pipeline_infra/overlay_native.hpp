@@ -28,7 +28,7 @@ typedef enum
 
 } overlay_status_t;
 overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, std::shared_ptr<StageDebugCounters> debug_counters, float landmark_point_radius, bool show_confidence = true, bool local_gallery = false, uint mask_overlay_n_threads = 0, bool partial_landmarks = false, size_t min_landmark = 0, size_t max_landmark = 0);
-void face_blur(HailoMat &mat, HailoROIPtr roi);
+void face_blur(HailoMat &mat, HailoROIPtr roi, const AnonymizeParams &params = AnonymizeParams(), uint n_threads = 0);
 
 cv::Scalar indexToColor(size_t index);
 #include "tappas/plugins/common/overlay_utils.hpp"
@@ -478,7 +478,7 @@ overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, std::shared_ptr<Stage
     return ret;
 }
 
-void face_blur(HailoMat &hmat, HailoROIPtr roi)
+static void collect_faces(HailoMat &hmat, HailoROIPtr roi, std::vector<AnonymizeRegion> &regions)
 {
     for (auto detection : hailo_common::get_hailo_detections(roi))
     {
@@ -490,15 +490,22 @@ void face_blur(HailoMat &hmat, HailoROIPtr roi)
             auto ymin = std::clamp<int>(((detection_bbox.ymin() * roi_bbox.height()) + roi_bbox.ymin()) * hmat.native_height(), 0, hmat.native_height());
             auto xmax = std::clamp<int>(((detection_bbox.xmax() * roi_bbox.width()) + roi_bbox.xmin()) * hmat.native_width(), 0, hmat.native_width());
             auto ymax = std::clamp<int>(((detection_bbox.ymax() * roi_bbox.height()) + roi_bbox.ymin()) * hmat.native_height(), 0, hmat.native_height());
-            auto rect = cv::Rect(cv::Point(xmin, ymin), cv::Point(xmax, ymax));
-            hmat.blur(rect, cv::Size(13, 13));
+            regions.emplace_back(cv::Rect(cv::Point(xmin, ymin), cv::Point(xmax, ymax)));
 
             // Remove landmarks from the ROI before overlaying the blurred face
             roi->remove_objects_typed(HAILO_LANDMARKS);
         }
         else
         {
-            face_blur(hmat, detection);
+            collect_faces(hmat, detection, regions);
         }
     }
 }
+
+void face_blur(HailoMat &hmat, HailoROIPtr roi, const AnonymizeParams &params, uint n_threads)
+{
+    // All the faces of the frame are anonymized together, so separate faces run in parallel
+    std::vector<AnonymizeRegion> regions;
+    collect_faces(hmat, roi, regions);
+    hmat.anonymize(regions, params, n_threads);
+}
@@ -15,6 +15,7 @@ struct HailoOverlay
     int font_thickness;                 /**< Font thickness for overlay. */
     float landmark_point_radius;        /**< Radius for landmark points. */
     bool face_blur;                     /**< Enable or disable face blur. */
+    AnonymizeParams face_blur_params;   /**< Face blur mode (blur or pixelate) and kernel size. */
     bool show_confidence;               /**< Enable or disable confidence display. */
     bool local_gallery;                 /**< Enable or disable local gallery usage. */
     uint mask_overlay_n_threads;        /**< Number of threads for mask overlay. */
@@ -55,6 +56,7 @@ public:
         m_hailooverlay_info.line_thickness = 1;
         m_hailooverlay_info.font_thickness = 1;
         m_hailooverlay_info.face_blur = false;
+        m_hailooverlay_info.face_blur_params = AnonymizeParams();
         m_hailooverlay_info.show_confidence = true;
         m_hailooverlay_info.local_gallery = false;
         m_hailooverlay_info.landmark_point_radius = 3;
@@ -114,7 +116,7 @@ public:
             // Blur faces if face-blur is activated.
             if (m_hailooverlay_info.face_blur)
             {
-                face_blur(*hmat.get(), data->get_roi());
+                face_blur(*hmat.get(), data->get_roi(), m_hailooverlay_info.face_blur_params, m_hailooverlay_info.mask_overlay_n_threads);
             }
             // Draw all results of the given roi on mat.
             overlay_status_t ret = draw_all(*hmat.get(), data->get_roi(), m_debug_counters,m_hailooverlay_info.landmark_point_radius, m_hailooverlay_info.show_confidence, m_hailooverlay_info.local_gallery, m_hailooverlay_info.mask_overlay_n_threads,
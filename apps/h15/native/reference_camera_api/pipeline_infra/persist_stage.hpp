@@ -1,23 +1,65 @@
 #pragma once
 
+// General includes
+#include <chrono>
+#include <vector>
+
 // Infra includes
 #include "stage.hpp"
 #include "buffer.hpp"
 #include "queue.hpp"
+#include "detection_extrapolator.hpp"
 
 // Tappas includes
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 
+/* PersistMode: what is added to a frame without detections
+Replay - the last detections, as they were.
+Extrapolate - new detections with the box, class, confidence and track id of the last ones, moved to the PTS of the frame at the velocity they were last seen moving.
+*/
+enum class PersistMode
+{
+    REPLAY = 0,
+    EXTRAPOLATE
+};
+
 class PersistStage : public ConnectedStage
 {
 private:
     std::vector<HailoDetectionPtr> m_detections;
+    DetectionExtrapolator m_extrapolator;
+    PersistMode m_mode;
     size_t m_expiration_threshold;
     size_t m_count = 0;
+
+    static ExtrapolatedDetection to_extrapolated(HailoDetectionPtr detection)
+    {
+        HailoBBox bbox = detection->get_bbox();
+        std::vector<HailoUniqueIDPtr> ids = hailo_common::get_hailo_track_id(detection);
+        return {bbox.xmin(), bbox.ymin(), bbox.width(), bbox.height(),
+                detection->get_class_id(), detection->get_label(), detection->get_confidence(),
+                ids.empty() ? -1 : ids[0]->get_id()};
+    }
+
+    // New detections, nothing is shared with the frames the extrapolator saw
+    static std::vector<HailoDetectionPtr> from_extrapolated(const std::vector<ExtrapolatedDetection> &extrapolated)
+    {
+        std::vector<HailoDetectionPtr> detections;
+        detections.reserve(extrapolated.size());
+        for (const ExtrapolatedDetection &e : extrapolated)
+        {
+            HailoDetectionPtr detection = std::make_shared<HailoDetection>(HailoBBox(e.xmin, e.ymin, e.width, e.height), e.class_id, e.label, e.confidence);
+            if (e.track_id >= 0)
+                detection->add_object(std::make_shared<HailoUniqueID>(e.track_id, TRACKING_ID));
+            detections.push_back(detection);
+        }
+        return detections;
+    }
+
 public:
-    PersistStage(std::string name, size_t expiration=5, size_t queue_size=5, bool leaky=false, bool print_fps=false) : 
-        ConnectedStage(name, queue_size, leaky, print_fps), m_expiration_threshold(expiration) {}
+    PersistStage(std::string name, size_t expiration=5, size_t queue_size=5, bool leaky=false, bool print_fps=false, PersistMode mode=PersistMode::REPLAY) : 
+        ConnectedStage(name, queue_size, leaky, print_fps), m_mode(mode), m_expiration_threshold(expiration) {}
 
     AppStatus process(BufferPtr data)
     {
@@ -25,7 +67,29 @@ public:
         HailoROIPtr hailo_roi = data->get_roi();
 
         std::vector<HailoDetectionPtr> incoming_detections = hailo_common::get_hailo_detections(hailo_roi);
-        if (incoming_detections.size() > 0)
+        if (m_mode == PersistMode::EXTRAPOLATE)
+        {
+            if (incoming_detections.size() > 0)
+            {
+                std::vector<ExtrapolatedDetection> extrapolated;
+                extrapolated.reserve(incoming_detections.size());
+                for (HailoDetectionPtr detection : incoming_detections)
+                    extrapolated.push_back(to_extrapolated(detection));
+                m_extrapolator.update(extrapolated, data->get_pts());
+                m_count = 0;
+            }
+            else if (!m_extrapolator.empty())
+            {
+                hailo_common::add_detection_pointers(hailo_roi, from_extrapolated(m_extrapolator.predict(data->get_pts())));
+                ++m_count;
+                if (m_count >= m_expiration_threshold)
+                {
+                    m_extrapolator.clear();
+                    m_count = 0;
+                }
+            }
+        }
+        else if (incoming_detections.size() > 0)
         {
             m_detections = incoming_detections;
         }
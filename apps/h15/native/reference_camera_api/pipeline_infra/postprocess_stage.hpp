@@ -23,17 +23,23 @@
 #include "buffer.hpp"
 #include "queue.hpp"
 #include "stage.hpp"
+#include "ordered_worker_pool.hpp"
 
 // Defines
 #define DEFAULT_FUNC_NAME "filter"
 #define INIT_FUNC_NAME "init"
 #define FREE_FUNC_NAME "free_resources"
+#define THREAD_SAFE_FUNC_NAME "postprocess_thread_safe"
 
 /**
  * @brief Class representing a post-processing stage in the connected stage pipeline.
  * 
  * This class is responsible for loading a shared object library, initializing it, and
  * applying post-processing functions to the data.
+ *
+ * With more than one worker, buffers are post-processed concurrently and sent to the subscribers
+ * in the order they arrived. Each worker gets its own params from the init function, unless the
+ * library exports a postprocess_thread_safe function that returns true, then the workers share them.
  */
 class PostprocessStage : public ConnectedStage
 {
@@ -43,15 +49,57 @@ private:
     std::string m_config_path;      ///< Path to the configuration file.
     std::string m_function_name;    ///< Name of the function to be executed from the shared object file.
 
+    // Workers
+    size_t m_num_workers;           ///< Number of threads running the post-processing function.
+    size_t m_reorder_window;        ///< Most buffers between input and output when running with several workers.
+    std::unique_ptr<OrderedWorkerPool<BufferPtr>> m_workers; ///< Set when running with several workers.
+
     // Loaded libraries and params
-    void *m_loaded_lib;             ///< Handle to the loaded shared object library.
-    void *m_params;                 ///< Parameters for the post-processing function.
+    void *m_loaded_lib = nullptr;   ///< Handle to the loaded shared object library.
+    std::vector<void *> m_params;   ///< Parameters for the post-processing function, one per worker unless shared.
 
     // Function handlers
-    void (*m_handler)(HailoROIPtr, void *);             ///< Function pointer to the post-processing function with parameters.
-    void (*m_handler_no_config)(HailoROIPtr);           ///< Function pointer to the post-processing function without parameters.
+    void (*m_handler)(HailoROIPtr, void *) = nullptr;   ///< Function pointer to the post-processing function with parameters.
+    void (*m_handler_no_config)(HailoROIPtr) = nullptr; ///< Function pointer to the post-processing function without parameters.
     std::chrono::steady_clock::time_point m_last_time;  ///< Timestamp of the last processed frame.
 
+    /**
+     * @brief Call the handler on the roi of the buffer, with the params of the given worker (if any).
+     */
+    void run_handler(size_t worker_index, BufferPtr data)
+    {
+        HailoROIPtr hailo_roi = data->get_roi();
+        if (!m_params.empty())
+        {
+            m_handler(hailo_roi, m_params[worker_index % m_params.size()]);
+        }
+        else
+        {
+            m_handler_no_config(hailo_roi);
+        }
+    }
+
+    /**
+     * @brief Stamp a post-processed buffer and push it to the next stages.
+     */
+    void send_processed(BufferPtr data)
+    {
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        if (m_print_fps)
+        {
+            std::cout << "Postprocess time (" << m_stage_name << ") = " << std::chrono::duration_cast<std::chrono::microseconds>(end - m_last_time).count() << "[microseconds]" << std::endl;
+            m_last_time = end;
+        }
+
+        data->add_time_stamp(m_stage_name);
+        set_duration(data);
+
+        // Push the buffer to the next stage
+        send_to_subscribers(data);
+        m_debug_counters->increment_output_frames();
+    }
+
 public:
     /**
      * @brief Construct a new Postprocess Stage object.
@@ -63,9 +111,13 @@ public:
      * @param queue_size Size of the processing queue.
      * @param leaky Whether the queue is leaky.
      * @param print_fps Whether to print frames per second information.
+     * @param num_workers Number of threads running the post-processing function.
+     * @param reorder_window Most buffers between input and output with several workers, 0 for twice the number of workers.
      */
-    PostprocessStage(std::string name, std::string so_path, std::string function_name=DEFAULT_FUNC_NAME, std::string config_path="", size_t queue_size=5, bool leaky=false, bool print_fps=false) : 
-        ConnectedStage(name, queue_size, leaky, print_fps), m_so_path(so_path), m_config_path(config_path), m_function_name(function_name) {}
+    PostprocessStage(std::string name, std::string so_path, std::string function_name=DEFAULT_FUNC_NAME, std::string config_path="", size_t queue_size=5, bool leaky=false, bool print_fps=false,
+                     size_t num_workers=1, size_t reorder_window=0) : 
+        ConnectedStage(name, queue_size, leaky, print_fps), m_so_path(so_path), m_config_path(config_path), m_function_name(function_name),
+        m_num_workers(num_workers ? num_workers : 1), m_reorder_window(reorder_window) {}
 
     /**
      * @brief Initialize the post-processing stage. by loading the provided so file with dlsym. 
@@ -93,12 +145,19 @@ public:
         {
             // Set the library function handler with the requested function name
             m_handler_no_config = (void (*)(HailoROIPtr))dlsym(m_loaded_lib, m_function_name.c_str());
-            m_params = nullptr;
+            m_params.clear();
         }
         else 
         {
-            // Call the init function to get the params
-            m_params = init_func(m_config_path, m_function_name);
+            // Call the init function to get the params, once per worker unless the library can share them
+            auto thread_safe_func = (bool (*)())dlsym(m_loaded_lib, THREAD_SAFE_FUNC_NAME);
+            dlerror(); // The thread safe function is optional
+            size_t num_params = (thread_safe_func != nullptr && thread_safe_func()) ? 1 : m_num_workers;
+            m_params.clear();
+            for (size_t i = 0; i < num_params; i++)
+            {
+                m_params.push_back(init_func(m_config_path, m_function_name));
+            }
             // Set the library function handler with the requested function name
             m_handler = (void (*)(HailoROIPtr, void *))dlsym(m_loaded_lib, m_function_name.c_str());
         }
@@ -110,11 +169,22 @@ public:
             std::cerr << "Cannot load symbol: " << dlsym_error << std::endl;
             REFERENCE_CAMERA_LOG_ERROR("Cannot load symbol: ", dlsym_error);
             dlclose(m_loaded_lib);
+            m_loaded_lib = nullptr;
             return AppStatus::CONFIGURATION_ERROR;
         }
 
         m_last_time = std::chrono::steady_clock::now();
 
+        if (m_num_workers > 1)
+        {
+            m_workers = std::make_unique<OrderedWorkerPool<BufferPtr>>(
+                m_num_workers, m_reorder_window,
+                [this](size_t worker_index, BufferPtr &data)
+                { run_handler(worker_index, data); },
+                [this](BufferPtr &data)
+                { send_processed(data); });
+        }
+
         return AppStatus::SUCCESS;
     }
 
@@ -125,17 +195,25 @@ public:
      */
     AppStatus deinit() override
     {
+        // Stop the workers before their params are freed
+        m_workers.reset();
+
         // Call the free function if there is any
-        if (m_params != nullptr)
+        if (!m_params.empty())
         {
             auto delete_func = (void (*)(void *))dlsym(m_loaded_lib, FREE_FUNC_NAME);
-            if (delete_func != nullptr)
-                delete_func(m_params);
+            for (void *params : m_params)
+            {
+                if (delete_func != nullptr && params != nullptr)
+                    delete_func(params);
+            }
+            m_params.clear();
         }
         // close the loaded library
         if (m_loaded_lib != nullptr)
         {
             dlclose(m_loaded_lib);
+            m_loaded_lib = nullptr;
         }
         for (auto &queue : m_queues)
         {
@@ -146,41 +224,26 @@ public:
     }
 
     /**
-     * @brief Process the data in the buffer using the loaded library
+     * @brief Process the data in the buffer using the loaded library.
+     * With several workers the buffer is handed to them, and sent on once the buffers before it were.
      * 
      * @param data Buffer containing the data to be processed.
      * @return AppStatus Status of the processing.
      */
     AppStatus process(BufferPtr data)
     {    
-        // Get the roi from the buffer
-        HailoROIPtr hailo_roi = data->get_roi();
         m_debug_counters->increment_input_frames();
 
-        // Call the handler with the roi and the params (if any)
-        if (m_params != nullptr)
-        {
-            m_handler(hailo_roi, m_params);
-        }
-        else
-        {
-            m_handler_no_config(hailo_roi);
-        }
-
-        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-
-        if (m_print_fps)
+        if (m_workers)
         {
-            std::cout << "Postprocess time (" << m_stage_name << ") = " << std::chrono::duration_cast<std::chrono::microseconds>(end - m_last_time).count() << "[microseconds]" << std::endl;
-            m_last_time = end;
+            // Blocks while the reorder window is full
+            m_workers->submit(data);
+            return AppStatus::SUCCESS;
         }
-        
-	    data->add_time_stamp(m_stage_name);
-        set_duration(data);
 
-	    // Push the buffer to the next stage
-        send_to_subscribers(data);
-        m_debug_counters->increment_output_frames();
+        // Call the handler with the roi and the params (if any)
+        run_handler(0, data);
+        send_processed(data);
         return AppStatus::SUCCESS;
     }
 };
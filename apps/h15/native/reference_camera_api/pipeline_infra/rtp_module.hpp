@@ -0,0 +1,357 @@
+#pragma once
+
+// General includes
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <tl/expected.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Infra includes
+#include "buffer.hpp"
+#include "stage.hpp"
+#include "rtp_packetizer.hpp"
+
+// Defines
+#define RTP_CLOCK_RATE 90000
+#define RTP_MAX_GSO_SEGMENTS 64
+#define RTP_MAX_GSO_BYTES 61440
+#define RTP_SEND_ERROR_LOG_INTERVAL_MS 1000
+
+class RtpModule;
+using RtpModulePtr = std::shared_ptr<RtpModule>;
+
+/**
+ * @brief Sends encoded frames as RTP over UDP, without a GStreamer pipeline.
+ *
+ * The packets of a frame are sent with a single sendmmsg call. Where the kernel supports UDP GSO,
+ * runs of equally sized packets (the fragments of a large NAL unit) are passed as one message
+ * that the kernel (or the NIC) segments.
+ * Has the interface of UdpModule, frames are sent from the thread that adds them.
+ */
+class RtpModule
+{
+private:
+    std::string m_name;
+    std::string m_host;
+    std::string m_port;
+    EncodingType m_type;
+    RtpPacketizer m_packetizer;
+
+    int m_socket = -1;
+    bool m_gso = false;
+    bool m_running = false;
+
+    // RTP timestamps are the capture times of the frames, relative to the first one
+    bool m_first_frame = true;
+    std::chrono::steady_clock::time_point m_first_pts;
+    uint32_t m_first_timestamp;
+
+    // Reused between frames
+    std::vector<struct mmsghdr> m_messages;
+    std::vector<size_t> m_message_first_packet;
+    std::vector<struct iovec> m_iovecs;
+    std::vector<uint8_t> m_controls;
+
+    // Statistics
+    uint64_t m_frames_sent = 0;
+    uint64_t m_packets_sent = 0;
+    uint64_t m_bytes_sent = 0;
+    uint64_t m_send_failures = 0;
+
+    // While sending keeps failing with the same error it is logged once per interval. Without a receiver
+    // ECONNREFUSED fails every other send (the ICMP error is reported on the next one), so sending only
+    // counts as recovered after an interval without failures.
+    int m_send_errno = 0;
+    uint64_t m_unlogged_failures = 0;
+    std::chrono::steady_clock::time_point m_last_error_log;
+    std::chrono::steady_clock::time_point m_last_failure;
+
+    static uint32_t random_u32()
+    {
+        static std::mt19937 generator(std::random_device{}());
+        return generator();
+    }
+
+    // Group the packets from the given one into messages, a run of equally sized packets (the last may be shorter) per GSO message
+    void build_messages(const std::vector<RtpPacket> &packets, size_t first_packet)
+    {
+        size_t count = packets.size() - first_packet;
+        m_messages.clear();
+        m_message_first_packet.clear();
+        m_iovecs.resize(2 * count);
+#ifdef UDP_SEGMENT
+        m_controls.assign(count * CMSG_SPACE(sizeof(uint16_t)), 0);
+#endif
+
+        size_t iovec_index = 0;
+        size_t index = first_packet;
+        while (index < packets.size())
+        {
+            size_t segment_size = packets[index].size();
+            size_t end = index + 1;
+            if (m_gso)
+            {
+                size_t bytes = segment_size;
+                while (end < packets.size() && end - index < RTP_MAX_GSO_SEGMENTS && bytes + packets[end].size() <= RTP_MAX_GSO_BYTES &&
+                       packets[end].size() <= segment_size)
+                {
+                    bytes += packets[end].size();
+                    end++;
+                    if (packets[end - 1].size() < segment_size)
+                        break; // Only the last segment can be shorter
+                }
+            }
+
+            struct mmsghdr message = {};
+            message.msg_hdr.msg_iov = &m_iovecs[iovec_index];
+            for (size_t i = index; i < end; i++)
+            {
+                const RtpPacket &packet = packets[i];
+                m_iovecs[iovec_index++] = {const_cast<uint8_t *>(m_packetizer.get_header(packet)), packet.header_size};
+                if (packet.payload_size > 0)
+                    m_iovecs[iovec_index++] = {const_cast<uint8_t *>(packet.payload), packet.payload_size};
+            }
+            message.msg_hdr.msg_iovlen = &m_iovecs[iovec_index] - message.msg_hdr.msg_iov;
+#ifdef UDP_SEGMENT
+            if (end - index > 1)
+            {
+                uint8_t *control = m_controls.data() + m_messages.size() * CMSG_SPACE(sizeof(uint16_t));
+                message.msg_hdr.msg_control = control;
+                message.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message.msg_hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t gso_size = segment_size;
+                memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+            }
+#endif
+            m_messages.push_back(message);
+            m_message_first_packet.push_back(index);
+            index = end;
+        }
+    }
+
+    void log_send_error(int error)
+    {
+        m_send_failures++;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        m_last_failure = now;
+        if (error == m_send_errno && now - m_last_error_log < std::chrono::milliseconds(RTP_SEND_ERROR_LOG_INTERVAL_MS))
+        {
+            m_unlogged_failures++;
+            return;
+        }
+        if (error == m_send_errno)
+            REFERENCE_CAMERA_LOG_ERROR("Udp {} failed to send: {} ({} more frames failed)", m_name, strerror(error), m_unlogged_failures);
+        else
+            REFERENCE_CAMERA_LOG_ERROR("Udp {} failed to send: {}", m_name, strerror(error));
+        m_send_errno = error;
+        m_unlogged_failures = 0;
+        m_last_error_log = now;
+    }
+
+    AppStatus send_packets(const std::vector<RtpPacket> &packets)
+    {
+        build_messages(packets, 0);
+        size_t sent = 0;
+        while (sent < m_messages.size())
+        {
+            int ret = sendmmsg(m_socket, &m_messages[sent], m_messages.size() - sent, 0);
+            if (ret > 0)
+            {
+                sent += ret;
+                continue;
+            }
+            if (errno == EINTR)
+                continue;
+            if (m_gso && (errno == EIO || errno == EINVAL || errno == EOPNOTSUPP))
+            {
+                // The device can't segment (e.g. no checksum offload), send the rest packet by packet
+                REFERENCE_CAMERA_LOG_WARN("Udp {} UDP GSO rejected, sending without it", m_name);
+                m_gso = false;
+                build_messages(packets, m_message_first_packet[sent]);
+                sent = 0;
+                continue;
+            }
+            // An unreachable receiver (ECONNREFUSED) only drops this frame
+            log_send_error(errno);
+            return AppStatus::PIPELINE_ERROR;
+        }
+        if (m_send_errno != 0 && std::chrono::steady_clock::now() - m_last_failure >= std::chrono::milliseconds(RTP_SEND_ERROR_LOG_INTERVAL_MS))
+        {
+            REFERENCE_CAMERA_LOG_INFO("Udp {} sending again, {} more frames failed after the last error message", m_name, m_unlogged_failures);
+            m_send_errno = 0;
+            m_unlogged_failures = 0;
+        }
+        return AppStatus::SUCCESS;
+    }
+
+public:
+    static tl::expected<RtpModulePtr, AppStatus> create(std::string name, std::string host, std::string port, EncodingType type, size_t mtu=RTP_DEFAULT_MTU)
+    {
+        AppStatus status = AppStatus::UNINITIALIZED;
+        RtpModulePtr rtp_module = std::make_shared<RtpModule>(name, host, port, type, mtu, status);
+        if (status != AppStatus::SUCCESS)
+        {
+            return tl::make_unexpected(status);
+        }
+        return rtp_module;
+    }
+
+    RtpModule(std::string name, std::string host, std::string port, EncodingType type, size_t mtu, AppStatus &status)
+        : m_name(name), m_host(host), m_port(port), m_type(type),
+          m_packetizer(type, mtu, random_u32(), random_u32() & 0xFFFF), m_first_timestamp(random_u32())
+    {
+        struct addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo *addresses = nullptr;
+        int ret = getaddrinfo(m_host.c_str(), m_port.c_str(), &hints, &addresses);
+        if (ret != 0)
+        {
+            std::cerr << "Failed to resolve UDP destination " << m_host << ":" << m_port << std::endl;
+            REFERENCE_CAMERA_LOG_ERROR("Failed to resolve UDP destination {}:{}: {}", m_host, m_port, gai_strerror(ret));
+            status = AppStatus::CONFIGURATION_ERROR;
+            return;
+        }
+        for (struct addrinfo *address = addresses; address != nullptr; address = address->ai_next)
+        {
+            m_socket = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+            if (m_socket < 0)
+                continue;
+            if (connect(m_socket, address->ai_addr, address->ai_addrlen) == 0)
+                break;
+            close(m_socket);
+            m_socket = -1;
+        }
+        freeaddrinfo(addresses);
+        if (m_socket < 0)
+        {
+            std::cerr << "Failed to open UDP socket to " << m_host << ":" << m_port << std::endl;
+            REFERENCE_CAMERA_LOG_ERROR("Failed to open UDP socket to {}:{}", m_host, m_port);
+            status = AppStatus::CONFIGURATION_ERROR;
+            return;
+        }
+
+        // A whole frame is handed to the kernel at once
+        int send_buffer_size = 4 * 1024 * 1024;
+        setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, &send_buffer_size, sizeof(send_buffer_size));
+#ifdef UDP_SEGMENT
+        // Supported if the kernel accepts the option, a size of 0 leaves segmentation off until a message asks for it
+        int gso_size = 0;
+        m_gso = (setsockopt(m_socket, SOL_UDP, UDP_SEGMENT, &gso_size, sizeof(gso_size)) == 0);
+#endif
+
+        status = AppStatus::SUCCESS;
+    }
+
+    ~RtpModule()
+    {
+        if (m_socket >= 0)
+        {
+            close(m_socket);
+        }
+    }
+
+    RtpModule(const RtpModule &) = delete;
+    RtpModule &operator=(const RtpModule &) = delete;
+
+    AppStatus start()
+    {
+        m_running = true;
+        return AppStatus::SUCCESS;
+    }
+
+    AppStatus stop()
+    {
+        m_running = false;
+        return AppStatus::SUCCESS;
+    }
+
+    /**
+     * @brief Send an encoded frame, stamped with the time it was added.
+     */
+    AppStatus add_buffer(HailoMediaLibraryBufferPtr ptr, size_t size)
+    {
+        return add_buffer(ptr, size, std::chrono::steady_clock::now());
+    }
+
+    /**
+     * @brief Send an encoded frame.
+     *
+     * @param pts The capture time of the frame, the RTP timestamp follows it.
+     */
+    AppStatus add_buffer(HailoMediaLibraryBufferPtr ptr, size_t size, std::chrono::steady_clock::time_point pts)
+    {
+        return send_access_unit(static_cast<const uint8_t *>(ptr->get_plane_ptr(0)), size, pts);
+    }
+
+    /**
+     * @brief Packetize and send an Annex B access unit.
+     */
+    AppStatus send_access_unit(const uint8_t *data, size_t size, std::chrono::steady_clock::time_point pts)
+    {
+        if (!m_running)
+        {
+            REFERENCE_CAMERA_LOG_ERROR("Udp {} got a buffer before start()", m_name);
+            return AppStatus::UNINITIALIZED;
+        }
+        if (m_first_frame)
+        {
+            m_first_pts = pts;
+            m_first_frame = false;
+        }
+        int64_t ticks = std::chrono::duration_cast<std::chrono::microseconds>(pts - m_first_pts).count() * RTP_CLOCK_RATE / 1000000;
+        uint32_t timestamp = m_first_timestamp + static_cast<uint32_t>(ticks);
+
+        const std::vector<RtpPacket> &packets = m_packetizer.packetize(data, size, timestamp);
+        AppStatus status = send_packets(packets);
+        if (status != AppStatus::SUCCESS)
+            return status;
+
+        m_frames_sent++;
+        m_packets_sent += packets.size();
+        for (const RtpPacket &packet : packets)
+            m_bytes_sent += packet.size();
+        return AppStatus::SUCCESS;
+    }
+
+    bool is_gso_enabled() const
+    {
+        return m_gso;
+    }
+
+    uint64_t get_frames_sent() const
+    {
+        return m_frames_sent;
+    }
+
+    uint64_t get_packets_sent() const
+    {
+        return m_packets_sent;
+    }
+
+    uint64_t get_bytes_sent() const
+    {
+        return m_bytes_sent;
+    }
+
+    // Frames that were dropped because sending them failed
+    uint64_t get_send_failures() const
+    {
+        return m_send_failures;
+    }
+};
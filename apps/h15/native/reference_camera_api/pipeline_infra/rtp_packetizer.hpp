@@ -0,0 +1,314 @@
+#pragma once
+
+// General includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Defines
+#define RTP_HEADER_SIZE 12
+#define RTP_DEFAULT_MTU 1400
+#define RTP_PAYLOAD_TYPE 96
+
+enum class EncodingType
+{
+    H264 = 0,
+    H265,
+};
+
+/**
+ * @brief One RTP packet of an access unit.
+ * The RTP header (and the FU / aggregation bytes after it) are kept by the packetizer,
+ * the payload points into the access unit, so it is never copied.
+ */
+struct RtpPacket
+{
+    size_t header_offset;   ///< Offset of the header in the header arena of the packetizer.
+    size_t header_size;     ///< Size of the header, aggregation packets hold their whole payload here.
+    const uint8_t *payload; ///< Part of the access unit sent after the header.
+    size_t payload_size;    ///< Size of the part of the access unit.
+
+    size_t size() const
+    {
+        return header_size + payload_size;
+    }
+};
+
+/**
+ * @brief Splits H.264 / H.265 Annex B access units into RTP packets (RFC 6184 / RFC 7798).
+ *
+ * NAL units that fit in a packet are sent as they are, larger ones are fragmented (FU-A / FU).
+ * Consecutive parameter sets are aggregated into a single packet (STAP-A / AP), and access unit
+ * delimiters are dropped. The marker bit is set on the last packet of each access unit.
+ */
+class RtpPacketizer
+{
+private:
+    struct NalUnit
+    {
+        const uint8_t *data;
+        size_t size;
+    };
+
+    EncodingType m_type;
+    size_t m_mtu;
+    uint8_t m_payload_type;
+    uint32_t m_ssrc;
+    uint16_t m_sequence;
+    uint32_t m_timestamp = 0;
+
+    // Reused between access units
+    std::vector<uint8_t> m_headers;
+    std::vector<RtpPacket> m_packets;
+    std::vector<NalUnit> m_nal_units;
+    std::vector<NalUnit> m_parameter_sets;
+    std::vector<uint8_t> m_aggregate;
+
+    size_t nal_header_size() const
+    {
+        return (m_type == EncodingType::H264) ? 1 : 2;
+    }
+
+    int nal_type(const NalUnit &nal) const
+    {
+        return (m_type == EncodingType::H264) ? (nal.data[0] & 0x1F) : ((nal.data[0] >> 1) & 0x3F);
+    }
+
+    bool is_delimiter(const NalUnit &nal) const
+    {
+        return nal_type(nal) == ((m_type == EncodingType::H264) ? 9 : 35);
+    }
+
+    bool is_parameter_set(const NalUnit &nal) const
+    {
+        int type = nal_type(nal);
+        if (m_type == EncodingType::H264)
+            return type == 7 || type == 8; // SPS, PPS
+        return type >= 32 && type <= 34;  // VPS, SPS, PPS
+    }
+
+    // Appends an RTP header and the given extra header bytes to the arena, and a packet using them
+    RtpPacket &add_packet(const uint8_t *extra, size_t extra_size, const uint8_t *payload, size_t payload_size)
+    {
+        size_t offset = m_headers.size();
+        m_headers.resize(offset + RTP_HEADER_SIZE + extra_size);
+        uint8_t *header = m_headers.data() + offset;
+        header[0] = 0x80; // Version 2, no padding, no extension, no CSRC
+        header[1] = m_payload_type;
+        header[2] = m_sequence >> 8;
+        header[3] = m_sequence & 0xFF;
+        header[4] = m_timestamp >> 24;
+        header[5] = (m_timestamp >> 16) & 0xFF;
+        header[6] = (m_timestamp >> 8) & 0xFF;
+        header[7] = m_timestamp & 0xFF;
+        header[8] = m_ssrc >> 24;
+        header[9] = (m_ssrc >> 16) & 0xFF;
+        header[10] = (m_ssrc >> 8) & 0xFF;
+        header[11] = m_ssrc & 0xFF;
+        if (extra_size > 0)
+            memcpy(header + RTP_HEADER_SIZE, extra, extra_size);
+        m_sequence++;
+        m_packets.push_back(RtpPacket{offset, RTP_HEADER_SIZE + extra_size, payload, payload_size});
+        return m_packets.back();
+    }
+
+    void add_nal_unit(const NalUnit &nal)
+    {
+        size_t max_payload = m_mtu - RTP_HEADER_SIZE;
+        if (nal.size <= max_payload)
+        {
+            add_packet(nullptr, 0, nal.data, nal.size);
+            return;
+        }
+
+        // Fragment, the NAL header is replaced by the FU indicator / payload header and the FU header
+        uint8_t fu[3];
+        size_t fu_size;
+        if (m_type == EncodingType::H264)
+        {
+            fu[0] = (nal.data[0] & 0xE0) | 28; // F and NRI of the NAL, FU-A
+            fu[1] = nal.data[0] & 0x1F;
+            fu_size = 2;
+        }
+        else
+        {
+            fu[0] = (nal.data[0] & 0x81) | (49 << 1); // F and LayerId bit of the NAL, FU
+            fu[1] = nal.data[1];
+            fu[2] = (nal.data[0] >> 1) & 0x3F;
+            fu_size = 3;
+        }
+        uint8_t &fu_header = fu[fu_size - 1];
+        uint8_t fu_type = fu_header;
+        size_t chunk_size = max_payload - fu_size;
+        const uint8_t *data = nal.data + nal_header_size();
+        size_t remaining = nal.size - nal_header_size();
+        bool first = true;
+        while (remaining > 0)
+        {
+            size_t size = std::min(remaining, chunk_size);
+            fu_header = fu_type;
+            if (first)
+                fu_header |= 0x80;
+            if (size == remaining)
+                fu_header |= 0x40;
+            add_packet(fu, fu_size, data, size);
+            data += size;
+            remaining -= size;
+            first = false;
+        }
+    }
+
+    void add_parameter_sets()
+    {
+        size_t max_payload = m_mtu - RTP_HEADER_SIZE;
+        size_t aggregation_header_size = nal_header_size();
+        size_t first = 0;
+        while (first < m_parameter_sets.size())
+        {
+            // As many of the following parameter sets as fit in one packet
+            size_t last = first;
+            size_t size = aggregation_header_size + 2 + m_parameter_sets[first].size;
+            while (last + 1 < m_parameter_sets.size() && size + 2 + m_parameter_sets[last + 1].size <= max_payload)
+            {
+                last++;
+                size += 2 + m_parameter_sets[last].size;
+            }
+            if (last == first)
+            {
+                add_nal_unit(m_parameter_sets[first]);
+                first++;
+                continue;
+            }
+
+            m_aggregate.clear();
+            if (m_type == EncodingType::H264)
+            {
+                uint8_t forbidden = 0, nri = 0;
+                for (size_t i = first; i <= last; i++)
+                {
+                    forbidden |= m_parameter_sets[i].data[0] & 0x80;
+                    nri = std::max<uint8_t>(nri, m_parameter_sets[i].data[0] & 0x60);
+                }
+                m_aggregate.push_back(forbidden | nri | 24); // STAP-A
+            }
+            else
+            {
+                uint8_t layer_id = 0x3F, tid = 0x07;
+                for (size_t i = first; i <= last; i++)
+                {
+                    const uint8_t *header = m_parameter_sets[i].data;
+                    layer_id = std::min<uint8_t>(layer_id, ((header[0] & 0x01) << 5) | (header[1] >> 3));
+                    tid = std::min<uint8_t>(tid, header[1] & 0x07);
+                }
+                m_aggregate.push_back((48 << 1) | (layer_id >> 5)); // AP
+                m_aggregate.push_back(((layer_id & 0x1F) << 3) | tid);
+            }
+            for (size_t i = first; i <= last; i++)
+            {
+                const NalUnit &nal = m_parameter_sets[i];
+                m_aggregate.push_back(nal.size >> 8);
+                m_aggregate.push_back(nal.size & 0xFF);
+                m_aggregate.insert(m_aggregate.end(), nal.data, nal.data + nal.size);
+            }
+            add_packet(m_aggregate.data(), m_aggregate.size(), nullptr, 0);
+            first = last + 1;
+        }
+        m_parameter_sets.clear();
+    }
+
+    // Finds the NAL units of an Annex B byte stream, without their start codes
+    void split_nal_units(const uint8_t *data, size_t size)
+    {
+        m_nal_units.clear();
+        size_t start = size;
+        size_t i = 0;
+        while (i + 3 <= size)
+        {
+            // A start code can't begin in the next 3 bytes when the third of them is above 1
+            if (data[i + 2] > 1)
+            {
+                i += 3;
+            }
+            else if (data[i + 2] == 1 && data[i + 1] == 0 && data[i] == 0)
+            {
+                if (start < size)
+                {
+                    size_t end = i;
+                    while (end > start && data[end - 1] == 0)
+                        end--; // The leading zero of a 4 byte start code, or trailing zeros
+                    m_nal_units.push_back(NalUnit{data + start, end - start});
+                }
+                i += 3;
+                start = i;
+            }
+            else
+            {
+                i++;
+            }
+        }
+        if (start < size)
+        {
+            m_nal_units.push_back(NalUnit{data + start, size - start});
+        }
+        else if (m_nal_units.empty() && size > 0)
+        {
+            // No start code, a single NAL unit
+            m_nal_units.push_back(NalUnit{data, size});
+        }
+    }
+
+public:
+    /**
+     * @param type The encoding of the access units.
+     * @param mtu Largest RTP packet, header included.
+     * @param ssrc Synchronization source of the stream.
+     * @param first_sequence Sequence number of the first packet.
+     * @param payload_type Dynamic RTP payload type.
+     */
+    RtpPacketizer(EncodingType type, size_t mtu, uint32_t ssrc, uint16_t first_sequence, uint8_t payload_type=RTP_PAYLOAD_TYPE)
+        : m_type(type), m_mtu(std::max<size_t>(mtu, RTP_HEADER_SIZE + 16)), m_payload_type(payload_type & 0x7F),
+          m_ssrc(ssrc), m_sequence(first_sequence) {}
+
+    /**
+     * @brief Packetize an Annex B access unit.
+     *        The packets point into data, and are valid until the next call.
+     *
+     * @param timestamp RTP timestamp of the access unit.
+     */
+    const std::vector<RtpPacket> &packetize(const uint8_t *data, size_t size, uint32_t timestamp)
+    {
+        m_timestamp = timestamp;
+        m_headers.clear();
+        m_packets.clear();
+
+        split_nal_units(data, size);
+        for (const NalUnit &nal : m_nal_units)
+        {
+            if (nal.size <= nal_header_size() || is_delimiter(nal))
+                continue;
+            if (is_parameter_set(nal))
+            {
+                m_parameter_sets.push_back(nal);
+                continue;
+            }
+            add_parameter_sets();
+            add_nal_unit(nal);
+        }
+        add_parameter_sets();
+
+        if (!m_packets.empty())
+            m_headers[m_packets.back().header_offset + 1] |= 0x80; // Marker, last packet of the access unit
+        return m_packets;
+    }
+
+    const uint8_t *get_header(const RtpPacket &packet) const
+    {
+        return m_headers.data() + packet.header_offset;
+    }
+
+    uint32_t get_ssrc() const
+    {
+        return m_ssrc;
+    }
+};
@@ -182,4 +182,26 @@ protected:
     size_t enum_size() const override {
         return static_cast<size_t>(AggregatorExtraCounters::AGGREGATOR_EXTRA_COUNTERS_SIZE);
     }
-};
\ No newline at end of file
+};
+
+enum class UdpExtraCounters
+{
+    SEND_FAILURES = 0,
+    UDP_EXTRA_COUNTERS_SIZE  /* should be last */
+};
+class UdpCounters : public StageDebugCounters {
+public:
+    UdpCounters(const std::string& stage_name) : StageDebugCounters(stage_name) {
+        extra_counters = new int[enum_size()]();
+    }
+
+    void write_additional_counter(std::ofstream& file) const override {
+        if (file.is_open()) {
+            file << "send failures: " << extra_counters[static_cast<int>(UdpExtraCounters::SEND_FAILURES)];
+        }
+    }
+protected:
+    size_t enum_size() const override {
+        return static_cast<size_t>(UdpExtraCounters::UDP_EXTRA_COUNTERS_SIZE);
+    }
+};
@@ -43,16 +43,17 @@ public:
         std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
         HailoROIPtr hailo_roi = data->get_roi();
 
+        // Take the detections to track out of the roi in a single pass
         std::vector<HailoDetectionPtr> detections;
-        for (auto obj : hailo_roi->get_objects_typed(HAILO_DETECTION))
-        {
-            HailoDetectionPtr detection = std::dynamic_pointer_cast<HailoDetection>(obj);
-            if ((m_class_id == -1) || (detection->get_class_id() == m_class_id))
-            {
-                detections.push_back(detection);
-                hailo_roi->remove_object(detection);
-            }
-        }
+        hailo_roi->remove_objects_if([this, &detections](const HailoObjectPtr &obj)
+                                     {
+                                         if (obj->get_type() != HAILO_DETECTION)
+                                             return false;
+                                         HailoDetectionPtr detection = std::dynamic_pointer_cast<HailoDetection>(obj);
+                                         if ((m_class_id != -1) && (detection->get_class_id() != m_class_id))
+                                             return false;
+                                         detections.push_back(detection);
+                                         return true; });
 
         // Swap the detections in the roi with just the online tracked detections
         std::vector<HailoDetectionPtr> online_detection_ptrs = HailoTracker::GetInstance().update(m_tracker_name, detections);
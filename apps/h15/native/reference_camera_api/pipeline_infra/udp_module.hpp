@@ -24,16 +24,11 @@
 #include "buffer.hpp"
 #include "queue.hpp"
 #include "stage.hpp"
+#include "rtp_module.hpp"
 
 // Defines
 #define SRC_QUEUE_NAME "appsrc_q"
 
-enum class EncodingType
-{
-    H264 = 0,
-    H265,
-};
-
 class UdpModule;
 using UdpModulePtr = std::shared_ptr<UdpModule>;
 
@@ -12,7 +12,7 @@
 // Infra includes
 #include "stage.hpp"
 #include "buffer.hpp"
-#include "udp_module.hpp"
+#include "rtp_module.hpp"
 
 class UdpStage : public ConnectedStage
 {
@@ -20,7 +20,7 @@ private:
     std::string m_host;
     std::string m_port;
     EncodingType m_type;
-    UdpModulePtr m_udp;
+    RtpModulePtr m_udp;
     
 public:
     UdpStage(std::string name, size_t queue_size=1, bool leaky=false, bool print_fps=false) : 
@@ -32,7 +32,7 @@ public:
     {
         if (m_udp == nullptr)
         {
-            tl::expected<UdpModulePtr, AppStatus> udp_expected = UdpModule::create(m_stage_name, host, port, type);
+            tl::expected<RtpModulePtr, AppStatus> udp_expected = RtpModule::create(m_stage_name, host, port, type);
             if (!udp_expected.has_value())
             {
                 std::cout << "Failed to create udp" << std::endl;
@@ -54,6 +54,7 @@ public:
             REFERENCE_CAMERA_LOG_ERROR("Udp  {} not configured. Call configure()", m_stage_name);
             return AppStatus::UNINITIALIZED;
         }
+        m_debug_counters = std::make_shared<UdpCounters>(m_stage_name);
         m_udp->start();
         return AppStatus::SUCCESS;
     }
@@ -93,7 +94,17 @@ public:
         }
         SizeMetadataPtr size_metadata = std::dynamic_pointer_cast<SizeMetadata>(metadata[0]);
         size_t size = size_metadata->get_size();
-        m_udp->add_buffer(data->get_buffer(), size);
+        m_debug_counters->increment_input_frames();
+        // RTP timestamps follow the capture time of the frame
+        AppStatus status = m_udp->add_buffer(data->get_buffer(), size, data->get_pts());
+        if (status != AppStatus::SUCCESS)
+        {
+            // The frame is dropped, the next one is sent again
+            m_debug_counters->increment_dropped_frames();
+            m_debug_counters->increment_extra_counter(static_cast<int>(UdpExtraCounters::SEND_FAILURES));
+            return status;
+        }
+        m_debug_counters->increment_output_frames();
 
         return AppStatus::SUCCESS;
     }
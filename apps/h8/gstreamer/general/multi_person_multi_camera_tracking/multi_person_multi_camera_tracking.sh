@@ -31,6 +31,7 @@ function init_variables() {
     vdevice_key=1
     json_config_path=$DEFAULT_JSON_CONFIG_PATH
     dewarp_element=""
+    roi_dewarp_element=""
     source_prefix="reid"
 }
 
@@ -43,6 +44,7 @@ function print_usage() {
     echo "  --num-of-sources NUM            Setting number of sources to given input (default value is 4)"
     echo "  --print-gst-launch              Print the ready gst-launch command without running it"
     echo "  --online-dewarp                 Perform online dewarping"
+    echo "  --online-dewarp-rois            Perform online dewarping of the detected persons only"
     echo "  --tcp-address              Used for TAPPAS GUI, switchs the sink to TCP client"
     exit 0
 }
@@ -75,6 +77,10 @@ function parse_args() {
             dewarp_element="queue name=pre_dewarp_q leaky=no max-size-buffers=30 max-size-bytes=0 max-size-time=0 ! \
                              hailofilter so_path=$RE_ID_DEWARP_SO use-gst-buffer=true qos=false ! "
             source_prefix="reid_orig"
+        elif [ "$1" = "--online-dewarp-rois" ]; then
+            roi_dewarp_element="queue name=pre_roi_dewarp_q leaky=no max-size-buffers=30 max-size-bytes=0 max-size-time=0 ! \
+                                 hailofilter so_path=$RE_ID_DEWARP_SO function-name=filter_rois use-gst-buffer=true qos=false ! "
+            source_prefix="reid_orig"
         elif [ "$1" = "--tcp-address" ]; then
             tcp_host=$(echo $2 | awk -F':' '{print $1}')
             tcp_port=$(echo $2 | awk -F':' '{print $2}')
@@ -139,6 +145,7 @@ function main() {
         videoconvert n-threads=1 qos=false ! video/x-raw,format=RGB ! \
         $dewarp_element \
         $DETECTION_PIPELINE ! \
+        $roi_dewarp_element \
         queue name=hailo_pre_tracker leaky=no max-size-buffers=30 max-size-bytes=0 max-size-time=0 ! \
         hailotracker name=hailo_tracker hailo-objects-blacklist=hailo_landmarks,hailo_depth_mask,hailo_class_mask,hailo_matrix \
         class-id=1 kalman-dist-thr=0.7 iou-thr=0.7 init-iou-thr=0.8 keep-new-frames=2 keep-tracked-frames=4 \
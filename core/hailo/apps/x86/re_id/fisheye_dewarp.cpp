@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include <algorithm>
+#include <cmath>
+#include "fisheye_dewarp.hpp"
+
+// Open source includes
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+
+// Points sampled along every edge of a rectangle when mapping it to the dewarped frame
+#define RECT_EDGE_SAMPLES (8)
+
+bool FisheyeCameraModel::operator==(const FisheyeCameraModel &other) const
+{
+    return fx == other.fx && fy == other.fy && cx == other.cx && cy == other.cy &&
+           k1 == other.k1 && k2 == other.k2 && k3 == other.k3 && k4 == other.k4 &&
+           calibration_size == other.calibration_size;
+}
+
+cv::Mat FisheyeCameraModel::camera_matrix() const
+{
+    return (cv::Mat_<float>(3, 3) << fx, 0.0f, cx,
+                                     0.0f, fy, cy,
+                                     0.0f, 0.0f, 1.0f);
+}
+
+cv::Mat FisheyeCameraModel::distortion() const
+{
+    return (cv::Mat_<float>(4, 1) << k1, k2, k3, k4);
+}
+
+FisheyeCameraModel FisheyeCameraModel::scaled(cv::Size size) const
+{
+    float scale_x = float(size.width) / calibration_size.width;
+    float scale_y = float(size.height) / calibration_size.height;
+    return {fx * scale_x, fy * scale_y, cx * scale_x, cy * scale_y, k1, k2, k3, k4, size};
+}
+
+DewarpMapPtr DewarpMapCache::get(const std::string &stream_id, cv::Size size, const FisheyeCameraModel &model)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_entries.find(stream_id);
+    if (entry != m_entries.end() && entry->second.size == size && entry->second.model == model)
+        return entry->second.map;
+
+    // Frames that are still being remapped with the old table keep it alive
+    DewarpMapPtr map = create_dewarp_map(size, model);
+    m_entries[stream_id] = {size, model, map};
+    return map;
+}
+
+size_t DewarpMapCache::size()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+DewarpMapPtr create_dewarp_map(cv::Size size, const FisheyeCameraModel &model)
+{
+    auto map = std::make_shared<DewarpMap>();
+    cv::Mat camera_matrix = model.scaled(size).camera_matrix();
+    cv::fisheye::initUndistortRectifyMap(camera_matrix, model.distortion(), cv::Mat(), camera_matrix,
+                                         size, CV_16SC2, map->map1, map->map2);
+    return map;
+}
+
+void dewarp_frame(const cv::Mat &src, cv::Mat &dst, const DewarpMap &map)
+{
+    cv::remap(src, dst, map.map1, map.map2, cv::INTER_LINEAR);
+}
+
+void dewarp_rects(const cv::Mat &src, const DewarpMap &map, const std::vector<cv::Rect> &rects, std::vector<cv::Mat> &outputs)
+{
+    outputs.resize(rects.size());
+    cv::parallel_for_(cv::Range(0, int(rects.size())), [&](const cv::Range &range)
+                      {
+                          for (int i = range.start; i < range.end; i++)
+                          {
+                              // The tables hold absolute source coordinates, so a view of them remaps just the rectangle
+                              cv::Rect rect = rects[i] & cv::Rect(0, 0, map.map1.cols, map.map1.rows);
+                              if (rect.empty())
+                              {
+                                  outputs[i].release();
+                                  continue;
+                              }
+                              cv::remap(src, outputs[i], map.map1(rect), map.map2(rect), cv::INTER_LINEAR);
+                          } });
+}
+
+void dewarp_rects_in_place(cv::Mat &frame, const DewarpMap &map, const std::vector<cv::Rect> &rects)
+{
+    std::vector<cv::Mat> outputs;
+    dewarp_rects(frame, map, rects, outputs);
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        if (!outputs[i].empty())
+            outputs[i].copyTo(frame(rects[i] & cv::Rect(0, 0, frame.cols, frame.rows)));
+    }
+}
+
+cv::Rect dewarped_rect(const cv::Rect &rect, cv::Size size, const FisheyeCameraModel &model)
+{
+    std::vector<cv::Point2f> distorted;
+    for (int i = 0; i <= RECT_EDGE_SAMPLES; i++)
+    {
+        float x = rect.x + rect.width * float(i) / RECT_EDGE_SAMPLES;
+        float y = rect.y + rect.height * float(i) / RECT_EDGE_SAMPLES;
+        distorted.emplace_back(x, rect.y);
+        distorted.emplace_back(x, rect.y + rect.height);
+        distorted.emplace_back(rect.x, y);
+        distorted.emplace_back(rect.x + rect.width, y);
+    }
+    std::vector<cv::Point2f> undistorted;
+    cv::Mat camera_matrix = model.scaled(size).camera_matrix();
+    cv::fisheye::undistortPoints(distorted, undistorted, camera_matrix, model.distortion(), cv::noArray(), camera_matrix);
+
+    float xmin = size.width, ymin = size.height, xmax = 0.0f, ymax = 0.0f;
+    for (const cv::Point2f &point : undistorted)
+    {
+        xmin = std::min(xmin, point.x);
+        ymin = std::min(ymin, point.y);
+        xmax = std::max(xmax, point.x);
+        ymax = std::max(ymax, point.y);
+    }
+    cv::Rect covering(cv::Point(std::floor(xmin), std::floor(ymin)), cv::Point(std::ceil(xmax), std::ceil(ymax)));
+    return covering & cv::Rect(0, 0, size.width, size.height);
+}
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file fisheye_dewarp.hpp
+ * @brief Fisheye dewarp of whole frames or of rectangles of them, with the remap tables cached per stream.
+ *
+ * The tables are OpenCV's fixed-point format (CV_16SC2 source coordinates + CV_16UC1 interpolation
+ * table indices), built once per (stream, resolution, camera model). Remapping a rectangle reads the same
+ * table entries the whole-frame remap does, so its pixels are identical to the same rectangle of a
+ * dewarped frame while the work is proportional to the rectangle's area.
+ */
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Fisheye camera intrinsics (in pixels of a calibration_size frame) and distortion coefficients.
+ */
+struct FisheyeCameraModel
+{
+    float fx;
+    float fy;
+    float cx;
+    float cy;
+    float k1;
+    float k2;
+    float k3;
+    float k4;
+    cv::Size calibration_size; // The frame size the intrinsics were calibrated at
+
+    bool operator==(const FisheyeCameraModel &other) const;
+    cv::Mat camera_matrix() const;
+    cv::Mat distortion() const;
+
+    /**
+     * @brief The same camera for frames of another size: the intrinsics are scaled by size / calibration_size.
+     *        The distortion coefficients act on angles, so they don't change.
+     */
+    FisheyeCameraModel scaled(cv::Size size) const;
+};
+
+struct DewarpMap
+{
+    cv::Mat map1; // CV_16SC2, source pixel of every dewarped pixel
+    cv::Mat map2; // CV_16UC1, interpolation table index of every dewarped pixel
+};
+using DewarpMapPtr = std::shared_ptr<const DewarpMap>;
+
+/**
+ * @brief The remap tables of every stream. A stream keeps one table, it is rebuilt when the stream's
+ *        resolution or camera model change.
+ */
+class DewarpMapCache
+{
+private:
+    struct Entry
+    {
+        cv::Size size;
+        FisheyeCameraModel model;
+        DewarpMapPtr map;
+    };
+    std::map<std::string, Entry> m_entries;
+    std::mutex m_mutex;
+
+public:
+    DewarpMapPtr get(const std::string &stream_id, cv::Size size, const FisheyeCameraModel &model);
+    size_t size();
+};
+
+/**
+ * @brief Build the remap tables of a frame size, taking the camera matrix (scaled to the frame) as the new camera matrix.
+ */
+DewarpMapPtr create_dewarp_map(cv::Size size, const FisheyeCameraModel &model);
+
+/**
+ * @brief Dewarp a whole frame into dst.
+ */
+void dewarp_frame(const cv::Mat &src, cv::Mat &dst, const DewarpMap &map);
+
+/**
+ * @brief Dewarp only the given rectangles (in pixels of the dewarped frame) of src, in parallel.
+ *        outputs[i] is set to rectangle i of the dewarped frame.
+ */
+void dewarp_rects(const cv::Mat &src, const DewarpMap &map, const std::vector<cv::Rect> &rects, std::vector<cv::Mat> &outputs);
+
+/**
+ * @brief Dewarp the given rectangles of a frame in place, the rest of the frame is left as is.
+ *        All rectangles are read from the original frame, so they may overlap.
+ */
+void dewarp_rects_in_place(cv::Mat &frame, const DewarpMap &map, const std::vector<cv::Rect> &rects);
+
+/**
+ * @brief The rectangle of the dewarped frame that covers a rectangle of the fisheye frame, clipped to the frame.
+ *        size is the size of the frame, the model is scaled to it.
+ */
+cv::Rect dewarped_rect(const cv::Rect &rect, cv::Size size, const FisheyeCameraModel &model);
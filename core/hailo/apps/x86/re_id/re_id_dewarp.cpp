@@ -11,67 +11,86 @@
 #include <math.h>
 
 // Hailo includes
-#include "re_id_overlay.hpp"
+#include "re_id_dewarp.hpp"
+#include "fisheye_dewarp.hpp"
 #include "hailo_common.hpp"
 
 // Open source includes
 #include <opencv2/opencv.hpp>
-#include <opencv2/imgcodecs.hpp>
-#include <opencv2/calib3d.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/core.hpp>
 
-cv::Mat fisheye_map1;
-cv::Mat fisheye_map2;
-bool fisheye_map_created = false;
+// Static fisheye configuration for the specific videos/cameras we use.
+static const FisheyeCameraModel fisheye_model = {
+    1328.3905382843832f, // fx
+    1356.204081943469f,  // fy
+    1006.5378470232891f, // cx
+    649.6687619615067f,  // cy
+    -0.04559713237248377f,
+    -0.2200614611319084f,
+    0.47521443770963995f,
+    -0.38690394174238846f,
+    cv::Size(2012, 1300)}; // calibration_size, the principal point is about its centre
+
+// Remap tables of every stream, built on the first frame of a stream and whenever its resolution changes.
+static DewarpMapCache dewarp_maps;
+
+static cv::Mat frame_to_mat(GstVideoFrame *frame)
+{
+    return cv::Mat(GST_VIDEO_FRAME_HEIGHT(frame),
+                   GST_VIDEO_FRAME_WIDTH(frame),
+                   CV_8UC3,
+                   GST_VIDEO_FRAME_PLANE_DATA(frame, 0),
+                   GST_VIDEO_FRAME_PLANE_STRIDE(frame, 0));
+}
+
+static std::string stream_key(gchar *current_stream_id)
+{
+    return current_stream_id ? current_stream_id : "";
+}
 
 void filter(HailoROIPtr roi, GstVideoFrame *frame, gchar *current_stream_id)
 {
     cv::Mat remap_mat;
-    cv::Mat image_mat(GST_VIDEO_FRAME_HEIGHT(frame),
-                GST_VIDEO_FRAME_WIDTH(frame),
-                CV_8UC3,
-                GST_VIDEO_FRAME_PLANE_DATA(frame, 0),
-                GST_VIDEO_FRAME_PLANE_STRIDE(frame, 0));
-    if (!fisheye_map_created)
-    {
-        // Static Matrices that represent the fisheye configuration for the specifix videos/cameras we use.
-
-        // Camera Matrix
-        cv::Mat cam(3, 3, cv::DataType<float>::type);
-        cam.at<float>(0, 0) = 1328.3905382843832f;
-        cam.at<float>(0, 1) = 0.0f;
-        cam.at<float>(0, 2) = 1006.5378470232891f;
+    cv::Mat image_mat = frame_to_mat(frame);
+    DewarpMapPtr map = dewarp_maps.get(stream_key(current_stream_id), image_mat.size(), fisheye_model);
 
-        cam.at<float>(1, 0) = 0.0f;
-        cam.at<float>(1, 1) = 1356.204081943469f;
-        cam.at<float>(1, 2) = 649.6687619615067f;
+    // Remap the whole frame and copy the dewarped image to the buffer image.
+    dewarp_frame(image_mat, remap_mat, *map);
+    remap_mat.copyTo(image_mat);
+    remap_mat.release();
+    image_mat.release();
+}
 
-        cam.at<float>(2, 0) = 0.0f;
-        cam.at<float>(2, 1) = 0.0f;
-        cam.at<float>(2, 2) = 1.0f;
+void filter_rois(HailoROIPtr roi, GstVideoFrame *frame, gchar *current_stream_id)
+{
+    cv::Mat image_mat = frame_to_mat(frame);
+    cv::Size size = image_mat.size();
+    DewarpMapPtr map = dewarp_maps.get(stream_key(current_stream_id), size, fisheye_model);
 
-        // Distance Coeffitients matrix
-        cv::Mat dist(4, 1, cv::DataType<float>::type);
-        dist.at<float>(0, 0) = -0.04559713237248377f;
-        dist.at<float>(1, 0) = -0.2200614611319084f;
-        dist.at<float>(2, 0) = 0.47521443770963995f;
-        dist.at<float>(3, 0) = -0.38690394174238846f;
+    HailoBBox roi_bbox = hailo_common::create_flattened_bbox(roi->get_bbox(), roi->get_scaling_bbox());
+    std::vector<cv::Rect> rects;
+    for (HailoDetectionPtr detection : hailo_common::get_hailo_detections(roi))
+    {
+        // The detection in pixels of the fisheye frame
+        HailoBBox bbox = detection->get_bbox();
+        cv::Point top_left(((bbox.xmin() * roi_bbox.width()) + roi_bbox.xmin()) * size.width,
+                           ((bbox.ymin() * roi_bbox.height()) + roi_bbox.ymin()) * size.height);
+        cv::Point bottom_right(((bbox.xmax() * roi_bbox.width()) + roi_bbox.xmin()) * size.width,
+                               ((bbox.ymax() * roi_bbox.height()) + roi_bbox.ymin()) * size.height);
+        cv::Rect rect = dewarped_rect(cv::Rect(top_left, bottom_right), size, fisheye_model);
+        if (rect.empty())
+            continue;
 
-        // Create Fisheye dewarp map.
-        cv::fisheye::initUndistortRectifyMap(cam, dist, cv::Mat(), cam,
-                                             cv::Size(GST_VIDEO_FRAME_WIDTH(frame),
-                                                      GST_VIDEO_FRAME_HEIGHT(frame)),
-                                             CV_16SC2, fisheye_map1, fisheye_map2);
-        // Mark boolean true in order to do this calculation only once.
-        fisheye_map_created = true;
+        // Move the detection to where the person is in the dewarped frame
+        float xmin = (float(rect.x) / size.width - roi_bbox.xmin()) / roi_bbox.width();
+        float ymin = (float(rect.y) / size.height - roi_bbox.ymin()) / roi_bbox.height();
+        float width = float(rect.width) / size.width / roi_bbox.width();
+        float height = float(rect.height) / size.height / roi_bbox.height();
+        detection->set_bbox(HailoBBox(xmin, ymin, width, height));
+        rects.push_back(rect);
     }
 
-    // Remap using 2 fisheye dewarp maps.
-    cv::remap(image_mat, remap_mat, fisheye_map1, fisheye_map2, cv::INTER_LINEAR);
-
-    // Copy the dewarped image to the buffer image.
-    memcpy(image_mat.data, remap_mat.data, sizeof(uint8_t) * remap_mat.rows * remap_mat.cols * 3);
-    remap_mat.release();
+    dewarp_rects_in_place(image_mat, *map, rects);
     image_mat.release();
-}
\ No newline at end of file
+}
@@ -7,5 +7,8 @@
 #include "hailo_objects.hpp"
 
 G_BEGIN_DECLS
+// Dewarp the whole frame
 void filter(HailoROIPtr roi, GstVideoFrame *frame, gchar *current_stream_id);
-G_END_DECLS
\ No newline at end of file
+// Dewarp only the detections of the frame, moving them to their place in the dewarped frame
+void filter_rois(HailoROIPtr roi, GstVideoFrame *frame, gchar *current_stream_id);
+G_END_DECLS
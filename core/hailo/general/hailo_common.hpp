@@ -8,6 +8,7 @@
 
 #pragma once
 #include "hailo_objects.hpp"
+#include <unordered_set>
 // #include <stdlib.h>
 // #include <string>
 // #include <cstring>
@@ -73,18 +74,16 @@ namespace hailo_common
 
     inline void remove_objects(HailoROIPtr roi, std::vector<HailoObjectPtr> objects)
     {
-        for (HailoObjectPtr obj : objects)
-        {
-            roi->remove_object(obj);
-        }
+        if (objects.empty())
+            return;
+        std::unordered_set<HailoObjectPtr> to_remove(objects.begin(), objects.end());
+        roi->remove_objects_if([&to_remove](const HailoObjectPtr &obj)
+                               { return to_remove.count(obj) > 0; });
     }
 
     inline void remove_detections(HailoROIPtr roi, std::vector<HailoDetectionPtr> objects)
     {
-        for (HailoObjectPtr obj : objects)
-        {
-            roi->remove_object(obj);
-        }
+        remove_objects(roi, std::vector<HailoObjectPtr>(objects.begin(), objects.end()));
     }
 
     inline bool has_classifications(HailoROIPtr roi, std::string classification_type)
@@ -116,10 +115,8 @@ namespace hailo_common
 
     inline std::vector<HailoDetectionPtr> get_hailo_detections(HailoROIPtr roi)
     {
-        std::vector<HailoObjectPtr> objects = roi->get_objects_typed(HAILO_DETECTION);
         std::vector<HailoDetectionPtr> detections;
-
-        for (auto obj : objects)
+        for (const HailoObjectPtr &obj : roi->get_objects_view(HAILO_DETECTION))
         {
             detections.emplace_back(std::dynamic_pointer_cast<HailoDetection>(obj));
         }
@@ -166,6 +163,23 @@ namespace hailo_common
         return unique_ids;
     }
 
+    /**
+     * @brief The number of unique ids of the roi (of any mode), and the id of the first of them.
+     *        Unlike get_hailo_unique_id it doesn't copy any object, for code that runs on every crop.
+     *
+     * @param first_id Set to the id of the first unique id, untouched if there are none.
+     */
+    inline size_t get_hailo_unique_id_count(HailoROIPtr roi, int &first_id)
+    {
+        size_t count = 0;
+        for (const HailoObjectPtr &obj : roi->get_objects_view(HAILO_UNIQUE_ID))
+        {
+            if (count++ == 0)
+                first_id = static_cast<HailoUniqueID *>(obj.get())->get_id();
+        }
+        return count;
+    }
+
     inline std::vector<HailoUniqueIDPtr> get_hailo_unique_id_by_mode(HailoROIPtr roi, hailo_unique_id_mode_t mode)
     {
         std::vector<HailoObjectPtr> objects = roi->get_objects_typed(HAILO_UNIQUE_ID);
@@ -247,19 +261,15 @@ namespace hailo_common
      */
     inline void flatten_hailo_roi(HailoROIPtr roi, HailoROIPtr parent_roi, hailo_object_t filter_type)
     {
-        std::vector<HailoObjectPtr> objects = roi->get_objects();
-        for (uint index = 0; index < objects.size(); index++)
+        std::vector<HailoObjectPtr> objects = roi->extract_objects_if([filter_type](const HailoObjectPtr &obj)
+                                                                      { return obj->get_type() == filter_type; });
+        HailoBBox roi_bbox = roi->get_bbox();
+        for (const HailoObjectPtr &obj : objects)
         {
-            if (objects[index]->get_type() == filter_type)
-            {
-                HailoROIPtr sub_obj_roi = std::dynamic_pointer_cast<HailoROI>(objects[index]);
-                sub_obj_roi->set_bbox(std::move(create_flattened_bbox(sub_obj_roi->get_bbox(), roi->get_bbox())));
-                parent_roi->add_object(sub_obj_roi);
-                roi->remove_object(index);
-                objects.erase(objects.begin() + index);
-                index--;
-            }
+            HailoROIPtr sub_obj_roi = std::dynamic_pointer_cast<HailoROI>(obj);
+            sub_obj_roi->set_bbox(std::move(create_flattened_bbox(sub_obj_roi->get_bbox(), roi_bbox)));
         }
+        parent_roi->add_objects(objects);
     }
 
     /**
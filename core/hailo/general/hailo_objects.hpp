@@ -186,6 +186,59 @@ public:
 
 using HailoObjectPtr = std::shared_ptr<HailoObject>;
 
+/**
+ * @brief A view of the sub objects of a given type of a main object, iterated without copying the object list.
+ * Holds the lock of the main object while it lives, so objects can't be added or removed meanwhile,
+ * calling a function of the main object that takes its lock from the loop deadlocks.
+ */
+class HailoObjectsView
+{
+public:
+    class iterator
+    {
+    private:
+        std::vector<HailoObjectPtr>::const_iterator m_current;
+        std::vector<HailoObjectPtr>::const_iterator m_end;
+        hailo_object_t m_type;
+
+        void skip_other_types()
+        {
+            while (m_current != m_end && (*m_current)->get_type() != m_type)
+                ++m_current;
+        }
+
+    public:
+        iterator(std::vector<HailoObjectPtr>::const_iterator current, std::vector<HailoObjectPtr>::const_iterator end, hailo_object_t type)
+            : m_current(current), m_end(end), m_type(type)
+        {
+            skip_other_types();
+        }
+
+        const HailoObjectPtr &operator*() const { return *m_current; }
+        const HailoObjectPtr *operator->() const { return &(*m_current); }
+        iterator &operator++()
+        {
+            ++m_current;
+            skip_other_types();
+            return *this;
+        }
+        bool operator==(const iterator &other) const { return m_current == other.m_current; }
+        bool operator!=(const iterator &other) const { return m_current != other.m_current; }
+    };
+
+    HailoObjectsView(std::shared_ptr<std::mutex> mutex, const std::vector<HailoObjectPtr> &objects, hailo_object_t type)
+        : m_mutex(mutex), m_lock(*m_mutex), m_objects(objects), m_type(type){};
+
+    iterator begin() const { return iterator(m_objects.begin(), m_objects.end(), m_type); }
+    iterator end() const { return iterator(m_objects.end(), m_objects.end(), m_type); }
+
+private:
+    std::shared_ptr<std::mutex> m_mutex; // Kept alive for the lock
+    std::unique_lock<std::mutex> m_lock;
+    const std::vector<HailoObjectPtr> &m_objects;
+    hailo_object_t m_type;
+};
+
 /**
  * @brief Represents a HailoObject that can hold other objects.
  *  for example a face detection can hold landmarks or age classification, gender classification etc...
@@ -218,6 +271,17 @@ public:
         m_sub_objects.emplace_back(obj);
     };
 
+    /**
+     * @brief Add objects to the main object, taking the lock once.
+     *
+     * @param objects Objects to add.
+     */
+    void add_objects(const std::vector<HailoObjectPtr> &objects)
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        m_sub_objects.insert(m_sub_objects.end(), objects.begin(), objects.end());
+    };
+
     /**
      * @brief Add a tensor to the main object.
      *
@@ -253,13 +317,58 @@ public:
         m_sub_objects.erase(m_sub_objects.begin() + index);
     };
 
+    /**
+     * @brief Remove the objects that match a predicate, in a single pass under the lock.
+     *        The remaining objects keep their order.
+     *
+     * @param predicate Called once per object with the lock held, so it must not call functions of this main object.
+     * @return size_t - The number of removed objects.
+     */
+    template <typename Predicate>
+    size_t remove_objects_if(Predicate predicate)
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        auto removed = std::remove_if(m_sub_objects.begin(), m_sub_objects.end(), predicate);
+        size_t count = m_sub_objects.end() - removed;
+        m_sub_objects.erase(removed, m_sub_objects.end());
+        return count;
+    }
+
+    /**
+     * @brief Remove the objects that match a predicate and return them, in a single pass under the lock.
+     *        Both the remaining and the returned objects keep their order.
+     *
+     * @param predicate Called once per object with the lock held, so it must not call functions of this main object.
+     * @return std::vector<HailoObjectPtr> - The removed objects.
+     */
+    template <typename Predicate>
+    std::vector<HailoObjectPtr> extract_objects_if(Predicate predicate)
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        auto removed = std::stable_partition(m_sub_objects.begin(), m_sub_objects.end(),
+                                             [&predicate](const HailoObjectPtr &obj)
+                                             { return !predicate(obj); });
+        std::vector<HailoObjectPtr> extracted(std::make_move_iterator(removed), std::make_move_iterator(m_sub_objects.end()));
+        m_sub_objects.erase(removed, m_sub_objects.end());
+        return extracted;
+    }
+
+    /**
+     * @brief Remove the detections whose label is not one of the given labels.
+     *        Objects that are not detections are kept.
+     *
+     * @param labels The labels to keep.
+     * @return size_t - The number of removed detections.
+     */
+    size_t retain_labels(const std::vector<std::string> &labels);
+
     /**
      * @brief Get a tensor from this main object.
      *
      * @param name Tensor's name to get,
      * @return HailoTensorPtr - A tensor.
      */
-    HailoTensorPtr get_tensor(std::string name)
+    HailoTensorPtr get_tensor(const std::string &name)
     {
         std::lock_guard<std::mutex> lock(*mutex);
         auto itr = m_tensors.find(name);
@@ -350,6 +459,18 @@ public:
         return filtered_subobjects;
     }
 
+    /**
+     * @brief Get a view of the objects of a given type, attached to this main object.
+     *        The view holds the lock of this main object until it goes out of scope.
+     *
+     * @param type The type of object to iterate.
+     * @return HailoObjectsView
+     */
+    HailoObjectsView get_objects_view(hailo_object_t type)
+    {
+        return HailoObjectsView(mutex, m_sub_objects, type);
+    }
+
     /**
      * @brief Removes all the objects of a given type, attached to this main object.
      *
@@ -357,10 +478,8 @@ public:
      */
     void remove_objects_typed(hailo_object_t type)
     {
-        for (auto obj : this->get_objects_typed(type))
-        {
-            this->remove_object(obj);
-        }
+        remove_objects_if([type](const HailoObjectPtr &obj)
+                          { return obj->get_type() == type; });
     }
 };
 using HailoMainObjectPtr = std::shared_ptr<HailoMainObject>;
@@ -408,6 +527,27 @@ public:
         HailoMainObject::add_object(obj);
     };
 
+    /**
+     * @brief Add objects to the main object, taking the lock once.
+     *
+     * @param objects Objects to add.
+     */
+    void add_objects(const std::vector<HailoObjectPtr> &objects)
+    {
+        HailoBBox bbox = this->get_bbox();
+        std::string stream_id = this->get_stream_id();
+        for (const HailoObjectPtr &obj : objects)
+        {
+            std::shared_ptr<HailoROI> possible_roi = std::dynamic_pointer_cast<HailoROI>(obj);
+            if (nullptr != possible_roi)
+            {
+                possible_roi->set_scaling_bbox(bbox);
+                possible_roi->set_stream_id(stream_id);
+            }
+        }
+        HailoMainObject::add_objects(objects);
+    };
+
     /**
      * @brief Add an object to the main object.
      *        Ignore possible scaling of rois
@@ -690,6 +830,16 @@ public:
 };
 using HailoDetectionPtr = std::shared_ptr<HailoDetection>;
 
+inline size_t HailoMainObject::retain_labels(const std::vector<std::string> &labels)
+{
+    return remove_objects_if([&labels](const HailoObjectPtr &obj)
+                             {
+                                 if (obj->get_type() != HAILO_DETECTION)
+                                     return false;
+                                 std::string label = std::dynamic_pointer_cast<HailoDetection>(obj)->get_label();
+                                 return std::find(labels.begin(), labels.end(), label) == labels.end(); });
+}
+
 /**
  * @brief Represents a Classification of an ROI.
  *
@@ -733,7 +883,7 @@ public:
     HailoClassification(const std::string &classification_type,
                         int class_id,
                         std::string label,
-                        float confidence) : m_confidence(assure_normal(confidence)), m_classification_type(classification_type), m_label(label), m_class_id(class_id){};
+                        float confidence) : m_confidence(assure_normal(confidence)), m_classification_type(classification_type), m_label(std::move(label)), m_class_id(class_id){};
     // Move Constructor
     HailoClassification(HailoClassification &&other) : m_confidence(assure_normal(other.m_confidence)),
                                                        m_classification_type(std::move(other.m_classification_type)),
@@ -9,6 +9,10 @@
 #define LICENSE_PLATE_LABEL "license_plate"
 #define OCR_LABEL "ocr"
 
+// Plates are scored at the resolution of the LPR network input, QUALITY_THRESHOLD is calibrated on this preprocessing
+static const LumaSharpnessParams license_plate_sharpness_params = {cv::Size(200, 40), cv::INTER_AREA, cv::COLOR_BGR2GRAY, true, true};
+static LumaSharpnessCache license_plate_quality_cache(QUALITY_CACHE_FRAMES, QUALITY_CACHE_SIZE_CHANGE);
+
 /**
  * @brief Returns the calculate the variance of edges.
  *
@@ -48,58 +52,8 @@ float quality_estimation(std::shared_ptr<HailoMat> hailo_mat, const HailoBBox &r
     if (cropped_width <= CROP_WIDTH_LIMIT || cropped_height <= CROP_HEIGHT_LIMIT)
         return -1.0;
 
-    // If it is not too small then we can make the crop
-    HailoROIPtr crop_roi = std::make_shared<HailoROI>(HailoBBox(cropped_xmin, cropped_ymin, cropped_width_n, cropped_height_n));
-    std::vector<cv::Mat> cropped_image_vec = hailo_mat->crop(crop_roi);
-
-    // Convert image to BGR
-    cv::Mat bgr_image;
-    switch (hailo_mat->get_type())
-    {
-    case HAILO_MAT_YUY2:
-    {
-        cv::Mat cropped_image = cropped_image_vec[0];
-        cv::Mat yuy2_image = cv::Mat(cropped_image.rows, cropped_image.cols * 2, CV_8UC2, (char *)cropped_image.data, cropped_image.step);
-        cv::cvtColor(yuy2_image, bgr_image, cv::COLOR_YUV2BGR_YUY2);
-        break;
-    }
-    case HAILO_MAT_NV12:
-    {
-        cv::Mat full_mat = cv::Mat(cropped_image_vec[0].rows + cropped_image_vec[1].rows, cropped_image_vec[0].cols, CV_8UC1);
-        memcpy(full_mat.data, cropped_image_vec[0].data, cropped_image_vec[0].rows * cropped_image_vec[0].cols);
-        memcpy(full_mat.data + cropped_image_vec[0].rows * cropped_image_vec[0].cols, cropped_image_vec[1].data, cropped_image_vec[1].rows * cropped_image_vec[1].cols);
-        cv::cvtColor(full_mat, bgr_image, cv::COLOR_YUV2BGR_NV12);
-
-        break;
-    }
-    default:
-        bgr_image = cropped_image_vec[0];
-        break;
-    }
-
-    // Resize the frame
-    cv::Mat resized_image;
-    cv::resize(bgr_image, resized_image, cv::Size(200, 40), 0, 0, cv::INTER_AREA);
-
-    // Gaussian Blur
-    cv::Mat gaussian_image;
-    cv::GaussianBlur(resized_image, gaussian_image, cv::Size(3, 3), 0);
-
-    // Convert to grayscale
-    cv::Mat gray_image;
-    cv::Mat gray_image_normalized;
-    cv::cvtColor(gaussian_image, gray_image, cv::COLOR_BGR2GRAY);
-    cv::normalize(gray_image, gray_image_normalized, 255, 0, cv::NORM_INF);
-
-    // Compute the Laplacian of the gray image
-    cv::Mat laplacian_image;
-    cv::Laplacian(gray_image_normalized, laplacian_image, CV_64F);
-
-    // Calculate the variance of edges
-    cv::Scalar mean, stddev;
-    cv::meanStdDev(laplacian_image, mean, stddev, cv::Mat());
-    float variance = stddev.val[0] * stddev.val[0];
-    return variance;
+    HailoBBox cropped_bbox(cropped_xmin, cropped_ymin, cropped_width_n, cropped_height_n);
+    return luma_sharpness(hailo_mat, cropped_bbox, license_plate_sharpness_params);
 }
 
 /**
@@ -120,22 +74,30 @@ std::vector<HailoROIPtr> license_plate_quality_estimation(std::shared_ptr<HailoM
 {
     std::vector<HailoROIPtr> crop_rois;
     float variance;
+    license_plate_quality_cache.new_frame(roi->get_stream_id());
     // Get all detections.
     std::vector<HailoDetectionPtr> vehicle_ptrs = hailo_common::get_hailo_detections(roi);
     for (HailoDetectionPtr &vehicle : vehicle_ptrs)
     {
         if (VEHICLE_LABEL != vehicle->get_label())
             continue;
+        std::vector<HailoUniqueIDPtr> track_ids = hailo_common::get_hailo_track_id(vehicle);
         // For each detection, check the inner detections
         std::vector<HailoDetectionPtr> license_plate_ptrs = hailo_common::get_hailo_detections(vehicle);
-        for (HailoDetectionPtr &license_plate : license_plate_ptrs)
+        for (uint plate_index = 0; plate_index < license_plate_ptrs.size(); plate_index++)
         {
+            HailoDetectionPtr &license_plate = license_plate_ptrs[plate_index];
             if (LICENSE_PLATE_LABEL != license_plate->get_label())
                 continue;
             HailoBBox license_plate_box = hailo_common::create_flattened_bbox(license_plate->get_bbox(), license_plate->get_scaling_bbox());
 
             // Get the variance of the image, only add ROIs that are above threshold.
-            variance = quality_estimation(image, license_plate_box, CROP_RATIO);
+            // The plate of a tracked vehicle is only scored again when its score is old or its size changed.
+            if (track_ids.empty())
+                variance = quality_estimation(image, license_plate_box, CROP_RATIO);
+            else
+                variance = license_plate_quality_cache.get(roi->get_stream_id(), track_ids[0]->get_id(), plate_index, license_plate_box,
+                                                           [&]() { return quality_estimation(image, license_plate_box, CROP_RATIO); });
 
             if (variance >= QUALITY_THRESHOLD)
             {
@@ -11,11 +11,14 @@
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 #include "hailomat.hpp"
+#include "luma_sharpness.hpp"
 
 #define CROP_RATIO 0.1
 #define QUALITY_THRESHOLD 100.0
 #define CROP_WIDTH_LIMIT 10
 #define CROP_HEIGHT_LIMIT 10
+#define QUALITY_CACHE_FRAMES 10
+#define QUALITY_CACHE_SIZE_CHANGE 0.2
 
 __BEGIN_DECLS
 float quality_estimation(std::shared_ptr<HailoMat> hailo_mat, const HailoBBox &roi, const float crop_ratio);
@@ -5,6 +5,8 @@
 #include <vector>
 #include <iostream>
 #include "re_id.hpp"
+#include "track_state_store.hpp"
+#include "recognition_policy.hpp"
 
 #define PERSON_LABEL "person"
 #define MIN_RATIO (1.7f)
@@ -15,60 +17,21 @@
 #define MAX_X (0.95f)
 #define TRACK_DELAY (5)
 #define MIN_QUALITY (400)
-#define RE_ID_NETWORK_SIZE (cv::Size(128, 256))
-std::map<int, int> track_counter;
-
-/**
- * @brief Returns the quaility estimation of the person's crop.
- *
- * @param image  -  cv::Mat
- *        The original image.
- *
- * @param roi  -  HailoBBox
- *        The Bounding box of the person to calculate quality estimation on.
- *
- * @return float
- *         The quality estimation of the person.
- */
-float quality_estimation(const cv::Mat &image, const HailoBBox &roi)
+#define QUALITY_CACHE_FRAMES (10)
+#define QUALITY_CACHE_SIZE_CHANGE (0.2f)
+// Frames each track was seen, tracks are cropped only after TRACK_DELAY frames
+static TrackStateStore<int> track_counter;
+// People are scored at the resolution of the re-id network input
+static const LumaSharpnessParams person_sharpness_params = {cv::Size(128, 256), cv::INTER_LINEAR, cv::COLOR_RGB2GRAY, false, false};
+static LumaSharpnessCache person_quality_cache(QUALITY_CACHE_FRAMES, QUALITY_CACHE_SIZE_CHANGE);
+// Which qualifying people are re-embedded on a frame, the quality is a sharpness so its floor is the one of a qualifying person
+static RecognitionPolicyParams re_id_policy_params()
 {
-    // Crop the center of the roi from the image, avoid cropping out of bounds
-    int cropped_xmin = CLAMP((image.cols * roi.xmin()), 0, image.cols);
-    int cropped_ymin = CLAMP((image.rows * roi.ymin()), 0, image.rows);
-    int cropped_xmax = CLAMP((image.cols * roi.xmax()), cropped_xmin, image.cols);
-    int cropped_ymax = CLAMP((image.rows * roi.ymax()), cropped_ymin, image.rows);
-    int cropped_width = cropped_xmax - cropped_xmin;
-    int cropped_height = cropped_ymax - cropped_ymin;
-
-    // If it is not too small then we can make the crop
-    cv::Rect center_crop(cropped_xmin, cropped_ymin, cropped_width, cropped_height);
-    cv::Mat cropped_image = image(center_crop);
-
-    // Resize the frame
-    cv::Mat resized_image;
-    cv::resize(cropped_image, resized_image, RE_ID_NETWORK_SIZE, 0, 0, cv::INTER_LINEAR);
-
-    // Convert to grayscale
-    cv::Mat gray_image;
-    cv::cvtColor(resized_image, gray_image, cv::COLOR_RGB2GRAY);
-
-    // Compute the Laplacian of the gray image
-    cv::Mat laplacian_image;
-    cv::Laplacian(gray_image, laplacian_image, CV_64F);
-
-    // Calculate the quality of person
-    cv::Scalar mean, stddev;
-    cv::meanStdDev(laplacian_image, mean, stddev, cv::Mat());
-    float quality = stddev.val[0] * stddev.val[0];
-
-    // Release resources
-    resized_image.release();
-    cropped_image.release();
-    gray_image.release();
-    laplacian_image.release();
-
-    return quality;
+    RecognitionPolicyParams params;
+    params.min_quality = MIN_QUALITY;
+    return params;
 }
+static RecognitionPolicy re_id_policy(re_id_policy_params());
 
 HailoUniqueIDPtr get_tracking_id(HailoDetectionPtr detection)
 {
@@ -84,15 +47,30 @@ HailoUniqueIDPtr get_tracking_id(HailoDetectionPtr detection)
 }
 
 /**
- * @brief Returns a vector of HailoROIPtr to crop and resize.
+ * @brief Counts the frames a track was seen, it is delayed for its first TRACK_DELAY frames.
  *
- * @param image The original picture (cv::Mat).
- * @param roi The main ROI of this picture.
- * @return std::vector<HailoROIPtr> vector of ROI's to crop and resize.
+ * @param stream_id The stream id of the roi.
+ * @param tracking_id The tracking id of the detection.
+ * @return true if the track should not be cropped yet.
  */
-std::vector<HailoROIPtr> create_crops(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
+bool track_delayed(const std::string &stream_id, int tracking_id)
 {
-    std::vector<HailoROIPtr> crop_rois;
+    return track_counter.update(stream_id, tracking_id, [](int &counter) {
+        if (counter > TRACK_DELAY)
+            return false;
+        counter++;
+        return true;
+    });
+}
+
+/**
+ * @brief Call func with every person detection that qualifies for re-id on this frame:
+ *        tracked for TRACK_DELAY frames, upright, in the middle of the frame and sharp enough.
+ */
+template <typename F>
+static void for_each_qualifying_person(std::shared_ptr<HailoMat> image, HailoROIPtr roi, F func)
+{
+    person_quality_cache.new_frame(roi->get_stream_id());
     // Get all detections.
     std::vector<HailoDetectionPtr> detections_ptrs = hailo_common::get_hailo_detections(roi);
     for (HailoDetectionPtr &detection : detections_ptrs)
@@ -105,28 +83,59 @@ std::vector<HailoROIPtr> create_crops(std::shared_ptr<HailoMat> image, HailoROIP
 
             int tracking_id = get_tracking_id(detection)->get_id();
 
-            auto counter = track_counter.find(tracking_id);
-            if (counter == track_counter.end())
-            {
-                track_counter[tracking_id] = 0;
-            }
-            else if (counter->second < TRACK_DELAY)
-            {
-                track_counter[tracking_id] += 1;
-            }
-            else
+            if (!track_delayed(roi->get_stream_id(), tracking_id))
             {
                 auto bbox = detection->get_bbox();
-                float quality = quality_estimation(image->get_matrices()[0], bbox);
+                float quality = person_quality_cache.get(roi->get_stream_id(), tracking_id, 0, bbox, [&]() { return luma_sharpness(image, bbox, person_sharpness_params); });
                 float ratio = (bbox.height() * image->height()) / (bbox.width() * image->width());
                 if (ratio > MIN_RATIO && ratio < MAX_RATIO &&
                     bbox.height() > MIN_HEIGHT && bbox.height() < MAX_HEIGHT &&
                     bbox.xmin() > MIN_X && bbox.xmax() < MAX_X && quality > MIN_QUALITY)
                 {
-                    crop_rois.emplace_back(detection);
+                    func(detection, tracking_id, bbox, quality);
                 }
             }
         }
     }
+}
+
+/**
+ * @brief Returns a vector of HailoROIPtr to crop and resize.
+ *        Tracks the gallery already identified with confidence are re-embedded less and less often
+ *        (see RecognitionPolicy), at most create_crops_set_max_crops() of them per frame.
+ *
+ * @param image The original picture (cv::Mat).
+ * @param roi The main ROI of this picture.
+ * @return std::vector<HailoROIPtr> vector of ROI's to crop and resize.
+ */
+std::vector<HailoROIPtr> create_crops(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
+{
+    std::vector<HailoROIPtr> crop_rois;
+    std::vector<RecognitionCandidate> candidates;
+    const std::string &stream_id = roi->get_stream_id();
+    re_id_policy.new_frame(stream_id);
+    for_each_qualifying_person(image, roi, [&](HailoDetectionPtr &detection, int tracking_id, const HailoBBox &bbox, float quality) {
+        float priority = re_id_policy.priority(stream_id, tracking_id, bbox, quality);
+        candidates.push_back({detection, tracking_id, bbox, quality, priority});
+    });
+    re_id_policy.select(stream_id, candidates, crop_rois);
+    return crop_rois;
+}
+
+/**
+ * @brief Returns every qualifying person on every frame, without the recognition policy
+ *        (e.g. to record the tracks for recognition_policy_replay).
+ */
+std::vector<HailoROIPtr> create_crops_every_frame(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
+{
+    std::vector<HailoROIPtr> crop_rois;
+    for_each_qualifying_person(image, roi, [&](HailoDetectionPtr &detection, int, const HailoBBox &, float) {
+        crop_rois.emplace_back(detection);
+    });
     return crop_rois;
 }
+
+void create_crops_set_max_crops(uint max_crops)
+{
+    re_id_policy.set_max_crops(max_crops);
+}
@@ -8,8 +8,11 @@
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 #include "hailomat.hpp"
+#include "luma_sharpness.hpp"
 
 __BEGIN_DECLS
 std::vector<HailoROIPtr> create_crops(std::shared_ptr<HailoMat> image, HailoROIPtr roi);
+std::vector<HailoROIPtr> create_crops_every_frame(std::shared_ptr<HailoMat> image, HailoROIPtr roi);
+void create_crops_set_max_crops(uint max_crops);
 
 __END_DECLS
\ No newline at end of file
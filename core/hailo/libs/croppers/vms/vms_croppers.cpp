@@ -5,6 +5,8 @@
 #include <vector>
 #include <cmath>
 #include "vms_croppers.hpp"
+#include "track_state_store.hpp"
+#include "recognition_policy.hpp"
 
 #define PERSON_LABEL "person"
 #define FACE_LABEL "face"
@@ -12,7 +14,13 @@
 #define FACE_ATTRIBUTES_CROP_HIGHT_OFFSET_FACTOR (0.10f)
 #define TRACK_UPDATE 60
 
-std::map<int, int> track_counter;
+struct TrackUpdateCounter
+{
+    int frames_since_update = TRACK_UPDATE; // A new track requires an update
+};
+static TrackStateStore<TrackUpdateCounter> track_counter;
+// Which faces are sent to the face recognition network on a frame
+static RecognitionPolicy face_recognition_policy;
 
 /**
 * @brief Get the tracking Hailo Unique Id object from a Hailo Detection.
@@ -50,35 +58,26 @@ bool box_contains_nan(HailoBBox box)
 *       How many frames to wait for an update are defined in TRACK_UPDATE.
 * 
 * @param detection HailoDetectionPtr
+* @param stream_id the stream id of the roi the detection belongs to
 * @param use_track_update boolean can override the default behaviour, false will always require an update
 * @return boolean indicating if traker update is required.
 */
-bool track_update(HailoDetectionPtr detection, bool use_track_update)
+bool track_update(HailoDetectionPtr detection, const std::string &stream_id, bool use_track_update)
 {
     auto tracking_obj = get_tracking_id(detection);
     if (tracking_obj && use_track_update)
     {
-        int tracking_id = tracking_obj->get_id();
-        auto counter = track_counter.find(tracking_id);
-        if (counter == track_counter.end())
-        {
-            // Emplace new element to the track_counter map. track update required.
-            track_counter.emplace(tracking_id, 0);
-            return true;
-        }
-        else if (counter->second >= TRACK_UPDATE)
-        {
-            // Counter passed the TRACK_UPDATE limit - set existing track to 0. track update required.
-            track_counter[tracking_id] = 0;
-            return true;
-        }
-        else if (counter->second < TRACK_UPDATE)
-        {
-            // Counter is still below TRACK_UPDATE_LIMIT - increasing the exising value. track update should be skipped. 
-            track_counter[tracking_id] += 1;
-        }
-
-        return false;
+        return track_counter.update(stream_id, tracking_obj->get_id(), [](TrackUpdateCounter &counter) {
+            if (counter.frames_since_update >= TRACK_UPDATE)
+            {
+                // New track, or the counter passed the TRACK_UPDATE limit - set it to 0. track update required.
+                counter.frames_since_update = 0;
+                return true;
+            }
+            // Counter is still below TRACK_UPDATE - increasing it. track update should be skipped.
+            counter.frames_since_update++;
+            return false;
+        });
     }
 
     return true;
@@ -101,7 +100,7 @@ std::vector<HailoROIPtr> person_crop(std::shared_ptr<HailoMat> image, HailoROIPt
         // Modify only detections with "person" label.
         if (std::string(PERSON_LABEL) == detection->get_label())
         {
-            if (track_update(detection, use_track_update))
+            if (track_update(detection, roi->get_stream_id(), use_track_update))
                 crop_rois.emplace_back(detection);
         }
     }
@@ -182,6 +181,26 @@ HailoDetectionPtr clone_detection_object(HailoDetectionPtr detection)
     return new_roi;
 }
 
+/**
+ * @brief Returns a face detection to crop: a copy of the detection, with the box of the 3ddfa cropping algorithm.
+ */
+static HailoROIPtr make_face_crop(std::shared_ptr<HailoMat> image, HailoDetectionPtr detection)
+{
+    // Modifies a rectengle according to a cropping algorithm only on faces
+    auto new_bbox = algorithm_face_crop(image->native_width(), image->native_height(), detection->get_bbox(), FACE_ATTRIBUTES_CROP_SCALE_FACTOR, FACE_ATTRIBUTES_CROP_HIGHT_OFFSET_FACTOR);
+
+    HailoDetectionPtr new_roi = clone_detection_object(detection);
+    hailo_common::fixate_landmarks_with_bbox(new_roi, new_bbox);
+
+    new_roi->set_bbox(new_bbox);
+    return new_roi;
+}
+
+static bool is_face(HailoDetectionPtr detection)
+{
+    return std::string(FACE_LABEL) == detection->get_label() && !box_contains_nan(detection->get_bbox());
+}
+
 /**
  * @brief Returns a vector of face detections to crop and resize.
  *
@@ -198,29 +217,59 @@ std::vector<HailoROIPtr> face_crop(std::shared_ptr<HailoMat> image, HailoROIPtr
     for (HailoDetectionPtr &detection : detections_ptrs)
     {
         // Modify only detections with "face" label.
-        if (std::string(FACE_LABEL) == detection->get_label() && !box_contains_nan(detection->get_bbox()))
-        {
-            if (track_update(detection, use_track_update))
-            {
-                // Modifies a rectengle according to a cropping algorithm only on faces
-                auto new_bbox = algorithm_face_crop(image->native_width(), image->native_height(), detection->get_bbox(), FACE_ATTRIBUTES_CROP_SCALE_FACTOR, FACE_ATTRIBUTES_CROP_HIGHT_OFFSET_FACTOR);
-
-                HailoDetectionPtr new_roi = clone_detection_object(detection);
-                hailo_common::fixate_landmarks_with_bbox(new_roi, new_bbox);
+        if (is_face(detection) && track_update(detection, roi->get_stream_id(), use_track_update))
+            crop_rois.emplace_back(make_face_crop(image, detection));
+    }
+    return crop_rois;
+}
 
-                new_roi->set_bbox(new_bbox);
-                crop_rois.emplace_back(new_roi);
-            }
+/**
+ * @brief Returns the faces to recognize on this frame.
+ *        Tracks the gallery already identified with confidence are recognized less and less often
+ *        (see RecognitionPolicy), at most face_recognition_set_max_crops() of them per frame.
+ *        Faces without a tracking id are always recognized. The detection confidence is the crop quality.
+ */
+std::vector<HailoROIPtr> face_recognition(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
+{
+    std::vector<HailoROIPtr> crop_rois;
+    std::vector<RecognitionCandidate> candidates;
+    const std::string &stream_id = roi->get_stream_id();
+    face_recognition_policy.new_frame(stream_id);
+    std::vector<HailoDetectionPtr> detections_ptrs = hailo_common::get_hailo_detections(roi);
+    for (HailoDetectionPtr &detection : detections_ptrs)
+    {
+        if (!is_face(detection))
+            continue;
+        auto tracking_obj = get_tracking_id(detection);
+        if (!tracking_obj)
+        {
+            crop_rois.emplace_back(make_face_crop(image, detection));
+            continue;
         }
+        HailoBBox bbox = detection->get_bbox();
+        float quality = detection->get_confidence();
+        float priority = face_recognition_policy.priority(stream_id, tracking_obj->get_id(), bbox, quality);
+        // Only the chosen faces are copied
+        candidates.push_back({detection, tracking_obj->get_id(), bbox, quality, priority});
     }
+    size_t untracked = crop_rois.size();
+    face_recognition_policy.select(stream_id, candidates, crop_rois);
+    for (size_t i = untracked; i < crop_rois.size(); i++)
+        crop_rois[i] = make_face_crop(image, std::dynamic_pointer_cast<HailoDetection>(crop_rois[i]));
     return crop_rois;
 }
 
-std::vector<HailoROIPtr> face_recognition(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
+// Every face on every frame, without the recognition policy
+std::vector<HailoROIPtr> face_recognition_every_frame(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
 {
     return face_crop(image, roi, false);
 }
 
+void face_recognition_set_max_crops(uint max_crops)
+{
+    face_recognition_policy.set_max_crops(max_crops);
+}
+
 std::vector<HailoROIPtr> face_attributes(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
 {
     return face_crop(image, roi, true);
@@ -229,4 +278,4 @@ std::vector<HailoROIPtr> face_attributes(std::shared_ptr<HailoMat> image, HailoR
 std::vector<HailoROIPtr> person_attributes(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
 {
     return person_crop(image, roi, true);
-}
\ No newline at end of file
+}
@@ -13,5 +13,7 @@ __BEGIN_DECLS
 std::vector<HailoROIPtr> person_attributes(std::shared_ptr<HailoMat> mat, HailoROIPtr roi);
 std::vector<HailoROIPtr> face_attributes(std::shared_ptr<HailoMat> image, HailoROIPtr roi);
 std::vector<HailoROIPtr> face_recognition(std::shared_ptr<HailoMat> image, HailoROIPtr roi);
+std::vector<HailoROIPtr> face_recognition_every_frame(std::shared_ptr<HailoMat> image, HailoROIPtr roi);
+void face_recognition_set_max_crops(uint max_crops);
 
 __END_DECLS
\ No newline at end of file
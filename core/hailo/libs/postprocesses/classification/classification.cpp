@@ -2,25 +2,42 @@
  * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
+#include <map>
+#include <string>
 #include <vector>
-#include <iostream>
 #include "common/labels/imagenet.hpp"
-#include "common/tensors.hpp"
-#include "common/math.hpp"
+#include "common/quantized_classification.hpp"
 #include "classification.hpp"
-#include "xtensor/xadapt.hpp"
-#include "xtensor/xarray.hpp"
 
-#define RESNET_50_LAYER_NAME "resnet_v1_50/softmax1"
-#define MOBILENET_V1_LAYER_NAME "mobilenet_v1/softmax1"
-#define RESNET_V1_18_LAYER_NAME "resnet_v1_18/softmax1"
+static const std::string RESNET_50_LAYER_NAME = "resnet_v1_50/softmax1";
+static const std::string MOBILENET_V1_LAYER_NAME = "mobilenet_v1/softmax1";
+static const std::string RESNET_V1_18_LAYER_NAME = "resnet_v1_18/softmax1";
+static const std::string CLASSIFICATION_TYPE = "imagenet";
 #define COMMA ","
 
-void top1(HailoROIPtr roi, std::string layer_name, int label_offset)
+/**
+ * @brief The imagenet label of a class. If there are multiple synonyms for the class, only the first.
+ *        The labels are trimmed once, on first use.
+ */
+static const std::string &imagenet_label(int index)
 {
-    const int k = 1;
-    std::string label = "";
+    static const std::map<int, std::string> first_synonyms = []
+    {
+        std::map<int, std::string> labels;
+        for (auto &label : common::imagenet_labels)
+        {
+            int comma_pos = label.second.find(COMMA);
+            labels.emplace(label.first, comma_pos > 0 ? label.second.substr(0, comma_pos) : label.second);
+        }
+        return labels;
+    }();
+    static const std::string unknown_label = "";
+    auto label = first_synonyms.find(index);
+    return label != first_synonyms.end() ? label->second : unknown_label;
+}
 
+void top1(HailoROIPtr roi, const std::string &layer_name, int label_offset)
+{
     if (!roi->has_tensors())
     {
         return;
@@ -29,29 +46,21 @@ void top1(HailoROIPtr roi, std::string layer_name, int label_offset)
     // Extract the relevant output tensor.
     HailoTensorPtr scores = roi->get_tensor(layer_name);
 
-    // Convert the tensor to xarray.
-    xt::xarray<uint8_t> xscores = common::get_xtensor(scores);
-
-    // Find the topk scores.
-    xt::xarray<int> top_k_scores = common::top_k(xscores, k);
-
-    // Extrats the label of the top score.
-    int index = top_k_scores[0] - label_offset;
-    std::string labels = common::imagenet_labels[index];
+    // The softmax is part of the network: find the top score on the quantized values, and dequantize only it.
+    float confidence = 0.0f;
+    int top_index = common::visit_quantized_scores(scores, [&confidence](const auto &quantized_scores)
+                                                   {
+                                                       int best = common::quantized_argmax(quantized_scores);
+                                                       if (best >= 0)
+                                                           confidence = quantized_scores.dequantize(best);
+                                                       return best;
+                                                   });
+    if (top_index < 0)
+        return;
 
-    // If there are multiple synonyms for this class, take only the first.
-    int comma_pos = labels.find(COMMA);
-    if (comma_pos > 0)
-        label = labels.substr(0, comma_pos);
-    else
-        label = labels;
-    float confidence = scores->fix_scale(xscores(index));
     // Update the tensor with the classification result.
-    hailo_common::add_classification(roi,
-                                     std::string("imagenet"),
-                                     label,
-                                     confidence,
-                                     index);
+    int index = top_index - label_offset;
+    hailo_common::add_object(roi, std::make_shared<HailoClassification>(CLASSIFICATION_TYPE, index, imagenet_label(index), confidence));
 }
 
 void filter(HailoROIPtr roi)
@@ -72,4 +81,31 @@ void mobilenet_v1(HailoROIPtr roi)
 void resnet_v1_18(HailoROIPtr roi)
 {
     top1(roi, RESNET_V1_18_LAYER_NAME, 0);
-}
\ No newline at end of file
+}
+
+//******************************************************************
+//  BATCH ENTRY POINTS
+//******************************************************************
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    for (HailoROIPtr &roi : rois)
+        top1(roi, RESNET_50_LAYER_NAME, 0);
+}
+
+void resnet_v1_50_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    for (HailoROIPtr &roi : rois)
+        top1(roi, RESNET_50_LAYER_NAME, 0);
+}
+
+void mobilenet_v1_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    for (HailoROIPtr &roi : rois)
+        top1(roi, MOBILENET_V1_LAYER_NAME, 1);
+}
+
+void resnet_v1_18_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    for (HailoROIPtr &roi : rois)
+        top1(roi, RESNET_V1_18_LAYER_NAME, 0);
+}
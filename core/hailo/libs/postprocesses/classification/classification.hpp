@@ -11,4 +11,8 @@ void filter(HailoROIPtr roi);
 void resnet_v1_50(HailoROIPtr roi);
 void mobilenet_v1(HailoROIPtr roi);
 void resnet_v1_18(HailoROIPtr roi);
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
+void resnet_v1_50_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
+void mobilenet_v1_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
+void resnet_v1_18_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
 __END_DECLS
\ No newline at end of file
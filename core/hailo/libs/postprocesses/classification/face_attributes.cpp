@@ -2,38 +2,46 @@
 * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
 * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
 **/
+#include <stdexcept>
+#include <string>
 #include <vector>
 #include "common/labels/celeb_a.hpp"
-#include "common/tensors.hpp"
-#include "common/math.hpp"
+#include "common/quantized_classification.hpp"
 #include "face_attributes.hpp"
 #include "hailo_tracker.hpp"
-#include "xtensor/xadapt.hpp"
-#include "xtensor/xarray.hpp"
 
-#define RESNET_V1_18_FACE_OUTPUT_LAYER_NAME "face_attr_resnet_v1_18/fc3"
 #define RESNET_V1_18_FACE_NUMBER_OF_CLASSES 40
 #define RESNET_V1_18_FACE_THRESHOLD 0.3f
 
+static const std::string RESNET_V1_18_FACE_OUTPUT_LAYER_NAME = "face_attr_resnet_v1_18/fc3";
+static const std::string RESNET_V1_18_FACE_RGBA_OUTPUT_LAYER_NAME = "face_attr_resnet_v1_18_rgbx/fc3";
+static const std::string FACE_ATTRIBUTES_TYPE = "face_attributes";
+
 std::string tracker_name="hailo_face_tracker";
 
-xt::xarray<float> get_face_attributes(HailoROIPtr roi, std::string output_layer_name)
+/**
+ * @brief Get the face attribute predictions: the argmax of the 2 logits of every class (1 when the attribute is present).
+ *        Both logits of a class share the quantization of the tensor, so the argmax is taken on the quantized values.
+ *
+ * @param attr_predictions Output, RESNET_V1_18_FACE_NUMBER_OF_CLASSES predictions.
+ */
+void get_face_attributes(HailoROIPtr roi, const std::string &output_layer_name, int *attr_predictions)
 {
     // Extract the relevant output tensor.
     HailoTensorPtr outp_tensor = roi->get_tensor(output_layer_name);
+    if (outp_tensor->size() != RESNET_V1_18_FACE_NUMBER_OF_CLASSES * 2)
+        throw std::invalid_argument("Face attributes tensor " + output_layer_name + " doesn't hold 2 logits per class");
 
-    // Convert the tensor to xarray
-    xt::xarray<float> output_dequantize = common::get_xtensor_float(outp_tensor);
-
-    // Reshape the output tensor to 40 classes view
-    output_dequantize = xt::reshape_view(output_dequantize, {1, RESNET_V1_18_FACE_NUMBER_OF_CLASSES, 2});
-
-    // Get the face attributes values by argmax
-    xt::xarray<float>  attr_predictions = xt::argmax(output_dequantize, -1);
-    return attr_predictions;
+    // Get the face attributes values by argmax of the [classes, 2] view
+    common::visit_quantized_scores(outp_tensor, [attr_predictions](const auto &scores)
+                                   { common::quantized_grouped_argmax(scores, 2, attr_predictions); });
 }
 
-void add_attribute_prediction_to_roi(HailoROIPtr roi, std::vector<HailoUniqueIDPtr> unique_ids, std::string jde_tracker_name, std::string label, float confidence, int index)
+/**
+ * @param unique_id_count Number of unique ids of the roi, the results go to the track of unique_id if there are any.
+ */
+void add_attribute_prediction_to_roi(HailoROIPtr roi, size_t unique_id_count, int unique_id, const std::string &jde_tracker_name,
+                                     const std::string &label, float confidence, int index)
 {
     HailoClassificationPtr classification;
 
@@ -42,7 +50,7 @@ void add_attribute_prediction_to_roi(HailoROIPtr roi, std::vector<HailoUniqueIDP
         if (label != "No_Beard")
         {
             // Create the classification result
-            classification = std::make_shared<HailoClassification>(std::string("face_attributes"),
+            classification = std::make_shared<HailoClassification>(FACE_ATTRIBUTES_TYPE,
                                                                    index,
                                                                    label,
                                                                    confidence);
@@ -58,7 +66,7 @@ void add_attribute_prediction_to_roi(HailoROIPtr roi, std::vector<HailoUniqueIDP
         if (new_label != "")
         {
             // Create the classification result
-            classification = std::make_shared<HailoClassification>(std::string("face_attributes"),
+            classification = std::make_shared<HailoClassification>(FACE_ATTRIBUTES_TYPE,
                                                                    index,
                                                                    new_label,
                                                                    0.99f);
@@ -67,7 +75,7 @@ void add_attribute_prediction_to_roi(HailoROIPtr roi, std::vector<HailoUniqueIDP
 
     if (classification != nullptr)
     {
-        if(unique_ids.empty())
+        if (unique_id_count == 0)
         {
             hailo_common::add_object(roi, classification);
         }
@@ -75,51 +83,98 @@ void add_attribute_prediction_to_roi(HailoROIPtr roi, std::vector<HailoUniqueIDP
         {
             // Update the tracker with the results
             HailoTracker::GetInstance().add_object_to_track(jde_tracker_name,
-                                                            unique_ids[0]->get_id(),
+                                                            unique_id,
                                                             classification);
         }
     }
 }
 
-void face_attributes_postprocess(HailoROIPtr roi, std::string output_layer_name)
+/**
+ * @param jde_tracker_name The tracker of the roi's stream, the caller may keep it across the rois of a stream.
+ */
+void face_attributes_postprocess(HailoROIPtr roi, const std::string &output_layer_name, const std::string &jde_tracker_name)
 {
     if (!roi->has_tensors())
     {
         return;
     }
 
-    xt::xarray<float> attr_predictions = get_face_attributes(roi, output_layer_name);
+    int attr_predictions[RESNET_V1_18_FACE_NUMBER_OF_CLASSES];
+    get_face_attributes(roi, output_layer_name, attr_predictions);
 
-    std::string jde_tracker_name = tracker_name + "_" + roi->get_stream_id();
-    std::vector<HailoUniqueIDPtr> unique_ids = hailo_common::get_hailo_unique_id(roi);
-    if (!unique_ids.empty())
+    int unique_id = 0;
+    size_t unique_id_count = hailo_common::get_hailo_unique_id_count(roi, unique_id);
+    if (unique_id_count != 0)
     {
         HailoTracker::GetInstance().remove_classifications_from_track(jde_tracker_name,
-                                                                    unique_ids[0]->get_id(),
-                                                                    std::string("face_attributes"));
+                                                                    unique_id,
+                                                                    FACE_ATTRIBUTES_TYPE);
     }
 
-    std::string label = "";
     // Iterate over the attribute predictions
     for (int i = 0; i < RESNET_V1_18_FACE_NUMBER_OF_CLASSES; i++)
     {
         // Get the label from the celeb_a labels
-        label = labels::celeb_a_filtered[i];
+        const std::string &label = labels::celeb_a_filtered.at(i);
         if (label == "")
             continue;
 
         // Get the confidence
-        float confidence = (attr_predictions(0, i)*0.99f);
-        add_attribute_prediction_to_roi(roi, unique_ids, jde_tracker_name, label, confidence, i);
+        float confidence = (attr_predictions[i]*0.99f);
+        add_attribute_prediction_to_roi(roi, unique_id_count, unique_id, jde_tracker_name, label, confidence, i);
+    }
+}
+
+/**
+ * @brief Set name to the tracker of the roi's stream, rebuilt only when the stream changes.
+ */
+static void update_tracker_name(HailoROIPtr roi, std::string &stream_id, std::string &name)
+{
+    std::string roi_stream_id = roi->get_stream_id();
+    if (name.empty() || roi_stream_id != stream_id)
+    {
+        stream_id = roi_stream_id;
+        name = tracker_name + "_" + stream_id;
+    }
+}
+
+static void face_attributes_single(HailoROIPtr roi, const std::string &output_layer_name)
+{
+    std::string jde_tracker_name = tracker_name + "_" + roi->get_stream_id();
+    face_attributes_postprocess(roi, output_layer_name, jde_tracker_name);
+}
+
+// All the crops of a batch in one call, the tracker name is only rebuilt when the stream changes
+static void face_attributes_batch(std::vector<HailoROIPtr> &rois, const std::string &output_layer_name)
+{
+    std::string stream_id;
+    std::string jde_tracker_name;
+    for (HailoROIPtr &roi : rois)
+    {
+        update_tracker_name(roi, stream_id, jde_tracker_name);
+        face_attributes_postprocess(roi, output_layer_name, jde_tracker_name);
     }
 }
 
 void filter(HailoROIPtr roi)
 {
-    face_attributes_postprocess(roi, RESNET_V1_18_FACE_OUTPUT_LAYER_NAME);
+    face_attributes_single(roi, RESNET_V1_18_FACE_OUTPUT_LAYER_NAME);
 }
 
 void face_attributes_rgba(HailoROIPtr roi)
 {
-    face_attributes_postprocess(roi, "face_attr_resnet_v1_18_rgbx/fc3");
+    face_attributes_single(roi, RESNET_V1_18_FACE_RGBA_OUTPUT_LAYER_NAME);
+}
+
+//******************************************************************
+//  BATCH ENTRY POINTS
+//******************************************************************
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    face_attributes_batch(rois, RESNET_V1_18_FACE_OUTPUT_LAYER_NAME);
+}
+
+void face_attributes_rgba_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    face_attributes_batch(rois, RESNET_V1_18_FACE_RGBA_OUTPUT_LAYER_NAME);
 }
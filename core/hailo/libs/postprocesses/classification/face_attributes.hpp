@@ -9,4 +9,6 @@
 __BEGIN_DECLS
 void filter(HailoROIPtr roi);
 void face_attributes_rgba(HailoROIPtr roi);
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
+void face_attributes_rgba_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
 __END_DECLS
\ No newline at end of file
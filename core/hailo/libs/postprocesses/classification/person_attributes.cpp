@@ -2,73 +2,58 @@
  * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
+#include <string>
 #include <vector>
 #include "common/labels/peta.hpp"
-#include "common/tensors.hpp"
-#include "common/math.hpp"
+#include "common/quantized_classification.hpp"
 #include "hailo_tracker.hpp"
 #include "person_attributes.hpp"
-#include "xtensor/xadapt.hpp"
-#include "xtensor/xarray.hpp"
 
-#define RESNET_V1_18_PERSON_OUTPUT_LAYER_NAME "person_attr_resnet_v1_18/fc1"
 #define RESNET_V1_18_PERSON_THRESHOLD 0.7f
 
+static const std::string RESNET_V1_18_PERSON_OUTPUT_LAYER_NAME = "person_attr_resnet_v1_18/fc1";
+static const std::string RESNET_V1_18_PERSON_RGBA_OUTPUT_LAYER_NAME = "person_attr_resnet_v1_18_rgbx/fc1";
+static const std::string PERSON_ATTRIBUTES_TYPE = "person_attributes";
+
 std::string tracker_name = "hailo_person_tracker";
 
-xt::xarray<float> get_attr_predictions_from_tensor(HailoTensorPtr outp_tensor)
-{
-    // Convert the tensor to xarray
-    xt::xarray<float> xscores = common::get_xtensor_float(outp_tensor);
-    auto attr_predictions = xt::view(xscores, 0, 0, xt::all());
+using ThresholdCache = common::QuantizedThresholdCache<float (*)(float)>;
 
-    // Calculate the face attributes values by sigmoid
-    common::sigmoid(attr_predictions.data(), attr_predictions.size());
-    return attr_predictions;
+static const std::string &peta_label(int index)
+{
+    static const std::string unknown_label = "";
+    auto label = labels::peta_filtered.find(index);
+    return label != labels::peta_filtered.end() ? label->second : unknown_label;
 }
 
-void person_attributes_postprocess(HailoROIPtr roi, std::string output_layer_name)
+/**
+ * @brief Add the attributes whose sigmoid passes the threshold. The sigmoid is never computed:
+ *        the threshold is moved to the quantized domain once per quantization (thresholds caches it).
+ */
+template <typename T>
+static void add_person_attributes(HailoROIPtr roi, const common::QuantizedScores<T> &attr_predictions, ThresholdCache &thresholds,
+                                  size_t unique_id_count, int unique_id, const std::string &jde_tracker_name)
 {
-    if (!roi->has_tensors())
-    {
-        return;
-    }
-
-    // Extract the relevant output tensor.
-    HailoTensorPtr outp_tensor = roi->get_tensor(output_layer_name);
-    auto attr_predictions = get_attr_predictions_from_tensor(outp_tensor);
-
-    std::string label = "";
-    std::string jde_tracker_name = tracker_name + "_" + roi->get_stream_id();
-    auto unique_ids = hailo_common::get_hailo_unique_id(roi);
-    if (unique_ids.size() == 1)
-    {
-        HailoTracker::GetInstance().remove_classifications_from_track(jde_tracker_name,
-                                                                      unique_ids[0]->get_id(),
-                                                                      std::string("person_attributes"));
-    }
+    int threshold = thresholds.get(attr_predictions);
 
-    uint num_of_attributes = attr_predictions.shape()[0];
     // Iterate over the attribute predictions
-    for (uint i = 0; i < num_of_attributes; i++)
+    for (int i = 0; i < attr_predictions.count; i++)
     {
-        // Get the confidence
-        float confidence = attr_predictions(i);
         // Get the label from the peta labels
-        label = labels::peta_filtered[i];
+        const std::string &label = peta_label(i);
 
         // Filter confidence values by threshold
         HailoClassificationPtr classification;
-        if (label != "" && confidence > RESNET_V1_18_PERSON_THRESHOLD)
+        if (label != "" && attr_predictions.at(i) >= threshold)
         {
-            classification = std::make_shared<HailoClassification>(std::string("person_attributes"),
+            classification = std::make_shared<HailoClassification>(PERSON_ATTRIBUTES_TYPE,
                                                                    i,
                                                                    label,
                                                                    0.99f);
         }
         else if(label == "Male")
         {
-            classification = std::make_shared<HailoClassification>(std::string("person_attributes"),
+            classification = std::make_shared<HailoClassification>(PERSON_ATTRIBUTES_TYPE,
                                                         i,
                                                         "Female",
                                                         0.99f);
@@ -77,32 +62,120 @@ void person_attributes_postprocess(HailoROIPtr roi, std::string output_layer_nam
         if (!classification)
             continue;
 
-        if (unique_ids.empty())
+        if (unique_id_count == 0)
         {
             hailo_common::add_object(roi, classification);
         }
-        else if(unique_ids.size() == 1)
+        else if(unique_id_count == 1)
         {
             // We are updating the tracker with the results.
             // No need to add the object to the ROI because it is followed by fakesing - end of sub-pipeline.
             HailoTracker::GetInstance().add_object_to_track(jde_tracker_name,
-                                                            unique_ids[0]->get_id(),
+                                                            unique_id,
                                                             classification);
         }
     }
 }
 
+/**
+ * @param jde_tracker_name The tracker of the roi's stream, the caller may keep it across the rois of a stream.
+ * @param thresholds       The quantized threshold, the caller may keep it across rois.
+ */
+void person_attributes_postprocess(HailoROIPtr roi, const std::string &output_layer_name, const std::string &jde_tracker_name,
+                                   ThresholdCache &thresholds)
+{
+    if (!roi->has_tensors())
+    {
+        return;
+    }
+
+    // Extract the relevant output tensor.
+    HailoTensorPtr outp_tensor = roi->get_tensor(output_layer_name);
+
+    int unique_id = 0;
+    size_t unique_id_count = hailo_common::get_hailo_unique_id_count(roi, unique_id);
+    if (unique_id_count == 1)
+    {
+        HailoTracker::GetInstance().remove_classifications_from_track(jde_tracker_name,
+                                                                      unique_id,
+                                                                      PERSON_ATTRIBUTES_TYPE);
+    }
+
+    // The attributes are the features of the first cell of the tensor
+    common::visit_quantized_scores(outp_tensor, [&](auto attr_predictions)
+                                   {
+                                       attr_predictions.count = outp_tensor->features();
+                                       add_person_attributes(roi, attr_predictions, thresholds, unique_id_count, unique_id, jde_tracker_name);
+                                   });
+}
+
+/**
+ * @brief Set name to the tracker of the roi's stream, rebuilt only when the stream changes.
+ */
+static void update_tracker_name(HailoROIPtr roi, std::string &stream_id, std::string &name)
+{
+    std::string roi_stream_id = roi->get_stream_id();
+    if (name.empty() || roi_stream_id != stream_id)
+    {
+        stream_id = roi_stream_id;
+        name = tracker_name + "_" + stream_id;
+    }
+}
+
+static ThresholdCache make_threshold_cache()
+{
+    return ThresholdCache(RESNET_V1_18_PERSON_THRESHOLD, common::sigmoid_activation);
+}
+
+static void person_attributes_single(HailoROIPtr roi, const std::string &output_layer_name)
+{
+    thread_local ThresholdCache thresholds = make_threshold_cache();
+    std::string jde_tracker_name = tracker_name + "_" + roi->get_stream_id();
+    person_attributes_postprocess(roi, output_layer_name, jde_tracker_name, thresholds);
+}
+
+// All the crops of a batch in one call, the tracker name is only rebuilt when the stream changes
+static void person_attributes_batch(std::vector<HailoROIPtr> &rois, const std::string &output_layer_name)
+{
+    thread_local ThresholdCache thresholds = make_threshold_cache();
+    std::string stream_id;
+    std::string jde_tracker_name;
+    for (HailoROIPtr &roi : rois)
+    {
+        update_tracker_name(roi, stream_id, jde_tracker_name);
+        person_attributes_postprocess(roi, output_layer_name, jde_tracker_name, thresholds);
+    }
+}
+
 void filter(HailoROIPtr roi)
 {
-    person_attributes_postprocess(roi, RESNET_V1_18_PERSON_OUTPUT_LAYER_NAME);
+    person_attributes_single(roi, RESNET_V1_18_PERSON_OUTPUT_LAYER_NAME);
 }
 
 void person_attributes_nv12(HailoROIPtr roi)
 {
-    person_attributes_postprocess(roi, RESNET_V1_18_PERSON_OUTPUT_LAYER_NAME);
+    person_attributes_single(roi, RESNET_V1_18_PERSON_OUTPUT_LAYER_NAME);
 }
 
 void person_attributes_rgba(HailoROIPtr roi)
 {
-    person_attributes_postprocess(roi, "person_attr_resnet_v1_18_rgbx/fc1");
-}
\ No newline at end of file
+    person_attributes_single(roi, RESNET_V1_18_PERSON_RGBA_OUTPUT_LAYER_NAME);
+}
+
+//******************************************************************
+//  BATCH ENTRY POINTS
+//******************************************************************
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    person_attributes_batch(rois, RESNET_V1_18_PERSON_OUTPUT_LAYER_NAME);
+}
+
+void person_attributes_nv12_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    person_attributes_batch(rois, RESNET_V1_18_PERSON_OUTPUT_LAYER_NAME);
+}
+
+void person_attributes_rgba_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    person_attributes_batch(rois, RESNET_V1_18_PERSON_RGBA_OUTPUT_LAYER_NAME);
+}
@@ -10,4 +10,7 @@ __BEGIN_DECLS
 void filter(HailoROIPtr roi);
 void person_attributes_nv12(HailoROIPtr roi);
 void person_attributes_rgba(HailoROIPtr roi);
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
+void person_attributes_nv12_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
+void person_attributes_rgba_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
 __END_DECLS
\ No newline at end of file
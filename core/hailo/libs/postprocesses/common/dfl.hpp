@@ -0,0 +1,301 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file common/dfl.hpp
+ * @brief Decoding kernels for the YOLOv8 family heads (DFL box regression + per anchor scores).
+ *
+ * The kernels work directly on the quantized NHWC tensors: scores are thresholded in the quantized
+ * domain, and the distribution focal loss (softmax expectation over the regression bins) is only
+ * computed for the anchors that pass. exp() of the bins is taken from a per tensor lookup table, since
+ * softmax only depends on the differences of the quantized values.
+ *
+ * Most anchors have no class above the threshold, so the per anchor score scan is the hot loop. It is done
+ * 16 scores at a time (NEON / SSE2, with a plain fallback) and only looks for the best class once an anchor passed.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "hailo_objects.hpp"
+#include "common/quantized_classification.hpp"
+
+namespace common
+{
+    /**
+     * @brief The anchor centers of one output level, in network pixels.
+     *        Anchor j of the level (NHWC order) is at (centers_x[j % width], centers_y[j / width]).
+     */
+    struct DflAnchorGrid
+    {
+        int stride;
+        int width;
+        int height;
+        std::vector<float> centers_x;
+        std::vector<float> centers_y;
+
+        int num_anchors() const { return width * height; }
+        float center_x(int anchor) const { return centers_x[anchor % width]; }
+        float center_y(int anchor) const { return centers_y[anchor / width]; }
+    };
+
+    /**
+     * @brief Build the anchor grid of every stride, once per network.
+     *
+     * @param network_dims  {width, height} of the network input.
+     * @param strides       The stride of every output level.
+     */
+    inline std::vector<DflAnchorGrid> make_dfl_anchor_grids(const std::vector<int> &network_dims, const std::vector<int> &strides)
+    {
+        std::vector<DflAnchorGrid> grids;
+        grids.reserve(strides.size());
+        for (int stride : strides)
+        {
+            DflAnchorGrid grid;
+            grid.stride = stride;
+            grid.width = network_dims[0] / stride;
+            grid.height = network_dims[1] / stride;
+            grid.centers_x.resize(grid.width);
+            grid.centers_y.resize(grid.height);
+            for (int x = 0; x < grid.width; x++)
+                grid.centers_x[x] = (x + 0.5f) * stride;
+            for (int y = 0; y < grid.height; y++)
+                grid.centers_y[y] = (y + 0.5f) * stride;
+            grids.emplace_back(std::move(grid));
+        }
+        return grids;
+    }
+
+    /**
+     * @brief Whether any of the count quantized scores is >= threshold (a quantized_threshold below 256).
+     *        The same as comparing the largest score to the threshold, 16 scores at a time.
+     */
+    inline bool any_score_passes(const uint8_t *scores, int count, int threshold)
+    {
+        if (count <= 0 || threshold > UINT8_MAX)
+            return false;
+        int i = 0;
+#if defined(__aarch64__) && defined(__ARM_NEON)
+        uint8x16_t max_scores = vdupq_n_u8(0);
+        for (; i + 16 <= count; i += 16)
+            max_scores = vmaxq_u8(max_scores, vld1q_u8(scores + i));
+        if (vmaxvq_u8(max_scores) >= threshold)
+            return true;
+#elif defined(__SSE2__)
+        __m128i max_scores = _mm_setzero_si128();
+        for (; i + 16 <= count; i += 16)
+            max_scores = _mm_max_epu8(max_scores, _mm_loadu_si128(reinterpret_cast<const __m128i *>(scores + i)));
+        // A lane is >= threshold iff taking the max with the threshold leaves it unchanged
+        __m128i thresholds = _mm_set1_epi8(static_cast<char>(threshold));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(max_scores, thresholds), max_scores)))
+            return true;
+#endif
+        uint8_t max_score = 0;
+        for (; i < count; i++)
+            max_score = std::max(max_score, scores[i]);
+        return max_score >= threshold;
+    }
+
+    /**
+     * @brief Index of the first of the highest scores.
+     */
+    inline int best_score_index(const uint8_t *scores, int count)
+    {
+        int best = 0;
+        for (int i = 1; i < count; i++)
+        {
+            if (scores[i] > scores[best])
+                best = i;
+        }
+        return best;
+    }
+
+    /**
+     * @brief exp() of the difference between two quantized values of a tensor, indexed by the difference.
+     */
+    class DflExpTable
+    {
+    public:
+        explicit DflExpTable(float qp_scale) : m_qp_scale(qp_scale)
+        {
+            for (int diff = 0; diff < 256; diff++)
+                m_table[diff] = std::exp(-diff * qp_scale);
+        }
+
+        float operator[](int diff) const { return m_table[diff]; }
+        float qp_scale() const { return m_qp_scale; }
+
+    private:
+        float m_qp_scale;
+        float m_table[256];
+    };
+
+    /**
+     * @brief Softmax expectation of one side's distribution: sum(k * softmax(bins)[k]).
+     *
+     * @param bins     regression_length + 1 quantized bins.
+     * @param num_bins regression_length + 1.
+     * @param exp_table exp table of the tensor's qp_scale.
+     */
+    inline float dfl_expectation(const uint8_t *bins, int num_bins, const DflExpTable &exp_table)
+    {
+        uint8_t max_bin = 0;
+        for (int k = 0; k < num_bins; k++)
+            max_bin = std::max(max_bin, bins[k]);
+
+        float sum = 0.0f;
+        float weighted_sum = 0.0f;
+        for (int k = 0; k < num_bins; k++)
+        {
+            float e = exp_table[max_bin - bins[k]];
+            sum += e;
+            weighted_sum += e * k;
+        }
+        return weighted_sum / sum;
+    }
+
+    /**
+     * @brief Decode the box of one anchor from its 4 DFL distributions (left, top, right, bottom).
+     *
+     * @return The box in network pixels, as {xmin, ymin, xmax, ymax}.
+     */
+    inline std::array<float, 4> dfl_decode_box(const uint8_t *anchor_bins, int regression_length,
+                                               const DflExpTable &exp_table, const DflAnchorGrid &grid, int anchor)
+    {
+        int num_bins = regression_length + 1;
+        float left = dfl_expectation(anchor_bins, num_bins, exp_table) * grid.stride;
+        float top = dfl_expectation(anchor_bins + num_bins, num_bins, exp_table) * grid.stride;
+        float right = dfl_expectation(anchor_bins + 2 * num_bins, num_bins, exp_table) * grid.stride;
+        float bottom = dfl_expectation(anchor_bins + 3 * num_bins, num_bins, exp_table) * grid.stride;
+        float center_x = grid.center_x(anchor);
+        float center_y = grid.center_y(anchor);
+        return {center_x - left, center_y - top, center_x + right, center_y + bottom};
+    }
+
+    struct DflCandidate
+    {
+        float xmin, ymin, xmax, ymax; // Network pixels
+        float confidence;
+        int class_id;
+        int level;  // Index of the output level (stride)
+        int anchor; // Index of the anchor in the level
+    };
+
+    /**
+     * @brief Collect the anchors of one level whose best class score passes the threshold, and decode their boxes.
+     *        Works on raw NHWC buffers, so scores and boxes may be separate tensors or parts of the same one.
+     *
+     * @param score_data  Quantized class scores of the first anchor, num_classes consecutive values per anchor.
+     * @param score_pitch Distance between the scores of consecutive anchors.
+     * @param threshold   quantized_threshold of the score threshold.
+     * @param box_data    Quantized DFL bins of the first anchor, 4 * (regression_length + 1) consecutive values per anchor.
+     * @param box_pitch   Distance between the bins of consecutive anchors.
+     * @param confidence  Maps the quantized best score of a passing anchor to its confidence.
+     * @param candidates  Output, passing anchors are appended.
+     */
+    template <typename Confidence>
+    inline void dfl_collect_candidates(const uint8_t *score_data, int score_pitch, int num_classes, int threshold,
+                                       const uint8_t *box_data, int box_pitch, const DflExpTable &exp_table,
+                                       const DflAnchorGrid &grid, int level, int num_anchors, int regression_length,
+                                       Confidence confidence, std::vector<DflCandidate> &candidates)
+    {
+        if (threshold > 255)
+            return;
+
+        for (int anchor = 0; anchor < num_anchors; anchor++)
+        {
+            const uint8_t *anchor_scores = score_data + anchor * score_pitch;
+            if (!any_score_passes(anchor_scores, num_classes, threshold))
+                continue;
+
+            int best_class = best_score_index(anchor_scores, num_classes);
+            auto box = dfl_decode_box(box_data + anchor * box_pitch, regression_length, exp_table, grid, anchor);
+            candidates.push_back({box[0], box[1], box[2], box[3], confidence(anchor_scores[best_class]), best_class, level, anchor});
+        }
+    }
+
+    /**
+     * @brief Collect the anchors of one level whose best class score passes the threshold, and decode their boxes.
+     *
+     * @param boxes      Quantized DFL tensor of the level, 4 * (regression_length + 1) features per anchor.
+     * @param scores     Quantized score tensor of the level, num_classes features per anchor (already sigmoided).
+     * @param candidates Output, passing anchors are appended.
+     */
+    inline void dfl_collect_candidates(HailoTensorPtr boxes, HailoTensorPtr scores, const DflAnchorGrid &grid, int level,
+                                       int regression_length, float score_threshold, std::vector<DflCandidate> &candidates)
+    {
+        auto &score_quant = scores->vstream_info().quant_info;
+        int threshold = quantized_threshold(score_threshold, score_quant.qp_scale, score_quant.qp_zp, UINT8_MAX, identity_activation, true);
+        int num_classes = scores->features();
+        int num_anchors = std::min<int>(grid.num_anchors(), scores->width() * scores->height());
+        DflExpTable exp_table(boxes->vstream_info().quant_info.qp_scale);
+
+        dfl_collect_candidates(scores->data(), num_classes, num_classes, threshold,
+                               boxes->data(), boxes->features(), exp_table, grid, level, num_anchors, regression_length,
+                               [&score_quant](uint8_t score) { return (float(score) - score_quant.qp_zp) * score_quant.qp_scale; },
+                               candidates);
+    }
+
+    inline float dfl_candidates_iou(const DflCandidate &a, const DflCandidate &b)
+    {
+        float overlap_width = std::max(std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin), 0.0f);
+        float overlap_height = std::max(std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin), 0.0f);
+        float overlap = overlap_width * overlap_height;
+        float area_a = (a.xmax - a.xmin) * (a.ymax - a.ymin);
+        float area_b = (b.xmax - b.xmin) * (b.ymax - b.ymin);
+        return overlap / (area_a + area_b - overlap);
+    }
+
+    /**
+     * @brief Greedy NMS of the candidates, in descending confidence order. Survivors are written to survivors
+     *        (cleared first) best first, so buffers kept across frames don't allocate.
+     *        Ties keep the collection order (level, then anchor).
+     */
+    inline void dfl_nms(std::vector<DflCandidate> &candidates, float iou_threshold, bool cross_classes,
+                        std::vector<DflCandidate> &survivors)
+    {
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const DflCandidate &a, const DflCandidate &b)
+                  {
+                      if (a.confidence != b.confidence)
+                          return a.confidence > b.confidence;
+                      return a.level != b.level ? a.level < b.level : a.anchor < b.anchor;
+                  });
+        survivors.clear();
+        for (const DflCandidate &candidate : candidates)
+        {
+            bool suppressed = false;
+            for (const DflCandidate &survivor : survivors)
+            {
+                if ((cross_classes || survivor.class_id == candidate.class_id) && dfl_candidates_iou(survivor, candidate) >= iou_threshold)
+                {
+                    suppressed = true;
+                    break;
+                }
+            }
+            if (!suppressed)
+                survivors.push_back(candidate);
+        }
+    }
+
+    /**
+     * @brief Greedy NMS of the candidates, in descending confidence order. Survivors are returned best first.
+     */
+    inline std::vector<DflCandidate> dfl_nms(std::vector<DflCandidate> &candidates, float iou_threshold, bool cross_classes)
+    {
+        std::vector<DflCandidate> survivors;
+        dfl_nms(candidates, iou_threshold, cross_classes, survivors);
+        return survivors;
+    }
+}
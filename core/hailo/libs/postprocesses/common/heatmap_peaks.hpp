@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file common/heatmap_peaks.hpp
+ * @brief Peak extraction for keypoint / center heatmaps (centerpose, mspn).
+ *
+ * A single pass over one channel of the (usually still quantized) heatmap applies a 3x3 max-pool NMS
+ * and keeps the k best cells in a fixed size heap, so no copy, transpose or sort of the whole heatmap
+ * is ever made. The features that belong to the peaks are then read directly at the peak cells.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "hailo_objects.hpp"
+
+namespace common
+{
+    /**
+     * @brief A strided view of one heatmap channel.
+     *        For an NHWC tensor: data = tensor data + channel, x_stride = features.
+     *        For a CHW plane: data = plane data, x_stride = 1.
+     */
+    template <typename T>
+    struct HeatmapPlane
+    {
+        const T *data;
+        int width;
+        int height;
+        int x_stride;
+
+        T at(int x, int y) const { return data[(y * width + x) * x_stride]; }
+    };
+
+    template <typename T>
+    HeatmapPlane<T> heatmap_plane(HailoTensorPtr tensor, int channel)
+    {
+        return {reinterpret_cast<const T *>(tensor->data()) + channel, (int)tensor->width(), (int)tensor->height(), (int)tensor->features()};
+    }
+
+    struct HeatmapPeak
+    {
+        int cell; // y * width + x, the index of the cell in the channel
+        int x;
+        int y;
+        float value; // As stored in the heatmap (quantized, if the heatmap is)
+    };
+
+    /**
+     * @brief Whether the cell is the maximum of its 3x3 neighbourhood (ties are all kept),
+     *        the same as comparing the heatmap to its 3x3 max-pool.
+     */
+    template <typename T>
+    inline bool heatmap_is_local_max(const HeatmapPlane<T> &plane, int x, int y, T value)
+    {
+        int x_begin = std::max(x - 1, 0), x_end = std::min(x + 1, plane.width - 1);
+        int y_begin = std::max(y - 1, 0), y_end = std::min(y + 1, plane.height - 1);
+        for (int ny = y_begin; ny <= y_end; ny++)
+        {
+            for (int nx = x_begin; nx <= x_end; nx++)
+            {
+                if (plane.at(nx, ny) > value)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Find the k highest cells of a heatmap channel.
+     *
+     * @param plane     The heatmap channel.
+     * @param k         The number of peaks to keep.
+     * @param min_value Cells below this value are ignored (use quantized_threshold for a score threshold).
+     * @param pool_nms  Keep only cells that are the maximum of their 3x3 neighbourhood.
+     * @param peaks     Output, cleared. Holds at most k peaks sorted by descending value, equal values
+     *                  by ascending cell. The capacity is kept, so a reused vector doesn't allocate.
+     */
+    template <typename T>
+    void heatmap_top_k(const HeatmapPlane<T> &plane, int k, float min_value, bool pool_nms, std::vector<HeatmapPeak> &peaks)
+    {
+        peaks.clear();
+        if (k <= 0)
+            return;
+        peaks.reserve(k);
+
+        // Min-heap on (value, -cell): the top is the peak the next better cell replaces
+        auto worse = [](const HeatmapPeak &a, const HeatmapPeak &b)
+        { return a.value > b.value || (a.value == b.value && a.cell < b.cell); };
+
+        for (int y = 0; y < plane.height; y++)
+        {
+            const T *row = plane.data + y * plane.width * plane.x_stride;
+            for (int x = 0; x < plane.width; x++)
+            {
+                T value = row[x * plane.x_stride];
+                if (value < min_value)
+                    continue;
+                // Cells are visited in ascending order, so an equal value never replaces a kept peak
+                bool full = (int)peaks.size() == k;
+                if (full && value <= peaks.front().value)
+                    continue;
+                if (pool_nms && !heatmap_is_local_max(plane, x, y, value))
+                    continue;
+
+                if (full)
+                {
+                    std::pop_heap(peaks.begin(), peaks.end(), worse);
+                    peaks.pop_back();
+                }
+                peaks.push_back({y * plane.width + x, x, y, float(value)});
+                std::push_heap(peaks.begin(), peaks.end(), worse);
+            }
+        }
+        std::sort_heap(peaks.begin(), peaks.end(), worse);
+    }
+
+    /**
+     * @brief Dequantized value of one feature of a tensor (uint8) at a heatmap cell.
+     */
+    inline float gather_feature(HailoTensorPtr tensor, int cell, int feature)
+    {
+        return tensor->fix_scale(tensor->data()[cell * tensor->features() + feature]);
+    }
+}
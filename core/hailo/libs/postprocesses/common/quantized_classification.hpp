@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file common/quantized_classification.hpp
+ * @brief Classification kernels (argmax, top-k, softmax, activation thresholds) that run on the quantized tensor.
+ *
+ * Dequantization is monotonic (qp_scale > 0), so which scores win and which pass a threshold can be decided
+ * on the uint8 / uint16 values themselves. Only the winners are ever converted to floats. Nothing here
+ * allocates, so the kernels can run for every crop of a frame.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "hailo_objects.hpp"
+
+namespace common
+{
+    /**
+     * @brief The quantized scores of a classification head, score i is data[i * stride].
+     */
+    template <typename T>
+    struct QuantizedScores
+    {
+        const T *data;
+        int count;
+        int stride;
+        float qp_scale;
+        float qp_zp;
+
+        T at(int index) const { return data[index * stride]; }
+        float dequantize(int index) const { return (float(at(index)) - qp_zp) * qp_scale; }
+        static constexpr int max_value() { return (1 << (8 * sizeof(T))) - 1; }
+    };
+
+    /**
+     * @brief All the values of a tensor as one score vector (e.g. a 1x1xN classification output).
+     */
+    template <typename T>
+    inline QuantizedScores<T> quantized_scores(HailoTensorPtr tensor)
+    {
+        auto &quant_info = tensor->vstream_info().quant_info;
+        return {reinterpret_cast<const T *>(tensor->data()), (int)tensor->size(), 1, quant_info.qp_scale, quant_info.qp_zp};
+    }
+
+    /**
+     * @brief Call func with the scores of the tensor, typed by the tensor's format (uint16 or uint8).
+     */
+    template <typename Func>
+    inline auto visit_quantized_scores(HailoTensorPtr tensor, Func func)
+    {
+        if (tensor->vstream_info().format.type == HAILO_FORMAT_TYPE_UINT16)
+            return func(quantized_scores<uint16_t>(tensor));
+        return func(quantized_scores<uint8_t>(tensor));
+    }
+
+    /**
+     * @brief Index of the first of the highest scores, -1 if there are none.
+     */
+    template <typename T>
+    inline int quantized_argmax(const QuantizedScores<T> &scores)
+    {
+        if (scores.count <= 0)
+            return -1;
+        int best = 0;
+        T best_value = scores.at(0);
+        for (int i = 1; i < scores.count; i++)
+        {
+            if (scores.at(i) > best_value)
+            {
+                best = i;
+                best_value = scores.at(i);
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @brief Argmax of every group of group_size consecutive scores (e.g. a [classes, 2] head of binary attributes).
+     *
+     * @param winners Output, count / group_size entries: the index of the first of the highest scores inside each group.
+     */
+    template <typename T>
+    inline void quantized_grouped_argmax(const QuantizedScores<T> &scores, int group_size, int *winners)
+    {
+        for (int group = 0; group < scores.count / group_size; group++)
+        {
+            int first = group * group_size;
+            int best = 0;
+            for (int i = 1; i < group_size; i++)
+            {
+                if (scores.at(first + i) > scores.at(first + best))
+                    best = i;
+            }
+            winners[group] = best;
+        }
+    }
+
+    /**
+     * @brief The k highest scores, without sorting or copying the scores.
+     *
+     * @param indices Output, room for k indices. Filled by descending score, equal scores by ascending index.
+     * @return The number of indices written, min(k, count).
+     */
+    template <typename T>
+    inline int quantized_top_k(const QuantizedScores<T> &scores, int k, int *indices)
+    {
+        int found = 0;
+        k = std::min(k, scores.count);
+        for (int i = 0; i < scores.count && k > 0; i++)
+        {
+            T value = scores.at(i);
+            if (found == k && value <= scores.at(indices[k - 1]))
+                continue;
+            // Insertion into the (short) sorted prefix, later equal scores go after the earlier ones
+            int position = (found < k) ? found++ : k - 1;
+            while (position > 0 && scores.at(indices[position - 1]) < value)
+            {
+                indices[position] = indices[position - 1];
+                position--;
+            }
+            indices[position] = i;
+        }
+        return found;
+    }
+
+    /**
+     * @brief softmax(dequantized scores)[index], for heads whose softmax isn't part of the network.
+     *        Only the differences to the highest score matter, so the exponents never overflow.
+     *        For uint8 scores exp() is taken once per distinct value.
+     */
+    template <typename T>
+    inline float quantized_softmax(const QuantizedScores<T> &scores, int index)
+    {
+        int best = quantized_argmax(scores);
+        if (best < 0)
+            return 0.0f;
+        int max_value = scores.at(best);
+        double sum = 0.0;
+        if (sizeof(T) == 1)
+        {
+            uint32_t histogram[256] = {0};
+            for (int i = 0; i < scores.count; i++)
+                histogram[scores.at(i)]++;
+            for (int q = 0; q <= max_value; q++)
+            {
+                if (histogram[q])
+                    sum += histogram[q] * std::exp((q - max_value) * scores.qp_scale);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < scores.count; i++)
+                sum += std::exp((int(scores.at(i)) - max_value) * scores.qp_scale);
+        }
+        return float(std::exp((int(scores.at(index)) - max_value) * scores.qp_scale) / sum);
+    }
+
+    // The logistic function, evaluated as common::sigmoid does
+    inline float sigmoid_activation(float value)
+    {
+        return 1.0f / (1.0f + std::exp(-1.0 * value));
+    }
+
+    inline float identity_activation(float value)
+    {
+        return value;
+    }
+
+    /**
+     * @brief The smallest quantized value q for which activation(dequantize(q)) > threshold (>= threshold if inclusive),
+     *        max_value + 1 if there is none. Comparing q >= result is exactly equivalent to comparing the activated float
+     *        to the threshold, as long as the activation is non decreasing (a binary search over the quantized range).
+     *        The dequantization and the activation are evaluated the way the float paths evaluate them.
+     */
+    template <typename Activation>
+    inline int quantized_threshold(float threshold, float qp_scale, float qp_zp, int max_value, Activation activation,
+                                   bool inclusive = false)
+    {
+        int low = 0;
+        int high = max_value + 1;
+        while (low < high)
+        {
+            int middle = low + (high - low) / 2;
+            float value = activation((float(middle) - qp_zp) * qp_scale);
+            if (inclusive ? value >= threshold : value > threshold)
+                high = middle;
+            else
+                low = middle + 1;
+        }
+        return low;
+    }
+
+    /**
+     * @brief Caches the quantized threshold of the last quantization it was asked for.
+     *        A head keeps the same quantization across crops, so the search runs once per head
+     *        instead of once per crop.
+     */
+    template <typename Activation>
+    class QuantizedThresholdCache
+    {
+    public:
+        QuantizedThresholdCache(float threshold, Activation activation) : m_threshold(threshold), m_activation(activation) {}
+
+        template <typename T>
+        int get(const QuantizedScores<T> &scores)
+        {
+            int max_value = QuantizedScores<T>::max_value();
+            if (scores.qp_scale != m_qp_scale || scores.qp_zp != m_qp_zp || max_value != m_max_value)
+            {
+                m_qp_scale = scores.qp_scale;
+                m_qp_zp = scores.qp_zp;
+                m_max_value = max_value;
+                m_quantized = quantized_threshold(m_threshold, m_qp_scale, m_qp_zp, m_max_value, m_activation);
+            }
+            return m_quantized;
+        }
+
+    private:
+        float m_threshold;
+        Activation m_activation;
+        float m_qp_scale = NAN;
+        float m_qp_zp = NAN;
+        int m_max_value = -1;
+        int m_quantized = 0;
+    };
+}
@@ -20,7 +20,7 @@ class HailoNMSDecode
 {
 private:
     HailoTensorPtr _nms_output_tensor;
-    std::map<uint8_t, std::string> labels_dict;
+    const std::map<uint8_t, std::string> &labels_dict; // Not copied, may be shared by several filters
     float _detection_thr;
     uint _max_boxes;
     bool _filter_by_score;
@@ -39,7 +39,8 @@ private:
         return dequant_bbox;
     }
 
-    void parse_bbox_to_detection_object(auto dequant_bbox, uint32_t class_index, std::vector<HailoDetection> &_objects)
+    template <typename Emit>
+    void parse_bbox_to_detection_object(auto dequant_bbox, uint32_t class_index, Emit &emit)
     {
         float confidence = CLAMP(dequant_bbox.score, 0.0f, 1.0f);
         // filter score by detection threshold if needed.
@@ -48,8 +49,59 @@ private:
             float32_t w, h = 0.0f;
             // parse width and height of the box
             std::tie(w, h) = get_shape(&dequant_bbox);
-            // create new detection object and add it to the vector of detections
-            _objects.push_back(HailoDetection(HailoBBox(dequant_bbox.x_min, dequant_bbox.y_min, w, h), class_index, labels_dict[class_index], confidence));
+            // hand the new detection to the caller's container
+            auto label = labels_dict.find(class_index);
+            emit(HailoBBox(dequant_bbox.x_min, dequant_bbox.y_min, w, h), class_index,
+                 label != labels_dict.end() ? label->second : empty_label(), confidence);
+        }
+    }
+
+    static const std::string &empty_label()
+    {
+        static const std::string empty;
+        return empty;
+    }
+
+    /**
+     * @brief Walk the nms buffer (see decode() for the layout), calling emit for every detection that passes.
+     */
+    template <typename T, typename BBoxType, typename Emit>
+    void for_each_detection(Emit emit)
+    {
+        if (!_nms_output_tensor)
+            return;
+
+        uint32_t max_bboxes_per_class = _vstream_info.nms_shape.max_bboxes_per_class;
+        uint32_t num_of_classes = _vstream_info.nms_shape.number_of_classes;
+        size_t buffer_offset = 0;
+        uint8_t *buffer = _nms_output_tensor->data();
+        for (size_t class_id = 0; class_id < num_of_classes; class_id++)
+        {
+            float32_t bbox_count = 0;
+            memcpy(&bbox_count, buffer + buffer_offset, sizeof(bbox_count));
+            buffer_offset += sizeof(bbox_count);
+
+            if (bbox_count == 0) // No detections
+                continue;
+            if (bbox_count > max_bboxes_per_class)
+                throw std::runtime_error("Runtime error - Got more than the maximum bboxes per class in the nms buffer");
+
+            for (size_t bbox_index = 0; bbox_index < static_cast<uint32_t>(bbox_count); bbox_index++)
+            {
+                if (std::is_same<T, uint16_t>::value)
+                {
+                    // output type (T) is uint16, so we need to do dequantization before parsing
+                    hailo_bbox_float32_t *bbox = (hailo_bbox_float32_t *)(&buffer[buffer_offset]);
+                    parse_bbox_to_detection_object(*bbox, class_id + 1, emit);
+                    buffer_offset += sizeof(hailo_bbox_float32_t);
+                }
+                else
+                {
+                    BBoxType *bbox_struct = (BBoxType *)(&buffer[buffer_offset]);
+                    parse_bbox_to_detection_object(*bbox_struct, class_id + 1, emit);
+                    buffer_offset += sizeof(BBoxType);
+                }
+            }
         }
     }
 
@@ -61,7 +113,7 @@ private:
     }
 
 public:
-    HailoNMSDecode(HailoTensorPtr tensor, std::map<uint8_t, std::string> &labels_dict, float detection_thr = DEFAULT_THRESHOLD, uint max_boxes = DEFAULT_MAX_BOXES, bool filter_by_score = false)
+    HailoNMSDecode(HailoTensorPtr tensor, const std::map<uint8_t, std::string> &labels_dict, float detection_thr = DEFAULT_THRESHOLD, uint max_boxes = DEFAULT_MAX_BOXES, bool filter_by_score = false)
         : _nms_output_tensor(tensor), labels_dict(labels_dict), _detection_thr(detection_thr), _max_boxes(max_boxes), _filter_by_score(filter_by_score), _vstream_info(tensor->vstream_info())
     {
         // making sure that the network's output is indeed an NMS type, by checking the order type value included in the metadata
@@ -104,43 +156,22 @@ public:
         ymin = 0.551805 xmin = 0.389635 ymax = 0.741805 xmax = 0.561974 score = 0.95
         */
 
-        if (!_nms_output_tensor)
-            return std::vector<HailoDetection>{};
-
         std::vector<HailoDetection> _objects;
         _objects.reserve(_max_boxes);
-        uint32_t max_bboxes_per_class = _vstream_info.nms_shape.max_bboxes_per_class;
-        uint32_t num_of_classes = _vstream_info.nms_shape.number_of_classes;
-        size_t buffer_offset = 0;
-        uint8_t *buffer = _nms_output_tensor->data();
-        for (size_t class_id = 0; class_id < num_of_classes; class_id++)
-        {
-            float32_t bbox_count = 0;
-            memcpy(&bbox_count, buffer + buffer_offset, sizeof(bbox_count));
-            buffer_offset += sizeof(bbox_count);
-
-            if (bbox_count == 0) // No detections
-                continue;
-            if (bbox_count > max_bboxes_per_class)
-                throw std::runtime_error("Runtime error - Got more than the maximum bboxes per class in the nms buffer");
-
-            for (size_t bbox_index = 0; bbox_index < static_cast<uint32_t>(bbox_count); bbox_index++)
-            {
-                if (std::is_same<T, uint16_t>::value)
-                {
-                    // output type (T) is uint16, so we need to do dequantization before parsing
-                    hailo_bbox_float32_t *bbox = (hailo_bbox_float32_t *)(&buffer[buffer_offset]);
-                    parse_bbox_to_detection_object(*bbox, class_id + 1, _objects);
-                    buffer_offset += sizeof(hailo_bbox_float32_t);
-                }
-                else
-                {
-                    BBoxType *bbox_struct = (BBoxType *)(&buffer[buffer_offset]);
-                    parse_bbox_to_detection_object(*bbox_struct, class_id + 1, _objects);
-                    buffer_offset += sizeof(BBoxType);
-                }
-            }
-        }
+        for_each_detection<T, BBoxType>([&_objects](const HailoBBox &bbox, int class_id, const std::string &label, float confidence)
+                                        { _objects.emplace_back(bbox, class_id, label, confidence); });
         return _objects;
     }
+
+    /**
+     * @brief Decode the nms buffer straight into detection objects appended to objects,
+     *        so a caller that keeps the vector across frames can attach them with HailoROI::add_objects
+     *        without any intermediate copy.
+     */
+    template <typename T, typename BBoxType>
+    void decode(std::vector<HailoObjectPtr> &objects)
+    {
+        for_each_detection<T, BBoxType>([&objects](const HailoBBox &bbox, int class_id, const std::string &label, float confidence)
+                                        { objects.emplace_back(std::make_shared<HailoDetection>(bbox, class_id, label, confidence)); });
+    }
 };
@@ -11,16 +11,20 @@ static const std::string DEFAULT_SSD_MERGED_OUTPUT_LAYER = "ssd_mobilenet_v1_no_
 static const std::string DEFAULT_SSD_VISDRONE_OUTPUT_LAYER = "ssd_mobilenet_v1_visdrone/nms1";
 
 
-static void mobilenet_ssd_base(HailoROIPtr roi, const std::string output_layer, std::map<uint8_t, std::string> &labels_dict)
+static void mobilenet_ssd_base(HailoROIPtr roi, const std::string &output_layer, std::map<uint8_t, std::string> &labels_dict)
 {
     if (!roi->has_tensors())
     {
         return;
     }
 
+    // The boxes, scores and NMS are computed on the device, only the surviving boxes are parsed here.
+    // They are created directly as the objects attached to the roi, in a buffer kept by every thread.
+    thread_local std::vector<HailoObjectPtr> detections;
     auto post = HailoNMSDecode(roi->get_tensor(output_layer), labels_dict);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    hailo_common::add_detections(roi, detections);
+    post.decode<float32_t, common::hailo_bbox_float32_t>(detections);
+    roi->add_objects(detections);
+    detections.clear();
 }
 
 void mobilenet_ssd(HailoROIPtr roi)
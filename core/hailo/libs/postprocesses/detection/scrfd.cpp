@@ -30,29 +30,25 @@
 #define SCRFD_HEIGHT (640)
 
 
-std::vector<std::string> BOXES_10g {"scrfd_10g/conv48",
-                                    "scrfd_10g/conv54",
-                                    "scrfd_10g/conv57"};
-std::vector<std::string> CLASSES_10g {"scrfd_10g/conv47",
-                                      "scrfd_10g/conv53",
-                                      "scrfd_10g/conv56"};
-std::vector<std::string> LANDMARKS_10g {"scrfd_10g/conv49",
-                                        "scrfd_10g/conv55",
-                                        "scrfd_10g/conv58"};
-
-std::vector<std::string> BOXES_2_5g {"scrfd_2_5g/conv47",
-                                     "scrfd_2_5g/conv53",
-                                     "scrfd_2_5g/conv56"};
-std::vector<std::string> CLASSES_2_5g {"scrfd_2_5g/conv46",
-                                       "scrfd_2_5g/conv52",
-                                       "scrfd_2_5g/conv55"};
-std::vector<std::string> LANDMARKS_2_5g {"scrfd_2_5g/conv48",
-                                         "scrfd_2_5g/conv54",
-                                         "scrfd_2_5g/conv57"};
-
-std::vector<std::string> BOXES;
-std::vector<std::string> CLASSES;
-std::vector<std::string> LANDMARKS;
+static const ScrfdLayers SCRFD_10G_LAYERS {{"scrfd_10g/conv48",
+                                            "scrfd_10g/conv54",
+                                            "scrfd_10g/conv57"},
+                                           {"scrfd_10g/conv47",
+                                            "scrfd_10g/conv53",
+                                            "scrfd_10g/conv56"},
+                                           {"scrfd_10g/conv49",
+                                            "scrfd_10g/conv55",
+                                            "scrfd_10g/conv58"}};
+
+static const ScrfdLayers SCRFD_2_5G_LAYERS {{"scrfd_2_5g/conv47",
+                                             "scrfd_2_5g/conv53",
+                                             "scrfd_2_5g/conv56"},
+                                            {"scrfd_2_5g/conv46",
+                                             "scrfd_2_5g/conv52",
+                                             "scrfd_2_5g/conv55"},
+                                            {"scrfd_2_5g/conv48",
+                                             "scrfd_2_5g/conv54",
+                                             "scrfd_2_5g/conv57"}};
 
 #if __GNUC__ > 8
 #include <filesystem>
@@ -200,6 +196,8 @@ ScrfdParams *init(const std::string config_path, const std::string function_name
     anchors = get_anchors_scrfd(anchor_min_size, anchor_steps, image_width, image_height);
     // Using the anchors, create a multiplier that will be used against the tensor results.
     ScrfdParams *params = new ScrfdParams(anchors, anchor_variance, anchor_min_size, score_threshold, iou_threshold, num_branches);
+    // Every filter instance keeps the layers of the network its function decodes, filter defaults to scrfd_10g
+    params->layers = (function_name.find("2_5g") != std::string::npos) ? SCRFD_2_5G_LAYERS : SCRFD_10G_LAYERS;
     return params;
 }
 
@@ -286,6 +284,7 @@ xt::xarray<float> decode_boxes_scrfd(const xt::xarray<float> &box_detections,
 }
 
 std::tuple<xt::xarray<float>, xt::xarray<float>, xt::xarray<float>> detect_decode_branch(std::map<std::string, HailoTensorPtr> &tensors,
+                                                                                        const ScrfdLayers &layers,
                                                                                         const xt::xarray<uint8_t> &boxes_quant,
                                                                                         const xt::xarray<uint8_t> &classes_quant,
                                                                                         const xt::xarray<uint8_t> &landmarks_quant,
@@ -296,7 +295,7 @@ std::tuple<xt::xarray<float>, xt::xarray<float>, xt::xarray<float>> detect_decod
 {
     // Filter scores that pass threshold, quantize the score threshold
     auto scores_quant = xt::col(classes_quant, 1);
-    xt::xarray<int> threshold_indices = xt::flatten_indices(xt::argwhere(scores_quant > tensors[CLASSES[i]]->quantize(score_threshold)));
+    xt::xarray<int> threshold_indices = xt::flatten_indices(xt::argwhere(scores_quant > tensors[layers.classes[i]]->quantize(score_threshold)));
     
     if (threshold_indices.shape(0) == 0)
         return xt::xtuple(xt::empty<float>({0}), xt::empty<float>({0}), xt::empty<float>({0}));
@@ -304,18 +303,18 @@ std::tuple<xt::xarray<float>, xt::xarray<float>, xt::xarray<float>> detect_decod
     // Filter and dequantize boxes
     xt::xarray<uint8_t> high_boxes_quant = xt::view(boxes_quant, xt::keep(threshold_indices), xt::all());
     auto high_boxes_dequant = common::dequantize(high_boxes_quant,
-                                                tensors[BOXES[i]]->vstream_info().quant_info.qp_scale,
-                                                tensors[BOXES[i]]->vstream_info().quant_info.qp_zp);
+                                                tensors[layers.boxes[i]]->vstream_info().quant_info.qp_scale,
+                                                tensors[layers.boxes[i]]->vstream_info().quant_info.qp_zp);
     // Filter and dequantize scores
     xt::xarray<uint8_t> high_scores_quant = xt::view(scores_quant, xt::keep(threshold_indices));
     auto high_scores_dequant = common::dequantize(high_scores_quant,
-                                                tensors[CLASSES[i]]->vstream_info().quant_info.qp_scale,
-                                                tensors[CLASSES[i]]->vstream_info().quant_info.qp_zp);
+                                                tensors[layers.classes[i]]->vstream_info().quant_info.qp_scale,
+                                                tensors[layers.classes[i]]->vstream_info().quant_info.qp_zp);
     // Filter and dequantize landmarks
     xt::xarray<uint8_t> high_landmarks_quant = xt::view(landmarks_quant, xt::keep(threshold_indices), xt::all());
     auto high_landmarks_dequant = common::dequantize(high_landmarks_quant,
-                                                    tensors[LANDMARKS[i]]->vstream_info().quant_info.qp_scale,
-                                                    tensors[LANDMARKS[i]]->vstream_info().quant_info.qp_zp);
+                                                    tensors[layers.landmarks[i]]->vstream_info().quant_info.qp_scale,
+                                                    tensors[layers.landmarks[i]]->vstream_info().quant_info.qp_zp);
     // Filter anchors and use them to decode boxes/landmarks
     auto stepped_inds = threshold_indices + steps;
     auto high_anchors = xt::view(anchors, xt::keep(stepped_inds), xt::all());
@@ -330,20 +329,22 @@ std::tuple<std::vector<xt::xarray<float>>,
             std::vector<xt::xarray<float>>,
             std::vector<xt::xarray<float>>>
 detect_boxes_and_landmarks(std::map<std::string, HailoTensorPtr> &tensors,
+                           const ScrfdLayers &layers,
                            const std::vector<xt::xarray<uint8_t>> &boxes_quant,
                            const std::vector<xt::xarray<uint8_t>> &classes_quant,
                            const std::vector<xt::xarray<uint8_t>> &landmarks_quant,
                            const xt::xarray<float> &anchors,
                            const float score_threshold)
 {
-    std::vector<xt::xarray<float>> high_scores_dequant(CLASSES.size());
-    std::vector<xt::xarray<float>> decoded_boxes(BOXES.size());
-    std::vector<xt::xarray<float>> decoded_landmarks(LANDMARKS.size());
+    std::vector<xt::xarray<float>> high_scores_dequant(layers.classes.size());
+    std::vector<xt::xarray<float>> decoded_boxes(layers.boxes.size());
+    std::vector<xt::xarray<float>> decoded_landmarks(layers.landmarks.size());
 
     int steps = 0;
-    for (uint i = 0; i < CLASSES.size(); ++i)
+    for (uint i = 0; i < layers.classes.size(); ++i)
     {
         auto boxes_scores_landmarks = detect_decode_branch(tensors,
+                                                           layers,
                                                            boxes_quant[i],
                                                            classes_quant[i],
                                                            landmarks_quant[i],
@@ -375,7 +376,7 @@ void encode_detections(std::vector<HailoDetection> &objects,
     // There is only 1 class in this network (face) so there is no need for label.
     std::string label = "face";
     // Iterate over our results
-    for (uint i = 0; i < CLASSES.size(); ++i)
+    for (uint i = 0; i < scores.size(); ++i)
     {
         for (uint index = 0; index < scores[i].size(); ++index)
         {
@@ -402,6 +403,7 @@ void encode_detections(std::vector<HailoDetection> &objects,
 }
 
 std::vector<HailoDetection> face_detection_postprocess(std::map<std::string, HailoTensorPtr> &tensors_by_name,
+                                                       const ScrfdLayers &layers,
                                                        const xt::xarray<float> &anchors,
                                                        const float score_threshold,
                                                        const float iou_threshold,
@@ -418,22 +420,22 @@ std::vector<HailoDetection> face_detection_postprocess(std::map<std::string, Hai
     std::vector<xt::xarray<uint8_t>> class_layers_quant;
     std::vector<xt::xarray<uint8_t>> landmarks_layers_quant;
 
-    for (uint i = 0; i < BOXES.size(); ++i)
+    for (uint i = 0; i < layers.boxes.size(); ++i)
     {
         // Extract the boxes
-        xt::xarray<uint8_t> xdata_boxes = common::get_xtensor(tensors_by_name[BOXES[i]]);
+        xt::xarray<uint8_t> xdata_boxes = common::get_xtensor(tensors_by_name[layers.boxes[i]]);
         auto num_boxes = (int)xdata_boxes.shape(0) * (int)xdata_boxes.shape(1) * ((int)xdata_boxes.shape(2) / 4);
         auto xdata_boxes_reshaped = xt::reshape_view(xdata_boxes, {num_boxes, 4}); // Resize to be by the 4 parameters for a box
         box_layers_quant.emplace_back(std::move(xdata_boxes_reshaped));
 
         // Extract the classes
-        xt::xarray<uint8_t> xdata_classes = common::get_xtensor(tensors_by_name[CLASSES[i]]);
+        xt::xarray<uint8_t> xdata_classes = common::get_xtensor(tensors_by_name[layers.classes[i]]);
         auto num_classes = (int)xdata_classes.shape(0) * (int)xdata_classes.shape(1) * ((int)xdata_classes.shape(2) / total_classes);
         auto xdata_classes_reshaped = xt::reshape_view(xdata_classes, {num_classes, total_classes}); // Resize to be by the total_classes available classes
         class_layers_quant.emplace_back(std::move(xdata_classes_reshaped));
 
         // Extract the landmarks
-        xt::xarray<uint8_t> xdata_landmarks = common::get_xtensor(tensors_by_name[LANDMARKS[i]]);
+        xt::xarray<uint8_t> xdata_landmarks = common::get_xtensor(tensors_by_name[layers.landmarks[i]]);
         auto num_landmarks = (int)xdata_landmarks.shape(0) * (int)xdata_landmarks.shape(1) * ((int)xdata_landmarks.shape(2) / 10);
         auto xdata_landmarks_reshaped = xt::reshape_view(xdata_landmarks, {num_landmarks, 10}); // Resize to be by the (x,y) for each of the 5 landmarks (2*5=10)
         landmarks_layers_quant.emplace_back(std::move(xdata_landmarks_reshaped));
@@ -445,6 +447,7 @@ std::vector<HailoDetection> face_detection_postprocess(std::map<std::string, Hai
 
     // Extract boxes and landmarks
     auto boxes_and_landmarks = detect_boxes_and_landmarks(tensors_by_name,
+                                                          layers,
                                                           box_layers_quant,
                                                           class_layers_quant,
                                                           landmarks_layers_quant,
@@ -501,7 +504,7 @@ void scrfd(HailoROIPtr roi, void *params_void_ptr)
     std::map<std::string, HailoTensorPtr> tensors_by_name = roi->get_tensors_by_name();
 
     // Extract the detection objects using the given parameters.
-    std::vector<HailoDetection> detections = face_detection_postprocess(tensors_by_name, params->anchors,
+    std::vector<HailoDetection> detections = face_detection_postprocess(tensors_by_name, params->layers, params->anchors,
                                                                         params->score_threshold, params->iou_threshold,
                                                                         params->num_branches, 1);
 
@@ -512,21 +515,13 @@ void scrfd(HailoROIPtr roi, void *params_void_ptr)
 
 void scrfd_2_5g(HailoROIPtr roi, void *params_void_ptr)
 {
-    ScrfdParams *params = reinterpret_cast<ScrfdParams *>(params_void_ptr);
-    BOXES = BOXES_2_5g;
-    CLASSES = CLASSES_2_5g;
-    LANDMARKS = LANDMARKS_2_5g;
-    scrfd(roi, params);
+    scrfd(roi, params_void_ptr);
 }
 
 
 void scrfd_10g(HailoROIPtr roi, void *params_void_ptr)
 {
-    ScrfdParams *params = reinterpret_cast<ScrfdParams *>(params_void_ptr);
-    BOXES = BOXES_10g;
-    CLASSES = CLASSES_10g;
-    LANDMARKS = LANDMARKS_10g;
-    scrfd(roi, params);
+    scrfd(roi, params_void_ptr);
 }
 
 //******************************************************************
@@ -535,9 +530,26 @@ void scrfd_10g(HailoROIPtr roi, void *params_void_ptr)
 void filter(HailoROIPtr roi, void *params_void_ptr)
 {
     // Default scrfd_10g
-    ScrfdParams *params = reinterpret_cast<ScrfdParams *>(params_void_ptr);
-    BOXES = BOXES_10g;
-    CLASSES = CLASSES_10g;
-    LANDMARKS = LANDMARKS_10g;
-    scrfd(roi, params);
+    scrfd(roi, params_void_ptr);
+}
+
+//******************************************************************
+//  BATCH ENTRY POINTS
+//******************************************************************
+void scrfd_2_5g_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    for (HailoROIPtr &roi : rois)
+        scrfd(roi, params_void_ptr);
+}
+
+void scrfd_10g_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    for (HailoROIPtr &roi : rois)
+        scrfd(roi, params_void_ptr);
+}
+
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    // Default scrfd_10g
+    scrfd_10g_batch(rois, params_void_ptr);
 }
@@ -7,9 +7,18 @@
 #include "hailo_common.hpp"
 #include "xtensor/xarray.hpp"
 
+// The output layer names of one scrfd network
+struct ScrfdLayers
+{
+    std::vector<std::string> boxes;
+    std::vector<std::string> classes;
+    std::vector<std::string> landmarks;
+};
+
 class ScrfdParams
 {
 public:
+    ScrfdLayers layers;
     xt::xarray<float> anchors;
     xt::xarray<float> anchor_variance;
     std::vector<std::vector<int>> anchor_min_size;
@@ -36,6 +45,9 @@ __BEGIN_DECLS
 void scrfd_2_5g(HailoROIPtr roi, void *params_void_ptr);
 void scrfd_10g(HailoROIPtr roi, void *params_void_ptr);
 void filter(HailoROIPtr roi, void *params_void_ptr);
+void scrfd_2_5g_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
+void scrfd_10g_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
 ScrfdParams *init(const std::string config_path, const std::string function_name);
 void free_resources(void *params_void_ptr);
 xt::xarray<float> get_anchors_scrfd(const std::vector<std::vector<int>> &anchor_min_sizes,
@@ -1,4 +1,3 @@
-#include <regex>
 #include <fstream>
 #include <sstream>
 #include <map>
@@ -103,6 +102,12 @@ void free_resources(void *params_void_ptr)
     delete params;
 }
 
+bool postprocess_thread_safe()
+{
+    // The filters only read the params, workers can share them
+    return true;
+}
+
 static std::map<uint8_t, std::string> yolo_vehicles_labels = {
     {0, "unlabeled"},
     {1, "car"}};
@@ -227,7 +232,7 @@ void filter(HailoROIPtr roi, void *params_void_ptr)
     // find the nms tensor
     for (auto tensor : tensors)
     {
-        if (std::regex_search(tensor->name(), std::regex("nms_postprocess"))) 
+        if (tensor->name().find("nms_postprocess") != std::string::npos)
         {
             auto post = HailoNMSDecode(tensor, params->labels, params->detection_threshold, params->max_boxes, params->filter_by_score);
             auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
@@ -235,6 +240,11 @@ void filter(HailoROIPtr roi, void *params_void_ptr)
         }
     }
 }
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    for (HailoROIPtr &roi : rois)
+        filter(roi, params_void_ptr);
+}
 void filter_letterbox(HailoROIPtr roi, void *params_void_ptr)
 {
     filter(roi, params_void_ptr);
@@ -25,8 +25,10 @@ public:
 
 YoloParamsNMS *init(const std::string config_path, const std::string function_name);
 void free_resources(void *params_void_ptr);
+bool postprocess_thread_safe();
 void filter(HailoROIPtr roi, void *params_void_ptr);
 void filter_letterbox(HailoROIPtr roi, void *params_void_ptr);
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
 void yolov5(HailoROIPtr roi);
 void yolov5s_nv12(HailoROIPtr roi);
 void yolov8s(HailoROIPtr roi);
@@ -35,11 +35,18 @@ protected:
     float _iou_thr;
     uint m_image_width;
     uint m_image_height;
-    std::map<uint8_t, std::string> m_dataset;
+    const std::map<uint8_t, std::string> &m_dataset; // Owned by the params, which outlive the decode
+
+    const std::string &label(uint8_t class_id)
+    {
+        static const std::string no_label;
+        auto entry = m_dataset.find(class_id);
+        return entry != m_dataset.end() ? entry->second : no_label;
+    }
 
 public:
     virtual ~YoloPost() = default;
-    YoloPost(std::map<uint8_t, std::string> dataset,
+    YoloPost(const std::map<uint8_t, std::string> &dataset,
              float detection_threshold,
              float iou_threshold,
              uint max_boxes)
@@ -49,6 +56,16 @@ public:
     std::vector<HailoDetection> decode()
     {
         std::vector<HailoDetection> objects;
+        decode(objects);
+        return objects;
+    }
+
+    /**
+     * @brief Decode into objects (cleared first), so a batch can reuse one vector.
+     */
+    void decode(std::vector<HailoDetection> &objects)
+    {
+        objects.clear();
         objects.reserve(_max_boxes);
         for (auto layer : _layers)
         {
@@ -61,8 +78,6 @@ public:
             HailoDetection empty_detection(bbox, "None", 0.0);
             objects.resize(_max_boxes, empty_detection);
         }
-
-        return objects;
     }
 
     uint get_num_classes()
@@ -106,7 +121,7 @@ void YoloPost::extract_boxes(std::shared_ptr<YoloOutputLayer> layer,
                     // Get the top left corner of the object.
                     xmin = (x - (w / 2.0f));
                     ymin = (y - (h / 2.0f));
-                    objects.push_back(HailoDetection(HailoBBox(xmin, ymin, w, h), class_id, m_dataset[class_id], confidence));
+                    objects.push_back(HailoDetection(HailoBBox(xmin, ymin, w, h), class_id, label(class_id), confidence));
                 }
             }
         }
@@ -434,6 +449,36 @@ void filter(HailoROIPtr roi, void *params_void_ptr)
     yolov5(roi, params);
 }
 
+//******************************************************************
+//  BATCH ENTRY POINTS
+//******************************************************************
+template <typename YoloDecoder>
+static void yolo_batch(std::vector<HailoROIPtr> &rois, YoloParams *params)
+{
+    std::vector<HailoDetection> detections;
+    for (HailoROIPtr &roi : rois)
+    {
+        auto post = YoloDecoder(roi, params);
+        post.decode(detections);
+        hailo_common::add_detections(roi, detections);
+    }
+}
+
+void yolov5_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    yolo_batch<Yolov5>(rois, reinterpret_cast<YoloParams *>(params_void_ptr));
+}
+
+void yolox_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    yolo_batch<YoloX>(rois, reinterpret_cast<YoloParams *>(params_void_ptr));
+}
+
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr)
+{
+    yolov5_batch(rois, params_void_ptr);
+}
+
 YoloParams *init(const std::string config_path, const std::string function_name)
 {
     YoloParams *params;
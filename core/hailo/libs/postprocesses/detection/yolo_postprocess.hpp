@@ -85,5 +85,8 @@ void yolov5_personface(HailoROIPtr roi, void *params_void_ptr);
 void yolov5_personface_letterbox(HailoROIPtr roi, void *params_void_ptr);
 void yolov5_no_faces_letterbox(HailoROIPtr roi, void *params_void_ptr);
 void yolov5_adas(HailoROIPtr roi, void *params_void_ptr);
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
+void yolov5_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
+void yolox_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
 
 __END_DECLS
\ No newline at end of file
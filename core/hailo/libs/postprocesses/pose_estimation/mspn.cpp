@@ -5,9 +5,11 @@
 
 **/
 
+#include <limits>
 #include <vector>
 
 #include "mspn.hpp"
+#include "common/heatmap_peaks.hpp"
 #include "common/tensors.hpp"
 #include "json_config.hpp"
 
@@ -81,64 +83,46 @@ void gaussian_blur(xt::xarray<float> &heatmaps, int num_joints, int width, int h
 }
 
 /**
- * @brief Get the max predictions
+ * @brief Find the maximum of every joint heatmap, refine it towards its higher neighbours and resize it to the image
  *
- * @param heatmaps the tensor containing the heatmaps
- * @param num_joints the number of joints of the skeleton
- * @param width the width of the image
- * @param height the height of the image
- * @return xt::xarray<float>
- */
-xt::xarray<float> get_max_predictions(xt::xarray<float> &heatmaps, int num_joints, int width, int height)
-{
-    auto heatmaps_reshape = xt::reshape_view(heatmaps, {num_joints, 3072});
-    auto max_indices = xt::argmax(heatmaps_reshape, 1);
-    auto max_indices_reshape = xt::reshape_view(max_indices, {num_joints, 1});
-    xt::xarray<float> max_vals = xt::amax(heatmaps_reshape, 1);
-    max_vals = xt::where(max_vals > 1.0, 1.0, max_vals); // tappas doesn't allow confidence to be greater than 1
-    auto max_vals_reshape = xt::reshape_view(max_vals, {num_joints, 1});
-    auto preds_ = xt::tile(max_indices_reshape, {1, 2});
-    auto preds_first = xt::view(preds_, xt::all(), 0) % width;
-    xt::view(preds_, xt::all(), 0) = preds_first;
-    auto preds_second_ = xt::view(preds_, xt::all(), 1);
-    auto preds_second = floor(preds_second_ / width);
-    xt::view(preds_, xt::all(), 1) = preds_second;
-    auto preds = xt::where(xt::tile(max_vals_reshape, {1, 2}) > 0.0, preds_, -1);
-    auto preds_with_confidence = xt::hstack(xt::xtuple(preds, max_vals_reshape / 255 + 0.5));
-
-    return preds_with_confidence;
-}
-
-/**
- * @brief calculates the joints and resizes them to the network input size
- *
- * @param heatmaps the tensor containing the heatmaps
- * @param preds the tensor containing the predictions
+ * @param data the heatmaps, quantized NHWC as the network outputs them or blurred CHW
  * @param num_joints the number of joints of the skeleton
  * @param width the width of the image
  * @param height the height of the image
+ * @param x_stride the distance between horizontally adjacent cells of a heatmap
+ * @param channel_stride the distance between the heatmaps of adjacent joints
+ * @param qp_scale qp_scale of the heatmaps (1 if they are dequantized)
+ * @param qp_zp qp_zp of the heatmaps (0 if they are dequantized)
+ * @return std::vector<HailoPoint> the joints
  */
-void calculate_joints_and_resize(xt::xarray<float> &heatmaps, xt::xarray<float> &preds, int num_joints, int width, int height)
+template <typename T>
+std::vector<HailoPoint> decode_joints(const T *data, int num_joints, int width, int height,
+                                      int x_stride, int channel_stride, float qp_scale, float qp_zp)
 {
-    xt::xarray<float> heatmap;
-    int px, py;
-    float diff;
+    std::vector<HailoPoint> points;
+    points.reserve(num_joints);
+    std::vector<common::HeatmapPeak> peaks;
     for (int k = 0; k < num_joints; k++)
     {
-        heatmap = xt::view(heatmaps, k, xt::all(), xt::all());
-        px = (int)preds(k, 0);
-        py = (int)preds(k, 1);
-        if (px < width - 1 && px > 1 && py < height - 1 && py > 1)
+        common::HeatmapPlane<T> heatmap = {data + k * channel_stride, width, height, x_stride};
+        // The first maximum of the heatmap
+        common::heatmap_top_k(heatmap, 1, std::numeric_limits<float>::lowest(), false, peaks);
+        float max_val = std::min((peaks[0].value - qp_zp) * qp_scale, 1.0f); // tappas doesn't allow confidence to be greater than 1
+        float px = (max_val > 0.0) ? peaks[0].x : -1;
+        float py = (max_val > 0.0) ? peaks[0].y : -1;
+
+        // Dequantization is monotonic, so quantized neighbours compare like the dequantized ones
+        int x = (int)px;
+        int y = (int)py;
+        if (x < width - 1 && x > 1 && y < height - 1 && y > 1)
         {
-            diff = heatmap(py, px + 1) - heatmap(py, px - 1);
-            preds(k, 0) += (diff > 0) ? 0.75 : 0.25;
-
-            diff = heatmap(py + 1, px) - heatmap(py - 1, px);
-            preds(k, 0) += (diff > 0) ? 0.75 : 0.25;
+            px += (heatmap.at(x + 1, y) > heatmap.at(x - 1, y)) ? 0.75 : 0.25;
+            // The vertical refinement is applied to x as well, the published results were measured this way
+            px += (heatmap.at(x, y + 1) > heatmap.at(x, y - 1)) ? 0.75 : 0.25;
         }
-        preds(k, 0) = preds(k, 0) / 48;
-        preds(k, 1) = preds(k, 1) / 64;
+        points.emplace_back(px / width, py / height, max_val / 255 + 0.5);
     }
+    return points;
 }
 
 /**
@@ -151,29 +135,26 @@ void calculate_joints_and_resize(xt::xarray<float> &heatmaps, xt::xarray<float>
  */
 void mspn_postprocess(HailoROIPtr roi, const float score_threshold, bool perform_gaussian_blur)
 {
-    std::vector<HailoDetection> objects; // The detection meta we will eventually return
     HailoTensorPtr tensor = roi->get_tensors()[0];
-    auto tensor_xarray = common::get_xtensor_float(tensor);
-    xt::xarray<float> heatmaps = xt::transpose(tensor_xarray, {2, 0, 1});
-    int num_joints = heatmaps.shape()[0];
-    int height = heatmaps.shape()[1];
-    int width = heatmaps.shape()[2];
+    int num_joints = tensor->features();
+    int height = tensor->height();
+    int width = tensor->width();
+    std::vector<HailoPoint> points;
 
     if (perform_gaussian_blur)
     {
+        auto tensor_xarray = common::get_xtensor_float(tensor);
+        xt::xarray<float> heatmaps = xt::transpose(tensor_xarray, {2, 0, 1});
         gaussian_blur(heatmaps, num_joints, width, height);
+        points = decode_joints(heatmaps.data(), num_joints, width, height, 1, width * height, 1.0f, 0.0f);
     }
-
-    xt::xarray<float> preds = get_max_predictions(heatmaps, num_joints, width, height);
-
-    calculate_joints_and_resize(heatmaps, preds, num_joints, width, height);
-
-    std::vector<HailoPoint> points;
-    points.reserve(num_joints);
-    for (int i = 0; i < num_joints; i++)
+    else
     {
-        points.emplace_back(HailoPoint(preds(i, 0), preds(i, 1), preds(i, 2)));
+        // Without the blur the maxima are found on the quantized tensor itself
+        auto &quant_info = tensor->vstream_info().quant_info;
+        points = decode_joints(tensor->data(), num_joints, width, height, num_joints, 1, quant_info.qp_scale, quant_info.qp_zp);
     }
+
     roi->add_object(std::make_shared<HailoLandmarks>("centerpose", points, score_threshold, centerpose_joint_pairs));
 }
 
@@ -22,12 +22,6 @@ struct PairPairs {
     float s2;
 };
 
-struct Triple {
-    std::vector<HailoTensorPtr> boxes;
-    xt::xarray<float> scores;
-    std::vector<HailoTensorPtr> keypoints;
-};
-
 struct Decodings {
     HailoDetection detection_box;
     std::pair<xt::xarray<float>, xt::xarray<float>> keypoints;
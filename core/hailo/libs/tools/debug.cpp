@@ -2,6 +2,7 @@
 * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
 * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
 **/
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <typeinfo>
@@ -10,7 +11,13 @@
 #include <cstdlib>
 #include <unistd.h>
 #include <random>
+#include <atomic>
+#include <mutex>
 #include "debug.hpp"
+#include "hailo_tracker.hpp"
+#include "track_state_store.hpp"
+#include "replay/tensor_recording.hpp"
+#include "replay/track_recording.hpp"
 
 #include "xtensor/xadapt.hpp"
 #include "xtensor/xarray.hpp"
@@ -212,6 +219,64 @@ void dump_tensors_to_npy(HailoROIPtr roi)
 
 }
 
+// Record the tensors of every frame for postprocess_replay
+// The recording is written to $HAILO_REPLAY_RECORDING_DIR, or to ./tensor_recording
+std::atomic<size_t> replay_frame_count(0);
+std::once_flag replay_infos_written;
+void dump_tensors_for_replay(HailoROIPtr roi)
+{
+    const char *env_directory = std::getenv("HAILO_REPLAY_RECORDING_DIR");
+    std::string directory = env_directory ? env_directory : "tensor_recording";
+    std::call_once(replay_infos_written, [&]() { replay::write_vstream_infos(directory, roi->get_tensors()); });
+    replay::record_frame(directory, replay_frame_count++, roi);
+}
+
+// Record the tracks of every frame, and the identities reported for them, for recognition_policy_replay
+// Place after hailogallery, the recording is written to $HAILO_TRACK_RECORDING_FILE, or to ./track_recording.csv
+std::mutex track_recording_mutex;
+std::ofstream track_recording;
+std::map<std::string, size_t> track_recording_frames;
+TrackStateStore<uint64_t> track_recording_reports; // Identity reports already recorded for every track
+void dump_tracks_for_replay(HailoROIPtr roi)
+{
+    std::lock_guard<std::mutex> lock(track_recording_mutex);
+    if (!track_recording.is_open())
+    {
+        const char *env_file = std::getenv("HAILO_TRACK_RECORDING_FILE");
+        track_recording.open(env_file ? env_file : "track_recording.csv");
+        track_recording << TRACK_RECORDING_HEADER << std::endl;
+    }
+    const std::string &stream_id = roi->get_stream_id();
+    size_t frame = track_recording_frames[stream_id]++;
+    for (HailoDetectionPtr &detection : hailo_common::get_hailo_detections(roi))
+    {
+        auto track_ids = hailo_common::get_hailo_track_id(detection);
+        if (track_ids.empty())
+            continue;
+        int track_id = std::dynamic_pointer_cast<HailoUniqueID>(track_ids[0])->get_id();
+        replay::TrackSample sample = {frame, stream_id, track_id, detection->get_bbox(), detection->get_confidence(), -1, 0.0f, 0.0f};
+
+        // Only a report that is new since the last frame is an answer about this frame
+        TrackIdentity identity;
+        if (HailoTracker::GetInstance().get_track_identity(stream_id, track_id, identity))
+        {
+            bool new_report = track_recording_reports.update(stream_id, track_id, [&identity](uint64_t &reports) {
+                bool changed = reports != identity.reports;
+                reports = identity.reports;
+                return changed;
+            });
+            if (new_report)
+            {
+                sample.global_id = identity.global_id;
+                sample.confidence = identity.confidence;
+                sample.margin = identity.margin;
+            }
+        }
+        track_recording << replay::format_track_sample(sample) << '\n';
+    }
+    track_recording.flush();
+}
+
 // Do Nothing
 void identity(HailoROIPtr roi)
 {
@@ -27,4 +27,6 @@ void generate_center_detection(HailoROIPtr roi);
 void generate_bottom_detection(HailoROIPtr roi);
 void print_roi_bboxs(HailoROIPtr roi);
 void dump_tensors_to_npy(HailoROIPtr roi);
+void dump_tensors_for_replay(HailoROIPtr roi);
+void dump_tracks_for_replay(HailoROIPtr roi);
 __END_DECLS
\ No newline at end of file
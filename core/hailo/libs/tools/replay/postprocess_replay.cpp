@@ -0,0 +1,350 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <dlfcn.h>
+#include <stdexcept>
+#include <thread>
+#include "postprocess_replay.hpp"
+
+#define INIT_FUNC_NAME "init"
+#define FREE_FUNC_NAME "free_resources"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+namespace replay
+{
+    thread_local uint64_t thread_allocation_count = 0;
+
+    PostprocessLibrary::PostprocessLibrary(const std::string &library_path, const std::string &function_name, const std::string &config_path)
+    {
+        m_library = dlopen(library_path.c_str(), RTLD_LAZY);
+        if (!m_library)
+            throw std::runtime_error(std::string("Could not load lib ") + dlerror());
+        // reset errors
+        dlerror();
+
+        auto init_func = (void *(*)(std::string, std::string))dlsym(m_library, INIT_FUNC_NAME);
+        if (init_func == nullptr)
+        {
+            dlerror();
+            m_handler = (void (*)(HailoROIPtr))dlsym(m_library, function_name.c_str());
+        }
+        else
+        {
+            m_params = init_func(config_path, function_name);
+            m_free_params = (void (*)(void *))dlsym(m_library, FREE_FUNC_NAME);
+            m_params_handler = (void (*)(HailoROIPtr, void *))dlsym(m_library, function_name.c_str());
+        }
+
+        const char *dlsym_error = dlerror();
+        if (dlsym_error || (!m_handler && !m_params_handler))
+        {
+            std::string error = std::string("Cannot load symbol ") + function_name + ": " + (dlsym_error ? dlsym_error : "not found");
+            if (m_params && m_free_params)
+                m_free_params(m_params);
+            dlclose(m_library);
+            throw std::runtime_error(error);
+        }
+    }
+
+    PostprocessLibrary::~PostprocessLibrary()
+    {
+        if (m_params && m_free_params)
+            m_free_params(m_params);
+        dlclose(m_library);
+    }
+
+    static inline uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    static inline uint64_t hash_float(uint64_t hash, float value)
+    {
+        return fnv1a(hash, &value, sizeof(value));
+    }
+
+    static inline uint64_t hash_string(uint64_t hash, const std::string &value)
+    {
+        return fnv1a(hash, value.data(), value.size());
+    }
+
+    static inline uint64_t hash_int(uint64_t hash, int64_t value)
+    {
+        return fnv1a(hash, &value, sizeof(value));
+    }
+
+    static uint64_t hash_bbox(uint64_t hash, HailoBBox bbox)
+    {
+        hash = hash_float(hash, bbox.xmin());
+        hash = hash_float(hash, bbox.ymin());
+        hash = hash_float(hash, bbox.width());
+        return hash_float(hash, bbox.height());
+    }
+
+    static uint64_t object_checksum(HailoObjectPtr object);
+
+    static uint64_t sub_objects_checksum(HailoROIPtr roi)
+    {
+        // Summing keeps the checksum independent of the order objects were added in
+        uint64_t sum = 0;
+        for (auto &sub_object : roi->get_objects())
+            sum += object_checksum(sub_object);
+        return sum;
+    }
+
+    static uint64_t object_checksum(HailoObjectPtr object)
+    {
+        uint64_t hash = hash_int(FNV_OFFSET_BASIS, object->get_type());
+        switch (object->get_type())
+        {
+        case HAILO_DETECTION:
+        {
+            HailoDetectionPtr detection = std::dynamic_pointer_cast<HailoDetection>(object);
+            hash = hash_bbox(hash, detection->get_bbox());
+            hash = hash_string(hash, detection->get_label());
+            hash = hash_int(hash, detection->get_class_id());
+            hash = hash_float(hash, detection->get_confidence());
+            hash = hash_int(hash, sub_objects_checksum(detection));
+            break;
+        }
+        case HAILO_CLASSIFICATION:
+        {
+            HailoClassificationPtr classification = std::dynamic_pointer_cast<HailoClassification>(object);
+            hash = hash_string(hash, classification->get_classification_type());
+            hash = hash_string(hash, classification->get_label());
+            hash = hash_int(hash, classification->get_class_id());
+            hash = hash_float(hash, classification->get_confidence());
+            break;
+        }
+        case HAILO_LANDMARKS:
+        {
+            HailoLandmarksPtr landmarks = std::dynamic_pointer_cast<HailoLandmarks>(object);
+            hash = hash_string(hash, landmarks->get_landmarks_type());
+            for (auto &point : landmarks->get_points())
+            {
+                hash = hash_float(hash, point.x());
+                hash = hash_float(hash, point.y());
+                hash = hash_float(hash, point.confidence());
+            }
+            break;
+        }
+        case HAILO_UNIQUE_ID:
+        {
+            HailoUniqueIDPtr unique_id = std::dynamic_pointer_cast<HailoUniqueID>(object);
+            hash = hash_int(hash, unique_id->get_id());
+            hash = hash_int(hash, unique_id->get_mode());
+            break;
+        }
+        case HAILO_MATRIX:
+        {
+            HailoMatrixPtr matrix = std::dynamic_pointer_cast<HailoMatrix>(object);
+            const std::vector<float> &data = matrix->get_data();
+            hash = fnv1a(hash, data.data(), data.size() * sizeof(float));
+            break;
+        }
+        case HAILO_DEPTH_MASK:
+        {
+            HailoDepthMaskPtr mask = std::dynamic_pointer_cast<HailoDepthMask>(object);
+            const std::vector<float> &data = mask->get_data();
+            hash = fnv1a(hash, data.data(), data.size() * sizeof(float));
+            break;
+        }
+        case HAILO_CLASS_MASK:
+        {
+            HailoClassMaskPtr mask = std::dynamic_pointer_cast<HailoClassMask>(object);
+            const std::vector<uint8_t> &data = mask->get_data();
+            hash = fnv1a(hash, data.data(), data.size());
+            break;
+        }
+        case HAILO_CONF_CLASS_MASK:
+        {
+            HailoConfClassMaskPtr mask = std::dynamic_pointer_cast<HailoConfClassMask>(object);
+            const std::vector<float> &data = mask->get_data();
+            hash = fnv1a(hash, data.data(), data.size() * sizeof(float));
+            hash = hash_int(hash, mask->get_class_id());
+            break;
+        }
+        case HAILO_ROI:
+        case HAILO_TILE:
+        {
+            HailoROIPtr roi = std::dynamic_pointer_cast<HailoROI>(object);
+            hash = hash_bbox(hash, roi->get_bbox());
+            hash = hash_int(hash, sub_objects_checksum(roi));
+            break;
+        }
+        default:
+            break;
+        }
+        return hash;
+    }
+
+    uint64_t roi_checksum(HailoROIPtr roi)
+    {
+        return hash_int(FNV_OFFSET_BASIS, sub_objects_checksum(roi));
+    }
+
+    uint64_t ReplayResult::percentile(double p) const
+    {
+        if (latencies_ns.empty())
+            return 0;
+        size_t index = std::lround(p / 100.0 * (latencies_ns.size() - 1));
+        index = std::min(index, latencies_ns.size() - 1);
+        return latencies_ns[index];
+    }
+
+    uint64_t ReplayResult::checksum() const
+    {
+        uint64_t hash = FNV_OFFSET_BASIS;
+        for (uint64_t frame_checksum : frame_checksums)
+            hash = hash_int(hash, frame_checksum);
+        return hash;
+    }
+
+    struct ThreadResult
+    {
+        std::vector<uint64_t> latencies_ns;
+        std::vector<uint64_t> frame_checksums;
+        uint64_t allocations = 0;
+        bool deterministic = true;
+    };
+
+    static void replay_thread(TensorRecording &recording, PostprocessLibrary &library, const ReplayOptions &options, ThreadResult &result)
+    {
+        size_t num_frames = recording.num_frames();
+        for (size_t i = 0; i < options.warmup_frames; i++)
+            library.run(recording.create_roi(i % num_frames));
+
+        result.latencies_ns.reserve(options.iterations * num_frames);
+        result.frame_checksums.resize(num_frames);
+        for (size_t iteration = 0; iteration < options.iterations; iteration++)
+        {
+            for (size_t frame_index = 0; frame_index < num_frames; frame_index++)
+            {
+                HailoROIPtr roi = recording.create_roi(frame_index);
+
+                uint64_t allocations_before = thread_allocation_count;
+                auto start = std::chrono::steady_clock::now();
+                library.run(roi);
+                auto end = std::chrono::steady_clock::now();
+                result.allocations += thread_allocation_count - allocations_before;
+                result.latencies_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+                uint64_t checksum = roi_checksum(roi);
+                if (iteration == 0)
+                    result.frame_checksums[frame_index] = checksum;
+                else if (result.frame_checksums[frame_index] != checksum)
+                    result.deterministic = false;
+            }
+        }
+    }
+
+    ReplayResult run_replay(TensorRecording &recording, PostprocessLibrary &library, const ReplayOptions &options)
+    {
+        size_t num_threads = std::max<size_t>(options.threads, 1);
+        std::vector<ThreadResult> thread_results(num_threads);
+        std::vector<std::thread> threads;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < num_threads; i++)
+            threads.emplace_back(replay_thread, std::ref(recording), std::ref(library), std::cref(options), std::ref(thread_results[i]));
+        for (auto &thread : threads)
+            thread.join();
+        auto end = std::chrono::steady_clock::now();
+
+        ReplayResult result;
+        result.wall_time_s = std::chrono::duration<double>(end - start).count();
+        result.frame_checksums = thread_results[0].frame_checksums;
+        uint64_t allocations = 0;
+        for (auto &thread_result : thread_results)
+        {
+            result.latencies_ns.insert(result.latencies_ns.end(), thread_result.latencies_ns.begin(), thread_result.latencies_ns.end());
+            allocations += thread_result.allocations;
+            if (!thread_result.deterministic || thread_result.frame_checksums != result.frame_checksums)
+                result.deterministic = false;
+        }
+        std::sort(result.latencies_ns.begin(), result.latencies_ns.end());
+        if (!result.latencies_ns.empty())
+            result.allocations_per_frame = (double)allocations / result.latencies_ns.size();
+        return result;
+    }
+
+    static float box_error(HailoBBox a, HailoBBox b)
+    {
+        return std::max({std::fabs(a.xmin() - b.xmin()), std::fabs(a.ymin() - b.ymin()),
+                         std::fabs(a.xmax() - b.xmax()), std::fabs(a.ymax() - b.ymax())});
+    }
+
+    static std::vector<HailoDetectionPtr> roi_detections(HailoROIPtr roi)
+    {
+        std::vector<HailoDetectionPtr> detections;
+        for (auto &object : roi->get_objects_typed(HAILO_DETECTION))
+            detections.emplace_back(std::dynamic_pointer_cast<HailoDetection>(object));
+        return detections;
+    }
+
+    OutputComparison compare_outputs(TensorRecording &recording, PostprocessLibrary &library, PostprocessLibrary &reference,
+                                     float tolerance)
+    {
+        OutputComparison comparison;
+        for (size_t frame_index = 0; frame_index < recording.num_frames(); frame_index++)
+        {
+            HailoROIPtr roi = recording.create_roi(frame_index);
+            HailoROIPtr reference_roi = recording.create_roi(frame_index);
+            library.run(roi);
+            reference.run(reference_roi);
+            std::vector<HailoDetectionPtr> detections = roi_detections(roi);
+            std::vector<HailoDetectionPtr> reference_detections = roi_detections(reference_roi);
+
+            // Greedily pair every reference detection with the closest unpaired detection of the same class
+            std::vector<bool> paired(detections.size(), false);
+            size_t frame_missing = 0;
+            for (auto &expected : reference_detections)
+            {
+                int best = -1;
+                float best_error = 0;
+                for (size_t i = 0; i < detections.size(); i++)
+                {
+                    if (paired[i] || detections[i]->get_class_id() != expected->get_class_id() ||
+                        detections[i]->get_label() != expected->get_label())
+                        continue;
+                    float error = box_error(detections[i]->get_bbox(), expected->get_bbox());
+                    if (best < 0 || error < best_error)
+                    {
+                        best = i;
+                        best_error = error;
+                    }
+                }
+                float confidence_error = best < 0 ? 0 : std::fabs(detections[best]->get_confidence() - expected->get_confidence());
+                if (best < 0 || best_error > tolerance || confidence_error > tolerance)
+                {
+                    frame_missing++;
+                    continue;
+                }
+                paired[best] = true;
+                comparison.matched++;
+                comparison.max_box_error = std::max(comparison.max_box_error, best_error);
+                comparison.max_confidence_error = std::max(comparison.max_confidence_error, confidence_error);
+            }
+            size_t frame_extra = std::count(paired.begin(), paired.end(), false);
+            comparison.missing += frame_missing;
+            comparison.extra += frame_extra;
+            if (frame_missing || frame_extra)
+                comparison.differing_frames++;
+            comparison.frames++;
+        }
+        return comparison;
+    }
+}
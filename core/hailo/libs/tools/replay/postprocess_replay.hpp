@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file replay/postprocess_replay.hpp
+ * @brief Runs a postprocess .so on recorded tensors, without a device or a pipeline.
+ *
+ * The library is loaded the way hailofilter loads it: if it exports init() the function gets the
+ * params it returned, and free_resources() releases them.
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "hailo_objects.hpp"
+#include "tensor_recording.hpp"
+
+namespace replay
+{
+    class PostprocessLibrary
+    {
+    public:
+        /**
+         * @throws std::runtime_error if the library or the function can't be loaded.
+         */
+        PostprocessLibrary(const std::string &library_path, const std::string &function_name, const std::string &config_path);
+        ~PostprocessLibrary();
+        PostprocessLibrary(const PostprocessLibrary &) = delete;
+        PostprocessLibrary &operator=(const PostprocessLibrary &) = delete;
+
+        void run(HailoROIPtr roi)
+        {
+            if (m_params_handler)
+                m_params_handler(roi, m_params);
+            else
+                m_handler(roi);
+        }
+
+    private:
+        void *m_library = nullptr;
+        void *m_params = nullptr;
+        void (*m_handler)(HailoROIPtr) = nullptr;
+        void (*m_params_handler)(HailoROIPtr, void *) = nullptr;
+        void (*m_free_params)(void *) = nullptr;
+    };
+
+    /**
+     * @brief Allocations of the calling thread, incremented by the operator new of the process (if it counts).
+     *        The replay tool replaces the global operator new to count, a library user may do the same.
+     *        Allocations that bypass operator new (malloc, cv::fastMalloc) are not counted.
+     */
+    extern thread_local uint64_t thread_allocation_count;
+
+    /**
+     * @brief Order independent checksum of the objects a postprocess attached to a roi (recursively).
+     *        Floats are hashed bit by bit, so any change in the output changes it.
+     */
+    uint64_t roi_checksum(HailoROIPtr roi);
+
+    struct ReplayOptions
+    {
+        size_t iterations = 1;     // Passes over the whole recording, per thread
+        size_t threads = 1;
+        size_t warmup_frames = 0;  // Calls per thread that are not measured
+    };
+
+    struct ReplayResult
+    {
+        std::vector<uint64_t> latencies_ns; // Every measured call, sorted
+        double allocations_per_frame = 0;
+        std::vector<uint64_t> frame_checksums; // Of the first pass, per frame of the recording
+        bool deterministic = true;             // All passes and threads produced the same checksums
+        double wall_time_s = 0;
+
+        uint64_t percentile(double p) const;
+        uint64_t checksum() const;
+    };
+
+    /**
+     * @brief Run the postprocess on every frame of the recording, in a tight loop on each thread.
+     */
+    ReplayResult run_replay(TensorRecording &recording, PostprocessLibrary &library, const ReplayOptions &options);
+
+    /**
+     * @brief How the detections of a postprocess compare to the detections of a reference implementation.
+     *        Detections are paired per frame by class and label, boxes and confidences may differ by a tolerance
+     *        (a reimplementation rarely reproduces the float results bit by bit).
+     */
+    struct OutputComparison
+    {
+        size_t frames = 0;
+        size_t differing_frames = 0;  // Frames with a missing or an extra detection
+        size_t matched = 0;           // Reference detections with a counterpart within the tolerance
+        size_t missing = 0;           // Reference detections without one
+        size_t extra = 0;             // Detections that only the postprocess produced
+        float max_box_error = 0;      // Largest coordinate difference of a matched pair (normalized)
+        float max_confidence_error = 0;
+    };
+
+    /**
+     * @brief Run both libraries once on every frame of the recording and compare the detections they attach to the roi.
+     */
+    OutputComparison compare_outputs(TensorRecording &recording, PostprocessLibrary &library, PostprocessLibrary &reference,
+                                     float tolerance);
+}
@@ -0,0 +1,215 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <cxxopts/cxxopts.hpp>
+#include "postprocess_replay.hpp"
+
+//******************************************************************
+// ALLOCATION COUNTING
+//******************************************************************
+void *operator new(std::size_t size)
+{
+    replay::thread_allocation_count++;
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+//******************************************************************
+// MAIN
+//******************************************************************
+/**
+ * @brief Build command line arguments.
+ *
+ * @return cxxopts::Options
+ *         The available user arguments.
+ */
+cxxopts::Options build_arg_parser()
+{
+    cxxopts::Options options("postprocess_replay", "Replay recorded tensors through a postprocess .so and benchmark it");
+    options.add_options()
+    ("h,help", "Show this help")
+    ("r,recording", "Recording directory (written by dump_tensors_for_replay of libdebug.so)", cxxopts::value<std::string>())
+    ("s,so-path", "Postprocess .so", cxxopts::value<std::string>())
+    ("f,function-name", "Function to call", cxxopts::value<std::string>()->default_value("filter"))
+    ("c,config-path", "JSON config passed to init()", cxxopts::value<std::string>()->default_value("NULL"))
+    ("t,threads", "Number of threads", cxxopts::value<size_t>()->default_value("1"))
+    ("i,iterations", "Passes over the recording per thread", cxxopts::value<size_t>()->default_value("10"))
+    ("w,warmup", "Unmeasured calls per thread", cxxopts::value<size_t>()->default_value("10"))
+    ("write-checksums", "Write the checksum of every frame to a file", cxxopts::value<std::string>())
+    ("check-checksums", "Compare the checksum of every frame to a file, fail on mismatch", cxxopts::value<std::string>())
+    ("max-p99-us", "Fail if the 99th percentile latency exceeds this (us)", cxxopts::value<double>())
+    ("reference-so", "Also benchmark this .so (e.g. a build of the previous implementation) and compare the outputs, fail if any frame differs", cxxopts::value<std::string>())
+    ("reference-function", "Function of the reference .so (default: --function-name)", cxxopts::value<std::string>())
+    ("reference-config", "JSON config of the reference .so (default: --config-path)", cxxopts::value<std::string>())
+    ("tolerance", "Largest box coordinate / confidence difference to the reference that still matches", cxxopts::value<float>()->default_value("0.001"));
+    return options;
+}
+
+static void print_result(const replay::ReplayResult &result, size_t threads)
+{
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "calls:                 " << result.latencies_ns.size() << " (" << threads << " threads)" << std::endl;
+    std::cout << "throughput:            " << result.latencies_ns.size() / result.wall_time_s << " frames/s" << std::endl;
+    std::cout << "latency us p50/p90/p99/max: "
+              << result.percentile(50) / 1000.0 << " / "
+              << result.percentile(90) / 1000.0 << " / "
+              << result.percentile(99) / 1000.0 << " / "
+              << result.percentile(100) / 1000.0 << std::endl;
+    std::cout << std::setprecision(2);
+    std::cout << "allocations per frame: " << result.allocations_per_frame << std::endl;
+    std::cout << "checksum:              " << std::hex << std::setw(16) << std::setfill('0') << result.checksum() << std::dec << std::setfill(' ') << std::endl;
+    if (!result.deterministic)
+        std::cout << "warning: the output differs between passes or threads" << std::endl;
+}
+
+static void print_comparison(const replay::ReplayResult &result, const replay::ReplayResult &reference_result,
+                             const replay::OutputComparison &comparison)
+{
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "speedup p50/p99:       " << (double)reference_result.percentile(50) / std::max<uint64_t>(result.percentile(50), 1) << "x / "
+              << (double)reference_result.percentile(99) / std::max<uint64_t>(result.percentile(99), 1) << "x" << std::endl;
+    std::cout << "detections matched:    " << comparison.matched << " (missing " << comparison.missing
+              << ", extra " << comparison.extra << ")" << std::endl;
+    std::cout << "differing frames:      " << comparison.differing_frames << " / " << comparison.frames << std::endl;
+    std::cout << std::setprecision(6);
+    std::cout << "max box / conf error:  " << comparison.max_box_error << " / " << comparison.max_confidence_error << std::endl;
+}
+
+static bool check_checksums(const replay::ReplayResult &result, const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Could not open " << path << std::endl;
+        return false;
+    }
+    bool ok = true;
+    size_t frame_index = 0;
+    uint64_t expected;
+    while (file >> std::hex >> expected)
+    {
+        if (frame_index >= result.frame_checksums.size())
+        {
+            std::cerr << path << " has more frames than the recording" << std::endl;
+            return false;
+        }
+        if (result.frame_checksums[frame_index] != expected)
+        {
+            std::cerr << "frame " << frame_index << ": output differs from the reference" << std::endl;
+            ok = false;
+        }
+        frame_index++;
+    }
+    if (frame_index != result.frame_checksums.size())
+    {
+        std::cerr << path << " has " << frame_index << " frames, the recording has " << result.frame_checksums.size() << std::endl;
+        return false;
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    cxxopts::Options options = build_arg_parser();
+    auto result = options.parse(argc, argv);
+    if (result.count("help") || !result.count("recording") || !result.count("so-path"))
+    {
+        std::cout << options.help() << std::endl;
+        return result.count("help") ? 0 : 1;
+    }
+
+    replay::ReplayOptions replay_options;
+    replay_options.threads = result["threads"].as<size_t>();
+    replay_options.iterations = result["iterations"].as<size_t>();
+    replay_options.warmup_frames = result["warmup"].as<size_t>();
+
+    bool compare = result.count("reference-so");
+    replay::ReplayResult replay_result;
+    replay::ReplayResult reference_result;
+    replay::OutputComparison comparison;
+    try
+    {
+        replay::TensorRecording recording(result["recording"].as<std::string>());
+        replay::PostprocessLibrary library(result["so-path"].as<std::string>(),
+                                           result["function-name"].as<std::string>(),
+                                           result["config-path"].as<std::string>());
+        std::cout << "frames in recording:   " << recording.num_frames() << std::endl;
+        replay_result = replay::run_replay(recording, library, replay_options);
+        print_result(replay_result, replay_options.threads);
+
+        if (compare)
+        {
+            std::string reference_function = result.count("reference-function") ? result["reference-function"].as<std::string>()
+                                                                                 : result["function-name"].as<std::string>();
+            std::string reference_config = result.count("reference-config") ? result["reference-config"].as<std::string>()
+                                                                             : result["config-path"].as<std::string>();
+            replay::PostprocessLibrary reference(result["reference-so"].as<std::string>(), reference_function, reference_config);
+            reference_result = replay::run_replay(recording, reference, replay_options);
+            std::cout << std::endl << "reference:" << std::endl;
+            print_result(reference_result, replay_options.threads);
+            comparison = replay::compare_outputs(recording, library, reference, result["tolerance"].as<float>());
+            std::cout << std::endl;
+            print_comparison(replay_result, reference_result, comparison);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    int status = 0;
+    if (compare && comparison.differing_frames)
+    {
+        std::cerr << "the output differs from the reference in " << comparison.differing_frames << " frames" << std::endl;
+        status = 1;
+    }
+    if (result.count("write-checksums"))
+    {
+        std::ofstream file(result["write-checksums"].as<std::string>());
+        for (uint64_t checksum : replay_result.frame_checksums)
+            file << std::hex << std::setw(16) << std::setfill('0') << checksum << std::endl;
+    }
+    if (result.count("check-checksums") && !check_checksums(replay_result, result["check-checksums"].as<std::string>()))
+        status = 1;
+    if (result.count("max-p99-us") && replay_result.percentile(99) / 1000.0 > result["max-p99-us"].as<double>())
+    {
+        std::cerr << "p99 latency exceeds " << result["max-p99-us"].as<double>() << " us" << std::endl;
+        status = 1;
+    }
+    return status;
+}
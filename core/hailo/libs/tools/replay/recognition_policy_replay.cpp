@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <utility>
+#include "recognition_policy_replay.hpp"
+
+namespace replay
+{
+    using TrackKey = std::pair<std::string, int>;
+    using RecognizeFunc = std::function<void(const std::vector<const TrackSample *> &, std::vector<const TrackSample *> &)>;
+
+    // The identity recorded most often for every track
+    static std::map<TrackKey, int> true_identities(const std::vector<TrackSample> &samples)
+    {
+        std::map<TrackKey, std::map<int, size_t>> votes;
+        for (const TrackSample &sample : samples)
+        {
+            if (sample.global_id >= 0)
+                votes[{sample.stream_id, sample.track_id}][sample.global_id]++;
+        }
+        std::map<TrackKey, int> identities;
+        for (auto &track : votes)
+        {
+            auto most = std::max_element(track.second.begin(), track.second.end(), [](const auto &a, const auto &b)
+                                         { return a.second < b.second; });
+            identities[track.first] = most->first;
+        }
+        return identities;
+    }
+
+    /**
+     * @brief Walk the recording frame by frame, recognize chooses which samples of a frame are recognized.
+     *        Counts the recognitions and scores the identity believed for every track on every frame.
+     */
+    static RecognitionReplayStats replay(const std::vector<TrackSample> &samples, double fps, const RecognizeFunc &recognize)
+    {
+        RecognitionReplayStats stats;
+        std::map<TrackKey, int> truth = true_identities(samples);
+        std::map<TrackKey, int> believed;
+        std::map<std::string, std::pair<size_t, size_t>> stream_frames; // First and last frame of every stream
+        std::vector<const TrackSample *> frame_samples;
+        std::vector<const TrackSample *> recognized;
+
+        size_t begin = 0;
+        while (begin < samples.size())
+        {
+            // The samples of one frame of one stream are consecutive
+            size_t end = begin;
+            frame_samples.clear();
+            while (end < samples.size() && samples[end].frame == samples[begin].frame && samples[end].stream_id == samples[begin].stream_id)
+                frame_samples.push_back(&samples[end++]);
+            stats.frames++;
+            auto range = stream_frames.emplace(samples[begin].stream_id, std::make_pair(samples[begin].frame, samples[begin].frame)).first;
+            range->second.first = std::min(range->second.first, samples[begin].frame);
+            range->second.second = std::max(range->second.second, samples[begin].frame);
+
+            recognized.clear();
+            recognize(frame_samples, recognized);
+            stats.crops += recognized.size();
+            for (const TrackSample *sample : recognized)
+            {
+                auto identity = believed.emplace(TrackKey(sample->stream_id, sample->track_id), sample->global_id);
+                if (!identity.second && identity.first->second != sample->global_id)
+                {
+                    stats.identity_switches++;
+                    identity.first->second = sample->global_id;
+                }
+            }
+
+            for (const TrackSample *sample : frame_samples)
+            {
+                TrackKey key(sample->stream_id, sample->track_id);
+                auto identity = believed.find(key);
+                if (identity == believed.end())
+                    continue;
+                stats.identified_track_frames++;
+                auto true_identity = truth.find(key);
+                if (true_identity != truth.end() && true_identity->second != identity->second)
+                    stats.identity_errors++;
+            }
+            begin = end;
+        }
+
+        for (auto &range : stream_frames)
+            stats.seconds = std::max(stats.seconds, (range.second.second - range.second.first + 1) / fps);
+        stats.crops_per_second = stats.seconds > 0.0 ? stats.crops / stats.seconds : 0.0;
+        return stats;
+    }
+
+    RecognitionReplayStats replay_every_frame(const std::vector<TrackSample> &samples, double fps)
+    {
+        return replay(samples, fps, [](const std::vector<const TrackSample *> &frame_samples, std::vector<const TrackSample *> &recognized)
+                      {
+                          for (const TrackSample *sample : frame_samples)
+                          {
+                              if (sample->global_id >= 0)
+                                  recognized.push_back(sample);
+                          }
+                      });
+    }
+
+    RecognitionReplayStats replay_recognition_policy(const std::vector<TrackSample> &samples, const RecognitionPolicyParams &params,
+                                                     uint max_crops, double fps)
+    {
+        // Identities are reported to the HailoTracker instance, every replay gets its own streams there
+        static std::atomic<int> replay_count(0);
+        std::string stream_prefix = "replay_" + std::to_string(replay_count++) + "/";
+
+        RecognitionPolicy policy(params);
+        policy.set_max_crops(max_crops);
+        std::vector<RecognitionCandidate> candidates;
+        std::vector<HailoROIPtr> crops;
+        std::map<int, const TrackSample *> eligible;
+        std::map<std::string, size_t> last_frames;
+
+        return replay(samples, fps, [&](const std::vector<const TrackSample *> &frame_samples, std::vector<const TrackSample *> &recognized)
+                      {
+                          std::string stream_id = stream_prefix + frame_samples.front()->stream_id;
+                          // Frames without tracks aren't recorded, the policy still counts them
+                          size_t frame = frame_samples.front()->frame;
+                          auto last_frame = last_frames.find(stream_id);
+                          size_t new_frames = (last_frame == last_frames.end()) ? 1 : frame - last_frame->second;
+                          for (size_t i = 0; i < new_frames; i++)
+                              policy.new_frame(stream_id);
+                          last_frames[stream_id] = frame;
+                          candidates.clear();
+                          crops.clear();
+                          eligible.clear();
+                          // Only the samples the recording has an answer for passed the cropper's filters
+                          for (const TrackSample *sample : frame_samples)
+                          {
+                              if (sample->global_id < 0)
+                                  continue;
+                              float priority = policy.priority(stream_id, sample->track_id, sample->bbox, sample->quality);
+                              candidates.push_back({nullptr, sample->track_id, sample->bbox, sample->quality, priority});
+                              eligible[sample->track_id] = sample;
+                          }
+                          policy.select(stream_id, candidates, crops);
+                          for (const RecognitionCandidate &candidate : candidates)
+                          {
+                              // Answer as hailogallery would
+                              const TrackSample *sample = eligible[candidate.track_id];
+                              HailoTracker::GetInstance().report_track_identity(stream_id, sample->track_id, sample->global_id,
+                                                                                sample->confidence, sample->margin);
+                              recognized.push_back(sample);
+                          }
+                      });
+    }
+}
@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file replay/recognition_policy_replay.hpp
+ * @brief Replays a track recording through a RecognitionPolicy, to weigh the recognitions it saves
+ *        against the identity mistakes it costs.
+ *
+ * The identity a replay believes for a track is the answer recorded on the last frame it recognized the track.
+ * A track's true identity is taken to be the identity recorded most often for it.
+ */
+#pragma once
+#include <vector>
+#include "recognition_policy.hpp"
+#include "track_recording.hpp"
+
+namespace replay
+{
+    struct RecognitionReplayStats
+    {
+        size_t frames = 0;            // Frames of all streams
+        double seconds = 0.0;         // Duration of the longest stream
+        size_t crops = 0;             // Recognitions
+        double crops_per_second = 0.0;
+        size_t identified_track_frames = 0; // Track frames with a believed identity
+        size_t identity_switches = 0; // Times the believed identity of a track changed
+        size_t identity_errors = 0;   // Identified track frames whose believed identity isn't the true one
+    };
+
+    /**
+     * @brief Recognize every track on every frame the recording has an answer for (no policy).
+     */
+    RecognitionReplayStats replay_every_frame(const std::vector<TrackSample> &samples, double fps);
+
+    /**
+     * @brief Recognize the tracks the policy chooses. The recorded answers are reported to HailoTracker
+     *        as hailogallery would, so the policy backs off exactly as in a pipeline.
+     *
+     * @param max_crops Most recognitions per frame, 0 for no limit.
+     */
+    RecognitionReplayStats replay_recognition_policy(const std::vector<TrackSample> &samples, const RecognitionPolicyParams &params,
+                                                     uint max_crops, double fps);
+}
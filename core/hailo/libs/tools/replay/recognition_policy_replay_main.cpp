@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include <iomanip>
+#include <iostream>
+#include <cxxopts/cxxopts.hpp>
+#include "recognition_policy_replay.hpp"
+
+/**
+ * @brief Build command line arguments.
+ *
+ * @return cxxopts::Options
+ *         The available user arguments.
+ */
+cxxopts::Options build_arg_parser()
+{
+    RecognitionPolicyParams defaults;
+    cxxopts::Options options("recognition_policy_replay", "Replay recorded tracks through the croppers' recognition policy, "
+                                                          "and compare it to recognizing every track on every frame");
+    options.add_options()
+    ("h,help", "Show this help")
+    ("r,recording", "Track recording CSV (written by dump_tracks_for_replay of libdebug.so)", cxxopts::value<std::string>())
+    ("fps", "Frame rate of the recording", cxxopts::value<double>()->default_value("30"))
+    ("max-crops", "Most recognitions per frame (max-crops-per-frame of hailocropper), 0 for no limit", cxxopts::value<uint>()->default_value("0"))
+    ("base-interval", "Frames between recognitions of tracks that aren't confidently identified", cxxopts::value<int>()->default_value(std::to_string(defaults.base_interval)))
+    ("max-interval", "Longest back off of confidently identified tracks", cxxopts::value<int>()->default_value(std::to_string(defaults.max_interval)))
+    ("max-age", "Recognize every track at least once every this many frames", cxxopts::value<int>()->default_value(std::to_string(defaults.max_age)))
+    ("min-confidence", "Similarity needed to back off", cxxopts::value<float>()->default_value(std::to_string(defaults.min_confidence)))
+    ("min-margin", "Margin over the next best identity needed to back off", cxxopts::value<float>()->default_value(std::to_string(defaults.min_margin)))
+    ("motion-iou", "Recognize again below this overlap with the box of the last recognition", cxxopts::value<float>()->default_value(std::to_string(defaults.motion_iou)))
+    ("quality-jump", "Recognize again when the quality grows by this fraction", cxxopts::value<float>()->default_value(std::to_string(defaults.quality_jump)))
+    ("min-quality", "Qualities below this count as this for the quality jump", cxxopts::value<float>()->default_value(std::to_string(defaults.min_quality)))
+    ("occlusion-frames", "Recognize again after the track was unseen for more frames than this", cxxopts::value<int>()->default_value(std::to_string(defaults.occlusion_frames)));
+    return options;
+}
+
+static void print_stats(const std::string &title, const replay::RecognitionReplayStats &stats)
+{
+    double track_frames = std::max<size_t>(stats.identified_track_frames, 1);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << title << std::endl;
+    std::cout << "  crops:                 " << stats.crops << " (" << stats.crops_per_second << " per second)" << std::endl;
+    std::cout << "  identity switches:     " << stats.identity_switches << " (" << 1000.0 * stats.identity_switches / track_frames
+              << " per 1000 track frames)" << std::endl;
+    std::cout << "  wrong identity:        " << 100.0 * stats.identity_errors / track_frames << "% of "
+              << stats.identified_track_frames << " identified track frames" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    cxxopts::Options options = build_arg_parser();
+    auto result = options.parse(argc, argv);
+    if (result.count("help") || !result.count("recording"))
+    {
+        std::cout << options.help() << std::endl;
+        return result.count("help") ? 0 : 1;
+    }
+
+    RecognitionPolicyParams params;
+    params.base_interval = result["base-interval"].as<int>();
+    params.max_interval = result["max-interval"].as<int>();
+    params.max_age = result["max-age"].as<int>();
+    params.min_confidence = result["min-confidence"].as<float>();
+    params.min_margin = result["min-margin"].as<float>();
+    params.motion_iou = result["motion-iou"].as<float>();
+    params.quality_jump = result["quality-jump"].as<float>();
+    params.min_quality = result["min-quality"].as<float>();
+    params.occlusion_frames = result["occlusion-frames"].as<int>();
+    double fps = result["fps"].as<double>();
+
+    try
+    {
+        std::vector<replay::TrackSample> samples = replay::read_track_recording(result["recording"].as<std::string>());
+        replay::RecognitionReplayStats every_frame = replay::replay_every_frame(samples, fps);
+        replay::RecognitionReplayStats policy = replay::replay_recognition_policy(samples, params, result["max-crops"].as<uint>(), fps);
+
+        std::cout << "frames in recording:     " << every_frame.frames << " (" << every_frame.seconds << " s)" << std::endl;
+        print_stats("every frame:", every_frame);
+        print_stats("recognition policy:", policy);
+        std::cout << "crops saved:             " << std::setprecision(1)
+                  << (every_frame.crops ? 100.0 * (every_frame.crops - policy.crops) / every_frame.crops : 0.0) << "% ("
+                  << std::setprecision(2) << every_frame.crops_per_second - policy.crops_per_second << " per second)" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
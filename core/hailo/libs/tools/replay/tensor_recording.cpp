@@ -0,0 +1,271 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "tensor_recording.hpp"
+
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+#if __GNUC__ > 8
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#endif
+
+#define NPY_MAGIC "\x93NUMPY"
+#define NPY_MAGIC_SIZE 6
+#define NPY_HEADER_ALIGNMENT 64
+
+namespace replay
+{
+    static size_t format_type_size(hailo_format_type_t type)
+    {
+        switch (type)
+        {
+        case HAILO_FORMAT_TYPE_UINT16:
+            return sizeof(uint16_t);
+        case HAILO_FORMAT_TYPE_FLOAT32:
+            return sizeof(float32_t);
+        default:
+            return sizeof(uint8_t);
+        }
+    }
+
+    size_t tensor_frame_size(const hailo_vstream_info_t &vstream_info)
+    {
+        size_t element_size = format_type_size(vstream_info.format.type);
+        if (vstream_info.format.order == HAILO_FORMAT_ORDER_HAILO_NMS)
+        {
+            // Per class: the number of boxes followed by max_bboxes_per_class boxes of 5 values (y_min, x_min, y_max, x_max, score)
+            size_t class_size = element_size + vstream_info.nms_shape.max_bboxes_per_class * 5 * element_size;
+            return vstream_info.nms_shape.number_of_classes * class_size;
+        }
+        return (size_t)vstream_info.shape.height * vstream_info.shape.width * vstream_info.shape.features * element_size;
+    }
+
+    static std::string tensor_file_name(const std::string &tensor_name)
+    {
+        std::string file_name = tensor_name;
+        std::replace(file_name.begin(), file_name.end(), '/', '_');
+        return file_name + ".npy";
+    }
+
+    static std::string frame_directory(const std::string &directory, size_t frame_index)
+    {
+        std::ostringstream oss;
+        oss << "frame_" << std::setw(6) << std::setfill('0') << frame_index;
+        return (fs::path(directory) / oss.str()).string();
+    }
+
+    static void write_npy(const std::string &path, const uint8_t *data, size_t size)
+    {
+        std::string header = "{'descr': '|u1', 'fortran_order': False, 'shape': (" + std::to_string(size) + ",), }";
+        // Magic, 2 version bytes, 2 header length bytes, then the header padded with spaces and terminated by a newline
+        size_t prefix_size = NPY_MAGIC_SIZE + 4;
+        size_t padding = NPY_HEADER_ALIGNMENT - ((prefix_size + header.size() + 1) % NPY_HEADER_ALIGNMENT);
+        header.append(padding % NPY_HEADER_ALIGNMENT, ' ');
+        header.push_back('\n');
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("Could not open " + path + " for writing");
+        uint16_t header_size = header.size();
+        file.write(NPY_MAGIC, NPY_MAGIC_SIZE);
+        file.put(1);
+        file.put(0);
+        file.put(header_size & 0xff);
+        file.put(header_size >> 8);
+        file.write(header.data(), header.size());
+        file.write(reinterpret_cast<const char *>(data), size);
+    }
+
+    /**
+     * @brief Read the payload of an npy file as raw bytes, whatever its dtype and shape are.
+     */
+    static std::vector<uint8_t> read_npy(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("Could not open " + path);
+        std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (contents.size() < NPY_MAGIC_SIZE + 4 || memcmp(contents.data(), NPY_MAGIC, NPY_MAGIC_SIZE) != 0)
+            throw std::runtime_error(path + " is not an npy file");
+
+        uint8_t major_version = contents[NPY_MAGIC_SIZE];
+        size_t header_offset = NPY_MAGIC_SIZE + 2;
+        size_t header_size = contents[header_offset] | (contents[header_offset + 1] << 8);
+        size_t data_offset = header_offset + 2 + header_size;
+        if (major_version > 1)
+        {
+            header_size |= (contents[header_offset + 2] << 16) | ((size_t)contents[header_offset + 3] << 24);
+            data_offset = header_offset + 4 + header_size;
+        }
+        if (data_offset > contents.size())
+            throw std::runtime_error(path + " has a truncated header");
+        return std::vector<uint8_t>(contents.begin() + data_offset, contents.end());
+    }
+
+    void write_vstream_infos(const std::string &directory, const std::vector<HailoTensorPtr> &tensors)
+    {
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        writer.StartObject();
+        writer.Key("tensors");
+        writer.StartArray();
+        for (auto &tensor : tensors)
+        {
+            hailo_vstream_info_t &info = tensor->vstream_info();
+            writer.StartObject();
+            writer.Key("name");
+            writer.String(info.name);
+            writer.Key("network_name");
+            writer.String(info.network_name);
+            writer.Key("format_type");
+            writer.Int(info.format.type);
+            writer.Key("format_order");
+            writer.Int(info.format.order);
+            writer.Key("format_flags");
+            writer.Int(info.format.flags);
+            if (info.format.order == HAILO_FORMAT_ORDER_HAILO_NMS)
+            {
+                writer.Key("number_of_classes");
+                writer.Uint(info.nms_shape.number_of_classes);
+                writer.Key("max_bboxes_per_class");
+                writer.Uint(info.nms_shape.max_bboxes_per_class);
+            }
+            else
+            {
+                writer.Key("height");
+                writer.Uint(info.shape.height);
+                writer.Key("width");
+                writer.Uint(info.shape.width);
+                writer.Key("features");
+                writer.Uint(info.shape.features);
+            }
+            writer.Key("qp_zp");
+            writer.Double(info.quant_info.qp_zp);
+            writer.Key("qp_scale");
+            writer.Double(info.quant_info.qp_scale);
+            writer.Key("limvals_min");
+            writer.Double(info.quant_info.limvals_min);
+            writer.Key("limvals_max");
+            writer.Double(info.quant_info.limvals_max);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+
+        fs::create_directories(directory);
+        std::string path = (fs::path(directory) / REPLAY_VSTREAM_INFOS_FILE).string();
+        std::ofstream file(path);
+        if (!file)
+            throw std::runtime_error("Could not open " + path + " for writing");
+        file << buffer.GetString() << std::endl;
+    }
+
+    std::vector<hailo_vstream_info_t> read_vstream_infos(const std::string &directory)
+    {
+        std::string path = (fs::path(directory) / REPLAY_VSTREAM_INFOS_FILE).string();
+        std::ifstream file(path);
+        if (!file)
+            throw std::runtime_error("Could not open " + path);
+        std::stringstream contents;
+        contents << file.rdbuf();
+
+        rapidjson::Document document;
+        document.Parse(contents.str().c_str());
+        if (document.HasParseError() || !document.IsObject() || !document.HasMember("tensors") || !document["tensors"].IsArray())
+            throw std::runtime_error(path + " is not a valid vstream infos file");
+
+        std::vector<hailo_vstream_info_t> vstream_infos;
+        for (auto &entry : document["tensors"].GetArray())
+        {
+            if (!entry.HasMember("name") || !entry.HasMember("format_type") || !entry.HasMember("format_order"))
+                throw std::runtime_error(path + ": a tensor is missing its name or format");
+            hailo_vstream_info_t info = {};
+            strncpy(info.name, entry["name"].GetString(), sizeof(info.name) - 1);
+            if (entry.HasMember("network_name"))
+                strncpy(info.network_name, entry["network_name"].GetString(), sizeof(info.network_name) - 1);
+            info.direction = HAILO_D2H_STREAM;
+            info.format.type = (hailo_format_type_t)entry["format_type"].GetInt();
+            info.format.order = (hailo_format_order_t)entry["format_order"].GetInt();
+            info.format.flags = entry.HasMember("format_flags") ? (hailo_format_flags_t)entry["format_flags"].GetInt() : HAILO_FORMAT_FLAGS_NONE;
+            if (info.format.order == HAILO_FORMAT_ORDER_HAILO_NMS)
+            {
+                info.nms_shape.number_of_classes = entry["number_of_classes"].GetUint();
+                info.nms_shape.max_bboxes_per_class = entry["max_bboxes_per_class"].GetUint();
+            }
+            else
+            {
+                info.shape.height = entry["height"].GetUint();
+                info.shape.width = entry["width"].GetUint();
+                info.shape.features = entry["features"].GetUint();
+            }
+            info.quant_info.qp_zp = entry["qp_zp"].GetDouble();
+            info.quant_info.qp_scale = entry["qp_scale"].GetDouble();
+            info.quant_info.limvals_min = entry.HasMember("limvals_min") ? entry["limvals_min"].GetDouble() : 0.0f;
+            info.quant_info.limvals_max = entry.HasMember("limvals_max") ? entry["limvals_max"].GetDouble() : 0.0f;
+            vstream_infos.push_back(info);
+        }
+        return vstream_infos;
+    }
+
+    void record_frame(const std::string &directory, size_t frame_index, HailoROIPtr roi)
+    {
+        std::string frame_path = frame_directory(directory, frame_index);
+        fs::create_directories(frame_path);
+        for (auto &tensor : roi->get_tensors())
+        {
+            std::string path = (fs::path(frame_path) / tensor_file_name(tensor->name())).string();
+            write_npy(path, tensor->data(), tensor_frame_size(tensor->vstream_info()));
+        }
+    }
+
+    TensorRecording::TensorRecording(const std::string &directory)
+        : m_vstream_infos(read_vstream_infos(directory))
+    {
+        for (size_t frame_index = 0;; frame_index++)
+        {
+            std::string frame_path = frame_directory(directory, frame_index);
+            if (!fs::is_directory(frame_path))
+                break;
+
+            std::vector<std::vector<uint8_t>> frame;
+            frame.reserve(m_vstream_infos.size());
+            for (auto &info : m_vstream_infos)
+            {
+                std::string path = (fs::path(frame_path) / tensor_file_name(info.name)).string();
+                std::vector<uint8_t> data = read_npy(path);
+                if (data.size() != tensor_frame_size(info))
+                {
+                    std::ostringstream oss;
+                    oss << path << " holds " << data.size() << " bytes, expected " << tensor_frame_size(info);
+                    throw std::runtime_error(oss.str());
+                }
+                frame.emplace_back(std::move(data));
+            }
+            m_frames.emplace_back(std::move(frame));
+        }
+        if (m_frames.empty())
+            throw std::runtime_error("No frames found in " + directory);
+    }
+
+    HailoROIPtr TensorRecording::create_roi(size_t frame_index)
+    {
+        auto roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+        auto &frame = m_frames.at(frame_index);
+        for (size_t i = 0; i < m_vstream_infos.size(); i++)
+            roi->add_tensor(std::make_shared<HailoTensor>(frame[i].data(), m_vstream_infos[i]));
+        return roi;
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file replay/tensor_recording.hpp
+ * @brief Recording of output tensors, so postprocesses can be replayed without a device.
+ *
+ * A recording is a directory:
+ *   vstream_infos.json        - the hailo_vstream_info_t of every output tensor (name, shape, format, quant info).
+ *   frame_000000/<name>.npy   - the raw data of every tensor of the first frame ('/' in names replaced by '_').
+ *   frame_000001/...
+ *
+ * Tensors are written as 1D uint8 npy arrays of the exact frame size. Files written by dump_tensors_to_npy
+ * of uint8 tensors can be put in a frame directory as they are.
+ */
+#pragma once
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "hailo_objects.hpp"
+
+namespace replay
+{
+#define REPLAY_VSTREAM_INFOS_FILE "vstream_infos.json"
+
+    /**
+     * @brief Size in bytes of the data of one frame of a tensor.
+     */
+    size_t tensor_frame_size(const hailo_vstream_info_t &vstream_info);
+
+    /**
+     * @brief Write the vstream infos of the given tensors to <directory>/vstream_infos.json.
+     */
+    void write_vstream_infos(const std::string &directory, const std::vector<HailoTensorPtr> &tensors);
+
+    /**
+     * @brief Read the vstream infos of a recording.
+     * @throws std::runtime_error if the file is missing or not valid.
+     */
+    std::vector<hailo_vstream_info_t> read_vstream_infos(const std::string &directory);
+
+    /**
+     * @brief Write the tensors of a roi as frame number frame_index of a recording.
+     */
+    void record_frame(const std::string &directory, size_t frame_index, HailoROIPtr roi);
+
+    class TensorRecording
+    {
+    public:
+        /**
+         * @brief Load a whole recording into memory.
+         * @throws std::runtime_error if a tensor of vstream_infos.json is missing in a frame or has the wrong size.
+         */
+        explicit TensorRecording(const std::string &directory);
+
+        size_t num_frames() const { return m_frames.size(); }
+        const std::vector<hailo_vstream_info_t> &vstream_infos() const { return m_vstream_infos; }
+
+        /**
+         * @brief A new full frame roi holding the tensors of a frame, as hailonet would attach them.
+         *        The tensors point to the recording's memory, which must outlive the roi.
+         */
+        HailoROIPtr create_roi(size_t frame_index);
+
+    private:
+        std::vector<hailo_vstream_info_t> m_vstream_infos;
+        // Per frame, the data of every tensor in the order of m_vstream_infos
+        std::vector<std::vector<std::vector<uint8_t>>> m_frames;
+    };
+}
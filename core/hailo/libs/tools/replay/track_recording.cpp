@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "track_recording.hpp"
+
+namespace replay
+{
+    std::string format_track_sample(const TrackSample &sample)
+    {
+        std::ostringstream oss;
+        oss << sample.frame << ',' << sample.stream_id << ',' << sample.track_id << ','
+            << sample.bbox.xmin() << ',' << sample.bbox.ymin() << ',' << sample.bbox.width() << ',' << sample.bbox.height() << ','
+            << sample.quality << ',' << sample.global_id << ',' << sample.confidence << ',' << sample.margin;
+        return oss.str();
+    }
+
+    static TrackSample parse_track_sample(const std::string &line)
+    {
+        std::vector<std::string> fields;
+        std::istringstream iss(line);
+        std::string field;
+        while (std::getline(iss, field, ','))
+            fields.push_back(field);
+        if (fields.size() != 11)
+            throw std::invalid_argument("expected 11 fields");
+
+        return TrackSample{std::stoul(fields[0]), fields[1], std::stoi(fields[2]),
+                           HailoBBox(std::stof(fields[3]), std::stof(fields[4]), std::stof(fields[5]), std::stof(fields[6])),
+                           std::stof(fields[7]), std::stoi(fields[8]), std::stof(fields[9]), std::stof(fields[10])};
+    }
+
+    std::vector<TrackSample> read_track_recording(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file)
+            throw std::runtime_error("Could not open " + path);
+
+        std::vector<TrackSample> samples;
+        std::string line;
+        size_t line_number = 0;
+        while (std::getline(file, line))
+        {
+            line_number++;
+            if (line.empty() || line == TRACK_RECORDING_HEADER)
+                continue;
+            try
+            {
+                samples.push_back(parse_track_sample(line));
+            }
+            catch (const std::exception &e)
+            {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + " is not a valid track sample (" + e.what() + ")");
+            }
+        }
+        return samples;
+    }
+}
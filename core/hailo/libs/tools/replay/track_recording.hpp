@@ -0,0 +1,47 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file replay/track_recording.hpp
+ * @brief Recording of tracks and of what the recognizer answered about them, so recognition policies
+ *        can be replayed without a device.
+ *
+ * A recording is a CSV file with a header line and a line per track per frame:
+ *   frame,stream_id,track_id,xmin,ymin,width,height,quality,global_id,confidence,margin
+ * global_id, confidence and margin are the identity the recognizer reported for the track on that frame,
+ * global_id is -1 on frames it didn't recognize the track. Record with recognition on every frame
+ * (e.g. the create_crops_every_frame cropper) to let the replay choose any subset of the frames.
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include "hailo_objects.hpp"
+
+namespace replay
+{
+#define TRACK_RECORDING_HEADER "frame,stream_id,track_id,xmin,ymin,width,height,quality,global_id,confidence,margin"
+
+    struct TrackSample
+    {
+        size_t frame;
+        std::string stream_id;
+        int track_id;
+        HailoBBox bbox;
+        float quality;
+        int global_id;
+        float confidence;
+        float margin;
+    };
+
+    /**
+     * @brief One line of a recording, without the newline.
+     */
+    std::string format_track_sample(const TrackSample &sample);
+
+    /**
+     * @brief Read a recording, in file order.
+     * @throws std::runtime_error if the file is missing or a line is not valid.
+     */
+    std::vector<TrackSample> read_track_recording(const std::string &path);
+}
@@ -13,11 +13,34 @@ static void gst_hailo_stream_meta_free(GstMeta *meta, GstBuffer *buffer);
 static gboolean gst_hailo_stream_meta_transform(GstBuffer *transbuf, GstMeta *meta, GstBuffer *buffer,
                                                 GQuark type, gpointer data);
 
+// Interned pad names (key -> value: pad name -> index + 1), entries are never removed
+G_LOCK_DEFINE_STATIC(stream_index_lock);
+static GHashTable *stream_index_table = NULL;
+
+guint gst_hailo_stream_meta_intern(const gchar *pad_name)
+{
+    if (pad_name == NULL)
+        return GST_HAILO_STREAM_INDEX_NONE;
+
+    G_LOCK(stream_index_lock);
+    if (stream_index_table == NULL)
+        stream_index_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    guint index = GPOINTER_TO_UINT(g_hash_table_lookup(stream_index_table, pad_name));
+    if (index == 0)
+    {
+        index = g_hash_table_size(stream_index_table) + 1;
+        g_hash_table_insert(stream_index_table, g_strdup(pad_name), GUINT_TO_POINTER(index));
+    }
+    G_UNLOCK(stream_index_lock);
+    return index - 1;
+}
+
 static gboolean gst_hailo_stream_meta_init(GstMeta *meta, gpointer params, GstBuffer *buffer)
 {
     GstHailoStreamMeta *stream_meta = (GstHailoStreamMeta *)meta;
     stream_meta->pad_name = NULL;
     stream_meta->stream_id = NULL;
+    stream_meta->stream_index = GST_HAILO_STREAM_INDEX_NONE;
     return TRUE;
 }
 
@@ -40,7 +63,8 @@ static gboolean gst_hailo_stream_meta_transform(GstBuffer *transbuf, GstMeta *me
                                                  GQuark type, gpointer data)
 {
     GstHailoStreamMeta *gst_hailo_stream_meta = (GstHailoStreamMeta *)meta;
-    gst_buffer_add_hailo_stream_meta(transbuf, gst_hailo_stream_meta->pad_name,  gst_hailo_stream_meta->stream_id);
+    gst_buffer_add_hailo_stream_meta_full(transbuf, gst_hailo_stream_meta->pad_name, gst_hailo_stream_meta->stream_id,
+                                          gst_hailo_stream_meta->stream_index);
     return TRUE;
 }
 
@@ -74,6 +98,12 @@ const GstMetaInfo *gst_hailo_stream_meta_get_info(void)
 }
 
 GstHailoStreamMeta *gst_buffer_add_hailo_stream_meta(GstBuffer *buffer, const gchar *pad_name, const gchar *stream_id)
+{
+    return gst_buffer_add_hailo_stream_meta_full(buffer, pad_name, stream_id, GST_HAILO_STREAM_INDEX_NONE);
+}
+
+GstHailoStreamMeta *gst_buffer_add_hailo_stream_meta_full(GstBuffer *buffer, const gchar *pad_name, const gchar *stream_id,
+                                                          guint stream_index)
 {
     GstHailoStreamMeta *stream_meta = NULL;
 
@@ -88,6 +118,7 @@ GstHailoStreamMeta *gst_buffer_add_hailo_stream_meta(GstBuffer *buffer, const gc
     
     stream_meta->pad_name = g_strdup(pad_name);
     stream_meta->stream_id = g_strdup(stream_id);
+    stream_meta->stream_index = (stream_index != GST_HAILO_STREAM_INDEX_NONE) ? stream_index : gst_hailo_stream_meta_intern(pad_name);
     return stream_meta;
 }
 
@@ -10,6 +10,7 @@ G_BEGIN_DECLS
 
 #define GST_HAILO_STREAM_META_API_TYPE (gst_hailo_stream_meta_api_get_type())
 #define GST_HAILO_STREAM_META_INFO (gst_hailo_stream_meta_get_info())
+#define GST_HAILO_STREAM_INDEX_NONE (G_MAXUINT)
 
 typedef struct _GstHailoStreamMeta GstHailoStreamMeta;
 typedef struct _GstHailoStream GstHailoStream;
@@ -20,6 +21,9 @@ struct _GstHailoStreamMeta
     GstMeta meta;
     gchar *pad_name;
     gchar *stream_id;
+    // pad_name interned to a small process-wide index (see gst_hailo_stream_meta_intern),
+    // lets downstream elements look streams up by array index instead of comparing strings
+    guint stream_index;
 };
 
 GType gst_hailo_stream_meta_api_get_type(void);
@@ -30,6 +34,21 @@ const GstMetaInfo *gst_hailo_stream_meta_get_info(void);
 GST_EXPORT
 GstHailoStreamMeta *gst_buffer_add_hailo_stream_meta(GstBuffer *buffer, const gchar *pad_name, const gchar *stream_id);
 
+/**
+ * @brief Add stream meta with an already interned pad name, avoids interning per buffer.
+ *        A stream_index of GST_HAILO_STREAM_INDEX_NONE interns pad_name.
+ */
+GST_EXPORT
+GstHailoStreamMeta *gst_buffer_add_hailo_stream_meta_full(GstBuffer *buffer, const gchar *pad_name, const gchar *stream_id,
+                                                          guint stream_index);
+
+/**
+ * @brief Intern a pad name. Indexes are dense (0, 1, 2...), stable for the lifetime of the process,
+ *        and equal names always get the same index.
+ */
+GST_EXPORT
+guint gst_hailo_stream_meta_intern(const gchar *pad_name);
+
 GST_EXPORT
 gboolean gst_buffer_remove_hailo_stream_meta(GstBuffer *buffer);
 
@@ -0,0 +1,284 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file common/binary_meta.hpp
+ * @brief The binary wire format of HailoROI meta, the compact alternative to the JSON of encode_json/decode_json.
+ *
+ * A message is a fixed header followed by the main ROI:
+ *
+ *     header:  u32 magic ("HMTA") | u16 version | u16 flags | u32 payload size | u64 timestamp (ms) | u64 buffer offset
+ *     roi:     bbox | object list
+ *     bbox:    f32 xmin | f32 ymin | f32 width | f32 height
+ *     objects: u32 count | count x (u8 tag | u32 body size | body)
+ *     string:  u32 size | bytes
+ *     blob:    u32 element count | elements (raw)
+ *
+ * Everything is little-endian. Every object carries the size of its body, so a reader skips tags it doesn't
+ * know and fields appended to a body by a newer minor version. The version is only bumped for changes that
+ * old readers can't skip, and readers refuse messages of a newer version.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define BINARY_META_MAGIC 0x41544d48 // "HMTA"
+#define BINARY_META_VERSION 1
+#define BINARY_META_HEADER_SIZE 28
+
+namespace binary_meta
+{
+    // Wire tags of the objects, independent of hailo_object_t so the enum can change without breaking the format
+    enum wire_tag_t : uint8_t
+    {
+        TAG_DETECTION = 1,
+        TAG_CLASSIFICATION = 2,
+        TAG_LANDMARKS = 3,
+        TAG_TILE = 4,
+        TAG_UNIQUE_ID = 5,
+        TAG_MATRIX = 6,
+        TAG_DEPTH_MASK = 7,
+        TAG_CLASS_MASK = 8,
+        TAG_CONF_CLASS_MASK = 9,
+    };
+
+    struct Header
+    {
+        uint16_t version;
+        uint16_t flags;
+        uint32_t payload_size;
+        uint64_t timestamp_ms;
+        uint64_t buffer_offset;
+    };
+
+    class FormatError : public std::runtime_error
+    {
+    public:
+        explicit FormatError(const std::string &what) : std::runtime_error("binary meta: " + what) {}
+    };
+
+    constexpr bool host_is_little_endian()
+    {
+        return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+    }
+
+    /**
+     * @brief Appends little-endian values to a byte vector. Clearing and reusing the vector between
+     *        messages keeps its capacity, so a steady stream of messages doesn't allocate.
+     */
+    class Writer
+    {
+    public:
+        explicit Writer(std::vector<uint8_t> &buffer) : m_buffer(buffer) {}
+
+        size_t size() const { return m_buffer.size(); }
+
+        void u8(uint8_t value) { m_buffer.push_back(value); }
+        void u16(uint16_t value) { put_le(value); }
+        void u32(uint32_t value) { put_le(value); }
+        void u64(uint64_t value) { put_le(value); }
+        void i32(int32_t value) { put_le(static_cast<uint32_t>(value)); }
+        void f32(float value)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            put_le(bits);
+        }
+
+        void string(const std::string &value)
+        {
+            u32(value.size());
+            m_buffer.insert(m_buffer.end(), value.begin(), value.end());
+        }
+
+        template <typename T>
+        void blob(const std::vector<T> &values)
+        {
+            static_assert(sizeof(T) == 1 || sizeof(T) == 4, "blobs hold bytes or 32 bit values");
+            u32(values.size());
+            size_t offset = m_buffer.size();
+            m_buffer.resize(offset + values.size() * sizeof(T));
+            if (sizeof(T) == 1 || host_is_little_endian())
+            {
+                if (!values.empty())
+                    std::memcpy(m_buffer.data() + offset, values.data(), values.size() * sizeof(T));
+                return;
+            }
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &values[i], sizeof(bits));
+                store_le(m_buffer.data() + offset + i * sizeof(T), bits);
+            }
+        }
+
+        /**
+         * @brief Reserve a u32 to be filled with the size of what follows, see end_size().
+         */
+        size_t begin_size()
+        {
+            size_t position = m_buffer.size();
+            u32(0);
+            return position;
+        }
+
+        void end_size(size_t position)
+        {
+            store_le(m_buffer.data() + position, uint32_t(m_buffer.size() - position - sizeof(uint32_t)));
+        }
+
+        void patch_u32(size_t position, uint32_t value) { store_le(m_buffer.data() + position, value); }
+
+    private:
+        template <typename T>
+        static void store_le(uint8_t *out, T value)
+        {
+            for (size_t i = 0; i < sizeof(T); i++)
+                out[i] = uint8_t(value >> (8 * i));
+        }
+
+        template <typename T>
+        void put_le(T value)
+        {
+            size_t offset = m_buffer.size();
+            m_buffer.resize(offset + sizeof(T));
+            store_le(m_buffer.data() + offset, value);
+        }
+
+        std::vector<uint8_t> &m_buffer;
+    };
+
+    /**
+     * @brief Reads little-endian values from a message. Every read is bounds checked and throws
+     *        FormatError on a truncated or corrupted message.
+     */
+    class Reader
+    {
+    public:
+        Reader(const uint8_t *data, size_t size) : m_data(data), m_size(size) {}
+
+        size_t position() const { return m_position; }
+        size_t remaining() const { return m_size - m_position; }
+
+        uint8_t u8() { return load_le<uint8_t>(); }
+        uint16_t u16() { return load_le<uint16_t>(); }
+        uint32_t u32() { return load_le<uint32_t>(); }
+        uint64_t u64() { return load_le<uint64_t>(); }
+        int32_t i32() { return static_cast<int32_t>(load_le<uint32_t>()); }
+        float f32()
+        {
+            uint32_t bits = load_le<uint32_t>();
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        std::string string()
+        {
+            uint32_t size = u32();
+            const uint8_t *bytes = take(size);
+            return std::string(reinterpret_cast<const char *>(bytes), size);
+        }
+
+        template <typename T>
+        std::vector<T> blob()
+        {
+            static_assert(sizeof(T) == 1 || sizeof(T) == 4, "blobs hold bytes or 32 bit values");
+            uint32_t count = u32();
+            if (count > remaining() / sizeof(T))
+                throw FormatError("blob overruns the message");
+            const uint8_t *bytes = take(count * sizeof(T));
+            std::vector<T> values(count);
+            if (sizeof(T) == 1 || host_is_little_endian())
+            {
+                if (count)
+                    std::memcpy(values.data(), bytes, count * sizeof(T));
+                return values;
+            }
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t bits = 0;
+                for (size_t b = 0; b < sizeof(uint32_t); b++)
+                    bits |= uint32_t(bytes[i * sizeof(T) + b]) << (8 * b);
+                std::memcpy(&values[i], &bits, sizeof(bits));
+            }
+            return values;
+        }
+
+        /**
+         * @brief A reader over the next size bytes, which are skipped in this reader.
+         */
+        Reader sub_reader(uint32_t size)
+        {
+            const uint8_t *bytes = take(size);
+            return Reader(bytes, size);
+        }
+
+    private:
+        const uint8_t *take(size_t size)
+        {
+            if (size > remaining())
+                throw FormatError("message is truncated");
+            const uint8_t *bytes = m_data + m_position;
+            m_position += size;
+            return bytes;
+        }
+
+        template <typename T>
+        T load_le()
+        {
+            const uint8_t *bytes = take(sizeof(T));
+            T value = 0;
+            for (size_t i = 0; i < sizeof(T); i++)
+                value |= T(bytes[i]) << (8 * i);
+            return value;
+        }
+
+        const uint8_t *m_data;
+        size_t m_size;
+        size_t m_position = 0;
+    };
+
+    inline void write_header(Writer &writer, uint64_t timestamp_ms, uint64_t buffer_offset)
+    {
+        writer.u32(BINARY_META_MAGIC);
+        writer.u16(BINARY_META_VERSION);
+        writer.u16(0);
+        writer.u32(0); // Payload size, patched by finish_message()
+        writer.u64(timestamp_ms);
+        writer.u64(buffer_offset);
+    }
+
+    inline void finish_message(Writer &writer, size_t message_start)
+    {
+        writer.patch_u32(message_start + 8, uint32_t(writer.size() - message_start - BINARY_META_HEADER_SIZE));
+    }
+
+    inline bool is_binary_meta(const uint8_t *data, size_t size)
+    {
+        return size >= BINARY_META_HEADER_SIZE && Reader(data, size).u32() == BINARY_META_MAGIC;
+    }
+
+    inline Header read_header(Reader &reader)
+    {
+        if (reader.remaining() < BINARY_META_HEADER_SIZE || reader.u32() != BINARY_META_MAGIC)
+            throw FormatError("not a binary meta message");
+        Header header;
+        header.version = reader.u16();
+        header.flags = reader.u16();
+        header.payload_size = reader.u32();
+        header.timestamp_ms = reader.u64();
+        header.buffer_offset = reader.u64();
+        if (header.version > BINARY_META_VERSION)
+            throw FormatError("message version " + std::to_string(header.version) + " is newer than the supported " +
+                              std::to_string(BINARY_META_VERSION));
+        if (header.payload_size != reader.remaining())
+            throw FormatError("payload size doesn't match the message size");
+        return header;
+    }
+}
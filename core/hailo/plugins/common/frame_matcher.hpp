@@ -0,0 +1,340 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file common/frame_matcher.hpp
+ * @brief Matching of main frames with the buffers of a sub branch by PTS or offset.
+ *
+ * Used by the 2-to-1 merging elements (hailomuxer, hailoaggregator) instead of handing buffers over
+ * between the chain functions: main frames wait in a small window until all their sub buffers arrived,
+ * or until they time out, and are released in arrival order. Sub buffers that arrive before their main
+ * frame wait in a window of their own. Nothing in HailoFrameMatcher blocks, and it is not thread safe.
+ * HailoMatchTimer releases timed out frames when neither branch sends buffers anymore.
+ */
+#pragma once
+
+#include <gst/gst.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+typedef enum
+{
+    GST_HAILO_MATCH_MODE_NONE = 0,
+    GST_HAILO_MATCH_MODE_PTS = 1,
+    GST_HAILO_MATCH_MODE_OFFSET = 2,
+} GstHailoMatchMode;
+
+inline GType gst_hailo_match_mode_get_type(void)
+{
+    static GType match_mode_type = 0;
+    static const GEnumValue match_modes[] = {
+        {GST_HAILO_MATCH_MODE_NONE, "Hand every main frame over to the sub branch and wait for it", "none"},
+        {GST_HAILO_MATCH_MODE_PTS, "Match frames by presentation timestamp, the main branch never waits", "pts"},
+        {GST_HAILO_MATCH_MODE_OFFSET, "Match frames by buffer offset, the main branch never waits", "offset"},
+        {0, NULL, NULL},
+    };
+    if (g_once_init_enter(&match_mode_type))
+    {
+        GType type = g_enum_register_static("GstHailoMatchMode", match_modes);
+        g_once_init_leave(&match_mode_type, type);
+    }
+    return match_mode_type;
+}
+#define GST_TYPE_HAILO_MATCH_MODE (gst_hailo_match_mode_get_type())
+
+#define HAILO_MATCH_DEFAULT_TOLERANCE 0
+#define HAILO_MATCH_DEFAULT_TIMEOUT_MS 500
+#define HAILO_MATCH_DEFAULT_WINDOW 8
+#define HAILO_MATCH_DEFAULT_SUB_WINDOW 256
+
+/**
+ * @brief The matching key of a buffer, GST_CLOCK_TIME_NONE (== GST_BUFFER_OFFSET_NONE) if it has none.
+ */
+inline guint64 gst_hailo_match_key(GstBuffer *buffer, GstHailoMatchMode mode)
+{
+    return (mode == GST_HAILO_MATCH_MODE_PTS) ? GST_BUFFER_PTS(buffer) : GST_BUFFER_OFFSET(buffer);
+}
+
+struct HailoPendingFrame
+{
+    GstBuffer *buffer;
+    guint64 key;
+    gint64 arrival_time; // Monotonic time in us
+    guint expected;      // Number of sub buffers to wait for
+    guint received;
+    bool expired;
+
+    bool complete() const { return received >= expected; }
+};
+
+struct HailoPendingSub
+{
+    GstBuffer *buffer;
+    guint64 key;
+};
+
+class HailoFrameMatcher
+{
+public:
+    /**
+     * @param tolerance Maximal key difference of matching buffers (ns for PTS, frames for offset).
+     * @param timeout_us Time after which a main frame is released even if not all of its sub buffers arrived.
+     * @param window Maximal number of pending main frames, the oldest is released when it is exceeded.
+     * @param sub_window Maximal number of sub buffers waiting for their main frame, the oldest is dropped when it is exceeded.
+     */
+    void configure(guint64 tolerance, gint64 timeout_us, guint window, guint sub_window = HAILO_MATCH_DEFAULT_SUB_WINDOW)
+    {
+        m_tolerance = tolerance;
+        m_timeout_us = timeout_us;
+        m_window = MAX(window, 1);
+        m_sub_window = MAX(sub_window, 1);
+    }
+
+    bool keys_match(guint64 a, guint64 b) const
+    {
+        if (a == GST_CLOCK_TIME_NONE || b == GST_CLOCK_TIME_NONE)
+            return false;
+        return ((a > b) ? a - b : b - a) <= m_tolerance;
+    }
+
+    HailoPendingFrame &add_main(GstBuffer *buffer, guint64 key, guint expected, gint64 now)
+    {
+        if (m_frames.size() >= m_window)
+            m_frames[m_frames.size() - m_window].expired = true;
+        m_frames.push_back({buffer, key, now, expected, 0, false});
+        return m_frames.back();
+    }
+
+    /**
+     * @brief The oldest pending main frame that matches the key and still waits for sub buffers.
+     */
+    HailoPendingFrame *find_main(guint64 key)
+    {
+        for (HailoPendingFrame &frame : m_frames)
+        {
+            if (!frame.complete() && !frame.expired && keys_match(frame.key, key))
+                return &frame;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Expire the main frames that are older than the key (minus tolerance).
+     *        Branches are ordered, so once a sub buffer of a later frame arrived, these won't get any more.
+     */
+    void expire_older_than(guint64 key)
+    {
+        if (key == GST_CLOCK_TIME_NONE)
+            return;
+        for (HailoPendingFrame &frame : m_frames)
+        {
+            if (frame.key != GST_CLOCK_TIME_NONE && frame.key + m_tolerance < key)
+                frame.expired = true;
+        }
+    }
+
+    /**
+     * @brief Keep a sub buffer that arrived before its main frame.
+     * @return A buffer that was evicted to make room (the oldest one), or NULL.
+     */
+    GstBuffer *add_sub(GstBuffer *buffer, guint64 key)
+    {
+        GstBuffer *evicted = NULL;
+        if (m_subs.size() >= m_sub_window)
+        {
+            evicted = m_subs.front().buffer;
+            m_subs.pop_front();
+        }
+        m_subs.push_back({buffer, key});
+        return evicted;
+    }
+
+    /**
+     * @brief Take the oldest pending sub buffer that matches the key, NULL if there is none.
+     *        Older sub buffers that can't match anymore are passed to on_stale.
+     */
+    template <typename F>
+    GstBuffer *take_sub(guint64 key, F on_stale)
+    {
+        while (!m_subs.empty())
+        {
+            HailoPendingSub sub = m_subs.front();
+            if (keys_match(sub.key, key))
+            {
+                m_subs.pop_front();
+                return sub.buffer;
+            }
+            if (key == GST_CLOCK_TIME_NONE || (sub.key != GST_CLOCK_TIME_NONE && sub.key > key))
+                break;
+            // The main frame of this sub buffer is gone
+            m_subs.pop_front();
+            on_stale(sub.buffer);
+        }
+        return NULL;
+    }
+
+    /**
+     * @brief Release the main frames at the front of the window that are complete, expired or timed out.
+     *        Frames are released in arrival order, a waiting frame holds back the frames after it.
+     */
+    template <typename F>
+    void release_ready(gint64 now, F on_release)
+    {
+        while (!m_frames.empty())
+        {
+            HailoPendingFrame &frame = m_frames.front();
+            if (!frame.complete() && !frame.expired && (now - frame.arrival_time) < m_timeout_us)
+                break;
+            release_front(now, on_release);
+        }
+    }
+
+    template <typename F>
+    void release_all(gint64 now, F on_release)
+    {
+        while (!m_frames.empty())
+            release_front(now, on_release);
+    }
+
+    /**
+     * @brief Drop everything that is pending (e.g. on flush), buffers are passed to on_drop.
+     */
+    template <typename F>
+    void clear(F on_drop)
+    {
+        for (HailoPendingFrame &frame : m_frames)
+            on_drop(frame.buffer);
+        for (HailoPendingSub &sub : m_subs)
+            on_drop(sub.buffer);
+        m_frames.clear();
+        m_subs.clear();
+    }
+
+    bool empty() const { return m_frames.empty() && m_subs.empty(); }
+
+    /**
+     * @brief Monotonic time (us) at which release_ready() releases the front main frame, -1 if there is none.
+     */
+    gint64 next_deadline() const
+    {
+        if (m_frames.empty())
+            return -1;
+        const HailoPendingFrame &frame = m_frames.front();
+        return (frame.complete() || frame.expired) ? frame.arrival_time : frame.arrival_time + m_timeout_us;
+    }
+
+    GstStructure *get_stats() const
+    {
+        guint64 released = m_matched + m_unmatched;
+        return gst_structure_new("match-stats",
+                                 "matched", G_TYPE_UINT64, m_matched,
+                                 "unmatched", G_TYPE_UINT64, m_unmatched,
+                                 "match-rate", G_TYPE_DOUBLE, (released > 0) ? (double)m_matched / released : 0.0,
+                                 "average-added-latency", G_TYPE_UINT64, (guint64)((released > 0) ? (m_total_latency_us / released) * GST_USECOND : 0),
+                                 NULL);
+    }
+
+private:
+    template <typename F>
+    void release_front(gint64 now, F on_release)
+    {
+        HailoPendingFrame frame = m_frames.front();
+        m_frames.pop_front();
+        if (frame.complete())
+            m_matched++;
+        else
+            m_unmatched++;
+        m_total_latency_us += MAX(now - frame.arrival_time, 0);
+        on_release(frame);
+    }
+
+    std::deque<HailoPendingFrame> m_frames;
+    std::deque<HailoPendingSub> m_subs;
+    guint64 m_tolerance = HAILO_MATCH_DEFAULT_TOLERANCE;
+    gint64 m_timeout_us = HAILO_MATCH_DEFAULT_TIMEOUT_MS * 1000;
+    guint m_window = HAILO_MATCH_DEFAULT_WINDOW;
+    guint m_sub_window = HAILO_MATCH_DEFAULT_SUB_WINDOW;
+    // Statistics
+    guint64 m_matched = 0;
+    guint64 m_unmatched = 0;
+    guint64 m_total_latency_us = 0;
+};
+
+/**
+ * @brief Calls a function whenever the next deadline of a matcher passed, so main frames are released on
+ *        their timeout even if no buffer arrives on either branch (e.g. the sub branch stopped, or at EOS).
+ *        The deadline is read under the mutex that guards the matcher, the function is called without it.
+ */
+class HailoMatchTimer
+{
+public:
+    ~HailoMatchTimer() { stop(); }
+
+    /**
+     * @param mutex The mutex that guards the matcher.
+     * @param next_deadline Returns the next deadline of the matcher (see HailoFrameMatcher::next_deadline), called with mutex held.
+     * @param on_deadline Releases the frames that are due, called without mutex held.
+     */
+    void start(std::mutex &mutex, std::function<gint64()> next_deadline, std::function<void()> on_deadline)
+    {
+        stop();
+        m_mutex = &mutex;
+        m_next_deadline = std::move(next_deadline);
+        m_on_deadline = std::move(on_deadline);
+        m_stop = false;
+        m_thread = std::thread(&HailoMatchTimer::run, this);
+    }
+
+    void stop()
+    {
+        if (!m_thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(*m_mutex);
+            m_stop = true;
+            m_cv.notify_one();
+        }
+        m_thread.join();
+    }
+
+    /**
+     * @brief The next deadline may have moved earlier (e.g. a main frame was added to an empty window), call with the mutex held.
+     */
+    void wake() { m_cv.notify_one(); }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(*m_mutex);
+        while (!m_stop)
+        {
+            gint64 deadline = m_next_deadline();
+            if (deadline < 0)
+            {
+                m_cv.wait(lock);
+                continue;
+            }
+            gint64 now = g_get_monotonic_time();
+            if (now < deadline)
+            {
+                m_cv.wait_for(lock, std::chrono::microseconds(deadline - now));
+                continue;
+            }
+            lock.unlock();
+            m_on_deadline();
+            lock.lock();
+        }
+    }
+
+    std::mutex *m_mutex = nullptr;
+    std::condition_variable m_cv;
+    std::function<gint64()> m_next_deadline;
+    std::function<void()> m_on_deadline;
+    bool m_stop = false;
+    std::thread m_thread;
+};
@@ -18,6 +18,7 @@
 #include <opencv2/opencv.hpp>
 #include "hailo_common.hpp"
 #include "hailo_objects.hpp"
+#include "region_anonymizer.hpp"
 
 // Transformations were taken from https://stackoverflow.com/questions/17892346/how-to-convert-rgb-yuv-rgb-both-ways.
 #define RGB2Y(R, G, B) CLIP((0.257 * (R) + 0.504 * (G) + 0.098 * (B)) + 16)
@@ -112,6 +113,25 @@ public:
     virtual void draw_line(cv::Point point1, cv::Point point2, const cv::Scalar color, int thickness, int line_type) = 0;
     virtual void draw_ellipse(cv::Point center, cv::Size axes, double angle, double start_angle, double end_angle, const cv::Scalar color, int thickness) = 0;
     virtual void blur(cv::Rect rect, cv::Size ksize) = 0;
+
+    /**
+     * @brief Get the channels of the mat as planes for the region anonymizer.
+     *
+     * @return std::vector<AnonymizePlane> - Empty if the format isn't supported.
+     */
+    virtual std::vector<AnonymizePlane> get_anonymize_planes() { return {}; }
+
+    /**
+     * @brief Blur or pixelate regions of the mat in place, including chroma for YUV formats.
+     *
+     * @param regions The regions, in native pixel coordinates.
+     * @param params The mode and kernel size.
+     * @param n_threads Threads anonymizing separate regions, 0 uses the OpenCV default.
+     */
+    void anonymize(const std::vector<AnonymizeRegion> &regions, const AnonymizeParams &params, uint n_threads = 0)
+    {
+        anonymize_regions(get_anonymize_planes(), regions, params, n_threads);
+    }
     /*
      * @brief Crop ROIs from the mat, note the present implementation is valid
      *        for interlaced formats. Planar formats such as NV12 should override.
@@ -200,6 +220,13 @@ public:
         cv::Mat target_roi = this->m_matrices[0](rect);
         cv::blur(target_roi, target_roi, ksize);
     }
+    virtual std::vector<AnonymizePlane> get_anonymize_planes()
+    {
+        std::vector<AnonymizePlane> planes;
+        for (int channel = 0; channel < 3; channel++)
+            planes.push_back({m_matrices[0].data + channel, (int)m_matrices[0].step, 3, (int)m_width, (int)m_height, 1, 1});
+        return planes;
+    }
     virtual ~HailoRGBMat()
     {
         for (auto &mat : m_matrices)
@@ -251,6 +278,14 @@ public:
         cv::Mat target_roi = this->m_matrices[0](rect);
         cv::blur(target_roi, target_roi, ksize);
     }
+    virtual std::vector<AnonymizePlane> get_anonymize_planes()
+    {
+        // The alpha channel is left as is
+        std::vector<AnonymizePlane> planes;
+        for (int channel = 0; channel < 3; channel++)
+            planes.push_back({m_matrices[0].data + channel, (int)m_matrices[0].step, 4, (int)m_width, (int)m_height, 1, 1});
+        return planes;
+    }
     virtual ~HailoRGBAMat()
     {
         m_matrices.clear();
@@ -290,7 +325,19 @@ public:
     virtual void draw_text(std::string text, cv::Point position, double font_scale, const cv::Scalar color){};
     virtual void draw_line(cv::Point point1, cv::Point point2, const cv::Scalar color, int thickness, int line_type){};
     virtual void draw_ellipse(cv::Point center, cv::Size axes, double angle, double start_angle, double end_angle, const cv::Scalar color, int thickness){};
-    virtual void blur(cv::Rect rect, cv::Size ksize){};
+    virtual void blur(cv::Rect rect, cv::Size ksize)
+    {
+        anonymize({rect}, {ANONYMIZE_MODE_BLUR, ksize.width}, 1);
+    }
+    virtual std::vector<AnonymizePlane> get_anonymize_planes()
+    {
+        // Macropixels are Y0 U Y1 V, the luma is every other byte and each chroma every fourth
+        uint8_t *data = m_matrices[0].data;
+        int stride = m_matrices[0].step;
+        return {{data, stride, 2, (int)m_native_width, (int)m_height, 1, 1},
+                {data + 1, stride, 4, (int)m_width, (int)m_height, 2, 1},
+                {data + 3, stride, 4, (int)m_width, (int)m_height, 2, 1}};
+    }
     virtual ~HailoYUY2Mat()
     {
         m_matrices.clear();
@@ -436,9 +483,16 @@ public:
 
     virtual void blur(cv::Rect rect, cv::Size ksize)
     {
-        cv::Rect y_rect = cv::Rect(rect.x, rect.y, rect.width, rect.height);
-        cv::Mat target_roi_y = this->m_matrices[0](y_rect);
-        cv::blur(target_roi_y, target_roi_y, ksize);
+        anonymize({rect}, {ANONYMIZE_MODE_BLUR, ksize.width}, 1);
+    }
+
+    virtual std::vector<AnonymizePlane> get_anonymize_planes()
+    {
+        uint8_t *uv = m_matrices[1].data;
+        int uv_stride = m_matrices[1].step;
+        return {{m_matrices[0].data, (int)m_matrices[0].step, 1, (int)m_native_width, (int)m_native_height, 1, 1},
+                {uv, uv_stride, 2, (int)m_native_width / 2, (int)m_native_height / 2, 2, 2},
+                {uv + 1, uv_stride, 2, (int)m_native_width / 2, (int)m_native_height / 2, 2, 2}};
     }
 
     virtual cv::Rect get_crop_rect(HailoROIPtr crop_roi)
@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file luma_sharpness.hpp
+ * @brief Sharpness (variance of the Laplacian) of a region of a HailoMat, used by croppers to
+ *        decide whether a detection is worth sending to the next network.
+ *
+ * The score is the one the croppers always computed: resize the region to the network input,
+ * optionally blur and normalize it, and take the variance of its CV_64F Laplacian, so the
+ * croppers' thresholds keep their calibration. Only the way to the gray image changed: for NV12
+ * and YUY2 the luma is read directly (and rescaled from the limited to the full range) instead of
+ * converting the whole crop to BGR first, which the BT.601 gray weights reduce back to the luma.
+ */
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "hailomat.hpp"
+#include "track_state_store.hpp"
+
+// Limited range luma (16-235) spans 219 levels, gray spans 255
+#define LUMA_SHARPNESS_YUV_TO_GRAY_SCALE (255.0 / 219.0)
+
+struct LumaSharpnessParams
+{
+    cv::Size size;          // The region is resized to the input of the next network
+    int interpolation;      // cv::resize interpolation
+    int rgb_to_gray;        // cv::cvtColor code of RGB/RGBA mats, the croppers were calibrated with different ones
+    bool blur;              // 3x3 gaussian blur before the Laplacian
+    bool normalize;         // Stretch the gray image so the brightest is 255
+};
+
+/**
+ * @brief Returns the variance of the Laplacian of the luma of a region.
+ *
+ * @param hailo_mat  -  std::shared_ptr<HailoMat>
+ *        The image.
+ *
+ * @param bbox  -  HailoBBox
+ *        The region, relative to the image.
+ *
+ * @param params  -  LumaSharpnessParams
+ *        The preprocessing of the region.
+ *
+ * @return float
+ *         The variance, 0 if the region is empty.
+ */
+inline float luma_sharpness(std::shared_ptr<HailoMat> hailo_mat, const HailoBBox &bbox, const LumaSharpnessParams &params)
+{
+    // Same rounding as HailoMat::crop
+    int width = hailo_mat->native_width();
+    int height = hailo_mat->native_height();
+    cv::Rect rect;
+    rect.x = CLAMP(bbox.xmin() * width, 0, width);
+    rect.y = CLAMP(bbox.ymin() * height, 0, height);
+    rect.width = CLAMP(bbox.width() * width, 0, width - rect.x);
+    rect.height = CLAMP(bbox.height() * height, 0, height - rect.y);
+    if (rect.width < 1 || rect.height < 1)
+        return 0.0f;
+
+    cv::Mat &mat = hailo_mat->get_matrices()[0];
+    cv::Mat resized;
+    cv::Mat gray;
+    switch (hailo_mat->get_type())
+    {
+    case HAILO_MAT_NV12:
+        cv::resize(mat(rect), resized, params.size, 0, 0, params.interpolation);
+        if (params.blur)
+            cv::GaussianBlur(resized, resized, cv::Size(3, 3), 0);
+        resized.convertTo(gray, CV_8U, LUMA_SHARPNESS_YUV_TO_GRAY_SCALE, -16 * LUMA_SHARPNESS_YUV_TO_GRAY_SCALE);
+        break;
+    case HAILO_MAT_YUY2:
+    {
+        // Y0 U Y1 V: seen as 2 channel pixels, the luma is the first channel
+        cv::Mat pixels = cv::Mat(mat.rows, width, CV_8UC2, mat.data, mat.step);
+        cv::Mat luma;
+        cv::extractChannel(pixels(rect), luma, 0);
+        cv::resize(luma, resized, params.size, 0, 0, params.interpolation);
+        if (params.blur)
+            cv::GaussianBlur(resized, resized, cv::Size(3, 3), 0);
+        resized.convertTo(gray, CV_8U, LUMA_SHARPNESS_YUV_TO_GRAY_SCALE, -16 * LUMA_SHARPNESS_YUV_TO_GRAY_SCALE);
+        break;
+    }
+    default:
+        // RGB and RGBA, cvtColor takes 3 or 4 channels with the same code
+        cv::resize(mat(rect), resized, params.size, 0, 0, params.interpolation);
+        if (params.blur)
+            cv::GaussianBlur(resized, resized, cv::Size(3, 3), 0);
+        cv::cvtColor(resized, gray, params.rgb_to_gray);
+        break;
+    }
+
+    if (params.normalize)
+        cv::normalize(gray, gray, 255, 0, cv::NORM_INF);
+
+    cv::Mat laplacian;
+    cv::Laplacian(gray, laplacian, CV_64F);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(laplacian, mean, stddev, cv::Mat());
+    return stddev.val[0] * stddev.val[0];
+}
+
+/**
+ * @brief Caches the sharpness of tracked detections, so a stable track is not scored on every frame.
+ *        Entries are kept per stream and track in a TrackStateStore, one per index of the detection within
+ *        the track (a vehicle may carry more than one plate), and every stream counts its own frames.
+ *        A detection is scored again once its score is max_age frames old, or when its box size changed
+ *        by more than max_size_change (relative). Tracks are dropped when the tracker removes them, or when
+ *        the store is full and they weren't looked up lately (e.g. the tracks of a stream that stopped).
+ */
+class LumaSharpnessCache
+{
+public:
+    LumaSharpnessCache(uint max_age, float max_size_change, size_t capacity = DEFAULT_TRACK_STATE_CAPACITY)
+        : m_max_age(max_age), m_max_size_change(max_size_change), m_entries(capacity){};
+
+    /**
+     * @brief Advance a stream to its next frame, call once per frame of the stream before its lookups.
+     */
+    void new_frame(const std::string &stream_id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_frames[stream_id];
+    }
+
+    /**
+     * @brief The sharpness of a detection, from the cache or computed by score() (and cached).
+     *        score() runs outside the locks, so the croppers of other streams aren't held up.
+     */
+    float get(const std::string &stream_id, int track_id, uint index, const HailoBBox &bbox, std::function<float()> score)
+    {
+        uint frame = current_frame(stream_id);
+        float cached_score = 0.0f;
+        bool cached = m_entries.update(stream_id, track_id, [&](std::vector<Entry> &entries) {
+            if (index >= entries.size() || !entries[index].scored)
+                return false;
+            const Entry &entry = entries[index];
+            cached_score = entry.score;
+            return frame - entry.scored_frame < m_max_age &&
+                   !size_changed(entry.width, bbox.width()) && !size_changed(entry.height, bbox.height());
+        });
+        if (cached)
+            return cached_score;
+
+        Entry entry = {score(), frame, bbox.width(), bbox.height(), true};
+        m_entries.update(stream_id, track_id, [&](std::vector<Entry> &entries) {
+            if (index >= entries.size())
+                entries.resize(index + 1);
+            entries[index] = entry;
+        });
+        return entry.score;
+    }
+
+    // Number of tracks with cached scores, across all streams
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+private:
+    struct Entry
+    {
+        float score;
+        uint scored_frame;
+        float width;
+        float height;
+        bool scored;
+    };
+
+    uint current_frame(const std::string &stream_id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_frames[stream_id];
+    }
+
+    bool size_changed(float cached, float current)
+    {
+        return std::abs(current - cached) > m_max_size_change * cached;
+    }
+
+    uint m_max_age;
+    float m_max_size_change;
+    std::map<std::string, uint> m_frames;
+    std::mutex m_mutex; // Guards m_frames, the store has its own lock
+    TrackStateStore<std::vector<Entry>> m_entries;
+};
@@ -0,0 +1,34 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file common/meta_format.hpp
+ * @brief The "format" property of the elements that export / import HailoROI meta (hailoexportzmq, hailoimportzmq).
+ */
+#pragma once
+
+#include <gst/gst.h>
+
+typedef enum
+{
+    GST_HAILO_META_FORMAT_JSON = 0,
+    GST_HAILO_META_FORMAT_BINARY = 1,
+} GstHailoMetaFormat;
+
+inline GType gst_hailo_meta_format_get_type(void)
+{
+    static GType meta_format_type = 0;
+    static const GEnumValue meta_formats[] = {
+        {GST_HAILO_META_FORMAT_JSON, "JSON, as written by encode_json", "json"},
+        {GST_HAILO_META_FORMAT_BINARY, "Compact little-endian binary, masks and matrices as raw blobs", "binary"},
+        {0, NULL, NULL},
+    };
+    if (g_once_init_enter(&meta_format_type))
+    {
+        GType type = g_enum_register_static("GstHailoMetaFormat", meta_formats);
+        g_once_init_leave(&meta_format_type, type);
+    }
+    return meta_format_type;
+}
+#define GST_TYPE_HAILO_META_FORMAT (gst_hailo_meta_format_get_type())
@@ -0,0 +1,421 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file common/region_anonymizer.hpp
+ * @brief Anonymization (box blur or pixelation) of rectangular and polygonal regions of an image,
+ *        working in place on the native planes of the image.
+ *
+ * An image is described as a list of channel planes: a base pointer, a row stride, the byte step between
+ * two samples of the channel and the subsampling of the channel relative to the luma. This lets NV12
+ * (Y, U, V of the interleaved UV plane), packed YUY2 (Y, U, V of the macropixels) and RGB/RGBA be handled
+ * by the same kernels, with chroma anonymized at its own resolution instead of being left sharp.
+ *
+ * Both modes cost O(pixels) regardless of the kernel size:
+ * - Blur is a separable box filter: each row is summed with a running (integral) sum, and the columns of
+ *   the row sums are kept as running sums while moving down the region.
+ * - Pixelation averages aligned blocks, each pixel is read once and written once.
+ * The inner loops are plain contiguous loops over a row, which the compiler vectorizes (NEON on the target).
+ *
+ * Regions are anonymized in parallel when, on every plane, the samples a region reads don't touch the samples
+ * another region writes. The others are anonymized one after the other, so a region never reads pixels another
+ * one is writing.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Largest blur radius, keeps the row sums in 16 bits
+#define ANONYMIZE_MAX_RADIUS 127
+#define ANONYMIZE_DEFAULT_KERNEL_SIZE 13
+// Averages multiply by a fixed point reciprocal of the kernel area, 255 * 2^24 still fits in 32 bits
+#define ANONYMIZE_RECIPROCAL_BITS 24
+
+typedef enum
+{
+    ANONYMIZE_MODE_BLUR = 0,
+    ANONYMIZE_MODE_PIXELATE = 1,
+} anonymize_mode_t;
+
+struct AnonymizeParams
+{
+    anonymize_mode_t mode = ANONYMIZE_MODE_BLUR;
+    int kernel_size = ANONYMIZE_DEFAULT_KERNEL_SIZE; // Blur kernel width / pixelation block size, in luma pixels
+};
+
+/**
+ * @brief A region to anonymize, in luma pixel coordinates.
+ *        If polygon is not empty only the pixels inside it are anonymized, rect then bounds the polygon.
+ */
+struct AnonymizeRegion
+{
+    cv::Rect rect;
+    std::vector<cv::Point> polygon;
+
+    AnonymizeRegion(cv::Rect rect) : rect(rect){};
+    AnonymizeRegion(const std::vector<cv::Point> &polygon) : rect(cv::boundingRect(polygon)), polygon(polygon){};
+};
+
+/**
+ * @brief One channel of an image.
+ */
+struct AnonymizePlane
+{
+    uint8_t *data;   // First sample of the channel
+    int stride;      // Bytes between two rows
+    int step;        // Bytes between two samples of a row, 1 to 4
+    int width;       // Samples in a row
+    int height;      // Rows
+    int subsample_x; // Luma pixels per sample, horizontally
+    int subsample_y; // Luma rows per row
+};
+
+namespace region_anonymizer_internal
+{
+    // Scratch buffers of a worker thread, reused between regions and frames
+    struct Scratch
+    {
+        std::vector<uint32_t> row_prefix;
+        std::vector<uint16_t> row_sums;
+        std::vector<uint32_t> column_sums;
+        std::vector<uint32_t> column_count;
+        std::vector<uint32_t> reciprocal;
+        std::vector<int> kernel_left;
+        std::vector<int> kernel_right;
+        std::vector<uint8_t> row_out;
+        std::vector<uint8_t> mask;
+    };
+
+    inline Scratch &scratch()
+    {
+        thread_local Scratch scratch;
+        return scratch;
+    }
+
+    /**
+     * @brief The region on a plane: its rect scaled by the subsampling (rounded outwards) and clipped,
+     *        and the polygon mask if it has one (nullptr otherwise).
+     */
+    inline cv::Rect plane_rect(const AnonymizePlane &plane, const AnonymizeRegion &region)
+    {
+        int x0 = region.rect.x / plane.subsample_x;
+        int y0 = region.rect.y / plane.subsample_y;
+        int x1 = (region.rect.x + region.rect.width + plane.subsample_x - 1) / plane.subsample_x;
+        int y1 = (region.rect.y + region.rect.height + plane.subsample_y - 1) / plane.subsample_y;
+        return cv::Rect(cv::Point(x0, y0), cv::Point(x1, y1)) & cv::Rect(0, 0, plane.width, plane.height);
+    }
+
+    inline const uint8_t *plane_mask(const AnonymizePlane &plane, const AnonymizeRegion &region, const cv::Rect &rect, Scratch &scratch)
+    {
+        if (region.polygon.empty())
+            return nullptr;
+        // Points are scaled to the plane with 4 fractional bits, so subsampled planes follow the outline closely
+        const int shift = 4;
+        std::vector<cv::Point> points;
+        points.reserve(region.polygon.size());
+        for (const cv::Point &point : region.polygon)
+            points.emplace_back(((point.x << shift) / plane.subsample_x) - (rect.x << shift),
+                                ((point.y << shift) / plane.subsample_y) - (rect.y << shift));
+        scratch.mask.assign(rect.area(), 0);
+        cv::Mat mask(rect.height, rect.width, CV_8UC1, scratch.mask.data());
+        cv::fillPoly(mask, std::vector<std::vector<cv::Point>>{points}, cv::Scalar(255), cv::LINE_8, shift);
+        return scratch.mask.data();
+    }
+
+    template <int STEP>
+    inline void write_row(uint8_t *dst, const uint8_t *values, const uint8_t *mask, int width)
+    {
+        if (mask == nullptr)
+        {
+            for (int x = 0; x < width; x++)
+                dst[x * STEP] = values[x];
+            return;
+        }
+        for (int x = 0; x < width; x++)
+            dst[x * STEP] = mask[x] ? values[x] : dst[x * STEP];
+    }
+
+    /**
+     * @brief Box blur of rect with a (2 * radius_x + 1) x (2 * radius_y + 1) kernel.
+     *        Samples outside the plane are left out of the average, so borders are not darkened.
+     *        Every sample the kernel reads is read before the row it belongs to is written:
+     *        rows are summed radius_y rows ahead of the row being written.
+     */
+    template <int STEP>
+    void blur(const AnonymizePlane &plane, const cv::Rect &rect, const uint8_t *mask, int radius_x, int radius_y, Scratch &scratch)
+    {
+        // The horizontal extent the row sums read, clipped to the plane
+        int in_x0 = std::max(rect.x - radius_x, 0);
+        int in_x1 = std::min(rect.x + rect.width + radius_x, plane.width);
+        int in_y0 = std::max(rect.y - radius_y, 0);
+        int in_y1 = std::min(rect.y + rect.height + radius_y, plane.height);
+        int in_width = in_x1 - in_x0;
+        int window = 2 * radius_y + 1;
+
+        scratch.row_prefix.resize(in_width + 1);
+        // The row sums of the last window rows, a ring of window rows
+        scratch.row_sums.resize(static_cast<size_t>(window) * rect.width);
+        scratch.column_sums.assign(rect.width, 0);
+        scratch.column_count.resize(rect.width);
+        scratch.reciprocal.resize(rect.width);
+        scratch.row_out.resize(rect.width);
+        // Where the kernel of each output column starts and ends in the prefix sums
+        scratch.kernel_left.resize(rect.width);
+        scratch.kernel_right.resize(rect.width);
+        for (int x = 0; x < rect.width; x++)
+        {
+            int left = std::max(rect.x + x - radius_x, 0);
+            int right = std::min(rect.x + x + radius_x + 1, plane.width);
+            scratch.kernel_left[x] = left - in_x0;
+            scratch.kernel_right[x] = right - in_x0;
+            scratch.column_count[x] = right - left;
+        }
+        // The output columns whose kernel isn't clipped by the plane borders
+        int kernel_width = 2 * radius_x + 1;
+        int inner_x0 = std::min(std::max(radius_x - rect.x, 0), rect.width);
+        int inner_x1 = std::max(std::min(plane.width - radius_x - rect.x, rect.width), inner_x0);
+
+        int ring_row = 0;
+        auto sum_row = [&](int y)
+        {
+            const uint8_t *src = plane.data + static_cast<size_t>(y) * plane.stride + static_cast<size_t>(in_x0) * STEP;
+            uint32_t *prefix = scratch.row_prefix.data();
+            uint32_t running = 0;
+            prefix[0] = 0;
+            for (int x = 0; x < in_width; x++)
+            {
+                running += src[x * STEP];
+                prefix[x + 1] = running;
+            }
+            uint16_t *sums = scratch.row_sums.data() + static_cast<size_t>(ring_row) * rect.width;
+            ring_row = (ring_row + 1 == window) ? 0 : ring_row + 1;
+            const int *left = scratch.kernel_left.data();
+            const int *right = scratch.kernel_right.data();
+            for (int x = 0; x < inner_x0; x++)
+                sums[x] = static_cast<uint16_t>(prefix[right[x]] - prefix[left[x]]);
+            // Away from the plane borders the kernel is a fixed offset, which keeps this loop contiguous
+            const uint32_t *inner_left = prefix + left[inner_x0];
+            const uint32_t *inner_right = prefix + left[inner_x0] + kernel_width;
+            for (int x = inner_x0; x < inner_x1; x++)
+                sums[x] = static_cast<uint16_t>(inner_right[x - inner_x0] - inner_left[x - inner_x0]);
+            for (int x = inner_x1; x < rect.width; x++)
+                sums[x] = static_cast<uint16_t>(prefix[right[x]] - prefix[left[x]]);
+            uint32_t *columns = scratch.column_sums.data();
+            for (int x = 0; x < rect.width; x++)
+                columns[x] += sums[x];
+        };
+        // Rows leave the window in the order they entered it
+        int oldest_row = 0;
+        auto drop_row = [&]()
+        {
+            const uint16_t *sums = scratch.row_sums.data() + static_cast<size_t>(oldest_row) * rect.width;
+            oldest_row = (oldest_row + 1 == window) ? 0 : oldest_row + 1;
+            uint32_t *columns = scratch.column_sums.data();
+            for (int x = 0; x < rect.width; x++)
+                columns[x] -= sums[x];
+        };
+
+        int rows_in_kernel = 0;
+        // Prime the window of the first output row
+        int next_in = in_y0;
+        for (; next_in < std::min(rect.y + radius_y + 1, in_y1); next_in++)
+            sum_row(next_in);
+
+        for (int y = rect.y; y < rect.y + rect.height; y++)
+        {
+            int top = std::max(y - radius_y, 0);
+            int bottom = std::min(y + radius_y + 1, plane.height);
+            if (bottom - top != rows_in_kernel)
+            {
+                // Only changes near the top and bottom of the plane
+                rows_in_kernel = bottom - top;
+                for (int x = 0; x < rect.width; x++)
+                    scratch.reciprocal[x] = ((1u << ANONYMIZE_RECIPROCAL_BITS) + (scratch.column_count[x] * rows_in_kernel) / 2) /
+                                            (scratch.column_count[x] * rows_in_kernel);
+            }
+            const uint32_t *columns = scratch.column_sums.data();
+            const uint32_t *reciprocal = scratch.reciprocal.data();
+            uint8_t *out = scratch.row_out.data();
+            for (int x = 0; x < rect.width; x++)
+                out[x] = static_cast<uint8_t>((columns[x] * reciprocal[x] + (1u << (ANONYMIZE_RECIPROCAL_BITS - 1))) >> ANONYMIZE_RECIPROCAL_BITS);
+
+            // Slide the window down before writing, row y is still needed by the rows below it otherwise
+            if (y - radius_y >= in_y0)
+                drop_row();
+            if (next_in < in_y1)
+                sum_row(next_in++);
+
+            uint8_t *dst = plane.data + static_cast<size_t>(y) * plane.stride + static_cast<size_t>(rect.x) * STEP;
+            write_row<STEP>(dst, out, mask ? mask + static_cast<size_t>(y - rect.y) * rect.width : nullptr, rect.width);
+        }
+    }
+
+    /**
+     * @brief Replace every block x block tile of rect (aligned to the rect) with its average.
+     *        Tiles at the right and bottom edges of rect are cut, and averaged over what is left of them.
+     */
+    template <int STEP>
+    void pixelate(const AnonymizePlane &plane, const cv::Rect &rect, const uint8_t *mask, int block_x, int block_y, Scratch &scratch)
+    {
+        int tiles_x = (rect.width + block_x - 1) / block_x;
+        scratch.column_sums.resize(rect.width);
+        scratch.row_out.resize(rect.width);
+
+        for (int tile_y = rect.y; tile_y < rect.y + rect.height; tile_y += block_y)
+        {
+            int rows = std::min(block_y, rect.y + rect.height - tile_y);
+            // Sum the rows of the tile row per column first, the inner loop stays contiguous
+            uint32_t *columns = scratch.column_sums.data();
+            std::fill(columns, columns + rect.width, 0);
+            for (int y = tile_y; y < tile_y + rows; y++)
+            {
+                const uint8_t *src = plane.data + static_cast<size_t>(y) * plane.stride + static_cast<size_t>(rect.x) * STEP;
+                for (int x = 0; x < rect.width; x++)
+                    columns[x] += src[x * STEP];
+            }
+            uint8_t *out = scratch.row_out.data();
+            for (int tile = 0; tile < tiles_x; tile++)
+            {
+                int x0 = tile * block_x;
+                int x1 = std::min(x0 + block_x, rect.width);
+                uint32_t sum = 0;
+                for (int x = x0; x < x1; x++)
+                    sum += columns[x];
+                uint32_t count = (x1 - x0) * rows;
+                std::fill(out + x0, out + x1, static_cast<uint8_t>((sum + count / 2) / count));
+            }
+            for (int y = tile_y; y < tile_y + rows; y++)
+            {
+                uint8_t *dst = plane.data + static_cast<size_t>(y) * plane.stride + static_cast<size_t>(rect.x) * STEP;
+                write_row<STEP>(dst, out, mask ? mask + static_cast<size_t>(y - rect.y) * rect.width : nullptr, rect.width);
+            }
+        }
+    }
+
+    // How far around its rect a region reads on a plane, in samples: the blur radius, nothing for pixelation
+    inline cv::Size plane_reach(const AnonymizePlane &plane, const AnonymizeParams &params)
+    {
+        if (params.mode == ANONYMIZE_MODE_PIXELATE)
+            return cv::Size(0, 0);
+        int radius = params.kernel_size / 2;
+        return cv::Size(std::min(std::max(radius / plane.subsample_x, radius ? 1 : 0), ANONYMIZE_MAX_RADIUS),
+                        std::min(std::max(radius / plane.subsample_y, radius ? 1 : 0), ANONYMIZE_MAX_RADIUS));
+    }
+
+    // The sample step is a template parameter so the row loops are compiled (and vectorized) per layout
+    template <int STEP>
+    void anonymize_plane(const AnonymizePlane &plane, const cv::Rect &rect, const uint8_t *mask, const AnonymizeParams &params, Scratch &scratch)
+    {
+        if (params.mode == ANONYMIZE_MODE_PIXELATE)
+        {
+            int block_x = std::max(params.kernel_size / plane.subsample_x, 1);
+            int block_y = std::max(params.kernel_size / plane.subsample_y, 1);
+            pixelate<STEP>(plane, rect, mask, block_x, block_y, scratch);
+        }
+        else
+        {
+            cv::Size radius = plane_reach(plane, params);
+            blur<STEP>(plane, rect, mask, radius.width, radius.height, scratch);
+        }
+    }
+
+    inline void anonymize_region(const std::vector<AnonymizePlane> &planes, const AnonymizeRegion &region, const AnonymizeParams &params)
+    {
+        Scratch &buffers = scratch();
+        for (const AnonymizePlane &plane : planes)
+        {
+            cv::Rect rect = plane_rect(plane, region);
+            if (rect.empty())
+                continue;
+            const uint8_t *mask = plane_mask(plane, region, rect, buffers);
+            switch (plane.step)
+            {
+            case 1:
+                anonymize_plane<1>(plane, rect, mask, params, buffers);
+                break;
+            case 2:
+                anonymize_plane<2>(plane, rect, mask, params, buffers);
+                break;
+            case 3:
+                anonymize_plane<3>(plane, rect, mask, params, buffers);
+                break;
+            case 4:
+                anonymize_plane<4>(plane, rect, mask, params, buffers);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Which regions can't be anonymized in parallel with the others: on some plane the samples the region reads
+     *        (its rect on the plane, grown by the reach) touch the samples another region writes.
+     *        This is checked per plane because the rects are rounded outwards to the subsampling, so regions that
+     *        are apart in luma can still share a chroma sample.
+     */
+    inline std::vector<bool> dependent_regions(const std::vector<AnonymizePlane> &planes, const std::vector<AnonymizeRegion> &regions,
+                                               const AnonymizeParams &params)
+    {
+        std::vector<bool> dependent(regions.size(), false);
+        std::vector<cv::Rect> rects(regions.size());
+        for (const AnonymizePlane &plane : planes)
+        {
+            for (size_t i = 0; i < regions.size(); i++)
+                rects[i] = plane_rect(plane, regions[i]);
+            cv::Size reach = plane_reach(plane, params);
+            for (size_t i = 0; i < regions.size(); i++)
+            {
+                if (dependent[i] || rects[i].empty())
+                    continue;
+                cv::Rect read_rect(rects[i].x - reach.width, rects[i].y - reach.height,
+                                   rects[i].width + 2 * reach.width, rects[i].height + 2 * reach.height);
+                for (size_t j = 0; j < regions.size() && !dependent[i]; j++)
+                    dependent[i] = (i != j) && !(read_rect & rects[j]).empty();
+            }
+        }
+        return dependent;
+    }
+} // namespace region_anonymizer_internal
+
+/**
+ * @brief Anonymize regions of an image in place.
+ *
+ * @param planes The channels of the image.
+ * @param regions The regions, in luma pixel coordinates, clipped to the image.
+ * @param params The mode and kernel size.
+ * @param n_threads Threads anonymizing separate regions, 0 uses the OpenCV default and 1 stays on the calling thread.
+ */
+inline void anonymize_regions(const std::vector<AnonymizePlane> &planes, const std::vector<AnonymizeRegion> &regions,
+                              const AnonymizeParams &params, uint n_threads = 0)
+{
+    if (planes.empty() || regions.empty() || params.kernel_size <= 1)
+        return;
+
+    std::vector<bool> is_dependent = region_anonymizer_internal::dependent_regions(planes, regions, params);
+    std::vector<AnonymizeRegion> independent;
+    std::vector<AnonymizeRegion> dependent;
+    for (size_t i = 0; i < regions.size(); i++)
+        (is_dependent[i] ? dependent : independent).push_back(regions[i]);
+
+    if (independent.size() > 1 && n_threads != 1)
+    {
+        if (n_threads > 0)
+            cv::setNumThreads(n_threads);
+        cv::parallel_for_(cv::Range(0, independent.size()), [&](const cv::Range &range)
+                          {
+                              for (int i = range.start; i < range.end; i++)
+                                  region_anonymizer_internal::anonymize_region(planes, independent[i], params); });
+    }
+    else
+    {
+        for (const AnonymizeRegion &region : independent)
+            region_anonymizer_internal::anonymize_region(planes, region, params);
+    }
+    for (const AnonymizeRegion &region : dependent)
+        region_anonymizer_internal::anonymize_region(planes, region, params);
+}
@@ -0,0 +1,289 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <signal.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "common/shm_meta_ring.hpp"
+
+#define SHM_META_RING_ALIGNMENT 64
+
+namespace shm_meta_ring
+{
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words have to be plain 32 bit words");
+
+    static std::string segment_name(const std::string &name)
+    {
+        return (name.empty() || name[0] != '/') ? "/" + name : name;
+    }
+
+    static size_t slot_stride(uint32_t slot_size)
+    {
+        size_t stride = sizeof(SlotHeader) + slot_size;
+        return (stride + SHM_META_RING_ALIGNMENT - 1) / SHM_META_RING_ALIGNMENT * SHM_META_RING_ALIGNMENT;
+    }
+
+    static SegmentId segment_id(const struct stat &segment_stat)
+    {
+        SegmentId id;
+        id.device = segment_stat.st_dev;
+        id.inode = segment_stat.st_ino;
+        return id;
+    }
+
+    static bool same_segment(const SegmentId &first, const SegmentId &second)
+    {
+        return first.device == second.device && first.inode == second.inode;
+    }
+
+    /**
+     * @brief Whether name refers to the segment id. Errors other than a missing name count as a match,
+     *        so a transient failure doesn't tear down a working ring.
+     */
+    static bool name_refers_to(const std::string &name, const SegmentId &id)
+    {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            return errno != ENOENT;
+        struct stat segment_stat;
+        bool refers = fstat(fd, &segment_stat) != 0 || same_segment(segment_id(segment_stat), id);
+        close(fd);
+        return refers;
+    }
+
+    static void *map_segment(int fd, size_t size)
+    {
+        void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        return (mapping == MAP_FAILED) ? nullptr : mapping;
+    }
+
+    // The futexes are shared between processes, so the non-private operations are used
+    static void futex_wake_all(std::atomic<uint32_t> *word)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    static void futex_wait(std::atomic<uint32_t> *word, uint32_t expected, int timeout_ms)
+    {
+        struct timespec timeout;
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT, expected, (timeout_ms < 0) ? nullptr : &timeout, nullptr, 0);
+    }
+
+    //******************************************************************
+    // WRITER
+    //******************************************************************
+    Writer::Writer(const std::string &name, uint32_t slot_count, uint32_t slot_size, mode_t mode) : m_name(segment_name(name))
+    {
+        if (slot_count == 0 || slot_size == 0)
+            throw std::runtime_error("shm meta ring needs at least one slot of at least one byte");
+
+        // Readers still mapping a previous ring keep their mapping until they reopen
+        shm_unlink(m_name.c_str());
+        int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, mode);
+        if (fd < 0)
+            throw std::runtime_error("shm_open of " + m_name + " failed: " + strerror(errno));
+
+        m_slot_stride = slot_stride(slot_size);
+        m_mapping_size = sizeof(RingHeader) + m_slot_stride * slot_count;
+        void *mapping = nullptr;
+        struct stat segment_stat;
+        // The umask applies to shm_open, fchmod sets the mode that was asked for
+        if (fchmod(fd, mode) == 0 && fstat(fd, &segment_stat) == 0 && ftruncate(fd, m_mapping_size) == 0)
+        {
+            m_segment = segment_id(segment_stat);
+            mapping = map_segment(fd, m_mapping_size);
+        }
+        int error = errno;
+        close(fd);
+        if (!mapping)
+        {
+            shm_unlink(m_name.c_str());
+            throw std::runtime_error("mapping " + m_name + " failed: " + strerror(error));
+        }
+
+        // ftruncate zero-fills the segment, so every slot starts as "never written" (state 0)
+        m_header = new (mapping) RingHeader();
+        m_slots = static_cast<uint8_t *>(mapping) + sizeof(RingHeader);
+        for (uint32_t i = 0; i < slot_count; i++)
+            new (m_slots + i * m_slot_stride) SlotHeader();
+        m_header->version = SHM_META_RING_VERSION;
+        m_header->slot_count = slot_count;
+        m_header->slot_size = slot_size;
+        m_header->writer_pid = getpid();
+        m_header->magic.store(SHM_META_RING_MAGIC, std::memory_order_release);
+    }
+
+    Writer::~Writer()
+    {
+        m_header->closed.store(1, std::memory_order_release);
+        m_header->futex_word.fetch_add(1);
+        futex_wake_all(&m_header->futex_word);
+        munmap(m_header, m_mapping_size);
+        // A writer that started since owns the name now
+        if (name_refers_to(m_name, m_segment))
+            shm_unlink(m_name.c_str());
+    }
+
+    bool Writer::publish(const uint8_t *data, size_t size, uint64_t pts)
+    {
+        if (size > m_header->slot_size)
+            return false;
+
+        uint64_t sequence = m_header->write_sequence.load(std::memory_order_relaxed);
+        SlotHeader *slot = reinterpret_cast<SlotHeader *>(m_slots + (sequence % m_header->slot_count) * m_slot_stride);
+
+        // Seqlock write: readers that see the odd state, or a different state after copying, retry or drop
+        slot->state.store(2 * sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot->pts = pts;
+        slot->size = size;
+        std::memcpy(reinterpret_cast<uint8_t *>(slot + 1), data, size);
+        slot->state.store(2 * sequence + 2, std::memory_order_release);
+
+        m_header->write_sequence.store(sequence + 1, std::memory_order_release);
+        // Sequentially consistent with the sleepers count of the readers: either the reader sees the new word
+        // and doesn't sleep, or the writer sees the sleeper and wakes it
+        m_header->futex_word.fetch_add(1);
+        if (m_header->sleepers.load() != 0)
+            futex_wake_all(&m_header->futex_word);
+        return true;
+    }
+
+    //******************************************************************
+    // READER
+    //******************************************************************
+    Reader::Reader(const std::string &name) : m_name(segment_name(name))
+    {
+        int fd = shm_open(m_name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+            throw std::runtime_error("shm_open of " + m_name + " failed: " + strerror(errno));
+
+        struct stat segment_stat;
+        void *mapping = nullptr;
+        if (fstat(fd, &segment_stat) == 0 && (size_t)segment_stat.st_size >= sizeof(RingHeader))
+        {
+            m_segment = segment_id(segment_stat);
+            m_mapping_size = segment_stat.st_size;
+            mapping = map_segment(fd, m_mapping_size);
+        }
+        close(fd);
+        if (!mapping)
+            throw std::runtime_error("mapping " + m_name + " failed");
+
+        m_header = static_cast<RingHeader *>(mapping);
+        if (m_header->magic.load(std::memory_order_acquire) != SHM_META_RING_MAGIC ||
+            m_header->version != SHM_META_RING_VERSION ||
+            sizeof(RingHeader) + slot_stride(m_header->slot_size) * m_header->slot_count > m_mapping_size)
+        {
+            munmap(mapping, m_mapping_size);
+            throw std::runtime_error(m_name + " is not an initialized shm meta ring of version " + std::to_string(SHM_META_RING_VERSION));
+        }
+        m_slots = static_cast<const uint8_t *>(mapping) + sizeof(RingHeader);
+        m_slot_stride = slot_stride(m_header->slot_size);
+        m_next_sequence = m_header->write_sequence.load(std::memory_order_acquire);
+    }
+
+    Reader::~Reader()
+    {
+        munmap(m_header, m_mapping_size);
+    }
+
+    bool Reader::writer_gone() const
+    {
+        if (writer_closed())
+            return true;
+        // The writer died without closing the ring
+        pid_t pid = m_header->writer_pid;
+        if (pid > 0 && kill(pid, 0) != 0 && errno == ESRCH)
+            return true;
+        return !name_refers_to(m_name, m_segment);
+    }
+
+    bool Reader::try_read(Message &message)
+    {
+        uint32_t slot_count = m_header->slot_count;
+        while (true)
+        {
+            uint64_t write_sequence = m_header->write_sequence.load(std::memory_order_acquire);
+            if (write_sequence == m_next_sequence)
+                return false;
+            // Messages a full ring behind were overwritten
+            if (write_sequence - m_next_sequence > slot_count)
+            {
+                m_dropped += write_sequence - slot_count - m_next_sequence;
+                m_next_sequence = write_sequence - slot_count;
+            }
+
+            const SlotHeader *slot = reinterpret_cast<const SlotHeader *>(m_slots + (m_next_sequence % slot_count) * m_slot_stride);
+            uint64_t state = slot->state.load(std::memory_order_acquire);
+            if (state == 2 * m_next_sequence + 2)
+            {
+                uint32_t size = std::min(slot->size, m_header->slot_size);
+                message.pts = slot->pts;
+                message.data.resize(size);
+                std::memcpy(message.data.data(), reinterpret_cast<const uint8_t *>(slot + 1), size);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot->state.load(std::memory_order_relaxed) == state)
+                {
+                    message.sequence = m_next_sequence++;
+                    return true;
+                }
+            }
+            // The writer lapped this reader and is rewriting the slot
+            m_dropped++;
+            m_next_sequence++;
+        }
+    }
+
+    bool Reader::next(Message &message, int timeout_ms)
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto deadline = now + std::chrono::milliseconds(timeout_ms);
+        auto liveness_check = now + std::chrono::milliseconds(SHM_META_RING_LIVENESS_INTERVAL_MS);
+        while (true)
+        {
+            uint32_t word = m_header->futex_word.load();
+            if (try_read(message))
+                return true;
+            if (writer_closed())
+                return false;
+
+            // A writer that died or was replaced never wakes this reader, so the wait is sliced
+            now = std::chrono::steady_clock::now();
+            if (now >= liveness_check)
+            {
+                if (writer_gone())
+                    return false;
+                liveness_check = now + std::chrono::milliseconds(SHM_META_RING_LIVENESS_INTERVAL_MS);
+            }
+            int wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(liveness_check - now).count() + 1;
+            if (timeout_ms >= 0)
+            {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+                if (remaining <= 0)
+                    return false;
+                wait_ms = std::min<int>(wait_ms, remaining);
+            }
+            m_header->sleepers.fetch_add(1);
+            // Returns at once if a message was published since word was read
+            if (m_header->futex_word.load() == word)
+                futex_wait(&m_header->futex_word, word, wait_ms);
+            m_header->sleepers.fetch_sub(1);
+        }
+    }
+}
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file common/shm_meta_ring.hpp
+ * @brief A shared-memory ring of metadata messages between processes on the same machine
+ *        (hailoexportshm -> hailoimportshm).
+ *
+ * One writer publishes messages into a ring of fixed size slots in a named POSIX shared-memory segment,
+ * any number of readers follow it, each at its own pace. The writer never waits for the readers: a reader
+ * that falls a full ring behind loses the messages that were overwritten (they are counted as dropped).
+ * Every slot is a seqlock, so a reader detects a slot that was overwritten while it copied it.
+ * Readers sleep on a futex in the segment, and the writer only makes the wake syscall when someone sleeps.
+ * A waiting reader checks every SHM_META_RING_LIVENESS_INTERVAL_MS that its writer is still there: that it didn't
+ * close the ring, that its process is alive and that the name still refers to the segment the reader mapped
+ * (a restarted writer creates a new segment under the same name).
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#define SHM_META_RING_MAGIC 0x474e5248 // "HRNG"
+#define SHM_META_RING_VERSION 1
+#define SHM_META_RING_DEFAULT_SLOTS 16
+#define SHM_META_RING_DEFAULT_SLOT_SIZE (256 * 1024)
+// Only the user that runs the exporter can open the ring by default
+#define SHM_META_RING_DEFAULT_MODE 0600
+#define SHM_META_RING_LIVENESS_INTERVAL_MS 200
+
+namespace shm_meta_ring
+{
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring needs lock-free 64 bit atomics");
+
+    struct alignas(64) RingHeader
+    {
+        std::atomic<uint32_t> magic; // Set last by the writer, once the ring is initialized
+        uint32_t version;
+        uint32_t slot_count;
+        uint32_t slot_size;
+        std::atomic<uint32_t> closed; // Set by the writer when it goes away
+        int32_t writer_pid;
+        alignas(64) std::atomic<uint64_t> write_sequence; // Number of published messages
+        alignas(64) std::atomic<uint32_t> futex_word;     // Changes on every publish, readers sleep on it
+        std::atomic<uint32_t> sleepers;
+    };
+
+    struct alignas(64) SlotHeader
+    {
+        std::atomic<uint64_t> state; // 2n+1 while message n is written, 2n+2 once it is
+        uint64_t pts;
+        uint32_t size;
+    };
+
+    struct Message
+    {
+        uint64_t sequence;
+        uint64_t pts;
+        std::vector<uint8_t> data; // Reused between reads, keeps its capacity
+    };
+
+    // Identifies a segment, a segment created again under the same name is a different file
+    struct SegmentId
+    {
+        dev_t device = 0;
+        ino_t inode = 0;
+    };
+
+    /**
+     * @brief The single writer of a ring. Creates the segment with the permissions of mode (replacing a stale one
+     *        of the same name) and removes it when destroyed, unless another writer replaced it in the meantime.
+     *        Throws std::runtime_error if the segment can't be created.
+     */
+    class Writer
+    {
+    public:
+        Writer(const std::string &name, uint32_t slot_count, uint32_t slot_size, mode_t mode = SHM_META_RING_DEFAULT_MODE);
+        ~Writer();
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        /**
+         * @brief Publish a message, never blocks.
+         *
+         * @return false if the message is larger than a slot (it is not published).
+         */
+        bool publish(const uint8_t *data, size_t size, uint64_t pts);
+
+        uint32_t slot_size() const { return m_header->slot_size; }
+        uint64_t published() const { return m_header->write_sequence.load(std::memory_order_relaxed); }
+
+    private:
+        std::string m_name;
+        SegmentId m_segment;
+        size_t m_mapping_size = 0;
+        RingHeader *m_header = nullptr;
+        uint8_t *m_slots = nullptr;
+        size_t m_slot_stride = 0;
+    };
+
+    /**
+     * @brief A reader of a ring. Starts at the next message to be published.
+     *        Throws std::runtime_error if there is no (initialized) ring of that name.
+     */
+    class Reader
+    {
+    public:
+        explicit Reader(const std::string &name);
+        ~Reader();
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        /**
+         * @brief Copy the next message, waiting for it up to timeout_ms (-1 waits as long as the writer lives).
+         *
+         * @return false on timeout, or if the writer is gone (see writer_gone).
+         */
+        bool next(Message &message, int timeout_ms);
+
+        bool writer_closed() const { return m_header->closed.load(std::memory_order_acquire) != 0; }
+
+        /**
+         * @brief Whether no more messages will come through this ring: the writer closed it, its process died
+         *        or the name now refers to another segment (or to none). A reader in this state has to be reopened.
+         */
+        bool writer_gone() const;
+        uint64_t dropped() const { return m_dropped; }
+
+    private:
+        bool try_read(Message &message);
+
+        std::string m_name;
+        SegmentId m_segment;
+        size_t m_mapping_size = 0;
+        RingHeader *m_header = nullptr;
+        const uint8_t *m_slots = nullptr;
+        size_t m_slot_stride = 0;
+        uint64_t m_next_sequence = 0;
+        uint64_t m_dropped = 0;
+    };
+}
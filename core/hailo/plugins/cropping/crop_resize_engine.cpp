@@ -0,0 +1,351 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include <algorithm>
+#include <cmath>
+#include "cropping/crop_resize_engine.hpp"
+#include "hailomat.hpp"
+
+// Bilinear weights are 8 bit fixed point, horizontal results fit in uint16 and vertical ones in uint32
+#define CROP_RESIZE_WEIGHT_BITS (8)
+#define CROP_RESIZE_WEIGHT_ONE (1 << CROP_RESIZE_WEIGHT_BITS)
+#define CROP_RESIZE_MAX_CHANNELS (4)
+
+static const int RGB_LETTERBOX_COLOR = 114;
+static const int YUV_LETTERBOX_COLOR = 130;
+
+/**
+ * @brief How one plane of a format is laid out in memory.
+ *        YUY2 is described as two planes sharing the same memory:
+ *        the luma bytes and the interleaved U/V bytes of every macro pixel.
+ */
+struct PlaneLayout
+{
+    int plane;         // Index of the plane in CropResizeImage
+    int byte_offset;   // Offset of the first channel inside a pixel
+    int pixel_step;    // Bytes between two pixels
+    int channels;      // Number of channels to resample
+    int channel_step;  // Bytes between two channels of the same pixel
+    int x_div;         // Horizontal subsampling
+    int y_div;         // Vertical subsampling
+};
+
+struct FormatLayout
+{
+    int num_planes;
+    PlaneLayout planes[2];
+    uint8_t letterbox_color[2][CROP_RESIZE_MAX_CHANNELS];
+};
+
+/**
+ * @brief Per thread scratch memory, kept between calls so a steady state crop does not allocate.
+ */
+struct ResizeScratch
+{
+    std::vector<int> src_offset0;
+    std::vector<int> src_offset1;
+    std::vector<uint16_t> x_weights;
+    std::vector<uint16_t> rows[2];
+    std::vector<uint8_t> out_row;
+};
+
+static bool get_format_layout(GstVideoFormat format, FormatLayout &layout)
+{
+    uint8_t y = RGB2Y(YUV_LETTERBOX_COLOR, YUV_LETTERBOX_COLOR, YUV_LETTERBOX_COLOR);
+    uint8_t u = RGB2U(YUV_LETTERBOX_COLOR, YUV_LETTERBOX_COLOR, YUV_LETTERBOX_COLOR);
+    uint8_t v = RGB2V(YUV_LETTERBOX_COLOR, YUV_LETTERBOX_COLOR, YUV_LETTERBOX_COLOR);
+
+    switch (format)
+    {
+    case GST_VIDEO_FORMAT_NV12:
+        layout = {2, {{0, 0, 1, 1, 1, 1, 1}, {1, 0, 2, 2, 1, 2, 2}}, {{y}, {u, v}}};
+        return true;
+    case GST_VIDEO_FORMAT_YUY2:
+        layout = {2, {{0, 0, 2, 1, 1, 1, 1}, {0, 1, 4, 2, 2, 2, 1}}, {{y}, {u, v}}};
+        return true;
+    case GST_VIDEO_FORMAT_RGB:
+        layout = {1, {{0, 0, 3, 3, 1, 1, 1}}, {{RGB_LETTERBOX_COLOR, RGB_LETTERBOX_COLOR, RGB_LETTERBOX_COLOR}}};
+        return true;
+    case GST_VIDEO_FORMAT_RGBA:
+        layout = {1, {{0, 0, 4, 4, 1, 1, 1}}, {{RGB_LETTERBOX_COLOR, RGB_LETTERBOX_COLOR, RGB_LETTERBOX_COLOR, 255}}};
+        return true;
+    default:
+        return false;
+    }
+}
+
+static inline uint8_t *plane_pixel(const CropResizeImage &image, const PlaneLayout &layout, int x, int y)
+{
+    return image.planes[layout.plane] + (size_t)y * image.strides[layout.plane] + x * layout.pixel_step + layout.byte_offset;
+}
+
+static void fill_plane_rect(const CropResizeImage &image, const PlaneLayout &layout, cv::Rect rect, const uint8_t *color)
+{
+    for (int y = rect.y; y < rect.y + rect.height; y++)
+    {
+        uint8_t *pixel = plane_pixel(image, layout, rect.x, y);
+        for (int x = 0; x < rect.width; x++, pixel += layout.pixel_step)
+        {
+            for (int c = 0; c < layout.channels; c++)
+                pixel[c * layout.channel_step] = color[c];
+        }
+    }
+}
+
+/**
+ * @brief Bilinear resize of src_rect of one input plane into dst_rect of one output plane.
+ *        Each source row is interpolated horizontally at most once (cached between output rows),
+ *        then two cached rows are blended vertically. Both inner loops are branch free over
+ *        contiguous buffers so the compiler vectorizes them on x86 and arm alike.
+ *        Sampling positions follow cv::resize INTER_LINEAR.
+ */
+static void resize_plane_bilinear(const CropResizeImage &src, const PlaneLayout &layout, cv::Rect src_rect,
+                                  const CropResizeImage &dst, cv::Rect dst_rect, ResizeScratch &scratch)
+{
+    const int channels = layout.channels;
+    const int row_len = dst_rect.width * channels;
+    const float scale_x = (float)src_rect.width / dst_rect.width;
+    const float scale_y = (float)src_rect.height / dst_rect.height;
+
+    scratch.src_offset0.resize(row_len);
+    scratch.src_offset1.resize(row_len);
+    scratch.x_weights.resize(row_len);
+    scratch.rows[0].resize(row_len);
+    scratch.rows[1].resize(row_len);
+    scratch.out_row.resize(row_len);
+
+    // Horizontal sampling table, shared by all rows
+    for (int dx = 0; dx < dst_rect.width; dx++)
+    {
+        float sx = (dx + 0.5f) * scale_x - 0.5f;
+        int x0 = (int)std::floor(sx);
+        float fx = sx - x0;
+        if (x0 < 0)
+        {
+            x0 = 0;
+            fx = 0.0f;
+        }
+        int x1 = x0 + 1;
+        if (x1 >= src_rect.width)
+        {
+            x0 = x1 = src_rect.width - 1;
+            fx = 0.0f;
+        }
+        uint16_t weight = (uint16_t)std::lround(fx * CROP_RESIZE_WEIGHT_ONE);
+        for (int c = 0; c < channels; c++)
+        {
+            scratch.src_offset0[dx * channels + c] = (src_rect.x + x0) * layout.pixel_step + c * layout.channel_step;
+            scratch.src_offset1[dx * channels + c] = (src_rect.x + x1) * layout.pixel_step + c * layout.channel_step;
+            scratch.x_weights[dx * channels + c] = weight;
+        }
+    }
+
+    auto interpolate_row = [&](int src_y, std::vector<uint16_t> &row) {
+        const uint8_t *src_row = plane_pixel(src, layout, 0, src_rect.y + src_y);
+        const int *offset0 = scratch.src_offset0.data();
+        const int *offset1 = scratch.src_offset1.data();
+        const uint16_t *weights = scratch.x_weights.data();
+        uint16_t *out = row.data();
+        for (int i = 0; i < row_len; i++)
+            out[i] = src_row[offset0[i]] * (CROP_RESIZE_WEIGHT_ONE - weights[i]) + src_row[offset1[i]] * weights[i];
+    };
+
+    const bool packed_output = (layout.pixel_step == channels && layout.channel_step == 1);
+    int cached_rows[2] = {-1, -1};
+    for (int dy = 0; dy < dst_rect.height; dy++)
+    {
+        float sy = (dy + 0.5f) * scale_y - 0.5f;
+        int y0 = (int)std::floor(sy);
+        float fy = sy - y0;
+        if (y0 < 0)
+        {
+            y0 = 0;
+            fy = 0.0f;
+        }
+        int y1 = y0 + 1;
+        if (y1 >= src_rect.height)
+        {
+            y0 = y1 = src_rect.height - 1;
+            fy = 0.0f;
+        }
+
+        // Reuse the rows interpolated for the previous output row when possible
+        if (cached_rows[0] != y0 && cached_rows[1] == y0)
+        {
+            std::swap(scratch.rows[0], scratch.rows[1]);
+            std::swap(cached_rows[0], cached_rows[1]);
+        }
+        if (cached_rows[0] != y0)
+        {
+            interpolate_row(y0, scratch.rows[0]);
+            cached_rows[0] = y0;
+        }
+        if (cached_rows[1] != y1)
+        {
+            interpolate_row(y1, scratch.rows[1]);
+            cached_rows[1] = y1;
+        }
+
+        const uint32_t weight1 = (uint32_t)std::lround(fy * CROP_RESIZE_WEIGHT_ONE);
+        const uint32_t weight0 = CROP_RESIZE_WEIGHT_ONE - weight1;
+        const uint16_t *row0 = scratch.rows[0].data();
+        const uint16_t *row1 = scratch.rows[1].data();
+        uint8_t *dst_pixel = plane_pixel(dst, layout, dst_rect.x, dst_rect.y + dy);
+        uint8_t *out = packed_output ? dst_pixel : scratch.out_row.data();
+        for (int i = 0; i < row_len; i++)
+            out[i] = (uint8_t)((row0[i] * weight0 + row1[i] * weight1 + (1 << (2 * CROP_RESIZE_WEIGHT_BITS - 1))) >> (2 * CROP_RESIZE_WEIGHT_BITS));
+
+        if (!packed_output)
+        {
+            for (int x = 0; x < dst_rect.width; x++, dst_pixel += layout.pixel_step)
+            {
+                for (int c = 0; c < channels; c++)
+                    dst_pixel[c * layout.channel_step] = out[x * channels + c];
+            }
+        }
+    }
+}
+
+bool CropResizeEngine::is_format_supported(GstVideoFormat format)
+{
+    FormatLayout layout;
+    return get_format_layout(format, layout);
+}
+
+void CropResizeEngine::crop_resize(const CropResizeImage &input, CropResizeJob &job)
+{
+    static thread_local ResizeScratch scratch;
+    FormatLayout layout;
+    const int out_width = job.output.width;
+    const int out_height = job.output.height;
+    const bool subsampled = (input.format == GST_VIDEO_FORMAT_NV12 || input.format == GST_VIDEO_FORMAT_YUY2);
+
+    if (!get_format_layout(input.format, layout) || job.crop_rect.empty() || out_width <= 0 || out_height <= 0)
+        return;
+
+    // The area of the output frame that receives the image, the rest is letterbox padding
+    cv::Rect inner(0, 0, out_width, out_height);
+    if (job.letterbox)
+    {
+        float ratio = std::min((float)out_height / job.crop_rect.height, (float)out_width / job.crop_rect.width);
+        inner.width = std::max(1, (int)std::round(job.crop_rect.width * ratio));
+        inner.height = std::max(1, (int)std::round(job.crop_rect.height * ratio));
+        if (subsampled)
+        {
+            // Chroma is shared by pixel pairs, keep the image aligned on them
+            inner.width = std::max(2, floor_to_even_number(inner.width));
+            if (input.format == GST_VIDEO_FORMAT_NV12)
+                inner.height = std::max(2, floor_to_even_number(inner.height));
+        }
+        // Like resize_letterbox_rgb, an odd padding pixel goes to the left and top
+        inner.x = (out_width - inner.width + 1) / 2;
+        inner.y = (out_height - inner.height + 1) / 2;
+        if (subsampled)
+        {
+            inner.x = floor_to_even_number(inner.x);
+            if (input.format == GST_VIDEO_FORMAT_NV12)
+                inner.y = floor_to_even_number(inner.y);
+        }
+        job.letterbox_scale = HailoBBox(-(inner.x / float(inner.width)),  // x-offset
+                                        -(inner.y / float(inner.height)), // y-offset
+                                        out_width / float(inner.width),   // width factor
+                                        out_height / float(inner.height)); // height factor
+    }
+
+    for (int p = 0; p < layout.num_planes; p++)
+    {
+        const PlaneLayout &plane = layout.planes[p];
+        cv::Rect src_rect(job.crop_rect.x / plane.x_div, job.crop_rect.y / plane.y_div,
+                          job.crop_rect.width / plane.x_div, job.crop_rect.height / plane.y_div);
+        cv::Rect dst_rect(inner.x / plane.x_div, inner.y / plane.y_div,
+                          inner.width / plane.x_div, inner.height / plane.y_div);
+        if (src_rect.empty() || dst_rect.empty())
+            continue;
+
+        resize_plane_bilinear(input, plane, src_rect, job.output, dst_rect, scratch);
+
+        if (job.letterbox)
+        {
+            const uint8_t *color = layout.letterbox_color[p];
+            int plane_width = out_width / plane.x_div;
+            int plane_height = out_height / plane.y_div;
+            fill_plane_rect(job.output, plane, cv::Rect(0, 0, plane_width, dst_rect.y), color);
+            fill_plane_rect(job.output, plane, cv::Rect(0, dst_rect.br().y, plane_width, plane_height - dst_rect.br().y), color);
+            fill_plane_rect(job.output, plane, cv::Rect(0, dst_rect.y, dst_rect.x, dst_rect.height), color);
+            fill_plane_rect(job.output, plane, cv::Rect(dst_rect.br().x, dst_rect.y, plane_width - dst_rect.br().x, dst_rect.height), color);
+        }
+    }
+}
+
+CropResizeEngine::CropResizeEngine(uint num_workers)
+{
+    for (uint i = 0; i < num_workers; i++)
+        m_workers.emplace_back(&CropResizeEngine::worker_loop, this);
+}
+
+CropResizeEngine::~CropResizeEngine()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_cv.notify_all();
+    for (std::thread &worker : m_workers)
+        worker.join();
+}
+
+void CropResizeEngine::process_jobs()
+{
+    for (size_t index = m_next_job.fetch_add(1); index < m_jobs->size(); index = m_next_job.fetch_add(1))
+        crop_resize(*m_input, (*m_jobs)[index]);
+}
+
+void CropResizeEngine::worker_loop()
+{
+    uint64_t handled_generation = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_work_cv.wait(lock, [&] { return m_stop || m_generation != handled_generation; });
+        if (m_stop)
+            return;
+        handled_generation = m_generation;
+
+        lock.unlock();
+        process_jobs();
+        lock.lock();
+
+        if (--m_busy_workers == 0)
+            m_done_cv.notify_one();
+    }
+}
+
+void CropResizeEngine::run(const CropResizeImage &input, std::vector<CropResizeJob> &jobs)
+{
+    if (m_workers.empty() || jobs.size() <= 1)
+    {
+        for (CropResizeJob &job : jobs)
+            crop_resize(input, job);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_input = &input;
+        m_jobs = &jobs;
+        m_next_job = 0;
+        // Every worker takes part in every generation, so none of them can still be
+        // looking at this run's jobs once we return
+        m_busy_workers = m_workers.size();
+        m_generation++;
+    }
+    m_work_cv.notify_all();
+
+    process_jobs();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [&] { return m_busy_workers == 0; });
+    m_input = nullptr;
+    m_jobs = nullptr;
+}
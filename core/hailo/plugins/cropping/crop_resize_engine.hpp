@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file cropping/crop_resize_engine.hpp
+ * @brief CPU crop & resize of all the ROIs of a frame in parallel.
+ *
+ * Each job crops a rectangle from the input frame and scales it (bilinear, optionally letterboxed)
+ * directly into a mapped output frame, in a single pass and without intermediate cv::Mat copies.
+ * Jobs are distributed over a persistent pool of worker threads, the calling thread works as well
+ * and run() returns only once all jobs are done, so callers keep their own output ordering.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <gst/video/video-format.h>
+#include <opencv2/core.hpp>
+#include "hailo_objects.hpp"
+
+/**
+ * @brief A raw view of a video frame (up to 2 planes).
+ */
+struct CropResizeImage
+{
+    GstVideoFormat format = GST_VIDEO_FORMAT_UNKNOWN;
+    int width = 0;
+    int height = 0;
+    uint8_t *planes[2] = {nullptr, nullptr};
+    int strides[2] = {0, 0};
+};
+
+/**
+ * @brief One crop of the input frame into one output frame.
+ */
+struct CropResizeJob
+{
+    cv::Rect crop_rect;      // In pixels of the input frame, even aligned for NV12 / YUY2
+    CropResizeImage output;  // Mapped output frame, same format as the input
+    bool letterbox = false;  // Keep the aspect ratio and pad the borders
+    HailoBBox letterbox_scale = HailoBBox(0.0f, 0.0f, 1.0f, 1.0f); // Filled when letterbox is set
+};
+
+class CropResizeEngine
+{
+public:
+    /**
+     * @param num_workers Number of worker threads, on top of the calling thread.
+     */
+    explicit CropResizeEngine(uint num_workers);
+    ~CropResizeEngine();
+
+    CropResizeEngine(const CropResizeEngine &) = delete;
+    CropResizeEngine &operator=(const CropResizeEngine &) = delete;
+
+    /**
+     * @brief Whether the engine can crop & resize frames of the given format.
+     */
+    static bool is_format_supported(GstVideoFormat format);
+
+    /**
+     * @brief Crop and resize all jobs in parallel, blocks until all of them are done.
+     *
+     * @param input The input frame, shared (read only) by all jobs.
+     * @param jobs The jobs to perform, letterbox_scale is updated in place.
+     */
+    void run(const CropResizeImage &input, std::vector<CropResizeJob> &jobs);
+
+    /**
+     * @brief Crop and resize a single job on the calling thread.
+     */
+    static void crop_resize(const CropResizeImage &input, CropResizeJob &job);
+
+private:
+    void worker_loop();
+    void process_jobs();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    bool m_stop = false;
+    uint64_t m_generation = 0;
+    uint m_busy_workers = 0;
+
+    // State of the current run, valid while m_generation is being processed
+    const CropResizeImage *m_input = nullptr;
+    std::vector<CropResizeJob> *m_jobs = nullptr;
+    std::atomic<size_t> m_next_job{0};
+};
@@ -31,6 +31,12 @@ enum
 {
     PROP_0,
     PROP_FLATTEN_DETECTIONS,
+    PROP_MATCH_MODE,
+    PROP_MATCH_TOLERANCE,
+    PROP_MATCH_TIMEOUT,
+    PROP_MATCH_WINDOW,
+    PROP_MATCH_SUB_WINDOW,
+    PROP_STATS,
 };
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink",
@@ -60,6 +66,9 @@ static gboolean gst_hailoaggregator_sink_event(GstPad *pad,
                                                GstEvent *event);
 static GstFlowReturn gst_hailoaggregator_chain_main(GstPad *pad, GstObject *parent, GstBuffer *buf);
 static GstFlowReturn gst_hailoaggregator_chain_sub(GstPad *pad, GstObject *parent, GstBuffer *buf);
+static GstFlowReturn gst_hailoaggregator_chain_main_matching_mode(GstPad *pad, GstObject *parent, GstBuffer *buf);
+static GstFlowReturn gst_hailoaggregator_chain_sub_matching_mode(GstPad *pad, GstObject *parent, GstBuffer *buf);
+static void gst_hailoaggregator_finalize(GObject *object);
 
 static gboolean gst_hailoaggregator_sink_query(GstPad *pad,
                                                  GstObject *parent, GstQuery *query);
@@ -74,6 +83,7 @@ gst_hailoaggregator_class_init(GstHailoAggregatorClass *klass)
 
     gobject_class->set_property = gst_hailoaggregator_set_property;
     gobject_class->get_property = gst_hailoaggregator_get_property;
+    gobject_class->finalize = gst_hailoaggregator_finalize;
 
     gst_element_class_set_static_metadata(gstelement_class,
                                           "hailoaggregator - Cascading",
@@ -90,6 +100,30 @@ gst_hailoaggregator_class_init(GstHailoAggregatorClass *klass)
     g_object_class_install_property(gobject_class, PROP_FLATTEN_DETECTIONS,
                                     g_param_spec_boolean("flatten-detections", "Flatten detections", "perform a 'flattening' functionality on the detection metadata when receiving each frame", false,
                                                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_MODE,
+                                    g_param_spec_enum("match-mode", "match-mode", "Match main frames and their crops by PTS or offset, main frames wait in a window instead of blocking the main branch",
+                                                      GST_TYPE_HAILO_MATCH_MODE, GST_HAILO_MATCH_MODE_NONE,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_TOLERANCE,
+                                    g_param_spec_uint64("match-tolerance", "match-tolerance", "Maximal difference between the keys of matching frames (ns for pts, frames for offset)",
+                                                        0, G_MAXUINT64, HAILO_MATCH_DEFAULT_TOLERANCE,
+                                                        (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_TIMEOUT,
+                                    g_param_spec_uint("match-timeout", "match-timeout", "Time in ms after which a main frame is pushed without its missing crops",
+                                                      1, G_MAXUINT, HAILO_MATCH_DEFAULT_TIMEOUT_MS,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_WINDOW,
+                                    g_param_spec_uint("match-window", "match-window", "Maximal number of main frames waiting for their crops",
+                                                      1, 1024, HAILO_MATCH_DEFAULT_WINDOW,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_SUB_WINDOW,
+                                    g_param_spec_uint("match-sub-window", "match-sub-window", "Maximal number of crops waiting for their main frame, raise it for many crops per frame at high frame rates",
+                                                      1, G_MAXUINT16, HAILO_MATCH_DEFAULT_SUB_WINDOW,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_STATS,
+                                    g_param_spec_boxed("stats", "Statistics", "Matched and unmatched main frames, match rate and average added latency in ns (only relevant when match-mode is set)",
+                                                       GST_TYPE_STRUCTURE,
+                                                       (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
@@ -121,6 +155,28 @@ gst_hailoaggregator_init(GstHailoAggregator *hailoaggregator)
     hailoaggregator->flatten_detections = false;
     hailoaggregator->eos_main = false;
     hailoaggregator->eos_sub = false;
+
+    hailoaggregator->match_mode = GST_HAILO_MATCH_MODE_NONE;
+    hailoaggregator->match_tolerance = HAILO_MATCH_DEFAULT_TOLERANCE;
+    hailoaggregator->match_timeout = HAILO_MATCH_DEFAULT_TIMEOUT_MS;
+    hailoaggregator->match_window = HAILO_MATCH_DEFAULT_WINDOW;
+    hailoaggregator->match_sub_window = HAILO_MATCH_DEFAULT_SUB_WINDOW;
+    hailoaggregator->matcher = new HailoFrameMatcher();
+    hailoaggregator->match_timer = new HailoMatchTimer();
+    hailoaggregator->flush_requested = false;
+    hailoaggregator->last_flow = GST_FLOW_OK;
+}
+
+static void
+gst_hailoaggregator_finalize(GObject *object)
+{
+    GstHailoAggregator *hailoaggregator = GST_HAILO_AGGREGATOR_CAST(object);
+    delete hailoaggregator->match_timer;
+    hailoaggregator->match_timer = NULL;
+    hailoaggregator->matcher->clear(gst_buffer_unref);
+    delete hailoaggregator->matcher;
+    hailoaggregator->matcher = NULL;
+    G_OBJECT_CLASS(parent_class)->finalize(object);
 }
 
 static void
@@ -134,6 +190,31 @@ gst_hailoaggregator_set_property(GObject *object, guint prop_id,
     case PROP_FLATTEN_DETECTIONS:
         hailoaggregator->flatten_detections = g_value_get_boolean(value);
         break;
+    case PROP_MATCH_MODE:
+        hailoaggregator->match_mode = (GstHailoMatchMode)g_value_get_enum(value);
+        if (hailoaggregator->match_mode != GST_HAILO_MATCH_MODE_NONE)
+        {
+            gst_pad_set_chain_function(hailoaggregator->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailoaggregator_chain_main_matching_mode));
+            gst_pad_set_chain_function(hailoaggregator->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailoaggregator_chain_sub_matching_mode));
+        }
+        else
+        {
+            gst_pad_set_chain_function(hailoaggregator->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailoaggregator_chain_main));
+            gst_pad_set_chain_function(hailoaggregator->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailoaggregator_chain_sub));
+        }
+        break;
+    case PROP_MATCH_TOLERANCE:
+        hailoaggregator->match_tolerance = g_value_get_uint64(value);
+        break;
+    case PROP_MATCH_TIMEOUT:
+        hailoaggregator->match_timeout = g_value_get_uint(value);
+        break;
+    case PROP_MATCH_WINDOW:
+        hailoaggregator->match_window = g_value_get_uint(value);
+        break;
+    case PROP_MATCH_SUB_WINDOW:
+        hailoaggregator->match_sub_window = g_value_get_uint(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -151,6 +232,27 @@ gst_hailoaggregator_get_property(GObject *object, guint prop_id, GValue *value,
     case PROP_FLATTEN_DETECTIONS:
         g_value_set_boolean(value, hailoaggregator->flatten_detections);
         break;
+    case PROP_MATCH_MODE:
+        g_value_set_enum(value, hailoaggregator->match_mode);
+        break;
+    case PROP_MATCH_TOLERANCE:
+        g_value_set_uint64(value, hailoaggregator->match_tolerance);
+        break;
+    case PROP_MATCH_TIMEOUT:
+        g_value_set_uint(value, hailoaggregator->match_timeout);
+        break;
+    case PROP_MATCH_WINDOW:
+        g_value_set_uint(value, hailoaggregator->match_window);
+        break;
+    case PROP_MATCH_SUB_WINDOW:
+        g_value_set_uint(value, hailoaggregator->match_sub_window);
+        break;
+    case PROP_STATS:
+    {
+        std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+        g_value_take_boxed(value, hailoaggregator->matcher->get_stats());
+        break;
+    }
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -230,6 +332,53 @@ gst_hailoaggregator_update_eos(GstHailoAggregator *hailoaggregator, GstPad *pad,
     }
 }
 
+/**
+ * Push the main frames that are released by the matcher, in order.
+ * Frames may become ready on both branches, the srcpad stream lock serializes the pushes.
+ * When the lock is taken and wait is false, the holder of the lock pushes them instead.
+ *
+ * @param[in] hailoaggregator   aggregator element.
+ * @param[in] wait              Whether to wait for the srcpad stream lock.
+ * @param[in] release_all       Release all pending frames, also those still waiting for crops.
+ * @return The flow return of the last push.
+ */
+static GstFlowReturn
+gst_hailoaggregator_push_released_frames(GstHailoAggregator *hailoaggregator, bool wait, bool release_all)
+{
+    GstHailoAggregatorClass *hailoaggregator_class = GST_HAILO_AGGREGATOR_GET_CLASS(hailoaggregator);
+    hailoaggregator->flush_requested.store(true);
+    while (hailoaggregator->flush_requested.load())
+    {
+        if (wait)
+            GST_PAD_STREAM_LOCK(hailoaggregator->srcpad);
+        else if (!GST_PAD_STREAM_TRYLOCK(hailoaggregator->srcpad))
+            return hailoaggregator->last_flow;
+        hailoaggregator->flush_requested.store(false);
+
+        std::vector<GstBuffer *> released;
+        {
+            std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+            auto on_release = [&released](HailoPendingFrame &frame) { released.push_back(frame.buffer); };
+            if (release_all)
+                hailoaggregator->matcher->release_all(g_get_monotonic_time(), on_release);
+            else
+                hailoaggregator->matcher->release_ready(g_get_monotonic_time(), on_release);
+        }
+
+        for (GstBuffer *buf : released)
+        {
+            hailoaggregator_class->handle_main_roi_post_aggregation(hailoaggregator, get_hailo_main_roi(buf));
+            gst_pad_sticky_events_foreach(hailoaggregator->sinkpad_main, forward_events, hailoaggregator->srcpad);
+            // Remove the cropping meta from the main frame.
+            if (!gst_buffer_remove_hailo_cropping_meta(buf))
+                GST_ERROR_OBJECT(hailoaggregator, "Failed to remove cropping meta from main frame");
+            hailoaggregator->last_flow = gst_pad_push(hailoaggregator->srcpad, buf);
+        }
+        GST_PAD_STREAM_UNLOCK(hailoaggregator->srcpad);
+    }
+    return hailoaggregator->last_flow;
+}
+
 static gboolean
 gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
 {
@@ -255,6 +404,9 @@ gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
             hailoaggregator->cv_sub.notify_all();
             forward = gst_hailoaggregator_all_sinkpads_eos_unlocked(hailoaggregator);
             GST_OBJECT_UNLOCK(hailoaggregator);
+            // Pending main frames won't get their crops anymore
+            if (hailoaggregator->match_mode != GST_HAILO_MATCH_MODE_NONE && (forward || pad == hailoaggregator->sinkpad_sub))
+                gst_hailoaggregator_push_released_frames(hailoaggregator, true, true);
         }
         else if (pad != hailoaggregator->sinkpad_main)
         {
@@ -268,6 +420,12 @@ gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
         GST_OBJECT_LOCK(hailoaggregator);
         gst_hailoaggregator_update_eos(hailoaggregator, pad, false);
         GST_OBJECT_UNLOCK(hailoaggregator);
+        if (hailoaggregator->match_mode != GST_HAILO_MATCH_MODE_NONE)
+        {
+            std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+            hailoaggregator->matcher->clear(gst_buffer_unref);
+            hailoaggregator->last_flow = GST_FLOW_OK;
+        }
     }
 
     if (forward && GST_EVENT_IS_SERIALIZED(event))
@@ -370,6 +528,84 @@ gst_hailoaggregator_chain_main(GstPad *pad, GstObject *parent, GstBuffer *buf)
     return ret;
 }
 
+/**
+ * Apply a crop to its pending main frame.
+ * The handle_sub_frame_roi vfunc works on hailoaggregator->mainframe, so it is pointed to the
+ * pending frame for the duration of the call. Called with the mutex held.
+ */
+static void
+gst_hailoaggregator_apply_sub_frame(GstHailoAggregator *hailoaggregator, HailoPendingFrame &frame, GstBuffer *sub_buf)
+{
+    GstHailoAggregatorClass *hailoaggregator_class = GST_HAILO_AGGREGATOR_GET_CLASS(hailoaggregator);
+    hailoaggregator->mainframe = frame.buffer;
+    hailoaggregator_class->handle_sub_frame_roi(hailoaggregator, get_hailo_main_roi(sub_buf));
+    hailoaggregator->mainframe = NULL;
+    frame.received++;
+    gst_buffer_remove_hailo_meta(sub_buf);
+    gst_buffer_unref(sub_buf);
+}
+
+static GstFlowReturn
+gst_hailoaggregator_chain_main_matching_mode(GstPad *pad, GstObject *parent, GstBuffer *buf)
+{
+    GstHailoAggregator *hailoaggregator = GST_HAILO_AGGREGATOR_CAST(parent);
+    {
+        std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+        guint64 key = gst_hailo_match_key(buf, hailoaggregator->match_mode);
+        guint expected = hailoaggregator->eos_sub ? 0 : gst_buffer_get_hailo_cropping_meta(buf)->num_of_crops;
+        bool was_empty = hailoaggregator->matcher->next_deadline() < 0;
+        HailoPendingFrame &frame = hailoaggregator->matcher->add_main(buf, key, expected, g_get_monotonic_time());
+        if (was_empty)
+            hailoaggregator->match_timer->wake();
+
+        // Crops may have arrived first
+        auto on_stale = [](GstBuffer *stale) {
+            gst_buffer_remove_hailo_meta(stale);
+            gst_buffer_unref(stale);
+        };
+        while (!frame.complete())
+        {
+            GstBuffer *sub_buf = hailoaggregator->matcher->take_sub(key, on_stale);
+            if (!sub_buf)
+                break;
+            gst_hailoaggregator_apply_sub_frame(hailoaggregator, frame, sub_buf);
+        }
+    }
+
+    // Never wait on the main branch, if another thread is pushing it will push this frame too
+    return gst_hailoaggregator_push_released_frames(hailoaggregator, false, false);
+}
+
+static GstFlowReturn
+gst_hailoaggregator_chain_sub_matching_mode(GstPad *pad, GstObject *parent, GstBuffer *buf)
+{
+    GstHailoAggregator *hailoaggregator = GST_HAILO_AGGREGATOR_CAST(parent);
+    {
+        std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+        guint64 key = gst_hailo_match_key(buf, hailoaggregator->match_mode);
+        HailoPendingFrame *frame = hailoaggregator->matcher->find_main(key);
+        if (frame != nullptr)
+        {
+            gst_hailoaggregator_apply_sub_frame(hailoaggregator, *frame, buf);
+            // Earlier main frames lost their remaining crops
+            hailoaggregator->matcher->expire_older_than(key);
+        }
+        else
+        {
+            // Wait for the main frame
+            GstBuffer *evicted = hailoaggregator->matcher->add_sub(buf, key);
+            if (evicted)
+            {
+                gst_buffer_remove_hailo_meta(evicted);
+                gst_buffer_unref(evicted);
+            }
+        }
+    }
+
+    gst_hailoaggregator_push_released_frames(hailoaggregator, true, false);
+    return GST_FLOW_OK;
+}
+
 /**
  * Functionality to perform for each incoming sub frame.
  * Called from the chain_sub method before the releasing the mutex and the buffers.
@@ -409,6 +645,22 @@ gst_hailoaggregator_change_state(GstElement *element, GstStateChange transition)
     GstHailoAggregator *aggregator = GST_HAILO_AGGREGATOR(element);
     switch (transition)
     {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    {
+        std::unique_lock<std::mutex> lock(aggregator->mutex);
+        aggregator->matcher->configure(aggregator->match_tolerance, (gint64)aggregator->match_timeout * 1000,
+                                       aggregator->match_window, aggregator->match_sub_window);
+        aggregator->last_flow = GST_FLOW_OK;
+        lock.unlock();
+        // Release timed out main frames also when no buffers arrive
+        if (aggregator->match_mode != GST_HAILO_MATCH_MODE_NONE)
+        {
+            aggregator->match_timer->start(
+                aggregator->mutex, [aggregator]() { return aggregator->matcher->next_deadline(); },
+                [aggregator]() { gst_hailoaggregator_push_released_frames(aggregator, true, false); });
+        }
+        break;
+    }
     case GST_STATE_CHANGE_PAUSED_TO_READY:
     {
         // Unlocking both condition variables in order to finish the chain function.
@@ -426,5 +678,12 @@ gst_hailoaggregator_change_state(GstElement *element, GstStateChange transition)
     if (ret == GST_STATE_CHANGE_FAILURE)
         return ret;
 
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY)
+    {
+        aggregator->match_timer->stop();
+        std::lock_guard<std::mutex> lock(aggregator->mutex);
+        aggregator->matcher->clear(gst_buffer_unref);
+    }
+
     return ret;
 }
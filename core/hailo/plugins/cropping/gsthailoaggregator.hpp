@@ -12,8 +12,10 @@
 #include <gst/gst.h>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 
 #include "hailo_objects.hpp"
+#include "common/frame_matcher.hpp"
 
 G_BEGIN_DECLS
 
@@ -49,6 +51,16 @@ struct _GstHailoAggregator
     uint expected_frames;
     uint last_offset;
     gboolean flatten_detections;
+    // Matching by PTS / offset
+    GstHailoMatchMode match_mode;
+    guint64 match_tolerance;
+    guint match_timeout;
+    guint match_window;
+    guint match_sub_window;
+    HailoFrameMatcher *matcher;
+    HailoMatchTimer *match_timer;
+    std::atomic<bool> flush_requested;
+    std::atomic<GstFlowReturn> last_flow;
 
     std::mutex mutex;
     std::condition_variable cv_main;
@@ -13,6 +13,7 @@
 #include <typeinfo>
 #include "common/image.hpp"
 #include "cropping/gsthailobasecropper.hpp"
+#include "cropping/crop_resize_engine.hpp"
 #include "gst_hailo_cropping_meta.hpp"
 #include "gst_hailo_stream_meta.hpp"
 #include "hailo_objects.hpp"
@@ -34,6 +35,7 @@ enum
     PROP_DROP_UNCROPPED_BUFFERS,
     PROP_CROPPING_PERIOD,
     PROP_FILTER_STREAMS,
+    PROP_CROP_THREADS,
 #ifdef HAILO15_TARGET
     PROP_USE_DSP,
     PROP_POOL_SIZE,
@@ -120,6 +122,13 @@ gst_hailo_basecropper_class_init(GstHailoBaseCropperClass *klass)
                                                                              "Filter stream", "",
                                                                              (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)),
                                                          (GParamFlags)(G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_CROP_THREADS,
+                                    g_param_spec_uint("crop-threads", "Crop Threads",
+                                                      "Number of threads (including the streaming thread) that crop and resize the ROIs of a frame in parallel on the CPU, "
+                                                      "writing directly into pooled output buffers. Only bilinear resizing is supported, other resize methods keep the serial path. "
+                                                      "0 disables the parallel engine. Default 0.",
+                                                      0, 64, 0,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 
 #ifdef HAILO15_TARGET
     g_object_class_install_property(gobject_class, PROP_USE_DSP,
@@ -142,6 +151,7 @@ gst_hailo_basecropper_class_init(GstHailoBaseCropperClass *klass)
 
     klass->prepare_crops = nullptr;
     klass->resize = nullptr;
+    klass->get_crop_resize_mode = nullptr;
 }
 
 static void
@@ -175,6 +185,8 @@ gst_hailo_basecropper_init(GstHailoBaseCropper *hailo_basecropper)
     hailo_basecropper->num_streams_to_filter = 0;
     hailo_basecropper->drop_uncropped_buffers = false;
     hailo_basecropper->buffer_pool = NULL;
+    hailo_basecropper->crop_threads = 0;
+    hailo_basecropper->crop_resize_engine = nullptr;
     hailo_basecropper->stream_ids_buff_offset.clear();
     for (uint i = 0; i < GST_HAILO_CROPPER_MAX_FILTER_STREAMS; i++)
         hailo_basecropper->filter_streams[i] = "";
@@ -205,9 +217,57 @@ static void gst_hailo_basecropper_dispose(GObject *object)
         hailo_basecropper->buffer_pool = NULL;
     }
 
+    if (hailo_basecropper->crop_resize_engine)
+    {
+        delete hailo_basecropper->crop_resize_engine;
+        hailo_basecropper->crop_resize_engine = nullptr;
+    }
+
     G_OBJECT_CLASS(gst_hailo_basecropper_parent_class)->dispose(object);
 }
 
+/**
+ * Creates a system memory buffer pool for the crop buffers of the parallel crop-resize engine,
+ * so steady state cropping does not allocate a new buffer for every ROI.
+ *
+ * @param[in] hailo_basecropper      Cropping element.
+ * @param[in] query                  Allocation query holding the crop caps.
+ * @return Upon success, returns true. Otherwise, returns false.
+ */
+static gboolean
+gst_hailo_basecropper_create_cpu_buffer_pool(GstHailoBaseCropper *hailo_basecropper, GstQuery *query)
+{
+    GstCaps *caps = NULL;
+    gst_query_parse_allocation(query, &caps, NULL);
+    if (!caps)
+    {
+        GST_ERROR_OBJECT(hailo_basecropper, "Decide Allocation - No caps in allocation query");
+        return FALSE;
+    }
+
+    if (hailo_basecropper->buffer_pool)
+    {
+        gst_buffer_pool_set_active(hailo_basecropper->buffer_pool, FALSE);
+        gst_object_unref(hailo_basecropper->buffer_pool);
+        hailo_basecropper->buffer_pool = NULL;
+    }
+
+    GstBufferPool *pool = gst_buffer_pool_new();
+    GstStructure *config = gst_buffer_pool_get_config(pool);
+    // No max buffers, the amount of crops per frame is not bounded
+    gst_buffer_pool_config_set_params(config, caps, get_size(caps), 1, 0);
+    if (!gst_buffer_pool_set_config(pool, config) || !gst_buffer_pool_set_active(pool, TRUE))
+    {
+        GST_ERROR_OBJECT(hailo_basecropper, "Decide Allocation - Failed to configure crop buffer pool");
+        gst_object_unref(pool);
+        return FALSE;
+    }
+    hailo_basecropper->buffer_pool = pool;
+
+    GST_INFO_OBJECT(hailo_basecropper, "Decide allocation - crop buffer pool created");
+    return TRUE;
+}
+
 static gboolean
 gst_hailo_basecropper_decide_allocation(GstHailoBaseCropper *hailo_basecropper, GstQuery *query)
 {
@@ -215,7 +275,11 @@ gst_hailo_basecropper_decide_allocation(GstHailoBaseCropper *hailo_basecropper,
 
 #ifdef HAILO15_TARGET
     if (!hailo_basecropper->use_dsp)
+    {
+        if (hailo_basecropper->crop_threads > 0)
+            ret = gst_hailo_basecropper_create_cpu_buffer_pool(hailo_basecropper, query);
         return ret;
+    }
 
     GST_DEBUG_OBJECT(hailo_basecropper, "Performing decide allocation");
 
@@ -228,7 +292,9 @@ gst_hailo_basecropper_decide_allocation(GstHailoBaseCropper *hailo_basecropper,
     }
 
     GST_INFO_OBJECT(hailo_basecropper, "Decide allocation - hailo buffer pool created");
-
+#else
+    if (hailo_basecropper->crop_threads > 0)
+        ret = gst_hailo_basecropper_create_cpu_buffer_pool(hailo_basecropper, query);
 #endif
     return ret;
 }
@@ -302,6 +368,15 @@ gst_hailo_basecropper_set_property(GObject *object, guint prop_id,
     case PROP_FILTER_STREAMS:
         set_filter_streams(hailo_basecropper, value);
         break;
+    case PROP_CROP_THREADS:
+        hailo_basecropper->crop_threads = g_value_get_uint(value);
+        // The engine is created on the next frame with the new amount of threads
+        if (hailo_basecropper->crop_resize_engine)
+        {
+            delete hailo_basecropper->crop_resize_engine;
+            hailo_basecropper->crop_resize_engine = nullptr;
+        }
+        break;
 #ifdef HAILO15_TARGET
     case PROP_USE_DSP:
         hailo_basecropper->use_dsp = g_value_get_boolean(value);
@@ -336,6 +411,9 @@ gst_hailo_basecropper_get_property(GObject *object, guint prop_id,
     case PROP_FILTER_STREAMS:
         get_filter_streams(hailo_basecropper, value);
         break;
+    case PROP_CROP_THREADS:
+        g_value_set_uint(value, hailo_basecropper->crop_threads);
+        break;
 #ifdef HAILO15_TARGET
     case PROP_USE_DSP:
         g_value_set_boolean(value, hailo_basecropper->use_dsp);
@@ -591,14 +669,18 @@ static GstBuffer *gst_hailo_basecropper_allocate_new_buffer(GstHailoBaseCropper
             GST_ERROR_OBJECT(hailo_basecropper, "Failed to acquire buffer from pool");
             return NULL;
         }
+        return output_buffer;
     }
-    else
+#endif
+
+    // CPU crop buffer pool, used by the parallel crop-resize engine
+    if (hailo_basecropper->buffer_pool)
     {
-        output_buffer = gst_buffer_new_allocate(NULL, buffer_size, NULL);
+        if (gst_buffer_pool_acquire_buffer(hailo_basecropper->buffer_pool, &output_buffer, NULL) == GST_FLOW_OK)
+            return output_buffer;
+        GST_WARNING_OBJECT(hailo_basecropper, "Failed to acquire buffer from crop pool, allocating a new one");
     }
-#else
     output_buffer = gst_buffer_new_allocate(NULL, buffer_size, NULL);
-#endif
 
     return output_buffer;
 }
@@ -818,6 +900,203 @@ static GstBuffer *handle_one_crop(GstHailoBaseCropper *hailo_basecropper, GstBuf
     return output_buffer;
 }
 
+/**
+ * Whether the crops should be done by the parallel crop-resize engine, and how.
+ *
+ * @param[in] hailo_basecropper      Cropping element.
+ * @param[out] letterbox             Whether the crops should be letterboxed.
+ * @param[out] update_scaling_bbox   Whether to set the letterbox scaling bbox on the cropped ROIs.
+ * @return boolean, whether the engine should be used.
+ */
+static gboolean use_crop_resize_engine(GstHailoBaseCropper *hailo_basecropper, gboolean *letterbox, gboolean *update_scaling_bbox)
+{
+    GstHailoBaseCropperClass *hailo_basecropperclass = GST_HAILO_BASE_CROPPER_GET_CLASS(hailo_basecropper);
+
+    if (hailo_basecropper->crop_threads == 0 || !hailo_basecropperclass->get_crop_resize_mode)
+        return FALSE;
+#ifdef HAILO15_TARGET
+    if (hailo_basecropper->use_dsp)
+        return FALSE;
+#endif
+    return hailo_basecropperclass->get_crop_resize_mode(hailo_basecropper, letterbox, update_scaling_bbox);
+}
+
+/**
+ * Get the pixel rectangle to crop from a frame, same as HailoMat::get_crop_rect.
+ * NV12 and YUY2 rectangles are aligned to even pixels since chroma is shared by pixel pairs.
+ *
+ * @param[in] crop_roi      The ROI to crop.
+ * @param[in] info          Video info of the frame to crop from.
+ * @return cv::Rect in pixels of the frame.
+ */
+static cv::Rect get_crop_rect_from_video_info(HailoROIPtr crop_roi, GstVideoInfo *info)
+{
+    HailoBBox bbox = hailo_common::create_flattened_bbox(crop_roi->get_bbox(), crop_roi->get_scaling_bbox());
+    uint width = GST_VIDEO_INFO_WIDTH(info);
+    uint height = GST_VIDEO_INFO_HEIGHT(info);
+    cv::Rect rect;
+    rect.x = CLAMP(bbox.xmin() * width, 0, width);
+    rect.y = CLAMP(bbox.ymin() * height, 0, height);
+    rect.width = CLAMP(bbox.width() * width, 0, width - rect.x);
+    rect.height = CLAMP(bbox.height() * height, 0, height - rect.y);
+
+    switch (GST_VIDEO_INFO_FORMAT(info))
+    {
+    case GST_VIDEO_FORMAT_NV12:
+        rect.y = floor_to_even_number(rect.y);
+        rect.height = floor_to_even_number(rect.height);
+        // fallthrough
+    case GST_VIDEO_FORMAT_YUY2:
+        rect.x = floor_to_even_number(rect.x);
+        rect.width = floor_to_even_number(rect.width);
+        break;
+    default:
+        break;
+    }
+    return rect;
+}
+
+static CropResizeImage crop_resize_image_from_frame(GstVideoFrame *frame)
+{
+    CropResizeImage image;
+    image.format = GST_VIDEO_FRAME_FORMAT(frame);
+    image.width = GST_VIDEO_FRAME_WIDTH(frame);
+    image.height = GST_VIDEO_FRAME_HEIGHT(frame);
+    for (uint plane = 0; plane < MIN(GST_VIDEO_FRAME_N_PLANES(frame), 2u); plane++)
+    {
+        image.planes[plane] = (uint8_t *)GST_VIDEO_FRAME_PLANE_DATA(frame, plane);
+        image.strides[plane] = GST_VIDEO_FRAME_PLANE_STRIDE(frame, plane);
+    }
+    return image;
+}
+
+/**
+ * Crop & resize all the given HailoROIs in parallel with the crop-resize engine,
+ * then push the cropped buffers in the same order as crop_rois.
+ *
+ * @param[in] hailo_basecropper      cropping element.
+ * @param[in] buf                    Buffer to crop.
+ * @param[in] crop_rois              Vector of HailoROI of buf to crop from.
+ * @param[in] letterbox              Whether the crops should be letterboxed.
+ * @param[in] update_scaling_bbox    Whether to set the letterbox scaling bbox on the cropped ROIs.
+ * @param[out] handled               Set to false when the frame can't be handled by the engine.
+ * @return boolean, whether all cropping were successful.
+ */
+static gboolean handle_crops_parallel(GstHailoBaseCropper *hailo_basecropper, GstBuffer *buf, std::vector<HailoROIPtr> &crop_rois,
+                                      gboolean letterbox, gboolean update_scaling_bbox, gboolean *handled)
+{
+    GstVideoInfo full_image_info, resized_image_info;
+    GstCaps *incaps, *outcaps;
+    gboolean ret = TRUE;
+
+    *handled = FALSE;
+    incaps = gst_pad_get_current_caps(hailo_basecropper->sinkpad);
+    outcaps = gst_pad_get_current_caps(hailo_basecropper->srcpad_crop);
+    if (!incaps || !outcaps)
+    {
+        if (incaps)
+            gst_caps_unref(incaps);
+        if (outcaps)
+            gst_caps_unref(outcaps);
+        return TRUE;
+    }
+    gboolean caps_parsed = gst_video_info_from_caps(&full_image_info, incaps) && gst_video_info_from_caps(&resized_image_info, outcaps);
+    gst_caps_unref(incaps);
+    gst_caps_unref(outcaps);
+
+    // Anything unusual is left to the serial path, which also reports the errors
+    if (!caps_parsed ||
+        GST_VIDEO_INFO_FORMAT(&full_image_info) != GST_VIDEO_INFO_FORMAT(&resized_image_info) ||
+        !CropResizeEngine::is_format_supported(GST_VIDEO_INFO_FORMAT(&full_image_info)))
+        return TRUE;
+    *handled = TRUE;
+
+    if (!hailo_basecropper->crop_resize_engine)
+        hailo_basecropper->crop_resize_engine = new CropResizeEngine(hailo_basecropper->crop_threads - 1);
+
+    GstVideoFrame input_frame;
+    if (!gst_video_frame_map(&input_frame, &full_image_info, buf, GST_MAP_READ))
+    {
+        GST_ERROR_OBJECT(hailo_basecropper, "Cannot map input buffer to frame");
+        return FALSE;
+    }
+    CropResizeImage input_image = crop_resize_image_from_frame(&input_frame);
+
+    bool input_res_equals_output_res = (full_image_info.width == resized_image_info.width && full_image_info.height == resized_image_info.height);
+    std::vector<GstBuffer *> output_buffers(crop_rois.size(), nullptr);
+    std::vector<GstVideoFrame> output_frames;
+    std::vector<CropResizeJob> jobs;
+    std::vector<int> roi_job_index(crop_rois.size(), -1);
+    output_frames.reserve(crop_rois.size());
+    jobs.reserve(crop_rois.size());
+
+    for (uint i = 0; i < crop_rois.size(); i++)
+    {
+        HailoBBox roi_bbox = crop_rois[i]->get_bbox();
+        bool crop_roi_is_whole_buffer = (roi_bbox.width() == 1.0f && roi_bbox.height() == 1.0f && roi_bbox.xmin() == 0.0f && roi_bbox.ymin() == 0.0f);
+        if (crop_roi_is_whole_buffer && input_res_equals_output_res)
+        {
+            output_buffers[i] = gst_buffer_ref(buf);
+            continue;
+        }
+
+        output_buffers[i] = gst_hailo_basecropper_allocate_new_buffer(hailo_basecropper, GST_VIDEO_INFO_SIZE(&resized_image_info));
+        if (!output_buffers[i])
+        {
+            ret = FALSE;
+            break;
+        }
+        output_frames.emplace_back();
+        if (!gst_video_frame_map(&output_frames.back(), &resized_image_info, output_buffers[i], GST_MAP_WRITE))
+        {
+            GST_ERROR_OBJECT(hailo_basecropper, "Cannot map output buffer to frame");
+            output_frames.pop_back();
+            ret = FALSE;
+            break;
+        }
+
+        CropResizeJob job;
+        job.crop_rect = get_crop_rect_from_video_info(crop_rois[i], &full_image_info);
+        job.output = crop_resize_image_from_frame(&output_frames.back());
+        job.letterbox = letterbox;
+        roi_job_index[i] = jobs.size();
+        jobs.push_back(job);
+    }
+
+    if (ret)
+    {
+        GST_DEBUG_OBJECT(hailo_basecropper, "Cropping %d ROIs in parallel", (int)jobs.size());
+        hailo_basecropper->crop_resize_engine->run(input_image, jobs);
+    }
+
+    for (GstVideoFrame &output_frame : output_frames)
+        gst_video_frame_unmap(&output_frame);
+    gst_video_frame_unmap(&input_frame);
+
+    if (!ret)
+    {
+        GST_WARNING_OBJECT(hailo_basecropper, "Could not crop buffer with offset %jd", buf->offset);
+        for (GstBuffer *output_buffer : output_buffers)
+        {
+            if (output_buffer)
+                gst_buffer_unref(output_buffer);
+        }
+        return FALSE;
+    }
+
+    // Push in the same order as the ROIs, regardless of which thread finished first
+    for (uint i = 0; i < crop_rois.size(); i++)
+    {
+        if (roi_job_index[i] >= 0 && letterbox && update_scaling_bbox)
+            crop_rois[i]->set_scaling_bbox(jobs[roi_job_index[i]].letterbox_scale);
+        gst_buffer_add_hailo_meta(output_buffers[i], crop_rois[i]);
+        output_buffers[i]->offset = buf->offset;
+        GST_BUFFER_PTS(output_buffers[i]) = GST_BUFFER_PTS(buf);
+        gst_pad_push(hailo_basecropper->srcpad_crop, output_buffers[i]);
+    }
+    return TRUE;
+}
+
 /**
  * Creates new crop buffers from given HailoROIs
  *
@@ -828,6 +1107,21 @@ static GstBuffer *handle_one_crop(GstHailoBaseCropper *hailo_basecropper, GstBuf
  */
 static gboolean handle_crops(GstHailoBaseCropper *hailo_basecropper, GstBuffer *buf, std::vector<HailoROIPtr> &crop_rois)
 {
+    gboolean letterbox = FALSE;
+    gboolean update_scaling_bbox = FALSE;
+    if (use_crop_resize_engine(hailo_basecropper, &letterbox, &update_scaling_bbox))
+    {
+        if (!gst_pad_is_active(hailo_basecropper->srcpad_crop))
+        {
+            GST_INFO_OBJECT(hailo_basecropper, "Crop src pad is not active, dropping buffer");
+            return TRUE;
+        }
+        gboolean handled = FALSE;
+        gboolean ret = handle_crops_parallel(hailo_basecropper, buf, crop_rois, letterbox, update_scaling_bbox, &handled);
+        if (handled)
+            return ret;
+    }
+
     for (HailoROIPtr &crop_roi : crop_rois)
     {
         if (!gst_pad_is_active(hailo_basecropper->srcpad_crop))
@@ -842,6 +1136,7 @@ static gboolean handle_crops(GstHailoBaseCropper *hailo_basecropper, GstBuffer *
             return FALSE;
         }
         newbuf->offset = buf->offset;
+        GST_BUFFER_PTS(newbuf) = GST_BUFFER_PTS(buf);
 
         // Push the cropped buffer into the crop src pad.
         gst_pad_push(hailo_basecropper->srcpad_crop, newbuf);
@@ -25,6 +25,8 @@ G_BEGIN_DECLS
 #define HAILO_BASE_CROPPER_VIDEO_CAPS \
     GST_VIDEO_CAPS_MAKE(HAILO_BASE_CROPPER_SUPPORTED_FORMATS)
 
+class CropResizeEngine;
+
 typedef struct _GstHailoBaseCropper GstHailoBaseCropper;
 typedef struct _GstHailoBaseCropperClass GstHailoBaseCropperClass;
 
@@ -41,6 +43,8 @@ struct _GstHailoBaseCropper
     guint bufferpool_min_size;
     #endif
     GstBufferPool *buffer_pool;
+    guint crop_threads;
+    CropResizeEngine *crop_resize_engine;
     uint num_streams_to_filter = 0;
     GstPad *sinkpad, *srcpad_crop, *srcpad_main;
     std::map<std::string, int> stream_ids_buff_offset;
@@ -53,6 +57,9 @@ struct _GstHailoBaseCropperClass
 
     std::vector<HailoROIPtr> (*prepare_crops) (GstHailoBaseCropper *hailocropper,  GstBuffer *buf);
     void (*resize) (GstHailoBaseCropper *basecropper, std::vector<cv::Mat> &cropped_image, std::vector<cv::Mat> &resized_image, HailoROIPtr roi, GstVideoFormat image_format);
+    // Optional: returns TRUE when resize is a plain bilinear (optionally letterboxed) resize,
+    // so the crops can be done by the parallel crop-resize engine instead.
+    gboolean (*get_crop_resize_mode) (GstHailoBaseCropper *basecropper, gboolean *letterbox, gboolean *update_scaling_bbox);
 };
 
 G_GNUC_INTERNAL GType gst_hailo_basecropper_get_type(void);
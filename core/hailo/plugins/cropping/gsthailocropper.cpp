@@ -15,6 +15,7 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <string>
 #include <typeinfo>
 #include "common/image.hpp"
 #include "cropping/gsthailocropper.hpp"
@@ -32,7 +33,8 @@ enum
     PROP_PROCESS_FUNC_NAME,
     PROP_RESIZE_METHOD,
     PROP_USE_LETTERBOX,
-    PROP_NO_SCALING_BBOX
+    PROP_NO_SCALING_BBOX,
+    PROP_MAX_CROPS_PER_FRAME
 };
 
 #define GST_TYPE_HAILOCROPPER_RESIZE_METHOD (gst_hailocropper_resize_method_get_type())
@@ -69,6 +71,7 @@ static std::vector<HailoROIPtr> gst_hailocropper_prepare_crops(GstHailoBaseCropp
                                                                GstBuffer *buf);
 static GstStateChangeReturn gst_hailocropper_change_state(GstElement *element, GstStateChange transition);
 void gst_hailocropper_resize_by_method(GstHailoBaseCropper *basecropper, std::vector<cv::Mat> &cropped_image_vec, std::vector<cv::Mat> &resized_image_vec, HailoROIPtr roi, GstVideoFormat image_format);
+static gboolean gst_hailocropper_get_crop_resize_mode(GstHailoBaseCropper *basecropper, gboolean *letterbox, gboolean *update_scaling_bbox);
 
 static void
 gst_hailocropper_class_init(GstHailoCropperClass *klass)
@@ -107,9 +110,16 @@ gst_hailocropper_class_init(GstHailoCropperClass *klass)
                                     g_param_spec_boolean("no-scaling-bbox", "No scaling bbox",
                                                          "If true, when setting use-letterbox no scaling box will be added. Use this if the crop you are using should not modify the original bbox data. For example running face recognition on a face. Default false.", false,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_MAX_CROPS_PER_FRAME,
+                                    g_param_spec_uint("max-crops-per-frame", "Max crops per frame",
+                                                      "The most crops sent per frame, 0 for no limit. The so function chooses which crops come first. "
+                                                      "If the so exports <function-name>_set_max_crops(guint) it is told the limit, so it can choose the crops itself (e.g. the recognition croppers). Default 0.",
+                                                      0, G_MAXUINT, 0,
+                                                      (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     gstelement_class->change_state = GST_DEBUG_FUNCPTR(gst_hailocropper_change_state);
     basecropper_class->prepare_crops = gst_hailocropper_prepare_crops;
     basecropper_class->resize = gst_hailocropper_resize_by_method;
+    basecropper_class->get_crop_resize_mode = gst_hailocropper_get_crop_resize_mode;
 }
 
 static void
@@ -118,6 +128,22 @@ gst_hailocropper_init(GstHailoCropper *hailocropper)
     GST_DEBUG_OBJECT(hailocropper, "init");
     hailocropper->method = cv::INTER_LINEAR;
     hailocropper->use_letterbox = false;
+    hailocropper->max_crops_per_frame = 0;
+    hailocropper->set_max_crops = nullptr;
+}
+
+/**
+ * @brief Tell the so function the crops limit, if it wants to know.
+ */
+static void gst_hailocropper_update_max_crops(GstHailoCropper *hailocropper)
+{
+    // Not the object lock, the so function may take its own locks
+    std::lock_guard<std::mutex> lock(hailocropper->symbol_mutex);
+    GST_OBJECT_LOCK(hailocropper);
+    guint max_crops = hailocropper->max_crops_per_frame;
+    GST_OBJECT_UNLOCK(hailocropper);
+    if (hailocropper->set_max_crops)
+        hailocropper->set_max_crops(max_crops);
 }
 
 static void
@@ -145,6 +171,12 @@ gst_hailocropper_set_property(GObject *object, guint prop_id,
     case PROP_NO_SCALING_BBOX:
         hailocropper->no_scaling_bbox = g_value_get_boolean(value);
         break;
+    case PROP_MAX_CROPS_PER_FRAME:
+        GST_OBJECT_LOCK(hailocropper);
+        hailocropper->max_crops_per_frame = g_value_get_uint(value);
+        GST_OBJECT_UNLOCK(hailocropper);
+        gst_hailocropper_update_max_crops(hailocropper);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -176,6 +208,11 @@ gst_hailocropper_get_property(GObject *object, guint prop_id,
     case PROP_NO_SCALING_BBOX:
         g_value_set_boolean(value, hailocropper->no_scaling_bbox);
         break;
+    case PROP_MAX_CROPS_PER_FRAME:
+        GST_OBJECT_LOCK(hailocropper);
+        g_value_set_uint(value, hailocropper->max_crops_per_frame);
+        GST_OBJECT_UNLOCK(hailocropper);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -195,6 +232,21 @@ void gst_hailocropper_resize_by_method(GstHailoBaseCropper *basecropper, std::ve
     }
 }
 
+/**
+ * @brief Only bilinear resizing can be handed to the parallel crop-resize engine.
+ */
+static gboolean gst_hailocropper_get_crop_resize_mode(GstHailoBaseCropper *basecropper, gboolean *letterbox, gboolean *update_scaling_bbox)
+{
+    GstHailoCropper *hailocropper = GST_HAILO_CROPPER(basecropper);
+    GST_OBJECT_LOCK(hailocropper);
+    cv::InterpolationFlags method = hailocropper->method;
+    GST_OBJECT_UNLOCK(hailocropper);
+
+    *letterbox = hailocropper->use_letterbox;
+    *update_scaling_bbox = !hailocropper->no_scaling_bbox;
+    return method == cv::INTER_LINEAR;
+}
+
 /**
  * @brief Calls the so function to retrieve the ROI's to crop.
  *
@@ -217,6 +269,12 @@ static std::vector<HailoROIPtr> gst_hailocropper_prepare_crops(GstHailoBaseCropp
 
     std::vector<HailoROIPtr> crop_rois = hailocropper->handler(image, hailo_roi);
     gst_caps_unref(caps);
+
+    GST_OBJECT_LOCK(hailocropper);
+    guint max_crops = hailocropper->max_crops_per_frame;
+    GST_OBJECT_UNLOCK(hailocropper);
+    if (max_crops && crop_rois.size() > max_crops)
+        crop_rois.resize(max_crops);
     return crop_rois;
 }
 
@@ -240,18 +298,32 @@ gst_hailocropper_load_symbol(GstHailoCropper *hailocropper)
     {
         std::cerr << "Cannot load symbol: " << dlsym_error << std::endl;
         dlclose(hailocropper->loaded_lib);
+        hailocropper->loaded_lib = nullptr;
         return FALSE;
     }
 
+    // Optional, lets the so choose which crops fit the crops limit
+    std::string set_max_crops_name = std::string(hailocropper->function_name) + "_set_max_crops";
+    void (*set_max_crops)(guint) = (void (*)(guint))dlsym(hailocropper->loaded_lib, set_max_crops_name.c_str());
+    dlerror();
+    {
+        std::lock_guard<std::mutex> lock(hailocropper->symbol_mutex);
+        hailocropper->set_max_crops = set_max_crops;
+    }
+    gst_hailocropper_update_max_crops(hailocropper);
+
     return TRUE;
 }
 
 static gboolean
 gst_hailocropper_free_symbol(GstHailoCropper *hailocropper)
 {
+    std::lock_guard<std::mutex> lock(hailocropper->symbol_mutex);
+    hailocropper->set_max_crops = nullptr;
     if (hailocropper->loaded_lib)
     {
         dlclose(hailocropper->loaded_lib);
+        hailocropper->loaded_lib = nullptr;
     }
     return TRUE;
 }
@@ -7,6 +7,7 @@
 #include <gst/gst.h>
 #include <opencv2/opencv.hpp>
 #include <dlfcn.h>
+#include <mutex>
 #include "cropping/gsthailobasecropper.hpp"
 #include "hailomat.hpp"
 
@@ -32,8 +33,12 @@ struct _GstHailoCropper
     gboolean use_letterbox;
     gboolean no_scaling_bbox;
     cv::InterpolationFlags method;
+    guint max_crops_per_frame;
     void *loaded_lib;
     std::vector<HailoROIPtr> (*handler)(std::shared_ptr<HailoMat>, HailoROIPtr);
+    void (*set_max_crops)(guint);
+    // Held while calling set_max_crops, so the so isn't closed under the call
+    std::mutex symbol_mutex;
 };
 
 struct _GstHailoCropperClass
@@ -0,0 +1,232 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+// General cpp includes
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "common/binary_meta.hpp"
+
+namespace encode_binary
+{
+    void encode_bbox(binary_meta::Writer &writer, HailoBBox bbox);
+    void encode_detection(binary_meta::Writer &writer, HailoDetectionPtr detection);
+    void encode_classification(binary_meta::Writer &writer, HailoClassificationPtr classification);
+    void encode_landmarks(binary_meta::Writer &writer, HailoLandmarksPtr landmarks);
+    void encode_tile(binary_meta::Writer &writer, HailoTileROIPtr tile);
+    void encode_unique_id(binary_meta::Writer &writer, HailoUniqueIDPtr id);
+    void encode_depth_mask(binary_meta::Writer &writer, HailoDepthMaskPtr mask);
+    void encode_class_mask(binary_meta::Writer &writer, HailoClassMaskPtr mask);
+    void encode_conf_class_mask(binary_meta::Writer &writer, HailoConfClassMaskPtr mask);
+    void encode_matrix(binary_meta::Writer &writer, HailoMatrixPtr matrix);
+    void encode_hailo_objects(binary_meta::Writer &writer, HailoROIPtr roi);
+}
+
+namespace encode_binary
+{
+    inline void encode_bbox(binary_meta::Writer &writer, HailoBBox bbox)
+    {
+        writer.f32(bbox.xmin());
+        writer.f32(bbox.ymin());
+        writer.f32(bbox.width());
+        writer.f32(bbox.height());
+    }
+
+    inline void encode_detection(binary_meta::Writer &writer, HailoDetectionPtr detection)
+    {
+        encode_bbox(writer, detection->get_bbox());
+        writer.i32(detection->get_class_id());
+        writer.f32(detection->get_confidence());
+        writer.string(detection->get_label());
+
+        // Recurse this object
+        encode_hailo_objects(writer, detection);
+    }
+
+    inline void encode_classification(binary_meta::Writer &writer, HailoClassificationPtr classification)
+    {
+        writer.string(classification->get_classification_type());
+        writer.i32(classification->get_class_id());
+        writer.f32(classification->get_confidence());
+        writer.string(classification->get_label());
+    }
+
+    inline void encode_landmarks(binary_meta::Writer &writer, HailoLandmarksPtr landmarks)
+    {
+        writer.string(landmarks->get_landmarks_type());
+        writer.f32(landmarks->get_threshold());
+        std::vector<HailoPoint> points = landmarks->get_points();
+        writer.u32(points.size());
+        for (auto &point : points)
+        {
+            writer.f32(point.x());
+            writer.f32(point.y());
+            writer.f32(point.confidence());
+        }
+        std::vector<std::pair<int, int>> pairs = landmarks->get_pairs();
+        writer.u32(pairs.size());
+        for (auto &pair : pairs)
+        {
+            writer.i32(pair.first);
+            writer.i32(pair.second);
+        }
+    }
+
+    inline void encode_tile(binary_meta::Writer &writer, HailoTileROIPtr tile)
+    {
+        encode_bbox(writer, tile->get_bbox());
+        writer.u32(tile->get_index());
+        writer.u32(tile->get_layer());
+        writer.u32(tile->get_mode());
+        writer.f32(tile->get_overlap_x_axis());
+        writer.f32(tile->get_overlap_y_axis());
+
+        // Recurse this object
+        encode_hailo_objects(writer, tile);
+    }
+
+    inline void encode_unique_id(binary_meta::Writer &writer, HailoUniqueIDPtr id)
+    {
+        writer.i32(id->get_id());
+        writer.u32(id->get_mode());
+    }
+
+    template <class T>
+    void encode_mask(binary_meta::Writer &writer, T mask)
+    {
+        writer.i32(mask->get_width());
+        writer.i32(mask->get_height());
+        writer.f32(mask->get_transparency());
+        writer.blob(mask->get_data());
+    }
+
+    inline void encode_depth_mask(binary_meta::Writer &writer, HailoDepthMaskPtr mask)
+    {
+        encode_mask(writer, mask);
+    }
+
+    inline void encode_class_mask(binary_meta::Writer &writer, HailoClassMaskPtr mask)
+    {
+        encode_mask(writer, mask);
+    }
+
+    inline void encode_conf_class_mask(binary_meta::Writer &writer, HailoConfClassMaskPtr mask)
+    {
+        encode_mask(writer, mask);
+        writer.i32(mask->get_class_id());
+    }
+
+    inline void encode_matrix(binary_meta::Writer &writer, HailoMatrixPtr matrix)
+    {
+        writer.u32(matrix->width());
+        writer.u32(matrix->height());
+        writer.u32(matrix->features());
+        writer.blob(matrix->get_data());
+    }
+
+    /**
+     * @brief Writes an object as tag | body size | body, objects of other types are skipped.
+     */
+    inline void encode_object(binary_meta::Writer &writer, HailoObjectPtr obj, uint32_t &count)
+    {
+        binary_meta::wire_tag_t tag;
+        switch (obj->get_type())
+        {
+        case HAILO_DETECTION:
+            tag = binary_meta::TAG_DETECTION;
+            break;
+        case HAILO_CLASSIFICATION:
+            tag = binary_meta::TAG_CLASSIFICATION;
+            break;
+        case HAILO_LANDMARKS:
+            tag = binary_meta::TAG_LANDMARKS;
+            break;
+        case HAILO_TILE:
+            tag = binary_meta::TAG_TILE;
+            break;
+        case HAILO_UNIQUE_ID:
+            tag = binary_meta::TAG_UNIQUE_ID;
+            break;
+        case HAILO_MATRIX:
+            tag = binary_meta::TAG_MATRIX;
+            break;
+        case HAILO_DEPTH_MASK:
+            tag = binary_meta::TAG_DEPTH_MASK;
+            break;
+        case HAILO_CLASS_MASK:
+            tag = binary_meta::TAG_CLASS_MASK;
+            break;
+        case HAILO_CONF_CLASS_MASK:
+            tag = binary_meta::TAG_CONF_CLASS_MASK;
+            break;
+        default:
+            return;
+        }
+
+        writer.u8(tag);
+        size_t body = writer.begin_size();
+        switch (tag)
+        {
+        case binary_meta::TAG_DETECTION:
+            encode_detection(writer, std::dynamic_pointer_cast<HailoDetection>(obj));
+            break;
+        case binary_meta::TAG_CLASSIFICATION:
+            encode_classification(writer, std::dynamic_pointer_cast<HailoClassification>(obj));
+            break;
+        case binary_meta::TAG_LANDMARKS:
+            encode_landmarks(writer, std::dynamic_pointer_cast<HailoLandmarks>(obj));
+            break;
+        case binary_meta::TAG_TILE:
+            encode_tile(writer, std::dynamic_pointer_cast<HailoTileROI>(obj));
+            break;
+        case binary_meta::TAG_UNIQUE_ID:
+            encode_unique_id(writer, std::dynamic_pointer_cast<HailoUniqueID>(obj));
+            break;
+        case binary_meta::TAG_MATRIX:
+            encode_matrix(writer, std::dynamic_pointer_cast<HailoMatrix>(obj));
+            break;
+        case binary_meta::TAG_DEPTH_MASK:
+            encode_depth_mask(writer, std::dynamic_pointer_cast<HailoDepthMask>(obj));
+            break;
+        case binary_meta::TAG_CLASS_MASK:
+            encode_class_mask(writer, std::dynamic_pointer_cast<HailoClassMask>(obj));
+            break;
+        case binary_meta::TAG_CONF_CLASS_MASK:
+            encode_conf_class_mask(writer, std::dynamic_pointer_cast<HailoConfClassMask>(obj));
+            break;
+        }
+        writer.end_size(body);
+        count++;
+    }
+
+    inline void encode_hailo_objects(binary_meta::Writer &writer, HailoROIPtr roi)
+    {
+        // The count is patched once the objects are written, since unsupported types are skipped
+        size_t count_position = writer.size();
+        writer.u32(0);
+        uint32_t count = 0;
+        for (auto obj : roi->get_objects())
+            encode_object(writer, obj, count);
+        writer.patch_u32(count_position, count);
+    }
+
+    /**
+     * @brief Encodes a ROI tree as one binary meta message, appended to buffer.
+     *
+     * @param buffer  -  std::vector<uint8_t>
+     *        The output. Clear it between messages to reuse its capacity.
+     */
+    inline void encode_hailo_roi(HailoROIPtr roi, std::vector<uint8_t> &buffer, uint64_t timestamp_ms = 0, uint64_t buffer_offset = 0)
+    {
+        binary_meta::Writer writer(buffer);
+        size_t message_start = writer.size();
+        binary_meta::write_header(writer, timestamp_ms, buffer_offset);
+        encode_bbox(writer, roi->get_bbox());
+        encode_hailo_objects(writer, roi);
+        binary_meta::finish_message(writer, message_start);
+    }
+}
@@ -5,7 +5,11 @@
 #pragma once
 
 // General cpp includes
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <string>
 
 // Tappas includes
 #include "hailo_objects.hpp"
@@ -19,6 +23,7 @@
 #include "rapidjson/filereadstream.h"
 #include "rapidjson/schema.h"
 #include "rapidjson/prettywriter.h"
+#include "rapidjson/writer.h"
 
 namespace encode_json
 {
@@ -361,5 +366,387 @@ namespace encode_json
 
         return document;
     }
+}
+
+//******************************************************************
+// STREAMING ENCODER
+//******************************************************************
+// Writes the same JSON as encode_hailo_roi straight to a rapidjson Writer (or PrettyWriter),
+// without building a Document: no allocation per object and no copied strings.
+namespace encode_json
+{
+    struct EncodeOptions
+    {
+        int matrix_precision = -1; // Decimal places of HailoMatrix data, -1 writes the shortest round-trip (default schema)
+        bool matrix_base64 = false; // Write HailoMatrix data as "data_base64", the base64 of the raw float32 values
+    };
+
+    static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    inline void base64_encode(const uint8_t *data, size_t size, std::string &out)
+    {
+        out.clear();
+        out.reserve((size + 2) / 3 * 4);
+        size_t i = 0;
+        for (; i + 2 < size; i += 3)
+        {
+            uint32_t triple = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+            out.push_back(BASE64_ALPHABET[(triple >> 18) & 0x3f]);
+            out.push_back(BASE64_ALPHABET[(triple >> 12) & 0x3f]);
+            out.push_back(BASE64_ALPHABET[(triple >> 6) & 0x3f]);
+            out.push_back(BASE64_ALPHABET[triple & 0x3f]);
+        }
+        if (i < size)
+        {
+            uint32_t triple = (data[i] << 16) | ((i + 1 < size) ? (data[i + 1] << 8) : 0);
+            out.push_back(BASE64_ALPHABET[(triple >> 18) & 0x3f]);
+            out.push_back(BASE64_ALPHABET[(triple >> 12) & 0x3f]);
+            out.push_back((i + 1 < size) ? BASE64_ALPHABET[(triple >> 6) & 0x3f] : '=');
+            out.push_back('=');
+        }
+    }
+
+    /**
+     * @brief Write a float with at most precision decimal places (trailing zeros dropped).
+     *        Integer formatting, much cheaper than finding the shortest round-trip double.
+     */
+    template <typename Writer>
+    void write_fixed_float(Writer &writer, float value, int precision)
+    {
+        static const uint64_t powers[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+        if (precision < 0 || precision > 9 || !std::isfinite(value) || std::fabs(value) * powers[precision] >= 9.0e18)
+        {
+            writer.Double(value);
+            return;
+        }
+        uint64_t scaled = std::llround(std::fabs((double)value) * powers[precision]);
+        uint64_t integer = scaled / powers[precision];
+        uint64_t fraction = scaled % powers[precision];
+
+        char text[32];
+        char *end = text + sizeof(text);
+        char *start = end;
+        // Fraction digits from the least significant, dropping the trailing zeros, at least ".0"
+        int digits = precision;
+        while (digits > 1 && fraction % 10 == 0)
+        {
+            fraction /= 10;
+            digits--;
+        }
+        for (int i = 0; i < digits; i++)
+        {
+            *--start = '0' + fraction % 10;
+            fraction /= 10;
+        }
+        if (digits == 0)
+            *--start = '0';
+        *--start = '.';
+        do
+        {
+            *--start = '0' + integer % 10;
+            integer /= 10;
+        } while (integer);
+        if (value < 0 && scaled != 0)
+            *--start = '-';
+        writer.RawValue(start, end - start, rapidjson::kNumberType);
+    }
+
+    template <typename Writer>
+    void write_string(Writer &writer, const std::string &value)
+    {
+        writer.String(value.c_str(), value.size());
+    }
+
+    template <typename Writer>
+    void write_bbox(Writer &writer, HailoBBox bbox)
+    {
+        writer.Key("HailoBBox");
+        writer.StartObject();
+        writer.Key("xmin");
+        writer.Double(bbox.xmin());
+        writer.Key("ymin");
+        writer.Double(bbox.ymin());
+        writer.Key("width");
+        writer.Double(bbox.width());
+        writer.Key("height");
+        writer.Double(bbox.height());
+        writer.EndObject();
+    }
+
+    template <typename Writer>
+    void write_hailo_objects(Writer &writer, HailoROIPtr roi, const EncodeOptions &options);
+
+    template <typename Writer>
+    void write_detection(Writer &writer, HailoDetectionPtr detection, const EncodeOptions &options)
+    {
+        writer.Key("HailoDetection");
+        writer.StartObject();
+        writer.Key("label");
+        write_string(writer, detection->get_label());
+        writer.Key("class_id");
+        writer.Int(detection->get_class_id());
+        writer.Key("confidence");
+        writer.Double(detection->get_confidence());
+        write_bbox(writer, detection->get_bbox());
+        write_hailo_objects(writer, detection, options);
+        writer.EndObject();
+    }
+
+    template <typename Writer>
+    void write_classification(Writer &writer, HailoClassificationPtr classification)
+    {
+        writer.Key("HailoClassification");
+        writer.StartObject();
+        writer.Key("label");
+        write_string(writer, classification->get_label());
+        writer.Key("classification_type");
+        write_string(writer, classification->get_classification_type());
+        writer.Key("class_id");
+        writer.Int(classification->get_class_id());
+        writer.Key("confidence");
+        writer.Double(classification->get_confidence());
+        writer.EndObject();
+    }
+
+    template <typename Writer>
+    void write_landmarks(Writer &writer, HailoLandmarksPtr landmarks)
+    {
+        writer.Key("HailoLandmarks");
+        writer.StartObject();
+        writer.Key("landmarks_type");
+        write_string(writer, landmarks->get_landmarks_type());
+        writer.Key("threshold");
+        writer.Double(landmarks->get_threshold());
+        writer.Key("points");
+        writer.StartArray();
+        for (auto &point : landmarks->get_points())
+        {
+            writer.StartObject();
+            writer.Key("x");
+            writer.Double(point.x());
+            writer.Key("y");
+            writer.Double(point.y());
+            writer.Key("confidence");
+            writer.Double(point.confidence());
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.Key("pairs");
+        writer.StartArray();
+        for (auto &pair : landmarks->get_pairs())
+        {
+            writer.StartArray();
+            writer.Int(pair.first);
+            writer.Int(pair.second);
+            writer.EndArray();
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+
+    template <typename Writer>
+    void write_tile(Writer &writer, HailoTileROIPtr tile, const EncodeOptions &options)
+    {
+        writer.Key("HailoTileROI");
+        writer.StartObject();
+        writer.Key("index");
+        writer.Uint(tile->get_index());
+        writer.Key("layer");
+        writer.Uint(tile->get_layer());
+        writer.Key("mode");
+        writer.Uint(tile->get_mode());
+        writer.Key("overlap_x_axis");
+        writer.Double(tile->get_overlap_x_axis());
+        writer.Key("overlap_y_axis");
+        writer.Double(tile->get_overlap_y_axis());
+        write_bbox(writer, tile->get_bbox());
+        write_hailo_objects(writer, tile, options);
+        writer.EndObject();
+    }
+
+    template <typename Writer>
+    void write_unique_id(Writer &writer, HailoUniqueIDPtr id)
+    {
+        writer.Key("HailoUniqueID");
+        writer.StartObject();
+        writer.Key("unique_id");
+        writer.Int(id->get_id());
+        writer.Key("mode");
+        writer.Int(id->get_mode());
+        writer.EndObject();
+    }
+
+    template <typename Writer>
+    void write_mask_value(Writer &writer, float value) { writer.Double(value); }
+    template <typename Writer>
+    void write_mask_value(Writer &writer, uint8_t value) { writer.Int(value); }
+
+    // Writes the members shared by all masks, the caller closes the object
+    template <typename Writer, class T>
+    void write_mask(Writer &writer, const char *name, T mask)
+    {
+        writer.Key(name);
+        writer.StartObject();
+        writer.Key("mask_width");
+        writer.Int(mask->get_width());
+        writer.Key("mask_height");
+        writer.Int(mask->get_height());
+        writer.Key("transparency");
+        writer.Double(mask->get_transparency());
+        writer.Key("data");
+        writer.StartArray();
+        for (auto value : mask->get_data())
+            write_mask_value(writer, value);
+        writer.EndArray();
+    }
+
+    template <typename Writer>
+    void write_matrix(Writer &writer, HailoMatrixPtr matrix, const EncodeOptions &options)
+    {
+        writer.Key("HailoMatrix");
+        writer.StartObject();
+        writer.Key("width");
+        writer.Uint(matrix->width());
+        writer.Key("height");
+        writer.Uint(matrix->height());
+        writer.Key("features");
+        writer.Uint(matrix->features());
+        const std::vector<float> &data = matrix->get_data();
+        if (options.matrix_base64)
+        {
+            static thread_local std::string encoded;
+            base64_encode(reinterpret_cast<const uint8_t *>(data.data()), data.size() * sizeof(float), encoded);
+            writer.Key("data_base64");
+            write_string(writer, encoded);
+        }
+        else
+        {
+            writer.Key("data");
+            writer.StartArray();
+            for (float value : data)
+            {
+                if (options.matrix_precision < 0)
+                    writer.Double(value);
+                else
+                    write_fixed_float(writer, value, options.matrix_precision);
+            }
+            writer.EndArray();
+        }
+        writer.EndObject();
+    }
 
-}
\ No newline at end of file
+    template <typename Writer>
+    void write_hailo_objects(Writer &writer, HailoROIPtr roi, const EncodeOptions &options)
+    {
+        writer.Key("SubObjects");
+        writer.StartArray();
+        for (auto &obj : roi->get_objects())
+        {
+            switch (obj->get_type())
+            {
+            case HAILO_DETECTION:
+                writer.StartObject();
+                write_detection(writer, std::static_pointer_cast<HailoDetection>(obj), options);
+                writer.EndObject();
+                break;
+            case HAILO_CLASSIFICATION:
+                writer.StartObject();
+                write_classification(writer, std::static_pointer_cast<HailoClassification>(obj));
+                writer.EndObject();
+                break;
+            case HAILO_LANDMARKS:
+                writer.StartObject();
+                write_landmarks(writer, std::static_pointer_cast<HailoLandmarks>(obj));
+                writer.EndObject();
+                break;
+            case HAILO_TILE:
+                writer.StartObject();
+                write_tile(writer, std::static_pointer_cast<HailoTileROI>(obj), options);
+                writer.EndObject();
+                break;
+            case HAILO_UNIQUE_ID:
+                writer.StartObject();
+                write_unique_id(writer, std::static_pointer_cast<HailoUniqueID>(obj));
+                writer.EndObject();
+                break;
+            case HAILO_DEPTH_MASK:
+                writer.StartObject();
+                write_mask(writer, "HailoDepthMask", std::static_pointer_cast<HailoDepthMask>(obj));
+                writer.EndObject();
+                writer.EndObject();
+                break;
+            case HAILO_CLASS_MASK:
+                writer.StartObject();
+                write_mask(writer, "HailoClassMask", std::static_pointer_cast<HailoClassMask>(obj));
+                writer.EndObject();
+                writer.EndObject();
+                break;
+            case HAILO_CONF_CLASS_MASK:
+            {
+                HailoConfClassMaskPtr mask = std::static_pointer_cast<HailoConfClassMask>(obj);
+                writer.StartObject();
+                write_mask(writer, "HailoConfClassMask", mask);
+                writer.Key("class_id");
+                writer.Int(mask->get_class_id());
+                writer.EndObject();
+                writer.EndObject();
+                break;
+            }
+            case HAILO_MATRIX:
+                writer.StartObject();
+                write_matrix(writer, std::static_pointer_cast<HailoMatrix>(obj), options);
+                writer.EndObject();
+                break;
+            default:
+                // continue
+                break;
+            }
+        }
+        writer.EndArray();
+    }
+
+    /**
+     * @brief Write the "HailoROI" member of a frame entry, inside an object the caller opened.
+     */
+    template <typename Writer>
+    void write_hailo_roi(Writer &writer, HailoROIPtr roi, const EncodeOptions &options = EncodeOptions())
+    {
+        writer.Key("HailoROI");
+        writer.StartObject();
+        write_bbox(writer, roi->get_bbox());
+        write_hailo_objects(writer, roi, options);
+        writer.EndObject();
+    }
+
+    /**
+     * @brief Encodes frame entries to JSON text into an output buffer that is reused between frames,
+     *        so once it has grown to the size of a frame, encoding doesn't allocate.
+     *        Usage: begin(roi), add members through writer(), end(), then read data() / size().
+     */
+    class StreamEncoder
+    {
+    public:
+        StreamEncoder(EncodeOptions options = EncodeOptions()) : m_writer(m_buffer), m_options(options){};
+
+        void set_options(EncodeOptions options) { m_options = options; }
+
+        void begin(HailoROIPtr roi)
+        {
+            m_buffer.Clear();
+            m_writer.Reset(m_buffer);
+            m_writer.StartObject();
+            write_hailo_roi(m_writer, roi, m_options);
+        }
+
+        void end() { m_writer.EndObject(); }
+
+        rapidjson::Writer<rapidjson::StringBuffer> &writer() { return m_writer; }
+        const char *data() { return m_buffer.GetString(); }
+        size_t size() { return m_buffer.GetSize(); }
+
+    private:
+        rapidjson::StringBuffer m_buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> m_writer;
+        EncodeOptions m_options;
+    };
+}
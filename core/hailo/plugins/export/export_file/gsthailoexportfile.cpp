@@ -178,16 +178,11 @@ gst_hailoexportfile_transform_ip(GstBaseTransform *trans,
 {
     GstHailoExportFile *hailoexportfile = GST_HAILO_EXPORT_FILE(trans);
 
-    // Get the roi from the current buffer and encode it to a JSON entry
+    // Get the roi from the current buffer
     HailoROIPtr hailo_roi = get_hailo_main_roi(buffer, true);
-    rapidjson::Document encoded_roi = encode_json::encode_hailo_roi(hailo_roi);
-
-    // Add a timestamp
     auto timenow = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-    encoded_roi.AddMember("timestamp (ms)", rapidjson::Value(timenow), encoded_roi.GetAllocator());
-    encoded_roi.AddMember("buffer_offset", rapidjson::Value(hailoexportfile->buffer_offset), encoded_roi.GetAllocator());
 
-    // Add the stream-id
+    // Get the stream-id
     std::string stream_id = hailo_roi->get_stream_id();
 
     if (stream_id.length() == 0)
@@ -197,8 +192,6 @@ gst_hailoexportfile_transform_ip(GstBaseTransform *trans,
         g_free(id);
     }
 
-    encoded_roi.AddMember("stream_id", stream_id, encoded_roi.GetAllocator() );
-
     // Open the file 
     hailoexportfile->json_file = fopen(hailoexportfile->file_path, "rb+");
 
@@ -210,11 +203,21 @@ gst_hailoexportfile_transform_ip(GstBaseTransform *trans,
         std::fseek(hailoexportfile->json_file, -1, SEEK_END);
     }
 
-    // Append the new entry to the document
+    // Encode the roi and append it as a new entry to the document, straight to the file
     char writeBuffer[65536];
     rapidjson::FileWriteStream write_stream(hailoexportfile->json_file, writeBuffer, sizeof(writeBuffer));
     rapidjson::PrettyWriter<rapidjson::FileWriteStream> writer(write_stream);
-    encoded_roi.Accept(writer);
+    writer.StartObject();
+    encode_json::write_hailo_roi(writer, hailo_roi);
+
+    // Add a timestamp, the buffer offset and the stream-id
+    writer.Key("timestamp (ms)");
+    writer.Int64(timenow);
+    writer.Key("buffer_offset");
+    writer.Uint(hailoexportfile->buffer_offset);
+    writer.Key("stream_id");
+    encode_json::write_string(writer, stream_id);
+    writer.EndObject();
 
     // Close the array
     std::fputc(']', hailoexportfile->json_file);
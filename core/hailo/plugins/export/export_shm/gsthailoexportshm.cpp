@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include "gsthailoexportshm.hpp"
+#include "gst_hailo_meta.hpp"
+#include <chrono>
+#include <stdexcept>
+#include <gst/gst.h>
+
+GST_DEBUG_CATEGORY_STATIC(gst_hailoexportshm_debug_category);
+#define GST_CAT_DEFAULT gst_hailoexportshm_debug_category
+
+#define DEFAULT_SHM_NAME "hailo_meta"
+
+/* prototypes */
+
+static void gst_hailoexportshm_set_property(GObject *object,
+                                            guint property_id, const GValue *value, GParamSpec *pspec);
+static void gst_hailoexportshm_get_property(GObject *object,
+                                            guint property_id, GValue *value, GParamSpec *pspec);
+static void gst_hailoexportshm_finalize(GObject *object);
+
+static gboolean gst_hailoexportshm_start(GstBaseTransform *trans);
+static gboolean gst_hailoexportshm_stop(GstBaseTransform *trans);
+static GstFlowReturn gst_hailoexportshm_transform_ip(GstBaseTransform *trans,
+                                                     GstBuffer *buffer);
+
+/* class initialization */
+
+G_DEFINE_TYPE_WITH_CODE(GstHailoExportSHM, gst_hailoexportshm, GST_TYPE_BASE_TRANSFORM,
+                        GST_DEBUG_CATEGORY_INIT(gst_hailoexportshm_debug_category, "hailoexportshm", 0,
+                                                "debug category for hailoexportshm element"));
+
+enum
+{
+    PROP_0,
+    PROP_SHM_NAME,
+    PROP_SLOTS,
+    PROP_SLOT_SIZE,
+    PROP_SHM_MODE,
+};
+
+static void
+gst_hailoexportshm_class_init(GstHailoExportSHMClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GstBaseTransformClass *base_transform_class =
+        GST_BASE_TRANSFORM_CLASS(klass);
+
+    const char *description = "Exports HailoObjects to a shared-memory ring, for hailoimportshm in other processes on the same machine."
+                              "\n\t\t\t   "
+                              "Encodes classes contained by HailoROI objects to the binary meta format.";
+    gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass),
+                                       gst_pad_template_new("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+                                                            gst_caps_new_any()));
+    gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass),
+                                       gst_pad_template_new("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+                                                            gst_caps_new_any()));
+
+    gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass),
+                                          "hailoexportshm - export element",
+                                          "Hailo/Tools",
+                                          description,
+                                          "hailo.ai <contact@hailo.ai>");
+
+    gobject_class->set_property = gst_hailoexportshm_set_property;
+    gobject_class->get_property = gst_hailoexportshm_get_property;
+    g_object_class_install_property(gobject_class, PROP_SHM_NAME,
+                                    g_param_spec_string("shm-name", "Shared memory name",
+                                                        "Name of the shared-memory segment (under /dev/shm), has to match the importers.", DEFAULT_SHM_NAME,
+                                                        (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_SLOTS,
+                                    g_param_spec_uint("slots", "Ring slots",
+                                                      "Number of messages kept in the ring, an importer that falls further behind drops messages.",
+                                                      1, 4096, SHM_META_RING_DEFAULT_SLOTS,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_SLOT_SIZE,
+                                    g_param_spec_uint("slot-size", "Slot size",
+                                                      "Maximal size of a message in bytes, larger messages are not exported.",
+                                                      64, G_MAXINT32, SHM_META_RING_DEFAULT_SLOT_SIZE,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_SHM_MODE,
+                                    g_param_spec_uint("shm-mode", "Shared memory mode",
+                                                      "Permission bits of the segment (384 = 0600, only the user of the exporter). "
+                                                      "Importers of other users need read and write permission.",
+                                                      0, 0777, SHM_META_RING_DEFAULT_MODE,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+
+    gobject_class->finalize = gst_hailoexportshm_finalize;
+    base_transform_class->start = GST_DEBUG_FUNCPTR(gst_hailoexportshm_start);
+    base_transform_class->stop = GST_DEBUG_FUNCPTR(gst_hailoexportshm_stop);
+    base_transform_class->transform_ip = GST_DEBUG_FUNCPTR(gst_hailoexportshm_transform_ip);
+}
+
+static void
+gst_hailoexportshm_init(GstHailoExportSHM *hailoexportshm)
+{
+    hailoexportshm->shm_name = g_strdup(DEFAULT_SHM_NAME);
+    hailoexportshm->slots = SHM_META_RING_DEFAULT_SLOTS;
+    hailoexportshm->slot_size = SHM_META_RING_DEFAULT_SLOT_SIZE;
+    hailoexportshm->shm_mode = SHM_META_RING_DEFAULT_MODE;
+    hailoexportshm->buffer_offset = 0;
+    hailoexportshm->writer = nullptr;
+    hailoexportshm->binary_buffer = nullptr;
+}
+
+void gst_hailoexportshm_set_property(GObject *object, guint property_id,
+                                     const GValue *value, GParamSpec *pspec)
+{
+    GstHailoExportSHM *hailoexportshm = GST_HAILO_EXPORT_SHM(object);
+
+    GST_DEBUG_OBJECT(hailoexportshm, "set_property");
+
+    switch (property_id)
+    {
+    case PROP_SHM_NAME:
+        g_free(hailoexportshm->shm_name);
+        hailoexportshm->shm_name = g_value_dup_string(value);
+        break;
+    case PROP_SLOTS:
+        hailoexportshm->slots = g_value_get_uint(value);
+        break;
+    case PROP_SLOT_SIZE:
+        hailoexportshm->slot_size = g_value_get_uint(value);
+        break;
+    case PROP_SHM_MODE:
+        hailoexportshm->shm_mode = g_value_get_uint(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+        break;
+    }
+}
+
+void gst_hailoexportshm_get_property(GObject *object, guint property_id,
+                                     GValue *value, GParamSpec *pspec)
+{
+    GstHailoExportSHM *hailoexportshm = GST_HAILO_EXPORT_SHM(object);
+
+    GST_DEBUG_OBJECT(hailoexportshm, "get_property");
+
+    switch (property_id)
+    {
+    case PROP_SHM_NAME:
+        g_value_set_string(value, hailoexportshm->shm_name);
+        break;
+    case PROP_SLOTS:
+        g_value_set_uint(value, hailoexportshm->slots);
+        break;
+    case PROP_SLOT_SIZE:
+        g_value_set_uint(value, hailoexportshm->slot_size);
+        break;
+    case PROP_SHM_MODE:
+        g_value_set_uint(value, hailoexportshm->shm_mode);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+        break;
+    }
+}
+
+void gst_hailoexportshm_finalize(GObject *object)
+{
+    GstHailoExportSHM *hailoexportshm = GST_HAILO_EXPORT_SHM(object);
+    GST_DEBUG_OBJECT(hailoexportshm, "finalize");
+
+    g_free(hailoexportshm->shm_name);
+    hailoexportshm->shm_name = NULL;
+
+    G_OBJECT_CLASS(gst_hailoexportshm_parent_class)->finalize(object);
+}
+
+static gboolean
+gst_hailoexportshm_start(GstBaseTransform *trans)
+{
+    GstHailoExportSHM *hailoexportshm = GST_HAILO_EXPORT_SHM(trans);
+    GST_DEBUG_OBJECT(hailoexportshm, "start");
+
+    try
+    {
+        hailoexportshm->writer = new shm_meta_ring::Writer(hailoexportshm->shm_name, hailoexportshm->slots, hailoexportshm->slot_size,
+                                                           hailoexportshm->shm_mode);
+    }
+    catch (const std::runtime_error &err)
+    {
+        GST_ERROR_OBJECT(hailoexportshm, "hailoexportshm failed to create the ring: %s", err.what());
+        return FALSE;
+    }
+    // Messages are encoded into the same buffer every frame, so it only allocates while it grows
+    hailoexportshm->binary_buffer = new std::vector<uint8_t>();
+    hailoexportshm->binary_buffer->reserve(hailoexportshm->slot_size);
+
+    return TRUE;
+}
+
+static gboolean
+gst_hailoexportshm_stop(GstBaseTransform *trans)
+{
+    GstHailoExportSHM *hailoexportshm = GST_HAILO_EXPORT_SHM(trans);
+    GST_DEBUG_OBJECT(hailoexportshm, "stop");
+
+    // Wakes the importers and removes the segment
+    delete hailoexportshm->writer;
+    hailoexportshm->writer = nullptr;
+    delete hailoexportshm->binary_buffer;
+    hailoexportshm->binary_buffer = nullptr;
+
+    return TRUE;
+}
+
+static GstFlowReturn
+gst_hailoexportshm_transform_ip(GstBaseTransform *trans,
+                                GstBuffer *buffer)
+{
+    GstHailoExportSHM *hailoexportshm = GST_HAILO_EXPORT_SHM(trans);
+
+    HailoROIPtr hailo_roi = get_hailo_main_roi(buffer, true);
+    auto timenow = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    hailoexportshm->binary_buffer->clear();
+    encode_binary::encode_hailo_roi(hailo_roi, *hailoexportshm->binary_buffer, timenow, hailoexportshm->buffer_offset);
+    // The PTS lets importers match the meta to their copy of the frame
+    if (!hailoexportshm->writer->publish(hailoexportshm->binary_buffer->data(), hailoexportshm->binary_buffer->size(), GST_BUFFER_PTS(buffer)))
+        GST_WARNING_OBJECT(hailoexportshm, "hailoexportshm message of %zu bytes is larger than slot-size (%u), not exported",
+                           hailoexportshm->binary_buffer->size(), hailoexportshm->slot_size);
+
+    hailoexportshm->buffer_offset++;
+    GST_DEBUG_OBJECT(hailoexportshm, "transform_ip");
+    return GST_FLOW_OK;
+}
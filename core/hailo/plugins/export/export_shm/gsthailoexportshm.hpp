@@ -0,0 +1,43 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+#pragma once
+
+#include <gst/base/gstbasetransform.h>
+#include "hailo_objects.hpp"
+#include "export/encode_binary.hpp"
+#include "common/shm_meta_ring.hpp"
+#include <vector>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_HAILO_EXPORT_SHM (gst_hailoexportshm_get_type())
+#define GST_HAILO_EXPORT_SHM(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_HAILO_EXPORT_SHM, GstHailoExportSHM))
+#define GST_HAILO_EXPORT_SHM_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_HAILO_EXPORT_SHM, GstHailoExportSHMClass))
+#define GST_IS_HAILO_EXPORT_SHM(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_HAILO_EXPORT_SHM))
+#define GST_IS_HAILO_EXPORT_SHM_CLASS(obj) (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_HAILO_EXPORT_SHM))
+
+typedef struct _GstHailoExportSHM GstHailoExportSHM;
+typedef struct _GstHailoExportSHMClass GstHailoExportSHMClass;
+
+struct _GstHailoExportSHM
+{
+    GstBaseTransform base_hailoexportshm;
+    gchar *shm_name;
+    guint slots;
+    guint slot_size;
+    guint shm_mode;
+    uint buffer_offset;
+    shm_meta_ring::Writer *writer;
+    std::vector<uint8_t> *binary_buffer;
+};
+
+struct _GstHailoExportSHMClass
+{
+    GstBaseTransformClass base_hailoexportshm_class;
+};
+
+GType gst_hailoexportshm_get_type(void);
+
+G_END_DECLS
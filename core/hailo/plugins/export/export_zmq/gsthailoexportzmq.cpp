@@ -45,6 +45,9 @@ enum
 {
     PROP_0,
     PROP_ADDRESS,
+    PROP_FORMAT,
+    PROP_MATRIX_PRECISION,
+    PROP_MATRIX_BASE64,
 };
 
 static void
@@ -54,9 +57,9 @@ gst_hailoexportzmq_class_init(GstHailoExportZMQClass *klass)
     GstBaseTransformClass *base_transform_class =
         GST_BASE_TRANSFORM_CLASS(klass);
 
-    const char *description = "Exports HailoObjects in JSON format to a ZMQ socket."
+    const char *description = "Exports HailoObjects in JSON or binary format to a ZMQ socket."
                               "\n\t\t\t   "
-                              "Encodes classes contained by HailoROI objects to JSON.";
+                              "Encodes classes contained by HailoROI objects to JSON or to the binary meta format.";
     /* Setting up pads and setting metadata should be moved to
        base_class_init if you intend to subclass this class. */
     gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass),
@@ -78,6 +81,21 @@ gst_hailoexportzmq_class_init(GstHailoExportZMQClass *klass)
                                     g_param_spec_string("address", "Endpoint address.",
                                                         "Address to bind the socket to.", "tcp://*:5555",
                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_FORMAT,
+                                    g_param_spec_enum("format", "Message format",
+                                                      "Encoding of the sent meta, binary is much smaller and faster for masks and matrices.",
+                                                      GST_TYPE_HAILO_META_FORMAT, GST_HAILO_META_FORMAT_JSON,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATRIX_PRECISION,
+                                    g_param_spec_int("matrix-precision", "JSON matrix precision",
+                                                     "Decimal places of HailoMatrix data (embeddings) in JSON messages, much faster to write. -1 writes the full precision.",
+                                                     -1, 9, -1,
+                                                     (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATRIX_BASE64,
+                                    g_param_spec_boolean("matrix-base64", "JSON matrix base64",
+                                                         "Write HailoMatrix data (embeddings) in JSON messages as base64 of the raw floats (data_base64), exact and compact.",
+                                                         FALSE,
+                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 
     gobject_class->dispose = gst_hailoexportzmq_dispose;
     gobject_class->finalize = gst_hailoexportzmq_finalize;
@@ -90,7 +108,11 @@ static void
 gst_hailoexportzmq_init(GstHailoExportZMQ *hailoexportzmq)
 {
     hailoexportzmq->address = g_strdup("tcp://*:5555");
+    hailoexportzmq->format = GST_HAILO_META_FORMAT_JSON;
     hailoexportzmq->buffer_offset = 0;
+    hailoexportzmq->binary_buffer = nullptr;
+    hailoexportzmq->json_options = encode_json::EncodeOptions();
+    hailoexportzmq->json_encoder = nullptr;
 }
 
 void gst_hailoexportzmq_set_property(GObject *object, guint property_id,
@@ -105,6 +127,15 @@ void gst_hailoexportzmq_set_property(GObject *object, guint property_id,
     case PROP_ADDRESS:
         hailoexportzmq->address = g_strdup(g_value_get_string(value));
         break;
+    case PROP_FORMAT:
+        hailoexportzmq->format = (GstHailoMetaFormat)g_value_get_enum(value);
+        break;
+    case PROP_MATRIX_PRECISION:
+        hailoexportzmq->json_options.matrix_precision = g_value_get_int(value);
+        break;
+    case PROP_MATRIX_BASE64:
+        hailoexportzmq->json_options.matrix_base64 = g_value_get_boolean(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -123,6 +154,15 @@ void gst_hailoexportzmq_get_property(GObject *object, guint property_id,
     case PROP_ADDRESS:
         g_value_set_string(value, hailoexportzmq->address);
         break;
+    case PROP_FORMAT:
+        g_value_set_enum(value, hailoexportzmq->format);
+        break;
+    case PROP_MATRIX_PRECISION:
+        g_value_set_int(value, hailoexportzmq->json_options.matrix_precision);
+        break;
+    case PROP_MATRIX_BASE64:
+        g_value_set_boolean(value, hailoexportzmq->json_options.matrix_base64);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -162,6 +202,10 @@ gst_hailoexportzmq_start(GstBaseTransform *trans)
     // Bind the socket to the requested address
     hailoexportzmq->socket->bind(hailoexportzmq->address);
 
+    // Messages are encoded into the same buffer every frame, so it only allocates while it grows
+    hailoexportzmq->binary_buffer = new std::vector<uint8_t>();
+    hailoexportzmq->json_encoder = new encode_json::StreamEncoder(hailoexportzmq->json_options);
+
     return TRUE;
 }
 
@@ -175,41 +219,64 @@ gst_hailoexportzmq_stop(GstBaseTransform *trans)
     hailoexportzmq->socket->close();
     hailoexportzmq->context->close();
 
+    delete hailoexportzmq->binary_buffer;
+    hailoexportzmq->binary_buffer = nullptr;
+    delete hailoexportzmq->json_encoder;
+    hailoexportzmq->json_encoder = nullptr;
+
     return TRUE;
 }
 
+/**
+ * @brief Sends a message, the data is copied into the message.
+ */
+static void
+gst_hailoexportzmq_send(GstHailoExportZMQ *hailoexportzmq, const void *data, size_t size)
+{
+    zmq::message_t message(size);
+    // Copy is required since zmq::message_t would only wrap the data, so if the buffer is freed/overwritten
+    // while the message is sending you will get garbage data or a segfault.
+    std::memcpy(message.data(), data, size);
+#if (CPPZMQ_VERSION_MAJOR >= 4 && CPPZMQ_VERSION_MINOR >= 6 && CPPZMQ_VERSION_PATCH >= 0)
+    zmq::send_result_t result = hailoexportzmq->socket->send(message, zmq::send_flags(ZMQ_DONTWAIT));
+#else
+    zmq::detail::send_result_t result = hailoexportzmq->socket->send(message, zmq::send_flags(ZMQ_DONTWAIT));
+#endif
+    if (result != message.size())
+        GST_WARNING("hailoexportzmq failed to send buffer!");
+}
+
 static GstFlowReturn
 gst_hailoexportzmq_transform_ip(GstBaseTransform *trans,
                                  GstBuffer *buffer)
 {
     GstHailoExportZMQ *hailoexportzmq = GST_HAILO_EXPORT_ZMQ(trans);
 
-    // Get the roi from the current buffer and encode it to a JSON entry
     HailoROIPtr hailo_roi = get_hailo_main_roi(buffer, true);
-    rapidjson::Document encoded_roi = encode_json::encode_hailo_roi(hailo_roi);
-
-    // Add a timestamp
     auto timenow = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-    encoded_roi.AddMember("timestamp (ms)", rapidjson::Value(timenow), encoded_roi.GetAllocator());
-    encoded_roi.AddMember("buffer_offset", rapidjson::Value(hailoexportzmq->buffer_offset), encoded_roi.GetAllocator());
 
-    // Get the buffer of the json
-    rapidjson::StringBuffer json_buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(json_buffer);
-    encoded_roi.Accept(writer);
-
-    // Send the message
-    zmq::message_t json_message(json_buffer.GetSize());
-    // Copy is required since zmq::message_t would only wrap the data, so if the buffer is freed/overwritten
-    // while the message is sending you will get garbage data or a segfault.
-    std::memcpy(json_message.data(), json_buffer.GetString(), json_buffer.GetSize()); 
-#if (CPPZMQ_VERSION_MAJOR >= 4 && CPPZMQ_VERSION_MINOR >= 6 && CPPZMQ_VERSION_PATCH >= 0)
-    zmq::send_result_t result = hailoexportzmq->socket->send(json_message, zmq::send_flags(ZMQ_DONTWAIT));
-#else
-    zmq::detail::send_result_t result = hailoexportzmq->socket->send(json_message, zmq::send_flags(ZMQ_DONTWAIT));
-#endif
-    if (result != json_message.size())
-        GST_WARNING("hailoexportzmq failed to send buffer!");
+    if (hailoexportzmq->format == GST_HAILO_META_FORMAT_BINARY)
+    {
+        // The timestamp and buffer offset are part of the binary header
+        hailoexportzmq->binary_buffer->clear();
+        encode_binary::encode_hailo_roi(hailo_roi, *hailoexportzmq->binary_buffer, timenow, hailoexportzmq->buffer_offset);
+        gst_hailoexportzmq_send(hailoexportzmq, hailoexportzmq->binary_buffer->data(), hailoexportzmq->binary_buffer->size());
+    }
+    else
+    {
+        // Encode the roi to a JSON entry, straight to text
+        encode_json::StreamEncoder *encoder = hailoexportzmq->json_encoder;
+        encoder->begin(hailo_roi);
+
+        // Add a timestamp
+        encoder->writer().Key("timestamp (ms)");
+        encoder->writer().Int64(timenow);
+        encoder->writer().Key("buffer_offset");
+        encoder->writer().Uint(hailoexportzmq->buffer_offset);
+        encoder->end();
+
+        gst_hailoexportzmq_send(hailoexportzmq, encoder->data(), encoder->size());
+    }
 
     hailoexportzmq->buffer_offset++;
     GST_DEBUG_OBJECT(hailoexportzmq, "transform_ip");
@@ -7,7 +7,10 @@
 #include <gst/base/gstbasetransform.h>
 #include "hailo_objects.hpp"
 #include "export/encode_json.hpp"
+#include "export/encode_binary.hpp"
+#include "common/meta_format.hpp"
 #include <cstdio>
+#include <vector>
 #include <zmq.hpp>
 
 G_BEGIN_DECLS
@@ -25,7 +28,11 @@ struct _GstHailoExportZMQ
 {
     GstBaseTransform base_hailoexportzmq;
     gchar *address;
+    GstHailoMetaFormat format;
     uint buffer_offset;
+    std::vector<uint8_t> *binary_buffer;
+    encode_json::EncodeOptions json_options;
+    encode_json::StreamEncoder *json_encoder;
     zmq::context_t *context;
     zmq::socket_t *socket;
 };
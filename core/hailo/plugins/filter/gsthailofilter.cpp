@@ -17,6 +17,10 @@ GST_DEBUG_CATEGORY_STATIC(gst_hailofilter_debug_category);
 #define DEFAULT_FUNCTION_NAME "filter"
 #define INIT_FUNC_NAME "init"
 #define FREE_FUNC_NAME "free_resources"
+#define BATCH_FUNC_SUFFIX "_batch"
+#define DEFAULT_BATCH_SIZE (1)
+#define DEFAULT_BATCH_TIMEOUT (10)
+#define DEFAULT_NUM_WORKERS (1)
 
 static void gst_hailofilter_set_property(GObject *object,
                                          guint property_id, const GValue *value, GParamSpec *pspec);
@@ -29,6 +33,12 @@ static gboolean gst_hailofilter_start(GstBaseTransform *trans);
 static gboolean gst_hailofilter_stop(GstBaseTransform *trans);
 static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
                                                   GstBuffer *buffer);
+static gboolean gst_hailofilter_sink_event(GstBaseTransform *trans, GstEvent *event);
+static GstFlowReturn gst_hailofilter_submit_input_buffer(GstBaseTransform *trans,
+                                                         gboolean is_discont, GstBuffer *input);
+static GstFlowReturn gst_hailofilter_generate_output(GstBaseTransform *trans,
+                                                     GstBuffer **outbuf);
+static void start_batch_mode(GstHailofilter *hailofilter);
 
 enum
 {
@@ -38,6 +48,10 @@ enum
     PROP_USE_GST_BUFFER,
     PROP_CONFIG_FILE_PATH,
     PROP_REMOVE_TENSORS,
+    PROP_CONFIG_RELOAD_INTERVAL,
+    PROP_BATCH_SIZE,
+    PROP_BATCH_TIMEOUT,
+    PROP_NUM_WORKERS,
 };
 
 G_DEFINE_TYPE_WITH_CODE(GstHailofilter, gst_hailofilter, GST_TYPE_BASE_TRANSFORM,
@@ -82,12 +96,35 @@ gst_hailofilter_class_init(GstHailofilterClass *klass)
     g_object_class_install_property(gobject_class, PROP_REMOVE_TENSORS,
                                     g_param_spec_boolean("remove-tensors", "remove-tensors", "whether hailofilter should delete tensors at the end", true,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_CONFIG_RELOAD_INTERVAL,
+                                    g_param_spec_uint("config-reload-interval", "config-reload-interval",
+                                                      "Interval in milliseconds to check the json config file for changes, and switch to the new config between frames. 0 never reloads.",
+                                                      0, G_MAXUINT, 0,
+                                                      (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_BATCH_SIZE,
+                                    g_param_spec_uint("batch-size", "batch-size",
+                                                      "Number of buffers to postprocess together on the worker threads, using the <function-name>_batch entry point of the so if it has one. 1 postprocesses every buffer on the streaming thread.",
+                                                      1, 256, DEFAULT_BATCH_SIZE,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_BATCH_TIMEOUT,
+                                    g_param_spec_uint("batch-timeout", "batch-timeout",
+                                                      "Longest time in milliseconds a buffer waits for its batch to fill.",
+                                                      0, G_MAXUINT, DEFAULT_BATCH_TIMEOUT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_NUM_WORKERS,
+                                    g_param_spec_uint("num-workers", "num-workers",
+                                                      "Number of threads postprocessing batches, buffers keep their order. Above 1 the postprocess has to be thread safe.",
+                                                      1, 64, DEFAULT_NUM_WORKERS,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 
     gobject_class->dispose = gst_hailofilter_dispose;
     gobject_class->finalize = gst_hailofilter_finalize;
     base_transform_class->start = GST_DEBUG_FUNCPTR(gst_hailofilter_start);
     base_transform_class->stop = GST_DEBUG_FUNCPTR(gst_hailofilter_stop);
     base_transform_class->transform_ip = GST_DEBUG_FUNCPTR(gst_hailofilter_transform_ip);
+    base_transform_class->sink_event = GST_DEBUG_FUNCPTR(gst_hailofilter_sink_event);
+    base_transform_class->submit_input_buffer = GST_DEBUG_FUNCPTR(gst_hailofilter_submit_input_buffer);
+    base_transform_class->generate_output = GST_DEBUG_FUNCPTR(gst_hailofilter_generate_output);
 }
 
 static void
@@ -96,6 +133,16 @@ gst_hailofilter_init(GstHailofilter *hailofilter)
     hailofilter->use_config = true;
     hailofilter->remove_tensors = true;
     hailofilter->params = nullptr;
+    hailofilter->params_handle = nullptr;
+    hailofilter->config_reload_interval = 0;
+    hailofilter->last_config_check = 0;
+    hailofilter->handler_batch = nullptr;
+    hailofilter->batch_size = DEFAULT_BATCH_SIZE;
+    hailofilter->batch_timeout = DEFAULT_BATCH_TIMEOUT;
+    hailofilter->num_workers = DEFAULT_NUM_WORKERS;
+    hailofilter->batcher = nullptr;
+    hailofilter->batch_last_flow = GST_FLOW_OK;
+    hailofilter->batch_failed = false;
     hailofilter->config_path = g_strdup("NULL");
 }
 
@@ -123,6 +170,18 @@ void gst_hailofilter_set_property(GObject *object, guint property_id,
     case PROP_REMOVE_TENSORS:
         hailofilter->remove_tensors = g_value_get_boolean(value);
         break;
+    case PROP_CONFIG_RELOAD_INTERVAL:
+        hailofilter->config_reload_interval = g_value_get_uint(value);
+        break;
+    case PROP_BATCH_SIZE:
+        hailofilter->batch_size = g_value_get_uint(value);
+        break;
+    case PROP_BATCH_TIMEOUT:
+        hailofilter->batch_timeout = g_value_get_uint(value);
+        break;
+    case PROP_NUM_WORKERS:
+        hailofilter->num_workers = g_value_get_uint(value);
+        break;
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -154,6 +213,18 @@ void gst_hailofilter_get_property(GObject *object, guint property_id,
     case PROP_REMOVE_TENSORS:
         g_value_set_boolean(value, hailofilter->remove_tensors);
         break;
+    case PROP_CONFIG_RELOAD_INTERVAL:
+        g_value_set_uint(value, hailofilter->config_reload_interval);
+        break;
+    case PROP_BATCH_SIZE:
+        g_value_set_uint(value, hailofilter->batch_size);
+        break;
+    case PROP_BATCH_TIMEOUT:
+        g_value_set_uint(value, hailofilter->batch_timeout);
+        break;
+    case PROP_NUM_WORKERS:
+        g_value_set_uint(value, hailofilter->num_workers);
+        break;
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -163,14 +234,16 @@ void gst_hailofilter_get_property(GObject *object, guint property_id,
 void gst_hailofilter_dispose(GObject *object)
 {
     GstHailofilter *hailofilter = GST_HAILO_FILTER(object);
-    if (hailofilter->params != nullptr)
-    {
-        auto delete_func = (void (*)(void *))dlsym(hailofilter->loaded_lib, FREE_FUNC_NAME);
-        delete_func(hailofilter->params);
-    }
+    delete hailofilter->batcher;
+    hailofilter->batcher = nullptr;
+    // The params may be shared with other filters, the last one to release them frees them (before its dlclose)
+    delete hailofilter->params_handle;
+    hailofilter->params_handle = nullptr;
+    hailofilter->params = nullptr;
     if (hailofilter->loaded_lib != nullptr)
     {
         dlclose(hailofilter->loaded_lib);
+        hailofilter->loaded_lib = nullptr;
     }
 
     if (hailofilter->lib_path != nullptr)
@@ -250,7 +323,13 @@ static gboolean gst_hailofilter_start(GstBaseTransform *trans)
     }
     else // found init function
     {
-        hailofilter->params = init_func(hailofilter->config_path, hailofilter->function_name);
+        // Filters of the same library, function and config content share their params
+        auto free_func = (void (*)(void *))dlsym(hailofilter->loaded_lib, FREE_FUNC_NAME);
+        delete hailofilter->params_handle;
+        hailofilter->params_handle = new PostprocessParamsHandle(hailofilter->lib_path, hailofilter->function_name, hailofilter->config_path,
+                                                                 init_func, free_func);
+        hailofilter->params = hailofilter->params_handle->get();
+        hailofilter->last_config_check = g_get_monotonic_time();
         if (hailofilter->use_gst_buffer)
         {
             /*
@@ -274,6 +353,10 @@ static gboolean gst_hailofilter_start(GstBaseTransform *trans)
         std::cerr << "Cannot load symbol: " << dlsym_error << std::endl;
         dlclose(hailofilter->loaded_lib);
     }
+    else if (hailofilter->batch_size > 1)
+    {
+        start_batch_mode(hailofilter);
+    }
 
     GST_DEBUG_OBJECT(hailofilter, "start");
 
@@ -285,6 +368,10 @@ gst_hailofilter_stop(GstBaseTransform *trans)
 {
     GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
 
+    // Buffers still in the batcher are dropped, the pads are already flushing
+    delete hailofilter->batcher;
+    hailofilter->batcher = nullptr;
+
     GST_DEBUG_OBJECT(hailofilter, "stop");
 
     return TRUE;
@@ -346,22 +433,62 @@ gboolean remove_tensors(GstBuffer *buffer, HailoROIPtr roi)
     return true;
 }
 
-static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
-                                                  GstBuffer *buffer)
+/**
+ * @brief Switch to the params of the new config if the config file changed.
+ *        Runs between frames, so every frame is processed with a single config.
+ *
+ * @param hailofilter The filter to check.
+ */
+static void check_config_reload(GstHailofilter *hailofilter)
 {
-    GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
+    gint64 now = g_get_monotonic_time();
+    if (now - hailofilter->last_config_check < (gint64)hailofilter->config_reload_interval * G_TIME_SPAN_MILLISECOND)
+        return;
+    hailofilter->last_config_check = now;
+    try
+    {
+        if (hailofilter->params_handle->reload_if_changed())
+        {
+            hailofilter->params = hailofilter->params_handle->get();
+            GST_INFO_OBJECT(hailofilter, "Reloaded config %s", hailofilter->config_path);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        GST_WARNING_OBJECT(hailofilter, "Failed to reload config %s, keeping the previous one: %s", hailofilter->config_path, e.what());
+    }
+}
 
+/**
+ * @brief Get the main ROI of the buffer, with the tensors of the buffer and its stream id.
+ */
+static HailoROIPtr prepare_roi(GstHailofilter *hailofilter, GstBuffer *buffer)
+{
     HailoROIPtr hailo_roi = get_hailo_main_roi(buffer, true);
     get_tensors_from_meta(buffer, hailo_roi);
-    GstPad *srcpad = trans->srcpad;
 
     if (hailo_roi->get_stream_id().length() == 0)
     {
-        gchar *id = gst_pad_get_stream_id(srcpad);
+        gchar *id = gst_pad_get_stream_id(GST_BASE_TRANSFORM_SRC_PAD(hailofilter));
         std::string stream_id = std::string(reinterpret_cast<char *>(id));
         g_free(id);
         hailo_roi->set_stream_id(stream_id);
     }
+    return hailo_roi;
+}
+
+static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
+                                                  GstBuffer *buffer)
+{
+    GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
+
+    if (hailofilter->params_handle != nullptr && hailofilter->config_reload_interval > 0)
+    {
+        check_config_reload(hailofilter);
+    }
+
+    HailoROIPtr hailo_roi = prepare_roi(hailofilter, buffer);
+    GstPad *srcpad = trans->srcpad;
 
     // Call all functions.
     if (hailofilter->use_gst_buffer)
@@ -409,3 +536,151 @@ static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
     GST_DEBUG_OBJECT(hailofilter, "transform_ip");
     return GST_FLOW_OK;
 }
+
+/**
+ * @brief Postprocess the rois of a batch, on a worker thread of the batcher.
+ *        Uses the batch entry point of the so if it has one, and the per buffer one otherwise.
+ *        A postprocess that throws posts an element error, and the next buffer returns GST_FLOW_ERROR upstream.
+ */
+static void process_batch(GstHailofilter *hailofilter, std::vector<HailoROIPtr> &rois, void *params)
+{
+    try
+    {
+        if (hailofilter->handler_batch != nullptr)
+        {
+            hailofilter->handler_batch(rois, params);
+        }
+        else if (hailofilter->use_config)
+        {
+            for (HailoROIPtr &roi : rois)
+                hailofilter->handler(roi, params);
+        }
+        else
+        {
+            for (HailoROIPtr &roi : rois)
+                hailofilter->handler_no_config(roi);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        GST_ERROR_OBJECT(hailofilter, "Postprocess of a batch of %zu buffers failed: %s", rois.size(), e.what());
+        GST_ELEMENT_ERROR(hailofilter, STREAM, FAILED, ("Postprocess %s failed", hailofilter->function_name), ("%s", e.what()));
+        hailofilter->batch_failed = true;
+    }
+    catch (...)
+    {
+        GST_ERROR_OBJECT(hailofilter, "Postprocess of a batch of %zu buffers failed with an unknown exception", rois.size());
+        GST_ELEMENT_ERROR(hailofilter, STREAM, FAILED, ("Postprocess %s failed", hailofilter->function_name), ("unknown exception"));
+        hailofilter->batch_failed = true;
+    }
+}
+
+/**
+ * @brief Push a postprocessed buffer, on the output thread of the batcher.
+ *        The flow return is reported to upstream on the next buffer.
+ */
+static void push_batched_buffer(GstHailofilter *hailofilter, GstBuffer *buffer, HailoROIPtr roi)
+{
+    if (hailofilter->remove_tensors)
+    {
+        remove_tensors(buffer, roi);
+    }
+    hailofilter->batch_last_flow = gst_pad_push(GST_BASE_TRANSFORM_SRC_PAD(hailofilter), buffer);
+}
+
+static void start_batch_mode(GstHailofilter *hailofilter)
+{
+    if (hailofilter->use_gst_buffer)
+    {
+        GST_WARNING_OBJECT(hailofilter, "batch-size is not supported with use-gst-buffer, postprocessing every buffer on the streaming thread");
+        return;
+    }
+
+    // The batch entry point is optional, so a missing symbol is not an error
+    std::string batch_function_name = std::string(hailofilter->function_name) + BATCH_FUNC_SUFFIX;
+    hailofilter->handler_batch = (void (*)(std::vector<HailoROIPtr> &, void *))dlsym(hailofilter->loaded_lib, batch_function_name.c_str());
+    dlerror();
+    GST_INFO_OBJECT(hailofilter, "Batches of up to %u buffers on %u workers, %s", hailofilter->batch_size, hailofilter->num_workers,
+                    hailofilter->handler_batch != nullptr ? batch_function_name.c_str() : hailofilter->function_name);
+
+    hailofilter->batch_last_flow = GST_FLOW_OK;
+    hailofilter->batch_failed = false;
+    delete hailofilter->batcher;
+    hailofilter->batcher = new PostprocessBatcher<GstBuffer *>(
+        hailofilter->batch_size, hailofilter->batch_timeout, hailofilter->num_workers,
+        [hailofilter](std::vector<HailoROIPtr> &rois, void *params)
+        { process_batch(hailofilter, rois, params); },
+        [hailofilter](GstBuffer *buffer, HailoROIPtr roi)
+        { push_batched_buffer(hailofilter, buffer, roi); },
+        [](GstBuffer *buffer)
+        { gst_buffer_unref(buffer); });
+}
+
+static GstFlowReturn gst_hailofilter_submit_input_buffer(GstBaseTransform *trans,
+                                                         gboolean is_discont, GstBuffer *input)
+{
+    GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
+    if (hailofilter->batcher == nullptr)
+    {
+        return GST_BASE_TRANSFORM_CLASS(gst_hailofilter_parent_class)->submit_input_buffer(trans, is_discont, input);
+    }
+
+    GstFlowReturn ret = hailofilter->batch_failed ? GST_FLOW_ERROR : hailofilter->batch_last_flow.load();
+    if (ret != GST_FLOW_OK)
+    {
+        gst_buffer_unref(input);
+        return ret;
+    }
+
+    if (hailofilter->params_handle != nullptr && hailofilter->config_reload_interval > 0)
+    {
+        check_config_reload(hailofilter);
+    }
+
+    // Same as the in place transform, the meta of the buffer is changed
+    input = gst_buffer_make_writable(input);
+    HailoROIPtr hailo_roi = prepare_roi(hailofilter, input);
+    PostprocessParamsPtr params = hailofilter->params_handle != nullptr ? hailofilter->params_handle->shared() : nullptr;
+    hailofilter->batcher->submit(input, hailo_roi, params);
+
+    GST_DEBUG_OBJECT(hailofilter, "submit_input_buffer");
+    return hailofilter->batch_failed ? GST_FLOW_ERROR : hailofilter->batch_last_flow.load();
+}
+
+static GstFlowReturn gst_hailofilter_generate_output(GstBaseTransform *trans,
+                                                     GstBuffer **outbuf)
+{
+    GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
+    if (hailofilter->batcher == nullptr)
+    {
+        return GST_BASE_TRANSFORM_CLASS(gst_hailofilter_parent_class)->generate_output(trans, outbuf);
+    }
+
+    // Batched buffers are pushed by the output thread of the batcher
+    *outbuf = NULL;
+    return GST_FLOW_OK;
+}
+
+static gboolean gst_hailofilter_sink_event(GstBaseTransform *trans, GstEvent *event)
+{
+    GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
+    if (hailofilter->batcher != nullptr)
+    {
+        switch (GST_EVENT_TYPE(event))
+        {
+        case GST_EVENT_FLUSH_START:
+            hailofilter->batcher->set_flushing(true);
+            break;
+        case GST_EVENT_FLUSH_STOP:
+            hailofilter->batcher->set_flushing(false);
+            hailofilter->batch_last_flow = GST_FLOW_OK;
+            break;
+        default:
+            // Serialized events (caps, segment, EOS...) have to follow the buffers that came before them
+            if (GST_EVENT_IS_SERIALIZED(event))
+                hailofilter->batcher->drain();
+            break;
+        }
+    }
+    return GST_BASE_TRANSFORM_CLASS(gst_hailofilter_parent_class)->sink_event(trans, event);
+}
@@ -6,9 +6,12 @@
 
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
+#include <atomic>
 #include <map>
 #include <vector>
 #include "hailo_objects.hpp"
+#include "postprocess_batcher.hpp"
+#include "postprocess_params_cache.hpp"
 
 G_BEGIN_DECLS
 
@@ -30,6 +33,9 @@ struct _GstHailofilter
     gchar *function_name;
     void *loaded_lib;
     void * params;
+    PostprocessParamsHandle *params_handle;
+    guint config_reload_interval;
+    gint64 last_config_check;
     gboolean use_config;
     gboolean remove_tensors;
 
@@ -37,7 +43,16 @@ struct _GstHailofilter
     void (*handler_no_config)(HailoROIPtr);
     void (*handler_gst)(HailoROIPtr, GstVideoFrame *, void *);
     void (*handler_gst_no_config)(HailoROIPtr, GstVideoFrame *);
+    void (*handler_batch)(std::vector<HailoROIPtr> &, void *);
     gboolean use_gst_buffer;
+
+    // Batch mode
+    guint batch_size;
+    guint batch_timeout;
+    guint num_workers;
+    PostprocessBatcher<GstBuffer *> *batcher;
+    std::atomic<GstFlowReturn> batch_last_flow;
+    std::atomic<bool> batch_failed; // A postprocess threw, upstream gets GST_FLOW_ERROR
 };
 
 struct _GstHailofilterClass
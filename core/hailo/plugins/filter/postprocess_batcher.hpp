@@ -0,0 +1,237 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file filter/postprocess_batcher.hpp
+ * @brief Gathers frames into batches, postprocesses the batches on a pool of worker threads,
+ *        and hands the frames on in the order they were submitted.
+ *
+ * A batch is dispatched once it holds batch_size frames, once its first frame waited batch_timeout,
+ * or when the params change (a batch is always processed with a single params object).
+ * submit() blocks while 2 * num_workers batches are in flight, so a slow postprocess backpressures upstream.
+ * Frames are handed on by an output thread, output() is never called concurrently.
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "hailo_objects.hpp"
+
+template <typename Frame>
+class PostprocessBatcher
+{
+public:
+    using ProcessFunc = std::function<void(std::vector<HailoROIPtr> &rois, void *params)>;
+    using OutputFunc = std::function<void(Frame frame, HailoROIPtr roi)>;
+    using DiscardFunc = std::function<void(Frame frame)>;
+
+private:
+    struct Batch
+    {
+        std::vector<Frame> frames;
+        std::vector<HailoROIPtr> rois;
+        std::shared_ptr<void> params; // Keeps the params alive if the config is reloaded meanwhile
+        std::chrono::steady_clock::time_point deadline;
+        bool done = false;
+    };
+    using BatchPtr = std::shared_ptr<Batch>;
+
+    uint m_batch_size;
+    std::chrono::milliseconds m_batch_timeout;
+    uint m_max_in_flight;
+    ProcessFunc m_process;
+    OutputFunc m_output;
+    DiscardFunc m_discard;
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;   // Workers wait for dispatched batches
+    std::condition_variable m_output_cv; // The output thread waits for done batches (or a deadline)
+    std::condition_variable m_idle_cv;   // submit() and drain() wait for batches to leave
+    BatchPtr m_pending;                  // The batch being gathered
+    std::deque<BatchPtr> m_dispatched;   // Not picked up by a worker yet
+    std::deque<BatchPtr> m_in_flight;    // Dispatched and not handed on yet, in submit order
+    bool m_outputting = false;
+    bool m_flushing = false;
+    bool m_stop = false;
+    std::vector<std::thread> m_workers;
+    std::thread m_output_thread;
+
+    // Called with the lock held
+    void dispatch_pending()
+    {
+        if (!m_pending)
+            return;
+        m_dispatched.push_back(m_pending);
+        m_in_flight.push_back(m_pending);
+        m_pending.reset();
+        m_work_cv.notify_one();
+    }
+
+    void worker_loop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_work_cv.wait(lock, [this]
+                           { return m_stop || !m_dispatched.empty(); });
+            if (m_dispatched.empty())
+                return;
+            BatchPtr batch = m_dispatched.front();
+            m_dispatched.pop_front();
+            bool skip = m_flushing || m_stop;
+            lock.unlock();
+            if (!skip)
+                m_process(batch->rois, batch->params.get());
+            lock.lock();
+            batch->done = true;
+            m_output_cv.notify_one();
+        }
+    }
+
+    void output_loop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            if (m_stop && m_in_flight.empty())
+                return;
+            if (!m_in_flight.empty() && m_in_flight.front()->done)
+            {
+                BatchPtr batch = m_in_flight.front();
+                m_in_flight.pop_front();
+                bool discard = m_flushing || m_stop;
+                m_outputting = true;
+                lock.unlock();
+                for (size_t i = 0; i < batch->frames.size(); i++)
+                {
+                    if (discard)
+                        m_discard(batch->frames[i]);
+                    else
+                        m_output(batch->frames[i], batch->rois[i]);
+                }
+                lock.lock();
+                m_outputting = false;
+                m_idle_cv.notify_all();
+                continue;
+            }
+            if (m_pending)
+            {
+                // Nothing to hand on yet, dispatch the gathered frames once the first of them waited long enough
+                if (std::chrono::steady_clock::now() >= m_pending->deadline)
+                    dispatch_pending();
+                else
+                    m_output_cv.wait_until(lock, m_pending->deadline);
+                continue;
+            }
+            m_output_cv.wait(lock);
+        }
+    }
+
+public:
+    /**
+     * @param batch_size Most frames in a batch.
+     * @param batch_timeout_ms Longest time a frame waits for its batch to fill.
+     * @param num_workers Number of worker threads, the postprocess has to be thread safe if above 1.
+     * @param process Postprocesses the rois of a batch, on a worker thread.
+     * @param output Hands a frame on, on the output thread.
+     * @param discard Drops a frame that won't be handed on (flushing or stopping).
+     */
+    PostprocessBatcher(uint batch_size, uint batch_timeout_ms, uint num_workers,
+                       ProcessFunc process, OutputFunc output, DiscardFunc discard)
+        : m_batch_size(batch_size ? batch_size : 1), m_batch_timeout(batch_timeout_ms),
+          m_max_in_flight(2 * (num_workers ? num_workers : 1)),
+          m_process(process), m_output(output), m_discard(discard)
+    {
+        for (uint i = 0; i < (num_workers ? num_workers : 1); i++)
+            m_workers.emplace_back(&PostprocessBatcher::worker_loop, this);
+        m_output_thread = std::thread(&PostprocessBatcher::output_loop, this);
+    }
+
+    // Frames that were not handed on yet are discarded
+    ~PostprocessBatcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            dispatch_pending();
+            m_work_cv.notify_all();
+            m_output_cv.notify_all();
+        }
+        for (std::thread &worker : m_workers)
+            worker.join();
+        m_output_thread.join();
+    }
+
+    PostprocessBatcher(const PostprocessBatcher &) = delete;
+    PostprocessBatcher &operator=(const PostprocessBatcher &) = delete;
+
+    /**
+     * @brief Add a frame to the batch being gathered.
+     *        Blocks while too many batches are in flight.
+     */
+    void submit(Frame frame, HailoROIPtr roi, std::shared_ptr<void> params)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle_cv.wait(lock, [this]
+                       { return m_flushing || m_in_flight.size() < m_max_in_flight; });
+        if (m_flushing)
+        {
+            lock.unlock();
+            m_discard(frame);
+            return;
+        }
+        if (m_pending && m_pending->params != params)
+            dispatch_pending();
+        if (!m_pending)
+        {
+            m_pending = std::make_shared<Batch>();
+            m_pending->frames.reserve(m_batch_size);
+            m_pending->rois.reserve(m_batch_size);
+            m_pending->params = params;
+            m_pending->deadline = std::chrono::steady_clock::now() + m_batch_timeout;
+            m_output_cv.notify_one();
+        }
+        m_pending->frames.push_back(frame);
+        m_pending->rois.push_back(roi);
+        if (m_pending->frames.size() >= m_batch_size)
+            dispatch_pending();
+    }
+
+    /**
+     * @brief Dispatch the batch being gathered and wait until all frames were handed on.
+     *        Used before serialized events, so they stay in order with the frames.
+     */
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        dispatch_pending();
+        m_idle_cv.wait(lock, [this]
+                       { return m_in_flight.empty() && !m_outputting; });
+    }
+
+    /**
+     * @brief While flushing, submitted and in flight frames are discarded instead of handed on.
+     *        Leaving the flushing state waits until all of them were discarded.
+     */
+    void set_flushing(bool flushing)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (flushing)
+        {
+            m_flushing = true;
+            dispatch_pending();
+            m_idle_cv.notify_all();
+            return;
+        }
+        m_idle_cv.wait(lock, [this]
+                       { return m_in_flight.empty() && !m_outputting; });
+        m_flushing = false;
+    }
+};
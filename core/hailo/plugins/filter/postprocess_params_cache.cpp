@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include "postprocess_params_cache.hpp"
+#include <fstream>
+#include <sstream>
+
+static bool read_config(const std::string &config_path, std::string &content)
+{
+    std::ifstream file(config_path, std::ios::in | std::ios::binary);
+    if (!file)
+        return false;
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    content = stream.str();
+    return true;
+}
+
+PostprocessParamsCache &PostprocessParamsCache::GetInstance()
+{
+    static PostprocessParamsCache instance;
+    return instance;
+}
+
+uint64_t PostprocessParamsCache::content_hash(const std::string &content)
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : content)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+PostprocessParamsPtr PostprocessParamsCache::acquire(const std::string &lib_path, const std::string &function_name,
+                                                     const std::string &config_path, const std::string &config_content,
+                                                     PostprocessInitFunc init_func, PostprocessFreeFunc free_func)
+{
+    std::string key = lib_path + '\n' + function_name + '\n' + std::to_string(content_hash(config_content));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto range = m_entries.equal_range(key);
+    for (auto entry = range.first; entry != range.second;)
+    {
+        if (entry->second.params.expired())
+        {
+            entry = m_entries.erase(entry);
+            continue;
+        }
+        if (entry->second.config_content == config_content)
+        {
+            PostprocessParamsPtr params = entry->second.params.lock();
+            if (params)
+                return params;
+        }
+        entry++;
+    }
+
+    // init runs under the lock, so filters starting together don't all parse the same config
+    void *raw_params = init_func(config_path, function_name);
+    PostprocessParamsPtr params(raw_params, [free_func](void *params_void_ptr)
+                                {
+                                    if (free_func != nullptr && params_void_ptr != nullptr)
+                                        free_func(params_void_ptr);
+                                });
+    m_entries.emplace(key, Entry{config_content, params});
+    return params;
+}
+
+size_t PostprocessParamsCache::size()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t count = 0;
+    for (auto &entry : m_entries)
+    {
+        if (!entry.second.params.expired())
+            count++;
+    }
+    return count;
+}
+
+PostprocessParamsHandle::PostprocessParamsHandle(const std::string &lib_path, const std::string &function_name, const std::string &config_path,
+                                                 PostprocessInitFunc init_func, PostprocessFreeFunc free_func)
+    : m_lib_path(lib_path), m_function_name(function_name), m_config_path(config_path), m_init_func(init_func), m_free_func(free_func)
+{
+    struct stat info;
+    bool have_info = (stat(m_config_path.c_str(), &info) == 0);
+    load(info, have_info);
+}
+
+bool PostprocessParamsHandle::config_changed(struct stat &info) const
+{
+    if (stat(m_config_path.c_str(), &info) != 0)
+        return false; // Removed, or in the middle of being replaced, keep the current params
+    return info.st_mtim.tv_sec != m_mtime.tv_sec || info.st_mtim.tv_nsec != m_mtime.tv_nsec || info.st_size != m_size;
+}
+
+void PostprocessParamsHandle::load(const struct stat &info, bool have_info)
+{
+    // Recorded before reading, so a write that races the read is seen by the next check
+    if (have_info)
+    {
+        m_mtime = info.st_mtim;
+        m_size = info.st_size;
+    }
+
+    std::string content;
+    if (!read_config(m_config_path, content))
+        content = "path:" + m_config_path; // No file (e.g. the "NULL" default), init picks its defaults by path
+    uint64_t hash = PostprocessParamsCache::content_hash(content);
+    if (m_params && hash == m_content_hash)
+        return;
+
+    m_params = PostprocessParamsCache::GetInstance().acquire(m_lib_path, m_function_name, m_config_path, content, m_init_func, m_free_func);
+    m_content_hash = hash;
+}
+
+bool PostprocessParamsHandle::reload_if_changed()
+{
+    struct stat info;
+    if (!config_changed(info))
+        return false;
+    void *previous = m_params.get();
+    load(info, true);
+    return m_params.get() != previous;
+}
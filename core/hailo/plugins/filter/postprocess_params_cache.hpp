@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file filter/postprocess_params_cache.hpp
+ * @brief Process-wide cache of the params objects returned by the init function of postprocess libraries.
+ *
+ * Filters that load the same library and function with the same config content share a single params
+ * object, which is freed (with the free_resources of the library) once the last of them releases it.
+ * Params are immutable once created, a changed config file produces a new params object that each filter
+ * swaps in between frames (see PostprocessParamsHandle::reload_if_changed).
+ */
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+
+using PostprocessInitFunc = void *(*)(std::string, std::string);
+using PostprocessFreeFunc = void (*)(void *);
+using PostprocessParamsPtr = std::shared_ptr<void>;
+
+class PostprocessParamsCache
+{
+public:
+    static PostprocessParamsCache &GetInstance();
+
+    PostprocessParamsCache(const PostprocessParamsCache &) = delete;
+    PostprocessParamsCache &operator=(const PostprocessParamsCache &) = delete;
+
+    /**
+     * @brief Get the params of a postprocess function for the given config, calling init only
+     *        if no other filter holds params for the same library, function and config content.
+     *
+     * @param config_content The content of the config file (empty if it could not be read).
+     * @throw Whatever init throws (e.g. a config that doesn't follow the schema), nothing is cached then.
+     */
+    PostprocessParamsPtr acquire(const std::string &lib_path, const std::string &function_name,
+                                 const std::string &config_path, const std::string &config_content,
+                                 PostprocessInitFunc init_func, PostprocessFreeFunc free_func);
+
+    // Number of params objects currently shared
+    size_t size();
+
+    static uint64_t content_hash(const std::string &content);
+
+private:
+    PostprocessParamsCache() = default;
+
+    struct Entry
+    {
+        std::string config_content; // Compared on lookup, so a hash collision never shares params
+        std::weak_ptr<void> params;
+    };
+
+    std::mutex m_mutex;
+    std::multimap<std::string, Entry> m_entries;
+};
+
+/**
+ * @brief The params of one filter, and the state needed to follow changes of its config file.
+ */
+class PostprocessParamsHandle
+{
+public:
+    /**
+     * @throw Whatever init throws.
+     */
+    PostprocessParamsHandle(const std::string &lib_path, const std::string &function_name, const std::string &config_path,
+                            PostprocessInitFunc init_func, PostprocessFreeFunc free_func);
+
+    void *get() const { return m_params.get(); }
+    PostprocessParamsPtr shared() const { return m_params; }
+
+    /**
+     * @brief Re-read the config file if it was modified since the params were created,
+     *        and swap to the params of the new content.
+     *
+     * @return true if the params were swapped.
+     * @throw Whatever init throws, the current params are kept then (and the same content isn't retried).
+     */
+    bool reload_if_changed();
+
+private:
+    bool config_changed(struct stat &info) const;
+    void load(const struct stat &info, bool have_info);
+
+    std::string m_lib_path;
+    std::string m_function_name;
+    std::string m_config_path;
+    PostprocessInitFunc m_init_func;
+    PostprocessFreeFunc m_free_func;
+    PostprocessParamsPtr m_params;
+    uint64_t m_content_hash = 0;
+    struct timespec m_mtime = {0, 0};
+    off_t m_size = -1;
+};
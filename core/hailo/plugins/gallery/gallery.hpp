@@ -4,6 +4,7 @@
  **/
 #pragma once
 #include <vector>
+#include <algorithm>
 #include <cstdio>
 #include <string>
 #include <ostream>
@@ -13,6 +14,7 @@
 #include "xtensor/xsort.hpp"
 #include "xtensor/xio.hpp"
 #include "hailo_objects.hpp"
+#include "track_state_store.hpp"
 #include "export/encode_json.hpp"
 #include "import/decode_json.hpp"
 
@@ -53,7 +55,8 @@ private:
     // For the whole gallery there is a vector of global id's (i.e. vector of vectors of HailoMatrixPtr)
     // where the global ID is represented by the outer vector's index.
     std::vector<std::vector<HailoMatrixPtr>> m_embeddings;
-    std::map<int, int> tracking_id_to_global_id;
+    // Shared, so a copied Gallery keeps a single registration with the tracker
+    std::shared_ptr<TrackStateStore<int>> tracking_id_to_global_id;
     std::vector<std::string> m_embedding_names;
     float m_similarity_thr;
     uint m_queue_size;
@@ -65,7 +68,10 @@ private:
 public:
     Gallery(float similarity_thr = 0.15, uint queue_size = 100) : m_similarity_thr(similarity_thr), m_queue_size(queue_size),
                                                                   m_json_file(nullptr), m_save_new_embeddings(false),
-                                                                  m_json_file_path(nullptr), m_load_local_embeddings(false){};
+                                                                  m_json_file_path(nullptr), m_load_local_embeddings(false)
+    {
+        tracking_id_to_global_id = std::make_shared<TrackStateStore<int>>();
+    };
 
     static float get_distance(std::vector<HailoMatrixPtr> embeddings_queue, HailoMatrixPtr matrix)
     {
@@ -192,13 +198,41 @@ public:
         return global_id;
     }
 
-    std::pair<uint, float> get_closest_global_id(HailoMatrixPtr matrix)
+    static std::pair<uint, float> get_closest_global_id(const xt::xarray<float> &distances)
     {
-        auto distances = get_embeddings_distances(matrix);
         auto global_id = xt::argpartition(distances, 1, xt::xnone())[0];
         return std::pair<uint, float>(global_id + 1, distances[global_id]);
     }
 
+    std::pair<uint, float> get_closest_global_id(HailoMatrixPtr matrix)
+    {
+        return get_closest_global_id(get_embeddings_distances(matrix));
+    }
+
+    /**
+     * @brief Report to the tracker how sure the match of a new embedding is, so croppers upstream
+     *        can stop recognizing tracks whose identity is already known.
+     *        The confidence is the similarity to the matched identity, the margin is how much closer
+     *        it is than the next closest identity.
+     */
+    static void report_identity(const xt::xarray<float> &distances, uint global_id, const std::string &stream_id, int track_id)
+    {
+        float distance = distances(global_id - 1);
+        float next_distance = 1.0f;
+        for (size_t i = 0; i < distances.size(); i++)
+        {
+            if (i != global_id - 1)
+                next_distance = std::min(next_distance, distances(i));
+        }
+        HailoTracker::GetInstance().report_track_identity(stream_id, track_id, global_id, 1.0f - distance, next_distance - distance);
+    }
+
+    // A new identity was created from a single embedding, nothing confirms it yet
+    static void report_new_identity(uint global_id, const std::string &stream_id, int track_id)
+    {
+        HailoTracker::GetInstance().report_track_identity(stream_id, track_id, global_id, 0.0f, 0.0f);
+    }
+
     HailoMatrixPtr get_embedding_matrix(HailoDetectionPtr detection)
     {
         auto embeddings = detection->get_objects_typed(HAILO_MATRIX);
@@ -229,10 +263,10 @@ public:
         }
     }
 
-    void update_embeddings_and_add_id_to_object(HailoMatrixPtr new_embedding, HailoDetectionPtr detection, const uint global_id, const int unique_id)
+    void update_embeddings_and_add_id_to_object(HailoMatrixPtr new_embedding, HailoDetectionPtr detection, const uint global_id, const std::string &stream_id, const int unique_id)
     {
         // Attach global id to tracking id
-        tracking_id_to_global_id[unique_id] = global_id;
+        tracking_id_to_global_id->set(stream_id, unique_id, global_id);
 
         // Add new embedding to the queue
         if (!this->m_load_local_embeddings && new_embedding != nullptr)
@@ -244,14 +278,17 @@ public:
             detection->add_object(std::make_shared<HailoUniqueID>(global_id, GLOBAL_ID));
     }
 
-    void new_embedding_to_global_id(HailoMatrixPtr new_embedding, HailoDetectionPtr detection, const int track_id)
+    void new_embedding_to_global_id(HailoMatrixPtr new_embedding, HailoDetectionPtr detection, const std::string &stream_id, const int track_id)
     {
-        if (tracking_id_to_global_id.find(track_id) != tracking_id_to_global_id.end())
+        int track_global_id;
+        if (tracking_id_to_global_id->get(stream_id, track_id, track_global_id))
         {
             // Global id to track already exists, add new embedding to global id
-            update_embeddings_and_add_id_to_object(new_embedding, detection, tracking_id_to_global_id[track_id], track_id);
+            if (new_embedding != nullptr)
+                report_identity(get_embeddings_distances(new_embedding), track_global_id, stream_id, track_id);
+            update_embeddings_and_add_id_to_object(new_embedding, detection, track_global_id, stream_id, track_id);
             if (this->m_load_local_embeddings)
-                handle_local_embedding(detection, tracking_id_to_global_id[track_id]);
+                handle_local_embedding(detection, track_global_id);
             return;
         }
 
@@ -266,14 +303,16 @@ public:
             // Gallery is empty, adding new global id
             uint global_id = create_new_global_id();
             save_embedding_to_json_file(new_embedding, global_id);
-            update_embeddings_and_add_id_to_object(new_embedding, detection, global_id, track_id);
+            update_embeddings_and_add_id_to_object(new_embedding, detection, global_id, stream_id, track_id);
+            report_new_identity(global_id, stream_id, track_id);
             return;
         }
 
         uint closest_global_id;
         float min_distance;
         // Get closest global id by distance between embeddings
-        std::tie(closest_global_id, min_distance) = get_closest_global_id(new_embedding);
+        xt::xarray<float> distances = get_embeddings_distances(new_embedding);
+        std::tie(closest_global_id, min_distance) = get_closest_global_id(distances);
         if (min_distance > this->m_similarity_thr)
         {
             // if smallest distance is bigger than threshold and local gallery is not loaded -> create new global ID
@@ -281,19 +320,21 @@ public:
             {
                 uint global_id = create_new_global_id();
                 save_embedding_to_json_file(new_embedding, global_id);
-                update_embeddings_and_add_id_to_object(new_embedding, detection, global_id, track_id);
+                update_embeddings_and_add_id_to_object(new_embedding, detection, global_id, stream_id, track_id);
+                report_new_identity(global_id, stream_id, track_id);
             }
         }
         else
         {
             // Close embedding found, update global id embeddings
-            update_embeddings_and_add_id_to_object(new_embedding, detection, closest_global_id, track_id);
+            report_identity(distances, closest_global_id, stream_id, track_id);
+            update_embeddings_and_add_id_to_object(new_embedding, detection, closest_global_id, stream_id, track_id);
             if (this->m_load_local_embeddings)
                 handle_local_embedding(detection, closest_global_id);
         }
     }
 
-    void update(std::vector<HailoDetectionPtr> &detections)
+    void update(std::vector<HailoDetectionPtr> &detections, const std::string &stream_id = "")
     {
         for (auto detection : detections)
         {
@@ -301,7 +342,7 @@ public:
             int track_id = std::dynamic_pointer_cast<HailoUniqueID>(track_ids[0])->get_id();
 
             HailoMatrixPtr new_embedding = get_embedding_matrix(detection);
-            new_embedding_to_global_id(new_embedding, detection, track_id);
+            new_embedding_to_global_id(new_embedding, detection, stream_id, track_id);
         }
     };
     void set_similarity_threshold(float thr) { this->m_similarity_thr = thr; };
@@ -255,7 +255,7 @@ gst_hailo_gallery_transform_ip(GstBaseTransform *trans, GstBuffer *buffer)
         if ((hailogallery->class_id == -1) || (detection->get_class_id() == hailogallery->class_id))
             detections.push_back(detection);
     }
-    hailogallery->gallery.update(detections);
+    hailogallery->gallery.update(detections, hailo_roi->get_stream_id());
 
     GST_DEBUG_OBJECT(hailogallery, "transform_ip");
     return GST_FLOW_OK;
@@ -25,6 +25,8 @@
 #include "export/export_file/gsthailoexportfile.hpp"
 #include "export/export_zmq/gsthailoexportzmq.hpp"
 #include "import/import_zmq/gsthailoimportzmq.hpp"
+#include "export/export_shm/gsthailoexportshm.hpp"
+#include "import/import_shm/gsthailoimportshm.hpp"
 #include "gray_scale/gsthailonv12togray.hpp"
 #include "gray_scale/gsthailograytonv12.hpp"
 #include "filter/gsthailonvalve.hpp"
@@ -52,6 +54,8 @@ plugin_init(GstPlugin *plugin)
     gst_element_register(plugin, "hailoexportzmq", GST_RANK_PRIMARY, GST_TYPE_HAILO_EXPORT_ZMQ);
     gst_element_register(plugin, "hailonvalve", GST_RANK_PRIMARY, GST_TYPE_HAILO_NVALVE);
     gst_element_register(plugin, "hailoimportzmq", GST_RANK_PRIMARY, GST_TYPE_HAILO_IMPORT_ZMQ);
+    gst_element_register(plugin, "hailoexportshm", GST_RANK_PRIMARY, GST_TYPE_HAILO_EXPORT_SHM);
+    gst_element_register(plugin, "hailoimportshm", GST_RANK_PRIMARY, GST_TYPE_HAILO_IMPORT_SHM);
     gst_element_register(plugin, "hailonv12togray", GST_RANK_PRIMARY, GST_TYPE_HAILO_NV12_TO_GRAY);
     gst_element_register(plugin, "hailograytonv12", GST_RANK_PRIMARY, GST_TYPE_HAILO_GRAY_TO_NV12);
 #ifdef HAILO15_TARGET
@@ -0,0 +1,248 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+// General cpp includes
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "common/binary_meta.hpp"
+
+// Objects nest detections and tiles, deeper messages are refused instead of recursing without a bound
+#define DECODE_BINARY_MAX_DEPTH 32
+
+namespace decode_binary
+{
+    HailoBBox decode_bbox(binary_meta::Reader &reader);
+    void check_dimensions(int64_t width, int64_t height, int64_t features, size_t count, const std::string &what);
+    void decode_detection(binary_meta::Reader &reader, HailoROIPtr roi, uint depth);
+    void decode_classification(binary_meta::Reader &reader, HailoROIPtr roi);
+    void decode_landmarks(binary_meta::Reader &reader, HailoROIPtr roi);
+    void decode_tile(binary_meta::Reader &reader, HailoROIPtr roi, uint depth);
+    void decode_unique_id(binary_meta::Reader &reader, HailoROIPtr roi);
+    void decode_depth_mask(binary_meta::Reader &reader, HailoROIPtr roi);
+    void decode_class_mask(binary_meta::Reader &reader, HailoROIPtr roi);
+    void decode_conf_class_mask(binary_meta::Reader &reader, HailoROIPtr roi);
+    void decode_matrix(binary_meta::Reader &reader, HailoROIPtr roi);
+    void decode_hailo_objects(binary_meta::Reader &reader, HailoROIPtr roi, uint depth);
+}
+
+namespace decode_binary
+{
+    inline HailoBBox decode_bbox(binary_meta::Reader &reader)
+    {
+        float xmin = reader.f32();
+        float ymin = reader.f32();
+        float width = reader.f32();
+        float height = reader.f32();
+        return HailoBBox(xmin, ymin, width, height);
+    }
+
+    /**
+     * @brief Throws binary_meta::FormatError unless width x height x features is the element count of the data,
+     *        so a mask or matrix can't index past its data.
+     */
+    inline void check_dimensions(int64_t width, int64_t height, int64_t features, size_t count, const std::string &what)
+    {
+        if (width < 0 || height < 0 || features < 0)
+            throw binary_meta::FormatError(what + " has a negative dimension");
+        // Every dimension fits 32 bits, so width * height can't overflow, and the features are divided out
+        uint64_t plane = uint64_t(width) * uint64_t(height);
+        bool match = features == 0 ? count == 0 : plane <= count / uint64_t(features) && plane * uint64_t(features) == count;
+        if (!match)
+            throw binary_meta::FormatError(what + " dimensions don't match its data");
+    }
+
+    inline void decode_detection(binary_meta::Reader &reader, HailoROIPtr roi, uint depth)
+    {
+        HailoBBox bbox = decode_bbox(reader);
+        int class_id = reader.i32();
+        float confidence = reader.f32();
+        std::string label = reader.string();
+        HailoDetectionPtr detection = std::make_shared<HailoDetection>(bbox, class_id, label, confidence);
+
+        // Add this detection object to the parent
+        roi->add_object(detection);
+
+        // Recurse this object
+        decode_hailo_objects(reader, detection, depth + 1);
+    }
+
+    inline void decode_classification(binary_meta::Reader &reader, HailoROIPtr roi)
+    {
+        std::string classification_type = reader.string();
+        int class_id = reader.i32();
+        float confidence = reader.f32();
+        std::string label = reader.string();
+        roi->add_object(std::make_shared<HailoClassification>(classification_type, class_id, label, confidence));
+    }
+
+    inline void decode_landmarks(binary_meta::Reader &reader, HailoROIPtr roi)
+    {
+        std::string landmarks_type = reader.string();
+        float threshold = reader.f32();
+
+        // Decode points, every point takes 3 floats
+        uint32_t num_points = reader.u32();
+        if (num_points > reader.remaining() / (3 * sizeof(float)))
+            throw binary_meta::FormatError("landmarks overrun the message");
+        std::vector<HailoPoint> points;
+        points.reserve(num_points);
+        for (uint32_t i = 0; i < num_points; i++)
+        {
+            float x = reader.f32();
+            float y = reader.f32();
+            float confidence = reader.f32();
+            points.emplace_back(x, y, confidence);
+        }
+
+        // Decode point pairs
+        uint32_t num_pairs = reader.u32();
+        if (num_pairs > reader.remaining() / (2 * sizeof(int32_t)))
+            throw binary_meta::FormatError("landmark pairs overrun the message");
+        std::vector<std::pair<int, int>> pairs;
+        pairs.reserve(num_pairs);
+        for (uint32_t i = 0; i < num_pairs; i++)
+        {
+            int first = reader.i32();
+            int second = reader.i32();
+            pairs.emplace_back(first, second);
+        }
+
+        roi->add_object(std::make_shared<HailoLandmarks>(landmarks_type, points, threshold, pairs));
+    }
+
+    inline void decode_tile(binary_meta::Reader &reader, HailoROIPtr roi, uint depth)
+    {
+        HailoBBox bbox = decode_bbox(reader);
+        uint index = reader.u32();
+        uint layer = reader.u32();
+        hailo_tiling_mode_t mode = (hailo_tiling_mode_t)reader.u32();
+        float overlap_x_axis = reader.f32();
+        float overlap_y_axis = reader.f32();
+        HailoTileROIPtr tile = std::make_shared<HailoTileROI>(bbox, index, overlap_x_axis, overlap_y_axis, layer, mode);
+
+        // Add this tile object to the parent
+        roi->add_object(tile);
+
+        // Recurse this object
+        decode_hailo_objects(reader, tile, depth + 1);
+    }
+
+    inline void decode_unique_id(binary_meta::Reader &reader, HailoROIPtr roi)
+    {
+        int id = reader.i32();
+        hailo_unique_id_mode_t mode = (hailo_unique_id_mode_t)reader.u32();
+        roi->add_object(std::make_shared<HailoUniqueID>(id, mode));
+    }
+
+    inline void decode_depth_mask(binary_meta::Reader &reader, HailoROIPtr roi)
+    {
+        int width = reader.i32();
+        int height = reader.i32();
+        float transparency = reader.f32();
+        std::vector<float> data = reader.blob<float>();
+        check_dimensions(width, height, 1, data.size(), "depth mask");
+        roi->add_object(std::make_shared<HailoDepthMask>(std::move(data), width, height, transparency));
+    }
+
+    inline void decode_class_mask(binary_meta::Reader &reader, HailoROIPtr roi)
+    {
+        int width = reader.i32();
+        int height = reader.i32();
+        float transparency = reader.f32();
+        std::vector<uint8_t> data = reader.blob<uint8_t>();
+        check_dimensions(width, height, 1, data.size(), "class mask");
+        roi->add_object(std::make_shared<HailoClassMask>(std::move(data), width, height, transparency));
+    }
+
+    inline void decode_conf_class_mask(binary_meta::Reader &reader, HailoROIPtr roi)
+    {
+        int width = reader.i32();
+        int height = reader.i32();
+        float transparency = reader.f32();
+        std::vector<float> data = reader.blob<float>();
+        int class_id = reader.i32();
+        check_dimensions(width, height, 1, data.size(), "confidence class mask");
+        roi->add_object(std::make_shared<HailoConfClassMask>(std::move(data), width, height, transparency, class_id));
+    }
+
+    inline void decode_matrix(binary_meta::Reader &reader, HailoROIPtr roi)
+    {
+        uint32_t width = reader.u32();
+        uint32_t height = reader.u32();
+        uint32_t features = reader.u32();
+        std::vector<float> data = reader.blob<float>();
+        check_dimensions(width, height, features, data.size(), "matrix");
+        roi->add_object(std::make_shared<HailoMatrix>(std::move(data), height, width, features));
+    }
+
+    inline void decode_hailo_objects(binary_meta::Reader &reader, HailoROIPtr roi, uint depth)
+    {
+        if (depth > DECODE_BINARY_MAX_DEPTH)
+            throw binary_meta::FormatError("objects nest deeper than " + std::to_string(DECODE_BINARY_MAX_DEPTH));
+        uint32_t count = reader.u32();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint8_t tag = reader.u8();
+            // Every body is decoded by a reader of its own, which skips unknown tags and trailing fields
+            binary_meta::Reader body = reader.sub_reader(reader.u32());
+            switch (tag)
+            {
+            case binary_meta::TAG_DETECTION:
+                decode_detection(body, roi, depth);
+                break;
+            case binary_meta::TAG_CLASSIFICATION:
+                decode_classification(body, roi);
+                break;
+            case binary_meta::TAG_LANDMARKS:
+                decode_landmarks(body, roi);
+                break;
+            case binary_meta::TAG_TILE:
+                decode_tile(body, roi, depth);
+                break;
+            case binary_meta::TAG_UNIQUE_ID:
+                decode_unique_id(body, roi);
+                break;
+            case binary_meta::TAG_MATRIX:
+                decode_matrix(body, roi);
+                break;
+            case binary_meta::TAG_DEPTH_MASK:
+                decode_depth_mask(body, roi);
+                break;
+            case binary_meta::TAG_CLASS_MASK:
+                decode_class_mask(body, roi);
+                break;
+            case binary_meta::TAG_CONF_CLASS_MASK:
+                decode_conf_class_mask(body, roi);
+                break;
+            default:
+                // continue
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Decodes a binary meta message, adding its objects to roi (the bbox of the main ROI is not applied,
+     *        the same as decode_json::decode_hailo_roi). Throws binary_meta::FormatError on a malformed message,
+     *        in which case roi is left unchanged.
+     *
+     * @return binary_meta::Header
+     *         The header of the message (timestamp, buffer offset).
+     */
+    inline binary_meta::Header decode_hailo_roi(const uint8_t *data, size_t size, HailoROIPtr roi)
+    {
+        binary_meta::Reader reader(data, size);
+        binary_meta::Header header = binary_meta::read_header(reader);
+        HailoROIPtr decoded = std::make_shared<HailoROI>(decode_bbox(reader));
+        decode_hailo_objects(reader, decoded, 0);
+        for (auto obj : decoded->get_objects())
+            roi->add_object(obj);
+        return header;
+    }
+}
@@ -5,7 +5,11 @@
 #pragma once
 
 // General cpp includes
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 // Tappas includes
 #include "hailo_objects.hpp"
@@ -86,17 +90,61 @@ namespace decode_json
                                                                 object_json["confidence"].GetFloat()));
     }
 
+    // Decodes base64 text (as written by encode_json::base64_encode) to bytes
+    inline std::vector<uint8_t> base64_decode(const char *text, size_t size)
+    {
+        static const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::vector<uint8_t> out;
+        out.reserve(size / 4 * 3);
+        uint32_t bits = 0;
+        int bit_count = 0;
+        for (size_t i = 0; i < size && text[i] != '='; i++)
+        {
+            size_t value = alphabet.find(text[i]);
+            if (value == std::string::npos)
+                throw std::invalid_argument("invalid base64 character in matrix data");
+            bits = (bits << 6) | value;
+            bit_count += 6;
+            if (bit_count >= 8)
+            {
+                bit_count -= 8;
+                out.push_back((bits >> bit_count) & 0xff);
+            }
+        }
+        return out;
+    }
+
+    // Decodes a matrix, throws std::invalid_argument if its data doesn't hold height x width x features floats
     inline void decode_matrix(rapidjson::Value& object_json, HailoROIPtr roi)
     {
+        int height = object_json["height"].GetInt();
+        int width = object_json["width"].GetInt();
+        int features = object_json["features"].GetInt();
+        if (height < 0 || width < 0 || features < 0)
+            throw std::invalid_argument("negative matrix dimension");
+        size_t count = size_t(height) * size_t(width) * size_t(features);
+
         std::vector<float> matrix_data;
-        for (rapidjson::Value& entry : object_json["data"].GetArray()) {
-            matrix_data.emplace_back(entry.GetFloat());
+        if (object_json.HasMember("data_base64"))
+        {
+            // Raw float32 values, written with the matrix-base64 option of the encoder
+            rapidjson::Value& encoded = object_json["data_base64"];
+            std::vector<uint8_t> bytes = base64_decode(encoded.GetString(), encoded.GetStringLength());
+            if (bytes.size() != count * sizeof(float))
+                throw std::invalid_argument("matrix data of " + std::to_string(bytes.size()) + " bytes doesn't match its dimensions");
+            matrix_data.resize(count);
+            std::memcpy(matrix_data.data(), bytes.data(), bytes.size());
+        }
+        else
+        {
+            for (rapidjson::Value& entry : object_json["data"].GetArray()) {
+                matrix_data.emplace_back(entry.GetFloat());
+            }
+            if (matrix_data.size() != count)
+                throw std::invalid_argument("matrix data of " + std::to_string(matrix_data.size()) + " values doesn't match its dimensions");
         }
         // Add this matrix object to the parent
-        roi->add_object(std::make_shared<HailoMatrix>(matrix_data,
-                                                      object_json["height"].GetInt(),
-                                                      object_json["width"].GetInt(),
-                                                      object_json["features"].GetInt()));
+        roi->add_object(std::make_shared<HailoMatrix>(matrix_data, height, width, features));
     }
 
     inline void decode_landmarks(rapidjson::Value& object_json, HailoROIPtr roi)
@@ -0,0 +1,297 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include "gsthailoimportshm.hpp"
+#include "gst_hailo_meta.hpp"
+#include <chrono>
+#include <stdexcept>
+#include <gst/gst.h>
+
+GST_DEBUG_CATEGORY_STATIC(gst_hailoimportshm_debug_category);
+#define GST_CAT_DEFAULT gst_hailoimportshm_debug_category
+
+#define DEFAULT_SHM_NAME "hailo_meta"
+// Wait for a message as long as it takes
+#define DEFAULT_TIMEOUT -1
+// Interval between attempts to open a ring whose exporter isn't up yet
+#define OPEN_RETRY_INTERVAL_US 10000
+
+/* prototypes */
+
+static void gst_hailoimportshm_set_property(GObject *object,
+                                            guint property_id, const GValue *value, GParamSpec *pspec);
+static void gst_hailoimportshm_get_property(GObject *object,
+                                            guint property_id, GValue *value, GParamSpec *pspec);
+static void gst_hailoimportshm_finalize(GObject *object);
+
+static gboolean gst_hailoimportshm_start(GstBaseTransform *trans);
+static gboolean gst_hailoimportshm_stop(GstBaseTransform *trans);
+static GstFlowReturn gst_hailoimportshm_transform_ip(GstBaseTransform *trans,
+                                                     GstBuffer *buffer);
+
+/* class initialization */
+
+G_DEFINE_TYPE_WITH_CODE(GstHailoImportSHM, gst_hailoimportshm, GST_TYPE_BASE_TRANSFORM,
+                        GST_DEBUG_CATEGORY_INIT(gst_hailoimportshm_debug_category, "hailoimportshm", 0,
+                                                "debug category for hailoimportshm element"));
+
+enum
+{
+    PROP_0,
+    PROP_SHM_NAME,
+    PROP_TIMEOUT,
+    PROP_SYNC_PTS,
+};
+
+static void
+gst_hailoimportshm_class_init(GstHailoImportSHMClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GstBaseTransformClass *base_transform_class =
+        GST_BASE_TRANSFORM_CLASS(klass);
+
+    const char *description = "Imports HailoObjects from the shared-memory ring of a hailoexportshm in another process."
+                              "\n\t\t\t   "
+                              "Decodes classes contained by the binary meta format to HailoROI objects.";
+    gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass),
+                                       gst_pad_template_new("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+                                                            gst_caps_new_any()));
+    gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass),
+                                       gst_pad_template_new("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+                                                            gst_caps_new_any()));
+
+    gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass),
+                                          "hailoimportshm - import element",
+                                          "Hailo/Tools",
+                                          description,
+                                          "hailo.ai <contact@hailo.ai>");
+
+    gobject_class->set_property = gst_hailoimportshm_set_property;
+    gobject_class->get_property = gst_hailoimportshm_get_property;
+    g_object_class_install_property(gobject_class, PROP_SHM_NAME,
+                                    g_param_spec_string("shm-name", "Shared memory name",
+                                                        "Name of the shared-memory segment of the exporter.", DEFAULT_SHM_NAME,
+                                                        (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_TIMEOUT,
+                                    g_param_spec_int("timeout", "Receive timeout",
+                                                     "Time in ms to wait for a message, a buffer that times out passes without meta. -1 waits forever.",
+                                                     -1, G_MAXINT, DEFAULT_TIMEOUT,
+                                                     (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_SYNC_PTS,
+                                    g_param_spec_boolean("sync-pts", "Sync by PTS",
+                                                         "Attach only the message exported with the PTS of the buffer. Older messages are skipped, "
+                                                         "a newer one is kept for its own buffer. When false, every buffer takes the next message.",
+                                                         FALSE,
+                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+
+    gobject_class->finalize = gst_hailoimportshm_finalize;
+    base_transform_class->start = GST_DEBUG_FUNCPTR(gst_hailoimportshm_start);
+    base_transform_class->stop = GST_DEBUG_FUNCPTR(gst_hailoimportshm_stop);
+    base_transform_class->transform_ip = GST_DEBUG_FUNCPTR(gst_hailoimportshm_transform_ip);
+}
+
+static void
+gst_hailoimportshm_init(GstHailoImportSHM *hailoimportshm)
+{
+    hailoimportshm->shm_name = g_strdup(DEFAULT_SHM_NAME);
+    hailoimportshm->timeout = DEFAULT_TIMEOUT;
+    hailoimportshm->sync_pts = FALSE;
+    hailoimportshm->reader = nullptr;
+    hailoimportshm->message = nullptr;
+    hailoimportshm->message_pending = FALSE;
+    hailoimportshm->reported_dropped = 0;
+}
+
+void gst_hailoimportshm_set_property(GObject *object, guint property_id,
+                                     const GValue *value, GParamSpec *pspec)
+{
+    GstHailoImportSHM *hailoimportshm = GST_HAILO_IMPORT_SHM(object);
+
+    GST_DEBUG_OBJECT(hailoimportshm, "set_property");
+
+    switch (property_id)
+    {
+    case PROP_SHM_NAME:
+        g_free(hailoimportshm->shm_name);
+        hailoimportshm->shm_name = g_value_dup_string(value);
+        break;
+    case PROP_TIMEOUT:
+        hailoimportshm->timeout = g_value_get_int(value);
+        break;
+    case PROP_SYNC_PTS:
+        hailoimportshm->sync_pts = g_value_get_boolean(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+        break;
+    }
+}
+
+void gst_hailoimportshm_get_property(GObject *object, guint property_id,
+                                     GValue *value, GParamSpec *pspec)
+{
+    GstHailoImportSHM *hailoimportshm = GST_HAILO_IMPORT_SHM(object);
+
+    GST_DEBUG_OBJECT(hailoimportshm, "get_property");
+
+    switch (property_id)
+    {
+    case PROP_SHM_NAME:
+        g_value_set_string(value, hailoimportshm->shm_name);
+        break;
+    case PROP_TIMEOUT:
+        g_value_set_int(value, hailoimportshm->timeout);
+        break;
+    case PROP_SYNC_PTS:
+        g_value_set_boolean(value, hailoimportshm->sync_pts);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+        break;
+    }
+}
+
+void gst_hailoimportshm_finalize(GObject *object)
+{
+    GstHailoImportSHM *hailoimportshm = GST_HAILO_IMPORT_SHM(object);
+    GST_DEBUG_OBJECT(hailoimportshm, "finalize");
+
+    g_free(hailoimportshm->shm_name);
+    hailoimportshm->shm_name = NULL;
+
+    G_OBJECT_CLASS(gst_hailoimportshm_parent_class)->finalize(object);
+}
+
+static gboolean
+gst_hailoimportshm_start(GstBaseTransform *trans)
+{
+    GstHailoImportSHM *hailoimportshm = GST_HAILO_IMPORT_SHM(trans);
+    GST_DEBUG_OBJECT(hailoimportshm, "start");
+
+    // The ring is opened with the first buffer, the exporting process may start after this one
+    hailoimportshm->message = new shm_meta_ring::Message();
+    hailoimportshm->message_pending = FALSE;
+    hailoimportshm->reported_dropped = 0;
+
+    return TRUE;
+}
+
+static void
+gst_hailoimportshm_close_reader(GstHailoImportSHM *hailoimportshm)
+{
+    delete hailoimportshm->reader;
+    hailoimportshm->reader = nullptr;
+    hailoimportshm->message_pending = FALSE;
+    hailoimportshm->reported_dropped = 0;
+}
+
+static gboolean
+gst_hailoimportshm_stop(GstBaseTransform *trans)
+{
+    GstHailoImportSHM *hailoimportshm = GST_HAILO_IMPORT_SHM(trans);
+    GST_DEBUG_OBJECT(hailoimportshm, "stop");
+
+    gst_hailoimportshm_close_reader(hailoimportshm);
+    delete hailoimportshm->message;
+    hailoimportshm->message = nullptr;
+
+    return TRUE;
+}
+
+/**
+ * @brief Open the ring, retrying until the exporter created it or the timeout passed.
+ */
+static gboolean
+gst_hailoimportshm_open_reader(GstHailoImportSHM *hailoimportshm)
+{
+    auto start = std::chrono::steady_clock::now();
+    while (true)
+    {
+        try
+        {
+            hailoimportshm->reader = new shm_meta_ring::Reader(hailoimportshm->shm_name);
+            return TRUE;
+        }
+        catch (const std::runtime_error &err)
+        {
+            auto waited_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            if (hailoimportshm->timeout >= 0 && waited_ms >= hailoimportshm->timeout)
+            {
+                GST_WARNING_OBJECT(hailoimportshm, "hailoimportshm could not open the ring: %s", err.what());
+                return FALSE;
+            }
+        }
+        g_usleep(OPEN_RETRY_INTERVAL_US);
+    }
+}
+
+/**
+ * @brief Get the message that belongs to the buffer into hailoimportshm->message.
+ */
+static gboolean
+gst_hailoimportshm_receive(GstHailoImportSHM *hailoimportshm, GstClockTime pts)
+{
+    shm_meta_ring::Message *message = hailoimportshm->message;
+    while (true)
+    {
+        if (!hailoimportshm->message_pending && !hailoimportshm->reader->next(*message, hailoimportshm->timeout))
+        {
+            // A restarted exporter creates a new segment, the reader of the old one would wait forever
+            if (hailoimportshm->reader->writer_gone())
+            {
+                GST_WARNING_OBJECT(hailoimportshm, "hailoimportshm exporter closed, died or replaced the ring, reopening");
+                gst_hailoimportshm_close_reader(hailoimportshm);
+            }
+            else
+            {
+                GST_WARNING_OBJECT(hailoimportshm, "hailoimportshm timed out waiting for a message, the buffer passes without meta");
+            }
+            return FALSE;
+        }
+        hailoimportshm->message_pending = FALSE;
+
+        if (!hailoimportshm->sync_pts || !GST_CLOCK_TIME_IS_VALID(pts) || message->pts == pts)
+            return TRUE;
+        if (message->pts > pts)
+        {
+            // The meta of this buffer was dropped or never exported, the message waits for its own buffer
+            hailoimportshm->message_pending = TRUE;
+            return FALSE;
+        }
+        // The message belongs to a buffer that was already pushed
+    }
+}
+
+static GstFlowReturn
+gst_hailoimportshm_transform_ip(GstBaseTransform *trans,
+                                GstBuffer *buffer)
+{
+    GstHailoImportSHM *hailoimportshm = GST_HAILO_IMPORT_SHM(trans);
+
+    if (!hailoimportshm->reader && !gst_hailoimportshm_open_reader(hailoimportshm))
+        return GST_FLOW_OK;
+    if (!gst_hailoimportshm_receive(hailoimportshm, GST_BUFFER_PTS(buffer)))
+        return GST_FLOW_OK;
+
+    if (hailoimportshm->reader->dropped() != hailoimportshm->reported_dropped)
+    {
+        GST_WARNING_OBJECT(hailoimportshm, "hailoimportshm fell behind the exporter, %" G_GUINT64_FORMAT " messages dropped so far",
+                           hailoimportshm->reader->dropped());
+        hailoimportshm->reported_dropped = hailoimportshm->reader->dropped();
+    }
+
+    // Add the received meta to the roi of the current buffer
+    HailoROIPtr hailo_roi = get_hailo_main_roi(buffer, true);
+    try
+    {
+        decode_binary::decode_hailo_roi(hailoimportshm->message->data.data(), hailoimportshm->message->data.size(), hailo_roi);
+    }
+    catch (const binary_meta::FormatError &err)
+    {
+        GST_ERROR_OBJECT(hailoimportshm, "hailoimportshm failed to decode a message! Error: %s", err.what());
+    }
+
+    GST_DEBUG_OBJECT(hailoimportshm, "transform_ip");
+    return GST_FLOW_OK;
+}
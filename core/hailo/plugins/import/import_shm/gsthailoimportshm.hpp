@@ -0,0 +1,42 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+#pragma once
+
+#include <gst/base/gstbasetransform.h>
+#include "hailo_objects.hpp"
+#include "import/decode_binary.hpp"
+#include "common/shm_meta_ring.hpp"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_HAILO_IMPORT_SHM (gst_hailoimportshm_get_type())
+#define GST_HAILO_IMPORT_SHM(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_HAILO_IMPORT_SHM, GstHailoImportSHM))
+#define GST_HAILO_IMPORT_SHM_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_HAILO_IMPORT_SHM, GstHailoImportSHMClass))
+#define GST_IS_HAILO_IMPORT_SHM(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_HAILO_IMPORT_SHM))
+#define GST_IS_HAILO_IMPORT_SHM_CLASS(obj) (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_HAILO_IMPORT_SHM))
+
+typedef struct _GstHailoImportSHM GstHailoImportSHM;
+typedef struct _GstHailoImportSHMClass GstHailoImportSHMClass;
+
+struct _GstHailoImportSHM
+{
+    GstBaseTransform base_hailoimportshm;
+    gchar *shm_name;
+    gint timeout;
+    gboolean sync_pts;
+    shm_meta_ring::Reader *reader;
+    shm_meta_ring::Message *message;
+    gboolean message_pending; // message is ahead of the buffers and waits for its frame (sync-pts)
+    guint64 reported_dropped;
+};
+
+struct _GstHailoImportSHMClass
+{
+    GstBaseTransformClass base_hailoimportshm_class;
+};
+
+GType gst_hailoimportshm_get_type(void);
+
+G_END_DECLS
@@ -12,7 +12,6 @@
 #include <ctime>
 #include <gst/video/video.h>
 #include <gst/gst.h>
-#include <unistd.h>
 
 #define RAPIDJSON_HAS_STDSTRING 1
 #include "rapidjson/document.h"
@@ -49,10 +48,14 @@ enum
 {
     PROP_0,
     PROP_ADDRESS,
+    PROP_FORMAT,
+    PROP_TIMEOUT,
 };
 
 // Default import node
 const gchar *DEFAULT_ADDRESS = "tcp://localhost:5555";
+// Wait for a message as long as it takes
+#define DEFAULT_TIMEOUT -1
 
 static void
 gst_hailoimportzmq_class_init(GstHailoImportZMQClass *klass)
@@ -61,9 +64,9 @@ gst_hailoimportzmq_class_init(GstHailoImportZMQClass *klass)
     GstBaseTransformClass *base_transform_class =
         GST_BASE_TRANSFORM_CLASS(klass);
 
-    const char *description = "Imports HailoObjects in JSON format from a ZMQ socket."
+    const char *description = "Imports HailoObjects in JSON or binary format from a ZMQ socket."
                               "\n\t\t\t   "
-                              "Decodes classes contained by JSON to HailoROI objects.";
+                              "Decodes classes contained by JSON or by the binary meta format to HailoROI objects.";
     /* Setting up pads and setting metadata should be moved to
        base_class_init if you intend to subclass this class. */
     gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass),
@@ -85,6 +88,16 @@ gst_hailoimportzmq_class_init(GstHailoImportZMQClass *klass)
                                     g_param_spec_string("address", "Endpoint address.",
                                                         "Address to bind the socket to.", "tcp://localhost:5555",
                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_FORMAT,
+                                    g_param_spec_enum("format", "Message format",
+                                                      "Encoding of the received meta, has to match the format of the exporter.",
+                                                      GST_TYPE_HAILO_META_FORMAT, GST_HAILO_META_FORMAT_JSON,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_TIMEOUT,
+                                    g_param_spec_int("timeout", "Receive timeout",
+                                                     "Time in ms to wait for a message, a buffer that times out passes without meta. -1 waits forever.",
+                                                     -1, G_MAXINT, DEFAULT_TIMEOUT,
+                                                     (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 
     gobject_class->dispose = gst_hailoimportzmq_dispose;
     gobject_class->finalize = gst_hailoimportzmq_finalize;
@@ -97,6 +110,8 @@ static void
 gst_hailoimportzmq_init(GstHailoImportZMQ *hailoimportzmq)
 {
     hailoimportzmq->address = g_strdup(DEFAULT_ADDRESS);
+    hailoimportzmq->format = GST_HAILO_META_FORMAT_JSON;
+    hailoimportzmq->timeout = DEFAULT_TIMEOUT;
 }
 
 void gst_hailoimportzmq_set_property(GObject *object, guint property_id,
@@ -111,6 +126,12 @@ void gst_hailoimportzmq_set_property(GObject *object, guint property_id,
     case PROP_ADDRESS:
         hailoimportzmq->address = g_strdup(g_value_get_string(value));
         break;
+    case PROP_FORMAT:
+        hailoimportzmq->format = (GstHailoMetaFormat)g_value_get_enum(value);
+        break;
+    case PROP_TIMEOUT:
+        hailoimportzmq->timeout = g_value_get_int(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -129,6 +150,12 @@ void gst_hailoimportzmq_get_property(GObject *object, guint property_id,
     case PROP_ADDRESS:
         g_value_set_string(value, hailoimportzmq->address);
         break;
+    case PROP_FORMAT:
+        g_value_set_enum(value, hailoimportzmq->format);
+        break;
+    case PROP_TIMEOUT:
+        g_value_set_int(value, hailoimportzmq->timeout);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -166,6 +193,8 @@ gst_hailoimportzmq_start(GstBaseTransform *trans)
 
     // Bind the socket to the requested address
     hailoimportzmq->socket->setsockopt(ZMQ_SUBSCRIBE, "", 0);
+    // recv blocks until a message arrives or the timeout passes
+    hailoimportzmq->socket->setsockopt(ZMQ_RCVTIMEO, hailoimportzmq->timeout);
     try {
         hailoimportzmq->socket->connect(hailoimportzmq->address);
     }
@@ -199,32 +228,66 @@ gst_hailoimportzmq_transform_ip(GstBaseTransform *trans,
 {
     GstHailoImportZMQ *hailoimportzmq = GST_HAILO_IMPORT_ZMQ(trans);
 
-    // Get the roi from the current buffer and decode it to a JSON entry
+    // Get the roi from the current buffer, the received meta is added to it
     HailoROIPtr hailo_roi = get_hailo_main_roi(buffer, true);
 
-    // Recv the message
+    // Recv the message, blocking until it arrives or the timeout passes
     zmq::message_t recv_message;
 #if (CPPZMQ_VERSION_MAJOR >= 4 && CPPZMQ_VERSION_MINOR >= 6 && CPPZMQ_VERSION_PATCH >= 0)
-    zmq::recv_result_t recv_succeeded = 0;
+    zmq::recv_result_t recv_result;
 #else
-    zmq::detail::recv_result_t recv_succeeded = 0;
+    zmq::detail::recv_result_t recv_result;
 #endif
-    while (recv_message.size() == 0)
+    try
+    {
+        recv_result = hailoimportzmq->socket->recv(recv_message, zmq::recv_flags::none);
+    }
+    catch (zmq::error_t const &err)
     {
-        recv_succeeded = hailoimportzmq->socket->recv(recv_message, zmq::recv_flags(ZMQ_DONTWAIT));
-        sleep(0);  // yield the scheduler to prevent the thread from spinning the CPU core
+        GST_ERROR("hailoimportzmq failed to receive a message! Error: %s", err.what());
+        return GST_FLOW_OK;
     }
-    if (recv_succeeded <= 0)
-        GST_WARNING("hailoimportzmq failed to send buffer!");
-
-    // Decode the recvd JSON
-    std::string rx_str;
-    rx_str.assign(static_cast<char *>(recv_message.data()), recv_message.size());
-    rapidjson::Document decoded_stream;
-    if (decoded_stream.Parse(rx_str).HasParseError()) {
-        GST_ERROR("hailoimportzmq failed to parse message to json!");
+    if (!recv_result)
+    {
+        GST_WARNING("hailoimportzmq timed out waiting for a message, the buffer passes without meta");
+        return GST_FLOW_OK;
+    }
+
+    if (hailoimportzmq->format == GST_HAILO_META_FORMAT_BINARY)
+    {
+        try
+        {
+            decode_binary::decode_hailo_roi(static_cast<const uint8_t *>(recv_message.data()), recv_message.size(), hailo_roi);
+        }
+        catch (const binary_meta::FormatError &err)
+        {
+            GST_ERROR("hailoimportzmq failed to decode a binary message! Error: %s", err.what());
+        }
+    }
+    else
+    {
+        // Decode the recvd JSON straight from the message, without copying it to a string
+        rapidjson::Document decoded_stream;
+        if (decoded_stream.Parse(static_cast<const char *>(recv_message.data()), recv_message.size()).HasParseError())
+        {
+            GST_ERROR("hailoimportzmq failed to parse message to json!");
+        }
+        else
+        {
+            // Decoded aside, so a message that fails halfway adds nothing to the buffer
+            HailoROIPtr decoded_roi = std::make_shared<HailoROI>(hailo_roi->get_bbox());
+            try
+            {
+                decode_json::decode_hailo_roi(decoded_stream, decoded_roi);
+                for (auto obj : decoded_roi->get_objects())
+                    hailo_roi->add_object(obj);
+            }
+            catch (const std::invalid_argument &err)
+            {
+                GST_WARNING("hailoimportzmq dropped a malformed message, the buffer passes without meta. Error: %s", err.what());
+            }
+        }
     }
-    decode_json::decode_hailo_roi(decoded_stream, hailo_roi);
 
     GST_DEBUG_OBJECT(hailoimportzmq, "transform_ip");
     return GST_FLOW_OK;
@@ -7,6 +7,8 @@
 #include <gst/base/gstbasetransform.h>
 #include "hailo_objects.hpp"
 #include "import/decode_json.hpp"
+#include "import/decode_binary.hpp"
+#include "common/meta_format.hpp"
 #include <cstdio>
 #include <zmq.hpp>
 
@@ -25,6 +27,8 @@ struct _GstHailoImportZMQ
 {
     GstBaseTransform base_hailoimportzmq;
     gchar *address;
+    GstHailoMetaFormat format;
+    gint timeout;
     zmq::context_t *context;
     zmq::socket_t *socket;
 };
@@ -32,6 +32,12 @@ enum
     PROP_0,
     PROP_SYNC_COUNTERS,
     PROP_LEAKY_SUB,
+    PROP_MATCH_MODE,
+    PROP_MATCH_TOLERANCE,
+    PROP_MATCH_TIMEOUT,
+    PROP_MATCH_WINDOW,
+    PROP_MATCH_SUB_WINDOW,
+    PROP_STATS,
 };
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink",
@@ -68,6 +74,9 @@ static void gst_hailomuxer_merge_rois(GstBuffer *main_buf, GstBuffer *sub_buf, G
 static void gst_hailomuxer_wait_for_main(GstHailoMuxer *hailomuxer, std::unique_lock<std::mutex> &lock);
 static void gst_hailomuxer_wait_for_sub(GstBuffer *buf, GstHailoMuxer *hailomuxer, std::unique_lock<std::mutex> &lock);
 static GstBuffer *gst_hailomuxer_dequeue_sub_frame_leaky_mode(GstHailoMuxer *hailomuxer);
+static GstFlowReturn gst_hailomuxer_chain_main_matching_mode(GstPad *pad, GstObject *parent, GstBuffer *buf);
+static GstFlowReturn gst_hailomuxer_chain_sub_matching_mode(GstPad *pad, GstObject *parent, GstBuffer *buf);
+static void gst_hailomuxer_finalize(GObject *object);
 
 static void
 gst_hailomuxer_class_init(GstHailoMuxerClass *klass)
@@ -79,6 +88,7 @@ gst_hailomuxer_class_init(GstHailoMuxerClass *klass)
 
     gobject_class->set_property = gst_hailomuxer_set_property;
     gobject_class->get_property = gst_hailomuxer_get_property;
+    gobject_class->finalize = gst_hailomuxer_finalize;
 
     gst_element_class_set_static_metadata(gstelement_class,
                                           "Muxer pipeline merging",
@@ -97,6 +107,30 @@ gst_hailomuxer_class_init(GstHailoMuxerClass *klass)
     g_object_class_install_property(gobject_class, PROP_LEAKY_SUB,
                                     g_param_spec_boolean("leaky-sub", "leaky-sub", "allow main frames to pass through the element even if a sub frame is not available (Can't be enabled with sync-counters)", false,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_MODE,
+                                    g_param_spec_enum("match-mode", "match-mode", "Match main and sub frames by PTS or offset, main frames wait in a window instead of blocking the main branch (overrides sync-counters and leaky-sub)",
+                                                      GST_TYPE_HAILO_MATCH_MODE, GST_HAILO_MATCH_MODE_NONE,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_TOLERANCE,
+                                    g_param_spec_uint64("match-tolerance", "match-tolerance", "Maximal difference between the keys of matching frames (ns for pts, frames for offset)",
+                                                        0, G_MAXUINT64, HAILO_MATCH_DEFAULT_TOLERANCE,
+                                                        (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_TIMEOUT,
+                                    g_param_spec_uint("match-timeout", "match-timeout", "Time in ms after which a main frame is pushed without its sub frame",
+                                                      1, G_MAXUINT, HAILO_MATCH_DEFAULT_TIMEOUT_MS,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_WINDOW,
+                                    g_param_spec_uint("match-window", "match-window", "Maximal number of main frames waiting for their sub frame",
+                                                      1, 1024, HAILO_MATCH_DEFAULT_WINDOW,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_SUB_WINDOW,
+                                    g_param_spec_uint("match-sub-window", "match-sub-window", "Maximal number of sub frames waiting for their main frame, raise it for many sub frames per frame at high frame rates",
+                                                      1, G_MAXUINT16, HAILO_MATCH_DEFAULT_SUB_WINDOW,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_STATS,
+                                    g_param_spec_boxed("stats", "Statistics", "Matched and unmatched main frames, match rate and average added latency in ns (only relevant when match-mode is set)",
+                                                       GST_TYPE_STRUCTURE,
+                                                       (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
@@ -131,6 +165,48 @@ gst_hailomuxer_init(GstHailoMuxer *hailomuxer)
     hailomuxer->sync_counters = false;
     hailomuxer->leaky_sub = false;
     hailomuxer->sub_buffers_queue = std::queue<GstBuffer *>();
+
+    hailomuxer->match_mode = GST_HAILO_MATCH_MODE_NONE;
+    hailomuxer->match_tolerance = HAILO_MATCH_DEFAULT_TOLERANCE;
+    hailomuxer->match_timeout = HAILO_MATCH_DEFAULT_TIMEOUT_MS;
+    hailomuxer->match_window = HAILO_MATCH_DEFAULT_WINDOW;
+    hailomuxer->match_sub_window = HAILO_MATCH_DEFAULT_SUB_WINDOW;
+    hailomuxer->matcher = new HailoFrameMatcher();
+    hailomuxer->match_timer = new HailoMatchTimer();
+    hailomuxer->flush_requested = false;
+    hailomuxer->last_flow = GST_FLOW_OK;
+}
+
+static void
+gst_hailomuxer_finalize(GObject *object)
+{
+    GstHailoMuxer *hailomuxer = GST_HAILO_MUXER_CAST(object);
+    delete hailomuxer->match_timer;
+    hailomuxer->match_timer = NULL;
+    hailomuxer->matcher->clear(gst_buffer_unref);
+    delete hailomuxer->matcher;
+    hailomuxer->matcher = NULL;
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+static void
+gst_hailomuxer_update_chain_functions(GstHailoMuxer *hailomuxer)
+{
+    if (hailomuxer->match_mode != GST_HAILO_MATCH_MODE_NONE)
+    {
+        gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main_matching_mode));
+        gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub_matching_mode));
+    }
+    else if (hailomuxer->leaky_sub)
+    {
+        gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main_leaky_mode));
+        gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub_leaky_mode));
+    }
+    else
+    {
+        gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main));
+        gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub));
+    }
 }
 
 static void
@@ -147,26 +223,32 @@ gst_hailomuxer_set_property(GObject *object, guint prop_id,
         {
             hailomuxer->leaky_sub = false;
             // set the chain function to the non-leaky mode
-            gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main));
-            gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub));
+            gst_hailomuxer_update_chain_functions(hailomuxer);
         }
         break;
     case PROP_LEAKY_SUB:
         if (!hailomuxer->sync_counters) // If sync_counters is enabled, leaky_sub is not allowed
         {
             hailomuxer->leaky_sub = g_value_get_boolean(value);
-            if (hailomuxer->leaky_sub)
-            {
-                gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main_leaky_mode));
-                gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub_leaky_mode));
-            }
-            else
-            {
-                gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main));
-                gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub));
-            }
+            gst_hailomuxer_update_chain_functions(hailomuxer);
         }
         break;
+    case PROP_MATCH_MODE:
+        hailomuxer->match_mode = (GstHailoMatchMode)g_value_get_enum(value);
+        gst_hailomuxer_update_chain_functions(hailomuxer);
+        break;
+    case PROP_MATCH_TOLERANCE:
+        hailomuxer->match_tolerance = g_value_get_uint64(value);
+        break;
+    case PROP_MATCH_TIMEOUT:
+        hailomuxer->match_timeout = g_value_get_uint(value);
+        break;
+    case PROP_MATCH_WINDOW:
+        hailomuxer->match_window = g_value_get_uint(value);
+        break;
+    case PROP_MATCH_SUB_WINDOW:
+        hailomuxer->match_sub_window = g_value_get_uint(value);
+        break;
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -188,6 +270,27 @@ gst_hailomuxer_get_property(GObject *object, guint prop_id, GValue *value,
     case PROP_LEAKY_SUB:
         g_value_set_boolean(value, hailomuxer->leaky_sub);
         break;
+    case PROP_MATCH_MODE:
+        g_value_set_enum(value, hailomuxer->match_mode);
+        break;
+    case PROP_MATCH_TOLERANCE:
+        g_value_set_uint64(value, hailomuxer->match_tolerance);
+        break;
+    case PROP_MATCH_TIMEOUT:
+        g_value_set_uint(value, hailomuxer->match_timeout);
+        break;
+    case PROP_MATCH_WINDOW:
+        g_value_set_uint(value, hailomuxer->match_window);
+        break;
+    case PROP_MATCH_SUB_WINDOW:
+        g_value_set_uint(value, hailomuxer->match_sub_window);
+        break;
+    case PROP_STATS:
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        g_value_take_boxed(value, hailomuxer->matcher->get_stats());
+        break;
+    }
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -240,6 +343,48 @@ gst_hailomuxer_update_eos(GstHailoMuxer *hailomuxer, GstPad *pad, bool eos)
     }
 }
 
+/**
+ * Push the main frames that are released by the matcher, in order.
+ * Frames may become ready on both branches, the srcpad stream lock serializes the pushes.
+ * When the lock is taken and wait is false, the holder of the lock pushes them instead.
+ *
+ * @param[in] hailomuxer   muxer element.
+ * @param[in] wait         Whether to wait for the srcpad stream lock.
+ * @param[in] release_all  Release all pending frames, also those still waiting for their sub frame.
+ * @return The flow return of the last push.
+ */
+static GstFlowReturn
+gst_hailomuxer_push_released_frames(GstHailoMuxer *hailomuxer, bool wait, bool release_all)
+{
+    hailomuxer->flush_requested.store(true);
+    while (hailomuxer->flush_requested.load())
+    {
+        if (wait)
+            GST_PAD_STREAM_LOCK(hailomuxer->srcpad);
+        else if (!GST_PAD_STREAM_TRYLOCK(hailomuxer->srcpad))
+            return hailomuxer->last_flow;
+        hailomuxer->flush_requested.store(false);
+
+        std::vector<GstBuffer *> released;
+        {
+            std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+            auto on_release = [&released](HailoPendingFrame &frame) { released.push_back(frame.buffer); };
+            if (release_all)
+                hailomuxer->matcher->release_all(g_get_monotonic_time(), on_release);
+            else
+                hailomuxer->matcher->release_ready(g_get_monotonic_time(), on_release);
+        }
+
+        for (GstBuffer *buf : released)
+        {
+            gst_pad_sticky_events_foreach(hailomuxer->sinkpad_main, forward_events, hailomuxer->srcpad);
+            hailomuxer->last_flow = gst_pad_push(hailomuxer->srcpad, buf);
+        }
+        GST_PAD_STREAM_UNLOCK(hailomuxer->srcpad);
+    }
+    return hailomuxer->last_flow;
+}
+
 static gboolean
 gst_hailomuxer_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
 {
@@ -265,6 +410,9 @@ gst_hailomuxer_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
             gst_hailomuxer_update_eos(hailomuxer, pad, true);
             forward = gst_hailomuxer_all_sinkpads_eos_unlocked(hailomuxer);
             GST_OBJECT_UNLOCK(hailomuxer);
+            // Pending main frames won't get their sub frames anymore
+            if (hailomuxer->match_mode != GST_HAILO_MATCH_MODE_NONE && (forward || pad == hailomuxer->sinkpad_sub))
+                gst_hailomuxer_push_released_frames(hailomuxer, true, true);
         }
         else if (pad != hailomuxer->sinkpad_main)
         {
@@ -278,6 +426,12 @@ gst_hailomuxer_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
         GST_OBJECT_LOCK(hailomuxer);
         gst_hailomuxer_update_eos(hailomuxer, pad, false);
         GST_OBJECT_UNLOCK(hailomuxer);
+        if (hailomuxer->match_mode != GST_HAILO_MATCH_MODE_NONE)
+        {
+            std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+            hailomuxer->matcher->clear(gst_buffer_unref);
+            hailomuxer->last_flow = GST_FLOW_OK;
+        }
     }
 
     if (forward && GST_EVENT_IS_SERIALIZED(event))
@@ -501,6 +655,78 @@ gst_hailomuxer_chain_main_leaky_mode(GstPad *pad, GstObject *parent, GstBuffer *
     return ret;
 }
 
+static GstFlowReturn
+gst_hailomuxer_chain_main_matching_mode(GstPad *pad, GstObject *parent, GstBuffer *buf)
+{
+    GstHailoMuxer *hailomuxer = GST_HAILO_MUXER_CAST(parent);
+    GstHailoMuxerClass *hailomuxer_class = GST_HAILO_MUXER_GET_CLASS(hailomuxer);
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        guint64 key = gst_hailo_match_key(buf, hailomuxer->match_mode);
+        // Without a sub branch the main frame is released right away
+        bool was_empty = hailomuxer->matcher->next_deadline() < 0;
+        HailoPendingFrame &frame = hailomuxer->matcher->add_main(buf, key, hailomuxer->eos_sub ? 0 : 1, g_get_monotonic_time());
+        if (was_empty)
+            hailomuxer->match_timer->wake();
+
+        // The sub frame may have arrived first
+        GstBuffer *sub_buf = hailomuxer->matcher->take_sub(key, [](GstBuffer *stale) {
+            gst_buffer_remove_hailo_meta(stale);
+            gst_buffer_unref(stale);
+        });
+        if (sub_buf)
+        {
+            hailomuxer_class->handle_sub_frame_roi(get_hailo_main_roi(frame.buffer, true), get_hailo_main_roi(sub_buf));
+            frame.received++;
+            gst_buffer_remove_hailo_meta(sub_buf);
+            gst_buffer_unref(sub_buf);
+        }
+    }
+
+    // Never wait on the main branch, if another thread is pushing it will push this frame too
+    return gst_hailomuxer_push_released_frames(hailomuxer, false, false);
+}
+
+static GstFlowReturn
+gst_hailomuxer_chain_sub_matching_mode(GstPad *pad, GstObject *parent, GstBuffer *buf)
+{
+    GstHailoMuxer *hailomuxer = GST_HAILO_MUXER_CAST(parent);
+    GstHailoMuxerClass *hailomuxer_class = GST_HAILO_MUXER_GET_CLASS(hailomuxer);
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        if (hailomuxer->eos_main)
+        {
+            gst_buffer_unref(buf);
+            return GST_FLOW_OK;
+        }
+
+        guint64 key = gst_hailo_match_key(buf, hailomuxer->match_mode);
+        HailoPendingFrame *frame = hailomuxer->matcher->find_main(key);
+        if (frame != nullptr)
+        {
+            hailomuxer_class->handle_sub_frame_roi(get_hailo_main_roi(frame->buffer, true), get_hailo_main_roi(buf));
+            frame->received++;
+            // Earlier main frames lost their sub frames
+            hailomuxer->matcher->expire_older_than(key);
+            gst_buffer_remove_hailo_meta(buf);
+            gst_buffer_unref(buf);
+        }
+        else
+        {
+            // Wait for the main frame
+            GstBuffer *evicted = hailomuxer->matcher->add_sub(buf, key);
+            if (evicted)
+            {
+                gst_buffer_remove_hailo_meta(evicted);
+                gst_buffer_unref(evicted);
+            }
+        }
+    }
+
+    gst_hailomuxer_push_released_frames(hailomuxer, true, false);
+    return GST_FLOW_OK;
+}
+
 /**
  * Functionality to perform for each incoming sub frame.
  * Called from the chain_sub method before the releasing the mutex and the buffers.
@@ -539,6 +765,22 @@ gst_hailomuxer_change_state(GstElement *element, GstStateChange transition)
     GstHailoMuxer *muxer = GST_HAILO_MUXER(element);
     switch (transition)
     {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    {
+        std::unique_lock<std::mutex> lock(muxer->mutex);
+        muxer->matcher->configure(muxer->match_tolerance, (gint64)muxer->match_timeout * 1000,
+                                  muxer->match_window, muxer->match_sub_window);
+        muxer->last_flow = GST_FLOW_OK;
+        lock.unlock();
+        // Release timed out main frames also when no buffers arrive
+        if (muxer->match_mode != GST_HAILO_MATCH_MODE_NONE)
+        {
+            muxer->match_timer->start(
+                muxer->mutex, [muxer]() { return muxer->matcher->next_deadline(); },
+                [muxer]() { gst_hailomuxer_push_released_frames(muxer, true, false); });
+        }
+        break;
+    }
     case GST_STATE_CHANGE_PAUSED_TO_READY:
     {
         // Unlocking both condition variables in order to finish the chain function.
@@ -556,5 +798,12 @@ gst_hailomuxer_change_state(GstElement *element, GstStateChange transition)
     if (ret == GST_STATE_CHANGE_FAILURE)
         return ret;
 
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY)
+    {
+        muxer->match_timer->stop();
+        std::lock_guard<std::mutex> lock(muxer->mutex);
+        muxer->matcher->clear(gst_buffer_unref);
+    }
+
     return ret;
 }
@@ -14,7 +14,9 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <atomic>
 #include "hailo_objects.hpp"
+#include "common/frame_matcher.hpp"
 
 G_BEGIN_DECLS
 
@@ -52,6 +54,16 @@ struct _GstHailoMuxer
     gboolean sync_counters;
     uint current_counter_main;
     uint current_counter_sub;
+    // Matching by PTS / offset
+    GstHailoMatchMode match_mode;
+    guint64 match_tolerance;
+    guint match_timeout;
+    guint match_window;
+    guint match_sub_window;
+    HailoFrameMatcher *matcher;
+    HailoMatchTimer *match_timer;
+    std::atomic<bool> flush_requested;
+    std::atomic<GstFlowReturn> last_flow;
 
     std::mutex mutex;
     std::condition_variable cv_main;
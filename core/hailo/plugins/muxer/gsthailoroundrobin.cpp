@@ -11,6 +11,7 @@
 #include "gsthailoroundrobin.hpp"
 #include "gst_hailo_meta.hpp"
 #include "gst_hailo_stream_meta.hpp"
+#include <algorithm>
 
 GST_DEBUG_CATEGORY_STATIC(gst_hailo_round_robin_debug);
 #define GST_CAT_DEFAULT gst_hailo_round_robin_debug
@@ -41,6 +42,10 @@ GType gst_hailo_round_robin_pad_get_type(void);
 #define MAX_WAIT_TIME 500
 #define MIN_WAIT_TIME 0
 
+#define MAX_ADAPTIVE_PADS 128
+// Maximal time the adaptive scheduler sleeps before re-checking its queue
+#define ADAPTIVE_SCHEDULER_WAKEUP_TIMEOUT_MS 100
+
 #define DEFAULT_PREROLL_FRAMES 3
 #define MAX_PREROLL_FRAMES 30
 #define MIN_PREROLL_FRAMES 1
@@ -57,6 +62,7 @@ gst_hailoroundrobin_mode_get_type(void)
         {GST_HAILO_ROUND_ROBIN_MODE_FUNNEL_MODE, "Funnel Mode (push every buffer when it is ready)", "funnel-mode"},
         {GST_HAILO_ROUND_ROBIN_MODE_BLOCKING, "Blocking Mode (push every buffer when it is its pad's turn, and if the buffer is not ready, block until ready)", "blocking-mode"},
         {GST_HAILO_ROUND_ROBIN_MODE_NON_BLOCKING, "Non Blocking Mode (push every buffer when it is its pad's turn, and if the buffer is not ready, skip it)", "non-blocking-mode"},
+        {GST_HAILO_ROUND_ROBIN_MODE_ADAPTIVE, "Adaptive Mode (push the buffer with the earliest deadline first, drop buffers of pads that are more than queue-size buffers behind)", "adaptive-mode"},
         {0, NULL, NULL},
     };
     if (!hailoroundrobin_mode_type)
@@ -71,6 +77,8 @@ struct _GstHailoRoundRobinPad
 {
     GstPad parent;
     gboolean got_eos;
+    guint stream_index;
+    guint pad_num;
 };
 
 struct _GstHailoRoundRobinPadClass
@@ -100,6 +108,7 @@ enum
     PROP_QUEUE_SIZE,
     PROP_WAIT_TIME,
     PROP_PREROLL_FRAMES,
+    PROP_STATS,
 };
 
 static void
@@ -111,6 +120,7 @@ static void
 gst_hailo_round_robin_pad_init(GstHailoRoundRobinPad *pad)
 {
     pad->got_eos = FALSE;
+    pad->stream_index = GST_HAILO_STREAM_INDEX_NONE;
 }
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink_%u",
@@ -143,6 +153,10 @@ static GstFlowReturn gst_hailo_round_robin_sink_chain_blocking_mode(GstPad *pad,
 static GstFlowReturn gst_hailo_round_robin_sink_chain_non_blocking_mode(GstPad *pad,
                                                                         GstObject *parent,
                                                                         GstBuffer *buf);
+static GstFlowReturn gst_hailo_round_robin_sink_chain_adaptive_mode(GstPad *pad,
+                                                                    GstObject *parent,
+                                                                    GstBuffer *buf);
+static GstStructure *gst_hailo_round_robin_get_stats(GstHailoRoundRobin *hailo_round_robin);
 
 static gboolean gst_hailo_round_robin_sink_event(GstPad *pad,
                                                  GstObject *parent,
@@ -214,6 +228,9 @@ gst_hailo_round_robin_get_property(GObject *object, guint prop_id, GValue *value
     case PROP_PREROLL_FRAMES:
         g_value_set_uint(value, GST_HAILO_ROUND_ROBIN(object)->preroll_frames);
         break;
+    case PROP_STATS:
+        g_value_take_boxed(value, gst_hailo_round_robin_get_stats(GST_HAILO_ROUND_ROBIN(object)));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -310,7 +327,7 @@ void schedule(GstHailoRoundRobin *hailo_round_robin)
                         gchar *stream_id = gst_pad_get_stream_id(pad);
 
                         // Add stream meta to the buffer including the pad name and stream id.
-                        gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
+                        gst_buffer_add_hailo_stream_meta_full(buf, pad_name, stream_id, GST_HAILO_ROUND_ROBIN_PAD_CAST(pad)->stream_index);
 
                         // Forward sticky events.
                         gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
@@ -332,6 +349,226 @@ void schedule(GstHailoRoundRobin *hailo_round_robin)
     }
 }
 
+/**
+ * Mark a buffer accepted in adaptive mode as done (pushed or dropped), waking up drain waiters when the pad is drained.
+ */
+static void
+adaptive_item_done(GstHailoRoundRobin *hailo_round_robin, HailoRoundRobinAdaptivePad *state)
+{
+    if (state->in_flight.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        std::lock_guard lock(*hailo_round_robin->adaptive_mutex);
+        hailo_round_robin->adaptive_cv->notify_all();
+    }
+}
+
+/**
+ * Release a buffer accepted in adaptive mode without pushing it, scheduler thread only.
+ */
+static void
+adaptive_release_item(GstHailoRoundRobin *hailo_round_robin, HailoRoundRobinItem &item)
+{
+    HailoRoundRobinAdaptivePad *state = hailo_round_robin->adaptive_pads[item.pad_num].get();
+    gst_buffer_unref(item.buffer);
+    gst_object_unref(item.pad);
+    state->queued.fetch_sub(1, std::memory_order_relaxed);
+    adaptive_item_done(hailo_round_robin, state);
+}
+
+static bool
+adaptive_item_flushed(HailoRoundRobinAdaptivePad *state, const HailoRoundRobinItem &item)
+{
+    return item.flush_generation != state->flush_generation.load(std::memory_order_acquire);
+}
+
+/**
+ * Push a buffer accepted in adaptive mode, scheduler thread only.
+ */
+static void
+adaptive_push_item(GstHailoRoundRobin *hailo_round_robin, HailoRoundRobinAdaptivePad *state, HailoRoundRobinItem &item)
+{
+    GstBuffer *buf = gst_buffer_make_writable(item.buffer);
+    gchar *pad_name = gst_pad_get_name(item.pad);
+    gchar *stream_id = gst_pad_get_stream_id(item.pad);
+
+    // Add stream meta to the buffer including the pad name and stream id.
+    gst_buffer_add_hailo_stream_meta_full(buf, pad_name, stream_id, GST_HAILO_ROUND_ROBIN_PAD_CAST(item.pad)->stream_index);
+
+    set_current_pad_num(hailo_round_robin, item.pad_num);
+    // Forward sticky events.
+    gst_pad_sticky_events_foreach(item.pad, forward_events, hailo_round_robin->srcpad);
+
+    // Latency is the time the buffer waited in the element
+    guint64 latency = g_get_monotonic_time() - item.arrival_time;
+    state->pushed.fetch_add(1, std::memory_order_relaxed);
+    state->total_latency.fetch_add(latency, std::memory_order_relaxed);
+    if (latency > state->max_latency.load(std::memory_order_relaxed))
+        state->max_latency.store(latency, std::memory_order_relaxed);
+    // Let the pad accept a new buffer while this one is pushed downstream
+    state->queued.fetch_sub(1, std::memory_order_release);
+
+    GstFlowReturn res = gst_pad_push(hailo_round_robin->srcpad, buf);
+    // A buffer from before a flush doesn't get to report the flushing downstream
+    if (!adaptive_item_flushed(state, item))
+        hailo_round_robin->adaptive_last_flow.store(res, std::memory_order_relaxed);
+    if (res != GST_FLOW_OK && res != GST_FLOW_FLUSHING)
+        GST_WARNING_OBJECT(hailo_round_robin, "Failed to push buffer to srcpad (%s)", gst_flow_get_name(res));
+
+    g_free(pad_name);
+    g_free(stream_id);
+    gst_object_unref(item.pad);
+    adaptive_item_done(hailo_round_robin, state);
+}
+
+/**
+ * Scheduler thread of adaptive mode.
+ * Sink pads enqueue their buffers to a single lock-free queue. This thread moves them to per pad
+ * pending lists and always pushes the buffer with the earliest deadline, where the deadline of a
+ * buffer is its arrival time plus the frame interval of its pad: every buffer should leave before
+ * the next buffer of its stream arrives. Slow (e.g. 5 fps) streams are thus not starved by fast
+ * (e.g. 30 fps) ones, and fast streams are not delayed behind a full round of slow ones.
+ */
+static void
+adaptive_schedule(GstHailoRoundRobin *hailo_round_robin)
+{
+    MpscQueue<HailoRoundRobinItem> &queue = *hailo_round_robin->adaptive_queue;
+    HailoRoundRobinItem item;
+    while (!hailo_round_robin->adaptive_stop.load(std::memory_order_acquire))
+    {
+        // Move all the new buffers to their pad's pending list
+        while (queue.pop(item))
+        {
+            HailoRoundRobinAdaptivePad *state = hailo_round_robin->adaptive_pads[item.pad_num].get();
+            if (adaptive_item_flushed(state, item))
+            {
+                adaptive_release_item(hailo_round_robin, item);
+                continue;
+            }
+            if (state->last_arrival != 0)
+            {
+                gint64 interval = std::min<gint64>(item.arrival_time - state->last_arrival, G_USEC_PER_SEC);
+                state->frame_interval = (state->frame_interval == 0) ? interval : (7 * state->frame_interval + interval) / 8;
+            }
+            state->last_arrival = item.arrival_time;
+            state->pending.push_back(item);
+        }
+
+        // Pick the pad with the earliest deadline
+        HailoRoundRobinAdaptivePad *next_state = NULL;
+        gint64 earliest_deadline = G_MAXINT64;
+        guint num_of_pads = hailo_round_robin->num_of_adaptive_pads.load(std::memory_order_acquire);
+        for (guint i = 0; i < num_of_pads; i++)
+        {
+            HailoRoundRobinAdaptivePad *state = hailo_round_robin->adaptive_pads[i].get();
+            // Drop the buffers that arrived before a flush of the pad
+            while (!state->pending.empty() && adaptive_item_flushed(state, state->pending.front()))
+            {
+                adaptive_release_item(hailo_round_robin, state->pending.front());
+                state->pending.pop_front();
+            }
+            if (state->pending.empty())
+                continue;
+            gint64 deadline = state->pending.front().arrival_time + state->frame_interval;
+            if (deadline < earliest_deadline)
+            {
+                earliest_deadline = deadline;
+                next_state = state;
+            }
+        }
+
+        if (next_state == NULL)
+        {
+            // Nothing to push, sleep until a sink pad enqueues a buffer
+            std::unique_lock lock(*hailo_round_robin->adaptive_mutex);
+            hailo_round_robin->adaptive_sleeping.store(true, std::memory_order_seq_cst);
+            if (queue.empty() && !hailo_round_robin->adaptive_stop.load(std::memory_order_acquire))
+                hailo_round_robin->adaptive_cv->wait_for(lock, std::chrono::milliseconds(ADAPTIVE_SCHEDULER_WAKEUP_TIMEOUT_MS));
+            hailo_round_robin->adaptive_sleeping.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        item = next_state->pending.front();
+        next_state->pending.pop_front();
+        adaptive_push_item(hailo_round_robin, next_state, item);
+    }
+
+    // Release the buffers that were not pushed
+    while (queue.pop(item))
+        adaptive_release_item(hailo_round_robin, item);
+    for (guint i = 0; i < hailo_round_robin->num_of_adaptive_pads.load(); i++)
+    {
+        for (HailoRoundRobinItem &pending_item : hailo_round_robin->adaptive_pads[i]->pending)
+            adaptive_release_item(hailo_round_robin, pending_item);
+        hailo_round_robin->adaptive_pads[i]->pending.clear();
+        hailo_round_robin->adaptive_pads[i]->last_arrival = 0;
+    }
+}
+
+static void
+gst_hailo_round_robin_start_adaptive_scheduler(GstHailoRoundRobin *hailo_round_robin)
+{
+    hailo_round_robin->adaptive_stop.store(false);
+    hailo_round_robin->adaptive_last_flow.store(GST_FLOW_OK);
+    hailo_round_robin->adaptive_thread = std::make_unique<std::thread>(adaptive_schedule, hailo_round_robin);
+}
+
+static void
+gst_hailo_round_robin_stop_adaptive_scheduler(GstHailoRoundRobin *hailo_round_robin)
+{
+    if (!hailo_round_robin->adaptive_thread)
+        return;
+    {
+        std::lock_guard lock(*hailo_round_robin->adaptive_mutex);
+        hailo_round_robin->adaptive_stop.store(true, std::memory_order_release);
+        hailo_round_robin->adaptive_cv->notify_all();
+    }
+    hailo_round_robin->adaptive_thread->join();
+    hailo_round_robin->adaptive_thread.reset();
+}
+
+/**
+ * Block until the pushes of all the buffers accepted in adaptive mode returned, so that EOS is not pushed before them.
+ */
+static void
+gst_hailo_round_robin_wait_adaptive_drained(GstHailoRoundRobin *hailo_round_robin)
+{
+    std::unique_lock lock(*hailo_round_robin->adaptive_mutex);
+    hailo_round_robin->adaptive_cv->wait(lock, [hailo_round_robin]() {
+        if (!hailo_round_robin->adaptive_thread || hailo_round_robin->adaptive_stop.load(std::memory_order_acquire))
+            return true;
+        guint num_of_pads = hailo_round_robin->num_of_adaptive_pads.load(std::memory_order_acquire);
+        for (guint i = 0; i < num_of_pads; i++)
+        {
+            if (hailo_round_robin->adaptive_pads[i]->in_flight.load(std::memory_order_acquire) > 0)
+                return false;
+        }
+        return true;
+    });
+}
+
+static GstStructure *
+gst_hailo_round_robin_get_stats(GstHailoRoundRobin *hailo_round_robin)
+{
+    GstStructure *stats = gst_structure_new_empty("application/x-hailo-round-robin-stats");
+    guint num_of_pads = hailo_round_robin->num_of_adaptive_pads.load(std::memory_order_acquire);
+    for (guint i = 0; i < num_of_pads; i++)
+    {
+        HailoRoundRobinAdaptivePad *state = hailo_round_robin->adaptive_pads[i].get();
+        guint64 pushed = state->pushed.load(std::memory_order_relaxed);
+        guint64 total_latency = state->total_latency.load(std::memory_order_relaxed);
+        GstStructure *pad_stats = gst_structure_new("pad-stats",
+                                                    "pushed", G_TYPE_UINT64, pushed,
+                                                    "dropped", G_TYPE_UINT64, (guint64)state->dropped.load(std::memory_order_relaxed),
+                                                    "average-latency", G_TYPE_UINT64, (guint64)((pushed > 0) ? (total_latency / pushed) * GST_USECOND : 0),
+                                                    "max-latency", G_TYPE_UINT64, (guint64)(state->max_latency.load(std::memory_order_relaxed) * GST_USECOND),
+                                                    NULL);
+        std::string pad_name = "sink_" + std::to_string(i);
+        gst_structure_set(stats, pad_name.c_str(), GST_TYPE_STRUCTURE, pad_stats, NULL);
+        gst_structure_free(pad_stats);
+    }
+    return stats;
+}
+
 static void
 gst_hailo_round_robin_class_init(GstHailoRoundRobinClass *klass)
 {
@@ -359,7 +596,7 @@ gst_hailo_round_robin_class_init(GstHailoRoundRobinClass *klass)
                                     PROP_MODE,
                                     g_param_spec_enum("mode",
                                                       "mode",
-                                                      "Select the mode of the element (0 - funnel mode (push every buffer when it is ready), 1 - blocking mode (push every buffer when it is its pad's turn, and if the buffer is not ready, block until ready), 2 - non blocking mode(push every buffer when it is its pad's turn, and if the buffer is not ready, skip it))",
+                                                      "Select the mode of the element (0 - funnel mode (push every buffer when it is ready), 1 - blocking mode (push every buffer when it is its pad's turn, and if the buffer is not ready, block until ready), 2 - non blocking mode(push every buffer when it is its pad's turn, and if the buffer is not ready, skip it), 3 - adaptive mode (push the buffer with the earliest deadline first, and drop buffers of pads that are more than queue-size buffers behind))",
                                                       GST_TYPE_HAILOROUNDROBIN_MODE,
                                                       (gint)GST_HAILO_ROUND_ROBIN_MODE_BLOCKING,
                                                       (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
@@ -377,7 +614,7 @@ gst_hailo_round_robin_class_init(GstHailoRoundRobinClass *klass)
                                     PROP_QUEUE_SIZE,
                                     g_param_spec_uint("queue-size",
                                                       "Queue size",
-                                                      "Size of the queue for each pad (only relevant when using non-blocking mode)",
+                                                      "Size of the queue for each pad (only relevant when using non-blocking or adaptive mode)",
                                                       MIN_QUEUE_SIZE,
                                                       MAX_QUEUE_SIZE,
                                                       DEFAULT_QUEUE_SIZE,
@@ -400,6 +637,13 @@ gst_hailo_round_robin_class_init(GstHailoRoundRobinClass *klass)
                                                       MAX_PREROLL_FRAMES,
                                                       DEFAULT_PREROLL_FRAMES,
                                                       (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class,
+                                    PROP_STATS,
+                                    g_param_spec_boxed("stats",
+                                                       "Statistics",
+                                                       "Per sink pad statistics: pushed and dropped buffers, average and max latency in ns (only relevant when using adaptive mode)",
+                                                       GST_TYPE_STRUCTURE,
+                                                       (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
@@ -423,6 +667,15 @@ gst_hailo_round_robin_init(GstHailoRoundRobin *hailo_round_robin)
     hailo_round_robin->num_of_sink_pads = 0;
     hailo_round_robin->num_of_pads_mutex = std::make_unique<std::shared_mutex>();
     hailo_round_robin->counter_mutex = std::make_unique<std::shared_mutex>();
+    hailo_round_robin->adaptive_queue = std::make_unique<MpscQueue<HailoRoundRobinItem>>();
+    // Reserved up front, so that the scheduler thread may index pads while new pads are requested
+    hailo_round_robin->adaptive_pads.reserve(MAX_ADAPTIVE_PADS);
+    hailo_round_robin->num_of_adaptive_pads.store(0);
+    hailo_round_robin->adaptive_stop.store(false);
+    hailo_round_robin->adaptive_sleeping.store(false);
+    hailo_round_robin->adaptive_last_flow.store(GST_FLOW_OK);
+    hailo_round_robin->adaptive_mutex = std::make_unique<std::mutex>();
+    hailo_round_robin->adaptive_cv = std::make_unique<std::condition_variable>();
     gst_pad_use_fixed_caps(hailo_round_robin->srcpad);
     gst_element_add_pad(GST_ELEMENT(hailo_round_robin), hailo_round_robin->srcpad);
 }
@@ -440,6 +693,7 @@ gst_hailo_round_robin_dispose(GObject *object)
     hailo_round_robin->mutexes_non_blocking.clear();
     hailo_round_robin->condition_vars_blocking.clear();
     hailo_round_robin->condition_vars_non_blocking.clear();
+    gst_hailo_round_robin_stop_adaptive_scheduler(hailo_round_robin);
     G_OBJECT_CLASS(parent_class)->dispose(object);
 }
 
@@ -465,6 +719,12 @@ gst_hailo_round_robin_request_new_pad(GstElement *element, GstPadTemplate *templ
 
     std::string pad_name;
     std::shared_lock lock(*(hailo_round_robin->num_of_pads_mutex.get()));
+    if (hailo_round_robin->mode == GST_HAILO_ROUND_ROBIN_MODE_ADAPTIVE && hailo_round_robin->num_of_sink_pads >= MAX_ADAPTIVE_PADS)
+    {
+        GST_ERROR_OBJECT(element, "Adaptive mode supports up to %d sink pads", MAX_ADAPTIVE_PADS);
+        return NULL;
+    }
+    guint pad_num = hailo_round_robin->num_of_sink_pads;
     pad_name = "sink_" + std::to_string(hailo_round_robin->num_of_sink_pads);
     hailo_round_robin->num_of_sink_pads++;
     lock.unlock();
@@ -472,6 +732,9 @@ gst_hailo_round_robin_request_new_pad(GstElement *element, GstPadTemplate *templ
     sinkpad = GST_PAD_CAST(g_object_new(GST_TYPE_HAILO_ROUND_ROBIN_PAD,
                                         "name", pad_name.c_str(), "direction", templ->direction, "template", templ,
                                         NULL));
+    // Intern the pad name once, so stream meta of every buffer carries its index for free
+    GST_HAILO_ROUND_ROBIN_PAD_CAST(sinkpad)->stream_index = gst_hailo_stream_meta_intern(pad_name.c_str());
+    GST_HAILO_ROUND_ROBIN_PAD_CAST(sinkpad)->pad_num = pad_num;
 
     // Set sink_chain and sink_event funtions for the new pad
     switch (hailo_round_robin->mode)
@@ -492,6 +755,11 @@ gst_hailo_round_robin_request_new_pad(GstElement *element, GstPadTemplate *templ
         gst_pad_set_chain_function(sinkpad, GST_DEBUG_FUNCPTR(gst_hailo_round_robin_sink_chain_preroll));
         break;
     }
+    case GST_HAILO_ROUND_ROBIN_MODE_ADAPTIVE:
+    {
+        gst_pad_set_chain_function(sinkpad, GST_DEBUG_FUNCPTR(gst_hailo_round_robin_sink_chain_adaptive_mode));
+        break;
+    }
     }
 
     gst_pad_set_event_function(sinkpad,
@@ -507,6 +775,11 @@ gst_hailo_round_robin_request_new_pad(GstElement *element, GstPadTemplate *templ
     hailo_round_robin->pad_queues.emplace_back(std::make_unique<std::queue<GstBuffer *>>());
     hailo_round_robin->condition_vars_blocking.emplace_back(std::make_unique<std::condition_variable>());
     hailo_round_robin->condition_vars_non_blocking.emplace_back(std::make_unique<std::condition_variable>());
+    if (pad_num < MAX_ADAPTIVE_PADS)
+    {
+        hailo_round_robin->adaptive_pads.emplace_back(std::make_unique<HailoRoundRobinAdaptivePad>());
+        hailo_round_robin->num_of_adaptive_pads.store(hailo_round_robin->adaptive_pads.size(), std::memory_order_release);
+    }
 
     gst_pad_set_active(sinkpad, TRUE);
 
@@ -600,7 +873,7 @@ gst_hailo_round_robin_sink_chain_preroll(GstPad *pad, GstObject *parent, GstBuff
     gchar *stream_id = gst_pad_get_stream_id(pad);
 
     // Add stream meta to the buffer including the pad name and stream id.
-    gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
+    gst_buffer_add_hailo_stream_meta_full(buf, pad_name, stream_id, GST_HAILO_ROUND_ROBIN_PAD_CAST(pad)->stream_index);
 
     // Forward sticky events.
     gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
@@ -685,7 +958,7 @@ gst_hailo_round_robin_sink_chain_blocking_mode(GstPad *pad, GstObject *parent, G
     gchar *stream_id = gst_pad_get_stream_id(pad);
 
     // Add stream meta to the buffer including the pad name and stream id.
-    gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
+    gst_buffer_add_hailo_stream_meta_full(buf, pad_name, stream_id, GST_HAILO_ROUND_ROBIN_PAD_CAST(pad)->stream_index);
 
     // Forward sticky events.
     gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
@@ -720,7 +993,7 @@ gst_hailo_round_robin_sink_chain_funnel_mode(GstPad *pad, GstObject *parent, Gst
     gchar *stream_id = gst_pad_get_stream_id(pad);
 
     // Add stream meta to the buffer including the pad name and stream id.
-    gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
+    gst_buffer_add_hailo_stream_meta_full(buf, pad_name, stream_id, GST_HAILO_ROUND_ROBIN_PAD_CAST(pad)->stream_index);
 
     // Forward sticky events.
     gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
@@ -755,6 +1028,38 @@ gst_hailo_round_robin_sink_chain_non_blocking_mode(GstPad *pad, GstObject *paren
     return ret;
 }
 
+static GstFlowReturn
+gst_hailo_round_robin_sink_chain_adaptive_mode(GstPad *pad, GstObject *parent, GstBuffer *buf)
+{
+    GstHailoRoundRobin *hailo_round_robin = GST_HAILO_ROUND_ROBIN_CAST(parent);
+    guint pad_num = GST_HAILO_ROUND_ROBIN_PAD_CAST(pad)->pad_num;
+    HailoRoundRobinAdaptivePad *state = hailo_round_robin->adaptive_pads[pad_num].get();
+
+    // Don't block the source on a slow downstream, drop its buffer instead so latency stays bounded
+    if (state->queued.load(std::memory_order_acquire) >= hailo_round_robin->queue_size)
+    {
+        state->dropped.fetch_add(1, std::memory_order_relaxed);
+        gst_buffer_unref(buf);
+        return GST_FLOW_OK;
+    }
+
+    state->queued.fetch_add(1, std::memory_order_relaxed);
+    state->in_flight.fetch_add(1, std::memory_order_relaxed);
+    hailo_round_robin->adaptive_queue->push({buf, GST_PAD_CAST(gst_object_ref(pad)), pad_num, g_get_monotonic_time(),
+                                             state->flush_generation.load(std::memory_order_acquire)});
+
+    // Wake the scheduler thread up only if it is waiting for buffers
+    if (hailo_round_robin->adaptive_sleeping.load(std::memory_order_seq_cst))
+    {
+        std::lock_guard lock(*hailo_round_robin->adaptive_mutex);
+        hailo_round_robin->adaptive_cv->notify_all();
+    }
+
+    // Propagate downstream errors (e.g. flushing, not-linked) to the sources
+    GstFlowReturn ret = hailo_round_robin->adaptive_last_flow.load(std::memory_order_relaxed);
+    return (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_OK) ? ret : GST_FLOW_OK;
+}
+
 static gboolean
 gst_hailo_round_robin_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
 {
@@ -781,6 +1086,8 @@ gst_hailo_round_robin_sink_event(GstPad *pad, GstObject *parent, GstEvent *event
             hailo_round_robin->condition_vars_non_blocking[pad_num]->notify_all();
             forward = gst_hailo_round_robin_all_sinkpads_eos_unlocked(hailo_round_robin);
             GST_OBJECT_UNLOCK(hailo_round_robin);
+            if (forward && hailo_round_robin->mode == GST_HAILO_ROUND_ROBIN_MODE_ADAPTIVE)
+                gst_hailo_round_robin_wait_adaptive_drained(hailo_round_robin);
         }
         else if (pad_num != get_current_pad_num(hailo_round_robin))
         {
@@ -794,6 +1101,14 @@ gst_hailo_round_robin_sink_event(GstPad *pad, GstObject *parent, GstEvent *event
         GST_OBJECT_LOCK(hailo_round_robin);
         fpad->got_eos = FALSE;
         GST_OBJECT_UNLOCK(hailo_round_robin);
+        if (hailo_round_robin->mode == GST_HAILO_ROUND_ROBIN_MODE_ADAPTIVE)
+        {
+            // Drop the buffers queued before the flush, and stop reporting the flushing to the sources
+            hailo_round_robin->adaptive_pads[pad_num]->flush_generation.fetch_add(1, std::memory_order_acq_rel);
+            hailo_round_robin->adaptive_last_flow.store(GST_FLOW_OK, std::memory_order_relaxed);
+            std::lock_guard lock(*hailo_round_robin->adaptive_mutex);
+            hailo_round_robin->adaptive_cv->notify_all();
+        }
     }
 
     if (forward && GST_EVENT_IS_SERIALIZED(event))
@@ -832,6 +1147,12 @@ gst_hailo_round_robin_change_state(GstElement *element, GstStateChange transitio
 
     switch (transition)
     {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    {
+        if (hailo_round_robin->mode == GST_HAILO_ROUND_ROBIN_MODE_ADAPTIVE)
+            gst_hailo_round_robin_start_adaptive_scheduler(hailo_round_robin);
+        break;
+    }
     case GST_STATE_CHANGE_READY_TO_NULL:
     {
         if (hailo_round_robin->mode != GST_HAILO_ROUND_ROBIN_MODE_FUNNEL_MODE)
@@ -856,5 +1177,11 @@ gst_hailo_round_robin_change_state(GstElement *element, GstStateChange transitio
     }
     ret = GST_ELEMENT_CLASS(parent_class)->change_state(element, transition);
 
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY)
+    {
+        // Sink pads are inactive by now, no more buffers are enqueued
+        gst_hailo_round_robin_stop_adaptive_scheduler(hailo_round_robin);
+    }
+
     return ret;
 }
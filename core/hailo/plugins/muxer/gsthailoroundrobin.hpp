@@ -12,12 +12,17 @@
 #pragma once
 
 #include <gst/gst.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <queue>
 #include <mutex>
 #include <shared_mutex>
 #include <condition_variable>
 #include <pthread.h>
+#include "mpsc_queue.hpp"
 #include <thread>
 
 G_BEGIN_DECLS
@@ -42,8 +47,39 @@ typedef enum
     GST_HAILO_ROUND_ROBIN_MODE_FUNNEL_MODE = 0,
     GST_HAILO_ROUND_ROBIN_MODE_BLOCKING = 1,
     GST_HAILO_ROUND_ROBIN_MODE_NON_BLOCKING = 2,
+    GST_HAILO_ROUND_ROBIN_MODE_ADAPTIVE = 3,
 } GstHailoRoundRobinMode;
 
+/**
+ * A buffer waiting in adaptive mode.
+ */
+struct HailoRoundRobinItem
+{
+    GstBuffer *buffer;
+    GstPad *pad;
+    guint pad_num;
+    gint64 arrival_time;    // Monotonic time in us
+    guint flush_generation; // Of the pad when the buffer arrived
+};
+
+/**
+ * Per sink pad state of adaptive mode.
+ */
+struct HailoRoundRobinAdaptivePad
+{
+    std::deque<HailoRoundRobinItem> pending; // Scheduler thread only
+    gint64 last_arrival = 0;                 // Scheduler thread only
+    gint64 frame_interval = 0;               // Scheduler thread only, moving average in us
+    std::atomic<guint> queued{0};            // Buffers accepted from the pad and not pushed yet
+    std::atomic<guint> in_flight{0};         // Buffers accepted from the pad whose push didn't return yet
+    std::atomic<guint> flush_generation{0};  // Bumped on FLUSH_STOP, buffers of older generations are dropped
+    // Statistics
+    std::atomic<guint64> pushed{0};
+    std::atomic<guint64> dropped{0};
+    std::atomic<guint64> total_latency{0}; // us
+    std::atomic<guint64> max_latency{0};   // us
+};
+
 /**
  * GstHailoRoundRobin:
  *
@@ -71,6 +107,16 @@ struct _GstHailoRoundRobin
     std::thread *thread;
     gboolean stop_thread;
     std::unique_ptr<std::shared_mutex> current_pad_mutex;
+    // Adaptive mode
+    std::unique_ptr<MpscQueue<HailoRoundRobinItem>> adaptive_queue;
+    std::vector<std::unique_ptr<HailoRoundRobinAdaptivePad>> adaptive_pads;
+    std::atomic<guint> num_of_adaptive_pads;
+    std::unique_ptr<std::thread> adaptive_thread;
+    std::atomic<bool> adaptive_stop;
+    std::atomic<bool> adaptive_sleeping;
+    std::atomic<GstFlowReturn> adaptive_last_flow;
+    std::unique_ptr<std::mutex> adaptive_mutex;
+    std::unique_ptr<std::condition_variable> adaptive_cv;
 };
 
 struct _GstHailoRoundRobinClass
@@ -44,6 +44,7 @@ struct _GstHailoStreamRouterPad
     /* properties */
     const gchar *input_streams[GST_HAILO_STREAM_ROUTER_MAX_INPUT_PADS];
     /* < private > */
+    guint input_stream_indexes[GST_HAILO_STREAM_ROUTER_MAX_INPUT_PADS];
     guint num_input_streams;
     GMutex lock;
 };
@@ -133,8 +134,10 @@ gst_hailo_stream_router_init(GstHailoStreamRouter *hailo_stream_router)
 {
     // Configure sink pad
     hailo_stream_router->sinkpad = gst_pad_new_from_static_template(&sink_template, "sink");
-    // Initialize hash table (of key -> value: input stream name -> target src_pads)
-    hailo_stream_router->targets_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_array_unref);
+    // Routing tables are built once the src pads are configured
+    hailo_stream_router->routing_table.store(NULL);
+    hailo_stream_router->retired_tables = g_ptr_array_new();
+    hailo_stream_router->reader_table = NULL;
 
     // Initialize element mutex
     g_mutex_init(&hailo_stream_router->lock);
@@ -154,49 +157,97 @@ gst_hailo_stream_router_dispose(GObject *object)
     G_OBJECT_CLASS(parent_class)->dispose(object);
 }
 
-static gpointer
-gst_pads_lookup(GstHailoStreamRouter *hailo_stream_router, const gchar *input_pad_name)
+static void
+gst_hailo_stream_routing_table_free(GstHailoStreamRoutingTable *table)
 {
-    g_mutex_lock(&hailo_stream_router->lock);
-    gpointer pads_ptr;
-    pads_ptr = g_hash_table_lookup(hailo_stream_router->targets_table, (gpointer)input_pad_name);
-    g_mutex_unlock(&hailo_stream_router->lock);
-    return pads_ptr;
+    for (auto &targets : table->targets)
+    {
+        for (GstPad *pad : targets)
+            gst_object_unref(pad);
+    }
+    delete table;
 }
 
+/**
+ * Build a new routing table from the current src pads configuration and publish it.
+ * The streaming thread keeps using the previous table until it finishes its current buffer,
+ * so the previous table is retired and freed by the streaming thread itself (see get_routing_table).
+ */
 static void
-insert_new_srcpad_to_target_pads_table(GstHailoStreamRouter *hailo_stream_router, GstHailoStreamRouterPad *router_srcpad)
+gst_hailo_stream_router_update_routing_table(GstHailoStreamRouter *hailo_stream_router)
 {
-    // Iterate over the input stream names configured in the pad's properties
-    guint i;
-    for (i = 0; i < router_srcpad->num_input_streams; i++)
+    GstHailoStreamRoutingTable *table = new GstHailoStreamRoutingTable();
+
+    g_mutex_lock(&hailo_stream_router->lock);
+    GST_OBJECT_LOCK(hailo_stream_router);
+    // Iterate over the src_pads of the element
+    for (GList *item = GST_ELEMENT_CAST(hailo_stream_router)->srcpads; item; item = item->next)
     {
-        // Get the input stream name
-        const char *input_pad_name = router_srcpad->input_streams[i];
-        // Get the array of pads from the hash table
-        gpointer pads_ptr = gst_pads_lookup(hailo_stream_router, input_pad_name);
-        if (pads_ptr)
+        GstHailoStreamRouterPad *router_srcpad = GST_HAILO_STREAM_ROUTER_PAD(item->data);
+        g_mutex_lock(&router_srcpad->lock);
+        // Iterate over the input streams configured in the pad's properties
+        for (guint i = 0; i < router_srcpad->num_input_streams; i++)
         {
-            g_mutex_lock(&hailo_stream_router->lock);
-            // Add router_srcpad to the pads GArray
-            GArray *pads = (GArray *)pads_ptr;
-            g_array_append_val(pads, router_srcpad);
-
-            // Replace the pads GArray in the hash table with the new one
-            g_hash_table_replace(hailo_stream_router->targets_table, (gpointer)input_pad_name, (gpointer)pads);
-            g_mutex_unlock(&hailo_stream_router->lock);
+            guint stream_index = router_srcpad->input_stream_indexes[i];
+            if (stream_index >= table->targets.size())
+                table->targets.resize(stream_index + 1);
+            table->targets[stream_index].push_back(GST_PAD(gst_object_ref(router_srcpad)));
         }
-        else
+        g_mutex_unlock(&router_srcpad->lock);
+    }
+    GST_OBJECT_UNLOCK(hailo_stream_router);
+
+    GstHailoStreamRoutingTable *old_table = hailo_stream_router->routing_table.exchange(table, std::memory_order_acq_rel);
+    if (old_table != NULL)
+        g_ptr_array_add(hailo_stream_router->retired_tables, old_table);
+    g_mutex_unlock(&hailo_stream_router->lock);
+}
+
+/**
+ * Get the routing table for the current buffer, called only from the sink pad chain.
+ * Chain calls are serialized, so once the streaming thread sees a new table it no longer uses any
+ * of the retired ones, and it can free them. The lock is only taken after a reconfiguration.
+ */
+static GstHailoStreamRoutingTable *
+get_routing_table(GstHailoStreamRouter *hailo_stream_router)
+{
+    GstHailoStreamRoutingTable *table = hailo_stream_router->routing_table.load(std::memory_order_acquire);
+    if (G_UNLIKELY(table != hailo_stream_router->reader_table))
+    {
+        g_mutex_lock(&hailo_stream_router->lock);
+        GPtrArray *retired_tables = hailo_stream_router->retired_tables;
+        for (gint i = (gint)retired_tables->len - 1; i >= 0; i--)
         {
-            // Create a new GArray of pads and add router_srcpad to it
-            GArray *pads = g_array_sized_new(FALSE, FALSE, sizeof(GstHailoStreamRouterPad *), router_srcpad->num_input_streams);
-            g_mutex_lock(&hailo_stream_router->lock);
-            g_array_append_val(pads, router_srcpad);
-            // Add input_pad_name as key and GArray of pads as value to the hash table if both doesn't already exist
-            g_hash_table_insert(hailo_stream_router->targets_table, (gpointer)input_pad_name, (gpointer)pads);
-            g_mutex_unlock(&hailo_stream_router->lock);
+            // A newer table may have been published since the load above, keep using the loaded one
+            GstHailoStreamRoutingTable *retired_table = (GstHailoStreamRoutingTable *)g_ptr_array_index(retired_tables, i);
+            if (retired_table != table)
+            {
+                gst_hailo_stream_routing_table_free(retired_table);
+                g_ptr_array_remove_index_fast(retired_tables, i);
+            }
         }
+        g_mutex_unlock(&hailo_stream_router->lock);
+        hailo_stream_router->reader_table = table;
     }
+    return table;
+}
+
+/**
+ * Free all routing tables, the streaming thread must not be running.
+ */
+static void
+gst_hailo_stream_router_clear_routing_tables(GstHailoStreamRouter *hailo_stream_router)
+{
+    GstHailoStreamRoutingTable *table = hailo_stream_router->routing_table.exchange(NULL);
+    if (table != NULL)
+        gst_hailo_stream_routing_table_free(table);
+    if (hailo_stream_router->retired_tables != NULL)
+    {
+        for (guint i = 0; i < hailo_stream_router->retired_tables->len; i++)
+            gst_hailo_stream_routing_table_free((GstHailoStreamRoutingTable *)g_ptr_array_index(hailo_stream_router->retired_tables, i));
+        g_ptr_array_set_size(hailo_stream_router->retired_tables, 0);
+    }
+    hailo_stream_router->reader_table = NULL;
 }
 
 static void
@@ -220,12 +271,7 @@ gst_hailo_stream_router_reset(GstHailoStreamRouter *hailo_stream_router)
         hailo_stream_router->sinkpad = NULL;
     }
 
-    if (hailo_stream_router->targets_table != NULL)
-    {
-        g_hash_table_remove_all(hailo_stream_router->targets_table);
-        g_hash_table_unref(hailo_stream_router->targets_table);
-        hailo_stream_router->targets_table = NULL;
-    }
+    gst_hailo_stream_router_clear_routing_tables(hailo_stream_router);
     GST_OBJECT_UNLOCK(hailo_stream_router);
 
     GstIterator *it = NULL;
@@ -270,14 +316,8 @@ gst_hailo_stream_router_change_state(GstElement *element, GstStateChange transit
     {
     case GST_STATE_CHANGE_READY_TO_PAUSED:
     {
-        // Prepare hash table of pads (key -> value: input stream name -> target src_pads)
-        GList *item;
-        // Iterate over the src_pads of the element
-        for (item = element->srcpads; item; item = item->next)
-        {
-            GstHailoStreamRouterPad *router_srcpad = GST_HAILO_STREAM_ROUTER_PAD(item->data);
-            insert_new_srcpad_to_target_pads_table(hailo_stream_router, router_srcpad);
-        }
+        // Prepare the routing table (stream index -> target src_pads)
+        gst_hailo_stream_router_update_routing_table(hailo_stream_router);
         break;
     }
     case GST_STATE_CHANGE_PAUSED_TO_READY:
@@ -295,6 +335,8 @@ gst_hailo_stream_router_change_state(GstElement *element, GstStateChange transit
 void gst_hailo_stream_router_finalize(GObject *object)
 {
     GstHailoStreamRouter *stream_router = GST_HAILO_STREAM_ROUTER(object);
+    gst_hailo_stream_router_clear_routing_tables(stream_router);
+    g_ptr_array_unref(stream_router->retired_tables);
     g_mutex_clear(&stream_router->lock);
     G_OBJECT_CLASS(parent_class)->finalize(object);
 }
@@ -335,6 +377,7 @@ set_input_streams(GstHailoStreamRouterPad *current_pad, const GValue *value)
         {
             const GValue *val = gst_value_array_get_value(value, i);
             current_pad->input_streams[i] = g_strdup(g_value_get_string(val));
+            current_pad->input_stream_indexes[i] = gst_hailo_stream_meta_intern(current_pad->input_streams[i]);
         }
         current_pad->num_input_streams = len;
     }
@@ -389,6 +432,7 @@ gst_hailo_stream_router_pad_init(GstHailoStreamRouterPad *pad)
     for (i = 0; i < GST_HAILO_STREAM_ROUTER_MAX_INPUT_PADS; i++)
     {
         pad->input_streams[i] = "";
+        pad->input_stream_indexes[i] = GST_HAILO_STREAM_INDEX_NONE;
     }
 
     g_mutex_unlock(&pad->lock);
@@ -407,7 +451,8 @@ forward_events(GstPad *pad, GstEvent **event, gpointer user_data)
 
 /**
  * Chain method of the sink pad
- * On incomming buffer, get the target src_pad from the hash table, and forward the buffer to it.
+ * On incomming buffer, get the target src_pads from the routing table, and forward the buffer to them.
+ * The lookup is a single array index by the interned stream index, and takes no locks.
  *
  * @param pad  The sink pad
  * @param parent GstObject stream_router element
@@ -421,37 +466,55 @@ gst_hailo_stream_router_sink_chain(GstPad *pad, GstObject *parent, GstBuffer *bu
 
     GstFlowReturn result = GST_FLOW_OK;
 
-    // Get the input stream name from the stream metadata on the buffer
-    gchar *input_pad_name = gst_buffer_get_hailo_stream_meta(buffer)->pad_name;
+    // Get the input stream index from the stream metadata on the buffer
+    GstHailoStreamMeta *stream_meta = gst_buffer_get_hailo_stream_meta(buffer);
+    if (stream_meta == NULL)
+    {
+        GST_WARNING_OBJECT(stream_router, "Buffer without stream meta, dropping it");
+        gst_buffer_unref(buffer);
+        return result;
+    }
 
-    // Lookup for the input stream name key and get it's value (target pads array) from the hash table
-    gpointer pads_ptr = gst_pads_lookup(stream_router, input_pad_name);
-    if (pads_ptr)
+    // Lookup the target pads of the input stream
+    GstHailoStreamRoutingTable *table = get_routing_table(stream_router);
+    if (table == NULL || stream_meta->stream_index >= table->targets.size())
     {
-        guint i;
-        GArray *src_pads = (GArray *)pads_ptr;
-        GstHailoStreamRouterPad *src_pad;
-        // Iterate over the target src_pads
-        for (i = 0; i < src_pads->len; i++)
-        {
-            src_pad = (GstHailoStreamRouterPad *)g_array_index(src_pads, GstHailoStreamRouterPad *, i);
-            if (GST_IS_PAD(src_pad))
-            {
-                // Forward sticky events.
-                gst_pad_sticky_events_foreach(pad, forward_events, src_pad);
+        gst_buffer_unref(buffer);
+        return result;
+    }
 
-                GstBuffer *buffer_copy = gst_buffer_copy(buffer);
+    const std::vector<GstPad *> &src_pads = table->targets[stream_meta->stream_index];
+    // Iterate over the target src_pads
+    for (size_t i = 0; i < src_pads.size(); i++)
+    {
+        // Forward sticky events.
+        gst_pad_sticky_events_foreach(pad, forward_events, src_pads[i]);
 
-                // Push the buffer to the src_pad
-                result = gst_pad_push(GST_PAD(src_pad), buffer_copy);
-            }
-        }
+        // The last target gets the buffer itself, the others get a copy
+        GstBuffer *out_buffer = (i + 1 < src_pads.size()) ? gst_buffer_copy(buffer) : buffer;
+
+        // Push the buffer to the src_pad
+        result = gst_pad_push(src_pads[i], out_buffer);
     }
 
-    gst_buffer_unref(buffer);
+    if (src_pads.empty())
+        gst_buffer_unref(buffer);
     return result;
 }
 
+/**
+ * Publish a new routing table when the pad configuration changes while buffers may be in flight.
+ */
+static void
+gst_hailo_stream_router_pad_update_parent(GstHailoStreamRouterPad *pad)
+{
+    GstObject *parent = gst_object_get_parent(GST_OBJECT(pad));
+    if (parent == NULL)
+        return;
+    gst_hailo_stream_router_update_routing_table(GST_HAILO_STREAM_ROUTER(parent));
+    gst_object_unref(parent);
+}
+
 static void
 gst_hailo_stream_router_pad_set_property(GObject *object, guint prop_id,
                                          const GValue *value, GParamSpec *pspec)
@@ -465,6 +528,7 @@ gst_hailo_stream_router_pad_set_property(GObject *object, guint prop_id,
         g_mutex_lock(&pad->lock);
         set_input_streams(pad, value);
         g_mutex_unlock(&pad->lock);
+        gst_hailo_stream_router_pad_update_parent(pad);
         break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -528,6 +592,8 @@ gst_hailo_stream_router_release_pad(GstElement *element, GstPad *pad)
     GST_DEBUG_OBJECT(hailo_stream_router, "releasing pad %s:%s", GST_DEBUG_PAD_NAME(pad));
     gst_pad_set_active(pad, FALSE);
     gst_element_remove_pad(GST_ELEMENT_CAST(hailo_stream_router), pad);
+    // The previous routing table keeps a reference to the pad until it is retired
+    gst_hailo_stream_router_update_routing_table(hailo_stream_router);
 }
 
 /* GstChildProxy implementation - for using pad properties */
@@ -12,6 +12,7 @@
 #pragma once
 
 #include <gst/gst.h>
+#include <atomic>
 #include <vector>
 
 G_BEGIN_DECLS
@@ -33,6 +34,17 @@ G_BEGIN_DECLS
 typedef struct _GstHailoStreamRouter GstHailoStreamRouter;
 typedef struct _GstHailoStreamRouterClass GstHailoStreamRouterClass;
 
+/**
+ * GstHailoStreamRoutingTable:
+ *
+ * Immutable snapshot of the routing configuration: the target src pads of each input stream,
+ * indexed by the interned stream index carried in #GstHailoStreamMeta.
+ */
+typedef struct _GstHailoStreamRoutingTable
+{
+  std::vector<std::vector<GstPad *>> targets;
+} GstHailoStreamRoutingTable;
+
 /**
  * GstHailoStreamRouter:
  *
@@ -44,8 +56,14 @@ struct _GstHailoStreamRouter
   GstElement element;
 
   GstPad *sinkpad;
+  // Serializes routing table updates, never taken by the streaming thread
   GMutex lock;
-  GHashTable *targets_table;
+  // Current routing table, replaced as a whole on every reconfiguration
+  std::atomic<GstHailoStreamRoutingTable *> routing_table;
+  // Replaced tables that the streaming thread may still be using
+  GPtrArray *retired_tables;
+  // Last table used by the streaming thread, only accessed by it
+  GstHailoStreamRoutingTable *reader_table;
 };
 
 struct _GstHailoStreamRouterClass
@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file muxer/mpsc_queue.hpp
+ * @brief Unbounded lock-free multi-producer single-consumer queue.
+ *
+ * Intrusive linked list with a stub node (Vyukov). push() is wait-free and may be called from
+ * any number of threads, pop() must only be called from a single consumer thread.
+ * A pushed item may be briefly invisible to the consumer while its producer links it in,
+ * callers that sleep on an empty queue must therefore wake up periodically or be notified.
+ */
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : m_head(&m_stub), m_tail(&m_stub)
+    {
+        m_stub.next.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue()
+    {
+        T item;
+        while (pop(item))
+            ;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void push(T item)
+    {
+        push_node(new Node(std::move(item)));
+    }
+
+    /**
+     * @brief Whether the queue is empty, consumer thread only.
+     *        Returns false as soon as a producer started a push, even if pop() can't see the item yet.
+     */
+    bool empty() const
+    {
+        // Any node other than the stub holds an item that was not popped yet
+        if (m_tail != &m_stub)
+            return false;
+        return m_stub.next.load(std::memory_order_acquire) == nullptr && m_head.load(std::memory_order_seq_cst) == &m_stub;
+    }
+
+    /**
+     * @brief Pop the oldest item, consumer thread only.
+     * @return false if the queue is (momentarily) empty.
+     */
+    bool pop(T &item)
+    {
+        Node *tail = m_tail;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (tail == &m_stub)
+        {
+            if (next == nullptr)
+                return false;
+            // Skip the stub
+            m_tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr)
+        {
+            m_tail = next;
+            item = std::move(tail->value);
+            delete tail;
+            return true;
+        }
+        if (tail != m_head.load(std::memory_order_acquire))
+        {
+            // A producer is in the middle of a push
+            return false;
+        }
+        // Last item, put the stub back behind it so it can be detached
+        push_node(&m_stub);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != nullptr)
+        {
+            m_tail = next;
+            item = std::move(tail->value);
+            delete tail;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Node
+    {
+        Node() = default;
+        explicit Node(T &&item) : value(std::move(item)) {}
+        std::atomic<Node *> next{nullptr};
+        T value{};
+    };
+
+    void push_node(Node *node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node *prev = m_head.exchange(node, std::memory_order_seq_cst);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    Node m_stub;
+    std::atomic<Node *> m_head;
+    Node *m_tail; // Consumer only
+};
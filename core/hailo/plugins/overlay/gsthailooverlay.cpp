@@ -9,6 +9,9 @@
 #include "common/image.hpp"
 #include "overlay/overlay.hpp"
 #include "gst_hailo_meta.hpp"
+#include "rapidjson/document.h"
+#include "rapidjson/error/en.h"
+#include "rapidjson/filereadstream.h"
 #ifdef HAILO15_TARGET
 #include "buffer_utils.hpp"
 #endif
@@ -36,6 +39,24 @@ G_DEFINE_TYPE_WITH_CODE(GstHailoOverlay, gst_hailooverlay, GST_TYPE_BASE_TRANSFO
                         GST_DEBUG_CATEGORY_INIT(gst_hailooverlay_debug_category, "hailooverlay", 0,
                                                 "debug category for hailooverlay element"));
 
+#define GST_TYPE_HAILOOVERLAY_FACE_BLUR_MODE (gst_hailooverlay_face_blur_mode_get_type())
+static GType
+gst_hailooverlay_face_blur_mode_get_type(void)
+{
+    static GType face_blur_mode = 0;
+    static const GEnumValue hailooverlay_face_blur_modes[] = {
+        {ANONYMIZE_MODE_BLUR, "Box blur", "blur"},
+        {ANONYMIZE_MODE_PIXELATE, "Pixelate", "pixelate"},
+        {0, NULL, NULL},
+    };
+    if (!face_blur_mode)
+    {
+        face_blur_mode =
+            g_enum_register_static("GstHailoOverlayFaceBlurMode", hailooverlay_face_blur_modes);
+    }
+    return face_blur_mode;
+}
+
 enum
 {
     PROP_0,
@@ -43,9 +64,12 @@ enum
     PROP_FONT_THICKNESS,
     PROP_LANDMARK_POINT_RADIUS,
     PROP_FACE_BLUR,
+    PROP_FACE_BLUR_MODE,
+    PROP_FACE_BLUR_KERNEL_SIZE,
     PROP_SHOW_CONF,
     PROP_MASK_OVERLAY_N_THREADS,
     PROP_LOCAL_GALLERY,
+    PROP_PRIVACY_MASK_CONFIG,
 };
 
 static void
@@ -84,16 +108,28 @@ gst_hailooverlay_class_init(GstHailoOverlayClass *klass)
     g_object_class_install_property(gobject_class, PROP_FACE_BLUR,
                                     g_param_spec_boolean("face-blur", "face-blur", "Whether to blur faces", false,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_FACE_BLUR_MODE,
+                                    g_param_spec_enum("face-blur-mode", "face-blur-mode", "How faces are anonymized when face-blur is set. Chroma is anonymized as well for YUV formats.",
+                                                      GST_TYPE_HAILOOVERLAY_FACE_BLUR_MODE, ANONYMIZE_MODE_BLUR,
+                                                      (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_FACE_BLUR_KERNEL_SIZE,
+                                    g_param_spec_uint("face-blur-kernel-size", "face-blur-kernel-size", "Width of the blur kernel, or the pixelation block size, in pixels. The cost doesn't depend on it. Default 13.", 2, 2 * ANONYMIZE_MAX_RADIUS + 1, ANONYMIZE_DEFAULT_KERNEL_SIZE,
+                                                      (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     g_object_class_install_property(gobject_class, PROP_SHOW_CONF,
                                     g_param_spec_boolean("show-confidence", "show-confidence", "Whether to display confidence on detections, classifications etc...", true,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     // install property mask-overlay-n-threads uint default value 0
     g_object_class_install_property(gobject_class, PROP_MASK_OVERLAY_N_THREADS,
-                                    g_param_spec_uint("mask-overlay-n-threads", "mask-overlay-n-threads", "Number of threads to use for parallel mask drawing. Default 0 (Will use the default value OpenCV initializes - effected by the system capabilities).", 0, G_MAXUINT, 0,
+                                    g_param_spec_uint("mask-overlay-n-threads", "mask-overlay-n-threads", "Number of threads to use for parallel mask drawing and face blurring. Default 0 (Will use the default value OpenCV initializes - effected by the system capabilities).", 0, G_MAXUINT, 0,
                                                       (GParamFlags)(GST_PARAM_MUTABLE_READY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     g_object_class_install_property(gobject_class, PROP_LOCAL_GALLERY,
                                     g_param_spec_boolean("local-gallery", "local-gallery", "Whether to display Identified and UnIdentified ROI's taken from the local gallery, as well as the Global ID they receive.", false,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_PRIVACY_MASK_CONFIG,
+                                    g_param_spec_string("privacy-mask-config", "privacy-mask-config", "Path to a JSON file of polygon privacy masks, drawn over everything else. "
+                                                                                                      "Setting it while playing swaps the masks in from the next frame. Default none.",
+                                                        NULL,
+                                                        (GParamFlags)(GST_PARAM_MUTABLE_PLAYING | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     g_object_class_install_property(gobject_class, PROP_LANDMARK_POINT_RADIUS,
                                     g_param_spec_float("landmark-point-radius", "landmark-point-radius", "The radius of the points when drawing landmarks. Default 3.", 0, G_MAXFLOAT, 3,
                                                        (GParamFlags)(GST_PARAM_MUTABLE_READY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
@@ -112,10 +148,85 @@ gst_hailooverlay_init(GstHailoOverlay *hailooverlay)
     hailooverlay->line_thickness = 1;
     hailooverlay->font_thickness = 1;
     hailooverlay->face_blur = false;
+    hailooverlay->face_blur_mode = ANONYMIZE_MODE_BLUR;
+    hailooverlay->face_blur_kernel_size = ANONYMIZE_DEFAULT_KERNEL_SIZE;
     hailooverlay->show_confidence = true;
     hailooverlay->local_gallery = false;
     hailooverlay->landmark_point_radius = 3;
     hailooverlay->mask_overlay_n_threads = 0;
+    hailooverlay->privacy_mask_config = NULL;
+    hailooverlay->privacy_masks = new PrivacyMaskRenderer();
+}
+
+/**
+ * @brief Read a privacy mask config file, in the format of the webserver privacy mask resource:
+ *        {"global_enable": true, "mode": "fill" | "pixelate", "color": [r, g, b], "block_size": 16,
+ *         "masks": [{"id": "...", "status": true, "Polygon": [{"x": 0, "y": 0}, ...]}, ...]}
+ *        Coordinates are frame pixels, masks with status false (or global_enable false) are skipped.
+ *
+ * @throw std::runtime_error if the file can't be read or parsed, or mode, color or block_size are invalid.
+ */
+static PrivacyMaskConfigPtr load_privacy_mask_config(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == nullptr)
+        throw std::runtime_error(std::string("Privacy mask config file can't be opened: ") + path);
+    char read_buffer[4096];
+    rapidjson::FileReadStream stream(file, read_buffer, sizeof(read_buffer));
+    rapidjson::Document doc;
+    doc.ParseStream(stream);
+    fclose(file);
+    if (doc.HasParseError() || !doc.IsObject())
+        throw std::runtime_error(std::string("Privacy mask config is not valid JSON: ") + rapidjson::GetParseError_En(doc.GetParseError()));
+
+    auto config = std::make_shared<PrivacyMaskConfig>();
+    if (doc.HasMember("mode"))
+    {
+        const rapidjson::Value &mode = doc["mode"];
+        if (!mode.IsString() || (std::string(mode.GetString()) != "fill" && std::string(mode.GetString()) != "pixelate"))
+            throw std::runtime_error("Privacy mask config mode must be \"fill\" or \"pixelate\"");
+        config->mode = std::string(mode.GetString()) == "pixelate" ? PRIVACY_MASK_MODE_PIXELATE : PRIVACY_MASK_MODE_FILL;
+    }
+    if (doc.HasMember("color"))
+    {
+        const rapidjson::Value &color = doc["color"];
+        if (!color.IsArray() || color.Size() != 3)
+            throw std::runtime_error("Privacy mask config color must be an array of 3 values");
+        int channels[3];
+        for (rapidjson::SizeType i = 0; i < 3; i++)
+        {
+            if (!color[i].IsInt() || color[i].GetInt() < 0 || color[i].GetInt() > 255)
+                throw std::runtime_error("Privacy mask config color values must be integers between 0 and 255");
+            channels[i] = color[i].GetInt();
+        }
+        config->color = cv::Scalar(channels[0], channels[1], channels[2]);
+    }
+    if (doc.HasMember("block_size"))
+    {
+        if (!doc["block_size"].IsInt() || doc["block_size"].GetInt() < 1)
+            throw std::runtime_error("Privacy mask config block_size must be a positive integer");
+        config->block_size = doc["block_size"].GetInt();
+    }
+    if (doc.HasMember("global_enable") && doc["global_enable"].IsBool() && !doc["global_enable"].GetBool())
+        return config;
+    if (!doc.HasMember("masks") || !doc["masks"].IsArray())
+        return config;
+    for (const auto &mask : doc["masks"].GetArray())
+    {
+        if (mask.HasMember("status") && mask["status"].IsBool() && !mask["status"].GetBool())
+            continue;
+        if (!mask.HasMember("Polygon") || !mask["Polygon"].IsArray())
+            continue;
+        std::vector<cv::Point> polygon;
+        for (const auto &point : mask["Polygon"].GetArray())
+        {
+            if (point.HasMember("x") && point.HasMember("y") && point["x"].IsNumber() && point["y"].IsNumber())
+                polygon.emplace_back(cvRound(point["x"].GetDouble()), cvRound(point["y"].GetDouble()));
+        }
+        if (polygon.size() >= 3)
+            config->polygons.push_back(polygon);
+    }
+    return config;
 }
 
 void gst_hailooverlay_set_property(GObject *object, guint property_id,
@@ -139,6 +250,12 @@ void gst_hailooverlay_set_property(GObject *object, guint property_id,
     case PROP_FACE_BLUR:
         hailooverlay->face_blur = g_value_get_boolean(value);
         break;
+    case PROP_FACE_BLUR_MODE:
+        hailooverlay->face_blur_mode = (anonymize_mode_t)g_value_get_enum(value);
+        break;
+    case PROP_FACE_BLUR_KERNEL_SIZE:
+        hailooverlay->face_blur_kernel_size = g_value_get_uint(value);
+        break;
     case PROP_SHOW_CONF:
         hailooverlay->show_confidence = g_value_get_boolean(value);
         break;
@@ -148,6 +265,31 @@ void gst_hailooverlay_set_property(GObject *object, guint property_id,
     case PROP_LOCAL_GALLERY:
         hailooverlay->local_gallery = g_value_get_boolean(value);
         break;
+    case PROP_PRIVACY_MASK_CONFIG:
+    {
+        const gchar *path = g_value_get_string(value);
+        if (path == NULL || path[0] == '\0')
+        {
+            // No masks
+            hailooverlay->privacy_masks->set_config(nullptr);
+        }
+        else
+        {
+            try
+            {
+                hailooverlay->privacy_masks->set_config(load_privacy_mask_config(path));
+            }
+            catch (const std::exception &e)
+            {
+                // The current masks stay in place
+                GST_ELEMENT_WARNING(hailooverlay, RESOURCE, READ, ("Failed to load privacy masks"), ("%s", e.what()));
+                break;
+            }
+        }
+        g_free(hailooverlay->privacy_mask_config);
+        hailooverlay->privacy_mask_config = g_value_dup_string(value);
+        break;
+    }
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -175,12 +317,21 @@ void gst_hailooverlay_get_property(GObject *object, guint property_id,
     case PROP_FACE_BLUR:
         g_value_set_boolean(value, hailooverlay->face_blur);
         break;
+    case PROP_FACE_BLUR_MODE:
+        g_value_set_enum(value, hailooverlay->face_blur_mode);
+        break;
+    case PROP_FACE_BLUR_KERNEL_SIZE:
+        g_value_set_uint(value, hailooverlay->face_blur_kernel_size);
+        break;
     case PROP_SHOW_CONF:
         g_value_set_boolean(value, hailooverlay->show_confidence);
         break;
     case PROP_LOCAL_GALLERY:
         g_value_set_boolean(value, hailooverlay->local_gallery);
         break;
+    case PROP_PRIVACY_MASK_CONFIG:
+        g_value_set_string(value, hailooverlay->privacy_mask_config);
+        break;
     case PROP_MASK_OVERLAY_N_THREADS:
         g_value_set_uint(value, hailooverlay->mask_overlay_n_threads);
         break;
@@ -206,6 +357,10 @@ void gst_hailooverlay_finalize(GObject *object)
     GST_DEBUG_OBJECT(hailooverlay, "finalize");
 
     /* clean up object here */
+    g_free(hailooverlay->privacy_mask_config);
+    hailooverlay->privacy_mask_config = NULL;
+    delete hailooverlay->privacy_masks;
+    hailooverlay->privacy_masks = nullptr;
 
     G_OBJECT_CLASS(gst_hailooverlay_parent_class)->finalize(object);
 }
@@ -267,10 +422,12 @@ gst_hailooverlay_transform_ip(GstBaseTransform *trans,
         // Blur faces if face-blur is activated.
         if (hailooverlay->face_blur)
         {
-            face_blur(*hmat.get(), hailo_roi);
+            face_blur(*hmat.get(), hailo_roi, {hailooverlay->face_blur_mode, (int)hailooverlay->face_blur_kernel_size}, hailooverlay->mask_overlay_n_threads);
         }
         // Draw all results of the given roi on mat.
         ret = draw_all(*hmat.get(), hailo_roi, hailooverlay->landmark_point_radius, hailooverlay->show_confidence, hailooverlay->local_gallery, hailooverlay->mask_overlay_n_threads);
+        // Privacy masks go last, so nothing drawn shows through them
+        hailooverlay->privacy_masks->apply(*hmat.get());
     }
     if (ret != OVERLAY_STATUS_OK)
     {
@@ -7,6 +7,8 @@
 #include <gst/base/gstbasetransform.h>
 #include <vector>
 #include "hailo_objects.hpp"
+#include "common/region_anonymizer.hpp"
+#include "overlay/privacy_mask.hpp"
 
 G_BEGIN_DECLS
 
@@ -26,9 +28,13 @@ struct _GstHailoOverlay
     gint font_thickness;
     gfloat landmark_point_radius;
     gboolean face_blur;
+    anonymize_mode_t face_blur_mode;
+    guint face_blur_kernel_size;
     gboolean show_confidence;
     gboolean local_gallery;
     guint mask_overlay_n_threads;
+    gchar *privacy_mask_config;
+    PrivacyMaskRenderer *privacy_masks;
 };
 
 struct _GstHailoOverlayClass
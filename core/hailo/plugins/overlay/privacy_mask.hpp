@@ -0,0 +1,377 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file overlay/privacy_mask.hpp
+ * @brief Polygon privacy masks drawn on the CPU, for pipelines that don't have the media library masking.
+ *
+ * The polygons are rasterized into run-length spans (per row, the [x0, x1) ranges inside any polygon) once
+ * per configuration and frame geometry, at the resolution of every plane. Per frame, only the spans are
+ * walked, so the cost is proportional to the masked pixels and doesn't depend on the number of vertices.
+ * Masked pixels are either filled with a color or pixelated with a block grid aligned to the frame,
+ * which keeps the blocks still while the image under them moves.
+ *
+ * The configuration can be replaced from any thread while frames are being drawn: it is an immutable
+ * object swapped atomically, and the drawing thread rasterizes the new one before its next frame.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "common/hailomat.hpp"
+#include "common/region_anonymizer.hpp"
+
+#define PRIVACY_MASK_DEFAULT_BLOCK_SIZE 16
+
+typedef enum
+{
+    PRIVACY_MASK_MODE_FILL = 0,
+    PRIVACY_MASK_MODE_PIXELATE = 1,
+} privacy_mask_mode_t;
+
+struct PrivacyMaskConfig
+{
+    std::vector<std::vector<cv::Point>> polygons; // In frame pixels
+    privacy_mask_mode_t mode = PRIVACY_MASK_MODE_FILL;
+    cv::Scalar color = cv::Scalar(0, 0, 0);       // RGB, converted for YUV frames
+    int block_size = PRIVACY_MASK_DEFAULT_BLOCK_SIZE; // Pixelation block size, in luma pixels
+};
+using PrivacyMaskConfigPtr = std::shared_ptr<const PrivacyMaskConfig>;
+
+struct PrivacyMaskSpan
+{
+    int x0;
+    int x1; // Exclusive
+};
+
+/**
+ * @brief The masked pixels of one plane. The spans of row y are spans[row_start[y]] to spans[row_start[y + 1]],
+ *        sorted and not overlapping.
+ */
+struct PrivacyMaskSpans
+{
+    int width = 0;
+    int height = 0;
+    int subsample_x = 1;
+    int subsample_y = 1;
+    std::vector<uint32_t> row_start;
+    std::vector<PrivacyMaskSpan> spans;
+    size_t pixels = 0;
+};
+
+namespace privacy_mask
+{
+    /**
+     * @brief Rasterize polygons into spans, at the resolution of a plane subsampled from the frame.
+     *        A pixel is masked if its center is inside a polygon (even-odd rule), polygons are merged.
+     *
+     * @param polygons The polygons, in frame pixels.
+     * @param width Samples in a row of the plane.
+     * @param height Rows of the plane.
+     * @param subsample_x Frame pixels per sample, horizontally.
+     * @param subsample_y Frame rows per row.
+     * @return PrivacyMaskSpans
+     */
+    inline PrivacyMaskSpans rasterize(const std::vector<std::vector<cv::Point>> &polygons, int width, int height,
+                                      int subsample_x = 1, int subsample_y = 1)
+    {
+        struct RowSpan
+        {
+            int y;
+            PrivacyMaskSpan span;
+        };
+        std::vector<RowSpan> row_spans;
+        // (row, first sample right of the crossing) for every edge crossing the center line of a row
+        std::vector<std::pair<int, int>> crossings;
+        // Exact integer arithmetic in units of half a frame pixel, so centers lying on an edge are decided consistently:
+        // the center of sample x of a plane is at (2x + 1) * subsample_x, of row y at (2y + 1) * subsample_y
+        auto ceil_div = [](int64_t num, int64_t den)
+        { return static_cast<int>(num >= 0 ? (num + den - 1) / den : -((-num) / den)); };
+
+        for (const std::vector<cv::Point> &polygon : polygons)
+        {
+            if (polygon.size() < 3)
+                continue;
+            crossings.clear();
+            for (size_t i = 0; i < polygon.size(); i++)
+            {
+                cv::Point a = polygon[i];
+                cv::Point b = polygon[(i + 1) % polygon.size()];
+                if (a.y == b.y)
+                    continue; // Horizontal edges never cross a center line
+                if (a.y > b.y)
+                    std::swap(a, b);
+                // Rows whose center is in [a.y, b.y), so a vertex shared by two edges is counted once
+                int first = std::max(ceil_div(2 * a.y - subsample_y, 2 * subsample_y), 0);
+                int last = std::min(ceil_div(2 * b.y - subsample_y, 2 * subsample_y), height);
+                int64_t dy = 2 * (b.y - a.y);
+                for (int y = first; y < last; y++)
+                {
+                    // The crossing is at x = num / dy, the first sample whose center is at or right of it starts inside
+                    int64_t num = 2 * static_cast<int64_t>(a.x) * dy + 2 * static_cast<int64_t>(b.x - a.x) * ((2 * y + 1) * subsample_y - 2 * a.y);
+                    crossings.emplace_back(y, ceil_div(num - subsample_x * dy, 2 * subsample_x * dy));
+                }
+            }
+            std::sort(crossings.begin(), crossings.end());
+            for (size_t i = 0; i + 1 < crossings.size(); i += 2)
+            {
+                int x0 = std::max(crossings[i].second, 0);
+                int x1 = std::min(crossings[i + 1].second, width);
+                if (x0 < x1)
+                    row_spans.push_back({crossings[i].first, {x0, x1}});
+            }
+        }
+
+        std::sort(row_spans.begin(), row_spans.end(), [](const RowSpan &a, const RowSpan &b)
+                  { return a.y != b.y ? a.y < b.y : a.span.x0 < b.span.x0; });
+
+        PrivacyMaskSpans result;
+        result.width = width;
+        result.height = height;
+        result.subsample_x = subsample_x;
+        result.subsample_y = subsample_y;
+        std::vector<uint32_t> row_count(height, 0);
+        int row = -1;
+        for (const RowSpan &row_span : row_spans)
+        {
+            // Spans of a row that overlap or touch (overlapping polygons) are merged
+            if (row_span.y == row && row_span.span.x0 <= result.spans.back().x1)
+            {
+                result.spans.back().x1 = std::max(result.spans.back().x1, row_span.span.x1);
+                continue;
+            }
+            result.spans.push_back(row_span.span);
+            row_count[row_span.y]++;
+            row = row_span.y;
+        }
+        result.row_start.assign(height + 1, 0);
+        for (int y = 0; y < height; y++)
+            result.row_start[y + 1] = result.row_start[y] + row_count[y];
+        for (const PrivacyMaskSpan &span : result.spans)
+            result.pixels += span.x1 - span.x0;
+        return result;
+    }
+
+    template <int STEP>
+    void fill(const AnonymizePlane &plane, const PrivacyMaskSpans &spans, uint8_t value)
+    {
+        for (int y = 0; y < spans.height; y++)
+        {
+            uint8_t *row = plane.data + static_cast<size_t>(y) * plane.stride;
+            for (uint32_t i = spans.row_start[y]; i < spans.row_start[y + 1]; i++)
+            {
+                if (STEP == 1)
+                {
+                    std::fill(row + spans.spans[i].x0, row + spans.spans[i].x1, value);
+                    continue;
+                }
+                for (int x = spans.spans[i].x0; x < spans.spans[i].x1; x++)
+                    row[x * STEP] = value;
+            }
+        }
+    }
+
+    /**
+     * @brief Replace the masked pixels of every block of the plane with the average of its masked pixels.
+     *        sums and counts hold a zero per block column, and are left zeroed.
+     */
+    template <int STEP>
+    void pixelate(const AnonymizePlane &plane, const PrivacyMaskSpans &spans, int block_x, int block_y,
+                  std::vector<uint32_t> &sums, std::vector<uint32_t> &counts)
+    {
+        for (int block_top = 0; block_top < spans.height; block_top += block_y)
+        {
+            int block_bottom = std::min(block_top + block_y, spans.height);
+            if (spans.row_start[block_top] == spans.row_start[block_bottom])
+                continue;
+            for (int pass = 0; pass < 2; pass++)
+            {
+                // The first pass sums the masked pixels of each block, the second writes the averages
+                for (int y = block_top; y < block_bottom; y++)
+                {
+                    uint8_t *row = plane.data + static_cast<size_t>(y) * plane.stride;
+                    for (uint32_t i = spans.row_start[y]; i < spans.row_start[y + 1]; i++)
+                    {
+                        for (int x0 = spans.spans[i].x0; x0 < spans.spans[i].x1;)
+                        {
+                            int block = x0 / block_x;
+                            int x1 = std::min((block + 1) * block_x, spans.spans[i].x1);
+                            if (pass == 0)
+                            {
+                                uint32_t sum = 0;
+                                for (int x = x0; x < x1; x++)
+                                    sum += row[x * STEP];
+                                sums[block] += sum;
+                                counts[block] += x1 - x0;
+                            }
+                            else
+                            {
+                                uint8_t value = static_cast<uint8_t>((sums[block] + counts[block] / 2) / counts[block]);
+                                for (int x = x0; x < x1; x++)
+                                    row[x * STEP] = value;
+                            }
+                            x0 = x1;
+                        }
+                    }
+                }
+            }
+            // Zero the blocks this block row used, instead of all of them
+            for (int y = block_top; y < block_bottom; y++)
+            {
+                for (uint32_t i = spans.row_start[y]; i < spans.row_start[y + 1]; i++)
+                {
+                    int first = spans.spans[i].x0 / block_x;
+                    int last = (spans.spans[i].x1 - 1) / block_x;
+                    std::fill(sums.begin() + first, sums.begin() + last + 1, 0);
+                    std::fill(counts.begin() + first, counts.begin() + last + 1, 0);
+                }
+            }
+        }
+    }
+} // namespace privacy_mask
+
+/**
+ * @brief Draws the privacy masks of the current configuration on frames.
+ *        set_config can be called from any thread, apply from a single (streaming) thread.
+ */
+class PrivacyMaskRenderer
+{
+private:
+    PrivacyMaskConfigPtr m_config;
+
+    // Owned by the drawing thread: the spans of the last rasterized configuration, per plane
+    PrivacyMaskConfigPtr m_rasterized_config;
+    std::vector<PrivacyMaskSpans> m_spans;
+    std::vector<uint32_t> m_block_sums;
+    std::vector<uint32_t> m_block_counts;
+    uint64_t m_rasterize_count = 0;
+
+    bool spans_match(const std::vector<AnonymizePlane> &planes, const PrivacyMaskConfigPtr &config) const
+    {
+        if (config != m_rasterized_config || planes.size() != m_spans.size())
+            return false;
+        for (size_t i = 0; i < planes.size(); i++)
+        {
+            if (planes[i].width != m_spans[i].width || planes[i].height != m_spans[i].height ||
+                planes[i].subsample_x != m_spans[i].subsample_x || planes[i].subsample_y != m_spans[i].subsample_y)
+                return false;
+        }
+        return true;
+    }
+
+    void rasterize(const std::vector<AnonymizePlane> &planes, const PrivacyMaskConfigPtr &config)
+    {
+        m_spans.clear();
+        size_t widest = 0;
+        for (const AnonymizePlane &plane : planes)
+        {
+            // Planes of the same geometry (U and V) share their spans
+            if (!m_spans.empty() && m_spans.back().width == plane.width && m_spans.back().height == plane.height &&
+                m_spans.back().subsample_x == plane.subsample_x && m_spans.back().subsample_y == plane.subsample_y)
+                m_spans.push_back(m_spans.back());
+            else
+                m_spans.push_back(privacy_mask::rasterize(config->polygons, plane.width, plane.height, plane.subsample_x, plane.subsample_y));
+            widest = std::max(widest, static_cast<size_t>(plane.width));
+        }
+        m_block_sums.assign(widest, 0);
+        m_block_counts.assign(widest, 0);
+        m_rasterized_config = config;
+        m_rasterize_count++;
+    }
+
+public:
+    void set_config(PrivacyMaskConfigPtr config)
+    {
+        std::atomic_store(&m_config, config);
+    }
+
+    PrivacyMaskConfigPtr get_config() const
+    {
+        return std::atomic_load(&m_config);
+    }
+
+    // Number of times the polygons were rasterized, only on configuration or frame geometry changes
+    uint64_t get_rasterize_count() const
+    {
+        return m_rasterize_count;
+    }
+
+    /**
+     * @brief Draw the masks on planes of a frame.
+     *
+     * @param planes The channels of the frame, RGB or YUV order.
+     * @param yuv Whether the planes are Y, U and V (the color is converted).
+     */
+    void apply(const std::vector<AnonymizePlane> &planes, bool yuv)
+    {
+        PrivacyMaskConfigPtr config = get_config();
+        if (!config || config->polygons.empty() || planes.empty())
+            return;
+        if (!spans_match(planes, config))
+            rasterize(planes, config);
+
+        cv::Scalar color = config->color;
+        if (yuv)
+            color = cv::Scalar(RGB2Y(config->color[0], config->color[1], config->color[2]),
+                               RGB2U(config->color[0], config->color[1], config->color[2]),
+                               RGB2V(config->color[0], config->color[1], config->color[2]));
+        for (size_t i = 0; i < planes.size(); i++)
+        {
+            const AnonymizePlane &plane = planes[i];
+            const PrivacyMaskSpans &spans = m_spans[i];
+            if (spans.pixels == 0)
+                continue;
+            if (config->mode == PRIVACY_MASK_MODE_FILL)
+            {
+                uint8_t value = static_cast<uint8_t>(color[std::min<size_t>(i, 2)]);
+                switch (plane.step)
+                {
+                case 1:
+                    privacy_mask::fill<1>(plane, spans, value);
+                    break;
+                case 2:
+                    privacy_mask::fill<2>(plane, spans, value);
+                    break;
+                case 3:
+                    privacy_mask::fill<3>(plane, spans, value);
+                    break;
+                case 4:
+                    privacy_mask::fill<4>(plane, spans, value);
+                    break;
+                default:
+                    break;
+                }
+                continue;
+            }
+            int block_x = std::max(config->block_size / plane.subsample_x, 1);
+            int block_y = std::max(config->block_size / plane.subsample_y, 1);
+            switch (plane.step)
+            {
+            case 1:
+                privacy_mask::pixelate<1>(plane, spans, block_x, block_y, m_block_sums, m_block_counts);
+                break;
+            case 2:
+                privacy_mask::pixelate<2>(plane, spans, block_x, block_y, m_block_sums, m_block_counts);
+                break;
+            case 3:
+                privacy_mask::pixelate<3>(plane, spans, block_x, block_y, m_block_sums, m_block_counts);
+                break;
+            case 4:
+                privacy_mask::pixelate<4>(plane, spans, block_x, block_y, m_block_sums, m_block_counts);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void apply(HailoMat &hmat)
+    {
+        hailo_mat_t type = hmat.get_type();
+        apply(hmat.get_anonymize_planes(), type == HAILO_MAT_NV12 || type == HAILO_MAT_YUY2);
+    }
+};
@@ -159,18 +159,17 @@ static void gst_hailotileaggregator_get_property(GObject *object, guint prop_id,
  */
 static void remove_large_landscape(HailoROIPtr hailo_roi, int &frame_width, int &frame_height)
 {
-    auto detections = hailo_common::get_hailo_detections(hailo_roi);
-    for (const HailoDetectionPtr &detection : detections)
-    {
-        HailoBBox bbox = detection->get_bbox();
-        float width = bbox.width() * frame_width;
-        float height = bbox.height() * frame_height;
-
-        bool is_landscape_mask = (width >= (height * LARGE_LANDSCAPE_MASK_WIDTH_HEIGHT_RATIO));
-        bool is_landscape_size_mask = (((width * height) / (frame_height * frame_width)) > LARGE_LANDSCAPE_MASK_SIZE);
-        if (is_landscape_mask && is_landscape_size_mask)
-            hailo_roi->remove_object(detection);
-    }
+    hailo_roi->remove_objects_if([frame_width, frame_height](const HailoObjectPtr &obj)
+                                 {
+                                     if (obj->get_type() != HAILO_DETECTION)
+                                         return false;
+                                     HailoBBox bbox = std::dynamic_pointer_cast<HailoDetection>(obj)->get_bbox();
+                                     float width = bbox.width() * frame_width;
+                                     float height = bbox.height() * frame_height;
+
+                                     bool is_landscape_mask = (width >= (height * LARGE_LANDSCAPE_MASK_WIDTH_HEIGHT_RATIO));
+                                     bool is_landscape_size_mask = (((width * height) / (frame_height * frame_width)) > LARGE_LANDSCAPE_MASK_SIZE);
+                                     return is_landscape_mask && is_landscape_size_mask; });
 }
 
 /**
@@ -183,20 +182,18 @@ static void remove_large_landscape(HailoROIPtr hailo_roi, int &frame_width, int
  */
 static void remove_exceeded_bboxes(HailoTileROIPtr hailo_tile_roi, float border_threshold)
 {
-    auto detections = hailo_common::get_hailo_detections(hailo_tile_roi);
     HailoBBox tile_bbox = hailo_tile_roi->get_bbox();
 
-    for (const HailoDetectionPtr &detection : detections)
-    {
-        HailoBBox bbox = detection->get_bbox();
-        bool exceed_xmin = (tile_bbox.xmin() != 0 && bbox.xmin() < border_threshold);
-        bool exceed_xmax = (tile_bbox.xmax() != 1 && (1 - bbox.xmax()) < border_threshold);
-        bool exceed_ymin = (tile_bbox.ymin() != 0 && bbox.ymin() < border_threshold);
-        bool exceed_ymax = (tile_bbox.ymax() != 1 && (1 - bbox.ymax()) < border_threshold);
-
-        if (exceed_xmin || exceed_xmax || exceed_ymin || exceed_ymax)
-            hailo_tile_roi->remove_object(detection);
-    }
+    hailo_tile_roi->remove_objects_if([&tile_bbox, border_threshold](const HailoObjectPtr &obj)
+                                      {
+                                          if (obj->get_type() != HAILO_DETECTION)
+                                              return false;
+                                          HailoBBox bbox = std::dynamic_pointer_cast<HailoDetection>(obj)->get_bbox();
+                                          bool exceed_xmin = (tile_bbox.xmin() != 0 && bbox.xmin() < border_threshold);
+                                          bool exceed_xmax = (tile_bbox.xmax() != 1 && (1 - bbox.xmax()) < border_threshold);
+                                          bool exceed_ymin = (tile_bbox.ymin() != 0 && bbox.ymin() < border_threshold);
+                                          bool exceed_ymax = (tile_bbox.ymax() != 1 && (1 - bbox.ymax()) < border_threshold);
+                                          return exceed_xmin || exceed_xmax || exceed_ymin || exceed_ymax; });
 }
 
 static void
@@ -270,6 +267,7 @@ void nms(HailoROIPtr hailo_roi, const float iou_thr)
               [](HailoDetectionPtr a, HailoDetectionPtr b)
               { return a->get_confidence() > b->get_confidence(); });
 
+    std::vector<HailoObjectPtr> suppressed;
     for (uint index = 0; index < objects.size(); index++)
     {
         for (uint jindex = index + 1; jindex < objects.size(); jindex++)
@@ -284,11 +282,13 @@ void nms(HailoROIPtr hailo_roi, const float iou_thr)
                 {
                     // The detections are arranged in highest score order,
                     // so we want to erase the latter detection.
-                    hailo_roi->remove_object(objects[jindex]);
+                    suppressed.push_back(objects[jindex]);
                     objects.erase(objects.begin() + jindex);
                     jindex--; // Step back jindex since we just erased the current detection.
                 }
             }
         }
     }
+    // Removed from the roi in a single pass
+    hailo_common::remove_objects(hailo_roi, suppressed);
 }
\ No newline at end of file
@@ -65,6 +65,7 @@ static void gst_hailotilecropper_finalize(GObject *object);
 static std::vector<HailoROIPtr> gst_hailotilecropper_prepare_crops(GstHailoBaseCropper *hailocropper,
                                                                    GstBuffer *buf);
 void tiling_resize(GstHailoBaseCropper *basecropper, std::vector<cv::Mat> &cropped_image_vec, std::vector<cv::Mat> &resized_image_vec, HailoROIPtr roi, GstVideoFormat image_format);
+static gboolean tiling_get_crop_resize_mode(GstHailoBaseCropper *basecropper, gboolean *letterbox, gboolean *update_scaling_bbox);
 
 
 static void
@@ -85,6 +86,7 @@ gst_hailotilecropper_class_init(GstHailoTileCropperClass *klass)
 
     hailobasecropper_class->prepare_crops = gst_hailotilecropper_prepare_crops;
     hailobasecropper_class->resize = tiling_resize;
+    hailobasecropper_class->get_crop_resize_mode = tiling_get_crop_resize_mode;
 
     gst_element_class_set_details_simple(gstelement_class,
                                          "hailotilecropper - Tiling",
@@ -312,3 +314,11 @@ void tiling_resize(GstHailoBaseCropper *basecropper, std::vector<cv::Mat> &cropp
 {
     resize_normal(cv::INTER_LINEAR, cropped_image_vec, resized_image_vec, image_format);
 }
+
+static gboolean tiling_get_crop_resize_mode(GstHailoBaseCropper *basecropper, gboolean *letterbox, gboolean *update_scaling_bbox)
+{
+    // Tiles are always resized bilinearly without letterbox
+    *letterbox = FALSE;
+    *update_scaling_bbox = FALSE;
+    return TRUE;
+}
@@ -494,21 +494,23 @@ gst_hailo_tracker_transform_frame_ip(GstVideoFilter *filter, GstVideoFrame *fram
         stream_id = hailo_roi->get_stream_id();
     }
 
+    // Take the detections to track out of the roi in a single pass
     std::vector<HailoDetectionPtr> detections;
-    for (auto obj : hailo_roi->get_objects_typed(HAILO_DETECTION))
-    {
-        HailoDetectionPtr detection = std::dynamic_pointer_cast<HailoDetection>(obj);
-        if ((hailotracker->class_id == -1) || (detection->get_class_id() == hailotracker->class_id))
-        {
-            detections.push_back(detection);
-            hailo_roi->remove_object(detection);
-        }
-    }
+    hailo_roi->remove_objects_if([hailotracker, &detections](const HailoObjectPtr &obj)
+                                 {
+                                     if (obj->get_type() != HAILO_DETECTION)
+                                         return false;
+                                     HailoDetectionPtr detection = std::dynamic_pointer_cast<HailoDetection>(obj);
+                                     if ((hailotracker->class_id != -1) && (detection->get_class_id() != hailotracker->class_id))
+                                         return false;
+                                     detections.push_back(detection);
+                                     return true; });
 
     // Swap the detections in the roi with just the online tracked detections
     GST_OBJECT_LOCK(hailotracker);
     std::string tracker_name = get_tracker_name(hailotracker, std::string(stream_id));
-    std::vector<HailoDetectionPtr> online_detection_ptrs = HailoTracker::GetInstance().update(tracker_name, detections);
+    // Removed tracks are reported with the stream id downstream elements read from the roi
+    std::vector<HailoDetectionPtr> online_detection_ptrs = HailoTracker::GetInstance().update(tracker_name, detections, hailo_roi->get_stream_id());
 
     hailo_common::add_detection_pointers(hailo_roi, online_detection_ptrs);
     GST_OBJECT_UNLOCK(hailotracker);
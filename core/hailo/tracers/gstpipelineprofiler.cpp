@@ -0,0 +1,475 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * SECTION:gstpipelineprofiler
+ * @short_description: attribute per-thread cpu time to the elements of the pipeline
+ *
+ * A tracing module that follows the pad push / pull hooks to know which element
+ * is currently running on every streaming thread, and charges the thread cpu time
+ * (CLOCK_THREAD_CPUTIME_ID) spent between two hooks to that element.
+ * Every thread keeps a calling-context tree (thread -> pushing element -> chained
+ * element -> ...), so the output is a collapsed-stack file that can be passed as is
+ * to flamegraph.pl / speedscope:
+ *
+ *   queue0:src;queue0;hailonet0;hailofilter0 1234
+ *
+ * Only one of every "sampling-ratio" top level pushes of a thread is measured, the
+ * rest only update the stack depth, which keeps the overhead low enough to leave the
+ * tracer on in production. Reported values are estimated cpu time in microseconds
+ * (measured time multiplied by the sampling ratio).
+ *
+ * Usage:
+ *   GST_TRACERS="pipelineprofiler(sampling-ratio=100,period=5)"
+ * The collapsed stacks are written every period to
+ * $HAILO_PROFILE_LOCATION/pipeline_profiler.folded
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <vector>
+
+#include "gstpipelineprofiler.hpp"
+#include "gstctf.hpp"
+
+GST_DEBUG_CATEGORY_STATIC(gst_pipeline_profiler_debug);
+#define GST_CAT_DEFAULT gst_pipeline_profiler_debug
+
+#define DEFAULT_SAMPLING_RATIO (10)
+#define PROFILER_THREAD_NAME_LEN (16)
+#define PROFILER_OUTPUT_FILE "pipeline_profiler.folded"
+
+/* A node in the calling-context tree of a thread.
+ * The element pointer is only used as an identity and is never dereferenced. */
+typedef struct _ProfilerNode
+{
+  GstElement *element;
+  const gchar *name;
+  struct _ProfilerNode *parent;
+  std::vector<struct _ProfilerNode *> children;
+  std::atomic<guint64> cpu_time_ns;
+} ProfilerNode;
+
+typedef struct _ProfilerThreadState
+{
+  GstPipelineProfilerTracer *owner;
+  gchar thread_name[PROFILER_THREAD_NAME_LEN];
+  /* Guards the shape of the tree (children vectors) against the dumping thread.
+   * Only the owning thread adds nodes, so it can read the tree without locking. */
+  GMutex lock;
+  ProfilerNode root;
+  ProfilerNode *current;
+  guint depth;
+  guint countdown;
+  gboolean sampling;
+  guint64 last_cpu_time_ns;
+} ProfilerThreadState;
+
+struct _GstPipelineProfilerTracer
+{
+  GstPeriodicTracer parent;
+  guint sampling_ratio;
+  GMutex threads_lock;
+  GPtrArray *threads;
+};
+
+#define _do_init \
+  GST_DEBUG_CATEGORY_INIT(gst_pipeline_profiler_debug, "pipelineprofiler", 0, "pipelineprofiler tracer");
+
+G_DEFINE_TYPE_WITH_CODE(GstPipelineProfilerTracer, gst_pipeline_profiler_tracer,
+                        GST_TYPE_PERIODIC_TRACER, _do_init);
+
+static GstTracerRecord *tr_pipeline_profiler;
+static thread_local ProfilerThreadState *profiler_thread_state = NULL;
+
+static inline guint64
+profiler_thread_cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (guint64)ts.tv_sec * GST_SECOND + (guint64)ts.tv_nsec;
+}
+
+static GstElement *
+profiler_pad_element(GstPad *pad)
+{
+  GstObject *parent = GST_OBJECT_PARENT(pad);
+
+  /* Climb through ghost / proxy pads until reaching the owning element */
+  while (parent && !GST_IS_ELEMENT(parent))
+  {
+    parent = GST_OBJECT_PARENT(parent);
+  }
+
+  return (GstElement *)parent;
+}
+
+static ProfilerThreadState *
+profiler_thread_state_new(GstPipelineProfilerTracer *self)
+{
+  ProfilerThreadState *state = new ProfilerThreadState();
+
+  state->owner = self;
+  if (0 != pthread_getname_np(pthread_self(), state->thread_name, PROFILER_THREAD_NAME_LEN))
+  {
+    g_snprintf(state->thread_name, PROFILER_THREAD_NAME_LEN, "thread-%p", (void *)pthread_self());
+  }
+  g_mutex_init(&state->lock);
+  state->root.element = NULL;
+  state->root.name = g_intern_string(state->thread_name);
+  state->root.parent = NULL;
+  state->root.cpu_time_ns = 0;
+  state->current = &state->root;
+  state->depth = 0;
+  state->countdown = 1;
+  state->sampling = FALSE;
+  state->last_cpu_time_ns = 0;
+
+  g_mutex_lock(&self->threads_lock);
+  g_ptr_array_add(self->threads, state);
+  g_mutex_unlock(&self->threads_lock);
+
+  GST_DEBUG_OBJECT(self, "Started profiling thread %s", state->thread_name);
+
+  return state;
+}
+
+static void
+profiler_node_free_children(ProfilerNode *node)
+{
+  for (ProfilerNode *child : node->children)
+  {
+    profiler_node_free_children(child);
+    delete child;
+  }
+  node->children.clear();
+}
+
+static void
+profiler_thread_state_free(gpointer data)
+{
+  ProfilerThreadState *state = (ProfilerThreadState *)data;
+
+  profiler_node_free_children(&state->root);
+  g_mutex_clear(&state->lock);
+  delete state;
+}
+
+static inline ProfilerThreadState *
+profiler_get_thread_state(GstPipelineProfilerTracer *self)
+{
+  if (G_UNLIKELY(NULL == profiler_thread_state || profiler_thread_state->owner != self))
+  {
+    profiler_thread_state = profiler_thread_state_new(self);
+  }
+
+  return profiler_thread_state;
+}
+
+static ProfilerNode *
+profiler_node_get_child(ProfilerThreadState *state, ProfilerNode *node, GstElement *element)
+{
+  const gchar *name = element ? GST_OBJECT_NAME(element) : "unknown";
+  ProfilerNode *child;
+
+  for (ProfilerNode *candidate : node->children)
+  {
+    /* The name is compared as well, in case the element pointer got recycled */
+    if (candidate->element == element && 0 == g_strcmp0(candidate->name, name))
+    {
+      return candidate;
+    }
+  }
+
+  child = new ProfilerNode();
+  child->element = element;
+  child->name = g_intern_string(name);
+  child->parent = node;
+  child->cpu_time_ns = 0;
+
+  g_mutex_lock(&state->lock);
+  node->children.push_back(child);
+  g_mutex_unlock(&state->lock);
+
+  return child;
+}
+
+static inline void
+profiler_charge_current(ProfilerThreadState *state)
+{
+  guint64 now = profiler_thread_cpu_time_ns();
+
+  state->current->cpu_time_ns.fetch_add(now - state->last_cpu_time_ns, std::memory_order_relaxed);
+  state->last_cpu_time_ns = now;
+}
+
+/* Called when the thread is about to run the element on the other side of the pad */
+static void
+profiler_enter(GstPipelineProfilerTracer *self, GstPad *pad)
+{
+  ProfilerThreadState *state = profiler_get_thread_state(self);
+
+  if (0 == state->depth)
+  {
+    /* The time between two top level pushes belongs to the pushing element (source / queue loop) */
+    if (state->sampling)
+    {
+      profiler_charge_current(state);
+      state->sampling = FALSE;
+    }
+
+    if (0 == --state->countdown)
+    {
+      state->countdown = self->sampling_ratio;
+      state->sampling = TRUE;
+      state->current = profiler_node_get_child(state, &state->root, profiler_pad_element(pad));
+      state->last_cpu_time_ns = profiler_thread_cpu_time_ns();
+    }
+  }
+  else if (state->sampling)
+  {
+    profiler_charge_current(state);
+  }
+
+  if (state->sampling)
+  {
+    GstPad *peer = gst_pad_get_peer(pad);
+
+    state->current = profiler_node_get_child(state, state->current, peer ? profiler_pad_element(peer) : NULL);
+    if (peer)
+    {
+      gst_object_unref(peer);
+    }
+  }
+
+  state->depth++;
+}
+
+/* Called when the element on the other side of the pad returned */
+static void
+profiler_leave(GstPipelineProfilerTracer *self)
+{
+  ProfilerThreadState *state = profiler_get_thread_state(self);
+
+  /* The tracer may have been attached in the middle of a push */
+  if (0 == state->depth)
+  {
+    return;
+  }
+  state->depth--;
+
+  if (state->sampling)
+  {
+    profiler_charge_current(state);
+    if (state->current->parent)
+    {
+      state->current = state->current->parent;
+    }
+  }
+}
+
+static void
+do_push_buffer_pre(GstTracer *tracer, guint64 ts, GstPad *pad, GstBuffer *buffer)
+{
+  profiler_enter(GST_PIPELINE_PROFILER_TRACER(tracer), pad);
+}
+
+static void
+do_push_buffer_post(GstTracer *tracer, guint64 ts, GstPad *pad, GstFlowReturn res)
+{
+  profiler_leave(GST_PIPELINE_PROFILER_TRACER(tracer));
+}
+
+static void
+do_push_buffer_list_pre(GstTracer *tracer, guint64 ts, GstPad *pad, GstBufferList *list)
+{
+  profiler_enter(GST_PIPELINE_PROFILER_TRACER(tracer), pad);
+}
+
+static void
+do_push_buffer_list_post(GstTracer *tracer, guint64 ts, GstPad *pad, GstFlowReturn res)
+{
+  profiler_leave(GST_PIPELINE_PROFILER_TRACER(tracer));
+}
+
+static void
+do_pull_range_pre(GstTracer *tracer, guint64 ts, GstPad *pad, guint64 offset, guint size)
+{
+  profiler_enter(GST_PIPELINE_PROFILER_TRACER(tracer), pad);
+}
+
+static void
+do_pull_range_post(GstTracer *tracer, guint64 ts, GstPad *pad, GstBuffer *buffer, GstFlowReturn res)
+{
+  profiler_leave(GST_PIPELINE_PROFILER_TRACER(tracer));
+}
+
+static void
+profiler_dump_node(GstPipelineProfilerTracer *self, ProfilerNode *node, GString *path, GString *output)
+{
+  gsize path_len = path->len;
+  guint64 cpu_time_us;
+
+  if (path->len > 0)
+  {
+    g_string_append_c(path, ';');
+  }
+  g_string_append(path, node->name);
+
+  cpu_time_us = node->cpu_time_ns.load(std::memory_order_relaxed) * self->sampling_ratio / GST_USECOND;
+  if (cpu_time_us > 0)
+  {
+    g_string_append_printf(output, "%s %" G_GUINT64_FORMAT "\n", path->str, cpu_time_us);
+    gst_tracer_record_log(tr_pipeline_profiler, path->str, cpu_time_us);
+  }
+
+  for (ProfilerNode *child : node->children)
+  {
+    profiler_dump_node(self, child, path, output);
+  }
+
+  g_string_truncate(path, path_len);
+}
+
+static void
+profiler_dump(GstPipelineProfilerTracer *self)
+{
+  GString *path = g_string_new(NULL);
+  GString *output = g_string_new(NULL);
+  const gchar *dir_name = get_ctf_path_name();
+  GError *error = NULL;
+  gchar *file_name;
+  guint i;
+
+  g_mutex_lock(&self->threads_lock);
+  for (i = 0; i < self->threads->len; i++)
+  {
+    ProfilerThreadState *state = (ProfilerThreadState *)g_ptr_array_index(self->threads, i);
+
+    g_mutex_lock(&state->lock);
+    profiler_dump_node(self, &state->root, path, output);
+    g_mutex_unlock(&state->lock);
+  }
+  g_mutex_unlock(&self->threads_lock);
+
+  if (NULL != dir_name && output->len > 0)
+  {
+    file_name = g_build_filename(dir_name, PROFILER_OUTPUT_FILE, NULL);
+    /* The whole profile is rewritten every time, so the file is always a consistent snapshot */
+    if (!g_file_set_contents(file_name, output->str, output->len, &error))
+    {
+      GST_WARNING_OBJECT(self, "Failed to write %s: %s", file_name, error->message);
+      g_clear_error(&error);
+    }
+    g_free(file_name);
+  }
+
+  g_string_free(output, TRUE);
+  g_string_free(path, TRUE);
+}
+
+static gboolean
+pipeline_profiler_thread_func(GstPeriodicTracer *tracer)
+{
+  profiler_dump(GST_PIPELINE_PROFILER_TRACER(tracer));
+
+  return TRUE;
+}
+
+static guint
+profiler_read_sampling_ratio(GstPipelineProfilerTracer *self)
+{
+  GList *list = gst_shark_tracer_get_param(GST_SHARK_TRACER(self), "sampling-ratio");
+  guint sampling_ratio;
+
+  if (NULL == list)
+  {
+    return DEFAULT_SAMPLING_RATIO;
+  }
+
+  sampling_ratio = g_ascii_strtoull((const gchar *)list->data, NULL, 0);
+  /* On error, 0 is set */
+  if (0 == sampling_ratio)
+  {
+    GST_WARNING_OBJECT(self, "Invalid sampling-ratio \"%s\", using default of %d",
+                       (const gchar *)list->data, DEFAULT_SAMPLING_RATIO);
+    sampling_ratio = DEFAULT_SAMPLING_RATIO;
+  }
+
+  return sampling_ratio;
+}
+
+/* tracer class */
+
+static void
+gst_pipeline_profiler_tracer_constructed(GObject *obj)
+{
+  GstPipelineProfilerTracer *self = GST_PIPELINE_PROFILER_TRACER(obj);
+
+  /* Params are only available once the shark tracer parsed them */
+  G_OBJECT_CLASS(gst_pipeline_profiler_tracer_parent_class)->constructed(obj);
+
+  self->sampling_ratio = profiler_read_sampling_ratio(self);
+  GST_INFO_OBJECT(self, "Sampling one of every %u top level pushes per thread", self->sampling_ratio);
+}
+
+static void
+gst_pipeline_profiler_tracer_finalize(GObject *obj)
+{
+  GstPipelineProfilerTracer *self = GST_PIPELINE_PROFILER_TRACER(obj);
+
+  profiler_dump(self);
+
+  g_ptr_array_unref(self->threads);
+  self->threads = NULL;
+  g_mutex_clear(&self->threads_lock);
+
+  G_OBJECT_CLASS(gst_pipeline_profiler_tracer_parent_class)->finalize(obj);
+}
+
+static void
+gst_pipeline_profiler_tracer_class_init(GstPipelineProfilerTracerClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GstPeriodicTracerClass *tracer_class = GST_PERIODIC_TRACER_CLASS(klass);
+
+  gobject_class->constructed = gst_pipeline_profiler_tracer_constructed;
+  gobject_class->finalize = gst_pipeline_profiler_tracer_finalize;
+
+  tracer_class->timer_callback = GST_DEBUG_FUNCPTR(pipeline_profiler_thread_func);
+
+  tr_pipeline_profiler = gst_tracer_record_new("pipelineprofiler.class",
+                                               "stack", GST_TYPE_STRUCTURE,
+                                               gst_structure_new("value", "type", G_TYPE_GTYPE, G_TYPE_STRING,
+                                                                 "description", G_TYPE_STRING,
+                                                                 "collapsed stack: thread;element;...", "flags", GST_TYPE_TRACER_VALUE_FLAGS,
+                                                                 GST_TRACER_VALUE_FLAGS_AGGREGATED, NULL),
+                                               "cpu_time",
+                                               GST_TYPE_STRUCTURE,
+                                               gst_structure_new("value", "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+                                                                 "description", G_TYPE_STRING, "Estimated self cpu time [us]", "flags",
+                                                                 GST_TYPE_TRACER_VALUE_FLAGS, GST_TRACER_VALUE_FLAGS_AGGREGATED, "min",
+                                                                 G_TYPE_UINT64, G_GUINT64_CONSTANT(0), "max", G_TYPE_UINT64, G_MAXUINT64, NULL),
+                                               NULL);
+}
+
+static void
+gst_pipeline_profiler_tracer_init(GstPipelineProfilerTracer *self)
+{
+  GstTracer *tracer = GST_TRACER(self);
+
+  self->sampling_ratio = DEFAULT_SAMPLING_RATIO;
+  g_mutex_init(&self->threads_lock);
+  self->threads = g_ptr_array_new_with_free_func(profiler_thread_state_free);
+
+  gst_tracing_register_hook(tracer, "pad-push-pre", G_CALLBACK(do_push_buffer_pre));
+  gst_tracing_register_hook(tracer, "pad-push-post", G_CALLBACK(do_push_buffer_post));
+  gst_tracing_register_hook(tracer, "pad-push-list-pre", G_CALLBACK(do_push_buffer_list_pre));
+  gst_tracing_register_hook(tracer, "pad-push-list-post", G_CALLBACK(do_push_buffer_list_post));
+  gst_tracing_register_hook(tracer, "pad-pull-range-pre", G_CALLBACK(do_pull_range_pre));
+  gst_tracing_register_hook(tracer, "pad-pull-range-post", G_CALLBACK(do_pull_range_post));
+}
@@ -0,0 +1,14 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+#include "gstperiodictracer.hpp"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_PIPELINE_PROFILER_TRACER (gst_pipeline_profiler_tracer_get_type())
+G_DECLARE_FINAL_TYPE (GstPipelineProfilerTracer, gst_pipeline_profiler_tracer, GST, PIPELINE_PROFILER_TRACER, GstPeriodicTracer)
+
+G_END_DECLS
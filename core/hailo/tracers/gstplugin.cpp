@@ -41,6 +41,7 @@
 #include "gstqueuelevel.hpp"
 #include "gstbitrate.hpp"
 #include "gstbuffer.hpp"
+#include "gstpipelineprofiler.hpp"
 #include "gstctf.hpp"
 
 static gboolean
@@ -105,6 +106,10 @@ plugin_init(GstPlugin *plugin)
   {
     return FALSE;
   }
+  if (!gst_tracer_register(plugin, "pipelineprofiler", gst_pipeline_profiler_tracer_get_type()))
+  {
+    return FALSE;
+  }
   if (!gst_ctf_init())
   {
     return FALSE;
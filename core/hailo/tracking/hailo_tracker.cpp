@@ -8,6 +8,7 @@
 
 #include "hailo_tracker.hpp"
 #include "hailo_common.hpp"
+#include "track_state_store.hpp"
 
 std::mutex HailoTracker::mutex_;
 
@@ -15,6 +16,21 @@ class HailoTracker::HailoTrackerPrivate
 {
 public:
     std::map<std::string, JDETracker> trackers;
+    std::map<std::string, std::string> tracker_stream_ids; // The stream id given to the last update of each tracker
+    std::map<int, TrackRemovedCallback> track_removed_callbacks;
+    int next_callback_id = 0;
+    // Erased with the tracks below, registering a callback from inside the instance would deadlock
+    TrackStateStore<TrackIdentity> track_identities{DEFAULT_TRACK_STATE_CAPACITY, false};
+
+    // Called under mutex_, so a callback can't be removed while it runs
+    void notify_removed(const std::string &stream_id, const std::vector<int> &track_ids)
+    {
+        if (track_ids.empty())
+            return;
+        track_identities.erase(stream_id, track_ids);
+        for (auto &callback : track_removed_callbacks)
+            callback.second(stream_id, track_ids);
+    }
 };
 
 HailoTracker::HailoTracker() : priv(std::make_unique<HailoTrackerPrivate>()){};
@@ -29,7 +45,13 @@ HailoTracker &HailoTracker::GetInstance()
 void HailoTracker::remove_jde_tracker(const std::string &name)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers.erase(name);
+    auto tracker = priv->trackers.find(name);
+    if (tracker == priv->trackers.end())
+        return;
+    // The tracks of the tracker go away with it
+    priv->notify_removed(priv->tracker_stream_ids[name], tracker->second.get_track_ids());
+    priv->tracker_stream_ids.erase(name);
+    priv->trackers.erase(tracker);
 }
 
 std::vector<std::string> HailoTracker::get_trackers_list()
@@ -69,14 +91,51 @@ void HailoTracker::add_jde_tracker(const std::string &name)
     priv->trackers.emplace(name, JDETracker());
 }
 
-std::vector<HailoDetectionPtr> HailoTracker::update(const std::string &name, std::vector<HailoDetectionPtr> &inputs)
+std::vector<HailoDetectionPtr> HailoTracker::update(const std::string &name, std::vector<HailoDetectionPtr> &inputs, const std::string &stream_id)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto online_stracks = priv->trackers[name].update(inputs);
-    bool debug = priv->trackers[name].get_debug();
+    JDETracker &tracker = priv->trackers[name];
+    auto online_stracks = tracker.update(inputs);
+    bool debug = tracker.get_debug();
+    priv->tracker_stream_ids[name] = stream_id;
+    priv->notify_removed(stream_id, tracker.get_removed_track_ids());
     return JDETracker::stracks_to_hailo_detections(online_stracks, debug);
 }
 
+int HailoTracker::add_track_removed_callback(TrackRemovedCallback callback)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int callback_id = priv->next_callback_id++;
+    priv->track_removed_callbacks.emplace(callback_id, std::move(callback));
+    return callback_id;
+}
+
+void HailoTracker::remove_track_removed_callback(int callback_id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    priv->track_removed_callbacks.erase(callback_id);
+}
+
+/**
+ * @brief Record what a recognizer concluded about a track, for the elements upstream of it
+ *        (e.g. a cropper that decides which tracks to recognize again) to read on the next frames.
+ *        The store has its own lock, so reporting doesn't wait for tracker updates.
+ */
+void HailoTracker::report_track_identity(const std::string &stream_id, int track_id, int global_id, float confidence, float margin)
+{
+    priv->track_identities.update(stream_id, track_id, [&](TrackIdentity &identity) {
+        identity.global_id = global_id;
+        identity.confidence = confidence;
+        identity.margin = margin;
+        identity.reports++;
+    });
+}
+
+bool HailoTracker::get_track_identity(const std::string &stream_id, int track_id, TrackIdentity &identity)
+{
+    return priv->track_identities.get(stream_id, track_id, identity);
+}
+
 void HailoTracker::add_object_to_track(const std::string &name, int track_id, HailoObjectPtr obj)
 {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -5,6 +5,8 @@
 #pragma once
 
 // General cpp includes
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <vector>
 #include <mutex>
@@ -45,6 +47,18 @@ struct HailoTrackerParams
     std::vector<hailo_object_t> hailo_objects_blacklist;
 };
 
+// Called with the ids of the tracks a tracker removed, and the stream id given to its update
+using TrackRemovedCallback = std::function<void(const std::string &stream_id, const std::vector<int> &track_ids)>;
+
+// What a recognizer downstream of the tracker (e.g. hailogallery) last concluded about a track
+struct TrackIdentity
+{
+    int global_id = -1;      // The identity the track was matched to
+    float confidence = 0.0f; // Similarity to that identity, 0 to 1
+    float margin = 0.0f;     // How much more similar that identity is than the next best one
+    uint64_t reports = 0;    // Number of reports so far, tells a new report from an old one
+};
+
 class HailoTracker
 {
 private:
@@ -62,7 +76,11 @@ public:
     void add_jde_tracker(const std::string &name);
     void remove_jde_tracker(const std::string &name);
     std::vector<std::string> get_trackers_list();
-    std::vector<HailoDetectionPtr> update(const std::string &name, std::vector<HailoDetectionPtr> &inputs);
+    std::vector<HailoDetectionPtr> update(const std::string &name, std::vector<HailoDetectionPtr> &inputs, const std::string &stream_id = "");
+    int add_track_removed_callback(TrackRemovedCallback callback);
+    void remove_track_removed_callback(int callback_id);
+    void report_track_identity(const std::string &stream_id, int track_id, int global_id, float confidence, float margin);
+    bool get_track_identity(const std::string &stream_id, int track_id, TrackIdentity &identity);
     void add_object_to_track(const std::string &name, int id, HailoObjectPtr obj);
     void remove_classifications_from_track(const std::string &name, int track_id, std::string classifier_type);
     void remove_matrices_from_track(const std::string &name, int track_id);
@@ -54,6 +54,7 @@ private:
     std::vector<STrack> m_tracked_stracks;                 // Currently tracked STracks
     std::vector<STrack> m_lost_stracks;                    // Currently lost STracks
     std::vector<STrack> m_new_stracks;                     // Currently new STracks
+    std::vector<int> m_removed_track_ids;                  // Ids of the activated STracks removed by the last update
     KalmanFilter m_kalman_filter;                          // Kalman Filter
     std::vector<hailo_object_t> m_hailo_objects_blacklist; // Objects that will never be kept track of
 
@@ -122,6 +123,8 @@ public:
     static std::vector<HailoDetectionPtr> stracks_to_hailo_detections(std::vector<STrack> &stracks, bool debug);
     STrack *get_detection_with_id(int track_id);
     std::vector<STrack> get_tracked_stracks();
+    std::vector<int> get_removed_track_ids() { return m_removed_track_ids; }
+    std::vector<int> get_track_ids();
     std::vector<STrack> update(std::vector<HailoDetectionPtr> &inputs, bool report_unconfirmed, bool report_lost);
 
     /******************** PRIVATE FUNCTIONS ****************************/
@@ -111,3 +111,15 @@ inline std::vector<STrack> JDETracker::get_tracked_stracks()
 {
     return m_tracked_stracks;
 }
+
+// Ids of the tracked and lost stracks, the tracks that still own an id
+inline std::vector<int> JDETracker::get_track_ids()
+{
+    std::vector<int> track_ids;
+    track_ids.reserve(m_tracked_stracks.size() + m_lost_stracks.size());
+    for (uint i = 0; i < m_tracked_stracks.size(); i++)
+        track_ids.push_back(m_tracked_stracks[i].m_track_id);
+    for (uint i = 0; i < m_lost_stracks.size(); i++)
+        track_ids.push_back(m_lost_stracks[i].m_track_id);
+    return track_ids;
+}
@@ -155,6 +155,7 @@ inline void JDETracker::update_unmatches(std::vector<STrack *> strack_pool,
             else
             {
                 track->mark_removed(); // Over keep threshold, now removed
+                this->m_removed_track_ids.push_back(track->m_track_id);
             }
             break;
         case TrackState::New:
@@ -165,6 +166,8 @@ inline void JDETracker::update_unmatches(std::vector<STrack *> strack_pool,
             else
             {
                 track->mark_removed(); // Over keep threshold, now removed
+                if (track->m_is_activated)
+                    this->m_removed_track_ids.push_back(track->m_track_id);
             }
             break;
         }
@@ -204,6 +207,7 @@ inline void JDETracker::update_unmatches(std::vector<STrack *> strack_pool,
 inline std::vector<STrack> JDETracker::update(std::vector<HailoDetectionPtr> &inputs, bool report_unconfirmed = false, bool report_lost = false)
 {
     this->m_frame_id++;
+    this->m_removed_track_ids.clear();
     std::vector<STrack> detections;        // New detections in this update
     std::vector<STrack> activated_stracks; // Currently active stracks
     std::vector<STrack> lost_stracks;      // Currently lost stracks
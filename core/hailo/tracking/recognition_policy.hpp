@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file recognition_policy.hpp
+ * @brief Decides which tracks a cropper sends to a recognition network (re-id, face recognition) on a frame.
+ *
+ * Re-embedding a track whose identity is already known spends the network on nothing, so:
+ *  - A track is recognized at base_interval until the recognizer reports it is confident
+ *    (HailoTracker::report_track_identity, see hailogallery).
+ *  - Every confident report doubles the interval of the track, up to max_interval.
+ *  - The interval drops back to base_interval (and the track is recognized right away) when the track
+ *    moved a lot since it was last recognized, came back after being unseen (occlusion), its crop quality
+ *    jumped (above min_quality), or it wasn't recognized for max_age frames.
+ * Tracks that are due compete for the crops budget of the frame, the most overdue first.
+ */
+#pragma once
+
+// General cpp includes
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "hailo_tracker.hpp"
+#include "track_state_store.hpp"
+
+struct RecognitionPolicyParams
+{
+    int base_interval = 1;        // Frames between recognitions of a track that isn't confidently identified
+    int max_interval = 32;        // Longest back off of a confidently identified track
+    int max_age = 90;             // A track is recognized at least once every max_age frames
+    float min_confidence = 0.6f;  // Reported similarity needed to back off
+    float min_margin = 0.1f;      // Reported margin over the next best identity needed to back off
+    float motion_iou = 0.5f;      // Recognize again if the box overlaps its box at the last recognition less than this
+    float quality_jump = 0.3f;    // Recognize again if the quality grew by this fraction since the last recognition
+    float min_quality = 0.1f;     // Qualities below this count as this for the jump, so a track recognized at 0 doesn't always jump
+    int occlusion_frames = 5;     // Recognize again if the track was unseen for more than this many frames
+};
+
+struct RecognitionCandidate
+{
+    HailoROIPtr crop;
+    int track_id;
+    HailoBBox bbox;
+    float quality;
+    float priority;
+};
+
+class RecognitionPolicy
+{
+private:
+    struct TrackState
+    {
+        bool recognized = false;
+        int last_recognized = 0; // Frame of the last recognition
+        int last_seen = 0;
+        int interval = 0;
+        uint64_t reports = 0; // Identity reports already taken into account
+        HailoBBox bbox = HailoBBox(0.0f, 0.0f, 0.0f, 0.0f); // Box and quality at the last recognition
+        float quality = 0.0f;
+    };
+
+    RecognitionPolicyParams m_params;
+    TrackStateStore<TrackState> m_tracks;
+    std::map<std::string, int> m_frames; // Frame counter of every stream
+    std::mutex m_frames_mutex;
+    std::atomic<uint> m_max_crops{0};
+
+    static float iou(const HailoBBox &a, const HailoBBox &b)
+    {
+        float width = std::min(a.xmax(), b.xmax()) - std::max(a.xmin(), b.xmin());
+        float height = std::min(a.ymax(), b.ymax()) - std::max(a.ymin(), b.ymin());
+        if (width <= 0.0f || height <= 0.0f)
+            return 0.0f;
+        float intersection = width * height;
+        return intersection / (a.width() * a.height() + b.width() * b.height() - intersection);
+    }
+
+    bool confident(const TrackIdentity &identity) const
+    {
+        return identity.confidence >= m_params.min_confidence && identity.margin >= m_params.min_margin;
+    }
+
+    bool retrigger(const TrackState &state, int frame, int unseen_frames, const HailoBBox &bbox, float quality) const
+    {
+        return unseen_frames > m_params.occlusion_frames ||
+               frame - state.last_recognized >= m_params.max_age ||
+               iou(state.bbox, bbox) < m_params.motion_iou ||
+               quality > std::max(state.quality, m_params.min_quality) * (1.0f + m_params.quality_jump);
+    }
+
+public:
+    explicit RecognitionPolicy(const RecognitionPolicyParams &params = RecognitionPolicyParams()) : m_params(params)
+    {
+        m_params.base_interval = std::max(m_params.base_interval, 1);
+        m_params.max_interval = std::max(m_params.max_interval, m_params.base_interval);
+    }
+
+    const RecognitionPolicyParams &params() const { return m_params; }
+
+    // Most tracks recognized per frame, 0 for no limit
+    void set_max_crops(uint max_crops) { m_max_crops = max_crops; }
+    uint get_max_crops() const { return m_max_crops; }
+
+    /**
+     * @brief Start a new frame of a stream, call once per frame before priority().
+     */
+    void new_frame(const std::string &stream_id)
+    {
+        std::lock_guard<std::mutex> lock(m_frames_mutex);
+        m_frames[stream_id]++;
+    }
+
+    int frame(const std::string &stream_id)
+    {
+        std::lock_guard<std::mutex> lock(m_frames_mutex);
+        return m_frames[stream_id];
+    }
+
+    /**
+     * @brief How overdue the recognition of a track is on this frame.
+     *        Takes the identity reports that arrived since the track was last seen into account.
+     *
+     * @param quality Any crop quality score where higher is better (e.g. sharpness, detection confidence).
+     * @return The frames since the last recognition divided by the track's interval, at least 1 if the track
+     *         is due, and the highest priority for tracks that were never recognized. Negative if the track
+     *         should be skipped on this frame.
+     */
+    float priority(const std::string &stream_id, int track_id, const HailoBBox &bbox, float quality)
+    {
+        int current_frame = frame(stream_id);
+        TrackIdentity identity;
+        bool identified = HailoTracker::GetInstance().get_track_identity(stream_id, track_id, identity);
+
+        return m_tracks.update(stream_id, track_id, [&](TrackState &state) {
+            int unseen_frames = current_frame - state.last_seen - 1;
+            state.last_seen = current_frame;
+            if (!state.recognized)
+                return std::numeric_limits<float>::max();
+
+            if (identified && identity.reports != state.reports)
+            {
+                // The recognizer answered, back off if it is sure
+                state.reports = identity.reports;
+                state.interval = confident(identity) ? std::min(2 * state.interval, m_params.max_interval) : m_params.base_interval;
+            }
+
+            float overdue = float(current_frame - state.last_recognized) / state.interval;
+            if (retrigger(state, current_frame, unseen_frames, bbox, quality))
+            {
+                state.interval = m_params.base_interval;
+                return std::max(overdue, 1.0f);
+            }
+            return overdue >= 1.0f ? overdue : -1.0f;
+        });
+    }
+
+    /**
+     * @brief Mark a track as recognized on this frame.
+     */
+    void commit(const std::string &stream_id, int track_id, const HailoBBox &bbox, float quality)
+    {
+        int current_frame = frame(stream_id);
+        m_tracks.update(stream_id, track_id, [&](TrackState &state) {
+            if (!state.recognized)
+                state.interval = m_params.base_interval;
+            state.recognized = true;
+            state.last_recognized = current_frame;
+            state.bbox = bbox;
+            state.quality = quality;
+        });
+    }
+
+    /**
+     * @brief Append the crops of the due candidates to crops, the most overdue first, up to the crops budget,
+     *        and commit them. Candidates with a negative priority are skipped.
+     *        candidates is left holding the chosen candidates, in the order of crops.
+     */
+    void select(const std::string &stream_id, std::vector<RecognitionCandidate> &candidates, std::vector<HailoROIPtr> &crops)
+    {
+        auto skipped = std::remove_if(candidates.begin(), candidates.end(), [](const RecognitionCandidate &candidate)
+                                      { return candidate.priority < 0.0f; });
+        candidates.erase(skipped, candidates.end());
+        std::stable_sort(candidates.begin(), candidates.end(), [](const RecognitionCandidate &a, const RecognitionCandidate &b)
+                         { return a.priority > b.priority; });
+        uint max_crops = m_max_crops;
+        if (max_crops && candidates.size() > max_crops)
+            candidates.erase(candidates.begin() + max_crops, candidates.end());
+        for (const RecognitionCandidate &candidate : candidates)
+        {
+            commit(stream_id, candidate.track_id, candidate.bbox, candidate.quality);
+            crops.emplace_back(candidate.crop);
+        }
+    }
+};
@@ -0,0 +1,254 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file track_state_store.hpp
+ * @brief Bounded per-track state, keyed on (stream id, track id), for croppers and postprocesses
+ *        that remember something about every track they see.
+ *
+ * The entries live in a fixed open-addressing table (linear probing, backward-shift deletion),
+ * so lookups don't slow down and memory doesn't grow over days of uptime:
+ *  - An entry is erased when the tracker removes its track (see HailoTracker::add_track_removed_callback).
+ *  - If the store is full anyway (e.g. the tracker runs in another process), inserting a new track evicts
+ *    an entry that was not used lately (CLOCK / second chance).
+ * Streams are told apart by the hash of their stream id.
+ */
+#pragma once
+
+// General cpp includes
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Tappas includes
+#include "hailo_tracker.hpp"
+
+#define DEFAULT_TRACK_STATE_CAPACITY (4096)
+
+template <typename T>
+class TrackStateStore
+{
+private:
+    struct Slot
+    {
+        uint64_t stream_hash;
+        int track_id;
+        bool used;
+        bool referenced; // Set on every access, cleared by the eviction hand
+        T state;
+    };
+
+    std::vector<Slot> m_slots; // Power of two, at least twice the capacity
+    size_t m_mask;
+    size_t m_capacity;
+    size_t m_size = 0;
+    size_t m_clock_hand = 0;
+    uint64_t m_evicted = 0;
+    int m_callback_id = -1;
+    mutable std::mutex m_mutex;
+
+    static uint64_t stream_hash(const std::string &stream_id)
+    {
+        return std::hash<std::string>()(stream_id);
+    }
+
+    size_t home_slot(uint64_t hash, int track_id) const
+    {
+        // splitmix64 finalizer, consecutive track ids spread over the table
+        uint64_t key = hash ^ (uint64_t(uint32_t(track_id)) * 0x9e3779b97f4a7c15ULL);
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+        return (key ^ (key >> 31)) & m_mask;
+    }
+
+    // Index of the entry, or of the empty slot that ends its probe sequence
+    size_t probe(uint64_t hash, int track_id) const
+    {
+        size_t index = home_slot(hash, track_id);
+        while (m_slots[index].used && (m_slots[index].stream_hash != hash || m_slots[index].track_id != track_id))
+            index = (index + 1) & m_mask;
+        return index;
+    }
+
+    // Backward-shift deletion: pull later entries of the cluster into the hole, so no tombstones are left
+    void erase_slot(size_t hole)
+    {
+        size_t index = hole;
+        while (true)
+        {
+            index = (index + 1) & m_mask;
+            if (!m_slots[index].used)
+                break;
+            size_t home = home_slot(m_slots[index].stream_hash, m_slots[index].track_id);
+            // The entry can move to the hole only if the hole lies between its home slot and its slot
+            if (((index - home) & m_mask) >= ((index - hole) & m_mask))
+            {
+                m_slots[hole] = std::move(m_slots[index]);
+                hole = index;
+            }
+        }
+        m_slots[hole].used = false;
+        m_slots[hole].state = T();
+        m_size--;
+    }
+
+    void evict_one()
+    {
+        while (true)
+        {
+            Slot &slot = m_slots[m_clock_hand];
+            if (slot.used && !slot.referenced)
+            {
+                // The shift may move an unvisited entry under the hand, so the hand stays
+                erase_slot(m_clock_hand);
+                m_evicted++;
+                return;
+            }
+            slot.referenced = false;
+            m_clock_hand = (m_clock_hand + 1) & m_mask;
+        }
+    }
+
+    Slot &get_or_insert(const std::string &stream_id, int track_id)
+    {
+        uint64_t hash = stream_hash(stream_id);
+        size_t index = probe(hash, track_id);
+        if (!m_slots[index].used)
+        {
+            if (m_size >= m_capacity)
+            {
+                evict_one();
+                index = probe(hash, track_id);
+            }
+            m_slots[index].stream_hash = hash;
+            m_slots[index].track_id = track_id;
+            m_slots[index].used = true;
+            m_slots[index].state = T();
+            m_size++;
+        }
+        m_slots[index].referenced = true;
+        return m_slots[index];
+    }
+
+public:
+    /**
+     * @brief Construct a new store.
+     *
+     * @param capacity  -  size_t
+     *        The most tracks kept, across all streams.
+     *
+     * @param evict_removed_tracks  -  bool
+     *        If true, entries are erased when HailoTracker removes their track.
+     */
+    TrackStateStore(size_t capacity = DEFAULT_TRACK_STATE_CAPACITY, bool evict_removed_tracks = true) : m_capacity(capacity ? capacity : 1)
+    {
+        size_t table_size = 2;
+        while (table_size < 2 * m_capacity)
+            table_size *= 2;
+        m_slots.resize(table_size);
+        m_mask = table_size - 1;
+
+        if (evict_removed_tracks)
+        {
+            m_callback_id = HailoTracker::GetInstance().add_track_removed_callback(
+                [this](const std::string &stream_id, const std::vector<int> &track_ids)
+                { erase(stream_id, track_ids); });
+        }
+    }
+
+    ~TrackStateStore()
+    {
+        if (m_callback_id >= 0)
+            HailoTracker::GetInstance().remove_track_removed_callback(m_callback_id);
+    }
+
+    TrackStateStore(const TrackStateStore &) = delete;
+    TrackStateStore &operator=(const TrackStateStore &) = delete;
+
+    /**
+     * @brief Run func on the state of a track, under the store lock.
+     *        A track seen for the first time starts with a value-initialized state.
+     *
+     * @return The return value of func.
+     */
+    template <typename F>
+    auto update(const std::string &stream_id, int track_id, F &&func) -> decltype(func(std::declval<T &>()))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return func(get_or_insert(stream_id, track_id).state);
+    }
+
+    /**
+     * @brief Copy the state of a track to state.
+     *
+     * @return false if the track has no state (state is left as is).
+     */
+    bool get(const std::string &stream_id, int track_id, T &state)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t index = probe(stream_hash(stream_id), track_id);
+        if (!m_slots[index].used)
+            return false;
+        m_slots[index].referenced = true;
+        state = m_slots[index].state;
+        return true;
+    }
+
+    void set(const std::string &stream_id, int track_id, const T &state)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        get_or_insert(stream_id, track_id).state = state;
+    }
+
+    bool erase(const std::string &stream_id, int track_id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t index = probe(stream_hash(stream_id), track_id);
+        if (!m_slots[index].used)
+            return false;
+        erase_slot(index);
+        return true;
+    }
+
+    void erase(const std::string &stream_id, const std::vector<int> &track_ids)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t hash = stream_hash(stream_id);
+        for (int track_id : track_ids)
+        {
+            size_t index = probe(hash, track_id);
+            if (m_slots[index].used)
+                erase_slot(index);
+        }
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Slot &slot : m_slots)
+        {
+            slot.used = false;
+            slot.state = T();
+        }
+        m_size = 0;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_size;
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+    // Number of entries evicted because the store was full, rather than by the tracker
+    uint64_t evicted() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_evicted;
+    }
+};
@@ -0,0 +1,189 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <algorithm>
+#include <vector>
+
+// Tappas includes
+#include "cropping/crop_resize_engine.hpp"
+#include "common/image.hpp"
+
+// Open source includes
+#include <opencv2/opencv.hpp>
+
+static CropResizeImage image_from_mat(cv::Mat &mat, GstVideoFormat format)
+{
+    CropResizeImage image;
+    image.format = format;
+    image.width = mat.cols;
+    image.height = mat.rows;
+    image.planes[0] = mat.data;
+    image.strides[0] = mat.step;
+    return image;
+}
+
+static CropResizeImage image_from_nv12(std::vector<uint8_t> &data, int width, int height)
+{
+    CropResizeImage image;
+    image.format = GST_VIDEO_FORMAT_NV12;
+    image.width = width;
+    image.height = height;
+    image.planes[0] = data.data();
+    image.planes[1] = data.data() + width * height;
+    image.strides[0] = width;
+    image.strides[1] = width;
+    return image;
+}
+
+static int max_abs_diff(const cv::Mat &a, const cv::Mat &b)
+{
+    cv::Mat diff;
+    double max_value;
+    cv::absdiff(a.reshape(1), b.reshape(1), diff);
+    cv::minMaxLoc(diff, nullptr, &max_value);
+    return (int)max_value;
+}
+
+TEST_CASE("Crop resize engine matches opencv bilinear resize", "[crop_resize_engine]")
+{
+    cv::Mat input(480, 640, CV_8UC3);
+    cv::randu(input, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::GaussianBlur(input, input, cv::Size(5, 5), 0);
+    cv::Rect crop_rect(100, 50, 300, 200);
+
+    SECTION("RGB crop")
+    {
+        cv::Mat output(112, 112, CV_8UC3);
+        CropResizeJob job;
+        job.crop_rect = crop_rect;
+        job.output = image_from_mat(output, GST_VIDEO_FORMAT_RGB);
+        CropResizeEngine::crop_resize(image_from_mat(input, GST_VIDEO_FORMAT_RGB), job);
+
+        cv::Mat expected;
+        cv::resize(input(crop_rect), expected, output.size(), 0, 0, cv::INTER_LINEAR);
+        CHECK(max_abs_diff(output, expected) <= 2);
+    }
+
+    SECTION("NV12 crop")
+    {
+        cv::Mat gray;
+        cv::cvtColor(input, gray, cv::COLOR_RGB2GRAY);
+        std::vector<uint8_t> nv12(640 * 480 * 3 / 2, 128);
+        gray.copyTo(cv::Mat(480, 640, CV_8UC1, nv12.data()));
+        std::vector<uint8_t> resized(120 * 80 * 3 / 2, 0);
+        CropResizeJob job;
+        job.crop_rect = crop_rect;
+        job.output = image_from_nv12(resized, 120, 80);
+        CropResizeEngine::crop_resize(image_from_nv12(nv12, 640, 480), job);
+
+        cv::Mat expected;
+        cv::resize(gray(crop_rect), expected, cv::Size(120, 80), 0, 0, cv::INTER_LINEAR);
+        CHECK(max_abs_diff(cv::Mat(80, 120, CV_8UC1, resized.data()), expected) <= 2);
+        // Flat chroma stays flat
+        CHECK(std::all_of(resized.begin() + 120 * 80, resized.end(), [](uint8_t v) { return v == 128; }));
+    }
+
+    SECTION("RGB letterbox keeps the aspect ratio and pads the borders")
+    {
+        cv::Mat output(100, 100, CV_8UC3, cv::Scalar::all(0));
+        CropResizeJob job;
+        job.crop_rect = crop_rect;
+        job.letterbox = true;
+        job.output = image_from_mat(output, GST_VIDEO_FORMAT_RGB);
+        CropResizeEngine::crop_resize(image_from_mat(input, GST_VIDEO_FORMAT_RGB), job);
+
+        // 300x200 into 100x100 -> 100x67 image with 17 padding rows on top and 16 below
+        CHECK(output.at<cv::Vec3b>(0, 50) == cv::Vec3b(114, 114, 114));
+        CHECK(output.at<cv::Vec3b>(99, 50) == cv::Vec3b(114, 114, 114));
+        CHECK(job.letterbox_scale.ymin() == Approx(-17.0f / 67.0f));
+        CHECK(job.letterbox_scale.height() == Approx(100.0f / 67.0f));
+    }
+}
+
+// The rows (or columns) of an image that are all the letterbox color
+static std::vector<int> padding_lines(const cv::Mat &image, bool rows)
+{
+    std::vector<int> lines;
+    int count = rows ? image.rows : image.cols;
+    for (int i = 0; i < count; i++)
+    {
+        cv::Mat line = rows ? image.row(i) : image.col(i);
+        if (cv::countNonZero(line.reshape(1) != 114) == 0)
+            lines.push_back(i);
+    }
+    return lines;
+}
+
+TEST_CASE("Crop resize engine letterbox matches the serial letterbox", "[crop_resize_engine]")
+{
+    cv::Mat input(480, 640, CV_8UC3);
+    cv::randu(input, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::GaussianBlur(input, input, cv::Size(5, 5), 0);
+    // Both leave an odd padding, 33 rows for the wide crop and 33 columns for the tall one
+    for (bool wide : {true, false})
+    {
+        cv::Rect crop_rect = wide ? cv::Rect(100, 50, 300, 200) : cv::Rect(100, 50, 200, 300);
+        INFO((wide ? "wide crop" : "tall crop"));
+        cv::Mat cropped = input(crop_rect).clone();
+
+        cv::Mat serial(100, 100, CV_8UC3);
+        HailoBBox serial_scale = resize_letterbox_rgb(cropped, serial, cv::Scalar(114, 114, 114), cv::INTER_LINEAR);
+
+        cv::Mat engine(100, 100, CV_8UC3, cv::Scalar::all(0));
+        CropResizeJob job;
+        job.crop_rect = crop_rect;
+        job.letterbox = true;
+        job.output = image_from_mat(engine, GST_VIDEO_FORMAT_RGB);
+        CropResizeEngine::crop_resize(image_from_mat(input, GST_VIDEO_FORMAT_RGB), job);
+
+        REQUIRE(serial.size() == engine.size());
+        CHECK(padding_lines(engine, wide) == padding_lines(serial, wide));
+        CHECK(max_abs_diff(engine, serial) <= 2);
+        CHECK(job.letterbox_scale.xmin() == Approx(serial_scale.xmin()));
+        CHECK(job.letterbox_scale.ymin() == Approx(serial_scale.ymin()));
+        CHECK(job.letterbox_scale.width() == Approx(serial_scale.width()));
+        CHECK(job.letterbox_scale.height() == Approx(serial_scale.height()));
+    }
+}
+
+TEST_CASE("Crop resize engine output does not depend on the amount of threads", "[crop_resize_engine]")
+{
+    cv::Mat input(480, 640, CV_8UC4);
+    cv::randu(input, cv::Scalar::all(0), cv::Scalar::all(255));
+    CropResizeImage input_image = image_from_mat(input, GST_VIDEO_FORMAT_RGBA);
+
+    const int num_crops = 40;
+    std::vector<cv::Mat> serial_outputs, parallel_outputs;
+    std::vector<CropResizeJob> serial_jobs, parallel_jobs;
+    for (int i = 0; i < num_crops; i++)
+    {
+        serial_outputs.emplace_back(64, 64, CV_8UC4);
+        parallel_outputs.emplace_back(64, 64, CV_8UC4);
+        CropResizeJob job;
+        job.crop_rect = cv::Rect(i * 10, i * 5, 80 + i, 120 - i);
+        job.letterbox = (i % 2 == 0);
+        job.output = image_from_mat(serial_outputs.back(), GST_VIDEO_FORMAT_RGBA);
+        serial_jobs.push_back(job);
+        job.output = image_from_mat(parallel_outputs.back(), GST_VIDEO_FORMAT_RGBA);
+        parallel_jobs.push_back(job);
+    }
+
+    CropResizeEngine serial_engine(0);
+    CropResizeEngine parallel_engine(3);
+    serial_engine.run(input_image, serial_jobs);
+    // Run several frames to exercise the persistent workers
+    for (int frame = 0; frame < 10; frame++)
+        parallel_engine.run(input_image, parallel_jobs);
+
+    for (int i = 0; i < num_crops; i++)
+    {
+        CHECK(max_abs_diff(serial_outputs[i], parallel_outputs[i]) == 0);
+        CHECK(serial_jobs[i].letterbox_scale.xmin() == parallel_jobs[i].letterbox_scale.xmin());
+    }
+}
@@ -14,6 +14,7 @@
 // Tappas includes
 #include "common/resources/license_plates/license_plates.hpp"
 #include "lpr_croppers.hpp"
+#include "hailo_tracker.hpp"
 
 // Open source includes
 #include <opencv2/opencv.hpp>
@@ -68,6 +69,174 @@ TEST_CASE( "Given an image, quality estimation can determine if there is too muc
     }
 }
 
+/**
+ * @brief The quality estimation as it was calibrated against QUALITY_THRESHOLD:
+ *        crop, convert to BGR, resize, blur, gray, normalize and the variance of the Laplacian.
+ */
+static float reference_quality_estimation(const cv::Mat &bgr_image, const HailoBBox &roi, const float crop_ratio)
+{
+    float x_offset = roi.width() * crop_ratio;
+    float y_offset = roi.height() * crop_ratio;
+    HailoBBox cropped(roi.xmin() + x_offset, roi.ymin() + y_offset, roi.width() - 2 * x_offset, roi.height() - 2 * y_offset);
+    cv::Rect rect(cropped.xmin() * bgr_image.cols, cropped.ymin() * bgr_image.rows,
+                  cropped.width() * bgr_image.cols, cropped.height() * bgr_image.rows);
+    cv::Mat resized_image, gaussian_image, gray_image, gray_image_normalized, laplacian_image;
+    cv::resize(bgr_image(rect), resized_image, cv::Size(200, 40), 0, 0, cv::INTER_AREA);
+    cv::GaussianBlur(resized_image, gaussian_image, cv::Size(3, 3), 0);
+    cv::cvtColor(gaussian_image, gray_image, cv::COLOR_BGR2GRAY);
+    cv::normalize(gray_image, gray_image_normalized, 255, 0, cv::NORM_INF);
+    cv::Laplacian(gray_image_normalized, laplacian_image, CV_64F);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(laplacian_image, mean, stddev, cv::Mat());
+    return stddev.val[0] * stddev.val[0];
+}
+
+/**
+ * @brief Converts a BGR image (cropped to even dimensions) to NV12 and YUY2 buffers.
+ */
+static void bgr_to_yuv(cv::Mat &bgr_image, std::vector<uint8_t> &nv12, std::vector<uint8_t> &yuy2)
+{
+    bgr_image = bgr_image(cv::Rect(0, 0, bgr_image.cols & ~1, bgr_image.rows & ~1)).clone();
+    int width = bgr_image.cols;
+    int height = bgr_image.rows;
+    cv::Mat i420;
+    cv::cvtColor(bgr_image, i420, cv::COLOR_BGR2YUV_I420);
+    const uint8_t *y_plane = i420.data;
+    const uint8_t *u_plane = y_plane + width * height;
+    const uint8_t *v_plane = u_plane + (width / 2) * (height / 2);
+
+    nv12.assign(y_plane, y_plane + width * height);
+    for (int i = 0; i < (width / 2) * (height / 2); i++)
+    {
+        nv12.push_back(u_plane[i]);
+        nv12.push_back(v_plane[i]);
+    }
+
+    yuy2.clear();
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x += 2)
+        {
+            int chroma = (y / 2) * (width / 2) + x / 2;
+            yuy2.push_back(y_plane[y * width + x]);
+            yuy2.push_back(u_plane[chroma]);
+            yuy2.push_back(y_plane[y * width + x + 1]);
+            yuy2.push_back(v_plane[chroma]);
+        }
+    }
+}
+
+TEST_CASE( "Quality estimation keeps the preprocessing QUALITY_THRESHOLD was calibrated on", "[quality_estimation]" ) {
+    HailoBBox bbox = HailoBBox(0, 0, 1, 1);
+    std::vector<std::string> plates = {CLEAR_PLATE_PE3820, CLEAR_PLATE_SM7080, CLEAR_PLATE_LPR_4253980, BLURRY_PLATE_APQ5, BLURRY_PLATE_KHO5};
+
+    SECTION( "RGB images score the same as the original chain" ) {
+        for (const std::string &plate : plates)
+        {
+            cv::Mat image = cv::imread(plate, cv::IMREAD_COLOR);
+            std::shared_ptr<HailoRGBMat> image_h = std::make_shared<HailoRGBMat>(image, "image");
+            float reference = reference_quality_estimation(image, bbox, 0.1);
+            CHECK( quality_estimation(image_h, bbox, 0.1) == Approx(reference).epsilon(0.001) );
+        }
+    }
+
+    SECTION( "NV12 and YUY2 images score close to the original chain and on the same side of the threshold" ) {
+        for (const std::string &plate : plates)
+        {
+            cv::Mat image = cv::imread(plate, cv::IMREAD_COLOR);
+            std::vector<uint8_t> nv12, yuy2;
+            bgr_to_yuv(image, nv12, yuy2);
+            int width = image.cols;
+            int height = image.rows;
+
+            // The original chain converted the YUV crop back to BGR
+            cv::Mat nv12_bgr, yuy2_bgr;
+            cv::cvtColor(cv::Mat(height * 3 / 2, width, CV_8UC1, nv12.data()), nv12_bgr, cv::COLOR_YUV2BGR_NV12);
+            cv::cvtColor(cv::Mat(height, width, CV_8UC2, yuy2.data()), yuy2_bgr, cv::COLOR_YUV2BGR_YUY2);
+            float nv12_reference = reference_quality_estimation(nv12_bgr, bbox, 0.1);
+            float yuy2_reference = reference_quality_estimation(yuy2_bgr, bbox, 0.1);
+
+            std::shared_ptr<HailoNV12Mat> nv12_h = std::make_shared<HailoNV12Mat>(nv12.data(), height, width, width, width);
+            std::shared_ptr<HailoYUY2Mat> yuy2_h = std::make_shared<HailoYUY2Mat>(yuy2.data(), height, width, width * 2);
+            float nv12_variance = quality_estimation(nv12_h, bbox, 0.1);
+            float yuy2_variance = quality_estimation(yuy2_h, bbox, 0.1);
+
+            CHECK( nv12_variance == Approx(nv12_reference).epsilon(0.1) );
+            CHECK( yuy2_variance == Approx(yuy2_reference).epsilon(0.1) );
+            CHECK( (nv12_variance >= QUALITY_THRESHOLD) == (nv12_reference >= QUALITY_THRESHOLD) );
+            CHECK( (yuy2_variance >= QUALITY_THRESHOLD) == (yuy2_reference >= QUALITY_THRESHOLD) );
+        }
+    }
+}
+
+TEST_CASE( "The sharpness cache is keyed by stream, track and index", "[quality_estimation]" ) {
+    LumaSharpnessCache cache(QUALITY_CACHE_FRAMES, QUALITY_CACHE_SIZE_CHANGE);
+    HailoBBox bbox = HailoBBox(0.1, 0.1, 0.2, 0.1);
+    int scored = 0;
+    auto score = [&]() { return float(++scored); };
+    cache.new_frame("stream0");
+    cache.new_frame("stream1");
+
+    SECTION( "Two plates of a vehicle and the same track id on another stream are scored apart" ) {
+        CHECK( cache.get("stream0", 1, 0, bbox, score) == 1.0f );
+        CHECK( cache.get("stream0", 1, 1, bbox, score) == 2.0f );
+        CHECK( cache.get("stream1", 1, 0, bbox, score) == 3.0f );
+        CHECK( cache.get("stream0", 1, 0, bbox, score) == 1.0f );
+        CHECK( cache.get("stream0", 1, 1, bbox, score) == 2.0f );
+        CHECK( cache.get("stream1", 1, 0, bbox, score) == 3.0f );
+    }
+
+    SECTION( "Frames of one stream don't age the entries of another" ) {
+        CHECK( cache.get("stream0", 1, 0, bbox, score) == 1.0f );
+        CHECK( cache.get("stream1", 1, 0, bbox, score) == 2.0f );
+        for (int i = 0; i < QUALITY_CACHE_FRAMES; i++)
+            cache.new_frame("stream1");
+        CHECK( cache.get("stream0", 1, 0, bbox, score) == 1.0f );
+        CHECK( cache.get("stream1", 1, 0, bbox, score) == 3.0f );
+    }
+}
+
+TEST_CASE( "The sharpness cache forgets tracks that are gone", "[quality_estimation]" ) {
+    HailoBBox bbox = HailoBBox(0.1, 0.1, 0.2, 0.1);
+    int scored = 0;
+    auto score = [&]() { return float(++scored); };
+
+    SECTION( "The tracks of a stream that stopped are evicted once the cache is full" ) {
+        LumaSharpnessCache cache(QUALITY_CACHE_FRAMES, QUALITY_CACHE_SIZE_CHANGE, 8);
+        cache.new_frame("stopped");
+        for (int track_id = 0; track_id < 8; track_id++)
+            cache.get("stopped", track_id, 0, bbox, score);
+        cache.new_frame("running");
+        for (int track_id = 0; track_id < 100; track_id++)
+            cache.get("running", track_id, 0, bbox, score);
+        CHECK( cache.size() == 8 );
+        // The newest tracks of the running stream are still cached
+        CHECK( cache.get("running", 99, 0, bbox, score) == 108.0f );
+    }
+
+    SECTION( "The tracks the tracker removed are dropped" ) {
+        const std::string tracker_name = "sharpness_cache_test_sink_0";
+        LumaSharpnessCache cache(QUALITY_CACHE_FRAMES, QUALITY_CACHE_SIZE_CHANGE);
+        HailoTracker::GetInstance().add_jde_tracker(tracker_name);
+        for (int frame = 0; frame < 5; frame++)
+        {
+            cache.new_frame("sink_0");
+            std::vector<HailoDetectionPtr> detections;
+            for (int i = 0; i < 3; i++)
+                detections.push_back(std::make_shared<HailoDetection>(HailoBBox(0.1f + 0.3f * i, 0.1f, 0.2f, 0.2f), "car", 0.9f));
+            for (auto &detection : HailoTracker::GetInstance().update(tracker_name, detections, "sink_0"))
+                cache.get("sink_0", hailo_common::get_hailo_track_id(detection)[0]->get_id(), 0, bbox, score);
+        }
+        CHECK( cache.size() == 3 );
+
+        std::vector<HailoDetectionPtr> no_detections;
+        for (int frame = 0; frame < 10; frame++)
+            HailoTracker::GetInstance().update(tracker_name, no_detections, "sink_0");
+        CHECK( cache.size() == 0 );
+        HailoTracker::GetInstance().remove_jde_tracker(tracker_name);
+    }
+}
+
 TEST_CASE( "Given a HailoROIPtr, vehicles_without_ocr will filter out detections with no OCR", "[vehicles_without_ocr]" ) {
     // Load a dummy image
     auto dummy_image = std::make_shared<HailoRGBMat>(cv::Mat(1920, 1080, CV_8UC3), "");
@@ -0,0 +1,143 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <cstdlib>
+#include <vector>
+
+// Tappas includes
+#include "fisheye_dewarp.hpp"
+
+// Open source includes
+#include <opencv2/opencv.hpp>
+
+// The model of the re-id videos, scaled down to a 640x400 frame
+static const cv::Size SIZE(640, 400);
+static const FisheyeCameraModel MODEL = {425.0f, 434.0f, 322.0f, 208.0f, -0.0456f, -0.2201f, 0.4752f, -0.3869f, SIZE};
+
+static cv::Mat random_frame(cv::Size size)
+{
+    cv::Mat frame(size, CV_8UC3);
+    cv::RNG rng(7);
+    rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+    return frame;
+}
+
+TEST_CASE( "Dewarping rectangles gives the pixels of the whole frame dewarp.", "[fisheye_dewarp]" ) {
+    cv::Mat frame = random_frame(SIZE);
+    DewarpMapPtr map = create_dewarp_map(SIZE, MODEL);
+    cv::Mat dewarped;
+    dewarp_frame(frame, dewarped, *map);
+
+    // Center, corners, overlapping, and partly outside the frame
+    std::vector<cv::Rect> rects = {cv::Rect(300, 180, 40, 90), cv::Rect(0, 0, 64, 128), cv::Rect(580, 300, 60, 100),
+                                   cv::Rect(310, 200, 50, 50), cv::Rect(600, 380, 100, 100), cv::Rect(1, 1, 1, 1)};
+
+    SECTION( "dewarp_rects" ) {
+        std::vector<cv::Mat> outputs;
+        dewarp_rects(frame, *map, rects, outputs);
+        REQUIRE( outputs.size() == rects.size() );
+        for (size_t i = 0; i < rects.size(); i++)
+        {
+            cv::Mat expected = dewarped(rects[i] & cv::Rect(cv::Point(0, 0), SIZE));
+            REQUIRE( outputs[i].size() == expected.size() );
+            CHECK( cv::norm(outputs[i], expected, cv::NORM_INF) == 0.0 );
+        }
+    }
+
+    SECTION( "dewarp_rects_in_place" ) {
+        cv::Mat in_place = frame.clone();
+        dewarp_rects_in_place(in_place, *map, rects);
+        cv::Mat covered = cv::Mat::zeros(SIZE, CV_8UC1);
+        for (const cv::Rect &rect : rects)
+        {
+            cv::Rect clipped = rect & cv::Rect(cv::Point(0, 0), SIZE);
+            CHECK( cv::norm(in_place(clipped), dewarped(clipped), cv::NORM_INF) == 0.0 );
+            covered(clipped) = 255;
+        }
+        // Everything else is untouched
+        cv::Mat untouched;
+        cv::bitwise_not(covered, untouched);
+        CHECK( cv::norm(in_place, frame, cv::NORM_INF, untouched) == 0.0 );
+    }
+}
+
+TEST_CASE( "A dewarped rectangle covers the dewarped pixels of the fisheye rectangle.", "[fisheye_dewarp]" ) {
+    DewarpMapPtr map = create_dewarp_map(SIZE, MODEL);
+    cv::Rect fisheye_rect(40, 60, 80, 160);
+    cv::Rect rect = dewarped_rect(fisheye_rect, SIZE, MODEL);
+    REQUIRE_FALSE( rect.empty() );
+    // Every dewarped pixel whose source is well inside the fisheye rectangle is inside the dewarped rectangle
+    cv::Rect inner(fisheye_rect.x + 2, fisheye_rect.y + 2, fisheye_rect.width - 4, fisheye_rect.height - 4);
+    int sources_inside = 0;
+    for (int y = 0; y < SIZE.height; y++)
+    {
+        for (int x = 0; x < SIZE.width; x++)
+        {
+            cv::Vec2s source = map->map1.at<cv::Vec2s>(y, x);
+            if (inner.contains(cv::Point(source[0], source[1])))
+            {
+                sources_inside++;
+                CHECK( rect.contains(cv::Point(x, y)) );
+            }
+        }
+    }
+    CHECK( sources_inside > 0 );
+}
+
+TEST_CASE( "The camera model is scaled to the frame size.", "[fisheye_dewarp]" ) {
+    // The principal point is the image centre, it is the one point the dewarp leaves in place
+    FisheyeCameraModel centered = MODEL;
+    centered.cx = SIZE.width / 2.0f;
+    centered.cy = SIZE.height / 2.0f;
+
+    for (cv::Size size : {SIZE, cv::Size(1280, 800), cv::Size(320, 200)})
+    {
+        INFO( "size " << size.width << "x" << size.height );
+        DewarpMapPtr map = create_dewarp_map(size, centered);
+        cv::Point center(size.width / 2, size.height / 2);
+        cv::Vec2s source = map->map1.at<cv::Vec2s>(center);
+        CHECK( std::abs(source[0] - center.x) <= 1 );
+        CHECK( std::abs(source[1] - center.y) <= 1 );
+
+        // A small rectangle around the centre barely moves
+        cv::Rect rect = dewarped_rect(cv::Rect(center.x - 4, center.y - 4, 8, 8), size, centered);
+        CHECK( std::abs(rect.x + rect.width / 2 - center.x) <= 1 );
+        CHECK( std::abs(rect.y + rect.height / 2 - center.y) <= 1 );
+    }
+
+    FisheyeCameraModel doubled = MODEL.scaled(cv::Size(1280, 800));
+    CHECK( doubled.fx == 2 * MODEL.fx );
+    CHECK( doubled.cy == 2 * MODEL.cy );
+    CHECK( doubled.k1 == MODEL.k1 );
+    CHECK( doubled.calibration_size == cv::Size(1280, 800) );
+}
+
+TEST_CASE( "DewarpMapCache keeps one table per stream.", "[fisheye_dewarp]" ) {
+    DewarpMapCache cache;
+    DewarpMapPtr first = cache.get("sink_0", SIZE, MODEL);
+    CHECK( cache.get("sink_0", SIZE, MODEL) == first );
+    CHECK( cache.get("sink_1", SIZE, MODEL) != first );
+    CHECK( cache.size() == 2 );
+
+    // A new resolution replaces the stream's table
+    DewarpMapPtr smaller = cache.get("sink_0", cv::Size(320, 200), MODEL);
+    CHECK( smaller != first );
+    CHECK( smaller->map1.size() == cv::Size(320, 200) );
+    CHECK( cache.size() == 2 );
+
+    FisheyeCameraModel other_model = MODEL;
+    other_model.k1 = 0.0f;
+    CHECK( cache.get("sink_0", cv::Size(320, 200), other_model) != smaller );
+
+    // The same intrinsics calibrated at another resolution are another camera
+    FisheyeCameraModel other_calibration = MODEL;
+    other_calibration.calibration_size = cv::Size(1280, 800);
+    DewarpMapPtr other = cache.get("sink_1", SIZE, other_calibration);
+    CHECK( other != cache.get("sink_1", SIZE, MODEL) );
+}
@@ -13,6 +13,7 @@
 
 // Tappas includes
 #include "encode_json.hpp"
+#include "decode_json.hpp"
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 
@@ -308,4 +309,92 @@ TEST_CASE( "The encode_json can encode Hailo Objects with complex schemes", "[en
         CHECK( doc["HailoROI"]["SubObjects"][0]["HailoDetection"]["SubObjects"][0]["HailoDetection"]["SubObjects"][0]["HailoClassification"]["label"].GetString() == std::string("123456789") );
         CHECK( doc["HailoROI"]["SubObjects"][0]["HailoDetection"]["SubObjects"][0]["HailoDetection"]["SubObjects"][0]["HailoClassification"]["classification_type"].GetString() == std::string("ocr") );
     }
-}
\ No newline at end of file
+}
+
+// A frame with every kind of object, nested
+HailoROIPtr make_full_frame()
+{
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+    HailoTileROIPtr tile = std::make_shared<HailoTileROI>(HailoBBox(0.5, 0, 0.5, 0.5), 3, 0.1, 0.2, 1, SINGLE_SCALE);
+    for (int i = 0; i < 4; i++)
+    {
+        HailoDetectionPtr detection = std::make_shared<HailoDetection>(HailoBBox(0.1 * i, 0.2, 0.3, 0.1), i, "person", 0.3 + 0.1 * i);
+        detection->add_object(std::make_shared<HailoClassification>("gender", 1, "female", 0.87));
+        detection->add_object(std::make_shared<HailoUniqueID>(i, TRACKING_ID));
+        detection->add_object(std::make_shared<HailoLandmarks>("pose", std::vector<HailoPoint>{HailoPoint(0.1, 0.2, 0.9), HailoPoint(0.3, 0.4, 0.8)},
+                                                               0.5, std::vector<std::pair<int, int>>{{0, 1}}));
+        detection->add_object(std::make_shared<HailoMatrix>(std::vector<float>{0.1f * i, -0.25f, 3.0f, 1.0e-7f}, 1, 1, 4));
+        tile->add_object(detection);
+    }
+    roi->add_object(tile);
+    roi->add_object(std::make_shared<HailoDepthMask>(std::vector<float>{0.5, -1.25, 3.0e-8}, 3, 1, 0.3));
+    roi->add_object(std::make_shared<HailoClassMask>(std::vector<uint8_t>{0, 7, 255}, 3, 1, 0.4));
+    roi->add_object(std::make_shared<HailoConfClassMask>(std::vector<float>{0.1, 0.2, 0.3}, 3, 1, 0.5, 12));
+    return roi;
+}
+
+std::string encode_with_stream_encoder(HailoROIPtr roi, encode_json::EncodeOptions options = encode_json::EncodeOptions())
+{
+    encode_json::StreamEncoder encoder(options);
+    encoder.begin(roi);
+    encoder.end();
+    return std::string(encoder.data(), encoder.size());
+}
+
+TEST_CASE( "The streaming encoder writes the same JSON as encode_hailo_roi", "[encode_json]" ) {
+    HailoROIPtr roi = make_full_frame();
+    rapidjson::Document doc = encode_json::encode_hailo_roi(roi);
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    SECTION( "The default options are byte compatible with the document encoder." ) {
+        CHECK( encode_with_stream_encoder(roi) == std::string(buffer.GetString(), buffer.GetSize()) );
+    }
+
+    SECTION( "The encoder buffer is reused between frames." ) {
+        encode_json::StreamEncoder encoder;
+        for (int i = 0; i < 3; i++)
+        {
+            encoder.begin(roi);
+            encoder.writer().Key("buffer_offset");
+            encoder.writer().Uint(i);
+            encoder.end();
+        }
+        rapidjson::Document frame;
+        frame.Parse(encoder.data(), encoder.size());
+        REQUIRE_FALSE( frame.HasParseError() );
+        CHECK( frame["buffer_offset"].GetUint() == 2 );
+        CHECK( frame["HailoROI"]["SubObjects"].Size() == 4 );
+    }
+
+    SECTION( "Matrices can be written with a fixed precision." ) {
+        encode_json::EncodeOptions options;
+        options.matrix_precision = 3;
+        rapidjson::Document frame;
+        frame.Parse(encode_with_stream_encoder(roi, options).c_str());
+        REQUIRE_FALSE( frame.HasParseError() );
+        rapidjson::Value &matrix = frame["HailoROI"]["SubObjects"][0]["HailoTileROI"]["SubObjects"][1]["HailoDetection"]["SubObjects"][3]["HailoMatrix"];
+        rapidjson::StringBuffer data_buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> data_writer(data_buffer);
+        matrix["data"].Accept(data_writer);
+        CHECK( data_buffer.GetString() == std::string("[0.1,-0.25,3.0,0.0]") );
+    }
+
+    SECTION( "Matrices can be written as base64 and decoded bit exact." ) {
+        encode_json::EncodeOptions options;
+        options.matrix_base64 = true;
+        rapidjson::Document frame;
+        frame.Parse(encode_with_stream_encoder(roi, options).c_str());
+        REQUIRE_FALSE( frame.HasParseError() );
+        HailoROIPtr decoded = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+        decode_json::decode_hailo_roi(frame, decoded);
+        auto tile = std::dynamic_pointer_cast<HailoTileROI>(decoded->get_objects()[0]);
+        REQUIRE( tile != nullptr );
+        auto detection = std::dynamic_pointer_cast<HailoDetection>(tile->get_objects()[2]);
+        REQUIRE( detection != nullptr );
+        auto matrix = std::dynamic_pointer_cast<HailoMatrix>(detection->get_objects_typed(HAILO_MATRIX)[0]);
+        REQUIRE( matrix != nullptr );
+        CHECK( matrix->get_data() == std::vector<float>{0.1f * 2, -0.25f, 3.0f, 1.0e-7f} );
+    }
+}
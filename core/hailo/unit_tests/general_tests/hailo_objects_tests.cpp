@@ -0,0 +1,97 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+
+static HailoROIPtr roi_with_detections(const std::vector<std::string> &labels)
+{
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoROI(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f)));
+    for (size_t i = 0; i < labels.size(); i++)
+    {
+        roi->add_object(std::make_shared<HailoDetection>(HailoBBox(0.1f * i, 0.0f, 0.1f, 0.1f), labels[i], 0.5f));
+        roi->add_object(std::make_shared<HailoClassification>("type", labels[i], 0.5f));
+    }
+    return roi;
+}
+
+static std::vector<std::string> detection_labels(HailoROIPtr roi)
+{
+    std::vector<std::string> labels;
+    for (HailoDetectionPtr detection : hailo_common::get_hailo_detections(roi))
+        labels.push_back(detection->get_label());
+    return labels;
+}
+
+TEST_CASE( "Bulk removal of sub objects keeps the order of the remaining objects.", "[hailo_objects]" ) {
+    HailoROIPtr roi = roi_with_detections({"person", "car", "person", "bus", "car"});
+
+    SECTION( "remove_objects_if removes every match in one call." ) {
+        size_t removed = roi->remove_objects_if([](const HailoObjectPtr &obj)
+                                                { return obj->get_type() == HAILO_DETECTION &&
+                                                         std::dynamic_pointer_cast<HailoDetection>(obj)->get_label() == "person"; });
+        CHECK( removed == 2 );
+        CHECK( detection_labels(roi) == std::vector<std::string>({"car", "bus", "car"}) );
+        CHECK( roi->get_objects_typed(HAILO_CLASSIFICATION).size() == 5 );
+    }
+
+    SECTION( "retain_labels only removes detections." ) {
+        CHECK( roi->retain_labels({"car"}) == 3 );
+        CHECK( detection_labels(roi) == std::vector<std::string>({"car", "car"}) );
+        CHECK( roi->get_objects_typed(HAILO_CLASSIFICATION).size() == 5 );
+    }
+
+    SECTION( "extract_objects_if returns the removed objects in order." ) {
+        std::vector<HailoObjectPtr> extracted = roi->extract_objects_if([](const HailoObjectPtr &obj)
+                                                                        { return obj->get_type() == HAILO_CLASSIFICATION; });
+        CHECK( extracted.size() == 5 );
+        CHECK( std::dynamic_pointer_cast<HailoClassification>(extracted.back())->get_label() == "car" );
+        CHECK( roi->get_objects().size() == 5 );
+    }
+
+    SECTION( "hailo_common::remove_objects removes exactly the given objects." ) {
+        std::vector<HailoDetectionPtr> detections = hailo_common::get_hailo_detections(roi);
+        hailo_common::remove_detections(roi, {detections[1], detections[3]});
+        CHECK( detection_labels(roi) == std::vector<std::string>({"person", "person", "car"}) );
+    }
+}
+
+TEST_CASE( "An objects view iterates a single type without copying.", "[hailo_objects]" ) {
+    HailoROIPtr roi = roi_with_detections({"person", "car"});
+    size_t count = 0;
+    for (const HailoObjectPtr &obj : roi->get_objects_view(HAILO_CLASSIFICATION))
+    {
+        CHECK( obj->get_type() == HAILO_CLASSIFICATION );
+        count++;
+    }
+    CHECK( count == 2 );
+
+    HailoROIPtr empty_roi = std::make_shared<HailoROI>(HailoROI(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f)));
+    auto view = empty_roi->get_objects_view(HAILO_DETECTION);
+    CHECK( view.begin() == view.end() );
+}
+
+TEST_CASE( "Flattening moves the sub rois to the parent in one pass.", "[hailo_objects]" ) {
+    HailoROIPtr parent = std::make_shared<HailoROI>(HailoROI(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f)));
+    HailoDetectionPtr tile = std::make_shared<HailoDetection>(HailoBBox(0.5f, 0.5f, 0.5f, 0.5f), "tile", 1.0f);
+    parent->add_object(tile);
+    tile->add_object(std::make_shared<HailoDetection>(HailoBBox(0.0f, 0.0f, 0.5f, 0.5f), "person", 0.9f));
+    tile->add_object(std::make_shared<HailoClassification>("type", "day", 0.9f));
+
+    hailo_common::flatten_hailo_roi(tile, parent, HAILO_DETECTION);
+    CHECK( tile->get_objects().size() == 1 );
+    std::vector<HailoDetectionPtr> detections = hailo_common::get_hailo_detections(parent);
+    REQUIRE( detections.size() == 2 );
+    CHECK( detections[1]->get_bbox().xmin() == Approx(0.5f) );
+    CHECK( detections[1]->get_bbox().width() == Approx(0.25f) );
+}
@@ -0,0 +1,249 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "common/resources/test_jsons/unit_test_jsons.hpp"
+#include "encode_binary.hpp"
+#include "decode_binary.hpp"
+#include "encode_json.hpp"
+#include "decode_json.hpp"
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+
+// Open source includes
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/filereadstream.h"
+
+rapidjson::Document read_file(std::string filename)
+{
+    FILE* fp = fopen(filename.c_str(), "rb"); // non-Windows use "r"
+
+    char readBuffer[65536];
+    rapidjson::FileReadStream is(fp, readBuffer, sizeof(readBuffer));
+
+    rapidjson::Document d;
+    d.ParseStream(is);
+
+    fclose(fp);
+    return d;
+}
+
+// The JSON of a roi, used to compare roi trees (it covers every field of every encoded object)
+std::string to_json_string(HailoROIPtr roi)
+{
+    rapidjson::Document document = encode_json::encode_hailo_roi(roi);
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    document.Accept(writer);
+    return buffer.GetString();
+}
+
+HailoROIPtr binary_round_trip(HailoROIPtr roi)
+{
+    std::vector<uint8_t> buffer;
+    encode_binary::encode_hailo_roi(roi, buffer);
+    HailoROIPtr decoded_roi = std::make_shared<HailoROI>(roi->get_bbox());
+    decode_binary::decode_hailo_roi(buffer.data(), buffer.size(), decoded_roi);
+    return decoded_roi;
+}
+
+HailoROIPtr roi_from_json(std::string filename)
+{
+    rapidjson::Document test_json = read_file(filename);
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+    decode_json::decode_hailo_roi(test_json, roi);
+    return roi;
+}
+
+// A busy frame: detections with a classification, a track id, pose landmarks and an embedding, and a mask
+HailoROIPtr make_frame(int num_detections, int mask_size)
+{
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+    for (int i = 0; i < num_detections; i++)
+    {
+        HailoDetectionPtr detection = std::make_shared<HailoDetection>(HailoBBox(0.01f * i, 0.02f * i, 0.1f, 0.2f), 1, "person", 0.5f + 0.01f * i);
+        detection->add_object(std::make_shared<HailoClassification>("gender", 0, "female", 0.87f));
+        detection->add_object(std::make_shared<HailoUniqueID>(i, TRACKING_ID));
+        std::vector<HailoPoint> points;
+        for (int p = 0; p < 17; p++)
+            points.emplace_back(0.05f * p, 0.03f * p, 0.9f);
+        detection->add_object(std::make_shared<HailoLandmarks>("centerpose", points, 0.5f, std::vector<std::pair<int, int>>{{0, 1}, {1, 2}}));
+        std::vector<float> embedding(512);
+        for (size_t e = 0; e < embedding.size(); e++)
+            embedding[e] = 0.001f * (e + i);
+        detection->add_object(std::make_shared<HailoMatrix>(embedding, 1, 1, 512));
+        roi->add_object(detection);
+    }
+    std::vector<uint8_t> mask(mask_size * mask_size);
+    for (size_t m = 0; m < mask.size(); m++)
+        mask[m] = m % 21;
+    roi->add_object(std::make_shared<HailoClassMask>(std::move(mask), mask_size, mask_size, 0.5f));
+    return roi;
+}
+
+TEST_CASE( "The binary meta format round trips Hailo Objects", "[binary_meta]" ) {
+    SECTION( "The json fixtures survive a binary round trip." ) {
+        for (std::string filename : {DETECTION_JSON, CLASSIFICATION_JSON, LANDMARKS_JSON, TILE_JSON, UNIQUE_ID_JSON})
+        {
+            HailoROIPtr roi = roi_from_json(filename);
+            REQUIRE( !roi->get_objects().empty() );
+            CHECK( to_json_string(binary_round_trip(roi)) == to_json_string(roi) );
+        }
+    }
+
+    SECTION( "Masks and matrices survive a binary round trip bit exact." ) {
+        HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+        roi->add_object(std::make_shared<HailoDepthMask>(std::vector<float>{0.5f, -1.25f, 3.0e-8f, 100.0f}, 2, 2, 0.3f));
+        roi->add_object(std::make_shared<HailoClassMask>(std::vector<uint8_t>{0, 1, 2, 255, 7, 9}, 3, 2, 0.4f));
+        roi->add_object(std::make_shared<HailoConfClassMask>(std::vector<float>{0.1f, 0.2f}, 1, 2, 0.5f, 12));
+        roi->add_object(std::make_shared<HailoMatrix>(std::vector<float>{1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f}, 1, 2, 3));
+
+        HailoROIPtr decoded = binary_round_trip(roi);
+        auto depth = std::dynamic_pointer_cast<HailoDepthMask>(decoded->get_objects()[0]);
+        auto class_mask = std::dynamic_pointer_cast<HailoClassMask>(decoded->get_objects()[1]);
+        auto conf_mask = std::dynamic_pointer_cast<HailoConfClassMask>(decoded->get_objects()[2]);
+        auto matrix = std::dynamic_pointer_cast<HailoMatrix>(decoded->get_objects()[3]);
+        REQUIRE( depth != nullptr );
+        REQUIRE( class_mask != nullptr );
+        REQUIRE( conf_mask != nullptr );
+        REQUIRE( matrix != nullptr );
+        CHECK( depth->get_data() == std::vector<float>{0.5f, -1.25f, 3.0e-8f, 100.0f} );
+        CHECK( class_mask->get_data() == std::vector<uint8_t>{0, 1, 2, 255, 7, 9} );
+        CHECK( class_mask->get_width() == 3 );
+        CHECK( class_mask->get_height() == 2 );
+        CHECK( conf_mask->get_class_id() == 12 );
+        CHECK( matrix->width() == 2 );
+        CHECK( matrix->height() == 1 );
+        CHECK( matrix->features() == 3 );
+        CHECK( to_json_string(decoded) == to_json_string(roi) );
+    }
+
+    SECTION( "Nested objects and the header survive a binary round trip." ) {
+        HailoROIPtr roi = make_frame(3, 8);
+        std::vector<uint8_t> buffer;
+        encode_binary::encode_hailo_roi(roi, buffer, 1234, 56);
+        HailoROIPtr decoded = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+        binary_meta::Header header = decode_binary::decode_hailo_roi(buffer.data(), buffer.size(), decoded);
+        CHECK( header.version == BINARY_META_VERSION );
+        CHECK( header.timestamp_ms == 1234 );
+        CHECK( header.buffer_offset == 56 );
+        CHECK( to_json_string(decoded) == to_json_string(roi) );
+    }
+
+    SECTION( "Malformed messages are refused and leave the roi unchanged." ) {
+        std::vector<uint8_t> buffer;
+        encode_binary::encode_hailo_roi(roi_from_json(DETECTION_JSON), buffer);
+        HailoROIPtr decoded = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+
+        std::vector<uint8_t> truncated(buffer.begin(), buffer.end() - 3);
+        CHECK_THROWS_AS( decode_binary::decode_hailo_roi(truncated.data(), truncated.size(), decoded), binary_meta::FormatError );
+
+        std::vector<uint8_t> newer_version = buffer;
+        newer_version[4] = BINARY_META_VERSION + 1;
+        CHECK_THROWS_AS( decode_binary::decode_hailo_roi(newer_version.data(), newer_version.size(), decoded), binary_meta::FormatError );
+
+        std::string json = to_json_string(roi_from_json(DETECTION_JSON));
+        CHECK_THROWS_AS( decode_binary::decode_hailo_roi(reinterpret_cast<const uint8_t *>(json.data()), json.size(), decoded), binary_meta::FormatError );
+
+        CHECK( decoded->get_objects().empty() );
+    }
+
+    SECTION( "Masks and matrices whose dimensions don't match their data are refused." ) {
+        HailoROIPtr decoded = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+        std::vector<HailoObjectPtr> objects = {
+            std::make_shared<HailoClassMask>(std::vector<uint8_t>(64), 8, 9, 0.5f),
+            std::make_shared<HailoClassMask>(std::vector<uint8_t>(64), -8, -8, 0.5f),
+            std::make_shared<HailoDepthMask>(std::vector<float>(64), 16, 16, 0.5f),
+            std::make_shared<HailoConfClassMask>(std::vector<float>(64), 8, 7, 0.5f, 1),
+            std::make_shared<HailoMatrix>(std::vector<float>(512), 1, 1, 513),
+        };
+        for (HailoObjectPtr &object : objects)
+        {
+            HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+            roi->add_object(object);
+            std::vector<uint8_t> buffer;
+            encode_binary::encode_hailo_roi(roi, buffer);
+            CHECK_THROWS_AS( decode_binary::decode_hailo_roi(buffer.data(), buffer.size(), decoded), binary_meta::FormatError );
+        }
+        CHECK( decoded->get_objects().empty() );
+    }
+
+    SECTION( "Objects nested deeper than the limit are refused." ) {
+        HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+        HailoROIPtr parent = roi;
+        for (int i = 0; i < DECODE_BINARY_MAX_DEPTH + 2; i++)
+        {
+            HailoDetectionPtr detection = std::make_shared<HailoDetection>(HailoBBox(0, 0, 1, 1), "person", 0.5f);
+            parent->add_object(detection);
+            parent = detection;
+        }
+        std::vector<uint8_t> buffer;
+        encode_binary::encode_hailo_roi(roi, buffer);
+        HailoROIPtr decoded = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+        CHECK_THROWS_AS( decode_binary::decode_hailo_roi(buffer.data(), buffer.size(), decoded), binary_meta::FormatError );
+        CHECK( decoded->get_objects().empty() );
+    }
+}
+
+TEST_CASE( "Binary meta is smaller than JSON", "[binary_meta]" ) {
+    HailoROIPtr roi = make_frame(20, 160);
+    std::string json = to_json_string(roi);
+    std::vector<uint8_t> buffer;
+    encode_binary::encode_hailo_roi(roi, buffer);
+    CHECK( buffer.size() < json.size() );
+}
+
+// Hidden, run with: binary_meta_unit_tests "[benchmark]"
+TEST_CASE( "Binary meta against JSON, bytes and time per frame", "[.][benchmark]" ) {
+    const int iterations = 200;
+    HailoROIPtr roi = make_frame(20, 160);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t json_bytes = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        rapidjson::Document document = encode_json::encode_hailo_roi(roi);
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        document.Accept(writer);
+        json_bytes = buffer.GetSize();
+
+        rapidjson::Document decoded_stream;
+        decoded_stream.Parse(buffer.GetString(), buffer.GetSize());
+        HailoROIPtr decoded = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+        decode_json::decode_hailo_roi(decoded_stream, decoded);
+    }
+    auto json_end = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> buffer;
+    for (int i = 0; i < iterations; i++)
+    {
+        buffer.clear();
+        encode_binary::encode_hailo_roi(roi, buffer);
+        HailoROIPtr decoded = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+        decode_binary::decode_hailo_roi(buffer.data(), buffer.size(), decoded);
+    }
+    auto binary_end = std::chrono::steady_clock::now();
+
+    double json_us = std::chrono::duration<double, std::micro>(json_end - start).count() / iterations;
+    double binary_us = std::chrono::duration<double, std::micro>(binary_end - json_end).count() / iterations;
+    // The JSON decoder skips masks, so only the binary side pays for decoding the mask
+    std::cout << "frame: 20 detections (classification, id, 17 landmarks, 512 float embedding), 160x160 class mask" << std::endl;
+    std::cout << "json:   " << json_bytes << " bytes/frame, " << json_us << " us/frame (encode + decode)" << std::endl;
+    std::cout << "binary: " << buffer.size() << " bytes/frame, " << binary_us << " us/frame (encode + decode)" << std::endl;
+    CHECK( buffer.size() < json_bytes );
+}
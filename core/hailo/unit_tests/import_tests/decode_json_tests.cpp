@@ -170,4 +170,23 @@ TEST_CASE( "The decode_json can decode JSON objects into Hailo Objects", "[decod
         CHECK( test_json["HailoROI"]["SubObjects"][1]["HailoUniqueID"]["unique_id"] == unique_ids[1]->get_id() );
         CHECK( test_json["HailoROI"]["SubObjects"][1]["HailoUniqueID"]["mode"] == unique_ids[1]->get_mode() );
     }
-}
\ No newline at end of file
+
+    SECTION( "Base64 matrices whose data doesn't match their dimensions are refused." ) {
+        HailoROIPtr main_roi_ptr = std::make_shared<HailoROI>(main_bbox);
+        // "AACAPw==" is the single float 1.0
+        rapidjson::Document test_json;
+        test_json.Parse(R"({"HailoROI": {"SubObjects": [{"HailoMatrix": {"width": 1, "height": 1, "features": 1, "data_base64": "AACAPw=="}}]}})");
+        decode_json::decode_hailo_roi(test_json, main_roi_ptr);
+        auto matrix = std::dynamic_pointer_cast<HailoMatrix>(main_roi_ptr->get_objects_typed(HAILO_MATRIX)[0]);
+        REQUIRE( matrix != nullptr );
+        CHECK( matrix->get_data() == std::vector<float>{1.0f} );
+
+        rapidjson::Document short_json;
+        short_json.Parse(R"({"HailoROI": {"SubObjects": [{"HailoMatrix": {"width": 1, "height": 1, "features": 2, "data_base64": "AACAPw=="}}]}})");
+        CHECK_THROWS_AS( decode_json::decode_hailo_roi(short_json, main_roi_ptr), std::invalid_argument );
+
+        rapidjson::Document invalid_json;
+        invalid_json.Parse(R"({"HailoROI": {"SubObjects": [{"HailoMatrix": {"width": 1, "height": 1, "features": 1, "data_base64": "AA*APw=="}}]}})");
+        CHECK_THROWS_AS( decode_json::decode_hailo_roi(invalid_json, main_roi_ptr), std::invalid_argument );
+    }
+}
@@ -0,0 +1,200 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tappas includes
+#include "common/frame_matcher.hpp"
+
+#define MS (1000)
+#define FRAME_NS (33 * GST_MSECOND)
+
+static GstBuffer *buffer_with_pts(guint64 pts)
+{
+    gst_init(NULL, NULL);
+    GstBuffer *buffer = gst_buffer_new();
+    GST_BUFFER_PTS(buffer) = pts;
+    return buffer;
+}
+
+// Released main frames, by PTS and whether all their sub buffers arrived
+struct Released
+{
+    guint64 pts;
+    bool complete;
+    bool operator==(const Released &other) const { return pts == other.pts && complete == other.complete; }
+};
+
+static std::vector<Released> release_ready(HailoFrameMatcher &matcher, gint64 now)
+{
+    std::vector<Released> released;
+    matcher.release_ready(now, [&released](HailoPendingFrame &frame) {
+        released.push_back({frame.key, frame.complete()});
+        gst_buffer_unref(frame.buffer);
+    });
+    return released;
+}
+
+// Hand a sub buffer to the matcher as hailoaggregator does
+static void add_sub(HailoFrameMatcher &matcher, guint64 pts)
+{
+    GstBuffer *sub = buffer_with_pts(pts);
+    HailoPendingFrame *frame = matcher.find_main(pts);
+    if (frame == nullptr)
+    {
+        GstBuffer *evicted = matcher.add_sub(sub, pts);
+        if (evicted)
+            gst_buffer_unref(evicted);
+        return;
+    }
+    frame->received++;
+    matcher.expire_older_than(pts);
+    gst_buffer_unref(sub);
+}
+
+// Add a main frame and take the sub buffers that arrived before it
+static void add_main(HailoFrameMatcher &matcher, guint64 pts, guint expected, gint64 now)
+{
+    HailoPendingFrame &frame = matcher.add_main(buffer_with_pts(pts), pts, expected, now);
+    auto on_stale = [](GstBuffer *stale) { gst_buffer_unref(stale); };
+    while (!frame.complete())
+    {
+        GstBuffer *sub = matcher.take_sub(pts, on_stale);
+        if (!sub)
+            break;
+        frame.received++;
+        gst_buffer_unref(sub);
+    }
+}
+
+TEST_CASE( "HailoFrameMatcher matches sub buffers with their main frame.", "[frame_matcher]" ) {
+    HailoFrameMatcher matcher;
+    matcher.configure(0, 500 * MS, 8);
+
+    SECTION( "Sub buffers after the main frame." ) {
+        add_main(matcher, 0, 2, 0);
+        add_sub(matcher, 0);
+        CHECK( release_ready(matcher, 0).empty() );
+        add_sub(matcher, 0);
+        CHECK( release_ready(matcher, 0) == std::vector<Released>({{0, true}}) );
+    }
+
+    SECTION( "Sub buffers before the main frame." ) {
+        add_sub(matcher, FRAME_NS);
+        add_sub(matcher, FRAME_NS);
+        add_main(matcher, FRAME_NS, 2, 0);
+        CHECK( release_ready(matcher, 0) == std::vector<Released>({{FRAME_NS, true}}) );
+    }
+
+    SECTION( "Within the tolerance." ) {
+        matcher.configure(GST_MSECOND, 500 * MS, 8);
+        add_main(matcher, FRAME_NS, 1, 0);
+        add_sub(matcher, FRAME_NS + GST_MSECOND);
+        CHECK( release_ready(matcher, 0) == std::vector<Released>({{FRAME_NS, true}}) );
+    }
+
+    matcher.clear(gst_buffer_unref);
+    CHECK( matcher.empty() );
+}
+
+TEST_CASE( "HailoFrameMatcher handles out of order and missing sub buffers.", "[frame_matcher]" ) {
+    HailoFrameMatcher matcher;
+    matcher.configure(0, 500 * MS, 8);
+
+    SECTION( "A sub buffer of a later frame expires the earlier frames, frames leave in arrival order." ) {
+        add_main(matcher, 0, 1, 0);
+        add_main(matcher, FRAME_NS, 1, 0);
+        add_main(matcher, 2 * FRAME_NS, 1, 0);
+        add_sub(matcher, FRAME_NS);
+        CHECK( release_ready(matcher, 0) == std::vector<Released>({{0, false}, {FRAME_NS, true}}) );
+        add_sub(matcher, 2 * FRAME_NS);
+        CHECK( release_ready(matcher, 0) == std::vector<Released>({{2 * FRAME_NS, true}}) );
+    }
+
+    SECTION( "Sub buffers whose main frame is gone are dropped." ) {
+        add_sub(matcher, 0);
+        add_sub(matcher, FRAME_NS);
+        add_main(matcher, FRAME_NS, 1, 0);
+        CHECK( release_ready(matcher, 0) == std::vector<Released>({{FRAME_NS, true}}) );
+        CHECK( matcher.empty() );
+    }
+
+    SECTION( "A full window releases its oldest frame." ) {
+        matcher.configure(0, 500 * MS, 2);
+        add_main(matcher, 0, 1, 0);
+        add_main(matcher, FRAME_NS, 1, 0);
+        add_main(matcher, 2 * FRAME_NS, 1, 0);
+        CHECK( release_ready(matcher, 0) == std::vector<Released>({{0, false}}) );
+    }
+
+    SECTION( "A full sub window drops its oldest sub buffer." ) {
+        matcher.configure(0, 500 * MS, 8, 2);
+        add_sub(matcher, 0);
+        add_sub(matcher, FRAME_NS);
+        add_sub(matcher, 2 * FRAME_NS);
+        add_main(matcher, 0, 1, 0);
+        CHECK( release_ready(matcher, 0).empty() );
+        add_main(matcher, FRAME_NS, 1, 0);
+        CHECK( release_ready(matcher, 0).empty() );
+        add_main(matcher, 2 * FRAME_NS, 1, 0);
+        // The first frame's sub buffer was dropped, so it waits for its timeout
+        CHECK( release_ready(matcher, 0).empty() );
+        CHECK( release_ready(matcher, 500 * MS) == std::vector<Released>({{0, false}, {FRAME_NS, true}, {2 * FRAME_NS, true}}) );
+    }
+
+    matcher.clear(gst_buffer_unref);
+}
+
+TEST_CASE( "HailoFrameMatcher releases main frames on their timeout.", "[frame_matcher]" ) {
+    HailoFrameMatcher matcher;
+    matcher.configure(0, 500 * MS, 8);
+    CHECK( matcher.next_deadline() == -1 );
+
+    add_main(matcher, 0, 1, 1000 * MS);
+    add_main(matcher, FRAME_NS, 0, 1033 * MS);
+    CHECK( matcher.next_deadline() == 1500 * MS );
+    CHECK( release_ready(matcher, 1499 * MS).empty() );
+    // The complete frame waited behind the timed out one
+    CHECK( release_ready(matcher, 1500 * MS) == std::vector<Released>({{0, false}, {FRAME_NS, true}}) );
+    CHECK( matcher.next_deadline() == -1 );
+}
+
+TEST_CASE( "HailoMatchTimer releases timed out frames when no buffers arrive.", "[frame_matcher]" ) {
+    std::mutex mutex;
+    HailoFrameMatcher matcher;
+    matcher.configure(0, 20 * MS, 8);
+    std::atomic<int> released(0);
+
+    HailoMatchTimer timer;
+    timer.start(
+        mutex, [&matcher]() { return matcher.next_deadline(); },
+        [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            released += release_ready(matcher, g_get_monotonic_time()).size();
+        });
+
+    gint64 start = g_get_monotonic_time();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        add_main(matcher, 0, 1, start);
+        timer.wake();
+    }
+    while (released == 0 && g_get_monotonic_time() - start < 2000 * MS)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK( released == 1 );
+    CHECK( g_get_monotonic_time() - start >= 20 * MS );
+    timer.stop();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK( matcher.empty() );
+}
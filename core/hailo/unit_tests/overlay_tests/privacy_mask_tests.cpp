@@ -0,0 +1,132 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <cstdlib>
+#include <vector>
+
+// Tappas includes
+#include "overlay/privacy_mask.hpp"
+
+// Reference rasterizer: a pixel is masked if its center is inside any polygon (even-odd crossing test)
+static bool reference_inside(const std::vector<std::vector<cv::Point>> &polygons, double px, double py)
+{
+    for (const std::vector<cv::Point> &polygon : polygons)
+    {
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+        {
+            double xi = polygon[i].x, yi = polygon[i].y, xj = polygon[j].x, yj = polygon[j].y;
+            if ((yi > py) != (yj > py) && px < (xj - xi) * (py - yi) / (yj - yi) + xi)
+                inside = !inside;
+        }
+        if (inside)
+            return true;
+    }
+    return false;
+}
+
+static std::vector<uint8_t> spans_to_mask(const PrivacyMaskSpans &spans)
+{
+    std::vector<uint8_t> mask(spans.width * spans.height, 0);
+    for (int y = 0; y < spans.height; y++)
+        for (uint32_t i = spans.row_start[y]; i < spans.row_start[y + 1]; i++)
+            for (int x = spans.spans[i].x0; x < spans.spans[i].x1; x++)
+                mask[y * spans.width + x]++;
+    return mask;
+}
+
+static std::vector<std::vector<cv::Point>> random_polygons(int count, int width, int height)
+{
+    std::vector<std::vector<cv::Point>> polygons;
+    for (int p = 0; p < count; p++)
+    {
+        std::vector<cv::Point> polygon;
+        int vertices = 3 + rand() % 12;
+        for (int v = 0; v < vertices; v++)
+            polygon.emplace_back(rand() % (width + 40) - 20, rand() % (height + 40) - 20);
+        polygons.push_back(polygon);
+    }
+    return polygons;
+}
+
+TEST_CASE( "Rasterized spans match a reference rasterizer.", "[privacy_mask]" ) {
+    srand(7);
+    const int width = 160, height = 120;
+    for (int round = 0; round < 50; round++)
+    {
+        auto polygons = random_polygons(1 + round % 4, width, height);
+        for (int subsample : {1, 2})
+        {
+            PrivacyMaskSpans spans = privacy_mask::rasterize(polygons, width / subsample, height / subsample, subsample, subsample);
+            std::vector<uint8_t> mask = spans_to_mask(spans);
+            size_t mismatches = 0, overlapping = 0;
+            for (int y = 0; y < spans.height; y++)
+            {
+                for (int x = 0; x < spans.width; x++)
+                {
+                    bool expected = reference_inside(polygons, (x + 0.5) * subsample, (y + 0.5) * subsample);
+                    mismatches += (mask[y * spans.width + x] > 0) != expected;
+                    overlapping += mask[y * spans.width + x] > 1;
+                }
+            }
+            CHECK( mismatches == 0 );
+            // Overlapping polygons are merged, no pixel is drawn twice
+            CHECK( overlapping == 0 );
+        }
+    }
+}
+
+TEST_CASE( "Privacy masks are drawn on the masked pixels of every plane only.", "[privacy_mask]" ) {
+    const int width = 64, height = 48;
+    std::vector<uint8_t> y_plane(width * height, 100);
+    std::vector<uint8_t> uv_plane(width * height / 2, 50);
+    std::vector<AnonymizePlane> planes = {{y_plane.data(), width, 1, width, height, 1, 1},
+                                          {uv_plane.data(), width, 2, width / 2, height / 2, 2, 2},
+                                          {uv_plane.data() + 1, width, 2, width / 2, height / 2, 2, 2}};
+    PrivacyMaskRenderer renderer;
+    auto config = std::make_shared<PrivacyMaskConfig>();
+    config->polygons = {{{8, 8}, {40, 8}, {40, 24}, {8, 24}}};
+    renderer.set_config(config);
+
+    SECTION( "Fill converts the color for YUV and is rasterized once." ) {
+        renderer.apply(planes, true);
+        renderer.apply(planes, true);
+        CHECK( renderer.get_rasterize_count() == 1 );
+        CHECK( y_plane[10 * width + 10] == 16 );
+        CHECK( y_plane[30 * width + 10] == 100 );
+        CHECK( uv_plane[5 * width + 5 * 2] == 128 );
+        CHECK( uv_plane[5 * width + 5 * 2 + 1] == 128 );
+        CHECK( uv_plane[15 * width + 5 * 2] == 50 );
+    }
+
+    SECTION( "Pixelate makes every block uniform and keeps the pixels outside." ) {
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                y_plane[y * width + x] = static_cast<uint8_t>(x * 3 + y);
+        config->mode = PRIVACY_MASK_MODE_PIXELATE;
+        config->block_size = 8;
+        renderer.apply(planes, true);
+        for (int y = 8; y < 16; y++)
+            for (int x = 8; x < 16; x++)
+                CHECK( y_plane[y * width + x] == y_plane[8 * width + 8] );
+        CHECK( y_plane[8 * width + 8] != y_plane[8 * width + 16] );
+        CHECK( y_plane[30 * width + 20] == 20 * 3 + 30 );
+    }
+
+    SECTION( "A new config is picked up on the next frame." ) {
+        renderer.apply(planes, false);
+        auto moved = std::make_shared<PrivacyMaskConfig>(*config);
+        moved->polygons = {{{40, 30}, {60, 30}, {60, 46}}};
+        moved->color = cv::Scalar(255, 255, 255);
+        renderer.set_config(moved);
+        renderer.apply(planes, false);
+        CHECK( renderer.get_rasterize_count() == 2 );
+        CHECK( y_plane[40 * width + 58] == 255 );
+    }
+}
@@ -0,0 +1,253 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Tappas includes
+#include "common/region_anonymizer.hpp"
+
+enum class TestFormat
+{
+    NV12,
+    YUY2,
+    RGB,
+    RGBA,
+};
+
+// An image in one buffer, with the planes the anonymizer sees
+struct TestImage
+{
+    int width, height;
+    std::vector<uint8_t> data;
+    std::vector<AnonymizePlane> planes;
+
+    TestImage(TestFormat format, int width, int height, uint32_t seed) : width(width), height(height)
+    {
+        switch (format)
+        {
+        case TestFormat::NV12:
+            data.resize(width * height * 3 / 2);
+            planes = {{data.data(), width, 1, width, height, 1, 1},
+                      {data.data() + width * height, width, 2, width / 2, height / 2, 2, 2},
+                      {data.data() + width * height + 1, width, 2, width / 2, height / 2, 2, 2}};
+            break;
+        case TestFormat::YUY2:
+            data.resize(width * height * 2);
+            planes = {{data.data(), width * 2, 2, width, height, 1, 1},
+                      {data.data() + 1, width * 2, 4, width / 2, height, 2, 1},
+                      {data.data() + 3, width * 2, 4, width / 2, height, 2, 1}};
+            break;
+        case TestFormat::RGB:
+        case TestFormat::RGBA:
+        {
+            int channels = (format == TestFormat::RGB) ? 3 : 4;
+            data.resize(width * height * channels);
+            for (int c = 0; c < channels; c++)
+                planes.push_back({data.data() + c, width * channels, channels, width, height, 1, 1});
+            break;
+        }
+        }
+        std::mt19937 rng(seed);
+        for (uint8_t &value : data)
+            value = rng() % 256;
+    }
+
+    TestImage(const TestImage &) = delete;
+};
+
+/**
+ * @brief A naive anonymization of one region, straight from the definitions: every sample of the region on a plane
+ *        becomes the average of the samples of its (clipped) box or its block, read from before the region was touched.
+ *        Marks the bytes it may change in covered.
+ */
+void reference_anonymize(TestImage &image, const cv::Rect &region, const AnonymizeParams &params, std::vector<bool> &covered)
+{
+    std::vector<uint8_t> before = image.data;
+    for (const AnonymizePlane &plane : image.planes)
+    {
+        auto index = [&](int x, int y)
+        { return static_cast<size_t>(plane.data - image.data.data()) + y * plane.stride + x * plane.step; };
+        int x0 = region.x / plane.subsample_x;
+        int y0 = region.y / plane.subsample_y;
+        int x1 = std::min((region.x + region.width + plane.subsample_x - 1) / plane.subsample_x, plane.width);
+        int y1 = std::min((region.y + region.height + plane.subsample_y - 1) / plane.subsample_y, plane.height);
+        for (int y = y0; y < y1; y++)
+        {
+            for (int x = x0; x < x1; x++)
+            {
+                int left, right, top, bottom;
+                if (params.mode == ANONYMIZE_MODE_PIXELATE)
+                {
+                    int block_x = std::max(params.kernel_size / plane.subsample_x, 1);
+                    int block_y = std::max(params.kernel_size / plane.subsample_y, 1);
+                    left = x0 + (x - x0) / block_x * block_x;
+                    top = y0 + (y - y0) / block_y * block_y;
+                    right = std::min(left + block_x, x1);
+                    bottom = std::min(top + block_y, y1);
+                }
+                else
+                {
+                    int radius = params.kernel_size / 2;
+                    int radius_x = std::max(radius / plane.subsample_x, 1);
+                    int radius_y = std::max(radius / plane.subsample_y, 1);
+                    left = std::max(x - radius_x, 0);
+                    top = std::max(y - radius_y, 0);
+                    right = std::min(x + radius_x + 1, plane.width);
+                    bottom = std::min(y + radius_y + 1, plane.height);
+                }
+                uint32_t sum = 0;
+                uint32_t count = (right - left) * (bottom - top);
+                for (int ky = top; ky < bottom; ky++)
+                    for (int kx = left; kx < right; kx++)
+                        sum += before[index(kx, ky)];
+                image.data[index(x, y)] = static_cast<uint8_t>((sum + count / 2) / count);
+                covered[index(x, y)] = true;
+            }
+        }
+    }
+}
+
+// Largest difference between the anonymized image and the reference, -1 if a byte no region covers was changed
+int compare_with_reference(TestFormat format, int width, int height, const std::vector<cv::Rect> &rects, const AnonymizeParams &params, uint n_threads)
+{
+    TestImage image(format, width, height, 7);
+    TestImage reference(format, width, height, 7);
+    std::vector<bool> covered(reference.data.size(), false);
+    std::vector<AnonymizeRegion> regions;
+    for (const cv::Rect &rect : rects)
+    {
+        regions.emplace_back(rect);
+        reference_anonymize(reference, rect, params, covered);
+    }
+    anonymize_regions(image.planes, regions, params, n_threads);
+
+    int max_difference = 0;
+    for (size_t i = 0; i < image.data.size(); i++)
+    {
+        int difference = std::abs(int(image.data[i]) - int(reference.data[i]));
+        if (!covered[i] && difference != 0)
+            return -1;
+        max_difference = std::max(max_difference, difference);
+    }
+    return max_difference;
+}
+
+// Apart from each other in luma, at odd coordinates, on the image borders and clipped by them
+const std::vector<cv::Rect> TEST_RECTS = {
+    cv::Rect(0, 0, 37, 41),
+    cv::Rect(101, 33, 64, 80),
+    cv::Rect(177, 9, 31, 31),
+    cv::Rect(250, 150, 70, 90),
+    cv::Rect(3, 200, 120, 39),
+};
+
+TEST_CASE( "Blur matches a naive box filter", "[region_anonymizer]" ) {
+    for (int kernel_size : {3, 13, 64})
+    {
+        AnonymizeParams params;
+        params.mode = ANONYMIZE_MODE_BLUR;
+        params.kernel_size = kernel_size;
+        INFO( "kernel size " << kernel_size );
+        // The fixed point reciprocal may round the other way than the exact division
+        for (uint n_threads : {1, 4})
+        {
+            int nv12 = compare_with_reference(TestFormat::NV12, 320, 240, TEST_RECTS, params, n_threads);
+            CHECK( (nv12 >= 0 && nv12 <= 1) );
+        }
+        int yuy2 = compare_with_reference(TestFormat::YUY2, 320, 240, TEST_RECTS, params, 4);
+        CHECK( (yuy2 >= 0 && yuy2 <= 1) );
+        int rgb = compare_with_reference(TestFormat::RGB, 320, 240, TEST_RECTS, params, 4);
+        CHECK( (rgb >= 0 && rgb <= 1) );
+    }
+}
+
+TEST_CASE( "Pixelation matches naive block averages", "[region_anonymizer]" ) {
+    for (int kernel_size : {2, 9, 16})
+    {
+        AnonymizeParams params;
+        params.mode = ANONYMIZE_MODE_PIXELATE;
+        params.kernel_size = kernel_size;
+        INFO( "kernel size " << kernel_size );
+        CHECK( compare_with_reference(TestFormat::NV12, 320, 240, TEST_RECTS, params, 4) == 0 );
+        CHECK( compare_with_reference(TestFormat::YUY2, 320, 240, TEST_RECTS, params, 4) == 0 );
+        CHECK( compare_with_reference(TestFormat::RGBA, 320, 240, TEST_RECTS, params, 4) == 0 );
+    }
+}
+
+TEST_CASE( "Regions are anonymized in parallel only when they don't touch on any plane", "[region_anonymizer]" ) {
+    TestImage nv12(TestFormat::NV12, 320, 240, 1);
+    std::vector<AnonymizePlane> luma_only = {nv12.planes[0]};
+
+    SECTION( "Pixelated regions apart in luma that share a chroma sample depend on each other." ) {
+        AnonymizeParams params;
+        params.mode = ANONYMIZE_MODE_PIXELATE;
+        std::vector<AnonymizeRegion> regions = {AnonymizeRegion(cv::Rect(0, 0, 101, 50)), AnonymizeRegion(cv::Rect(101, 0, 50, 50))};
+        CHECK( region_anonymizer_internal::dependent_regions(luma_only, regions, params) == std::vector<bool>({false, false}) );
+        CHECK( region_anonymizer_internal::dependent_regions(nv12.planes, regions, params) == std::vector<bool>({true, true}) );
+    }
+
+    SECTION( "The blur reach is rounded on each plane." ) {
+        AnonymizeParams params;
+        params.mode = ANONYMIZE_MODE_BLUR;
+        params.kernel_size = 13;
+        // On luma the first region reads up to x 106, on chroma it reads up to sample 53, where the second one starts
+        std::vector<AnonymizeRegion> regions = {AnonymizeRegion(cv::Rect(0, 0, 101, 50)), AnonymizeRegion(cv::Rect(107, 0, 50, 50))};
+        CHECK( region_anonymizer_internal::dependent_regions(luma_only, regions, params) == std::vector<bool>({false, false}) );
+        CHECK( region_anonymizer_internal::dependent_regions(nv12.planes, regions, params) == std::vector<bool>({true, true}) );
+
+        regions[1] = AnonymizeRegion(cv::Rect(110, 0, 50, 50));
+        CHECK( region_anonymizer_internal::dependent_regions(nv12.planes, regions, params) == std::vector<bool>({false, false}) );
+    }
+
+    SECTION( "Crowded random regions give the same result as anonymizing them one by one." ) {
+        std::mt19937 rng(3);
+        std::vector<cv::Rect> rects;
+        for (int i = 0; i < 40; i++)
+            rects.emplace_back(rng() % 300, rng() % 220, 1 + rng() % 40, 1 + rng() % 40);
+        AnonymizeParams params;
+        params.kernel_size = 7;
+        for (anonymize_mode_t mode : {ANONYMIZE_MODE_BLUR, ANONYMIZE_MODE_PIXELATE})
+        {
+            params.mode = mode;
+            TestImage serial(TestFormat::NV12, 320, 240, 5);
+            TestImage parallel(TestFormat::NV12, 320, 240, 5);
+            std::vector<AnonymizeRegion> regions(rects.begin(), rects.end());
+            for (const AnonymizeRegion &region : regions)
+                anonymize_regions(serial.planes, {region}, params, 1);
+            anonymize_regions(parallel.planes, regions, params, 4);
+            CHECK( serial.data == parallel.data );
+        }
+    }
+}
+
+TEST_CASE( "Polygon regions leave the pixels outside the polygon untouched", "[region_anonymizer]" ) {
+    TestImage image(TestFormat::NV12, 320, 240, 9);
+    std::vector<uint8_t> before = image.data;
+    std::vector<cv::Point> triangle = {cv::Point(40, 40), cv::Point(200, 60), cv::Point(60, 200)};
+    AnonymizeParams params;
+    anonymize_regions(image.planes, {AnonymizeRegion(triangle)}, params, 1);
+
+    int changed_inside = 0;
+    for (int y = 0; y < image.height; y++)
+    {
+        for (int x = 0; x < image.width; x++)
+        {
+            bool changed = image.data[y * image.width + x] != before[y * image.width + x];
+            // Well outside the triangle: left of its left edge or beyond its bounding rect
+            bool outside = x < 40 || y < 40 || x > 200 || y > 200 || (x < 40 + (y - 40) / 8);
+            if (outside)
+                CHECK_FALSE( changed );
+            else
+                changed_inside += changed;
+        }
+    }
+    CHECK( changed_inside > 0 );
+}
@@ -0,0 +1,120 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// Tappas includes
+#include "detection_extrapolator.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point START = Clock::time_point(std::chrono::seconds(1000));
+
+Clock::time_point frame_pts(int frame, int fps=30)
+{
+    return START + std::chrono::microseconds(frame * 1000000 / fps);
+}
+
+// A box of the given size that started centered at (x0, y0) and moves at (vx, vy) per second
+ExtrapolatedDetection box_at(float x0, float y0, float vx, float vy, float width, float height, int frame, int class_id=1, int track_id=-1)
+{
+    float t = frame / 30.0f;
+    return {x0 + vx * t - width / 2, y0 + vy * t - height / 2, width, height, class_id, "object", 0.9f, track_id};
+}
+
+float iou(const ExtrapolatedDetection &a, const ExtrapolatedDetection &b)
+{
+    float overlap_width = std::min(a.xmin + a.width, b.xmin + b.width) - std::max(a.xmin, b.xmin);
+    float overlap_height = std::min(a.ymin + a.height, b.ymin + b.height) - std::max(a.ymin, b.ymin);
+    if (overlap_width <= 0.0f || overlap_height <= 0.0f)
+        return 0.0f;
+    float intersection = overlap_width * overlap_height;
+    return intersection / (a.width * a.height + b.width * b.height - intersection);
+}
+
+TEST_CASE( "Extrapolated detections follow a synthetic trajectory", "[detection_extrapolator]" ) {
+    DetectionExtrapolator extrapolator;
+
+    SECTION( "An untracked box at constant velocity is predicted with a high IoU, better than replaying it." ) {
+        for (int frame = 0; frame < 10; frame++)
+            extrapolator.update({box_at(0.2f, 0.3f, 0.3f, 0.15f, 0.1f, 0.1f, frame)}, frame_pts(frame));
+        ExtrapolatedDetection last = box_at(0.2f, 0.3f, 0.3f, 0.15f, 0.1f, 0.1f, 9);
+
+        for (int frame = 10; frame < 15; frame++)
+        {
+            std::vector<ExtrapolatedDetection> predicted = extrapolator.predict(frame_pts(frame));
+            ExtrapolatedDetection truth = box_at(0.2f, 0.3f, 0.3f, 0.15f, 0.1f, 0.1f, frame);
+            REQUIRE( predicted.size() == 1 );
+            CHECK( iou(predicted[0], truth) > 0.95f );
+            CHECK( iou(predicted[0], truth) > iou(last, truth) );
+        }
+    }
+
+    SECTION( "A growing box keeps growing." ) {
+        for (int frame = 0; frame < 10; frame++)
+        {
+            float size = 0.1f + 0.01f * frame;
+            extrapolator.update({box_at(0.5f, 0.5f, 0.0f, 0.0f, size, size, frame)}, frame_pts(frame));
+        }
+        std::vector<ExtrapolatedDetection> predicted = extrapolator.predict(frame_pts(14));
+        REQUIRE( predicted.size() == 1 );
+        CHECK( iou(predicted[0], box_at(0.5f, 0.5f, 0.0f, 0.0f, 0.24f, 0.24f, 14)) > 0.95f );
+    }
+
+    SECTION( "Tracked boxes are matched by track id, even when they cross." ) {
+        for (int frame = 0; frame < 10; frame++)
+        {
+            extrapolator.update({box_at(0.3f, 0.5f, 0.6f, 0.0f, 0.1f, 0.1f, frame, 1, 7),
+                                 box_at(0.7f, 0.5f, -0.6f, 0.0f, 0.1f, 0.1f, frame, 1, 8)},
+                                frame_pts(frame));
+        }
+        std::vector<ExtrapolatedDetection> predicted = extrapolator.predict(frame_pts(14));
+        REQUIRE( predicted.size() == 2 );
+        for (const ExtrapolatedDetection &detection : predicted)
+        {
+            ExtrapolatedDetection truth = (detection.track_id == 7) ? box_at(0.3f, 0.5f, 0.6f, 0.0f, 0.1f, 0.1f, 14, 1, 7)
+                                                                    : box_at(0.7f, 0.5f, -0.6f, 0.0f, 0.1f, 0.1f, 14, 1, 8);
+            CHECK( iou(detection, truth) > 0.9f );
+        }
+    }
+
+    SECTION( "Untracked boxes of another class aren't matched." ) {
+        extrapolator.update({box_at(0.5f, 0.5f, 0.0f, 0.0f, 0.2f, 0.2f, 0, 1)}, frame_pts(0));
+        extrapolator.update({box_at(0.55f, 0.5f, 0.0f, 0.0f, 0.2f, 0.2f, 1, 2)}, frame_pts(1));
+        std::vector<ExtrapolatedDetection> predicted = extrapolator.predict(frame_pts(10));
+        REQUIRE( predicted.size() == 1 );
+        CHECK( iou(predicted[0], box_at(0.55f, 0.5f, 0.0f, 0.0f, 0.2f, 0.2f, 1, 2)) == Approx(1.0f) );
+    }
+
+    SECTION( "A box seen once stays where it was, with its class, label, confidence and track id." ) {
+        ExtrapolatedDetection detection = box_at(0.5f, 0.5f, 0.0f, 0.0f, 0.2f, 0.2f, 0, 3, 11);
+        extrapolator.update({detection}, frame_pts(0));
+        std::vector<ExtrapolatedDetection> predicted = extrapolator.predict(frame_pts(5));
+        REQUIRE( predicted.size() == 1 );
+        CHECK( iou(predicted[0], detection) == Approx(1.0f) );
+        CHECK( predicted[0].class_id == 3 );
+        CHECK( predicted[0].label == "object" );
+        CHECK( predicted[0].confidence == Approx(0.9f) );
+        CHECK( predicted[0].track_id == 11 );
+    }
+
+    SECTION( "Boxes are clipped to the frame, and left out once they moved out of it." ) {
+        for (int frame = 0; frame < 10; frame++)
+            extrapolator.update({box_at(0.6f, 0.5f, 1.0f, 0.0f, 0.1f, 0.1f, frame)}, frame_pts(frame));
+        std::vector<ExtrapolatedDetection> predicted = extrapolator.predict(frame_pts(12));
+        REQUIRE( predicted.size() == 1 );
+        CHECK( predicted[0].xmin + predicted[0].width <= 1.0f );
+        CHECK( extrapolator.predict(frame_pts(30)).empty() );
+        CHECK_FALSE( extrapolator.empty() );
+        extrapolator.clear();
+        CHECK( extrapolator.empty() );
+    }
+}
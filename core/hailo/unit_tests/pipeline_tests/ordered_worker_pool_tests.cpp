@@ -0,0 +1,242 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Tappas includes
+#include "ordered_worker_pool.hpp"
+
+// Blocks the workers that reach it until it is opened
+class Gate
+{
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_open = false;
+
+public:
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]
+                  { return m_open; });
+    }
+
+    void open()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = true;
+        m_cv.notify_all();
+    }
+};
+
+bool is_in_order(const std::vector<uint64_t> &outputs)
+{
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        if (outputs[i] != i)
+            return false;
+    }
+    return true;
+}
+
+TEST_CASE( "The ordered worker pool hands items on in submission order", "[ordered_worker_pool]" ) {
+    SECTION( "Items with random latency are handed on in the order they were submitted." ) {
+        const uint64_t num_items = 500;
+        std::vector<uint64_t> outputs;
+        std::atomic<size_t> concurrent(0);
+        std::atomic<size_t> max_concurrent(0);
+        {
+            OrderedWorkerPool<uint64_t> pool(
+                4, 8,
+                [&](size_t, uint64_t &seq)
+                {
+                    size_t now = ++concurrent;
+                    size_t max = max_concurrent.load();
+                    while (now > max && !max_concurrent.compare_exchange_weak(max, now))
+                        ;
+                    // Seeded by the item, so every run sees the same latencies
+                    std::mt19937 rng(seq);
+                    std::this_thread::sleep_for(std::chrono::microseconds(rng() % 2000));
+                    concurrent--;
+                },
+                [&](uint64_t &seq)
+                { outputs.push_back(seq); });
+            for (uint64_t i = 0; i < num_items; i++)
+                CHECK( pool.submit(i) == i );
+            pool.drain();
+            CHECK( pool.get_num_workers() == 4 );
+            CHECK( pool.get_reordered_count() <= num_items );
+        }
+        REQUIRE( outputs.size() == num_items );
+        CHECK( is_in_order(outputs) );
+        CHECK( max_concurrent.load() <= 4 );
+    }
+
+    SECTION( "A single worker never reorders." ) {
+        std::vector<uint64_t> outputs;
+        std::atomic<bool> other_worker(false);
+        OrderedWorkerPool<uint64_t> pool(
+            1, 0,
+            [&](size_t worker_index, uint64_t &)
+            {
+                if (worker_index != 0)
+                    other_worker = true;
+            },
+            [&](uint64_t &seq)
+            { outputs.push_back(seq); });
+        for (uint64_t i = 0; i < 100; i++)
+            pool.submit(i);
+        pool.drain();
+        CHECK( outputs.size() == 100 );
+        CHECK( is_in_order(outputs) );
+        CHECK( pool.get_reordered_count() == 0 );
+        CHECK_FALSE( other_worker.load() );
+    }
+}
+
+TEST_CASE( "The ordered worker pool bounds the out of order window", "[ordered_worker_pool]" ) {
+    SECTION( "A window smaller than the number of workers is widened to twice the workers." ) {
+        auto noop = [](size_t, int &) {};
+        auto drop = [](int &) {};
+        CHECK( OrderedWorkerPool<int>(4, 2, noop, drop).get_window() == 8 );
+        CHECK( OrderedWorkerPool<int>(4, 0, noop, drop).get_window() == 8 );
+        CHECK( OrderedWorkerPool<int>(4, 6, noop, drop).get_window() == 6 );
+        CHECK( OrderedWorkerPool<int>(0, 0, noop, drop).get_num_workers() == 1 );
+    }
+
+    SECTION( "No item is worked on while a window's worth of items before it wasn't handed on." ) {
+        std::atomic<uint64_t> output_count(0);
+        std::atomic<bool> window_exceeded(false);
+        OrderedWorkerPool<uint64_t> pool(
+            3, 5,
+            [&](size_t, uint64_t &seq)
+            {
+                if (seq - output_count.load() >= 5)
+                    window_exceeded = true;
+                std::mt19937 rng(seq);
+                std::this_thread::sleep_for(std::chrono::microseconds(rng() % 1000));
+            },
+            [&](uint64_t &)
+            { output_count++; });
+        for (uint64_t i = 0; i < 200; i++)
+            pool.submit(i);
+        pool.drain();
+        CHECK( output_count.load() == 200 );
+        CHECK_FALSE( window_exceeded.load() );
+    }
+
+    SECTION( "A stuck item blocks submit once the window is full, and releases it when it finishes." ) {
+        const size_t window = 4;
+        Gate gate;
+        std::vector<uint64_t> outputs;
+        std::atomic<size_t> submitted(0);
+        OrderedWorkerPool<uint64_t> pool(
+            2, window,
+            [&](size_t, uint64_t &seq)
+            {
+                if (seq == 0)
+                    gate.wait();
+            },
+            [&](uint64_t &seq)
+            { outputs.push_back(seq); });
+
+        std::thread submitter([&]
+                              {
+                                  for (uint64_t i = 0; i < 2 * window; i++)
+                                  {
+                                      pool.submit(i);
+                                      submitted++;
+                                  } });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // The items after the stuck one finished, but wait in the reorder buffer
+        CHECK( submitted.load() == window );
+        CHECK( outputs.empty() );
+
+        gate.open();
+        submitter.join();
+        pool.drain();
+        CHECK( submitted.load() == 2 * window );
+        CHECK( outputs.size() == 2 * window );
+        CHECK( is_in_order(outputs) );
+        CHECK( pool.get_reordered_count() >= window - 1 );
+    }
+}
+
+TEST_CASE( "The ordered worker pool shuts down with items in flight", "[ordered_worker_pool]" ) {
+    SECTION( "Destroying the pool with pending items hands on an in order prefix and frees the rest." ) {
+        std::vector<uint64_t> outputs;
+        std::vector<std::weak_ptr<uint64_t>> items;
+        {
+            OrderedWorkerPool<std::shared_ptr<uint64_t>> pool(
+                2, 16,
+                [](size_t, std::shared_ptr<uint64_t> &)
+                { std::this_thread::sleep_for(std::chrono::milliseconds(5)); },
+                [&](std::shared_ptr<uint64_t> &item)
+                { outputs.push_back(*item); });
+            for (uint64_t i = 0; i < 16; i++)
+            {
+                auto item = std::make_shared<uint64_t>(i);
+                items.push_back(item);
+                pool.submit(item);
+            }
+        }
+        CHECK( outputs.size() < 16 );
+        CHECK( is_in_order(outputs) );
+        for (auto &item : items)
+            CHECK( item.expired() );
+    }
+
+    SECTION( "Destroying the pool waits for a busy worker and doesn't hand on anything after the stop." ) {
+        Gate gate;
+        std::vector<uint64_t> outputs;
+        std::atomic<bool> stuck_item_started(false);
+        std::thread opener;
+        {
+            OrderedWorkerPool<uint64_t> pool(
+                2, 4,
+                [&](size_t, uint64_t &seq)
+                {
+                    if (seq == 0)
+                    {
+                        stuck_item_started = true;
+                        gate.wait();
+                    }
+                },
+                [&](uint64_t &seq)
+                { outputs.push_back(seq); });
+            for (uint64_t i = 0; i < 4; i++)
+                pool.submit(i);
+            while (!stuck_item_started.load())
+                std::this_thread::yield();
+            // Opened only after the destructor started waiting for the stuck worker
+            opener = std::thread([&]
+                                 {
+                                     std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                                     gate.open(); });
+        }
+        opener.join();
+        CHECK( outputs.empty() );
+    }
+
+    SECTION( "Destroying an idle pool returns right away." ) {
+        auto start = std::chrono::steady_clock::now();
+        {
+            OrderedWorkerPool<int> pool(
+                4, 0, [](size_t, int &) {}, [](int &) {});
+        }
+        CHECK( std::chrono::steady_clock::now() - start < std::chrono::seconds(1) );
+    }
+}
@@ -0,0 +1,259 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Tappas includes
+#include "rtp_packetizer.hpp"
+
+using Bytes = std::vector<uint8_t>;
+
+// A NAL unit with the given header and random payload bytes, none of them 0 so there are no start code emulations
+Bytes make_nal(Bytes header, size_t size, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    Bytes nal = header;
+    while (nal.size() < size)
+        nal.push_back(1 + rng() % 255);
+    return nal;
+}
+
+Bytes h264_nal(int type, size_t size, uint32_t seed)
+{
+    return make_nal({uint8_t(0x60 | type)}, size, seed);
+}
+
+Bytes h265_nal(int type, size_t size, uint32_t seed)
+{
+    return make_nal({uint8_t(type << 1), 0x01}, size, seed);
+}
+
+// An Annex B access unit, alternating 4 and 3 byte start codes
+Bytes annex_b(const std::vector<Bytes> &nal_units)
+{
+    Bytes access_unit;
+    for (size_t i = 0; i < nal_units.size(); i++)
+    {
+        if (i % 2 == 0)
+            access_unit.push_back(0);
+        access_unit.insert(access_unit.end(), {0, 0, 1});
+        access_unit.insert(access_unit.end(), nal_units[i].begin(), nal_units[i].end());
+    }
+    return access_unit;
+}
+
+/**
+ * @brief A reference depacketizer following RFC 6184 / RFC 7798, with the checks on the RTP header.
+ */
+struct Depacketizer
+{
+    EncodingType type;
+    size_t mtu;
+    std::vector<Bytes> nal_units;
+    Bytes fragment;
+    bool in_fragment = false;
+    int single = 0, aggregated = 0, fragments = 0;
+    bool valid = true;
+    const char *error = "";
+
+    void fail(const char *reason)
+    {
+        valid = false;
+        error = reason;
+    }
+
+    uint16_t read16(const uint8_t *data)
+    {
+        return (data[0] << 8) | data[1];
+    }
+
+    void depacketize_access_unit(const RtpPacketizer &packetizer, const std::vector<RtpPacket> &packets, uint32_t timestamp, uint16_t &sequence)
+    {
+        for (size_t i = 0; i < packets.size(); i++)
+        {
+            Bytes packet(packetizer.get_header(packets[i]), packetizer.get_header(packets[i]) + packets[i].header_size);
+            packet.insert(packet.end(), packets[i].payload, packets[i].payload + packets[i].payload_size);
+            if (packet.size() > mtu)
+                fail("packet larger than the mtu");
+            if (packet[0] != 0x80)
+                fail("not RTP version 2 without padding, extension and CSRC");
+            if ((packet[1] & 0x7F) != RTP_PAYLOAD_TYPE)
+                fail("wrong payload type");
+            if (bool(packet[1] & 0x80) != (i + 1 == packets.size()))
+                fail("marker not only on the last packet of the access unit");
+            if (read16(&packet[2]) != sequence++)
+                fail("sequence numbers not consecutive");
+            uint32_t packet_timestamp = (uint32_t(packet[4]) << 24) | (packet[5] << 16) | (packet[6] << 8) | packet[7];
+            if (packet_timestamp != timestamp)
+                fail("wrong timestamp");
+            uint32_t ssrc = (uint32_t(packet[8]) << 24) | (packet[9] << 16) | (packet[10] << 8) | packet[11];
+            if (ssrc != packetizer.get_ssrc())
+                fail("wrong ssrc");
+            depacketize(packet.data() + RTP_HEADER_SIZE, packet.size() - RTP_HEADER_SIZE);
+        }
+        if (in_fragment)
+            fail("access unit ended inside a fragmented NAL unit");
+    }
+
+    void depacketize(const uint8_t *payload, size_t size)
+    {
+        int nal_type = (type == EncodingType::H264) ? (payload[0] & 0x1F) : ((payload[0] >> 1) & 0x3F);
+        bool is_aggregate = (type == EncodingType::H264) ? (nal_type == 24) : (nal_type == 48);
+        bool is_fragment = (type == EncodingType::H264) ? (nal_type == 28) : (nal_type == 49);
+        size_t header_size = (type == EncodingType::H264) ? 1 : 2;
+        if (is_aggregate)
+        {
+            aggregated++;
+            size_t offset = header_size;
+            while (offset < size)
+            {
+                if (offset + 2 > size)
+                    return fail("truncated aggregation size");
+                size_t nal_size = read16(payload + offset);
+                offset += 2;
+                if (offset + nal_size > size)
+                    return fail("truncated aggregated NAL unit");
+                nal_units.emplace_back(payload + offset, payload + offset + nal_size);
+                offset += nal_size;
+            }
+        }
+        else if (is_fragment)
+        {
+            fragments++;
+            size_t fu_size = header_size + 1;
+            uint8_t fu_header = payload[fu_size - 1];
+            if (fu_header & 0x80)
+            {
+                if (in_fragment)
+                    return fail("fragment started inside another");
+                in_fragment = true;
+                fragment.clear();
+                if (type == EncodingType::H264)
+                {
+                    fragment.push_back((payload[0] & 0xE0) | (fu_header & 0x1F));
+                }
+                else
+                {
+                    fragment.push_back((payload[0] & 0x81) | ((fu_header & 0x3F) << 1));
+                    fragment.push_back(payload[1]);
+                }
+            }
+            else if (!in_fragment)
+            {
+                return fail("fragment continued without a start");
+            }
+            fragment.insert(fragment.end(), payload + fu_size, payload + size);
+            if (fu_header & 0x40)
+            {
+                nal_units.push_back(fragment);
+                in_fragment = false;
+            }
+        }
+        else
+        {
+            single++;
+            nal_units.emplace_back(payload, payload + size);
+        }
+    }
+};
+
+TEST_CASE( "H.264 access units survive packetizing and a reference depacketizer", "[rtp_packetizer]" ) {
+    const size_t mtu = 400;
+    RtpPacketizer packetizer(EncodingType::H264, mtu, 0x12345678, 65530);
+    Depacketizer depacketizer{EncodingType::H264, mtu};
+    uint16_t sequence = 65530; // Wraps around during the test
+
+    Bytes delimiter = h264_nal(9, 2, 1);
+    Bytes sps = h264_nal(7, 24, 2);
+    Bytes pps = h264_nal(8, 6, 3);
+    Bytes idr = h264_nal(5, 5000, 4);
+    Bytes slice = h264_nal(1, 120, 5);
+
+    SECTION( "An IDR frame: parameter sets aggregated in a STAP-A, the slice fragmented in FU-A, the delimiter dropped." ) {
+        Bytes access_unit = annex_b({delimiter, sps, pps, idr});
+        const std::vector<RtpPacket> &packets = packetizer.packetize(access_unit.data(), access_unit.size(), 3000);
+        depacketizer.depacketize_access_unit(packetizer, packets, 3000, sequence);
+        INFO( depacketizer.error );
+        CHECK( depacketizer.valid );
+        CHECK( depacketizer.nal_units == std::vector<Bytes>({sps, pps, idr}) );
+        CHECK( depacketizer.aggregated == 1 );
+        CHECK( depacketizer.fragments == int((idr.size() - 1 + (mtu - RTP_HEADER_SIZE - 2) - 1) / (mtu - RTP_HEADER_SIZE - 2)) );
+        CHECK( depacketizer.single == 0 );
+    }
+
+    SECTION( "Consecutive access units keep the sequence numbers running and carry their own timestamps." ) {
+        for (uint32_t frame = 0; frame < 5; frame++)
+        {
+            Bytes access_unit = (frame == 0) ? annex_b({sps, pps, idr}) : annex_b({delimiter, slice});
+            const std::vector<RtpPacket> &packets = packetizer.packetize(access_unit.data(), access_unit.size(), frame * 3000);
+            depacketizer.depacketize_access_unit(packetizer, packets, frame * 3000, sequence);
+        }
+        INFO( depacketizer.error );
+        CHECK( depacketizer.valid );
+        std::vector<Bytes> expected = {sps, pps, idr, slice, slice, slice, slice};
+        CHECK( depacketizer.nal_units == expected );
+        CHECK( depacketizer.single == 4 );
+    }
+
+    SECTION( "Parameter sets that don't fit together are split over several packets." ) {
+        Bytes big_sps = h264_nal(7, 300, 6);
+        Bytes big_pps = h264_nal(8, 300, 7);
+        Bytes access_unit = annex_b({big_sps, big_pps, pps, slice});
+        const std::vector<RtpPacket> &packets = packetizer.packetize(access_unit.data(), access_unit.size(), 0);
+        depacketizer.depacketize_access_unit(packetizer, packets, 0, sequence);
+        INFO( depacketizer.error );
+        CHECK( depacketizer.valid );
+        CHECK( depacketizer.nal_units == std::vector<Bytes>({big_sps, big_pps, pps, slice}) );
+    }
+
+    SECTION( "A byte stream without start codes is a single NAL unit." ) {
+        const std::vector<RtpPacket> &packets = packetizer.packetize(slice.data(), slice.size(), 0);
+        depacketizer.depacketize_access_unit(packetizer, packets, 0, sequence);
+        CHECK( depacketizer.valid );
+        CHECK( depacketizer.nal_units == std::vector<Bytes>({slice}) );
+    }
+}
+
+TEST_CASE( "H.265 access units survive packetizing and a reference depacketizer", "[rtp_packetizer]" ) {
+    const size_t mtu = 1400;
+    RtpPacketizer packetizer(EncodingType::H265, mtu, 0xCAFEBABE, 100);
+    Depacketizer depacketizer{EncodingType::H265, mtu};
+    uint16_t sequence = 100;
+
+    Bytes delimiter = h265_nal(35, 3, 1);
+    Bytes vps = h265_nal(32, 24, 2);
+    Bytes sps = h265_nal(33, 40, 3);
+    Bytes pps = h265_nal(34, 8, 4);
+    Bytes idr = h265_nal(19, 20000, 5);
+    Bytes trail = h265_nal(1, 900, 6);
+
+    SECTION( "An IDR frame: parameter sets aggregated in an AP, the slice fragmented in FUs, the delimiter dropped." ) {
+        Bytes access_unit = annex_b({delimiter, vps, sps, pps, idr, trail});
+        const std::vector<RtpPacket> &packets = packetizer.packetize(access_unit.data(), access_unit.size(), 90000);
+        depacketizer.depacketize_access_unit(packetizer, packets, 90000, sequence);
+        INFO( depacketizer.error );
+        CHECK( depacketizer.valid );
+        CHECK( depacketizer.nal_units == std::vector<Bytes>({vps, sps, pps, idr, trail}) );
+        CHECK( depacketizer.aggregated == 1 );
+        CHECK( depacketizer.fragments > 1 );
+        CHECK( depacketizer.single == 1 );
+    }
+
+    SECTION( "The FU and AP headers keep the layer id and temporal id of the NAL units." ) {
+        Bytes layered = make_nal({uint8_t((1 << 1) | 0x01), uint8_t((3 << 3) | 2)}, 3000, 7);
+        Bytes access_unit = annex_b({vps, sps, layered});
+        const std::vector<RtpPacket> &packets = packetizer.packetize(access_unit.data(), access_unit.size(), 0);
+        depacketizer.depacketize_access_unit(packetizer, packets, 0, sequence);
+        INFO( depacketizer.error );
+        CHECK( depacketizer.valid );
+        CHECK( depacketizer.nal_units == std::vector<Bytes>({vps, sps, layered}) );
+    }
+}
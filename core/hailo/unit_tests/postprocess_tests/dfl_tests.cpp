@@ -0,0 +1,247 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Tappas includes
+#include "common/dfl.hpp"
+
+static const float SCORE_SCALE = 1.0f / 255.0f;
+static const float SCORE_ZP = 0.0f;
+static const float BIN_SCALE = 0.05f;
+static const float BIN_ZP = 128.0f;
+static const int NUM_CLASSES = 20; // Not a multiple of 16, so the scan has a tail
+static const int REGRESSION_LENGTH = 15;
+static const int NUM_BINS = REGRESSION_LENGTH + 1;
+
+static float dequantize(uint8_t value, float qp_scale, float qp_zp)
+{
+    return (float(value) - qp_zp) * qp_scale;
+}
+
+// One output level: the scores and DFL bins of every anchor, in separate NHWC buffers
+struct TestLevel
+{
+    common::DflAnchorGrid grid;
+    std::vector<uint8_t> scores;
+    std::vector<uint8_t> bins;
+};
+
+// Mostly low scores with a few high ones, and random bins
+static std::vector<TestLevel> make_levels(std::mt19937 &random)
+{
+    std::vector<TestLevel> levels;
+    for (common::DflAnchorGrid &grid : common::make_dfl_anchor_grids({64, 64}, {8, 16, 32}))
+    {
+        TestLevel level = {grid, std::vector<uint8_t>(grid.num_anchors() * NUM_CLASSES), std::vector<uint8_t>(grid.num_anchors() * 4 * NUM_BINS)};
+        for (uint8_t &score : level.scores)
+            score = (random() % 10 == 0) ? random() % 256 : random() % 64;
+        for (uint8_t &bin : level.bins)
+            bin = random() % 256;
+        levels.push_back(std::move(level));
+    }
+    return levels;
+}
+
+// The float path the kernels replace: dequantize, take the best class, softmax the bins
+static std::vector<common::DflCandidate> float_candidates(const std::vector<TestLevel> &levels, float threshold)
+{
+    std::vector<common::DflCandidate> candidates;
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        const TestLevel &level = levels[l];
+        for (int anchor = 0; anchor < level.grid.num_anchors(); anchor++)
+        {
+            int best_class = 0;
+            float best_score = -1.0f;
+            for (int c = 0; c < NUM_CLASSES; c++)
+            {
+                float score = dequantize(level.scores[anchor * NUM_CLASSES + c], SCORE_SCALE, SCORE_ZP);
+                if (score > best_score)
+                {
+                    best_score = score;
+                    best_class = c;
+                }
+            }
+            if (best_score < threshold)
+                continue;
+
+            float distances[4];
+            for (int side = 0; side < 4; side++)
+            {
+                const uint8_t *bins = level.bins.data() + anchor * 4 * NUM_BINS + side * NUM_BINS;
+                double max_logit = -1e9, sum = 0.0, weighted_sum = 0.0;
+                for (int k = 0; k < NUM_BINS; k++)
+                    max_logit = std::max(max_logit, double(dequantize(bins[k], BIN_SCALE, BIN_ZP)));
+                for (int k = 0; k < NUM_BINS; k++)
+                {
+                    double e = std::exp(dequantize(bins[k], BIN_SCALE, BIN_ZP) - max_logit);
+                    sum += e;
+                    weighted_sum += e * k;
+                }
+                distances[side] = float(weighted_sum / sum) * level.grid.stride;
+            }
+            float center_x = level.grid.center_x(anchor);
+            float center_y = level.grid.center_y(anchor);
+            candidates.push_back({center_x - distances[0], center_y - distances[1], center_x + distances[2], center_y + distances[3],
+                                  best_score, best_class, int(l), anchor});
+        }
+    }
+    return candidates;
+}
+
+static std::vector<common::DflCandidate> quantized_candidates(const std::vector<TestLevel> &levels, float threshold)
+{
+    std::vector<common::DflCandidate> candidates;
+    int quantized = common::quantized_threshold(threshold, SCORE_SCALE, SCORE_ZP, UINT8_MAX, common::identity_activation, true);
+    common::DflExpTable exp_table(BIN_SCALE);
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        const TestLevel &level = levels[l];
+        common::dfl_collect_candidates(level.scores.data(), NUM_CLASSES, NUM_CLASSES, quantized,
+                                       level.bins.data(), 4 * NUM_BINS, exp_table, level.grid, l, level.grid.num_anchors(), REGRESSION_LENGTH,
+                                       [](uint8_t score) { return dequantize(score, SCORE_SCALE, SCORE_ZP); },
+                                       candidates);
+    }
+    return candidates;
+}
+
+static float reference_iou(const common::DflCandidate &a, const common::DflCandidate &b)
+{
+    float width = std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin);
+    float height = std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin);
+    if (width <= 0.0f || height <= 0.0f)
+        return 0.0f;
+    float overlap = width * height;
+    return overlap / ((a.xmax - a.xmin) * (a.ymax - a.ymin) + (b.xmax - b.xmin) * (b.ymax - b.ymin) - overlap);
+}
+
+static void check_same_candidates(const std::vector<common::DflCandidate> &actual, const std::vector<common::DflCandidate> &expected)
+{
+    REQUIRE(actual.size() == expected.size());
+    for (size_t i = 0; i < actual.size(); i++)
+    {
+        INFO("candidate " << i << ", level " << expected[i].level << ", anchor " << expected[i].anchor);
+        REQUIRE(actual[i].level == expected[i].level);
+        REQUIRE(actual[i].anchor == expected[i].anchor);
+        CHECK(actual[i].class_id == expected[i].class_id);
+        CHECK(actual[i].confidence == expected[i].confidence);
+        CHECK(actual[i].xmin == Approx(expected[i].xmin).margin(1e-3));
+        CHECK(actual[i].ymin == Approx(expected[i].ymin).margin(1e-3));
+        CHECK(actual[i].xmax == Approx(expected[i].xmax).margin(1e-3));
+        CHECK(actual[i].ymax == Approx(expected[i].ymax).margin(1e-3));
+    }
+}
+
+TEST_CASE("The SIMD score scan agrees with a scalar loop", "[dfl]")
+{
+    std::mt19937 random(47);
+    std::vector<uint8_t> buffer(128 + 16);
+    for (int count : {0, 1, 15, 16, 17, 20, 31, 32, 33, 80, 128})
+    {
+        for (int trial = 0; trial < 200; trial++)
+        {
+            // Unaligned starts, and the largest score anywhere, including the tail after the last 16 scores
+            int offset = random() % 16;
+            for (uint8_t &value : buffer)
+                value = random() % 200;
+            if (count > 0 && trial % 2 == 0)
+                buffer[offset + random() % count] = 200 + random() % 56;
+            const uint8_t *scores = buffer.data() + offset;
+            for (int threshold : {0, 1, 100, 199, 200, 201, 254, 255, 256})
+            {
+                bool expected = std::any_of(scores, scores + count, [threshold](uint8_t score) { return score >= threshold; });
+                INFO("count " << count << ", threshold " << threshold);
+                REQUIRE(common::any_score_passes(scores, count, threshold) == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("The best score index is the first of the highest scores", "[dfl]")
+{
+    std::vector<uint8_t> scores = {3, 9, 1, 9, 0};
+    CHECK(common::best_score_index(scores.data(), 5) == 1);
+    CHECK(common::best_score_index(scores.data(), 1) == 0);
+}
+
+TEST_CASE("DFL candidates match the float decode", "[dfl]")
+{
+    std::mt19937 random(7);
+    std::vector<TestLevel> levels = make_levels(random);
+
+    SECTION("The same anchors pass, with the same class, confidence and box.")
+    {
+        for (float threshold : {0.3f, 0.5f, 0.9f})
+        {
+            INFO("threshold " << threshold);
+            std::vector<common::DflCandidate> expected = float_candidates(levels, threshold);
+            REQUIRE(!expected.empty());
+            check_same_candidates(quantized_candidates(levels, threshold), expected);
+        }
+    }
+
+    SECTION("A threshold exactly on a quantized score keeps that score.")
+    {
+        // Anchor 0 of the first level has 200 as its best score, on a class past the last 16 scores
+        std::fill(levels[0].scores.begin(), levels[0].scores.begin() + NUM_CLASSES, 10);
+        levels[0].scores[NUM_CLASSES - 2] = 200;
+        auto is_planted = [](const common::DflCandidate &candidate) { return candidate.level == 0 && candidate.anchor == 0; };
+
+        float threshold = dequantize(200, SCORE_SCALE, SCORE_ZP);
+        std::vector<common::DflCandidate> candidates = quantized_candidates(levels, threshold);
+        check_same_candidates(candidates, float_candidates(levels, threshold));
+        auto planted = std::find_if(candidates.begin(), candidates.end(), is_planted);
+        REQUIRE(planted != candidates.end());
+        CHECK(planted->class_id == NUM_CLASSES - 2);
+        CHECK(planted->confidence == threshold);
+
+        candidates = quantized_candidates(levels, std::nextafter(threshold, 1.0f));
+        CHECK(std::none_of(candidates.begin(), candidates.end(), is_planted));
+    }
+
+    SECTION("Nothing passes a threshold above the largest score.")
+    {
+        CHECK(quantized_candidates(levels, 1.5f).empty());
+    }
+}
+
+TEST_CASE("DFL NMS matches a greedy NMS of the float decode", "[dfl]")
+{
+    std::mt19937 random(11);
+    std::vector<TestLevel> levels = make_levels(random);
+    std::vector<common::DflCandidate> expected = float_candidates(levels, 0.3f);
+    std::vector<common::DflCandidate> candidates = quantized_candidates(levels, 0.3f);
+
+    for (bool cross_classes : {false, true})
+    {
+        INFO("cross classes " << cross_classes);
+        // Greedy NMS over the float candidates, best first, ties in collection order
+        std::vector<common::DflCandidate> sorted = expected;
+        std::stable_sort(sorted.begin(), sorted.end(), [](const common::DflCandidate &a, const common::DflCandidate &b)
+                         { return a.confidence > b.confidence; });
+        std::vector<common::DflCandidate> expected_survivors;
+        for (const common::DflCandidate &candidate : sorted)
+        {
+            bool suppressed = std::any_of(expected_survivors.begin(), expected_survivors.end(), [&](const common::DflCandidate &survivor)
+                                          { return (cross_classes || survivor.class_id == candidate.class_id) &&
+                                                   reference_iou(survivor, candidate) >= 0.5f; });
+            if (!suppressed)
+                expected_survivors.push_back(candidate);
+        }
+        REQUIRE(expected_survivors.size() < expected.size());
+
+        std::vector<common::DflCandidate> survivors;
+        common::dfl_nms(candidates, 0.5f, cross_classes, survivors);
+        check_same_candidates(survivors, expected_survivors);
+    }
+}
@@ -0,0 +1,119 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "filter/postprocess_batcher.hpp"
+
+// Frames are numbered, the postprocess tags every roi with a classification
+struct BatcherTestOutput
+{
+    std::mutex mutex;
+    std::vector<int> output;
+    std::vector<int> discarded;
+    std::vector<size_t> batch_sizes;
+    std::vector<void *> batch_params;
+};
+
+static std::unique_ptr<PostprocessBatcher<int>> make_batcher(BatcherTestOutput &result, uint batch_size, uint batch_timeout_ms, uint num_workers,
+                                                             int process_time_us = 0)
+{
+    return std::make_unique<PostprocessBatcher<int>>(
+        batch_size, batch_timeout_ms, num_workers,
+        [&result, process_time_us](std::vector<HailoROIPtr> &rois, void *params)
+        {
+            {
+                std::lock_guard<std::mutex> lock(result.mutex);
+                result.batch_sizes.push_back(rois.size());
+                result.batch_params.push_back(params);
+            }
+            for (HailoROIPtr &roi : rois)
+            {
+                // Later batches often finish first
+                std::this_thread::sleep_for(std::chrono::microseconds(process_time_us * (1 + rand() % 4)));
+                roi->add_object(std::make_shared<HailoClassification>("test", "done", 1.0f));
+            }
+        },
+        [&result](int frame, HailoROIPtr roi)
+        {
+            // Catch assertions aren't thread safe, a frame handed on before its postprocess shows as -1
+            std::lock_guard<std::mutex> lock(result.mutex);
+            result.output.push_back(roi->get_objects().size() == 1 ? frame : -1);
+        },
+        [&result](int frame)
+        {
+            std::lock_guard<std::mutex> lock(result.mutex);
+            result.discarded.push_back(frame);
+        });
+}
+
+static HailoROIPtr make_roi()
+{
+    return std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+}
+
+TEST_CASE( "PostprocessBatcher postprocesses batches in parallel and keeps the frame order", "[postprocess_batcher]" ) {
+    BatcherTestOutput result;
+
+    SECTION( "Frames come out in submit order with several workers." ) {
+        auto batcher = make_batcher(result, 4, 1000, 4, 200);
+        for (int frame = 0; frame < 200; frame++)
+            batcher->submit(frame, make_roi(), nullptr);
+        batcher->drain();
+        REQUIRE( result.output.size() == 200 );
+        for (int frame = 0; frame < 200; frame++)
+            CHECK( result.output[frame] == frame );
+        for (size_t batch_size : result.batch_sizes)
+            CHECK( batch_size == 4 );
+    }
+
+    SECTION( "A partial batch is dispatched after the batch timeout." ) {
+        auto batcher = make_batcher(result, 8, 20, 2);
+        batcher->submit(0, make_roi(), nullptr);
+        batcher->submit(1, make_roi(), nullptr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::lock_guard<std::mutex> lock(result.mutex);
+        CHECK( result.output == std::vector<int>{0, 1} );
+        CHECK( result.batch_sizes == std::vector<size_t>{2} );
+    }
+
+    SECTION( "A batch is processed with the params of all its frames." ) {
+        auto first_params = std::make_shared<int>(1);
+        auto second_params = std::make_shared<int>(2);
+        auto batcher = make_batcher(result, 4, 1000, 1);
+        batcher->submit(0, make_roi(), first_params);
+        batcher->submit(1, make_roi(), first_params);
+        batcher->submit(2, make_roi(), second_params);
+        batcher->drain();
+        CHECK( result.output == std::vector<int>{0, 1, 2} );
+        CHECK( result.batch_sizes == std::vector<size_t>{2, 1} );
+        CHECK( result.batch_params == std::vector<void *>{first_params.get(), second_params.get()} );
+    }
+
+    SECTION( "Frames are discarded while flushing, and on destruction." ) {
+        auto batcher = make_batcher(result, 4, 1000, 2, 100);
+        for (int frame = 0; frame < 6; frame++)
+            batcher->submit(frame, make_roi(), nullptr);
+        batcher->set_flushing(true);
+        batcher->submit(6, make_roi(), nullptr);
+        batcher->set_flushing(false);
+        batcher->submit(7, make_roi(), nullptr);
+        batcher.reset();
+        CHECK( result.output.size() + result.discarded.size() == 8 );
+        CHECK( std::find(result.output.begin(), result.output.end(), 6) == result.output.end() );
+        CHECK( std::find(result.discarded.begin(), result.discarded.end(), 7) != result.discarded.end() );
+    }
+}
@@ -0,0 +1,118 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Tappas includes
+#include "filter/postprocess_params_cache.hpp"
+
+// A stand-in for the init / free_resources of a postprocess library
+struct TestParams
+{
+    std::string config;
+};
+
+static int init_calls = 0;
+static int free_calls = 0;
+
+void *test_init(std::string config_path, std::string function_name)
+{
+    init_calls++;
+    std::ifstream file(config_path);
+    std::stringstream content;
+    content << file.rdbuf();
+    if (content.str().find("invalid") != std::string::npos)
+        throw std::runtime_error("json config file doesn't follow schema rules");
+    return new TestParams{content.str()};
+}
+
+void test_free(void *params_void_ptr)
+{
+    free_calls++;
+    delete reinterpret_cast<TestParams *>(params_void_ptr);
+}
+
+static void write_config(const std::string &path, const std::string &content)
+{
+    std::ofstream file(path, std::ios::trunc);
+    file << content;
+}
+
+static std::string params_config(const PostprocessParamsHandle &handle)
+{
+    return reinterpret_cast<TestParams *>(handle.get())->config;
+}
+
+TEST_CASE( "Filters with the same library, function and config share their params", "[postprocess_params_cache]" ) {
+    const std::string first_path = "/tmp/postprocess_params_cache_test_0.json";
+    const std::string second_path = "/tmp/postprocess_params_cache_test_1.json";
+    write_config(first_path, "{\"detection_threshold\": 0.3}");
+    write_config(second_path, "{\"detection_threshold\": 0.3}");
+    init_calls = 0;
+    free_calls = 0;
+
+    SECTION( "Identical configs are initialized once, and freed with the last filter." ) {
+        auto first = new PostprocessParamsHandle("libyolo_post.so", "yolov5", first_path, test_init, test_free);
+        auto second = new PostprocessParamsHandle("libyolo_post.so", "yolov5", second_path, test_init, test_free);
+        CHECK( init_calls == 1 );
+        CHECK( first->get() == second->get() );
+        CHECK( PostprocessParamsCache::GetInstance().size() == 1 );
+        delete first;
+        CHECK( free_calls == 0 );
+        delete second;
+        CHECK( free_calls == 1 );
+        CHECK( PostprocessParamsCache::GetInstance().size() == 0 );
+    }
+
+    SECTION( "Another function or another config gets its own params." ) {
+        PostprocessParamsHandle yolov5("libyolo_post.so", "yolov5", first_path, test_init, test_free);
+        PostprocessParamsHandle yolox("libyolo_post.so", "yolox", first_path, test_init, test_free);
+        write_config(second_path, "{\"detection_threshold\": 0.5}");
+        PostprocessParamsHandle other_config("libyolo_post.so", "yolov5", second_path, test_init, test_free);
+        CHECK( init_calls == 3 );
+        CHECK( yolov5.get() != yolox.get() );
+        CHECK( yolov5.get() != other_config.get() );
+    }
+
+    SECTION( "A changed config file is swapped in, the previous params live until no filter uses them." ) {
+        PostprocessParamsHandle first("libyolo_post.so", "yolov5", first_path, test_init, test_free);
+        PostprocessParamsHandle second("libyolo_post.so", "yolov5", first_path, test_init, test_free);
+        CHECK_FALSE( first.reload_if_changed() );
+
+        write_config(first_path, "{\"detection_threshold\": 0.55}");
+        REQUIRE( first.reload_if_changed() );
+        CHECK( params_config(first) == "{\"detection_threshold\": 0.55}" );
+        CHECK( params_config(second) == "{\"detection_threshold\": 0.3}" );
+        CHECK( free_calls == 0 );
+
+        // The second filter picks up the params the first one created
+        REQUIRE( second.reload_if_changed() );
+        CHECK( second.get() == first.get() );
+        CHECK( init_calls == 2 );
+        CHECK( free_calls == 1 );
+    }
+
+    SECTION( "A config that fails to initialize keeps the previous params." ) {
+        PostprocessParamsHandle handle("libyolo_post.so", "yolov5", first_path, test_init, test_free);
+        void *params = handle.get();
+        write_config(first_path, "{\"detection_threshold\": invalid");
+        CHECK_THROWS_AS( handle.reload_if_changed(), std::runtime_error );
+        CHECK( handle.get() == params );
+        // The broken content is not retried every check
+        CHECK_FALSE( handle.reload_if_changed() );
+        CHECK( init_calls == 2 );
+    }
+
+    std::remove(first_path.c_str());
+    std::remove(second_path.c_str());
+}
@@ -0,0 +1,122 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Tappas includes
+#include "common/quantized_classification.hpp"
+
+// The float path the kernels replace: dequantize everything, then decide
+template <typename T>
+static std::vector<float> dequantize_all(const std::vector<T> &values, float qp_scale, float qp_zp)
+{
+    std::vector<float> dequantized;
+    for (T value : values)
+        dequantized.push_back((float(value) - qp_zp) * qp_scale);
+    return dequantized;
+}
+
+template <typename T>
+static std::vector<T> random_values(std::mt19937 &random, int count, int max_value)
+{
+    std::uniform_int_distribution<int> distribution(0, max_value);
+    std::vector<T> values(count);
+    for (T &value : values)
+        value = distribution(random);
+    return values;
+}
+
+TEMPLATE_TEST_CASE("Quantized kernels decide like the dequantized floats", "[quantized_classification]", uint8_t, uint16_t)
+{
+    std::mt19937 random(7);
+    const int max_value = common::QuantizedScores<TestType>::max_value();
+    for (int round = 0; round < 50; round++)
+    {
+        int count = 1 + random() % 1000;
+        // Few distinct values, so there are ties
+        std::vector<TestType> values = random_values<TestType>(random, count, round % 2 ? 15 : max_value);
+        float qp_scale = 0.001f + (random() % 1000) / 5000.0f;
+        float qp_zp = random() % (max_value + 1);
+        common::QuantizedScores<TestType> scores = {values.data(), count, 1, qp_scale, qp_zp};
+        std::vector<float> floats = dequantize_all(values, qp_scale, qp_zp);
+
+        // argmax: the first of the highest
+        int expected_best = std::max_element(floats.begin(), floats.end()) - floats.begin();
+        REQUIRE(common::quantized_argmax(scores) == expected_best);
+
+        // top k: by descending score, ties by ascending index
+        int k = 1 + random() % 10;
+        std::vector<int> expected_order(count);
+        std::iota(expected_order.begin(), expected_order.end(), 0);
+        std::stable_sort(expected_order.begin(), expected_order.end(), [&floats](int a, int b)
+                         { return floats[a] > floats[b]; });
+        std::vector<int> top(k);
+        int found = common::quantized_top_k(scores, k, top.data());
+        REQUIRE(found == std::min(k, count));
+        for (int i = 0; i < found; i++)
+            REQUIRE(top[i] == expected_order[i]);
+
+        // grouped argmax of [count / 2, 2]
+        std::vector<int> winners(count / 2);
+        common::quantized_grouped_argmax(scores, 2, winners.data());
+        for (int group = 0; group < count / 2; group++)
+            REQUIRE(winners[group] == (floats[2 * group + 1] > floats[2 * group] ? 1 : 0));
+
+        // softmax of the winner and of a random score, against doubles (float dequantization of wide zero points rounds)
+        auto logit = [&](int i)
+        { return (double(values[i]) - double(values[expected_best])) * qp_scale; };
+        double sum = 0;
+        for (int i = 0; i < count; i++)
+            sum += std::exp(logit(i));
+        int index = random() % count;
+        REQUIRE(common::quantized_softmax(scores, expected_best) == Approx(1.0 / sum).epsilon(1e-4));
+        REQUIRE(common::quantized_softmax(scores, index) == Approx(std::exp(logit(index)) / sum).epsilon(1e-4).margin(1e-30));
+
+        // sigmoid threshold: q >= threshold exactly when the float path passes
+        float threshold = (random() % 100) / 100.0f;
+        int quantized = common::quantized_threshold(threshold, qp_scale, qp_zp, max_value, common::sigmoid_activation);
+        int inclusive = common::quantized_threshold(threshold, qp_scale, qp_zp, max_value, common::sigmoid_activation, true);
+        for (int i = 0; i < count; i++)
+        {
+            REQUIRE((values[i] >= quantized) == (common::sigmoid_activation(floats[i]) > threshold));
+            REQUIRE((values[i] >= inclusive) == (common::sigmoid_activation(floats[i]) >= threshold));
+        }
+    }
+}
+
+TEST_CASE("Quantized threshold covers the whole range", "[quantized_classification]")
+{
+    // Nothing passes
+    CHECK(common::quantized_threshold(3.0f, 0.01f, 0.0f, 255, common::identity_activation) == 256);
+    // Everything passes
+    CHECK(common::quantized_threshold(-1.0f, 0.01f, 0.0f, 255, common::identity_activation) == 0);
+    // Strictly above: 1.0 itself doesn't pass
+    CHECK(common::quantized_threshold(1.0f, 0.01f, 0.0f, 255, common::identity_activation) == 101);
+    CHECK(common::quantized_threshold(1.0f, 0.01f, 0.0f, 65535, common::identity_activation) == 101);
+    // At least: 1.0 itself passes
+    CHECK(common::quantized_threshold(1.0f, 0.01f, 0.0f, 255, common::identity_activation, true) == 100);
+    CHECK(common::quantized_threshold(3.0f, 0.01f, 0.0f, 255, common::identity_activation, true) == 256);
+}
+
+TEST_CASE("Quantized threshold cache follows the quantization", "[quantized_classification]")
+{
+    common::QuantizedThresholdCache<float (*)(float)> thresholds(0.5f, common::sigmoid_activation);
+    std::vector<uint8_t> values = {0, 10, 20};
+    common::QuantizedScores<uint8_t> scores = {values.data(), 3, 1, 0.1f, 10.0f};
+    CHECK(thresholds.get(scores) == 11);
+    scores.qp_zp = 100.0f;
+    CHECK(thresholds.get(scores) == 101);
+    std::vector<uint16_t> wide_values = {0};
+    common::QuantizedScores<uint16_t> wide_scores = {wide_values.data(), 1, 1, 0.1f, 1000.0f};
+    CHECK(thresholds.get(wide_scores) == 1001);
+}
@@ -0,0 +1,152 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "hailo_tracker.hpp"
+#include "recognition_policy.hpp"
+
+static const HailoBBox STILL_BOX(0.4f, 0.2f, 0.1f, 0.4f);
+
+// Run a frame of one track: returns true if the policy recognized it
+static bool run_frame(RecognitionPolicy &policy, const std::string &stream_id, int track_id,
+                      const HailoBBox &bbox = STILL_BOX, float quality = 1.0f)
+{
+    policy.new_frame(stream_id);
+    std::vector<RecognitionCandidate> candidates = {{std::make_shared<HailoROI>(bbox), track_id, bbox, quality,
+                                                     policy.priority(stream_id, track_id, bbox, quality)}};
+    std::vector<HailoROIPtr> crops;
+    policy.select(stream_id, candidates, crops);
+    return !crops.empty();
+}
+
+// Frames (from 1) the track was recognized on, the recognizer answers every recognition with the given confidence
+static std::vector<int> recognized_frames(RecognitionPolicy &policy, const std::string &stream_id, int frames, float confidence,
+                                          float quality = 1.0f)
+{
+    std::vector<int> recognized;
+    for (int frame = 1; frame <= frames; frame++)
+    {
+        if (run_frame(policy, stream_id, 1, STILL_BOX, quality))
+        {
+            recognized.push_back(frame);
+            HailoTracker::GetInstance().report_track_identity(stream_id, 1, 7, confidence, 0.5f);
+        }
+    }
+    return recognized;
+}
+
+TEST_CASE( "RecognitionPolicy backs off confidently identified tracks.", "[recognition_policy]" ) {
+    RecognitionPolicyParams params;
+    params.base_interval = 1;
+    params.max_interval = 8;
+    params.max_age = 1000;
+
+    SECTION( "Unsure tracks are recognized every base interval." ) {
+        RecognitionPolicy policy(params);
+        std::vector<int> recognized = recognized_frames(policy, "unsure", 10, 0.2f);
+        CHECK( recognized.size() == 10 );
+    }
+
+    SECTION( "Every confident answer doubles the interval, up to max_interval." ) {
+        RecognitionPolicy policy(params);
+        std::vector<int> recognized = recognized_frames(policy, "confident", 40, 0.9f);
+        CHECK( recognized == std::vector<int>({1, 3, 7, 15, 23, 31, 39}) );
+    }
+
+    SECTION( "A track is recognized at least every max_age frames." ) {
+        params.max_interval = 64;
+        params.max_age = 10;
+        RecognitionPolicy policy(params);
+        std::vector<int> recognized = recognized_frames(policy, "max_age", 40, 0.9f);
+        CHECK( recognized == std::vector<int>({1, 3, 7, 15, 25, 27, 31, 39}) );
+    }
+}
+
+TEST_CASE( "RecognitionPolicy recognizes again when the track changes.", "[recognition_policy]" ) {
+    RecognitionPolicyParams params;
+    params.max_interval = 32;
+    params.occlusion_frames = 3;
+    RecognitionPolicy policy(params);
+    // Back off far enough that only a trigger recognizes the track
+    recognized_frames(policy, "triggers", 20, 0.9f);
+    REQUIRE_FALSE( run_frame(policy, "triggers", 1) );
+
+    SECTION( "Large motion." ) {
+        CHECK( run_frame(policy, "triggers", 1, HailoBBox(0.6f, 0.2f, 0.1f, 0.4f)) );
+    }
+
+    SECTION( "Small motion doesn't." ) {
+        CHECK_FALSE( run_frame(policy, "triggers", 1, HailoBBox(0.41f, 0.2f, 0.1f, 0.4f)) );
+    }
+
+    SECTION( "A quality jump." ) {
+        CHECK( run_frame(policy, "triggers", 1, STILL_BOX, 2.0f) );
+    }
+
+    SECTION( "A quality that didn't grow doesn't." ) {
+        CHECK_FALSE( run_frame(policy, "triggers", 1, STILL_BOX, 1.2f) );
+    }
+
+    SECTION( "Coming back after an occlusion." ) {
+        for (int frame = 0; frame < 4; frame++)
+            policy.new_frame("triggers");
+        CHECK( run_frame(policy, "triggers", 1) );
+    }
+}
+
+TEST_CASE( "RecognitionPolicy needs a minimum quality to recognize again on a quality jump.", "[recognition_policy]" ) {
+    RecognitionPolicyParams params;
+    params.max_interval = 32;
+    RecognitionPolicy policy(params);
+    // Recognized with no quality at all, any positive quality is an infinite jump
+    recognized_frames(policy, "min_quality", 20, 0.9f, 0.0f);
+    REQUIRE_FALSE( run_frame(policy, "min_quality", 1, STILL_BOX, 0.0f) );
+
+    SECTION( "A quality jump from 0 below the minimum doesn't." ) {
+        CHECK_FALSE( run_frame(policy, "min_quality", 1, STILL_BOX, 0.05f) );
+        CHECK_FALSE( run_frame(policy, "min_quality", 1, STILL_BOX, params.min_quality) );
+    }
+
+    SECTION( "A quality jump from 0 well above the minimum does." ) {
+        CHECK( run_frame(policy, "min_quality", 1, STILL_BOX, 2 * params.min_quality) );
+    }
+}
+
+TEST_CASE( "RecognitionPolicy spends the crops budget on the most overdue tracks.", "[recognition_policy]" ) {
+    RecognitionPolicy policy;
+    policy.set_max_crops(2);
+    std::vector<HailoROIPtr> crops;
+    std::vector<RecognitionCandidate> candidates;
+    auto run = [&](const std::vector<int> &track_ids)
+    {
+        policy.new_frame("budget");
+        candidates.clear();
+        crops.clear();
+        for (int track_id : track_ids)
+            candidates.push_back({std::make_shared<HailoROI>(STILL_BOX), track_id, STILL_BOX, 1.0f,
+                                  policy.priority("budget", track_id, STILL_BOX, 1.0f)});
+        policy.select("budget", candidates, crops);
+        std::vector<int> chosen;
+        for (auto &candidate : candidates)
+            chosen.push_back(candidate.track_id);
+        return chosen;
+    };
+
+    CHECK( run({1, 2, 3}) == std::vector<int>({1, 2}) );
+    // Track 3 was never recognized, so it goes first
+    CHECK( run({1, 2, 3}) == std::vector<int>({3, 1}) );
+    // Track 2 waited two frames, 1 and 3 one frame each: equal priorities keep the candidates' order
+    CHECK( run({1, 2, 3}) == std::vector<int>({2, 1}) );
+    CHECK( run({1, 2, 3}) == std::vector<int>({3, 1}) );
+    CHECK( crops.size() == 2 );
+}
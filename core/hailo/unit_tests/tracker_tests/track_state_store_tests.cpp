@@ -0,0 +1,155 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+#include "hailo_tracker.hpp"
+#include "track_state_store.hpp"
+
+// Resident set size of this process, in bytes
+static size_t resident_bytes()
+{
+    size_t total_pages = 0, resident_pages = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> total_pages >> resident_pages;
+    return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+TEST_CASE( "TrackStateStore keeps state per stream and track.", "[track_state_store]" ) {
+    TrackStateStore<int> store(8, false);
+
+    SECTION( "New tracks start value-initialized and keep their state." ) {
+        CHECK( store.update("sink_0", 1, [](int &state) { return state++; }) == 0 );
+        CHECK( store.update("sink_0", 1, [](int &state) { return state++; }) == 1 );
+        int state = -1;
+        REQUIRE( store.get("sink_0", 1, state) );
+        CHECK( state == 2 );
+        CHECK_FALSE( store.get("sink_0", 2, state) );
+        CHECK( state == 2 );
+    }
+
+    SECTION( "The same track id on different streams is a different track." ) {
+        store.set("sink_0", 7, 10);
+        store.set("sink_1", 7, 20);
+        int state = 0;
+        REQUIRE( store.get("sink_0", 7, state) );
+        CHECK( state == 10 );
+        REQUIRE( store.get("sink_1", 7, state) );
+        CHECK( state == 20 );
+        CHECK( store.erase("sink_0", 7) );
+        CHECK_FALSE( store.get("sink_0", 7, state) );
+        CHECK( store.get("sink_1", 7, state) );
+        CHECK( store.size() == 1 );
+    }
+
+    SECTION( "A full store evicts the tracks that were not used lately." ) {
+        for (int track_id = 0; track_id < 8; track_id++)
+            store.set("sink_0", track_id, track_id);
+        // One sweep clears every reference bit, then only the tracks used since are spared
+        store.set("sink_0", 100, 100);
+        store.set("sink_0", 0, 0);
+        store.set("sink_0", 101, 101);
+        CHECK( store.size() == 8 );
+        CHECK( store.evicted() >= 2 );
+        int state = 0;
+        CHECK( store.get("sink_0", 0, state) );
+        CHECK( store.get("sink_0", 100, state) );
+        CHECK( store.get("sink_0", 101, state) );
+    }
+
+    SECTION( "Erasing keeps the other tracks of the probe sequences reachable." ) {
+        for (int track_id = 0; track_id < 8; track_id++)
+            store.set("sink_0", track_id, track_id);
+        for (int track_id = 0; track_id < 8; track_id += 2)
+            CHECK( store.erase("sink_0", track_id) );
+        for (int track_id = 0; track_id < 8; track_id++)
+        {
+            int state = -1;
+            CHECK( store.get("sink_0", track_id, state) == (track_id % 2 == 1) );
+        }
+        CHECK( store.size() == 4 );
+    }
+}
+
+TEST_CASE( "TrackStateStore drops the tracks HailoTracker removes.", "[track_state_store]" ) {
+    const std::string tracker_name = "track_state_store_test_sink_0";
+    TrackStateStore<int> store(64);
+    HailoTracker::GetInstance().add_jde_tracker(tracker_name);
+
+    std::vector<int> track_ids;
+    for (int frame = 0; frame < 5; frame++)
+    {
+        std::vector<HailoDetectionPtr> detections;
+        for (int i = 0; i < 3; i++)
+            detections.push_back(std::make_shared<HailoDetection>(HailoBBox(0.1f + 0.3f * i, 0.1f, 0.2f, 0.2f), "person", 0.9f));
+        std::vector<HailoDetectionPtr> tracked = HailoTracker::GetInstance().update(tracker_name, detections, "sink_0");
+        track_ids.clear();
+        for (auto &detection : tracked)
+        {
+            int track_id = hailo_common::get_hailo_track_id(detection)[0]->get_id();
+            track_ids.push_back(track_id);
+            store.update("sink_0", track_id, [](int &frames) { return frames++; });
+        }
+    }
+    REQUIRE( track_ids.size() == 3 );
+    CHECK( store.size() == 3 );
+
+    SECTION( "Tracks that stay lost for keep-lost-frames are removed." ) {
+        std::vector<HailoDetectionPtr> no_detections;
+        for (int frame = 0; frame < 10; frame++)
+            HailoTracker::GetInstance().update(tracker_name, no_detections, "sink_0");
+        CHECK( store.size() == 0 );
+        HailoTracker::GetInstance().remove_jde_tracker(tracker_name);
+    }
+
+    SECTION( "The tracks of a removed tracker are removed." ) {
+        HailoTracker::GetInstance().remove_jde_tracker(tracker_name);
+        CHECK( store.size() == 0 );
+    }
+}
+
+// Hidden, run with: track_state_store_unit_tests "[soak]"
+TEST_CASE( "TrackStateStore memory stays flat over 10M tracks.", "[track_state_store][.][soak]" ) {
+    const int total_tracks = 10000000;
+    const int frames_per_track = 3;
+    const std::vector<std::string> streams = {"sink_0", "sink_1", "sink_2", "sink_3"};
+    TrackStateStore<int> store(1024, false);
+
+    size_t warm_rss = 0;
+    size_t max_size = 0;
+    std::vector<std::vector<int>> removed_track_ids(streams.size());
+    for (int track_id = 0; track_id < total_tracks; track_id++)
+    {
+        size_t stream = track_id % streams.size();
+        for (int frame = 0; frame < frames_per_track; frame++)
+            store.update(streams[stream], track_id, [](int &frames) { return frames++; });
+        // The tracker reports most tracks as removed, the rest are left for the store to evict
+        if (track_id % 10 != 0)
+            removed_track_ids[stream].push_back(track_id);
+        if (removed_track_ids[stream].size() == 64)
+        {
+            store.erase(streams[stream], removed_track_ids[stream]);
+            removed_track_ids[stream].clear();
+        }
+        max_size = std::max(max_size, store.size());
+        if (track_id == total_tracks / 10)
+            warm_rss = resident_bytes();
+    }
+
+    CHECK( max_size <= store.capacity() );
+    CHECK( store.evicted() > 0 );
+    // Nothing is allocated per track, so the process doesn't grow after the warm up
+    CHECK( resident_bytes() <= warm_rss + 1024 * 1024 );
+}
@@ -0,0 +1,207 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Tappas includes
+#include "common/shm_meta_ring.hpp"
+
+std::vector<uint8_t> make_message(uint64_t index, size_t size)
+{
+    std::vector<uint8_t> data(size, uint8_t(index));
+    std::memcpy(data.data(), &index, sizeof(index));
+    return data;
+}
+
+// Unique per process and call, so parallel test runs don't share rings
+std::string unique_ring_name()
+{
+    static int counter = 0;
+    return "hailo_ring_unit_test_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+}
+
+bool check_message(const shm_meta_ring::Message &message, uint64_t index, size_t size)
+{
+    return message.data == make_message(index, size);
+}
+
+TEST_CASE( "The shm meta ring hands messages over between a writer and its readers", "[shm_meta_ring]" ) {
+    std::string name = unique_ring_name();
+
+    SECTION( "Readers receive the messages published after they opened, in order." ) {
+        shm_meta_ring::Writer writer(name, 8, 256);
+        writer.publish(make_message(0, 64).data(), 64, 0); // Before the readers, not received
+        shm_meta_ring::Reader first_reader(name);
+        shm_meta_ring::Reader second_reader("/" + name);
+        for (uint64_t i = 1; i <= 5; i++)
+            REQUIRE( writer.publish(make_message(i, 64).data(), 64, 1000 * i) );
+
+        shm_meta_ring::Message message;
+        for (uint64_t i = 1; i <= 5; i++)
+        {
+            REQUIRE( first_reader.next(message, 0) );
+            CHECK( check_message(message, i, 64) );
+            CHECK( message.pts == 1000 * i );
+            CHECK( message.sequence == i );
+            REQUIRE( second_reader.next(message, 0) );
+            CHECK( check_message(message, i, 64) );
+        }
+        CHECK_FALSE( first_reader.next(message, 10) );
+        CHECK( first_reader.dropped() == 0 );
+    }
+
+    SECTION( "A slow reader drops the overwritten messages, the writer never waits." ) {
+        shm_meta_ring::Writer writer(name, 4, 64);
+        shm_meta_ring::Reader reader(name);
+        for (uint64_t i = 0; i < 10; i++)
+            REQUIRE( writer.publish(make_message(i, 16).data(), 16, i) );
+
+        shm_meta_ring::Message message;
+        for (uint64_t i = 6; i < 10; i++)
+        {
+            REQUIRE( reader.next(message, 0) );
+            CHECK( message.pts == i );
+        }
+        CHECK( reader.dropped() == 6 );
+    }
+
+    SECTION( "Messages larger than a slot are refused." ) {
+        shm_meta_ring::Writer writer(name, 4, 64);
+        CHECK_FALSE( writer.publish(make_message(0, 65).data(), 65, 0) );
+        CHECK( writer.published() == 0 );
+    }
+
+    SECTION( "A waiting reader wakes up on publish and on close." ) {
+        shm_meta_ring::Writer *writer = new shm_meta_ring::Writer(name, 4, 64);
+        shm_meta_ring::Reader reader(name);
+        std::thread publisher([writer]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            writer->publish(make_message(7, 32).data(), 32, 7);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            delete writer;
+        });
+        shm_meta_ring::Message message;
+        REQUIRE( reader.next(message, -1) );
+        CHECK( check_message(message, 7, 32) );
+        CHECK_FALSE( reader.next(message, -1) );
+        CHECK( reader.writer_closed() );
+        publisher.join();
+    }
+
+    SECTION( "Opening a ring that doesn't exist throws." ) {
+        CHECK_THROWS_AS( shm_meta_ring::Reader(name + "_missing"), std::runtime_error );
+    }
+
+    SECTION( "The segment is created with the requested mode, 0600 by default." ) {
+        struct stat segment_stat;
+        {
+            shm_meta_ring::Writer writer(name, 4, 64);
+            REQUIRE( stat(("/dev/shm/" + name).c_str(), &segment_stat) == 0 );
+            CHECK( (segment_stat.st_mode & 0777) == 0600 );
+        }
+        shm_meta_ring::Writer writer(name, 4, 64, 0660);
+        REQUIRE( stat(("/dev/shm/" + name).c_str(), &segment_stat) == 0 );
+        CHECK( (segment_stat.st_mode & 0777) == 0660 );
+    }
+
+    SECTION( "A waiting reader notices a writer that replaced the segment, which the old writer leaves in place." ) {
+        std::unique_ptr<shm_meta_ring::Writer> old_writer(new shm_meta_ring::Writer(name, 4, 64));
+        shm_meta_ring::Reader reader(name);
+        CHECK_FALSE( reader.writer_gone() );
+        shm_meta_ring::Writer new_writer(name, 4, 64);
+        CHECK( reader.writer_gone() );
+        shm_meta_ring::Message message;
+        CHECK_FALSE( reader.next(message, -1) );
+
+        old_writer.reset();
+        shm_meta_ring::Reader new_reader(name);
+        REQUIRE( new_writer.publish(make_message(1, 16).data(), 16, 1) );
+        REQUIRE( new_reader.next(message, 0) );
+        CHECK( check_message(message, 1, 16) );
+    }
+
+    SECTION( "A waiting reader notices a writer that died without closing the ring." ) {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            // Exits without the destructor, the segment stays and is never closed
+            new shm_meta_ring::Writer(name, 4, 64);
+            _exit(0);
+        }
+        int status;
+        REQUIRE( waitpid(pid, &status, 0) == pid );
+        {
+            shm_meta_ring::Reader reader(name);
+            CHECK_FALSE( reader.writer_closed() );
+            CHECK( reader.writer_gone() );
+            shm_meta_ring::Message message;
+            CHECK_FALSE( reader.next(message, -1) );
+        }
+        shm_unlink(("/" + name).c_str());
+    }
+}
+
+TEST_CASE( "The shm meta ring works across processes", "[shm_meta_ring]" ) {
+    const int num_messages = 20000;
+    const size_t message_size = 2048;
+    std::string name = unique_ring_name();
+    std::unique_ptr<shm_meta_ring::Writer> writer(new shm_meta_ring::Writer(name, 16, message_size));
+    int ready_pipe[2];
+    REQUIRE( pipe(ready_pipe) == 0 );
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // The child reads every message and checks its content, the exit status is the result
+        int status = 0;
+        {
+            shm_meta_ring::Reader reader(name);
+            char ready = 1;
+            if (write(ready_pipe[1], &ready, 1) != 1)
+                _exit(2);
+            shm_meta_ring::Message message;
+            uint64_t received = 0;
+            while (reader.next(message, 5000))
+            {
+                if (!check_message(message, message.pts, message_size))
+                    status = 1;
+                received++;
+            }
+            if (received + reader.dropped() != (uint64_t)num_messages || !reader.writer_closed())
+                status = 1;
+        }
+        _exit(status);
+    }
+
+    char ready;
+    REQUIRE( read(ready_pipe[0], &ready, 1) == 1 );
+    for (int i = 0; i < num_messages; i++)
+    {
+        std::vector<uint8_t> data = make_message(i, message_size);
+        writer->publish(data.data(), data.size(), i);
+        if (i % 4 == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    // Closing the ring ends the reading loop of the child
+    writer.reset();
+
+    int status;
+    REQUIRE( waitpid(pid, &status, 0) == pid );
+    CHECK( WIFEXITED(status) );
+    CHECK( WEXITSTATUS(status) == 0 );
+}
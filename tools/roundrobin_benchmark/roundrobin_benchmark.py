@@ -0,0 +1,115 @@
+"""
+Synthetic multi-source benchmark of the hailoroundrobin scheduling modes.
+
+Mixes live videotestsrc sources of different frame rates into hailoroundrobin, simulates a shared
+accelerator with an identity element that sleeps on every buffer, and demuxes the streams back
+with hailostreamrouter. For every mode, reports per stream throughput and end-to-end latency
+(sink running time minus buffer timestamp), plus the element's own statistics in adaptive mode.
+
+Usage:
+    python roundrobin_benchmark.py --framerates 30 30 30 5 5 --inference-time 8 --duration 10
+    python roundrobin_benchmark.py --modes blocking-mode adaptive-mode --queue-size 2
+"""
+import argparse
+import statistics
+
+import gi
+
+gi.require_version('Gst', '1.0')
+from gi.repository import Gst, GLib
+
+Gst.init(None)
+
+ALL_MODES = ["funnel-mode", "blocking-mode", "non-blocking-mode", "adaptive-mode"]
+
+
+def parse_args():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--framerates", type=int, nargs="+", default=[30, 30, 30, 30, 5, 5, 5, 5],
+                        help="Frame rate of each source")
+    parser.add_argument("--inference-time", type=float, default=6.0,
+                        help="Simulated processing time of every buffer in ms")
+    parser.add_argument("--duration", type=float, default=10.0, help="Duration of every run in seconds")
+    parser.add_argument("--queue-size", type=int, default=3, help="hailoroundrobin queue-size")
+    parser.add_argument("--modes", nargs="+", default=ALL_MODES, choices=ALL_MODES, help="Modes to benchmark")
+    return parser.parse_args()
+
+
+def build_pipeline_string(args, mode):
+    num_of_sources = len(args.framerates)
+    router_pads = " ".join(f"src_{n}::input-streams='<sink_{n}>'" for n in range(num_of_sources))
+    pipeline = f"hailoroundrobin name=rr mode={mode} queue-size={args.queue_size} ! " \
+               f"identity sleep-time={int(args.inference_time * 1000)} ! " \
+               f"hailostreamrouter name=router {router_pads} "
+    for n, framerate in enumerate(args.framerates):
+        pipeline += f"videotestsrc is-live=true pattern=ball ! video/x-raw,width=320,height=240,framerate={framerate}/1 ! " \
+                    f"queue leaky=no max-size-buffers=5 max-size-bytes=0 max-size-time=0 ! rr.sink_{n} "
+        pipeline += f"router.src_{n} ! fakesink name=sink_{n} sync=false async=false "
+    return pipeline
+
+
+def run_mode(args, mode):
+    pipeline = Gst.parse_launch(build_pipeline_string(args, mode))
+    latencies = [[] for _ in args.framerates]
+
+    def on_buffer(pad, info, stream):
+        clock = pipeline.get_clock()
+        buffer = info.get_buffer()
+        if clock is not None and buffer.pts != Gst.CLOCK_TIME_NONE:
+            running_time = clock.get_time() - pipeline.get_base_time()
+            latencies[stream].append((running_time - buffer.pts) / Gst.MSECOND)
+        return Gst.PadProbeReturn.OK
+
+    for n in range(len(args.framerates)):
+        sink_pad = pipeline.get_by_name(f"sink_{n}").get_static_pad("sink")
+        sink_pad.add_probe(Gst.PadProbeType.BUFFER, on_buffer, n)
+
+    loop = GLib.MainLoop()
+    bus = pipeline.get_bus()
+    bus.add_signal_watch()
+
+    def on_message(bus, message):
+        if message.type == Gst.MessageType.ERROR:
+            err, debug = message.parse_error()
+            print(f"{mode}: {err}: {debug}")
+            loop.quit()
+        return True
+
+    bus.connect("message", on_message)
+    pipeline.set_state(Gst.State.PLAYING)
+    GLib.timeout_add(int(args.duration * 1000), loop.quit)
+    loop.run()
+
+    stats = pipeline.get_by_name("rr").get_property("stats")
+    pipeline.set_state(Gst.State.NULL)
+    bus.remove_signal_watch()
+    return latencies, stats
+
+
+def print_results(args, mode, latencies, stats):
+    print(f"\n{mode}")
+    print(f"{'stream':>8} {'fps in':>7} {'fps out':>8} {'avg ms':>8} {'p99 ms':>8} {'max ms':>8} {'dropped':>8}")
+    for n, framerate in enumerate(args.framerates):
+        stream_latencies = sorted(latencies[n])
+        dropped = "-"
+        if mode == "adaptive-mode" and stats is not None and stats.has_field(f"sink_{n}"):
+            dropped = str(stats.get_value(f"sink_{n}").get_value("dropped"))
+        if not stream_latencies:
+            print(f"{n:>8} {framerate:>7} {0:>8.1f} {'-':>8} {'-':>8} {'-':>8} {dropped:>8}")
+            continue
+        p99 = stream_latencies[min(len(stream_latencies) - 1, int(len(stream_latencies) * 0.99))]
+        print(f"{n:>8} {framerate:>7} {len(stream_latencies) / args.duration:>8.1f} "
+              f"{statistics.mean(stream_latencies):>8.1f} {p99:>8.1f} {stream_latencies[-1]:>8.1f} {dropped:>8}")
+
+
+def main():
+    args = parse_args()
+    print(f"sources: {args.framerates} fps, simulated inference: {args.inference_time} ms, "
+          f"load: {sum(args.framerates) * args.inference_time / 1000:.0%}")
+    for mode in args.modes:
+        latencies, stats = run_mode(args, mode)
+        print_results(args, mode, latencies, stats)
+
+
+if __name__ == '__main__':
+    main()